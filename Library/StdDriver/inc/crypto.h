@@ -88,6 +88,8 @@ extern "C"
 #define CRYPTO_DMA_CONTINUE     0x6UL   /*!< Do continuous encrypt/decrypt in DMA cascade \hideinitializer */
 #define CRYPTO_DMA_LAST         0x7UL   /*!< Do last encrypt/decrypt in DMA cascade          \hideinitializer */
 
+#define ECC_KEY_WORD_MAX        18      /*!< Word count of an ECC number for the ECC_xxxWords APIs \hideinitializer */
+
 typedef enum
 {
     /*!< ECC curve                \hideinitializer */
@@ -116,6 +118,56 @@ typedef enum
 }
 E_ECC_CURVE;                            /*!< ECC curve                \hideinitializer */
 
+#define CRPT_JOB_AES            0UL     /*!< Job runs on the AES engine              \hideinitializer */
+#define CRPT_JOB_TDES           1UL     /*!< Job runs on the DES/TDES engine         \hideinitializer */
+#define CRPT_JOB_SHA            2UL     /*!< Job runs on the SHA/HMAC engine         \hideinitializer */
+#define CRPT_JOB_ECC            3UL     /*!< Job runs on the ECC engine              \hideinitializer */
+#define CRPT_JOB_ENGINE_CNT     4UL     /*!< Number of engines with a job queue      \hideinitializer */
+
+#define CRPT_JOB_DONE           0L      /*!< Job finished successfully               \hideinitializer */
+#define CRPT_JOB_QUEUED         1L      /*!< Job is waiting for its engine           \hideinitializer */
+#define CRPT_JOB_RUNNING        2L      /*!< Job is running on its engine            \hideinitializer */
+#define CRPT_JOB_FAILED         (-1L)   /*!< Engine reported an error for the job    \hideinitializer */
+
+/**
+  * @brief  One register write of a job's start sequence.
+  */
+typedef struct
+{
+    volatile uint32_t  *pu32Reg;        /*!< Register to write                       */
+    uint32_t           u32Val;          /*!< Value to write                          */
+} CRPT_JOB_REG_T;
+
+/**
+  * @brief  A queued crypto job. The register writes are replayed in order to start
+  *         the job, the last one being the write that sets START, so the next job
+  *         of an engine is started right from the CRYPTO interrupt.
+  */
+typedef struct crpt_job_t
+{
+    uint32_t                u32Engine;  /*!< CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC */
+    const CRPT_JOB_REG_T    *pRegs;     /*!< Start sequence, must stay valid until the job is done */
+    uint32_t                u32RegCnt;  /*!< Number of entries in pRegs              */
+    void  (*pfnDone)(struct crpt_job_t *job);   /*!< Called from the CRYPTO interrupt when done, before the next
+                                                     job of the engine starts, may be NULL */
+    void                    *pvParam;   /*!< Free for the owner of pfnDone           */
+    volatile int32_t        i32Status;  /*!< CRPT_JOB_QUEUED/RUNNING/DONE/FAILED     */
+    struct crpt_job_t       *pNext;     /*!< Queue link, used by the driver          */
+} CRPT_JOB_T;
+
+/**
+  * @brief  Per engine job statistics.
+  */
+typedef struct
+{
+    uint32_t  u32Submitted;             /*!< Jobs submitted                          */
+    uint32_t  u32Completed;             /*!< Jobs finished, including failed ones    */
+    uint32_t  u32Failed;                /*!< Jobs the engine reported an error for   */
+    uint32_t  u32Depth;                 /*!< Jobs queued or running now              */
+    uint32_t  u32MaxDepth;              /*!< Highest u32Depth seen                   */
+    uint64_t  u64BusyCycles;            /*!< CPU cycles the engine spent running jobs */
+} CRPT_JOB_STAT_T;
+
 
 /*@}*/ /* end of group CRYPTO_EXPORTED_CONSTANTS */
 
@@ -352,6 +404,15 @@ void SHA_Open(CRPT_T *crpt, uint32_t u32OpMode, uint32_t u32SwapType, uint32_t h
 void SHA_Start(CRPT_T *crpt, uint32_t u32DMAMode);
 void SHA_SetDMATransfer(CRPT_T *crpt, uint32_t u32SrcAddr, uint32_t u32TransCnt);
 void SHA_Read(CRPT_T *crpt, uint32_t u32Digest[]);
+int32_t  CRPT_JobSubmit(CRPT_T *crpt, CRPT_JOB_T *job);
+int32_t  CRPT_JobRun(CRPT_T *crpt, CRPT_JOB_T *job);
+void CRPT_JobSetRunner(int32_t (*pfnRunner)(CRPT_T *crpt, CRPT_JOB_T *job));
+void CRPT_JobSetLock(void (*pfnLock)(uint32_t u32Engine), void (*pfnUnlock)(uint32_t u32Engine));
+void CRPT_JobLock(uint32_t u32Engine);
+void CRPT_JobUnlock(uint32_t u32Engine);
+uint32_t CRPT_JobIRQHandler(CRPT_T *crpt);
+void CRPT_JobGetStat(uint32_t u32Engine, CRPT_JOB_STAT_T *pStat);
+void CRPT_JobClearStat(void);
 void ECC_Complete(CRPT_T *crpt);
 int  ECC_IsPrivateKeyValid(CRPT_T *crpt, E_ECC_CURVE ecc_curve,  char private_k[]);
 int32_t  ECC_GeneratePublicKey(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_k, char public_k1[], char public_k2[]);
@@ -359,6 +420,10 @@ int32_t  ECC_Mutiply(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char x1[], char y1[],
 int32_t  ECC_GenerateSecretZ(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_k, char public_k1[], char public_k2[], char secret_z[]);
 int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message, char *d, char *k, char *R, char *S);
 int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message, char *public_k1, char *public_k2, char *R, char *S);
+int32_t  ECC_MultiplyWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t x1[], const uint32_t y1[], const uint32_t k[], uint32_t x2[], uint32_t y2[]);
+int32_t  ECC_GenerateSecretZWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t private_k[], const uint32_t public_k1[], const uint32_t public_k2[], uint32_t secret_z[]);
+int32_t  ECC_GenerateSignatureWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t message[], const uint32_t d[], const uint32_t k[], uint32_t R[], uint32_t S[]);
+int32_t  ECC_VerifySignatureWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t message[], const uint32_t public_k1[], const uint32_t public_k2[], const uint32_t R[], const uint32_t S[]);
 
 
 /*@}*/ /* end of group CRYPTO_EXPORTED_FUNCTIONS */
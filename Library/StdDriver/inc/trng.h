@@ -50,10 +50,40 @@ extern "C"
   */
 #define TRNG_SET_CLKP(clkpsc) do { TRNG->CTL = (TRNG->CTL&~TRNG_CTL_CLKP_Msk)|((clkpsc & 0xf)<<TRNG_CTL_CLKP_Pos); } while(0);
 
+/**
+  * @brief  Byte size of the TRNG entropy pool. The pool is filled in the background by
+  *         TRNG_PoolIRQHandler() or TRNG_PoolHarvest() and drained by TRNG_PoolRead().
+  *         Must be a power of 2.
+  * \hideinitializer
+  */
+#ifndef TRNG_POOL_SIZE
+#define TRNG_POOL_SIZE      256UL
+#endif
+
 
 /*@}*/ /* end of group M480_TRNG_EXPORTED_MACROS */
 
 
+/** @addtogroup M480_TRNG_EXPORTED_STRUCTS TRNG Exported Structs
+  @{
+*/
+
+/**
+  * @brief  Counters of the TRNG entropy pool, see TRNG_PoolGetStat().
+  */
+typedef struct
+{
+    uint32_t u32Level;          /*!< Bytes currently in the pool */
+    uint32_t u32Size;           /*!< Capacity of the pool, TRNG_POOL_SIZE */
+    uint32_t u32Harvested;      /*!< Bytes moved from the TRNG into the pool */
+    uint32_t u32Consumed;       /*!< Bytes handed out by TRNG_PoolRead() */
+    uint32_t u32Stalls;         /*!< TRNG_PoolReadWait() calls that found the pool short and had to wait */
+    uint32_t u32Pauses;         /*!< Times harvesting stopped because the pool was full */
+} TRNG_POOL_STAT_T;
+
+/*@}*/ /* end of group M480_TRNG_EXPORTED_STRUCTS */
+
+
 /** @addtogroup TRNG_EXPORTED_FUNCTIONS TRNG Exported Functions
   @{
 */
@@ -67,6 +97,12 @@ void TRNG_Open(void);
 int32_t TRNG_GenWord(uint32_t *u32RndNum);
 int32_t TRNG_GenBignum(uint8_t u8BigNum[], int32_t i32Len);
 int32_t TRNG_GenBignumHex(char cBigNumHex[], int32_t i32Len);
+void TRNG_PoolOpen(void);
+void TRNG_PoolIRQHandler(void);
+uint32_t TRNG_PoolHarvest(void);
+uint32_t TRNG_PoolRead(uint8_t au8Buf[], uint32_t u32Len);
+int32_t TRNG_PoolReadWait(uint8_t au8Buf[], uint32_t u32Len);
+void TRNG_PoolGetStat(TRNG_POOL_STAT_T *psStat);
 
 
 /*@}*/ /* end of group TRNG_EXPORTED_FUNCTIONS */
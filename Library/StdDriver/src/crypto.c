@@ -46,7 +46,7 @@ static void dump_ecc_reg(char *str, uint32_t volatile regs[], int32_t count);
 static char get_Nth_nibble_char(uint32_t val32, uint32_t idx);
 static void Hex2Reg(char input[], uint32_t volatile reg[]);
 static void Reg2Hex(int32_t count, uint32_t volatile reg[], char output[]);
-static void Hex2RegEx(char input[], uint32_t volatile reg[], int shift);
+static void ecc_hex2words(char input[], uint32_t output[]);
 static char ch2hex(char ch);
 static int  get_nibble_value(char c);
 
@@ -456,6 +456,303 @@ void SHA_Read(CRPT_T *crpt, uint32_t u32Digest[])
 
 /** @cond HIDDEN_SYMBOLS */
 
+/*-----------------------------------------------------------------------------------------------*/
+/*                                                                                               */
+/*    Job queue                                                                                  */
+/*                                                                                               */
+/*-----------------------------------------------------------------------------------------------*/
+
+static CRPT_JOB_T  *s_apJobHead[CRPT_JOB_ENGINE_CNT];
+static CRPT_JOB_T  *s_apJobTail[CRPT_JOB_ENGINE_CNT];
+static CRPT_JOB_STAT_T  s_JobStat[CRPT_JOB_ENGINE_CNT];
+static uint32_t  s_au32JobStart[CRPT_JOB_ENGINE_CNT];     /* DWT cycle count when the head job was started */
+static int32_t (*s_pfnJobRunner)(CRPT_T *crpt, CRPT_JOB_T *job);
+static void (*s_pfnJobLock)(uint32_t u32Engine);
+static void (*s_pfnJobUnlock)(uint32_t u32Engine);
+
+/* INTSTS done and error flags of each engine, in CRPT_JOB_xxx order */
+static const uint32_t s_au32JobDoneFlag[CRPT_JOB_ENGINE_CNT] =
+{
+    CRPT_INTSTS_AESIF_Msk, CRPT_INTSTS_TDESIF_Msk, CRPT_INTSTS_HMACIF_Msk, CRPT_INTSTS_ECCIF_Msk
+};
+static const uint32_t s_au32JobErrFlag[CRPT_JOB_ENGINE_CNT] =
+{
+    CRPT_INTSTS_AESEIF_Msk, CRPT_INTSTS_TDESEIF_Msk, CRPT_INTSTS_HMACEIF_Msk, CRPT_INTSTS_ECCEIF_Msk
+};
+
+static void crpt_job_start(uint32_t u32Engine)
+{
+    CRPT_JOB_T  *job = s_apJobHead[u32Engine];
+    uint32_t    i;
+
+    job->i32Status = CRPT_JOB_RUNNING;
+    s_au32JobStart[u32Engine] = DWT->CYCCNT;
+
+    for (i = 0UL; i < job->u32RegCnt; i++)
+    {
+        *job->pRegs[i].pu32Reg = job->pRegs[i].u32Val;
+    }
+}
+
+/* Retire the running job of an engine and start the next one. Called with the CRYPTO interrupt masked or from it. */
+static void crpt_job_complete(uint32_t u32Engine, int32_t i32Status)
+{
+    CRPT_JOB_T  *job = s_apJobHead[u32Engine];
+
+    if (job == NULL)
+    {
+        return;
+    }
+
+    s_JobStat[u32Engine].u64BusyCycles += (uint32_t)(DWT->CYCCNT - s_au32JobStart[u32Engine]);
+    s_JobStat[u32Engine].u32Completed++;
+    s_JobStat[u32Engine].u32Depth--;
+    if (i32Status != CRPT_JOB_DONE)
+    {
+        s_JobStat[u32Engine].u32Failed++;
+    }
+
+    s_apJobHead[u32Engine] = job->pNext;
+    if (s_apJobHead[u32Engine] == NULL)
+    {
+        s_apJobTail[u32Engine] = NULL;
+    }
+
+    /* Before the next job overwrites the result registers, HMAC_DGST or ECC_X1/Y1 */
+    if (job->pfnDone != NULL)
+    {
+        job->pfnDone(job);
+    }
+
+    /* Last access, the owner may reuse the job as soon as it sees the status */
+    job->i32Status = i32Status;
+
+    /* pfnDone may have submitted a job to the idle engine, which started it already */
+    if ((s_apJobHead[u32Engine] != NULL) && (s_apJobHead[u32Engine]->i32Status == CRPT_JOB_QUEUED))
+    {
+        crpt_job_start(u32Engine);
+    }
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+/**
+  * @brief  Queue a job on its engine. The job is started at once if the engine is idle,
+  *         otherwise from the CRYPTO interrupt when the jobs ahead of it are done.
+  * @param[in]  crpt        Reference to Crypto module.
+  * @param[in]  job         The job. It must stay valid until its status is no longer
+  *                         CRPT_JOB_QUEUED or CRPT_JOB_RUNNING.
+  * @return  0    Success.
+  * @return  -1   Invalid engine.
+  * @details  Completion is reported by CRPT_JobIRQHandler() for AES, TDES and SHA jobs and
+  *           by ECC_Complete() for ECC jobs, one of which the CRYPTO_IRQHandler() must call.
+  */
+int32_t  CRPT_JobSubmit(CRPT_T *crpt, CRPT_JOB_T *job)
+{
+    uint32_t  u32Engine = job->u32Engine;
+    uint32_t  u32PriMask;
+
+    (void)crpt;
+
+    if (u32Engine >= CRPT_JOB_ENGINE_CNT)
+    {
+        return -1;
+    }
+
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0UL)
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    job->pNext = NULL;
+    job->i32Status = CRPT_JOB_QUEUED;
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    s_JobStat[u32Engine].u32Submitted++;
+    if (++s_JobStat[u32Engine].u32Depth > s_JobStat[u32Engine].u32MaxDepth)
+    {
+        s_JobStat[u32Engine].u32MaxDepth = s_JobStat[u32Engine].u32Depth;
+    }
+
+    if (s_apJobTail[u32Engine] == NULL)
+    {
+        s_apJobHead[u32Engine] = job;
+        s_apJobTail[u32Engine] = job;
+        crpt_job_start(u32Engine);
+    }
+    else
+    {
+        s_apJobTail[u32Engine]->pNext = job;
+        s_apJobTail[u32Engine] = job;
+    }
+
+    __set_PRIMASK(u32PriMask);
+    return 0;
+}
+
+/**
+  * @brief  Submit a job and wait until it is done. Busy-waits unless a runner was
+  *         installed by CRPT_JobSetRunner().
+  * @param[in]  crpt        Reference to Crypto module.
+  * @param[in]  job         The job.
+  * @return  CRPT_JOB_DONE    Success.
+  * @return  CRPT_JOB_FAILED  The engine reported an error.
+  * @return  -1               Invalid engine.
+  * @details  The result registers of the engine still hold the result of the job on
+  *           return if no other job was queued behind it, as when the caller holds the
+  *           engine with CRPT_JobLock().
+  */
+int32_t  CRPT_JobRun(CRPT_T *crpt, CRPT_JOB_T *job)
+{
+    if (s_pfnJobRunner != NULL)
+    {
+        return s_pfnJobRunner(crpt, job);
+    }
+
+    job->pfnDone = NULL;
+    if (CRPT_JobSubmit(crpt, job) != 0)
+    {
+        return -1;
+    }
+
+    while (job->i32Status > CRPT_JOB_DONE)
+    {
+    }
+    return job->i32Status;
+}
+
+/**
+  * @brief  Install the function CRPT_JobRun() hands its jobs to, for example one that
+  *         blocks the calling RTOS task until the job's pfnDone callback wakes it up.
+  * @param[in]  pfnRunner   The runner, or NULL to go back to busy-waiting.
+  * @return None
+  */
+void CRPT_JobSetRunner(int32_t (*pfnRunner)(CRPT_T *crpt, CRPT_JOB_T *job))
+{
+    s_pfnJobRunner = pfnRunner;
+}
+
+/**
+  * @brief  Install the functions CRPT_JobLock() and CRPT_JobUnlock() call, for example
+  *         ones that take and give one recursive RTOS mutex per engine.
+  * @param[in]  pfnLock     Called with CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC
+  *                         to get exclusive use of the engine, or NULL.
+  * @param[in]  pfnUnlock   Gives the engine back, or NULL.
+  * @return None
+  * @details  The lock must be recursive: a caller holding an engine may call other code
+  *           that locks the same engine. It is never taken from the CRYPTO interrupt.
+  */
+void CRPT_JobSetLock(void (*pfnLock)(uint32_t u32Engine), void (*pfnUnlock)(uint32_t u32Engine))
+{
+    s_pfnJobLock = pfnLock;
+    s_pfnJobUnlock = pfnUnlock;
+}
+
+/**
+  * @brief  Get exclusive use of an engine for a sequence of register writes and jobs that
+  *         must not be interleaved with those of another task: loading keys and IVs, a DMA
+  *         cascade, and the data buffers the sequence shares with other callers. Does
+  *         nothing unless a lock was installed by CRPT_JobSetLock().
+  * @param[in]  u32Engine   CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC.
+  * @return None
+  */
+void CRPT_JobLock(uint32_t u32Engine)
+{
+    if (s_pfnJobLock != NULL)
+    {
+        s_pfnJobLock(u32Engine);
+    }
+}
+
+/**
+  * @brief  Give back an engine taken by CRPT_JobLock().
+  * @param[in]  u32Engine   CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC.
+  * @return None
+  */
+void CRPT_JobUnlock(uint32_t u32Engine)
+{
+    if (s_pfnJobUnlock != NULL)
+    {
+        s_pfnJobUnlock(u32Engine);
+    }
+}
+
+/**
+  * @brief  Retire finished AES, TDES and SHA jobs and start the next queued ones.
+  *         User application must invoke this function in his CRYPTO_IRQHandler().
+  *         Flags of engines without a queued job are left for the application.
+  * @param[in]  crpt        Reference to Crypto module.
+  * @return  The AES, TDES and SHA flags of INTSTS the application may handle and clear.
+  * @details  Flags of engines with jobs must be left alone: the next job may have finished
+  *           while the pfnDone of the one before ran, clearing its flag would lose it.
+  */
+uint32_t CRPT_JobIRQHandler(CRPT_T *crpt)
+{
+    uint32_t  u32Engine, u32Sts, u32Free = 0UL;
+
+    for (u32Engine = CRPT_JOB_AES; u32Engine <= CRPT_JOB_SHA; u32Engine++)
+    {
+        if (s_apJobHead[u32Engine] == NULL)
+        {
+            u32Free |= s_au32JobDoneFlag[u32Engine] | s_au32JobErrFlag[u32Engine];
+            continue;
+        }
+
+        u32Sts = crpt->INTSTS & (s_au32JobDoneFlag[u32Engine] | s_au32JobErrFlag[u32Engine]);
+        if (u32Sts != 0UL)
+        {
+            crpt->INTSTS = u32Sts;
+            crpt_job_complete(u32Engine, (u32Sts & s_au32JobErrFlag[u32Engine]) ? CRPT_JOB_FAILED : CRPT_JOB_DONE);
+        }
+    }
+    return crpt->INTSTS & u32Free;
+}
+
+/**
+  * @brief  Get the job statistics of an engine.
+  * @param[in]  u32Engine   CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC.
+  * @param[out] pStat       The statistics.
+  * @return None
+  */
+void CRPT_JobGetStat(uint32_t u32Engine, CRPT_JOB_STAT_T *pStat)
+{
+    uint32_t  u32PriMask;
+
+    if (u32Engine < CRPT_JOB_ENGINE_CNT)
+    {
+        u32PriMask = __get_PRIMASK();
+        __disable_irq();
+        *pStat = s_JobStat[u32Engine];
+        __set_PRIMASK(u32PriMask);
+    }
+}
+
+/**
+  * @brief  Clear the job statistics of all engines. Queue depths are kept.
+  * @return None
+  */
+void CRPT_JobClearStat(void)
+{
+    uint32_t  i, u32PriMask;
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+    for (i = 0UL; i < CRPT_JOB_ENGINE_CNT; i++)
+    {
+        s_JobStat[i].u32Submitted = 0UL;
+        s_JobStat[i].u32Completed = 0UL;
+        s_JobStat[i].u32Failed = 0UL;
+        s_JobStat[i].u32MaxDepth = s_JobStat[i].u32Depth;
+        s_JobStat[i].u64BusyCycles = 0ULL;
+    }
+    __set_PRIMASK(u32PriMask);
+}
+
+/** @cond HIDDEN_SYMBOLS */
+
 /*-----------------------------------------------------------------------------------------------*/
 /*                                                                                               */
 /*    ECC                                                                                        */
@@ -886,6 +1183,13 @@ const ECC_CURVE _Curve[] =
 static ECC_CURVE  *pCurve;
 static ECC_CURVE  Curve_Copy;
 
+/* Curve parameters parsed by the last ecc_init_curve(), in words */
+static E_ECC_CURVE  ecc_loaded_curve = CURVE_UNDEF;
+static uint32_t  ecc_a[18], ecc_b[18];      /* curve coefficients */
+static uint32_t  ecc_gx[18], ecc_gy[18];    /* base point G */
+static uint32_t  ecc_modulus[18];           /* prime modulus or irreducible polynomial */
+static uint32_t  ecc_order[18];             /* curve order */
+
 static ECC_CURVE * get_curve(E_ECC_CURVE ecc_curve);
 static int32_t ecc_init_curve(CRPT_T *crpt, E_ECC_CURVE ecc_curve);
 static void run_ecc_codec(CRPT_T *crpt, uint32_t mode);
@@ -950,33 +1254,15 @@ static void Hex2Reg(char input[], uint32_t volatile reg[])
     }
 }
 
-static void Hex2RegEx(char input[], uint32_t volatile reg[], int shift)
+static void ecc_hex2words(char input[], uint32_t output[])
 {
-    uint32_t  hex, carry;
-    int       si, ri;
-    uint32_t  i, val32;
-
-    si = (int)strlen(input) - 1;
-    ri = 0L;
-    carry = 0UL;
-    while (si >= 0)
-    {
-        val32 = 0UL;
-        for (i = 0UL; (i < 8UL) && (si >= 0L); i++)
-        {
-            hex = (uint32_t)ch2hex(input[si]);
-            hex <<= shift;
+    int32_t  i;
 
-            val32 |= (uint32_t)((hex & 0xFUL) | carry) << (i * 4UL);
-            carry = (hex >> 4UL) & 0xFUL;
-            si--;
-        }
-        reg[ri++] = val32;
-    }
-    if (carry != 0UL)
+    for (i = 0; i < 18; i++)
     {
-        reg[ri] = carry;
+        output[i] = 0UL;
     }
+    Hex2Reg(input, output);
 }
 
 /**
@@ -1035,94 +1321,150 @@ static int32_t ecc_init_curve(CRPT_T *crpt, E_ECC_CURVE ecc_curve)
 {
     int32_t  i, ret = 0;
 
-    pCurve = get_curve(ecc_curve);
-    if (pCurve == NULL)
+    /*
+     *  The hex strings of a curve are only parsed when the curve changes. The registers
+     *  are written every time: the application, or a job of the CRPT job queue, may have
+     *  used the engine with other values since.
+     */
+    if ((ecc_curve != ecc_loaded_curve) || (ecc_curve == CURVE_UNDEF))
+    {
+        ecc_loaded_curve = CURVE_UNDEF;
+
+        pCurve = get_curve(ecc_curve);
+        if (pCurve == NULL)
+        {
+            CRPT_DBGMSG("Cannot find curve %d!!\n", ecc_curve);
+            ret = -1;
+        }
+
+        if (ret == 0)
+        {
+            for (i = 0; i < 18; i++)
+            {
+                ecc_a[i] = 0UL;
+                ecc_b[i] = 0UL;
+                ecc_gx[i] = 0UL;
+                ecc_gy[i] = 0UL;
+                ecc_modulus[i] = 0UL;
+                ecc_order[i] = 0UL;
+            }
+
+            Hex2Reg(pCurve->Ea, ecc_a);
+            Hex2Reg(pCurve->Eb, ecc_b);
+            Hex2Reg(pCurve->Px, ecc_gx);
+            Hex2Reg(pCurve->Py, ecc_gy);
+            Hex2Reg(pCurve->Eorder, ecc_order);
+
+            if (pCurve->GF == (int)CURVE_GF_2M)
+            {
+                ecc_modulus[0] = 0x1UL;
+                ecc_modulus[(pCurve->key_len) / 32] |= (1UL << ((pCurve->key_len) % 32));
+                ecc_modulus[(pCurve->irreducible_k1) / 32] |= (1UL << ((pCurve->irreducible_k1) % 32));
+                ecc_modulus[(pCurve->irreducible_k2) / 32] |= (1UL << ((pCurve->irreducible_k2) % 32));
+                ecc_modulus[(pCurve->irreducible_k3) / 32] |= (1UL << ((pCurve->irreducible_k3) % 32));
+            }
+            else
+            {
+                Hex2Reg(pCurve->Pp, ecc_modulus);
+            }
+
+            ecc_loaded_curve = ecc_curve;
+        }
+    }
+    else if ((pCurve == NULL) || (pCurve->curve_id != ecc_curve))
     {
-        CRPT_DBGMSG("Cannot find curve %d!!\n", ecc_curve);
-        ret = -1;
+        pCurve = get_curve(ecc_curve);
     }
 
     if (ret == 0)
     {
         for (i = 0; i < 18; i++)
         {
-            crpt->ECC_A[i] = 0UL;
-            crpt->ECC_B[i] = 0UL;
-            crpt->ECC_X1[i] = 0UL;
-            crpt->ECC_Y1[i] = 0UL;
-            crpt->ECC_N[i] = 0UL;
+            crpt->ECC_A[i] = ecc_a[i];
+            crpt->ECC_B[i] = ecc_b[i];
+            crpt->ECC_X1[i] = ecc_gx[i];
+            crpt->ECC_Y1[i] = ecc_gy[i];
+            crpt->ECC_N[i] = ecc_modulus[i];
         }
 
-        Hex2Reg(pCurve->Ea, crpt->ECC_A);
-        Hex2Reg(pCurve->Eb, crpt->ECC_B);
-        Hex2Reg(pCurve->Px, crpt->ECC_X1);
-        Hex2Reg(pCurve->Py, crpt->ECC_Y1);
-
         CRPT_DBGMSG("Key length = %d\n", pCurve->key_len);
         dump_ecc_reg("CRPT_ECC_CURVE_A", crpt->ECC_A, 10);
         dump_ecc_reg("CRPT_ECC_CURVE_B", crpt->ECC_B, 10);
         dump_ecc_reg("CRPT_ECC_POINT_X1", crpt->ECC_X1, 10);
         dump_ecc_reg("CRPT_ECC_POINT_Y1", crpt->ECC_Y1, 10);
-
-        if (pCurve->GF == (int)CURVE_GF_2M)
-        {
-            crpt->ECC_N[0] = 0x1UL;
-            crpt->ECC_N[(pCurve->key_len) / 32] |= (1UL << ((pCurve->key_len) % 32));
-            crpt->ECC_N[(pCurve->irreducible_k1) / 32] |= (1UL << ((pCurve->irreducible_k1) % 32));
-            crpt->ECC_N[(pCurve->irreducible_k2) / 32] |= (1UL << ((pCurve->irreducible_k2) % 32));
-            crpt->ECC_N[(pCurve->irreducible_k3) / 32] |= (1UL << ((pCurve->irreducible_k3) % 32));
-        }
-        else
-        {
-            Hex2Reg(pCurve->Pp, crpt->ECC_N);
-        }
     }
     dump_ecc_reg("CRPT_ECC_CURVE_N", crpt->ECC_N, 10);
     return ret;
 }
 
-static int  get_nibble_value(char c)
+/* Switch ECC_N from the modulus to the curve order for the modular operations */
+static void ecc_load_order(CRPT_T *crpt)
 {
-    if ((c >= '0') && (c <= '9'))
+    int32_t  i;
+
+    for (i = 0; i < 18; i++)
     {
-        c = c - '0';
+        crpt->ECC_N[i] = ecc_order[i];
     }
+}
 
-    if ((c >= 'a') && (c <= 'f'))
+static void ecc_load_words(const uint32_t input[], uint32_t volatile reg[])
+{
+    int32_t  i;
+
+    for (i = 0; i < 18; i++)
     {
-        c = c - 'a' + (char)10;
+        reg[i] = input[i];
     }
+}
 
-    if ((c >= 'A') && (c <= 'F'))
+/* Same as ecc_load_words() but with the number shifted left by "shift" (1~3) bits */
+static void ecc_load_words_shifted(const uint32_t input[], uint32_t volatile reg[], uint32_t shift)
+{
+    int32_t   i;
+    uint32_t  carry;
+
+    carry = 0UL;
+    for (i = 0; i < 18; i++)
     {
-        c = c - 'A' + (char)10;
+        reg[i] = (input[i] << shift) | carry;
+        carry = input[i] >> (32UL - shift);
     }
-    return (int)c;
 }
 
-static int ecc_strcmp(char *s1, char *s2)
+static void ecc_store_words(uint32_t volatile reg[], uint32_t output[])
 {
-    char  c1, c2;
+    int32_t  i, cnt;
 
-    while (*s1 == '0') s1++;
-    while (*s2 == '0') s2++;
+    /* keep the same Echar nibbles Reg2Hex() would */
+    cnt = (pCurve->Echar + 7) / 8;
+    for (i = 0; i < 18; i++)
+    {
+        output[i] = (i < cnt) ? reg[i] : 0UL;
+    }
+    if ((pCurve->Echar % 8) != 0)
+    {
+        output[cnt - 1] &= (1UL << ((uint32_t)(pCurve->Echar % 8) * 4UL)) - 1UL;
+    }
+}
 
-    for ( ; *s1 || *s2; s1++, s2++)
+static int  get_nibble_value(char c)
+{
+    if ((c >= '0') && (c <= '9'))
     {
-        if ((*s1 >= 'A') && (*s1 <= 'Z'))
-            c1 = *s1 + 32;
-        else
-            c1 = *s1;
+        c = c - '0';
+    }
 
-        if ((*s2 >= 'A') && (*s2 <= 'Z'))
-            c2 = *s2 + 32;
-        else
-            c2 = *s2;
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        c = c - 'a' + (char)10;
+    }
 
-        if (c1 != c2)
-            return 1;
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        c = c - 'A' + (char)10;
     }
-    return 0;
+    return (int)c;
 }
 
 volatile uint32_t g_ECC_done, g_ECCERR_done;
@@ -1137,10 +1479,13 @@ volatile uint32_t g_ECC_done, g_ECCERR_done;
   */
 void ECC_Complete(CRPT_T *crpt)
 {
+    int32_t  i32Status = CRPT_JOB_QUEUED;
+
     if (crpt->INTSTS & CRPT_INTSTS_ECCIF_Msk)
     {
         g_ECC_done = 1UL;
         crpt->INTSTS = CRPT_INTSTS_ECCIF_Msk;
+        i32Status = CRPT_JOB_DONE;
         /* printf("ECC done IRQ.\n"); */
     }
 
@@ -1148,8 +1493,14 @@ void ECC_Complete(CRPT_T *crpt)
     {
         g_ECCERR_done = 1UL;
         crpt->INTSTS = CRPT_INTSTS_ECCEIF_Msk;
+        i32Status = CRPT_JOB_FAILED;
         /* printf("ECCERRIF is set!!\n"); */
     }
+
+    if (i32Status != CRPT_JOB_QUEUED)
+    {
+        crpt_job_complete(CRPT_JOB_ECC, i32Status);
+    }
 }
 
 /**
@@ -1225,24 +1576,7 @@ int32_t  ECC_GeneratePublicKey(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *privat
         }
         Hex2Reg(private_k, crpt->ECC_K);
 
-        /* set FSEL (Field selection) */
-        if (pCurve->GF == (int)CURVE_GF_2M)
-        {
-            crpt->ECC_CTL = 0UL;
-        }
-        else
-        {
-            /*  CURVE_GF_P */
-            crpt->ECC_CTL = CRPT_ECC_CTL_FSEL_Msk;
-        }
-
-        g_ECC_done = g_ECCERR_done = 0UL;
-        crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) |
-                         ECCOP_POINT_MUL | CRPT_ECC_CTL_START_Msk;
-
-        while ((g_ECC_done | g_ECCERR_done) == 0UL)
-        {
-        }
+        run_ecc_codec(crpt, ECCOP_POINT_MUL);
 
         Reg2Hex(pCurve->Echar, crpt->ECC_X1, public_k1);
         Reg2Hex(pCurve->Echar, crpt->ECC_Y1, public_k2);
@@ -1252,20 +1586,22 @@ int32_t  ECC_GeneratePublicKey(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *privat
 }
 
 /**
-  * @brief  Given a private key and curve to generate the public key pair.
+  * @brief  ECC point multiplication (x2, y2) = k * (x1, y1).
   * @param[in]  crpt        Reference to Crypto module.
-  * @param[out] x1          The x-coordinate of input point.
-  * @param[out] y1          The y-coordinate of input point.
-  * @param[in]  k           The private key
   * @param[in]  ecc_curve   The pre-defined ECC curve.
+  * @param[in]  x1          The x-coordinate of input point.
+  * @param[in]  y1          The y-coordinate of input point.
+  * @param[in]  k           The scalar.
   * @param[out] x2          The x-coordinate of output point.
   * @param[out] y2          The y-coordinate of output point.
   * @return  0    Success.
   * @return  -1   "ecc_curve" value is invalid.
+  * @details  All numbers are arrays of ECC_KEY_WORD_MAX words, least significant word first.
   */
-int32_t  ECC_Mutiply(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char x1[], char y1[], char *k, char x2[], char y2[])
+int32_t  ECC_MultiplyWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t x1[], const uint32_t y1[],
+                           const uint32_t k[], uint32_t x2[], uint32_t y2[])
 {
-    int32_t  i, ret = 0;
+    int32_t  ret = 0;
 
     if (ecc_init_curve(crpt, ecc_curve) != 0)
     {
@@ -1274,44 +1610,52 @@ int32_t  ECC_Mutiply(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char x1[], char y1[],
 
     if (ret == 0)
     {
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_X1[i] = 0UL;
-            crpt->ECC_Y1[i] = 0UL;
-            crpt->ECC_K[i] = 0UL;
-        }
-        Hex2Reg(x1, crpt->ECC_X1);
-        Hex2Reg(y1, crpt->ECC_Y1);
-        Hex2Reg(k, crpt->ECC_K);
+        ecc_load_words(x1, crpt->ECC_X1);
+        ecc_load_words(y1, crpt->ECC_Y1);
+        ecc_load_words(k, crpt->ECC_K);
 
-        /* set FSEL (Field selection) */
-        if (pCurve->GF == (int)CURVE_GF_2M)
-        {
-            crpt->ECC_CTL = 0UL;
-        }
-        else
-        {
-            /*  CURVE_GF_P */
-            crpt->ECC_CTL = CRPT_ECC_CTL_FSEL_Msk;
-        }
+        run_ecc_codec(crpt, ECCOP_POINT_MUL);
 
-        g_ECC_done = g_ECCERR_done = 0UL;
-        crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) |
-                         ECCOP_POINT_MUL | CRPT_ECC_CTL_START_Msk;
+        ecc_store_words(crpt->ECC_X1, x2);
+        ecc_store_words(crpt->ECC_Y1, y2);
+    }
 
-        while ((g_ECC_done | g_ECCERR_done) == 0UL)
-        {
-        }
+    return ret;
+}
+
+/**
+  * @brief  Given a private key and curve to generate the public key pair.
+  * @param[in]  crpt        Reference to Crypto module.
+  * @param[out] x1          The x-coordinate of input point.
+  * @param[out] y1          The y-coordinate of input point.
+  * @param[in]  k           The private key
+  * @param[in]  ecc_curve   The pre-defined ECC curve.
+  * @param[out] x2          The x-coordinate of output point.
+  * @param[out] y2          The y-coordinate of output point.
+  * @return  0    Success.
+  * @return  -1   "ecc_curve" value is invalid.
+  */
+int32_t  ECC_Mutiply(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char x1[], char y1[], char *k, char x2[], char y2[])
+{
+    uint32_t  w_x[18], w_y[18], w_k[18];
+    int32_t   ret;
+
+    ecc_hex2words(x1, w_x);
+    ecc_hex2words(y1, w_y);
+    ecc_hex2words(k, w_k);
 
-        Reg2Hex(pCurve->Echar, crpt->ECC_X1, x2);
-        Reg2Hex(pCurve->Echar, crpt->ECC_Y1, y2);
+    ret = ECC_MultiplyWords(crpt, ecc_curve, w_x, w_y, w_k, w_x, w_y);
+    if (ret == 0)
+    {
+        Reg2Hex(pCurve->Echar, w_x, x2);
+        Reg2Hex(pCurve->Echar, w_y, y2);
     }
 
     return ret;
 }
 
 /**
-  * @brief  Given a curve parameter, the other party's public key, and one's own private key to generate the secret Z.
+  * @brief  Word array version of ECC_GenerateSecretZ().
   * @param[in]  crpt        Reference to Crypto module.
   * @param[in]  ecc_curve   The pre-defined ECC curve.
   * @param[in]  private_k   One's own private key.
@@ -1320,10 +1664,12 @@ int32_t  ECC_Mutiply(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char x1[], char y1[],
   * @param[out] secret_z    The ECC CDH secret Z.
   * @return  0    Success.
   * @return  -1   "ecc_curve" value is invalid.
+  * @details  All numbers are arrays of ECC_KEY_WORD_MAX words, least significant word first.
   */
-int32_t  ECC_GenerateSecretZ(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_k, char public_k1[], char public_k2[], char secret_z[])
+int32_t  ECC_GenerateSecretZWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t private_k[],
+                                  const uint32_t public_k1[], const uint32_t public_k2[], uint32_t secret_z[])
 {
-    int32_t  i, ret = 0;
+    int32_t  ret = 0;
 
     if (ecc_init_curve(crpt, ecc_curve) != 0)
     {
@@ -1332,50 +1678,57 @@ int32_t  ECC_GenerateSecretZ(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_
 
     if (ret == 0)
     {
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_K[i] = 0UL;
-            crpt->ECC_X1[i] = 0UL;
-            crpt->ECC_Y1[i] = 0UL;
-        }
-
+        /* Binary curves are multiplied by the cofactor, 2 for B-xxx and K-163, 4 for other K-xxx */
         if ((ecc_curve == CURVE_B_163) || (ecc_curve == CURVE_B_233) || (ecc_curve == CURVE_B_283) ||
                 (ecc_curve == CURVE_B_409) || (ecc_curve == CURVE_B_571) || (ecc_curve == CURVE_K_163))
         {
-            Hex2RegEx(private_k, crpt->ECC_K, 1);
+            ecc_load_words_shifted(private_k, crpt->ECC_K, 1UL);
         }
         else if ((ecc_curve == CURVE_K_233) || (ecc_curve == CURVE_K_283) ||
                  (ecc_curve == CURVE_K_409) || (ecc_curve == CURVE_K_571))
         {
-            Hex2RegEx(private_k, crpt->ECC_K, 2);
+            ecc_load_words_shifted(private_k, crpt->ECC_K, 2UL);
         }
         else
         {
-            Hex2Reg(private_k, crpt->ECC_K);
+            ecc_load_words(private_k, crpt->ECC_K);
         }
 
-        Hex2Reg(public_k1, crpt->ECC_X1);
-        Hex2Reg(public_k2, crpt->ECC_Y1);
+        ecc_load_words(public_k1, crpt->ECC_X1);
+        ecc_load_words(public_k2, crpt->ECC_Y1);
 
-        /* set FSEL (Field selection) */
-        if (pCurve->GF == (int)CURVE_GF_2M)
-        {
-            crpt->ECC_CTL = 0UL;
-        }
-        else
-        {
-            /*  CURVE_GF_P */
-            crpt->ECC_CTL = CRPT_ECC_CTL_FSEL_Msk;
-        }
-        g_ECC_done = g_ECCERR_done = 0UL;
-        crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) |
-                         ECCOP_POINT_MUL | CRPT_ECC_CTL_START_Msk;
+        run_ecc_codec(crpt, ECCOP_POINT_MUL);
 
-        while ((g_ECC_done | g_ECCERR_done) == 0UL)
-        {
-        }
+        ecc_store_words(crpt->ECC_X1, secret_z);
+    }
 
-        Reg2Hex(pCurve->Echar, crpt->ECC_X1, secret_z);
+    return ret;
+}
+
+/**
+  * @brief  Given a curve parameter, the other party's public key, and one's own private key to generate the secret Z.
+  * @param[in]  crpt        Reference to Crypto module.
+  * @param[in]  ecc_curve   The pre-defined ECC curve.
+  * @param[in]  private_k   One's own private key.
+  * @param[in]  public_k1   The other party's publick key 1.
+  * @param[in]  public_k2   The other party's publick key 2.
+  * @param[out] secret_z    The ECC CDH secret Z.
+  * @return  0    Success.
+  * @return  -1   "ecc_curve" value is invalid.
+  */
+int32_t  ECC_GenerateSecretZ(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_k, char public_k1[], char public_k2[], char secret_z[])
+{
+    uint32_t  w_k[18], w_x[18], w_y[18];
+    int32_t   ret;
+
+    ecc_hex2words(private_k, w_k);
+    ecc_hex2words(public_k1, w_x);
+    ecc_hex2words(public_k2, w_y);
+
+    ret = ECC_GenerateSecretZWords(crpt, ecc_curve, w_k, w_x, w_y, w_x);
+    if (ret == 0)
+    {
+        Reg2Hex(pCurve->Echar, w_x, secret_z);
     }
 
     return ret;
@@ -1385,29 +1738,38 @@ int32_t  ECC_GenerateSecretZ(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *private_
 
 static void run_ecc_codec(CRPT_T *crpt, uint32_t mode)
 {
+    CRPT_JOB_REG_T  start;
+    CRPT_JOB_T      job;
+    uint32_t        u32Ctl;
+
     if ((mode & CRPT_ECC_CTL_ECCOP_Msk) == ECCOP_MODULE)
     {
-        crpt->ECC_CTL = CRPT_ECC_CTL_FSEL_Msk;
+        u32Ctl = CRPT_ECC_CTL_FSEL_Msk;
     }
     else
     {
         if (pCurve->GF == (int)CURVE_GF_2M)
         {
             /* point */
-            crpt->ECC_CTL = 0UL;
+            u32Ctl = 0UL;
         }
         else
         {
             /* CURVE_GF_P */
-            crpt->ECC_CTL = CRPT_ECC_CTL_FSEL_Msk;
+            u32Ctl = CRPT_ECC_CTL_FSEL_Msk;
         }
     }
 
+    start.pu32Reg = &crpt->ECC_CTL;
+    start.u32Val = u32Ctl | ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) | mode | CRPT_ECC_CTL_START_Msk;
+
+    memset(&job, 0, sizeof(job));
+    job.u32Engine = CRPT_JOB_ECC;
+    job.pRegs = &start;
+    job.u32RegCnt = 1UL;
+
     g_ECC_done = g_ECCERR_done = 0UL;
-    crpt->ECC_CTL |= ((uint32_t)pCurve->key_len << CRPT_ECC_CTL_CURVEM_Pos) | mode | CRPT_ECC_CTL_START_Msk;
-    while ((g_ECC_done | g_ECCERR_done) == 0UL)
-    {
-    }
+    CRPT_JobRun(crpt, &job);
 
     while (crpt->ECC_STS & CRPT_ECC_STS_BUSY_Msk)
     {
@@ -1416,7 +1778,7 @@ static void run_ecc_codec(CRPT_T *crpt, uint32_t mode)
 /** @endcond HIDDEN_SYMBOLS */
 
 /**
-  * @brief  ECDSA digital signature generation.
+  * @brief  ECDSA digital signature generation on word arrays.
   * @param[in]  crpt        Reference to Crypto module.
   * @param[in]  ecc_curve   The pre-defined ECC curve.
   * @param[in]  message     The hash value of source context.
@@ -1426,9 +1788,10 @@ static void run_ecc_codec(CRPT_T *crpt, uint32_t mode)
   * @param[out] S           S of the (R,S) pair digital signature
   * @return  0    Success.
   * @return  -1   "ecc_curve" value is invalid.
+  * @details  All numbers are arrays of ECC_KEY_WORD_MAX words, least significant word first.
   */
-int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
-                               char *d, char *k, char *R, char *S)
+int32_t  ECC_GenerateSignatureWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t message[],
+                                    const uint32_t d[], const uint32_t k[], uint32_t R[], uint32_t S[])
 {
     uint32_t volatile temp_result1[18], temp_result2[18];
     int32_t  i, ret = 0;
@@ -1469,20 +1832,12 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
          */
 
         /* 3-(4) Write the random integer k to K register */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_K[i] = 0UL;
-        }
-        Hex2Reg(k, crpt->ECC_K);
+        ecc_load_words(k, crpt->ECC_K);
 
         run_ecc_codec(crpt, ECCOP_POINT_MUL);
 
         /*  3-(9) Write the curve order to N registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /* 3-(10) Write 0x0 to Y1 registers */
         for (i = 0; i < 18; i++)
@@ -1498,7 +1853,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
             temp_result1[i] = crpt->ECC_X1[i];
         }
 
-        Reg2Hex(pCurve->Echar, temp_result1, R);
+        ecc_store_words(temp_result1, R);
 
         /*
          *   4. Compute s = k ? 1  (e + d  r)(mod n). If s = 0, go to step 2
@@ -1534,11 +1889,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
         /* S/W: GFp_add_mod_order(pCurve->key_len+2, 0, x1, a, R); */
 
         /*  4-(1) Write the curve order to N registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /*  4-(2) Write 0x1 to Y1 registers */
         for (i = 0; i < 18; i++)
@@ -1548,11 +1899,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
         crpt->ECC_Y1[0] = 0x1UL;
 
         /*  4-(3) Write the random integer k to X1 registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_X1[i] = 0UL;
-        }
-        Hex2Reg(k, crpt->ECC_X1);
+        ecc_load_words(k, crpt->ECC_X1);
 
         run_ecc_codec(crpt, ECCOP_MODULE | MODOP_DIV);
 
@@ -1574,11 +1921,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
 #endif
 
         /*  4-(9) Write the curve order and curve length to N ,M registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /*  4-(10) Write r, d to X1, Y1 registers */
         for (i = 0; i < 18; i++)
@@ -1586,11 +1929,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
             crpt->ECC_X1[i] = temp_result1[i];
         }
 
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_Y1[i] = 0UL;
-        }
-        Hex2Reg(d, crpt->ECC_Y1);
+        ecc_load_words(d, crpt->ECC_Y1);
 
         run_ecc_codec(crpt, ECCOP_MODULE | MODOP_MUL);
 
@@ -1600,18 +1939,10 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
 #endif
 
         /*  4-(15) Write the curve order to N registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /*  4-(16) Write e to Y1 registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_Y1[i] = 0UL;
-        }
-        Hex2Reg(message, crpt->ECC_Y1);
+        ecc_load_words(message, crpt->ECC_Y1);
 
         run_ecc_codec(crpt, ECCOP_MODULE | MODOP_ADD);
 
@@ -1621,11 +1952,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
 #endif
 
         /*  4-(21) Write the curve order and curve length to N ,M registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /*  4-(22) Write k^-1 to Y1 registers */
         for (i = 0; i < 18; i++)
@@ -1641,7 +1968,7 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
             temp_result2[i] = crpt->ECC_X1[i];
         }
 
-        Reg2Hex(pCurve->Echar, temp_result2, S);
+        ecc_store_words(temp_result2, S);
 
     }  /* ret == 0 */
 
@@ -1649,7 +1976,39 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
 }
 
 /**
-  * @brief  ECDSA dogotal signature verification.
+  * @brief  ECDSA digital signature generation.
+  * @param[in]  crpt        Reference to Crypto module.
+  * @param[in]  ecc_curve   The pre-defined ECC curve.
+  * @param[in]  message     The hash value of source context.
+  * @param[in]  d           The private key.
+  * @param[in]  k           The selected random integer.
+  * @param[out] R           R of the (R,S) pair digital signature
+  * @param[out] S           S of the (R,S) pair digital signature
+  * @return  0    Success.
+  * @return  -1   "ecc_curve" value is invalid.
+  */
+int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
+                               char *d, char *k, char *R, char *S)
+{
+    uint32_t  w_e[18], w_d[18], w_k[18], w_r[18], w_s[18];
+    int32_t   ret;
+
+    ecc_hex2words(message, w_e);
+    ecc_hex2words(d, w_d);
+    ecc_hex2words(k, w_k);
+
+    ret = ECC_GenerateSignatureWords(crpt, ecc_curve, w_e, w_d, w_k, w_r, w_s);
+    if (ret == 0)
+    {
+        Reg2Hex(pCurve->Echar, w_r, R);
+        Reg2Hex(pCurve->Echar, w_s, S);
+    }
+
+    return ret;
+}
+
+/**
+  * @brief  ECDSA digital signature verification on word arrays.
   * @param[in]  crpt        Reference to Crypto module.
   * @param[in]  ecc_curve   The pre-defined ECC curve.
   * @param[in]  message     The hash value of source context.
@@ -1660,9 +2019,11 @@ int32_t  ECC_GenerateSignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *messag
   * @return  0    Success.
   * @return  -1   "ecc_curve" value is invalid.
   * @return  -2   Verification failed.
+  * @details  All numbers are arrays of ECC_KEY_WORD_MAX words, least significant word first.
   */
-int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
-                             char *public_k1, char *public_k2, char *R, char *S)
+int32_t  ECC_VerifySignatureWords(CRPT_T *crpt, E_ECC_CURVE ecc_curve, const uint32_t message[],
+                                  const uint32_t public_k1[], const uint32_t public_k2[],
+                                  const uint32_t R[], const uint32_t S[])
 {
     uint32_t  temp_result1[18], temp_result2[18];
     uint32_t  temp_x[18], temp_y[18];
@@ -1695,11 +2056,7 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
     if (ret == 0)
     {
         /*  3-(1) Write the curve order to N registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /*  3-(2) Write 0x1 to Y1 registers */
         for (i = 0; i < 18; i++)
@@ -1709,11 +2066,7 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
         crpt->ECC_Y1[0] = 0x1UL;
 
         /*  3-(3) Write s to X1 registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_X1[i] = 0UL;
-        }
-        Hex2Reg(S, crpt->ECC_X1);
+        ecc_load_words(S, crpt->ECC_X1);
 
         run_ecc_codec(crpt, ECCOP_MODULE | MODOP_DIV);
 
@@ -1724,7 +2077,8 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
         }
 
 #if ENABLE_DEBUG
-        CRPT_DBGMSG("e = %s\n", message);
+        Reg2Hex(pCurve->Echar, (uint32_t *)message, temp_hex_str);
+        CRPT_DBGMSG("e = %s\n", temp_hex_str);
         Reg2Hex(pCurve->Echar, temp_result2, temp_hex_str);
         CRPT_DBGMSG("w = %s\n", temp_hex_str);
         CRPT_DBGMSG("o = %s (order)\n", pCurve->Eorder);
@@ -1749,18 +2103,10 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
          */
 
         /*  4-(1) Write the curve order and curve length to N ,M registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /* 4-(2) Write e, w to X1, Y1 registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_X1[i] = 0UL;
-        }
-        Hex2Reg(message, crpt->ECC_X1);
+        ecc_load_words(message, crpt->ECC_X1);
 
         for (i = 0; i < 18; i++)
         {
@@ -1781,18 +2127,10 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
 #endif
 
         /*  4-(8) Write the curve order and curve length to N ,M registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /* 4-(9) Write r, w to X1, Y1 registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_X1[i] = 0UL;
-        }
-        Hex2Reg(R, crpt->ECC_X1);
+        ecc_load_words(R, crpt->ECC_X1);
 
         for (i = 0; i < 18; i++)
         {
@@ -1877,14 +2215,8 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
         ecc_init_curve(crpt, ecc_curve);
 
         /* (9) Write the public key Q(x,y) to X1, Y1 registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_X1[i] = 0UL;
-            crpt->ECC_Y1[i] = 0UL;
-        }
-
-        Hex2Reg(public_k1, crpt->ECC_X1);
-        Hex2Reg(public_k2, crpt->ECC_Y1);
+        ecc_load_words(public_k1, crpt->ECC_X1);
+        ecc_load_words(public_k2, crpt->ECC_Y1);
 
         /* (10) Write u2 to K registers */
         for (i = 0; i < 18; i++)
@@ -1941,11 +2273,7 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
 #endif
 
         /*  (20) Write the curve order and curve length to N ,M registers */
-        for (i = 0; i < 18; i++)
-        {
-            crpt->ECC_N[i] = 0UL;
-        }
-        Hex2Reg(pCurve->Eorder, crpt->ECC_N);
+        ecc_load_order(crpt);
 
         /*
          *  (21) Write x1 to X1 registers
@@ -1966,24 +2294,56 @@ int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
 
         run_ecc_codec(crpt, ECCOP_MODULE | MODOP_ADD);
 
-        /*  (27) Read X1 registers to get x1 (mod n) */
-        Reg2Hex(pCurve->Echar, crpt->ECC_X1, temp_hex_str);
-        CRPT_DBGMSG("5-(27) x1' (mod n) = %s\n", temp_hex_str);
+        /*  (27) Read X1 registers to get x1' (mod n) */
+        ecc_store_words(crpt->ECC_X1, temp_x);
 
-        /* 6. The signature is valid if x1 = r, otherwise it is invalid */
+#if ENABLE_DEBUG
+        Reg2Hex(pCurve->Echar, temp_x, temp_hex_str);
+        CRPT_DBGMSG("5-(27) x1' (mod n) = %s\n", temp_hex_str);
+#endif
 
-        /* Compare with test pattern to check if r is correct or not */
-        if (ecc_strcmp(temp_hex_str, R) != 0)
+        /* 6. The signature is valid if x1' = r, otherwise it is invalid */
+        for (i = 0; i < 18; i++)
         {
-            CRPT_DBGMSG("x1' (mod n) != R Test filed!!\n");
-            CRPT_DBGMSG("Signature R [%s] is not matched with expected R [%s]!\n", temp_hex_str, R);
-            ret = -2;
+            if (temp_x[i] != R[i])
+            {
+                CRPT_DBGMSG("x1' (mod n) != R Test filed!!\n");
+                ret = -2;
+                break;
+            }
         }
     }  /* ret == 0 */
 
     return ret;
 }
 
+/**
+  * @brief  ECDSA dogotal signature verification.
+  * @param[in]  crpt        Reference to Crypto module.
+  * @param[in]  ecc_curve   The pre-defined ECC curve.
+  * @param[in]  message     The hash value of source context.
+  * @param[in]  public_k1   The public key 1.
+  * @param[in]  public_k2   The public key 2.
+  * @param[in]  R           R of the (R,S) pair digital signature
+  * @param[in]  S           S of the (R,S) pair digital signature
+  * @return  0    Success.
+  * @return  -1   "ecc_curve" value is invalid.
+  * @return  -2   Verification failed.
+  */
+int32_t  ECC_VerifySignature(CRPT_T *crpt, E_ECC_CURVE ecc_curve, char *message,
+                             char *public_k1, char *public_k2, char *R, char *S)
+{
+    uint32_t  w_e[18], w_x[18], w_y[18], w_r[18], w_s[18];
+
+    ecc_hex2words(message, w_e);
+    ecc_hex2words(public_k1, w_x);
+    ecc_hex2words(public_k2, w_y);
+    ecc_hex2words(R, w_r);
+    ecc_hex2words(S, w_s);
+
+    return ECC_VerifySignatureWords(crpt, ecc_curve, w_e, w_x, w_y, w_r, w_s);
+}
+
 /*@}*/ /* end of group CRYPTO_EXPORTED_FUNCTIONS */
 
 /*@}*/ /* end of group CRYPTO_Driver */
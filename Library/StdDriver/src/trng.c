@@ -20,6 +20,56 @@
 */
 
 
+/** @cond HIDDEN_SYMBOLS */
+
+/*
+ *  Entropy pool. A single producer ring: bytes are put by the TRNG interrupt
+ *  or by TRNG_PoolHarvest() inside a PRIMASK critical section, and taken by
+ *  TRNG_PoolRead(). Head and tail are free running, so the fill level is
+ *  their difference.
+ */
+static volatile uint8_t s_au8TrngPool[TRNG_POOL_SIZE];
+static volatile uint32_t s_u32TrngPoolHead;
+static volatile uint32_t s_u32TrngPoolTail;
+static volatile uint32_t s_u32TrngPoolPaused;
+
+static volatile uint32_t s_u32TrngHarvested;
+static volatile uint32_t s_u32TrngStalls;
+static volatile uint32_t s_u32TrngPauses;
+
+/*
+ *  Move the byte the TRNG holds into the pool. Called with DVIF set and
+ *  interrupts masked. When the pool is full, the byte is left in the TRNG and
+ *  the data valid interrupt is turned off until TRNG_PoolRead() makes room.
+ *  Returns 1 if a byte was stored.
+ */
+static uint32_t TRNG_PoolPut(void)
+{
+    uint32_t u32Head = s_u32TrngPoolHead;
+
+    if ((u32Head - s_u32TrngPoolTail) >= TRNG_POOL_SIZE)
+    {
+        TRNG->CTL &= ~TRNG_CTL_DVIEN_Msk;
+        if (s_u32TrngPoolPaused == 0UL)
+        {
+            s_u32TrngPoolPaused = 1UL;
+            s_u32TrngPauses++;
+        }
+        return 0UL;
+    }
+
+    s_au8TrngPool[u32Head & (TRNG_POOL_SIZE - 1UL)] = (uint8_t)(TRNG->DATA & 0xffUL);
+    s_u32TrngPoolHead = u32Head + 1UL;
+    s_u32TrngHarvested++;
+
+    /* Start the next byte */
+    TRNG->CTL = (TRNG->CTL & ~TRNG_CTL_DVIF_Msk) | TRNG_CTL_TRNGEN_Msk;
+    return 1UL;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+
 /** @addtogroup TRNG_EXPORTED_FUNCTIONS TRNG Exported Functions
   @{
 */
@@ -160,6 +210,194 @@ int32_t TRNG_GenBignumHex(char cBigNumHex[], int32_t i32Len)
 }
 
 
+/**
+  * @brief   Initialize TRNG hardware and start filling the entropy pool in the background.
+  *
+  * @return  None
+  *
+  * @details The pool is emptied and the TRNG data valid interrupt is enabled. Each interrupt
+  *          moves one byte into the pool from TRNG_PoolIRQHandler(), which the application
+  *          calls from TRNG_IRQHandler() after NVIC_EnableIRQ(TRNG_IRQn). Without the interrupt,
+  *          call TRNG_PoolHarvest() from an idle loop instead.
+  * @note    Like TRNG_Open(), this function writes protected registers. Please make sure that
+  *          the registers are unlocked before calling it.
+  */
+void TRNG_PoolOpen(void)
+{
+    uint32_t u32PriMask;
+
+    TRNG_Open();
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    s_u32TrngPoolHead = 0UL;
+    s_u32TrngPoolTail = 0UL;
+    s_u32TrngPoolPaused = 0UL;
+    s_u32TrngHarvested = 0UL;
+    s_u32TrngStalls = 0UL;
+    s_u32TrngPauses = 0UL;
+
+    /* Start the first byte */
+    TRNG->CTL = (TRNG->CTL & ~TRNG_CTL_DVIF_Msk) | TRNG_CTL_TRNGEN_Msk | TRNG_CTL_DVIEN_Msk;
+
+    __set_PRIMASK(u32PriMask);
+}
+
+/**
+  * @brief   TRNG interrupt service of the entropy pool.
+  *
+  * @return  None
+  *
+  * @details Call this function from TRNG_IRQHandler(). It moves the byte the TRNG holds into
+  *          the pool and starts the next one. When the pool is full, the data valid interrupt
+  *          is disabled until TRNG_PoolRead() takes bytes out of the pool.
+  */
+void TRNG_PoolIRQHandler(void)
+{
+    /* TRNG_PoolHarvest() may have taken the byte already */
+    if (TRNG->CTL & TRNG_CTL_DVIF_Msk)
+    {
+        (void)TRNG_PoolPut();
+    }
+}
+
+/**
+  * @brief   Poll the TRNG once and move a ready byte into the entropy pool.
+  *
+  * @return  Number of bytes moved into the pool, 0 or 1.
+  *
+  * @details For systems that do not enable TRNG_IRQn, call this function from an idle hook.
+  *          It never waits for the TRNG.
+  */
+uint32_t TRNG_PoolHarvest(void)
+{
+    uint32_t u32PriMask, u32Put = 0UL;
+
+    u32PriMask = __get_PRIMASK();
+    __disable_irq();
+
+    if (TRNG->CTL & TRNG_CTL_DVIF_Msk)
+    {
+        u32Put = TRNG_PoolPut();
+    }
+
+    __set_PRIMASK(u32PriMask);
+    return u32Put;
+}
+
+/**
+  * @brief   Take random bytes out of the entropy pool.
+  * @param[out]  au8Buf    The output buffer.
+  * @param[in]   u32Len    Number of bytes wanted.
+  *
+  * @return  Number of bytes copied to au8Buf. It is less than u32Len if the pool holds less.
+  *
+  * @details This function never waits for the TRNG. If the pool was full, it resumes harvesting.
+  */
+uint32_t TRNG_PoolRead(uint8_t au8Buf[], uint32_t u32Len)
+{
+    uint32_t i, u32Tail, u32Level, u32PriMask;
+
+    u32Tail = s_u32TrngPoolTail;
+    u32Level = s_u32TrngPoolHead - u32Tail;
+    if (u32Len > u32Level)
+    {
+        u32Len = u32Level;
+    }
+
+    for (i = 0UL; i < u32Len; i++)
+    {
+        au8Buf[i] = s_au8TrngPool[(u32Tail + i) & (TRNG_POOL_SIZE - 1UL)];
+        s_au8TrngPool[(u32Tail + i) & (TRNG_POOL_SIZE - 1UL)] = 0U;
+    }
+    s_u32TrngPoolTail = u32Tail + u32Len;
+
+    if ((u32Len > 0UL) && s_u32TrngPoolPaused)
+    {
+        u32PriMask = __get_PRIMASK();
+        __disable_irq();
+        s_u32TrngPoolPaused = 0UL;
+        /* The byte held back while paused raises the interrupt right away */
+        TRNG->CTL |= TRNG_CTL_DVIEN_Msk;
+        __set_PRIMASK(u32PriMask);
+    }
+    return u32Len;
+}
+
+/**
+  * @brief   Take random bytes out of the entropy pool, waiting for the TRNG if the pool runs short.
+  * @param[out]  au8Buf    The output buffer.
+  * @param[in]   u32Len    Number of bytes wanted.
+  *
+  * @return  Success or time-out.
+  * @retval  0   Success
+  * @retval  -1  Time-out. TRNG hardware may not be enabled.
+  *
+  * @details While waiting, the TRNG is polled with TRNG_PoolHarvest(), so this function also
+  *          works with TRNG_IRQn disabled. Each call that has to wait counts as one stall in
+  *          TRNG_PoolGetStat().
+  */
+int32_t TRNG_PoolReadWait(uint8_t au8Buf[], uint32_t u32Len)
+{
+    uint32_t u32Done, u32Got, timeout;
+    uint32_t u32Stalled = 0UL;
+
+    u32Done = 0UL;
+    /* TRNG should generate one byte per 125*8 us */
+    timeout = CLK_GetHCLKFreq() / 100UL;
+
+    while (u32Done < u32Len)
+    {
+        u32Got = TRNG_PoolRead(&au8Buf[u32Done], u32Len - u32Done);
+        if (u32Got > 0UL)
+        {
+            u32Done += u32Got;
+            timeout = CLK_GetHCLKFreq() / 100UL;
+            continue;
+        }
+
+        if (u32Stalled == 0UL)
+        {
+            u32Stalled = 1UL;
+            s_u32TrngStalls++;
+        }
+
+        (void)TRNG_PoolHarvest();
+
+        if (--timeout == 0UL)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+  * @brief   Get the fill level and the harvest counters of the entropy pool.
+  * @param[out]  psStat    The counters, see TRNG_POOL_STAT_T.
+  *
+  * @return  None
+  *
+  * @details Counters run from TRNG_PoolOpen(). u32Harvested over time is the harvest rate;
+  *          u32Stalls tells how often a reader had to wait on the TRNG.
+  */
+void TRNG_PoolGetStat(TRNG_POOL_STAT_T *psStat)
+{
+    uint32_t u32Head, u32Tail;
+
+    u32Head = s_u32TrngPoolHead;
+    u32Tail = s_u32TrngPoolTail;
+
+    psStat->u32Level = u32Head - u32Tail;
+    psStat->u32Size = TRNG_POOL_SIZE;
+    psStat->u32Harvested = s_u32TrngHarvested;
+    psStat->u32Consumed = u32Tail;
+    psStat->u32Stalls = s_u32TrngStalls;
+    psStat->u32Pauses = s_u32TrngPauses;
+}
+
+
 /*@}*/ /* end of group TRNG_EXPORTED_FUNCTIONS */
 
 /*@}*/ /* end of group TRNG_Driver */
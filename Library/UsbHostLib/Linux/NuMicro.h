@@ -0,0 +1,145 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @version  V1.00
+ * @brief    Host stand-in of the M480 device header for the Linux build of
+ *           the USB Host library tests. It provides the register types the
+ *           library headers refer to, the CMSIS intrinsics the library uses
+ *           and the peripherals the host controller drivers access, which
+ *           usbh_sim.c models.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+#include "sys_reg.h"
+#include "usbh_reg.h"
+#include "hsusbh_reg.h"
+
+typedef enum
+{
+    USBH_IRQn                     = 54,       /*!< USB host Interrupt                               */
+    HSUSBH_IRQn                   = 92        /*!< High speed USB host Interrupt                    */
+} IRQn_Type;
+
+/*
+ *  The OHCI and EHCI registers and the NVIC functions are provided by usbh_sim.c, only the
+ *  tests that run the host controller drivers link it. SYS->CSERVER reads 0, an M480MD,
+ *  which has both host controllers.
+ */
+extern USBH_T    __host_usbh;
+extern HSUSBH_T  __host_hsusbh;
+__attribute__((weak)) SYS_T  __host_sys;
+
+#define SYS                  (&__host_sys)
+#define USBH                 (&__host_usbh)
+#define HSUSBH               (&__host_hsusbh)
+
+extern void NVIC_EnableIRQ(IRQn_Type IRQn);
+extern void NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/*
+ *  Single threaded. A test that simulates interrupts runs its interrupt handler only while
+ *  __host_primask is 0, as __disable_irq() would mask it. usbh_sim.c provides
+ *  __host_irq_unmask(), which runs the interrupts that became pending while masked.
+ */
+__attribute__((weak)) volatile uint32_t  __host_primask;
+extern void __host_irq_unmask(void) __attribute__((weak));
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return __host_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t priMask)
+{
+    __host_primask = priMask;
+    if ((priMask == 0UL) && __host_irq_unmask)
+        __host_irq_unmask();
+}
+
+static inline void __disable_irq(void)
+{
+    __host_primask = 1UL;
+}
+
+static inline void __enable_irq(void)
+{
+    __host_primask = 0UL;
+    if (__host_irq_unmask)
+        __host_irq_unmask();
+}
+
+/*
+ *  DWT cycle counter, the default timer of the transfer trace. A test sets DWT->CYCCNT.
+ */
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+__attribute__((weak)) DWT_Type        __host_dwt;
+__attribute__((weak)) CoreDebug_Type  __host_core_debug;
+__attribute__((weak)) uint32_t        SystemCoreClock = 192000000UL;
+
+#define DWT                         (&__host_dwt)
+#define CoreDebug                   (&__host_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+/* Exclusive access always succeeds, nothing can come in between on the host. */
+static inline uint32_t __LDREXW(volatile uint32_t *addr)
+{
+    return *addr;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+    *addr = value;
+    return 0UL;
+}
+
+static inline void __CLREX(void)
+{
+}
+
+static inline void __DMB(void)
+{
+    __sync_synchronize();
+}
+
+static inline uint32_t __CLZ(uint32_t value)
+{
+    return (value == 0UL) ? 32UL : (uint32_t)__builtin_clz(value);
+}
+
+static inline uint32_t __RBIT(uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555UL) | ((value & 0x55555555UL) << 1);
+    value = ((value >> 2) & 0x33333333UL) | ((value & 0x33333333UL) << 2);
+    value = ((value >> 4) & 0x0F0F0F0FUL) | ((value & 0x0F0F0F0FUL) << 4);
+    return __builtin_bswap32(value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,375 @@
+/**************************************************************************//**
+ * @file     cache_bench.c
+ * @version  V1.00
+ * @brief    Host benchmark of the mass storage sector cache of msc_cache.c.
+ *
+ *           FatFs runs the same workload on two simulated disk images: drive 0
+ *           through usbh_umas_read()/usbh_umas_write() with the sector cache,
+ *           drive 1 with one command per disk_read()/disk_write() as before.
+ *           The READ(10)/WRITE(10) commands of each are counted, and the two
+ *           images must be identical at the end.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "msc.h"
+
+#define DISK_SECT           65536       /* 32 MB FAT16 volume                         */
+#define FAT_SECT            64
+#define ROOT_ENTRIES        512
+#define CLUSTER_SECT        4
+
+#define BIG_FILE_SIZE       (4 * 1024 * 1024)
+#define SMALL_FILE_NUM      64
+#define SMALL_FILE_SIZE     3000
+
+static uint8_t  *_image[2];
+
+typedef struct
+{
+    uint32_t  read_cmds, write_cmds;
+} DISK_CNT_T;
+
+static DISK_CNT_T  _cnt[2];
+
+
+/*--------------------------------------------------------------------------*/
+/*   Simulated device of drive 0, under msc_cache.c                          */
+/*--------------------------------------------------------------------------*/
+static UMAS_REQ_T  *_async_head;
+
+void usbh_umas_poll(void)
+{
+    UMAS_REQ_T  *req;
+
+    /* the device runs the queued commands in order */
+    while (_async_head != NULL)
+    {
+        req = _async_head;
+        _async_head = req->next;
+        _cnt[0].read_cmds++;
+        memcpy(req->buff, _image[0] + req->sec_no * 512, req->sec_cnt * 512);
+        req->status = 0;
+        req->bIsDone = 1;
+        if (req->func)
+            req->func(req);
+    }
+}
+
+int  usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff,
+                          UMAS_REQ_T *req, UMAS_DONE_FUNC *func, void *context)
+{
+    UMAS_REQ_T  **p;
+
+    if ((drv_no != 0) || (sec_no + sec_cnt > DISK_SECT))
+        return UMAS_ERR_IVALID_PARM;
+    req->drv_no = drv_no;
+    req->sec_no = sec_no;
+    req->sec_cnt = sec_cnt;
+    req->buff = buff;
+    req->func = func;
+    req->context = context;
+    req->bIsDone = 0;
+    req->next = NULL;
+    for (p = &_async_head; *p != NULL; p = &(*p)->next)
+        ;
+    *p = req;
+    return 0;
+}
+
+int  umas_dev_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    usbh_umas_poll();
+    if ((drv_no != 0) || (sec_no + sec_cnt > DISK_SECT))
+        return UMAS_ERR_IO;
+    _cnt[0].read_cmds++;
+    memcpy(buff, _image[0] + sec_no * 512, sec_cnt * 512);
+    return 0;
+}
+
+int  umas_dev_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    usbh_umas_poll();
+    if ((drv_no != 0) || (sec_no + sec_cnt > DISK_SECT))
+        return UMAS_ERR_IO;
+    _cnt[0].write_cmds++;
+    memcpy(_image[0] + sec_no * 512, buff, sec_cnt * 512);
+    return 0;
+}
+
+int  usbh_umas_ioctl(int drv_no, int cmd, void *buff)
+{
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return (umas_cache_flush(drv_no) < 0) ? RES_ERROR : RES_OK;
+    case GET_SECTOR_COUNT:
+        *(uint32_t *)buff = DISK_SECT;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+    case GET_BLOCK_SIZE:
+        *(uint32_t *)buff = 512;
+        return RES_OK;
+    }
+    return UMAS_ERR_IVALID_PARM;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   FatFs disk I/O: drive 0 cached, drive 1 one command per call            */
+/*--------------------------------------------------------------------------*/
+DSTATUS disk_status(BYTE pdrv)
+{
+    return (pdrv < 2) ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return disk_status(pdrv);
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    if (pdrv == 0)
+        return umas_cache_read(0, sector, count, buff) ? RES_ERROR : RES_OK;
+
+    _cnt[1].read_cmds++;
+    memcpy(buff, _image[1] + sector * 512, count * 512);
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    if (pdrv == 0)
+        return umas_cache_write(0, sector, count, (uint8_t *)buff) ? RES_ERROR : RES_OK;
+
+    _cnt[1].write_cmds++;
+    memcpy(_image[1] + sector * 512, buff, count * 512);
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    if (pdrv == 0)
+        return usbh_umas_ioctl(0, cmd, buff) ? RES_ERROR : RES_OK;
+    if (cmd == GET_SECTOR_COUNT)
+        *(DWORD *)buff = DISK_SECT;
+    return RES_OK;
+}
+
+DWORD get_fattime(void)
+{
+    return ((DWORD)(2019 - 1980) << 25) | (1UL << 21) | (1UL << 16);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Workload                                                               */
+/*--------------------------------------------------------------------------*/
+static void format_fat16(uint8_t *img)
+{
+    uint8_t  *bs = img;
+    int      i;
+
+    memset(img, 0, DISK_SECT * 512);
+    memcpy(bs, "\xEB\x3C\x90" "NUVOTON ", 11);
+    bs[11] = 0x00;                          /* 512 bytes per sector                       */
+    bs[12] = 0x02;
+    bs[13] = CLUSTER_SECT;
+    bs[14] = 1;                             /* reserved sectors                           */
+    bs[16] = 2;                             /* number of FATs                             */
+    bs[17] = ROOT_ENTRIES & 0xFF;
+    bs[18] = ROOT_ENTRIES >> 8;
+    bs[21] = 0xF8;                          /* media                                      */
+    bs[22] = FAT_SECT;
+    bs[24] = 63;
+    bs[26] = 255;
+    bs[32] = DISK_SECT & 0xFF;              /* total sectors (32-bit)                     */
+    bs[33] = (DISK_SECT >> 8) & 0xFF;
+    bs[34] = (DISK_SECT >> 16) & 0xFF;
+    bs[35] = (DISK_SECT >> 24) & 0xFF;
+    bs[36] = 0x80;
+    bs[38] = 0x29;
+    memcpy(bs + 43, "NO NAME    FAT16   ", 19);
+    bs[510] = 0x55;
+    bs[511] = 0xAA;
+
+    for (i = 0; i < 2; i++)
+        memcpy(img + (1 + i * FAT_SECT) * 512, "\xF8\xFF\xFF\xFF", 4);
+}
+
+static uint8_t pattern(uint32_t pos, int file)
+{
+    return (uint8_t)((pos * 7) ^ (pos >> 9) ^ file);
+}
+
+static int write_file(const char *path, uint32_t size, UINT chunk, int file)
+{
+    static uint8_t  buff[4096];
+    FIL      fil;
+    uint32_t pos, i;
+    UINT     n, bw;
+
+    if (f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+        return -1;
+    for (pos = 0; pos < size; pos += n)
+    {
+        n = (size - pos < chunk) ? (size - pos) : chunk;
+        for (i = 0; i < n; i++)
+            buff[i] = pattern(pos + i, file);
+        if ((f_write(&fil, buff, n, &bw) != FR_OK) || (bw != n))
+            return -1;
+    }
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+static int read_file(const char *path, uint32_t size, UINT chunk, int file)
+{
+    static uint8_t  buff[4096];
+    FIL      fil;
+    uint32_t pos, i;
+    UINT     n, br;
+
+    if (f_open(&fil, path, FA_READ) != FR_OK)
+        return -1;
+    for (pos = 0; pos < size; pos += n)
+    {
+        n = (size - pos < chunk) ? (size - pos) : chunk;
+        if ((f_read(&fil, buff, n, &br) != FR_OK) || (br != n))
+            return -1;
+        for (i = 0; i < n; i++)
+        {
+            if (buff[i] != pattern(pos + i, file))
+                return -1;
+        }
+    }
+    return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+/* Returns the bytes of file data moved, or -1 */
+static long workload(int drv)
+{
+    static FATFS  fs;
+    DIR      dir;
+    FILINFO  fno;
+    char     path[32];
+    long     bytes = 0;
+    int      i, n;
+
+    sprintf(path, "%d:", drv);
+    if (f_mount(&fs, path, 1) != FR_OK)
+        return -1;
+
+    /* a big file, written and read back 512 bytes at a time, then read in 4 KB */
+    sprintf(path, "%d:/BIG.BIN", drv);
+    if ((write_file(path, BIG_FILE_SIZE, 512, 0) < 0) ||
+            (read_file(path, BIG_FILE_SIZE, 512, 0) < 0) ||
+            (read_file(path, BIG_FILE_SIZE, 4096, 0) < 0))
+        return -1;
+    bytes += 3L * BIG_FILE_SIZE;
+
+    /* small files in a directory, written 100 bytes at a time and read back */
+    sprintf(path, "%d:/LOG", drv);
+    if (f_mkdir(path) != FR_OK)
+        return -1;
+    for (i = 0; i < SMALL_FILE_NUM; i++)
+    {
+        sprintf(path, "%d:/LOG/F%04d.TXT", drv, i);
+        if (write_file(path, SMALL_FILE_SIZE, 100, i + 1) < 0)
+            return -1;
+    }
+    for (i = 0; i < SMALL_FILE_NUM; i++)
+    {
+        sprintf(path, "%d:/LOG/F%04d.TXT", drv, i);
+        if (read_file(path, SMALL_FILE_SIZE, 512, i + 1) < 0)
+            return -1;
+    }
+    bytes += 2L * SMALL_FILE_NUM * SMALL_FILE_SIZE;
+
+    /* list the directory, then remove every other file */
+    sprintf(path, "%d:/LOG", drv);
+    if (f_opendir(&dir, path) != FR_OK)
+        return -1;
+    for (n = 0; (f_readdir(&dir, &fno) == FR_OK) && (fno.fname[0] != 0); n++)
+        ;
+    f_closedir(&dir);
+    if (n != SMALL_FILE_NUM)
+        return -1;
+    for (i = 0; i < SMALL_FILE_NUM; i += 2)
+    {
+        sprintf(path, "%d:/LOG/F%04d.TXT", drv, i);
+        if (f_unlink(path) != FR_OK)
+            return -1;
+    }
+
+    /* f_unlink() does not sync, an application would f_sync() or close a file */
+    if (disk_ioctl(drv, CTRL_SYNC, NULL) != RES_OK)
+        return -1;
+    sprintf(path, "%d:", drv);
+    f_mount(NULL, path, 0);
+    return bytes;
+}
+
+static void report(const char *name, DISK_CNT_T *cnt, long bytes)
+{
+    double  mb = (double)bytes / (1024 * 1024);
+
+    printf("%-9s %10u %10u %10.1f\n", name, (unsigned)cnt->read_cmds, (unsigned)cnt->write_cmds,
+           (cnt->read_cmds + cnt->write_cmds) / mb);
+}
+
+int main(void)
+{
+    UMAS_CACHE_STAT_T  stat;
+    long   bytes[2];
+    int    i, ret = 0;
+
+    for (i = 0; i < 2; i++)
+    {
+        _image[i] = malloc(DISK_SECT * 512);
+        if (_image[i] == NULL)
+            return 1;
+        format_fat16(_image[i]);
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        bytes[i] = workload(i);
+        if (bytes[i] < 0)
+        {
+            printf("drive %d: workload failed\n", i);
+            return 1;
+        }
+    }
+
+    usbh_umas_cache_stat(&stat);
+    printf("%d lines of %d sectors, read-ahead %d. %.1f MB of file data moved.\n\n",
+           UMAS_CACHE_LINES, UMAS_CACHE_LINE_SECT, UMAS_CACHE_READ_AHEAD,
+           (double)bytes[0] / (1024 * 1024));
+    printf("%-9s %10s %10s %10s\n", "", "READ(10)", "WRITE(10)", "cmds/MB");
+    report("uncached", &_cnt[1], bytes[1]);
+    report("cached", &_cnt[0], bytes[0]);
+    printf("\nsectors read %u, cache hits %u (%.1f%%), from read-ahead %u, read-ahead commands %u\n",
+           (unsigned)stat.read_sect, (unsigned)stat.read_hit,
+           stat.read_sect ? 100.0 * stat.read_hit / stat.read_sect : 0.0,
+           (unsigned)stat.ra_hit, (unsigned)stat.ra_cmds);
+    printf("sectors written %u\n", (unsigned)stat.write_sect);
+
+    if ((stat.read_cmds != _cnt[0].read_cmds) || (stat.write_cmds != _cnt[0].write_cmds))
+    {
+        printf("usbh_umas_cache_stat commands do not match the device\n");
+        ret = 1;
+    }
+    if (memcmp(_image[0], _image[1], DISK_SECT * 512) != 0)
+    {
+        printf("disk images differ\n");
+        ret = 1;
+    }
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
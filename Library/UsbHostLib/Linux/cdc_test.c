@@ -0,0 +1,447 @@
+/**************************************************************************//**
+ * @file     cdc_test.c
+ * @version  V1.00
+ * @brief    Host test of the ring mode bulk transfers of cdc_ring.c on a
+ *           simulated USB to UART bridge.
+ *
+ *           Time runs in 125 us steps. The full speed bridge moves its UART
+ *           data at 3 Mbaud through 256-byte FIFOs, and the application
+ *           main loop runs once per millisecond. The test compares the
+ *           single transfer of usbh_cdc_start_to_receive_data(), restarted
+ *           from the main loop, against ring mode, checks that ring mode
+ *           holds the bridge off without losing data when the application
+ *           stops reading, and that the send ring delivers the stream
+ *           intact without blocking the main loop.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_cdc.h"
+
+#define EP_MPS              64
+#define BUS_BYTES           152                     /* full speed bulk bytes per step    */
+#define BAUD                3000000
+#define BYTE_RATE           (BAUD / 10)             /* 8N1                               */
+#define UART_FIFO           256
+#define LOOP_UFRAMES        8                       /* main loop period, 1 ms            */
+#define RX_RING_SIZE        4096
+#define TX_RING_SIZE        2048
+
+
+/*--------------------------------------------------------------------------*/
+/*   Simulated USB to UART bridge                                           */
+/*--------------------------------------------------------------------------*/
+static UDEV_T       _udev;
+static IFACE_T      _iface;
+static ALT_IFACE_T  _aif;
+static DESC_IF_T    _ifd;
+static CDC_DEV_T    _cdev;
+
+static UTR_T        *_in_q[8], *_out_q[8];      /* bulk transfers queued               */
+static int          _in_n, _out_n;
+static uint32_t     _uframe;                    /* 125 us steps since start            */
+static uint32_t     _line_acc;                  /* line rate accumulator               */
+
+static uint8_t      _rx_fifo[UART_FIFO];        /* UART receive, sent to the host      */
+static uint32_t     _rx_fifo_rd, _rx_fifo_n;
+static uint32_t     _line_pos;                  /* stream byte on the UART RX line next */
+static uint32_t     _line_lost;                 /* bytes lost on RX FIFO overrun       */
+static int          _flow_ctl;                  /* RTS/CTS: the line waits for room    */
+
+static uint32_t     _tx_fifo_n;                 /* UART transmit, from the host        */
+static uint32_t     _dev_pos;                   /* stream byte the bridge expects next */
+static int          _data_err;
+
+static uint8_t stream_byte(uint32_t pos)
+{
+    return (uint8_t)((pos * 7) ^ (pos >> 8));
+}
+
+static int  queue_remove(UTR_T **q, int *n, UTR_T *utr)
+{
+    int   i;
+
+    for (i = 0; i < *n; i++)
+    {
+        if (q[i] == utr)
+        {
+            (*n)--;
+            memmove(q + i, q + i + 1, (*n - i) * sizeof(q[0]));
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void  complete(UTR_T **q, int *n)
+{
+    UTR_T   *utr = q[0];
+
+    queue_remove(q, n, utr);
+    utr->status = 0;
+    if (utr->func)
+        utr->func(utr);
+}
+
+/* 125 us of the bridge. Transfers complete in interrupt context. */
+static void  sim_uframe(void)
+{
+    UTR_T     *utr;
+    uint32_t  bytes, n, i, room, bus = BUS_BYTES;
+
+    _uframe++;
+
+    /* the UART lines move BYTE_RATE bytes per second each way */
+    _line_acc += BYTE_RATE;
+    bytes = _line_acc / 8000;
+    _line_acc -= bytes * 8000;
+
+    for (i = 0; i < bytes; i++)
+    {
+        if (_rx_fifo_n == UART_FIFO)
+        {
+            if (_flow_ctl)
+                break;
+            _line_lost++;
+            _line_pos++;
+            continue;
+        }
+        _rx_fifo[(_rx_fifo_rd + _rx_fifo_n) % UART_FIFO] = stream_byte(_line_pos++);
+        _rx_fifo_n++;
+    }
+    _tx_fifo_n = (_tx_fifo_n > bytes) ? _tx_fifo_n - bytes : 0;
+
+    if (__host_primask)
+        return;                         /* the host controller interrupt is masked    */
+
+    /* bulk in: one packet of what the FIFO holds at a time, a short packet ends the transfer */
+    while ((_in_n > 0) && (_rx_fifo_n > 0) && (bus >= EP_MPS))
+    {
+        utr = _in_q[0];
+        n = utr->data_len - utr->xfer_len;
+        if (n > EP_MPS)
+            n = EP_MPS;
+        if (n > _rx_fifo_n)
+            n = _rx_fifo_n;
+        bus -= EP_MPS;
+        for (i = 0; i < n; i++)
+            utr->buff[utr->xfer_len + i] = _rx_fifo[(_rx_fifo_rd + i) % UART_FIFO];
+        _rx_fifo_rd = (_rx_fifo_rd + n) % UART_FIFO;
+        _rx_fifo_n -= n;
+        utr->xfer_len += n;
+        if ((utr->xfer_len == utr->data_len) || (n < EP_MPS))
+            complete(_in_q, &_in_n);
+    }
+
+    /* bulk out: packets are NAKed until the FIFO has room for them */
+    while ((_out_n > 0) && (bus >= EP_MPS))
+    {
+        utr = _out_q[0];
+        n = utr->data_len - utr->xfer_len;
+        if (n > EP_MPS)
+            n = EP_MPS;
+        room = UART_FIFO * 4 - _tx_fifo_n;
+        if (n > room)
+            break;
+        for (i = 0; i < n; i++)
+        {
+            if (utr->buff[utr->xfer_len + i] != stream_byte(_dev_pos++))
+                _data_err++;
+        }
+        _tx_fifo_n += n;
+        utr->xfer_len += n;
+        bus -= EP_MPS;
+        if (utr->xfer_len == utr->data_len)
+            complete(_out_q, &_out_n);
+    }
+}
+
+static void  sim_run(uint32_t uframes)
+{
+    while (uframes--)
+        sim_uframe();
+}
+
+int usbh_bulk_xfer(UTR_T *utr)
+{
+    if (utr->ep->bEndpointAddress & EP_ADDR_DIR_IN)
+        _in_q[_in_n++] = utr;
+    else
+        _out_q[_out_n++] = utr;
+    return 0;
+}
+
+int usbh_quit_utr(UTR_T *utr)
+{
+    if (queue_remove(_in_q, &_in_n, utr) < 0)
+        queue_remove(_out_q, &_out_n, utr);
+    return 0;
+}
+
+int usbh_quit_xfer(UDEV_T *udev, EP_INFO_T *ep)
+{
+    if (ep->bEndpointAddress & EP_ADDR_DIR_IN)
+        _in_n = 0;
+    else
+        _out_n = 0;
+    return 0;
+}
+
+int usbh_int_xfer(UTR_T *utr)
+{
+    return USBH_ERR_NOT_SUPPORTED;
+}
+
+int usbh_ctrl_xfer(UDEV_T *udev, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                   uint16_t wLength, uint8_t *buff, uint32_t *xfer_len, uint32_t timeout)
+{
+    return USBH_ERR_NOT_SUPPORTED;
+}
+
+EP_INFO_T * usbh_iface_find_ep(IFACE_T *iface, uint8_t ep_addr, uint8_t dir_type)
+{
+    int   i;
+
+    for (i = 0; i < iface->aif->ifd->bNumEndpoints; i++)
+    {
+        if ((iface->aif->ep[i].bEndpointAddress & EP_ADDR_DIR_MASK) == (dir_type & EP_ADDR_DIR_MASK))
+            return &iface->aif->ep[i];
+    }
+    return NULL;
+}
+
+/* A busy wait on get_ticks() lets the simulation run, unless interrupts are disabled. */
+uint32_t get_ticks(void)
+{
+    if (__host_primask == 0)
+        sim_uframe();
+    return _uframe / 80;
+}
+
+static void  setup_cdc(void)
+{
+    _udev.speed = SPEED_FULL;
+    _ifd.bNumEndpoints = 2;
+    _aif.ifd = &_ifd;
+    _aif.ep[0].bEndpointAddress = 0x81;
+    _aif.ep[0].bmAttributes = EP_ATTR_TT_BULK;
+    _aif.ep[0].wMaxPacketSize = EP_MPS;
+    _aif.ep[1].bEndpointAddress = 0x02;
+    _aif.ep[1].bmAttributes = EP_ATTR_TT_BULK;
+    _aif.ep[1].wMaxPacketSize = EP_MPS;
+    _iface.udev = &_udev;
+    _iface.aif = &_aif;
+
+    memset(&_cdev, 0, sizeof(_cdev));
+    _cdev.udev = &_udev;
+    _cdev.iface_data = &_iface;
+}
+
+static void  sim_reset(int flow_ctl)
+{
+    _rx_fifo_rd = _rx_fifo_n = 0;
+    _tx_fifo_n = 0;
+    _line_pos = _line_lost = 0;
+    _dev_pos = 0;
+    _data_err = 0;
+    _flow_ctl = flow_ctl;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Test                                                                   */
+/*--------------------------------------------------------------------------*/
+static uint8_t    _rx_ring[RX_RING_SIZE], _tx_ring[TX_RING_SIZE];
+static uint32_t   _host_pos;            /* stream byte the application reads or writes next */
+static uint32_t   _cb_bytes;
+
+static void  rx_callback(CDC_DEV_T *cdev, uint8_t *rdata, int data_len)
+{
+    _cb_bytes += data_len;
+}
+
+/* Read what the receive ring holds, returns the number of bytes that differ from the stream */
+static int  app_read(void)
+{
+    uint8_t   buff[700];
+    int       len, i, err = 0;
+
+    while ((len = usbh_cdc_read(&_cdev, buff, sizeof(buff))) > 0)
+    {
+        for (i = 0; i < len; i++)
+        {
+            if (buff[i] != stream_byte(_host_pos++))
+                err++;
+        }
+    }
+    return err;
+}
+
+/* Queue up to <bytes> of the stream in pieces of up to 100 bytes, returns the bytes queued */
+static uint32_t  app_write(uint32_t bytes)
+{
+    uint8_t   buff[100];
+    uint32_t  len, i, done = 0;
+
+    while (done < bytes)
+    {
+        len = bytes - done;
+        if (len > sizeof(buff))
+            len = sizeof(buff);
+        for (i = 0; i < len; i++)
+            buff[i] = stream_byte(_host_pos + i);
+        if (usbh_cdc_send_data(&_cdev, buff, len) != 0)
+            break;
+        _host_pos += len;
+        done += len;
+    }
+    return done;
+}
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+int main(void)
+{
+    CDC_STAT_T       st;
+    USBH_MEM_STAT_T  mstat;
+    uint32_t         ms, t0, start, blocked;
+    int              ret = 0, err;
+
+    usbh_memory_init();
+    setup_cdc();
+
+    /* callback mode, one bulk-in transfer restarted from the main loop */
+    printf("receive, usbh_cdc_start_to_receive_data() from the main loop\n");
+    sim_reset(0);
+    for (ms = 0; ms < 1000; ms++)
+    {
+        if (_cdev.rx_busy == 0)
+            usbh_cdc_start_to_receive_data(&_cdev, rx_callback);
+        sim_run(LOOP_UFRAMES);
+    }
+    printf("  %u of %u bytes received, %u lost in the bridge\n", _cb_bytes, _line_pos, _line_lost);
+    if (_cdev.rx_busy == 0)
+        usbh_cdc_start_to_receive_data(&_cdev, rx_callback);
+    CHECK(usbh_cdc_start_receive_ring(&_cdev, _rx_ring, sizeof(_rx_ring)) == USBH_ERR_NOT_EXPECTED,
+          "ring mode started while receiving");
+    usbh_quit_utr(_cdev.utr_rx);
+    free_utr(_cdev.utr_rx);
+    _cdev.utr_rx = NULL;
+    _cdev.rx_busy = 0;
+
+    /* ring mode at line rate */
+    printf("receive, ring mode\n");
+    sim_reset(0);
+    _host_pos = 0;
+    CHECK(usbh_cdc_start_receive_ring(&_cdev, _rx_ring, 100) == USBH_ERR_INVALID_PARAM, "small ring taken");
+    CHECK(usbh_cdc_start_receive_ring(&_cdev, _rx_ring, sizeof(_rx_ring)) == 0, "usbh_cdc_start_receive_ring");
+    CHECK(_in_n == CDC_RX_UTR_NUM, "%d transfers queued", _in_n);
+    CHECK(usbh_cdc_start_to_receive_data(&_cdev, rx_callback) == USBH_ERR_NOT_EXPECTED, "callback mode started");
+    usbh_cdc_get_stat(&_cdev, &st);
+    err = 0;
+    for (ms = 0; ms < 1000; ms++)
+    {
+        sim_run(LOOP_UFRAMES);
+        err += app_read();
+    }
+    usbh_cdc_get_stat(&_cdev, &st);
+    printf("  %u of %u bytes received in %u transfers, %u lost in the bridge, %u B/s, peak %u\n",
+           _host_pos, _line_pos, st.rx_xfers, _line_lost, st.rx_rate, st.rx_peak);
+    CHECK(err == 0, "%d bytes differ from the stream", err);
+    CHECK(_line_lost == 0, "bytes lost");
+    CHECK(_host_pos + _rx_fifo_n == _line_pos, "bytes missing");
+    CHECK((st.rx_rate > BYTE_RATE * 99 / 100) && (st.rx_rate < BYTE_RATE * 101 / 100), "rx_rate %u", st.rx_rate);
+    CHECK((st.rx_full == 0) && (st.rx_errors == 0), "rx_full %u, rx_errors %u", st.rx_full, st.rx_errors);
+
+    /* the application stops reading for 100 ms, the bridge is held off by flow control */
+    printf("receive, ring mode, not read for 100 ms\n");
+    _flow_ctl = 1;
+    sim_run(100 * LOOP_UFRAMES);
+    usbh_cdc_get_stat(&_cdev, &st);
+    printf("  ring %u of %u, %u transfers parked, %u held back\n", _cdev.rx_wr - _cdev.rx_rd,
+           RX_RING_SIZE, CDC_RX_UTR_NUM - _in_n, st.rx_full);
+    CHECK(st.rx_full > 0, "ring never full");
+    CHECK(st.rx_peak <= RX_RING_SIZE, "peak %u", st.rx_peak);
+    err = 0;
+    for (ms = 0; ms < 200; ms++)
+    {
+        sim_run(LOOP_UFRAMES);
+        err += app_read();
+    }
+    CHECK(err == 0, "%d bytes differ from the stream", err);
+    CHECK((_line_lost == 0) && (_host_pos + _rx_fifo_n == _line_pos), "bytes lost");
+    CHECK(_in_n == CDC_RX_UTR_NUM, "%d transfers queued after the stall", _in_n);
+
+    usbh_cdc_stop_ring(&_cdev);
+    CHECK((_in_n == 0) && (_cdev.rx_ring == NULL), "not stopped");
+    CHECK(usbh_cdc_read(&_cdev, _rx_ring, 1) == USBH_ERR_NOT_FOUND, "read after stop");
+
+    /* blocking send, 100 bytes at a time */
+    printf("send, blocking\n");
+    sim_reset(0);
+    _host_pos = 0;
+    blocked = 0;
+    start = _uframe;
+    for (ms = 0; ms < 1000; ms++)
+    {
+        t0 = _uframe;
+        app_write(BYTE_RATE / 1000);
+        blocked += _uframe - t0;
+        if (_uframe - t0 < LOOP_UFRAMES)
+            sim_run(LOOP_UFRAMES - (_uframe - t0));
+    }
+    printf("  %u bytes sent, main loop blocked %u%% of the time\n", _dev_pos, blocked * 100 / (_uframe - start));
+    CHECK(_data_err == 0, "%d bytes differ from the stream", _data_err);
+
+    /* send ring at line rate */
+    printf("send, ring mode\n");
+    sim_reset(0);
+    _host_pos = 0;
+    CHECK(usbh_cdc_set_send_ring(&_cdev, _tx_ring, sizeof(_tx_ring)) == 0, "usbh_cdc_set_send_ring");
+    usbh_cdc_get_stat(&_cdev, &st);
+    blocked = 0;
+    start = _uframe;
+    for (ms = 0; ms < 1000; ms++)
+    {
+        t0 = _uframe;
+        CHECK(app_write(BYTE_RATE / 1000) == BYTE_RATE / 1000, "ring full at line rate");
+        blocked += _uframe - t0;
+        sim_run(LOOP_UFRAMES);
+    }
+    usbh_cdc_get_stat(&_cdev, &st);
+    printf("  %u bytes sent in %u transfers, %u B/s, main loop blocked %u%% of the time\n",
+           st.tx_bytes, st.tx_xfers, st.tx_rate, blocked * 100 / (_uframe - start));
+    CHECK(blocked == 0, "main loop blocked");
+    CHECK((st.tx_rate > BYTE_RATE * 99 / 100) && (st.tx_rate < BYTE_RATE * 101 / 100), "tx_rate %u", st.tx_rate);
+
+    /* faster than the line: the ring fills and usbh_cdc_send_data() refuses */
+    printf("send, ring mode, 4 times line rate\n");
+    for (ms = 0; ms < 100; ms++)
+    {
+        sim_run(LOOP_UFRAMES);
+        app_write(BYTE_RATE * 4 / 1000);
+    }
+    usbh_cdc_get_stat(&_cdev, &st);
+    printf("  %u refused, %d bytes pending\n", st.tx_full, usbh_cdc_send_pending(&_cdev));
+    CHECK(st.tx_full > 0, "ring never full");
+    CHECK(usbh_cdc_send_pending(&_cdev) > TX_RING_SIZE - 100, "ring not full");
+    for (ms = 0; (ms < 100) && (usbh_cdc_send_pending(&_cdev) > 0); ms++)
+        sim_run(LOOP_UFRAMES);
+    CHECK(_data_err == 0, "%d bytes differ from the stream", _data_err);
+    CHECK((_dev_pos == _host_pos) && (st.tx_errors == 0), "bytes lost");
+
+    CHECK(usbh_cdc_set_send_ring(&_cdev, NULL, 0) == 0, "usbh_cdc_set_send_ring(NULL)");
+    CHECK((_out_n == 0) && (_cdev.tx_ring == NULL), "not stopped");
+
+    usbh_memory_stat(&mstat);
+    CHECK((mstat.utr.used == 0) && (mstat.heap_used == 0), "UTRs or memory left in use");
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
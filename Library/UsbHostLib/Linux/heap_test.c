@@ -0,0 +1,161 @@
+/**************************************************************************//**
+ * @file     heap_test.c
+ * @version  V1.00
+ * @brief    Host test of the heap calls made by mem_alloc.c.
+ *
+ *           malloc(), calloc() and free() are wrapped (-Wl,--wrap) to count the calls.
+ *           A device is enumerated, then mass storage transfers are replayed
+ *           as msc_bulk_transfer() does them: a UTR and its descriptors for
+ *           each of the CBW, data and CSW phases. Built with STATIC_MEMORY_ALLOC
+ *           the transfers must make no heap calls at all, and the UTR pool
+ *           must report its exhaustion.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+
+#define TEST_XFERS          10000
+#define TEST_DATA_TDS       4           /* 16 KB of data phase in 4 KB OHCI TDs       */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void  __real_free(void *p);
+
+static unsigned  _malloc_calls, _free_calls;
+
+void *__wrap_malloc(size_t size)
+{
+    _malloc_calls++;
+    return __real_malloc(size);
+}
+
+/* the compiler may turn malloc() and memset() into calloc() */
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    _malloc_calls++;
+    return __real_calloc(nmemb, size);
+}
+
+void __wrap_free(void *p)
+{
+    _free_calls++;
+    __real_free(p);
+}
+
+/* One bulk phase of an MSC transfer, with the allocations the OHCI driver makes for it */
+static int msc_phase(UDEV_T *udev, int td_cnt)
+{
+    TD_T   *td[TEST_DATA_TDS];
+    UTR_T  *utr;
+    int    i;
+
+    utr = alloc_utr(udev);
+    if (utr == NULL)
+        return -1;
+    for (i = 0; i < td_cnt; i++)
+        td[i] = alloc_ohci_TD(utr);
+    for (i = 0; i < td_cnt; i++)
+        free_ohci_TD(td[i]);
+    free_utr(utr);
+    return 0;
+}
+
+static int test_exhaustion(UDEV_T *udev)
+{
+#if STATIC_MEMORY_ALLOC
+    UTR_T            *utr[MAX_UTR_NUM];
+    USBH_MEM_STAT_T  stat;
+    int              i, ret = 0;
+
+    for (i = 0; i < MAX_UTR_NUM; i++)
+    {
+        utr[i] = alloc_utr(udev);
+        if (utr[i] == NULL)
+            ret = -1;
+    }
+    if (alloc_utr(udev) != NULL)
+        ret = -1;
+    for (i = 0; i < MAX_UTR_NUM; i++)
+        free_utr(utr[i]);
+    free_utr(utr[0]);                   /* double free is reported and ignored        */
+
+    usbh_memory_stat(&stat);
+    printf("UTR pool: max used %d/%d, failed allocations %u, in use %d\n",
+           stat.utr.max_used, MAX_UTR_NUM, (unsigned)stat.utr_fail, stat.utr.used);
+    if ((stat.utr.max_used != MAX_UTR_NUM) || (stat.utr_fail != 1) || (stat.utr.used != 0))
+        ret = -1;
+    return ret;
+#else
+    (void)udev;
+    return 0;
+#endif
+}
+
+int main(void)
+{
+    USBH_MEM_STAT_T  stat;
+    UDEV_T    *udev;
+    uint8_t   *cfd_buff;
+    void      *iface;
+    unsigned  heap_calls, stat_calls;
+    int       i, ret = 0;
+
+    usbh_memory_init();
+
+    /* enumeration: device, configuration descriptor buffer and interface */
+    udev = alloc_device();
+    cfd_buff = usbh_alloc_desc_buff();
+    iface = usbh_alloc_mem(sizeof(IFACE_T));
+    if ((udev == NULL) || (cfd_buff == NULL) || (iface == NULL))
+    {
+        printf("enumeration allocations failed\n");
+        return 1;
+    }
+    udev->cfd_buff = cfd_buff;
+    heap_calls = _malloc_calls + _free_calls;
+    printf("STATIC_MEMORY_ALLOC %d\n", STATIC_MEMORY_ALLOC);
+    printf("enumeration: %u heap calls\n", heap_calls);
+
+    usbh_memory_stat(&stat);
+    stat_calls = stat.heap_calls;
+    _malloc_calls = _free_calls = 0;
+    for (i = 0; i < TEST_XFERS; i++)
+    {
+        if ((msc_phase(udev, 1) < 0) || (msc_phase(udev, TEST_DATA_TDS) < 0) || (msc_phase(udev, 1) < 0))
+        {
+            printf("transfer %d: alloc_utr failed\n", i);
+            return 1;
+        }
+    }
+    heap_calls = _malloc_calls + _free_calls;
+    printf("%d MSC transfers: %u malloc, %u free\n", TEST_XFERS, _malloc_calls, _free_calls);
+
+    usbh_memory_stat(&stat);
+    if (stat.heap_calls - stat_calls != heap_calls)
+    {
+        printf("usbh_memory_stat heap_calls %u, counted %u\n", (unsigned)(stat.heap_calls - stat_calls), heap_calls);
+        ret = 1;
+    }
+    if (STATIC_MEMORY_ALLOC && (heap_calls != 0))
+        ret = 1;
+
+    if (test_exhaustion(udev) < 0)
+        ret = 1;
+
+    usbh_free_mem(iface, sizeof(IFACE_T));
+    free_device(udev);
+    usbh_memory_stat(&stat);
+    if ((stat.utr.used != 0) || (stat.udev.used != 0) || (stat.desc_buff.used != 0) || (stat.heap_used != 0))
+    {
+        printf("objects left in use after disconnect\n");
+        ret = 1;
+    }
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
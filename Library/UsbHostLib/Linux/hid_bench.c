@@ -0,0 +1,141 @@
+/**************************************************************************//**
+ * @file     hid_bench.c
+ * @version  V1.00
+ * @brief    Host benchmark of report decoding with hid_parser.c.
+ *
+ *           All input fields of the reports of hid_corpus.h are
+ *           decoded three ways: walking the report descriptor for every
+ *           report and extracting bit by bit as applications did, bit by
+ *           bit from the compiled field table, and with usbh_hid_get_field().
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_hid.h"
+#include "hid_corpus.h"
+
+#define BENCH_REPORTS       200000
+#define MAX_FIELD           64
+
+typedef enum
+{
+    BENCH_REPARSE,                      /* parse the descriptor per report, bit loop  */
+    BENCH_BIT_LOOP,                     /* compiled fields, bit loop                  */
+    BENCH_COMPILED,                     /* compiled fields, usbh_hid_get_field()      */
+    BENCH_NUM
+} BENCH_T;
+
+static const char *_bench_name[BENCH_NUM] = { "re-parse", "bit loop", "compiled" };
+
+static HID_FIELD_T       _field[MAX_FIELD];
+static HID_REPORT_MAP_T  _map;
+static volatile int32_t  _sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int parse(uint8_t *desc, int len)
+{
+    memset(&_map, 0, sizeof(_map));
+    _map.field = _field;
+    _map.max_field = MAX_FIELD;
+    return usbh_hid_parse_report_map(desc, len, &_map);
+}
+
+static int32_t bit_loop(HID_FIELD_T *f, int idx, uint8_t *data)
+{
+    uint32_t  bit = f->bit_offset + idx * f->bit_size;
+    uint32_t  v = 0;
+    int       i;
+
+    for (i = 0; i < f->bit_size; i++, bit++)
+    {
+        if (data[bit / 8] & (1 << (bit % 8)))
+            v |= 1UL << i;
+    }
+    if ((f->logical_min < 0) && (f->bit_size < 32) && (v & (1UL << (f->bit_size - 1))))
+        v |= ~f->mask;
+    return (int32_t)v;
+}
+
+/* Decode all input elements of <BENCH_REPORTS> reports, returns ns per report */
+static double bench_run(BENCH_T type, uint8_t *desc, int desc_len, uint8_t *report, int len, int *elements)
+{
+    HID_FIELD_T  *f;
+    uint64_t     t0;
+    int32_t      v, sum = 0;
+    int          n, i, idx;
+
+    parse(desc, desc_len);
+    *elements = 0;
+    t0 = now_ns();
+    for (n = 0; n < BENCH_REPORTS; n++)
+    {
+        report[len - 1] = n;            /* a new report each time                     */
+        if (type == BENCH_REPARSE)
+            parse(desc, desc_len);
+
+        for (i = 0; i < _map.num_field; i++)
+        {
+            f = &_map.field[i];
+            if (f->report_type != RT_INPUT)
+                continue;
+            for (idx = 0; idx < f->count; idx++)
+            {
+                if (type == BENCH_COMPILED)
+                    usbh_hid_get_field(f, idx, report, len, &v);
+                else
+                    v = bit_loop(f, idx, report);
+                sum += v;
+                if (n == 0)
+                    (*elements)++;
+            }
+        }
+    }
+    _sink = sum;
+    return (double)(now_ns() - t0) / BENCH_REPORTS;
+}
+
+static void bench(const char *name, uint8_t *desc, int desc_len, int report_id)
+{
+    uint8_t  report[64];
+    double   ns;
+    int      type, len, elements;
+
+    parse(desc, desc_len);
+    len = usbh_hid_report_length(&_map, RT_INPUT, report_id);
+    for (type = 0; type < len; type++)
+        report[type] = rand();
+    report[0] = _map.report_id_used ? report_id : report[0];
+
+    for (type = 0; type < BENCH_NUM; type++)
+    {
+        ns = bench_run(type, desc, desc_len, report, len, &elements);
+        printf("%-14s %-10s %8d %10.1f %12.0f %14.0f\n", name, _bench_name[type], elements, ns,
+               1e9 / ns, 1e9 / ns * elements);
+    }
+}
+
+int main(void)
+{
+    printf("ns per report, decoding all input elements of %d reports.\n\n", BENCH_REPORTS);
+    printf("%-14s %-10s %8s %10s %12s %14s\n", "device", "decoder", "elements", "ns/report", "reports/s", "elements/s");
+    bench("gamepad", _desc_gamepad, sizeof(_desc_gamepad), 1);
+    bench("touch screen", _desc_touch, sizeof(_desc_touch), 1);
+    bench("keyboard", _desc_keyboard, sizeof(_desc_keyboard), 0);
+    bench("mouse", _desc_mouse, sizeof(_desc_mouse), 0);
+    bench("transfer", _desc_transfer, sizeof(_desc_transfer), 0);
+    return 0;
+}
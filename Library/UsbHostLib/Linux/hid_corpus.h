@@ -0,0 +1,109 @@
+/**************************************************************************//**
+ * @file     hid_corpus.h
+ * @version  V1.00
+ * @brief    HID report descriptors for hid_test.c and hid_bench.c.
+ *
+ *           The mouse, keyboard, touch screen and vendor transfer
+ *           descriptors are those of the USBD_HID_MouseKeyboard,
+ *           USBD_HID_Touch and USBD_HID_Transfer device samples. The
+ *           gamepad is written for the tests: 12-bit axes packed across
+ *           bytes, a hat switch with a null state, a 32-bit counter at an
+ *           odd bit offset, Push/Pop, a long item and 4-byte usages.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef  _HID_CORPUS_H_
+#define  _HID_CORPUS_H_
+
+/* SampleCode/StdDriver/USBD_HID_MouseKeyboard, HID_MouseReportDescriptor */
+static uint8_t _desc_mouse[] =
+{
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x09, 0x01, 0xA1, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x03,
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x03, 0x81, 0x02, 0x75, 0x05, 0x95, 0x01, 0x81, 0x01,
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x38, 0x15, 0x81, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x03,
+    0x81, 0x06, 0xC0, 0xC0,
+};
+
+/* SampleCode/StdDriver/USBD_HID_MouseKeyboard, HID_KeyboardReportDescriptor */
+static uint8_t _desc_keyboard[] =
+{
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01,
+    0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08, 0x81, 0x01, 0x95, 0x05, 0x75, 0x01,
+    0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01, 0x95, 0x06,
+    0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65, 0x81, 0x00, 0xC0,
+};
+
+/* SampleCode/StdDriver/USBD_HID_Touch, HID_DigitizerReportDescriptor */
+static uint8_t _desc_touch[] =
+{
+    0x05, 0x0D, 0x09, 0x04, 0xA1, 0x01, 0x85, 0x01, 0x09, 0x22, 0xA1, 0x02, 0x09, 0x42, 0x15, 0x00,
+    0x25, 0x01, 0x75, 0x01, 0x95, 0x01, 0x81, 0x02, 0x09, 0x32, 0x81, 0x02, 0x09, 0x47, 0x81, 0x02,
+    0x95, 0x05, 0x81, 0x03, 0x75, 0x08, 0x09, 0x51, 0x95, 0x01, 0x81, 0x02, 0x05, 0x01, 0x75, 0x10,
+    0x55, 0x0E, 0x65, 0x11, 0x09, 0x30, 0x35, 0x00, 0x46, 0xE3, 0x13, 0x26, 0x7F, 0x07, 0x81, 0x02,
+    0x09, 0x31, 0x46, 0x2F, 0x0B, 0x26, 0x37, 0x04, 0x81, 0x02, 0xC0, 0xA1, 0x02, 0x05, 0x0D, 0x09,
+    0x42, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x01, 0x81, 0x02, 0x09, 0x32, 0x81, 0x02, 0x09,
+    0x47, 0x81, 0x02, 0x95, 0x05, 0x81, 0x03, 0x75, 0x08, 0x09, 0x51, 0x95, 0x01, 0x81, 0x02, 0x05,
+    0x01, 0x75, 0x10, 0x55, 0x0E, 0x65, 0x11, 0x09, 0x30, 0x35, 0x00, 0x46, 0xE3, 0x13, 0x26, 0x7F,
+    0x07, 0x81, 0x02, 0x46, 0x2F, 0x0B, 0x26, 0x37, 0x04, 0x09, 0x31, 0x81, 0x02, 0xC0, 0x05, 0x0D,
+    0x09, 0x54, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x09, 0x55, 0x25,
+    0x02, 0x95, 0x01, 0x85, 0x02, 0xB1, 0x02, 0xC0,
+};
+
+/* SampleCode/StdDriver/USBD_HID_Transfer, HID_DeviceReportDescriptor */
+static uint8_t _desc_transfer[] =
+{
+    0x06, 0x00, 0xFF, 0x09, 0x01, 0xA1, 0x01, 0x19, 0x01, 0x29, 0x40, 0x15, 0x00, 0x26, 0xFF, 0x00,
+    0x75, 0x08, 0x95, 0x40, 0x81, 0x00, 0x19, 0x01, 0x29, 0x40, 0x91, 0x00, 0xC0,
+};
+
+/* Gamepad, report ID 1: input 15 bytes + ID, report ID 2: 4-byte output */
+static uint8_t _desc_gamepad[] =
+{
+    0x05, 0x01,                     /* Usage Page (Generic Desktop)                 */
+    0x09, 0x05,                     /* Usage (Game Pad)                             */
+    0xA1, 0x01,                     /* Collection (Application)                     */
+    0x85, 0x01,                     /*   Report ID (1)                              */
+    0x05, 0x09,                     /*   Usage Page (Button)                        */
+    0x19, 0x01, 0x29, 0x10,         /*   Usage Minimum (1), Usage Maximum (16)      */
+    0x15, 0x00, 0x25, 0x01,         /*   Logical Minimum (0), Logical Maximum (1)   */
+    0x75, 0x01, 0x95, 0x10,         /*   Report Size (1), Report Count (16)         */
+    0x81, 0x02,                     /*   Input (Data, Var, Abs)                     */
+    0x05, 0x01,                     /*   Usage Page (Generic Desktop)               */
+    0x09, 0x39,                     /*   Usage (Hat switch)                         */
+    0x15, 0x00, 0x25, 0x07,         /*   Logical Minimum (0), Logical Maximum (7)   */
+    0x75, 0x04, 0x95, 0x01,         /*   Report Size (4), Report Count (1)          */
+    0x81, 0x42,                     /*   Input (Data, Var, Abs, Null)               */
+    0xA4,                           /*   Push                                       */
+    0x09, 0x30, 0x09, 0x31,         /*   Usage (X), Usage (Y)                       */
+    0x09, 0x32, 0x09, 0x35,         /*   Usage (Z), Usage (Rz)                      */
+    0x16, 0x01, 0xF8,               /*   Logical Minimum (-2047)                    */
+    0x26, 0xFF, 0x07,               /*   Logical Maximum (2047)                     */
+    0x75, 0x0C, 0x95, 0x04,         /*   Report Size (12), Report Count (4)         */
+    0x81, 0x02,                     /*   Input (Data, Var, Abs)                     */
+    0xB4,                           /*   Pop: 4 bits, 0..7                          */
+    0x95, 0x01,                     /*   Report Count (1)                           */
+    0x75, 0x01,                     /*   Report Size (1)                            */
+    0x81, 0x03,                     /*   Input (Const): padding                     */
+    0xFE, 0x02, 0x10, 0xAA, 0xBB,   /*   long item, ignored                         */
+    0x0B, 0x36, 0x00, 0x01, 0x00,   /*   Usage (Generic Desktop: Slider), 4 bytes   */
+    0x16, 0x00, 0x80,               /*   Logical Minimum (-32768)                   */
+    0x26, 0xFF, 0x7F,               /*   Logical Maximum (32767)                    */
+    0x75, 0x10,                     /*   Report Size (16)                           */
+    0x81, 0x02,                     /*   Input (Data, Var, Abs)                     */
+    0x06, 0x00, 0xFF,               /*   Usage Page (Vendor 0xFF00)                 */
+    0x09, 0x20,                     /*   Usage (0x20): timestamp                    */
+    0x15, 0x00,                     /*   Logical Minimum (0)                        */
+    0x27, 0xFF, 0xFF, 0xFF, 0x7F,   /*   Logical Maximum (0x7FFFFFFF)               */
+    0x75, 0x20,                     /*   Report Size (32)                           */
+    0x81, 0x02,                     /*   Input (Data, Var, Abs)                     */
+    0x75, 0x03,                     /*   Report Size (3)                            */
+    0x81, 0x03,                     /*   Input (Const): padding to a byte           */
+    0x85, 0x02,                     /*   Report ID (2)                              */
+    0x09, 0x21,                     /*   Usage (0x21): rumble motors                */
+    0x26, 0xFF, 0x00,               /*   Logical Maximum (255)                      */
+    0x75, 0x08, 0x95, 0x04,         /*   Report Size (8), Report Count (4)          */
+    0x91, 0x02,                     /*   Output (Data, Var, Abs)                    */
+    0xC0,                           /* End Collection                               */
+};
+
+#endif  /* _HID_CORPUS_H_ */
@@ -0,0 +1,255 @@
+/**************************************************************************//**
+ * @file     hid_test.c
+ * @version  V1.00
+ * @brief    Host test of the report descriptor parser of hid_parser.c.
+ *
+ *           Each descriptor of hid_corpus.h is compiled and checked for its
+ *           fields and report lengths. Every element of every field is then
+ *           taken from random reports and compared with a bit by bit
+ *           extraction. Malformed descriptors must be refused.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_hid.h"
+#include "hid_corpus.h"
+
+#define MAX_FIELD           64
+#define RANDOM_REPORTS      1000
+
+static HID_FIELD_T       _field[MAX_FIELD];
+static HID_REPORT_MAP_T  _map;
+static int               ret;
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+
+/* Element <idx> of <f>, bit by bit */
+static int32_t ref_get(HID_FIELD_T *f, int idx, uint8_t *data)
+{
+    uint32_t  bit = f->bit_offset + idx * f->bit_size;
+    uint32_t  v = 0;
+    int       i;
+
+    for (i = 0; i < f->bit_size; i++, bit++)
+    {
+        if (data[bit / 8] & (1 << (bit % 8)))
+            v |= 1UL << i;
+    }
+    if ((f->logical_min < 0) && (f->bit_size < 32) && (v & (1UL << (f->bit_size - 1))))
+        v |= ~f->mask;
+    return (int32_t)v;
+}
+
+static int parse(uint8_t *desc, int len)
+{
+    memset(&_map, 0, sizeof(_map));
+    _map.field = _field;
+    _map.max_field = MAX_FIELD;
+    return usbh_hid_parse_report_map(desc, len, &_map);
+}
+
+/* Compare all elements of all fields with ref_get() on random reports */
+static void check_random_reports(void)
+{
+    uint8_t      data[256];
+    HID_FIELD_T  *f;
+    int32_t      v;
+    int          i, n, idx, len, err = 0;
+
+    for (n = 0; n < RANDOM_REPORTS; n++)
+    {
+        for (i = 0; i < sizeof(data); i++)
+            data[i] = rand();
+
+        for (i = 0; i < _map.num_field; i++)
+        {
+            f = &_map.field[i];
+            len = usbh_hid_report_length(&_map, f->report_type, f->report_id);
+            data[0] = _map.report_id_used ? f->report_id : data[0];
+            for (idx = 0; idx < f->count; idx++)
+            {
+                if ((usbh_hid_get_field(f, idx, data, len, &v) != 0) || (v != ref_get(f, idx, data)))
+                    err++;
+            }
+            if (usbh_hid_get_field(f, f->count, data, len, &v) != HID_RET_INVALID_PARAMETER)
+                err++;
+            if ((f->bit_offset + f->count * f->bit_size + 7) / 8 > len)
+                err++;                      /* field past the report end                  */
+        }
+    }
+    CHECK(err == 0, "%d elements differ from the bit by bit extraction", err);
+}
+
+static HID_FIELD_T * field(int type, uint32_t usage, int bit_offset, int bit_size, int count)
+{
+    HID_FIELD_T  *f = usbh_hid_find_field(&_map, type, usage);
+
+    CHECK(f != NULL, "usage 0x%x not found", usage);
+    if (f == NULL)
+        return NULL;
+    CHECK((f->bit_offset == bit_offset) && (f->bit_size == bit_size) && (f->count == count),
+          "usage 0x%x at bit %d, %d bits x %d", usage, f->bit_offset, f->bit_size, f->count);
+    return f;
+}
+
+static void test_mouse(void)
+{
+    uint8_t      report[4] = { 0x05, 0xFE, 0x10, 0x81 };
+    HID_FIELD_T  *f;
+    int32_t      v;
+
+    printf("mouse\n");
+    CHECK(parse(_desc_mouse, sizeof(_desc_mouse)) == 6, "%d fields", _map.num_field);
+    CHECK(usbh_hid_report_length(&_map, RT_INPUT, 0) == 4, "input report length");
+    field(RT_INPUT, HID_USAGE(0x09, 1), 0, 1, 1);
+    f = field(RT_INPUT, HID_USAGE(0x09, 3), 2, 1, 1);
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 4, &v) == 0) && (v == 1), "button 3");
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x30), 8, 8, 1);
+    CHECK(f && (f->logical_min == -127) && (f->logical_max == 127) && (f->flags & HID_FIELD_RELATIVE), "X range");
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 4, &v) == 0) && (v == -2), "X %d", v);
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x38), 24, 8, 1);
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 4, &v) == 0) && (v == -127), "wheel %d", v);
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 3, &v) == HID_RET_INVALID_PARAMETER), "short report");
+    check_random_reports();
+}
+
+static void test_keyboard(void)
+{
+    uint8_t      report[8] = { 0x02, 0x00, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00 };
+    HID_FIELD_T  *f;
+    int32_t      v;
+
+    printf("keyboard\n");
+    CHECK(parse(_desc_keyboard, sizeof(_desc_keyboard)) == 14, "%d fields", _map.num_field);
+    CHECK(usbh_hid_report_length(&_map, RT_INPUT, 0) == 8, "input report length");
+    CHECK(usbh_hid_report_length(&_map, RT_OUTPUT, 0) == 1, "output report length");
+    CHECK(usbh_hid_report_length(&_map, RT_FEATURE, 0) == HID_RET_INVALID_PARAMETER, "feature report");
+    f = field(RT_INPUT, HID_USAGE(0x07, 0xE1), 1, 1, 1);
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 8, &v) == 0) && (v == 1), "left shift");
+    field(RT_OUTPUT, HID_USAGE(0x08, 5), 4, 1, 1);
+    f = field(RT_INPUT, HID_USAGE(0x07, 0x00), 16, 8, 6);
+    CHECK(f && !(f->flags & HID_FIELD_VARIABLE) && (f->logical_max == 0x65), "key array");
+    CHECK(f && (usbh_hid_get_field(f, 1, report, 8, &v) == 0) && (v == 5), "second key %d", v);
+    check_random_reports();
+}
+
+static void test_touch(void)
+{
+    uint8_t      report[14] = { 0x01, 0x07, 0x03, 0x34, 0x12, 0x78, 0x04 };
+    HID_FIELD_T  *f;
+    int32_t      v;
+
+    printf("touch screen\n");
+    CHECK(parse(_desc_touch, sizeof(_desc_touch)) == 14, "%d fields", _map.num_field);
+    CHECK(_map.report_id_used && (_map.num_report == 2), "reports");
+    CHECK(usbh_hid_report_length(&_map, RT_INPUT, 1) == 14, "input report length");
+    CHECK(usbh_hid_report_length(&_map, RT_FEATURE, 2) == 2, "feature report length");
+    field(RT_INPUT, HID_USAGE(0x0D, 0x42), 8, 1, 1);
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x30), 24, 16, 1);
+    CHECK(f && (f->logical_max == 0x77F), "X range");
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 14, &v) == 0) && (v == 0x1234), "X 0x%x", v);
+    report[0] = 2;
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 14, &v) == HID_RET_INVALID_PARAMETER), "report ID not checked");
+    f = field(RT_FEATURE, HID_USAGE(0x0D, 0x55), 8, 8, 1);
+    CHECK(f && (f->report_id == 2) && (f->logical_max == 2), "contact count maximum");
+    check_random_reports();
+}
+
+static void test_transfer(void)
+{
+    printf("vendor transfer\n");
+    CHECK(parse(_desc_transfer, sizeof(_desc_transfer)) == 2, "%d fields", _map.num_field);
+    CHECK(usbh_hid_report_length(&_map, RT_INPUT, 0) == 64, "input report length");
+    CHECK(usbh_hid_report_length(&_map, RT_OUTPUT, 0) == 64, "output report length");
+    field(RT_INPUT, HID_USAGE(0xFF00, 1), 0, 8, 64);
+    field(RT_OUTPUT, HID_USAGE(0xFF00, 1), 0, 8, 64);
+    check_random_reports();
+}
+
+static void test_gamepad(void)
+{
+    uint8_t      report[16];
+    HID_FIELD_T  *f;
+    int32_t      v;
+
+    printf("gamepad\n");
+    CHECK(parse(_desc_gamepad, sizeof(_desc_gamepad)) == 24, "%d fields", _map.num_field);
+    CHECK(usbh_hid_report_length(&_map, RT_INPUT, 1) == 16, "input report length");
+    CHECK(usbh_hid_report_length(&_map, RT_OUTPUT, 2) == 5, "output report length");
+    field(RT_INPUT, HID_USAGE(0x09, 16), 23, 1, 1);
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x39), 24, 4, 1);
+    CHECK(f && (f->flags & HID_FIELD_NULL_STATE) && (f->logical_max == 7), "hat");
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x30), 28, 12, 1);
+    CHECK(f && (f->logical_min == -2047) && (f->logical_max == 2047), "X range");
+
+    /* X = -2047 from bit 28, Y = 2047 from bit 40 */
+    memset(report, 0, sizeof(report));
+    report[0] = 1;
+    report[3] = 0x10;
+    report[4] = 0x80;
+    report[5] = 0xFF;
+    report[6] = 0x07;
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 16, &v) == 0) && (v == -2047), "X %d", v);
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x31), 40, 12, 1);
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 16, &v) == 0) && (v == 2047), "Y %d", v);
+    field(RT_INPUT, HID_USAGE(0x01, 0x35), 64, 12, 1);
+    f = field(RT_INPUT, HID_USAGE(0x01, 0x36), 77, 16, 1);
+    CHECK(f && (f->logical_min == -32768), "slider range");
+
+    /* 32 bits from bit 93: five bytes */
+    f = field(RT_INPUT, HID_USAGE(0xFF00, 0x20), 93, 32, 1);
+    memset(report, 0, sizeof(report));
+    report[0] = 1;
+    report[11] = 0xE0;
+    report[15] = 0x10;
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 16, &v) == 0) && ((uint32_t)v == 0x80000007), "timestamp 0x%x", v);
+    CHECK(f && (usbh_hid_get_field(f, 0, report, 15, &v) == HID_RET_INVALID_PARAMETER), "short report");
+    f = field(RT_OUTPUT, HID_USAGE(0xFF00, 0x21), 8, 8, 4);
+    CHECK(f && (f->report_id == 2) && (f->flags & HID_FIELD_VARIABLE), "rumble");
+    check_random_reports();
+}
+
+static void test_malformed(void)
+{
+    static uint8_t  truncated[] = { 0x05, 0x01, 0x26, 0xFF };
+    static uint8_t  end_collection[] = { 0x05, 0x01, 0xC0 };
+    static uint8_t  open_collection[] = { 0xA1, 0x01, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02 };
+    static uint8_t  usage_max[] = { 0x29, 0x05, 0x81, 0x02 };
+    static uint8_t  report_id_0[] = { 0x85, 0x00 };
+    static uint8_t  pop[] = { 0xB4 };
+    static uint8_t  long_item[] = { 0xFE, 0x08, 0x10, 0x00 };
+
+    printf("malformed descriptors\n");
+    CHECK(parse(truncated, sizeof(truncated)) == HID_RET_INVALID_PARAMETER, "truncated item");
+    CHECK(parse(end_collection, sizeof(end_collection)) == HID_RET_INVALID_PARAMETER, "End Collection");
+    CHECK(parse(open_collection, sizeof(open_collection)) == HID_RET_INVALID_PARAMETER, "open collection");
+    CHECK(parse(usage_max, sizeof(usage_max)) == HID_RET_INVALID_PARAMETER, "Usage Maximum");
+    CHECK(parse(report_id_0, sizeof(report_id_0)) == HID_RET_INVALID_PARAMETER, "report ID 0");
+    CHECK(parse(pop, sizeof(pop)) == HID_RET_INVALID_PARAMETER, "Pop");
+    CHECK(parse(long_item, sizeof(long_item)) == HID_RET_INVALID_PARAMETER, "long item");
+
+    memset(&_map, 0, sizeof(_map));
+    _map.field = _field;
+    _map.max_field = 5;
+    CHECK(usbh_hid_parse_report_map(_desc_mouse, sizeof(_desc_mouse), &_map) == HID_RET_OUT_OF_MEMORY, "field table full");
+}
+
+int main(void)
+{
+    test_mouse();
+    test_keyboard();
+    test_touch();
+    test_transfer();
+    test_gamepad();
+    test_malformed();
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
@@ -0,0 +1,212 @@
+/**************************************************************************//**
+ * @file     mem_bench.c
+ * @version  V1.00
+ * @brief    Host micro-benchmark of the descriptor pool of mem_alloc.c.
+ *
+ *           A transfer allocates its qTDs (EHCI) or TDs (OHCI) and frees them
+ *           when it is done, with part of the pool held by the descriptors of
+ *           other endpoints. The time per transfer is measured for the bitmap
+ *           pool of mem_alloc.c and for the unit by unit scan it replaced,
+ *           which is reproduced below.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+
+#define BENCH_ROUNDS        200000
+#define BENCH_DESC_MAX      16          /* 64 KB: four 16 KB qTDs, sixteen 4 KB TDs   */
+
+
+/*--------------------------------------------------------------------------*/
+/*   The previous allocator: scan for a free unit, scan again to free it     */
+/*--------------------------------------------------------------------------*/
+static uint8_t  _ref_pool[MEM_POOL_UNIT_NUM][MEM_POOL_UNIT_SIZE] __attribute__((aligned(32)));
+static uint8_t  _ref_used[MEM_POOL_UNIT_NUM];
+static int      _ref_sidx;
+
+static void * ref_alloc_ohci(void)
+{
+    int    i;
+
+    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    {
+        if (_ref_used[i] == 0)
+        {
+            _ref_used[i] = 1;
+            memset(&_ref_pool[i], 0, sizeof(TD_T));
+            return &_ref_pool[i];
+        }
+    }
+    return NULL;
+}
+
+static void * ref_alloc_ehci(void)
+{
+    int    i;
+
+    for (i = (_ref_sidx+1) % MEM_POOL_UNIT_NUM; i != _ref_sidx; i = (i+1) % MEM_POOL_UNIT_NUM)
+    {
+        if (_ref_used[i] == 0)
+        {
+            _ref_used[i] = 1;
+            _ref_sidx = i;
+            memset(&_ref_pool[i], 0, sizeof(qTD_T));
+            return &_ref_pool[i];
+        }
+    }
+    return NULL;
+}
+
+static void ref_free(void *p)
+{
+    int    i;
+
+    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    {
+        if (&_ref_pool[i] == p)
+        {
+            _ref_used[i] = 0;
+            return;
+        }
+    }
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Benchmark                                                              */
+/*--------------------------------------------------------------------------*/
+typedef enum
+{
+    BENCH_REF_QTD,
+    BENCH_REF_TD,
+    BENCH_POOL_QTD,
+    BENCH_POOL_TD,
+} BENCH_ALLOC_T;
+
+static const char * const _alloc_name[] =
+{
+    "scan qTD", "scan TD", "bitmap qTD", "bitmap TD"
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void * bench_alloc(BENCH_ALLOC_T type)
+{
+    switch (type)
+    {
+    case BENCH_REF_QTD:
+        return ref_alloc_ehci();
+    case BENCH_REF_TD:
+        return ref_alloc_ohci();
+    case BENCH_POOL_QTD:
+        return alloc_ehci_qTD(NULL);
+    default:
+        return alloc_ohci_TD(NULL);
+    }
+}
+
+static void bench_free(BENCH_ALLOC_T type, void *p)
+{
+    switch (type)
+    {
+    case BENCH_REF_QTD:
+    case BENCH_REF_TD:
+        ref_free(p);
+        break;
+    case BENCH_POOL_QTD:
+        free_ehci_qTD((qTD_T *)p);
+        break;
+    default:
+        free_ohci_TD((TD_T *)p);
+        break;
+    }
+}
+
+/*
+ *  Hold <held> units, spread over the pool as the descriptors of other endpoints are,
+ *  then time <BENCH_ROUNDS> transfers of <desc_cnt> descriptors each.
+ */
+static double bench_run(BENCH_ALLOC_T type, int held, int desc_cnt)
+{
+    void      *hold[MEM_POOL_UNIT_NUM];
+    void      *desc[BENCH_DESC_MAX];
+    uint64_t  t0, t1;
+    int       i, j, n;
+
+    usbh_memory_init();
+    memset(_ref_used, 0, sizeof(_ref_used));
+    _ref_sidx = 0;
+
+    /* fill the pool, then free all but <held> units picked at random */
+    for (n = 0; n < MEM_POOL_UNIT_NUM; n++)
+        hold[n] = bench_alloc(type);
+    srand(1);
+    for (i = n - 1; i > 0; i--)
+    {
+        void  *t;
+
+        j = rand() % (i + 1);
+        t = hold[i];
+        hold[i] = hold[j];
+        hold[j] = t;
+    }
+    for (i = held; i < n; i++)
+        bench_free(type, hold[i]);
+
+    t0 = now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+    {
+        for (j = 0; j < desc_cnt; j++)
+            desc[j] = bench_alloc(type);
+        for (j = 0; j < desc_cnt; j++)
+            bench_free(type, desc[j]);
+    }
+    t1 = now_ns();
+
+    for (i = 0; i < held; i++)
+        bench_free(type, hold[i]);
+
+    return (double)(t1 - t0) / BENCH_ROUNDS;
+}
+
+int main(void)
+{
+    static const int  held_list[] = { 0, 64, 128, 192, 240 };
+    USBH_MEM_STAT_T   stat;
+    BENCH_ALLOC_T     type;
+    int               h, desc_cnt;
+
+    printf("Pool of %d units. ns per 64 KB transfer, alloc and free of all its descriptors.\n\n", MEM_POOL_UNIT_NUM);
+    printf("%-12s %11s", "allocator", "descriptors");
+    for (h = 0; h < (int)(sizeof(held_list) / sizeof(held_list[0])); h++)
+        printf("  held %3d", held_list[h]);
+    printf("\n");
+
+    for (type = BENCH_REF_QTD; type <= BENCH_POOL_TD; type++)
+    {
+        desc_cnt = ((type == BENCH_REF_QTD) || (type == BENCH_POOL_QTD)) ? 4 : 16;
+        printf("%-12s %11d", _alloc_name[type], desc_cnt);
+        for (h = 0; h < (int)(sizeof(held_list) / sizeof(held_list[0])); h++)
+            printf("  %8.0f", bench_run(type, held_list[h], desc_cnt));
+        printf("\n");
+    }
+
+    /* high-water marks of the last run, which filled the pool with TDs to spread the held ones */
+    usbh_memory_stat(&stat);
+    printf("\npool max used %d/%d, TD max used %d, qTD max used %d, failed allocations %u\n",
+           stat.pool.max_used, MEM_POOL_UNIT_NUM, stat.td.max_used, stat.qtd.max_used,
+           (unsigned)stat.alloc_fail);
+    return (stat.pool.max_used == MEM_POOL_UNIT_NUM) && (stat.alloc_fail == 0) ? 0 : 1;
+}
@@ -0,0 +1,951 @@
+/**************************************************************************//**
+ * @file     sim_dev.c
+ * @version  V1.00
+ * @brief    Simulated USB devices for the controller models of usbh_sim.c: a hub,
+ *           a bulk-only mass storage disk, a CDC ACM loopback, a HID keyboard and
+ *           a USB audio device with a microphone and a speaker.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "NuMicro.h"
+
+#include "usb.h"
+#include "hub.h"
+#include "usbh_sim.h"
+
+#define SIM_VID              0x0416
+
+/* Write a descriptor of <len> bytes, the bytes after bLength are the arguments */
+static uint8_t * desc(uint8_t *p, int len, ...)
+{
+    va_list  ap;
+    int      i;
+
+    va_start(ap, len);
+    p[0] = len;
+    for (i = 1; i < len; i++)
+        p[i] = (uint8_t)va_arg(ap, int);
+    va_end(ap);
+    return p + len;
+}
+
+static uint8_t * desc_ep(uint8_t *p, uint8_t addr, uint8_t attr, int mps, int interval)
+{
+    return desc(p, 7, USB_DT_ENDPOINT, addr, attr, mps & 0xFF, mps >> 8, interval);
+}
+
+static void  desc_dev(uint8_t *d, int cls, int proto, int mps0, uint16_t pid)
+{
+    desc(d, 18, USB_DT_DEVICE, 0x00, 0x02, cls, 0, proto, mps0,
+         SIM_VID & 0xFF, SIM_VID >> 8, pid & 0xFF, pid >> 8, 0x00, 0x01, 0, 2, 0, 1);
+}
+
+/* Write the configuration descriptor header at <cfg>, with the length up to <end> */
+static void  desc_cfg(uint8_t *cfg, uint8_t *end, int num_if)
+{
+    int   len = end - cfg;
+
+    desc(cfg, 9, USB_DT_CONFIGURATION, len & 0xFF, len >> 8, num_if, 1, 0, 0x80, 50);
+}
+
+static SIM_DEV_T * dev_new(const SIM_CLASS_T *cls, int speed, void *priv,
+                           const uint8_t *dev_desc, const uint8_t *cfg_desc)
+{
+    SIM_DEV_T  *dev;
+
+    dev = calloc(1, sizeof(*dev));
+    dev->priv = priv;
+    sim_dev_init(dev, cls, speed, dev_desc, cfg_desc);
+    return dev;
+}
+
+static int  bulk_mps(int speed)
+{
+    return (speed == SIM_SPEED_HIGH) ? 512 : 64;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Hub                                                                                  */
+/*----------------------------------------------------------------------------------------*/
+
+/*
+ *  The port status and change bits are kept in the SIM_DEV_T of the hub. A port reset
+ *  takes HUB_RESET_NS and is completed when the status is next looked at.
+ */
+#define HUB_RESET_NS         10000000ULL
+
+typedef struct
+{
+    uint8_t   dev_desc[18];
+    uint8_t   cfg_desc[32];
+} SIM_HUB_T;
+
+static void  hub_port_update(SIM_DEV_T *hub, int port)
+{
+    SIM_DEV_T  *dev = hub->port_dev[port];
+
+    if (!(hub->port_sts[port] & PORT_S_RESET) || (sim_time_ns() < hub->port_reset_end[port]))
+        return;
+
+    hub->port_sts[port] &= ~(PORT_S_RESET | PORT_S_LOW_SPEED | PORT_S_HIGH_SPEED);
+    hub->port_chg[port] |= PORT_C_RESET;
+    if ((dev != NULL) && (hub->port_sts[port] & PORT_S_CONNECTION))
+    {
+        hub->port_sts[port] |= PORT_S_ENABLE;
+        if (dev->speed == SIM_SPEED_LOW)
+            hub->port_sts[port] |= PORT_S_LOW_SPEED;
+        else if ((dev->speed == SIM_SPEED_HIGH) && (hub->speed == SIM_SPEED_HIGH))
+            hub->port_sts[port] |= PORT_S_HIGH_SPEED;
+    }
+}
+
+static int  hub_port_feature(SIM_DEV_T *hub, int port, int feature, int set)
+{
+    SIM_DEV_T  *dev = hub->port_dev[port];
+    uint16_t   *sts = &hub->port_sts[port];
+
+    if (!set)
+    {
+        switch (feature)
+        {
+        case FS_PORT_ENABLE:
+            *sts &= ~PORT_S_ENABLE;
+            break;
+        case FS_PORT_SUSPEND:
+            *sts &= ~PORT_S_SUSPEND;
+            break;
+        case FS_PORT_POWER:
+            *sts = 0;
+            break;
+        default:
+            if ((feature >= FS_C_PORT_CONNECTION) && (feature <= FS_C_PORT_RESET))
+                hub->port_chg[port] &= ~(1 << (feature - FS_C_PORT_CONNECTION));
+            break;
+        }
+        return 0;
+    }
+
+    switch (feature)
+    {
+    case FS_PORT_SUSPEND:
+        *sts |= PORT_S_SUSPEND;
+        break;
+    case FS_PORT_RESET:
+        if ((*sts & (PORT_S_PORT_POWER | PORT_S_CONNECTION)) == (PORT_S_PORT_POWER | PORT_S_CONNECTION))
+        {
+            *sts = (*sts & ~PORT_S_ENABLE) | PORT_S_RESET;
+            hub->port_reset_end[port] = sim_time_ns() + HUB_RESET_NS;
+            sim_dev_reset(dev);
+        }
+        break;
+    case FS_PORT_POWER:
+        if (!(*sts & PORT_S_PORT_POWER))
+        {
+            *sts |= PORT_S_PORT_POWER;
+            if (dev != NULL)
+            {
+                *sts |= PORT_S_CONNECTION;
+                hub->port_chg[port] |= PORT_C_CONNECTION;
+            }
+        }
+        break;
+    }
+    return 0;
+}
+
+static int  hub_ctrl(SIM_DEV_T *hub, const uint8_t *setup, uint8_t *data)
+{
+    int   port = setup[4];
+
+    if (setup[0] == (REQ_TYPE_IN | REQ_TYPE_CLASS_DEV | REQ_TYPE_TO_DEV))
+    {
+        if (setup[1] == USB_REQ_GET_DESCRIPTOR)
+        {
+            desc(data, 9, 0x29, hub->nports, 0x09, 0x00, 50, 0, 0x00, 0xFF);
+            return 9;
+        }
+        if (setup[1] == USB_REQ_GET_STATUS)
+        {
+            memset(data, 0, 4);
+            return 4;
+        }
+        return SIM_STALL;
+    }
+    if ((setup[0] & 0x1F) == REQ_TYPE_TO_DEV)
+        return 0;                           /* hub features                               */
+
+    if ((port < 1) || (port > hub->nports))
+        return SIM_STALL;
+    hub_port_update(hub, port);
+
+    switch (setup[1])
+    {
+    case USB_REQ_GET_STATUS:
+        data[0] = hub->port_sts[port] & 0xFF;
+        data[1] = hub->port_sts[port] >> 8;
+        data[2] = hub->port_chg[port] & 0xFF;
+        data[3] = hub->port_chg[port] >> 8;
+        return 4;
+    case USB_REQ_SET_FEATURE:
+    case USB_REQ_CLEAR_FEATURE:
+        return hub_port_feature(hub, port, setup[2], setup[1] == USB_REQ_SET_FEATURE);
+    }
+    return 0;                               /* transaction translator requests            */
+}
+
+/* Status change endpoint: a bit for each port with a change, NAK if there is none */
+static int  hub_xfer(SIM_DEV_T *hub, uint8_t ep_addr, uint8_t *buf, int len)
+{
+    uint8_t  map = 0;
+    int      port;
+
+    for (port = 1; port <= hub->nports; port++)
+    {
+        hub_port_update(hub, port);
+        if (hub->port_chg[port])
+            map |= (1 << port);
+    }
+    if (map == 0)
+        return SIM_NAK;
+    buf[0] = map;
+    return 1;
+}
+
+static void  hub_event(SIM_DEV_T *hub, int ev, int arg)
+{
+    if (ev == SIM_EV_RESET)
+    {
+        memset(hub->port_sts, 0, sizeof(hub->port_sts));
+        memset(hub->port_chg, 0, sizeof(hub->port_chg));
+    }
+}
+
+static const SIM_CLASS_T  _hub_class = { "Hub", hub_ctrl, hub_xfer, hub_event };
+
+/**
+  * @brief    Create a hub with SIM_HUB_PORTS ports.
+  * @param[in]  speed  SIM_SPEED_HIGH, a hub with a single TT, or SIM_SPEED_FULL
+  * @return   The hub.
+  */
+SIM_DEV_T * sim_hub_new(int speed)
+{
+    SIM_HUB_T  *h = calloc(1, sizeof(*h));
+    SIM_DEV_T  *dev;
+    uint8_t    *p;
+
+    desc_dev(h->dev_desc, USB_CLASS_HUB, (speed == SIM_SPEED_HIGH) ? 1 : 0, 64, 0x5001);
+    p = h->cfg_desc + 9;
+    p = desc(p, 9, USB_DT_INTERFACE, 0, 0, 1, USB_CLASS_HUB, 0, 0, 0);
+    p = desc_ep(p, 0x81, EP_ATTR_TT_INT, 1, 12);
+    desc_cfg(h->cfg_desc, p, 1);
+
+    dev = dev_new(&_hub_class, speed, h, h->dev_desc, h->cfg_desc);
+    dev->nports = SIM_HUB_PORTS;
+    return dev;
+}
+
+/**
+  * @brief    Connect a device to a downstream port of a hub.
+  * @param[in]  hub    The hub
+  * @param[in]  port   Port, 1 to SIM_HUB_PORTS
+  * @param[in]  dev    The device
+  */
+void  sim_hub_attach(SIM_DEV_T *hub, int port, SIM_DEV_T *dev)
+{
+    sim_dev_reset(dev);
+    dev->parent = hub;
+    dev->port = port;
+    hub->port_dev[port] = dev;
+    if (hub->port_sts[port] & PORT_S_PORT_POWER)
+    {
+        hub->port_sts[port] |= PORT_S_CONNECTION;
+        hub->port_chg[port] |= PORT_C_CONNECTION;
+    }
+}
+
+/**
+  * @brief    Disconnect the device on a downstream port of a hub.
+  * @param[in]  hub    The hub
+  * @param[in]  port   Port, 1 to SIM_HUB_PORTS
+  */
+void  sim_hub_detach(SIM_DEV_T *hub, int port)
+{
+    hub->port_dev[port] = NULL;
+    if (hub->port_sts[port] & PORT_S_CONNECTION)
+    {
+        hub->port_sts[port] &= ~(PORT_S_CONNECTION | PORT_S_ENABLE | PORT_S_RESET |
+                                 PORT_S_LOW_SPEED | PORT_S_HIGH_SPEED);
+        hub->port_chg[port] |= PORT_C_CONNECTION;
+    }
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Mass storage, bulk-only transport                                                    */
+/*----------------------------------------------------------------------------------------*/
+
+#define MSC_CBW              0              /* waiting for a CBW                          */
+#define MSC_DATA_IN          1
+#define MSC_DATA_OUT         2
+#define MSC_CSW              3
+
+typedef struct
+{
+    uint8_t   dev_desc[18];
+    uint8_t   cfg_desc[32];
+    uint8_t   *image;
+    uint32_t  sectors;
+
+    int       state;
+    uint32_t  tag;
+    uint32_t  residue;                      /* of the data phase                          */
+    uint8_t   status;                       /* CSW status                                 */
+    uint8_t   sense_key;
+    uint8_t   *data;                        /* data phase                                 */
+    uint32_t  data_len;
+    uint32_t  data_pos;
+    uint8_t   resp[36];
+
+    uint32_t  latency_us;                   /* before the data or status of a command     */
+    uint64_t  ready_at;
+    int       stall_read;
+} SIM_MSC_T;
+
+static uint32_t  get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void  put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void  msc_command(SIM_MSC_T *m, const uint8_t *cbw)
+{
+    const uint8_t  *cdb = cbw + 15;
+    uint32_t  dlen = cbw[8] | (cbw[9] << 8) | (cbw[10] << 16) | ((uint32_t)cbw[11] << 24);
+    uint32_t  lba, cnt;
+    int       in = (cbw[12] & 0x80) != 0;
+
+    m->tag = cbw[4] | (cbw[5] << 8) | (cbw[6] << 16) | ((uint32_t)cbw[7] << 24);
+    m->status = 0;
+    m->data = m->resp;
+    m->data_len = 0;
+    m->data_pos = 0;
+    memset(m->resp, 0, sizeof(m->resp));
+
+    switch (cdb[0])
+    {
+    case 0x12:                              /* INQUIRY                                    */
+        m->resp[1] = 0x80;                  /* removable                                  */
+        m->resp[2] = 0x04;
+        m->resp[3] = 0x02;
+        m->resp[4] = 31;
+        memcpy(m->resp + 8, "NUVOTON SIM DISK        1.00", 28);
+        m->data_len = 36;
+        break;
+    case 0x03:                              /* REQUEST SENSE                              */
+        m->resp[0] = 0x70;
+        m->resp[2] = m->sense_key;
+        m->resp[7] = 10;
+        m->data_len = 18;
+        m->sense_key = 0;
+        break;
+    case 0x25:                              /* READ CAPACITY (10)                         */
+        put_be32(m->resp, m->sectors - 1);
+        put_be32(m->resp + 4, 512);
+        m->data_len = 8;
+        break;
+    case 0x1A:                              /* MODE SENSE (6)                             */
+        m->resp[0] = 3;
+        m->data_len = 4;
+        break;
+    case 0x28:                              /* READ (10)                                  */
+    case 0x2A:                              /* WRITE (10)                                 */
+        lba = get_be32(cdb + 2);
+        cnt = (cdb[7] << 8) | cdb[8];
+        if ((lba + cnt > m->sectors) || (cnt * 512 != dlen))
+        {
+            m->status = 1;
+            m->sense_key = 5;               /* ILLEGAL REQUEST                            */
+            break;
+        }
+        m->data = m->image + lba * 512;
+        m->data_len = cnt * 512;
+        break;
+    case 0x00:                              /* TEST UNIT READY                            */
+    case 0x1B:                              /* START STOP UNIT                            */
+    case 0x1E:                              /* PREVENT ALLOW MEDIUM REMOVAL               */
+    case 0x35:                              /* SYNCHRONIZE CACHE                          */
+        break;
+    default:
+        m->status = 1;
+        m->sense_key = 5;
+        break;
+    }
+
+    if (m->data_len > dlen)
+        m->data_len = dlen;
+    m->residue = dlen;
+    if ((dlen == 0) || (m->status != 0))
+        m->state = MSC_CSW;
+    else
+        m->state = in ? MSC_DATA_IN : MSC_DATA_OUT;
+    m->ready_at = sim_time_ns() + m->latency_us * 1000ULL;
+}
+
+static int  msc_ctrl(SIM_DEV_T *dev, const uint8_t *setup, uint8_t *data)
+{
+    SIM_MSC_T  *m = dev->priv;
+
+    if ((setup[0] == (REQ_TYPE_IN | REQ_TYPE_CLASS_DEV | REQ_TYPE_TO_IFACE)) && (setup[1] == 0xFE))
+    {
+        data[0] = 0;                        /* GET MAX LUN                                */
+        return 1;
+    }
+    if ((setup[0] == (REQ_TYPE_OUT | REQ_TYPE_CLASS_DEV | REQ_TYPE_TO_IFACE)) && (setup[1] == 0xFF))
+    {
+        m->state = MSC_CBW;                 /* bulk-only mass storage reset               */
+        return 0;
+    }
+    return SIM_STALL;
+}
+
+static int  msc_xfer(SIM_DEV_T *dev, uint8_t ep_addr, uint8_t *buf, int len)
+{
+    SIM_MSC_T  *m = dev->priv;
+    int        n;
+
+    if (!(ep_addr & 0x80))
+    {
+        if (m->state == MSC_CBW)
+        {
+            if ((len != 31) || (get_be32(buf) != 0x55534243))
+                return SIM_STALL;
+            msc_command(m, buf);
+            return len;
+        }
+        if (m->state != MSC_DATA_OUT)
+            return SIM_STALL;
+        if (sim_time_ns() < m->ready_at)
+            return SIM_NAK;
+        n = (len < m->data_len - m->data_pos) ? len : m->data_len - m->data_pos;
+        memcpy(m->data + m->data_pos, buf, n);
+        m->data_pos += n;
+        m->residue -= len;
+        if (m->data_pos >= m->data_len)
+            m->state = MSC_CSW;
+        return len;
+    }
+
+    if ((m->state == MSC_CBW) || (m->state == MSC_DATA_OUT) || (sim_time_ns() < m->ready_at))
+        return SIM_NAK;
+
+    if (m->state == MSC_DATA_IN)
+    {
+        if (m->stall_read && (m->data != m->resp))
+        {
+            /* a failed read: the data phase is stalled, the CSW tells the rest */
+            m->stall_read = 0;
+            m->status = 1;
+            m->sense_key = 3;               /* MEDIUM ERROR                               */
+            m->state = MSC_CSW;
+            return SIM_STALL;
+        }
+        n = (len < m->data_len - m->data_pos) ? len : m->data_len - m->data_pos;
+        memcpy(buf, m->data + m->data_pos, n);
+        m->data_pos += n;
+        m->residue -= n;
+        if ((m->data_pos >= m->data_len) || (n < len))
+            m->state = MSC_CSW;
+        return n;
+    }
+
+    /* CSW */
+    put_be32(buf, 0x55534253);
+    buf[4] = m->tag;
+    buf[5] = m->tag >> 8;
+    buf[6] = m->tag >> 16;
+    buf[7] = m->tag >> 24;
+    buf[8] = m->residue;
+    buf[9] = m->residue >> 8;
+    buf[10] = m->residue >> 16;
+    buf[11] = m->residue >> 24;
+    buf[12] = m->status;
+    m->state = MSC_CBW;
+    return 13;
+}
+
+static void  msc_event(SIM_DEV_T *dev, int ev, int arg)
+{
+    SIM_MSC_T  *m = dev->priv;
+
+    if ((ev == SIM_EV_RESET) || (ev == SIM_EV_CONFIG))
+        m->state = MSC_CBW;
+}
+
+static const SIM_CLASS_T  _msc_class = { "Mass Storage", msc_ctrl, msc_xfer, msc_event };
+
+/**
+  * @brief    Create a bulk-only SCSI disk of 512 byte sectors.
+  * @param[in]  speed    SIM_SPEED_HIGH or SIM_SPEED_FULL
+  * @param[in]  image    The disk image, read and written by the device
+  * @param[in]  sectors  Size of the image in sectors
+  * @return   The device.
+  */
+SIM_DEV_T * sim_msc_new(int speed, uint8_t *image, uint32_t sectors)
+{
+    SIM_MSC_T  *m = calloc(1, sizeof(*m));
+    uint8_t    *p;
+
+    m->image = image;
+    m->sectors = sectors;
+    desc_dev(m->dev_desc, 0, 0, 64, 0x5002);
+    p = m->cfg_desc + 9;
+    p = desc(p, 9, USB_DT_INTERFACE, 0, 0, 2, USB_CLASS_MASS_STORAGE, 6, 0x50, 0);
+    p = desc_ep(p, 0x81, EP_ATTR_TT_BULK, bulk_mps(speed), 0);
+    p = desc_ep(p, 0x02, EP_ATTR_TT_BULK, bulk_mps(speed), 0);
+    desc_cfg(m->cfg_desc, p, 1);
+    return dev_new(&_msc_class, speed, m, m->dev_desc, m->cfg_desc);
+}
+
+/**
+  * @brief    Set the time the disk takes for a command. The bulk endpoints NAK until then.
+  * @param[in]  dev    The disk
+  * @param[in]  us     Latency in us
+  */
+void  sim_msc_set_latency(SIM_DEV_T *dev, uint32_t us)
+{
+    ((SIM_MSC_T *)dev->priv)->latency_us = us;
+}
+
+/**
+  * @brief    Fail the next READ(10): its data phase is stalled and the CSW reports an error.
+  * @param[in]  dev    The disk
+  */
+void  sim_msc_stall_next_read(SIM_DEV_T *dev)
+{
+    ((SIM_MSC_T *)dev->priv)->stall_read = 1;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   CDC ACM loopback                                                                     */
+/*----------------------------------------------------------------------------------------*/
+
+#define CDC_FIFO_SIZE        4096           /* power of 2                                 */
+
+typedef struct
+{
+    uint8_t   dev_desc[18];
+    uint8_t   cfg_desc[80];
+    uint8_t   line_coding[7];
+    uint8_t   fifo[CDC_FIFO_SIZE];
+    uint32_t  wr, rd;
+} SIM_CDC_T;
+
+static int  cdc_ctrl(SIM_DEV_T *dev, const uint8_t *setup, uint8_t *data)
+{
+    SIM_CDC_T  *c = dev->priv;
+
+    switch (setup[1])
+    {
+    case 0x20:                              /* SET_LINE_CODING                            */
+        memcpy(c->line_coding, data, 7);
+        return 0;
+    case 0x21:                              /* GET_LINE_CODING                            */
+        memcpy(data, c->line_coding, 7);
+        return 7;
+    case 0x22:                              /* SET_CONTROL_LINE_STATE                     */
+        return 0;
+    }
+    return SIM_STALL;
+}
+
+/* What comes in on the bulk OUT endpoint goes out on the bulk IN endpoint */
+static int  cdc_xfer(SIM_DEV_T *dev, uint8_t ep_addr, uint8_t *buf, int len)
+{
+    SIM_CDC_T  *c = dev->priv;
+    int        i;
+
+    if (ep_addr == 0x02)
+    {
+        if (CDC_FIFO_SIZE - (c->wr - c->rd) < len)
+            return SIM_NAK;
+        for (i = 0; i < len; i++)
+            c->fifo[(c->wr + i) & (CDC_FIFO_SIZE - 1)] = buf[i];
+        c->wr += len;
+        return len;
+    }
+    if ((ep_addr != 0x81) || (c->wr == c->rd))
+        return SIM_NAK;                     /* no serial state notifications              */
+    if (len > c->wr - c->rd)
+        len = c->wr - c->rd;
+    for (i = 0; i < len; i++)
+        buf[i] = c->fifo[(c->rd + i) & (CDC_FIFO_SIZE - 1)];
+    c->rd += len;
+    return len;
+}
+
+static void  cdc_event(SIM_DEV_T *dev, int ev, int arg)
+{
+    SIM_CDC_T  *c = dev->priv;
+
+    if (ev == SIM_EV_RESET)
+        c->wr = c->rd = 0;
+}
+
+static const SIM_CLASS_T  _cdc_class = { "CDC Loopback", cdc_ctrl, cdc_xfer, cdc_event };
+
+/**
+  * @brief    Create a CDC ACM device that sends back what it receives.
+  * @param[in]  speed  SIM_SPEED_HIGH or SIM_SPEED_FULL
+  * @return   The device.
+  */
+SIM_DEV_T * sim_cdc_new(int speed)
+{
+    static const uint8_t  line_coding[7] = { 0x00, 0xC2, 0x01, 0x00, 0, 0, 8 };  /* 115200 8N1 */
+    SIM_CDC_T  *c = calloc(1, sizeof(*c));
+    uint8_t    *p;
+
+    memcpy(c->line_coding, line_coding, 7);
+    desc_dev(c->dev_desc, USB_CLASS_COMM, 0, 64, 0x5003);
+    p = c->cfg_desc + 9;
+    p = desc(p, 9, USB_DT_INTERFACE, 0, 0, 1, USB_CLASS_COMM, 2, 1, 0);
+    p = desc(p, 5, 0x24, 0x00, 0x10, 0x01);                         /* header             */
+    p = desc(p, 5, 0x24, 0x01, 0x00, 1);                            /* call management    */
+    p = desc(p, 4, 0x24, 0x02, 0x02);                               /* ACM                */
+    p = desc(p, 5, 0x24, 0x06, 0, 1);                               /* union              */
+    p = desc_ep(p, 0x83, EP_ATTR_TT_INT, 16, (speed == SIM_SPEED_HIGH) ? 8 : 10);
+    p = desc(p, 9, USB_DT_INTERFACE, 1, 0, 2, USB_CLASS_DATA, 0, 0, 0);
+    p = desc_ep(p, 0x81, EP_ATTR_TT_BULK, bulk_mps(speed), 0);
+    p = desc_ep(p, 0x02, EP_ATTR_TT_BULK, bulk_mps(speed), 0);
+    desc_cfg(c->cfg_desc, p, 2);
+    return dev_new(&_cdc_class, speed, c, c->dev_desc, c->cfg_desc);
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   HID boot keyboard                                                                    */
+/*----------------------------------------------------------------------------------------*/
+
+#define HID_QUEUE_SIZE       16
+
+static const uint8_t  _kbd_report_desc[] =
+{
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,             /* Generic Desktop, Keyboard          */
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01,
+    0x75, 0x01, 0x95, 0x08, 0x81, 0x02,             /* modifiers                          */
+    0x95, 0x01, 0x75, 0x08, 0x81, 0x01,             /* reserved                           */
+    0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02,    /* LEDs   */
+    0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+    0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65,
+    0x05, 0x07, 0x19, 0x00, 0x29, 0x65, 0x81, 0x00, /* key codes                          */
+    0xC0
+};
+
+typedef struct
+{
+    uint8_t   dev_desc[18];
+    uint8_t   cfg_desc[40];
+    uint8_t   report[HID_QUEUE_SIZE][8];
+    uint32_t  wr, rd;
+    uint8_t   last[8];
+    uint8_t   idle;
+    uint8_t   protocol;
+    uint8_t   leds;
+} SIM_HID_T;
+
+static int  hid_ctrl(SIM_DEV_T *dev, const uint8_t *setup, uint8_t *data)
+{
+    SIM_HID_T  *h = dev->priv;
+
+    if ((setup[0] & 0x60) == USB_DT_STANDARD)
+    {
+        if ((setup[1] != USB_REQ_GET_DESCRIPTOR) || ((setup[0] & 0x1F) != REQ_TYPE_TO_IFACE))
+            return SIM_STALL;
+        if (setup[3] == 0x22)
+        {
+            memcpy(data, _kbd_report_desc, sizeof(_kbd_report_desc));
+            return sizeof(_kbd_report_desc);
+        }
+        if (setup[3] == 0x21)
+        {
+            memcpy(data, h->cfg_desc + 18, 9);
+            return 9;
+        }
+        return SIM_STALL;
+    }
+
+    switch (setup[1])
+    {
+    case 0x01:                              /* GET_REPORT                                 */
+        memcpy(data, h->last, 8);
+        return 8;
+    case 0x02:                              /* GET_IDLE                                   */
+        data[0] = h->idle;
+        return 1;
+    case 0x03:                              /* GET_PROTOCOL                               */
+        data[0] = h->protocol;
+        return 1;
+    case 0x09:                              /* SET_REPORT, the LEDs                       */
+        h->leds = data[0];
+        return 0;
+    case 0x0A:                              /* SET_IDLE                                   */
+        h->idle = setup[3];
+        return 0;
+    case 0x0B:                              /* SET_PROTOCOL                               */
+        h->protocol = setup[2];
+        return 0;
+    }
+    return SIM_STALL;
+}
+
+/* The reports queued by sim_hid_report(), NAK if there is none */
+static int  hid_xfer(SIM_DEV_T *dev, uint8_t ep_addr, uint8_t *buf, int len)
+{
+    SIM_HID_T  *h = dev->priv;
+
+    if (h->wr == h->rd)
+        return SIM_NAK;
+    if (len > 8)
+        len = 8;
+    memcpy(h->last, h->report[h->rd % HID_QUEUE_SIZE], 8);
+    memcpy(buf, h->last, len);
+    h->rd++;
+    return len;
+}
+
+static void  hid_event(SIM_DEV_T *dev, int ev, int arg)
+{
+    SIM_HID_T  *h = dev->priv;
+
+    if (ev == SIM_EV_RESET)
+    {
+        h->wr = h->rd = 0;
+        h->protocol = 1;
+    }
+}
+
+static const SIM_CLASS_T  _hid_class = { "Keyboard", hid_ctrl, hid_xfer, hid_event };
+
+/**
+  * @brief    Create a boot protocol keyboard.
+  * @param[in]  speed  SIM_SPEED_FULL or SIM_SPEED_LOW
+  * @return   The device.
+  */
+SIM_DEV_T * sim_hid_new(int speed)
+{
+    SIM_HID_T  *h = calloc(1, sizeof(*h));
+    uint8_t    *p;
+
+    desc_dev(h->dev_desc, 0, 0, (speed == SIM_SPEED_LOW) ? 8 : 64, 0x5004);
+    p = h->cfg_desc + 9;
+    p = desc(p, 9, USB_DT_INTERFACE, 0, 0, 1, USB_CLASS_HID, 1, 1, 0);
+    p = desc(p, 9, 0x21, 0x11, 0x01, 0, 1, 0x22, sizeof(_kbd_report_desc), 0);
+    p = desc_ep(p, 0x81, EP_ATTR_TT_INT, 8, 10);
+    desc_cfg(h->cfg_desc, p, 1);
+    return dev_new(&_hid_class, speed, h, h->dev_desc, h->cfg_desc);
+}
+
+/**
+  * @brief    Queue an input report of the keyboard.
+  * @param[in]  dev     The keyboard
+  * @param[in]  report  8 byte boot report
+  * @return   0, or -1 if the queue is full.
+  */
+int  sim_hid_report(SIM_DEV_T *dev, const uint8_t *report)
+{
+    SIM_HID_T  *h = dev->priv;
+
+    if (h->wr - h->rd >= HID_QUEUE_SIZE)
+        return -1;
+    memcpy(h->report[h->wr % HID_QUEUE_SIZE], report, 8);
+    h->wr++;
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   USB audio, microphone and speaker                                                    */
+/*----------------------------------------------------------------------------------------*/
+
+/*
+ *  48 kHz 16-bit stereo in both directions. The microphone sends the sample frames
+ *  (n, ~n) with n counting up, the speaker checks that it receives such a sequence and
+ *  counts the frames that break it.
+ */
+#define UAC_FRAMES_PER_MS    48
+#define UAC_MPS              200            /* 48 frames and one more for rate adjustment */
+
+typedef struct
+{
+    uint8_t   dev_desc[18];
+    uint8_t   cfg_desc[256];
+    uint8_t   cur[16][4];                   /* SET_CUR values by control selector         */
+    uint16_t  mic_seq;
+    uint16_t  spk_seq;
+    int       spk_sync;
+    uint32_t  in_bytes;
+    uint32_t  out_bytes;
+    uint32_t  out_errors;
+} SIM_UAC_T;
+
+static int  uac_ctrl(SIM_DEV_T *dev, const uint8_t *setup, uint8_t *data)
+{
+    SIM_UAC_T  *u = dev->priv;
+    int        cs = setup[3] & 0xF;
+    int        len = setup[6];
+    uint32_t   v;
+
+    if ((setup[0] & 0x60) != REQ_TYPE_CLASS_DEV)
+        return SIM_STALL;
+    if (len > 4)
+        len = 4;
+    if (!(setup[0] & REQ_TYPE_IN))
+    {
+        memcpy(u->cur[cs], data, len);      /* SET_CUR and the others                     */
+        return 0;
+    }
+    switch (setup[1])
+    {
+    case 0x82:                              /* GET_MIN                                    */
+        v = 0xE000;
+        break;
+    case 0x83:                              /* GET_MAX                                    */
+        v = 0x0000;
+        break;
+    case 0x84:                              /* GET_RES                                    */
+        v = 0x0100;
+        break;
+    default:                                /* GET_CUR                                    */
+        memcpy(data, u->cur[cs], len);
+        return len;
+    }
+    memcpy(data, &v, len);
+    return len;
+}
+
+static int  uac_xfer(SIM_DEV_T *dev, uint8_t ep_addr, uint8_t *buf, int len)
+{
+    SIM_UAC_T  *u = dev->priv;
+    uint16_t   *s = (uint16_t *)buf;
+    int        i, n;
+
+    if (ep_addr == 0x81)
+    {
+        if (dev->alt[1] == 0)
+            return SIM_NAK;
+        n = (len / 4 < UAC_FRAMES_PER_MS) ? len / 4 : UAC_FRAMES_PER_MS;
+        for (i = 0; i < n; i++, u->mic_seq++)
+        {
+            s[i * 2] = u->mic_seq;
+            s[i * 2 + 1] = ~u->mic_seq;
+        }
+        u->in_bytes += n * 4;
+        return n * 4;
+    }
+
+    if (dev->alt[2] == 0)
+        return SIM_NAK;
+    for (i = 0; i < len / 4; i++)
+    {
+        if (!u->spk_sync)
+        {
+            u->spk_seq = s[i * 2];
+            u->spk_sync = 1;
+        }
+        if ((s[i * 2] != u->spk_seq) || (s[i * 2 + 1] != (uint16_t)~u->spk_seq))
+        {
+            u->out_errors++;
+            u->spk_seq = s[i * 2];
+        }
+        u->spk_seq++;
+    }
+    u->out_bytes += len;
+    return len;
+}
+
+static void  uac_event(SIM_DEV_T *dev, int ev, int arg)
+{
+    SIM_UAC_T  *u = dev->priv;
+
+    if ((ev == SIM_EV_RESET) || ((ev == SIM_EV_ALT) && (arg == 2)))
+        u->spk_sync = 0;
+}
+
+static const SIM_CLASS_T  _uac_class = { "Audio", uac_ctrl, uac_xfer, uac_event };
+
+/* An audio streaming interface, alternate setting 0 without and 1 with the endpoint */
+static uint8_t * uac_as_iface(uint8_t *p, int ifnum, int link, uint8_t ep_addr, uint8_t attr, int speed)
+{
+    p = desc(p, 9, USB_DT_INTERFACE, ifnum, 0, 0, USB_CLASS_AUDIO, 2, 0, 0);
+    p = desc(p, 9, USB_DT_INTERFACE, ifnum, 1, 1, USB_CLASS_AUDIO, 2, 0, 0);
+    p = desc(p, 7, 0x24, 0x01, link, 1, 0x01, 0x00);                   /* AS_GENERAL, PCM */
+    p = desc(p, 11, 0x24, 0x02, 1, 2, 2, 16, 1, 0x80, 0xBB, 0x00);      /* 48000 Hz        */
+    /* the drivers take bInterval as a number of (micro)frames */
+    p = desc(p, 9, USB_DT_ENDPOINT, ep_addr, attr, UAC_MPS & 0xFF, UAC_MPS >> 8,
+             (speed == SIM_SPEED_HIGH) ? 8 : 1, 0, 0);
+    p = desc(p, 7, 0x25, 0x01, 0x01, 0, 0, 0);
+    return p;
+}
+
+/**
+  * @brief    Create a USB audio device with a microphone and a speaker.
+  * @param[in]  speed  SIM_SPEED_HIGH or SIM_SPEED_FULL. The controller models do not
+  *                     run full speed isochronous transfers through a high speed hub.
+  * @return   The device.
+  */
+SIM_DEV_T * sim_uac_new(int speed)
+{
+    SIM_UAC_T  *u = calloc(1, sizeof(*u));
+    uint8_t    *p, *ac;
+
+    u->cur[1][0] = 0x80;                    /* sampling frequency control, 48000 Hz       */
+    u->cur[1][1] = 0xBB;
+    desc_dev(u->dev_desc, 0, 0, 64, 0x5005);
+    p = u->cfg_desc + 9;
+    p = desc(p, 9, USB_DT_INTERFACE, 0, 0, 0, USB_CLASS_AUDIO, 1, 0, 0);
+    ac = p;
+    p = desc(p, 10, 0x24, 0x01, 0x00, 0x01, 0, 0, 2, 1, 2);             /* header          */
+    p = desc(p, 12, 0x24, 0x02, 1, 0x01, 0x02, 0, 2, 0x03, 0x00, 0, 0); /* microphone IT   */
+    p = desc(p, 10, 0x24, 0x06, 2, 1, 1, 0x03, 0x00, 0x00, 0);          /* feature unit    */
+    p = desc(p, 9, 0x24, 0x03, 3, 0x01, 0x01, 0, 2, 0);                 /* USB streaming OT */
+    p = desc(p, 12, 0x24, 0x02, 4, 0x01, 0x01, 0, 2, 0x03, 0x00, 0, 0); /* USB streaming IT */
+    p = desc(p, 10, 0x24, 0x06, 5, 4, 1, 0x03, 0x00, 0x00, 0);          /* feature unit    */
+    p = desc(p, 9, 0x24, 0x03, 6, 0x01, 0x03, 0, 5, 0);                 /* speaker OT      */
+    ac[5] = (p - ac) & 0xFF;
+    ac[6] = (p - ac) >> 8;
+    p = uac_as_iface(p, 1, 3, 0x81, EP_ATTR_TT_ISO | 0x04, speed);      /* asynchronous    */
+    p = uac_as_iface(p, 2, 4, 0x02, EP_ATTR_TT_ISO | 0x08, speed);      /* adaptive        */
+    desc_cfg(u->cfg_desc, p, 3);
+    return dev_new(&_uac_class, speed, u, u->dev_desc, u->cfg_desc);
+}
+
+/**
+  * @brief    Get the audio counters of a device.
+  * @param[in]  dev         The device
+  * @param[out] in_bytes    Bytes sent by the microphone
+  * @param[out] out_bytes   Bytes received by the speaker
+  * @param[out] out_errors  Sample frames the speaker received out of sequence
+  */
+void  sim_uac_stat(SIM_DEV_T *dev, uint32_t *in_bytes, uint32_t *out_bytes, uint32_t *out_errors)
+{
+    SIM_UAC_T  *u = dev->priv;
+
+    *in_bytes = u->in_bytes;
+    *out_bytes = u->out_bytes;
+    *out_errors = u->out_errors;
+}
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
@@ -0,0 +1,598 @@
+/**************************************************************************//**
+ * @file     sim_test.c
+ * @version  V1.00
+ * @brief    Host test of the USB Host library on the simulated EHCI and OHCI
+ *           controllers of usbh_sim.c.
+ *
+ *           The first topology is a high speed hub on root port 1 with a high
+ *           speed disk, a high speed CDC loopback, a full speed keyboard behind
+ *           the transaction translator and a high speed audio device, and a
+ *           full speed audio device on root port 2. The test times the
+ *           enumeration, moves data through FatFs and the raw sector calls,
+ *           adds command latency and a failed read to the disk, loops data
+ *           through the CDC rings, reads keyboard reports and streams audio
+ *           both ways on both audio devices. Then the hub is unplugged and a
+ *           full speed hub with a full speed CDC loopback and a low speed
+ *           keyboard is plugged in, which EHCI hands over to OHCI. The
+ *           transfer statistics and the bus use of each part are printed.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_cdc.h"
+#include "usbh_hid.h"
+#include "usbh_uac.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_sim.h"
+
+#if !ENABLE_USB_TRACE
+#error "build with -DENABLE_USB_TRACE=1"
+#endif
+
+#define DISK_SECT           65536       /* 32 MB FAT16 volume                         */
+#define FAT_SECT            64
+#define ROOT_ENTRIES        512
+#define CLUSTER_SECT        4
+#define DISK_DRV            3           /* first FatFs drive of the mass storage driver */
+
+#define RAW_SIZE            (2 * 1024 * 1024)
+#define RAW_SECT            64          /* sectors per usbh_umas_read()/write()       */
+#define FILE_SIZE           (256 * 1024)
+#define CDC_SIZE            (256 * 1024)
+#define CDC_FS_SIZE         (32 * 1024)
+#define AUDIO_MS            1000
+#define AUDIO_RING          (8192 + 8 * 200)    /* and a guard of 8 packets           */
+
+static uint8_t     *_image;
+static uint8_t     _buff[RAW_SECT * 512];
+static uint8_t     _buff2[RAW_SECT * 512];
+static int         ret;
+
+static uint8_t     _hid_rx[32][8];
+static volatile int _hid_cnt;
+
+
+/*--------------------------------------------------------------------------*/
+/*   FatFs disk I/O                                                         */
+/*--------------------------------------------------------------------------*/
+DSTATUS disk_status(BYTE pdrv)
+{
+    return usbh_umas_disk_status(pdrv) ? STA_NODISK : 0;
+}
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return disk_status(pdrv);
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    return usbh_umas_read(pdrv, sector, count, buff) ? RES_ERROR : RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    return usbh_umas_write(pdrv, sector, count, (uint8_t *)buff) ? RES_ERROR : RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    return usbh_umas_ioctl(pdrv, cmd, buff) ? RES_ERROR : RES_OK;
+}
+
+DWORD get_fattime(void)
+{
+    return ((DWORD)(2019 - 1980) << 25) | (1UL << 21) | (1UL << 16);
+}
+
+static void format_fat16(uint8_t *img)
+{
+    uint8_t  *bs = img;
+    int      i;
+
+    memset(img, 0, DISK_SECT * 512);
+    memcpy(bs, "\xEB\x3C\x90" "NUVOTON ", 11);
+    bs[11] = 0x00;                          /* 512 bytes per sector                       */
+    bs[12] = 0x02;
+    bs[13] = CLUSTER_SECT;
+    bs[14] = 1;                             /* reserved sectors                           */
+    bs[16] = 2;                             /* number of FATs                             */
+    bs[17] = ROOT_ENTRIES & 0xFF;
+    bs[18] = ROOT_ENTRIES >> 8;
+    bs[21] = 0xF8;                          /* media                                      */
+    bs[22] = FAT_SECT;
+    bs[24] = 63;
+    bs[26] = 255;
+    bs[32] = DISK_SECT & 0xFF;              /* total sectors (32-bit)                     */
+    bs[33] = (DISK_SECT >> 8) & 0xFF;
+    bs[34] = (DISK_SECT >> 16) & 0xFF;
+    bs[35] = (DISK_SECT >> 24) & 0xFF;
+    bs[36] = 0x80;
+    bs[38] = 0x29;
+    memcpy(bs + 43, "NO NAME    FAT16   ", 19);
+    bs[510] = 0x55;
+    bs[511] = 0xAA;
+
+    for (i = 0; i < 2; i++)
+        memcpy(img + (1 + i * FAT_SECT) * 512, "\xF8\xFF\xFF\xFF", 4);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Helpers                                                                */
+/*--------------------------------------------------------------------------*/
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static uint8_t stream_byte(uint32_t pos)
+{
+    return (uint8_t)((pos * 7) ^ (pos >> 8) ^ (pos >> 16));
+}
+
+static double ms_since(uint64_t t0)
+{
+    return (sim_time_ns() - t0) / 1e6;
+}
+
+static double mbps(uint32_t bytes, uint64_t t0)
+{
+    return bytes / ((sim_time_ns() - t0) / 1e9) / (1024 * 1024);
+}
+
+/* Let the hub thread and the controllers run for <ms> */
+static void run_ms(int ms)
+{
+    while (ms-- > 0)
+    {
+        usbh_pooling_hubs();
+        delay_us(1000);
+    }
+}
+
+static int uac_count(void)
+{
+    UAC_DEV_T  *uac;
+    int        n = 0;
+
+    for (uac = usbh_uac_get_device_list(); uac != NULL; uac = uac->next)
+        n++;
+    return n;
+}
+
+static int phase1_ready(void)
+{
+    return (usbh_umas_disk_status(DISK_DRV) == 0) && (usbh_cdc_get_device_list() != NULL) &&
+           (usbh_hid_get_device_list() != NULL) && (uac_count() == 2);
+}
+
+static int phase2_ready(void)
+{
+    return (usbh_cdc_get_device_list() != NULL) && (usbh_hid_get_device_list() != NULL);
+}
+
+static int gone(void)
+{
+    return (usbh_umas_disk_status(DISK_DRV) != 0) &&
+           (usbh_cdc_get_device_list() == NULL) && (usbh_hid_get_device_list() == NULL) &&
+           (uac_count() == 1);
+}
+
+/* Run until cond() holds, at most <ms>. Returns the time it took, or -1. */
+static double wait_for(int (*cond)(void), int ms)
+{
+    uint64_t  t0 = sim_time_ns();
+
+    while (!cond())
+    {
+        if (ms-- <= 0)
+            return -1;
+        run_ms(1);
+    }
+    return ms_since(t0);
+}
+
+static void report(const char *title)
+{
+    USBH_TRACE_EVT_T  evt[64];
+
+    printf("\n%s, %.1f ms simulated\n", title, sim_time_ns() / 1e6);
+    while (usbh_trace_read(evt, 64) > 0)
+        ;                                   /* the statistics only                        */
+    usbh_trace_dump();
+    sim_bus_report();
+    printf("\n");
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Mass storage                                                           */
+/*--------------------------------------------------------------------------*/
+static void test_disk(SIM_DEV_T *msc)
+{
+    FIL       fil;
+    UINT      n;
+    uint64_t  t0;
+    uint32_t  i, sec, pos;
+    double    ms;
+
+    printf("mass storage\n");
+
+    /* raw sectors, past the FAT area */
+    t0 = sim_time_ns();
+    for (sec = 8192, pos = 0; pos < RAW_SIZE; sec += RAW_SECT, pos += sizeof(_buff))
+    {
+        for (i = 0; i < sizeof(_buff); i++)
+            _buff[i] = stream_byte(pos + i);
+        if (usbh_umas_write(DISK_DRV, sec, RAW_SECT, _buff) != 0)
+            break;
+    }
+    printf("  write %u KB: %.2f MB/s\n", RAW_SIZE / 1024, mbps(pos, t0));
+    CHECK(pos == RAW_SIZE, "write at %u", pos);
+    for (i = 0; i < RAW_SIZE; i++)
+    {
+        if (_image[8192 * 512 + i] != stream_byte(i))
+            break;
+    }
+    CHECK(i == RAW_SIZE, "image differs at %u", i);
+
+    memset(_image + 8192 * 512, 0x5A, 64);  /* must be read from the device, not a cache */
+    t0 = sim_time_ns();
+    for (sec = 8192, pos = 0; pos < RAW_SIZE; sec += RAW_SECT, pos += sizeof(_buff))
+    {
+        if (usbh_umas_read(DISK_DRV, sec, RAW_SECT, _buff) != 0)
+            break;
+        if ((pos == 0) && (_buff[0] != 0x5A || _buff[63] != 0x5A))
+            break;
+        for (i = (pos == 0) ? 64 : 0; i < sizeof(_buff); i++)
+        {
+            if (_buff[i] != stream_byte(pos + i))
+                break;
+        }
+        if (i < sizeof(_buff))
+            break;
+    }
+    printf("  read %u KB: %.2f MB/s\n", RAW_SIZE / 1024, mbps(pos, t0));
+    CHECK(pos == RAW_SIZE, "read at %u", pos);
+
+    /* a file through FatFs */
+    CHECK(f_open(&fil, "3:/sim.bin", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK, "f_open write");
+    t0 = sim_time_ns();
+    for (pos = 0; pos < FILE_SIZE; pos += 4000)
+    {
+        for (i = 0; i < 4000; i++)
+            _buff[i] = stream_byte(pos + i + 1);
+        n = (FILE_SIZE - pos < 4000) ? FILE_SIZE - pos : 4000;
+        if ((f_write(&fil, _buff, n, &n) != FR_OK) || (n == 0))
+            break;
+    }
+    CHECK(f_close(&fil) == FR_OK, "f_close");
+    printf("  file write %u KB: %.2f MB/s\n", FILE_SIZE / 1024, mbps(FILE_SIZE, t0));
+
+    CHECK(f_open(&fil, "3:/sim.bin", FA_READ) == FR_OK, "f_open read");
+    t0 = sim_time_ns();
+    for (pos = 0; pos < FILE_SIZE; pos += n)
+    {
+        if ((f_read(&fil, _buff, 4000, &n) != FR_OK) || (n == 0))
+            break;
+        for (i = 0; i < n; i++)
+        {
+            if (_buff[i] != stream_byte(pos + i + 1))
+                break;
+        }
+        if (i < n)
+            break;
+    }
+    f_close(&fil);
+    printf("  file read %u KB: %.2f MB/s\n", FILE_SIZE / 1024, mbps(FILE_SIZE, t0));
+    CHECK(pos == FILE_SIZE, "file data at %u", pos);
+
+    /* command latency */
+    sim_msc_set_latency(msc, 2000);
+    t0 = sim_time_ns();
+    CHECK(usbh_umas_read(DISK_DRV, 20000, RAW_SECT, _buff) == 0, "slow read");
+    ms = ms_since(t0);
+    printf("  read of %u sectors with 2 ms latency: %.2f ms\n", RAW_SECT, ms);
+    CHECK(ms >= 2.0, "latency not seen");
+    sim_msc_set_latency(msc, 0);
+
+    /* a failed read, and the disk still works after it */
+    memcpy(_image + 30000 * 512, "sector 30000", 12);
+    sim_msc_stall_next_read(msc);
+    CHECK(usbh_umas_read(DISK_DRV, 30000, RAW_SECT, _buff) != 0, "stalled read did not fail");
+    CHECK((usbh_umas_read(DISK_DRV, 30000, RAW_SECT, _buff) == 0) && (memcmp(_buff, "sector 30000", 12) == 0),
+          "read after the stall");
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   CDC loopback                                                           */
+/*--------------------------------------------------------------------------*/
+static void test_cdc(uint32_t size)
+{
+    static uint8_t  rx_ring[8192], tx_ring[8192];
+    CDC_DEV_T  *cdev = usbh_cdc_get_device_list();
+    LINE_CODING_T  lc;
+    uint64_t   t0;
+    uint32_t   tx, rx, i;
+    int        n, idle;
+
+    printf("CDC loopback, %s speed\n", (cdev->udev->speed == SPEED_HIGH) ? "high" : "full");
+
+    CHECK(usbh_cdc_get_line_coding(cdev, &lc) == 0, "get line coding");
+    lc.baud = 921600;
+    CHECK(usbh_cdc_set_line_coding(cdev, &lc) == 0, "set line coding");
+    CHECK((usbh_cdc_get_line_coding(cdev, &lc) == 0) && (lc.baud == 921600), "line coding not kept");
+
+    CHECK(usbh_cdc_start_receive_ring(cdev, rx_ring, sizeof(rx_ring)) == 0, "receive ring");
+    CHECK(usbh_cdc_set_send_ring(cdev, tx_ring, sizeof(tx_ring)) == 0, "send ring");
+
+    t0 = sim_time_ns();
+    for (tx = rx = 0, idle = 0; (rx < size) && (idle < 100); )
+    {
+        for (i = 0; (i < 1000) && (tx + i < size); i++)
+            _buff[i] = stream_byte(tx + i);
+        if ((i > 0) && (usbh_cdc_send_data(cdev, _buff, i) == 0))
+            tx += i;
+
+        n = usbh_cdc_read(cdev, _buff2, sizeof(_buff2));
+        for (i = 0; (n > 0) && (i < n); i++)
+        {
+            if (_buff2[i] != stream_byte(rx + i))
+                break;
+        }
+        if ((n > 0) && (i < n))
+        {
+            CHECK(0, "loopback data at %u", rx + i);
+            break;
+        }
+        if (n > 0)
+        {
+            rx += n;
+            idle = 0;
+        }
+        else
+        {
+            idle++;
+            delay_us(100);
+        }
+    }
+    printf("  %u KB looped back: %.2f MB/s\n", rx / 1024, mbps(rx, t0));
+    CHECK(rx == size, "looped back %u of %u", rx, size);
+    usbh_cdc_stop_ring(cdev);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Keyboard                                                               */
+/*--------------------------------------------------------------------------*/
+static void hid_int_read(HID_DEV_T *hdev, uint16_t ep_addr, int status, uint8_t *rdata, uint32_t data_len)
+{
+    if ((status == 0) && (data_len == 8) && (_hid_cnt < 32))
+        memcpy(_hid_rx[_hid_cnt++], rdata, 8);
+}
+
+static void test_hid(SIM_DEV_T *kbd, int num)
+{
+    HID_DEV_T  *hdev = usbh_hid_get_device_list();
+    uint8_t    rpt[8];
+    int        i;
+
+    printf("keyboard, %s speed\n", (((IFACE_T *)hdev->iface)->udev->speed == SPEED_LOW) ? "low" : "full");
+
+    _hid_cnt = 0;
+    CHECK(usbh_hid_start_int_read(hdev, 0, hid_int_read) == 0, "start int read");
+    for (i = 0; i < num; i++)
+    {
+        memset(rpt, 0, 8);
+        rpt[2] = 4 + i;                     /* 'a', 'b', ...                              */
+        sim_hid_report(kbd, rpt);
+        run_ms(15);
+    }
+    run_ms(50);
+    usbh_hid_stop_int_read(hdev, 0);
+    printf("  %d of %d reports\n", _hid_cnt, num);
+    CHECK(_hid_cnt == num, "reports");
+    for (i = 0; i < _hid_cnt; i++)
+        CHECK(_hid_rx[i][2] == 4 + i, "report %d: key %d", i, _hid_rx[i][2]);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Audio                                                                  */
+/*--------------------------------------------------------------------------*/
+typedef struct
+{
+    UAC_DEV_T   *uac;
+    SIM_DEV_T   *dev;
+    UAC_RING_T  in, out;
+    uint8_t     in_buff[AUDIO_RING], out_buff[AUDIO_RING];
+    uint16_t    in_seq, out_seq;
+    int         in_sync;
+    uint32_t    in_bytes, in_errors;
+} AUDIO_T;
+
+static AUDIO_T  _audio[2];
+
+/* Sample frames (n, ~n) into the out ring, as much as fits */
+static void audio_fill(AUDIO_T *a)
+{
+    uint16_t  *s;
+    uint32_t  len, i;
+
+    s = (uint16_t *)usbh_uac_ring_write_ptr(&a->out, &len);
+    len &= ~3;
+    for (i = 0; i < len / 4; i++, a->out_seq++)
+    {
+        s[i * 2] = a->out_seq;
+        s[i * 2 + 1] = ~a->out_seq;
+    }
+    usbh_uac_ring_write_done(&a->out, len);
+}
+
+static void audio_drain(AUDIO_T *a)
+{
+    uint16_t  *s;
+    uint32_t  len, i;
+
+    while (1)
+    {
+        s = (uint16_t *)usbh_uac_ring_read_ptr(&a->in, &len);
+        len &= ~3;
+        if (len == 0)
+            break;
+        for (i = 0; i < len / 4; i++)
+        {
+            if (a->in_sync && ((s[i * 2] != a->in_seq) || (s[i * 2 + 1] != (uint16_t)~s[i * 2])))
+                a->in_errors++;
+            a->in_seq = s[i * 2] + 1;
+            a->in_sync = 1;
+        }
+        a->in_bytes += len;
+        usbh_uac_ring_read_done(&a->in, len);
+    }
+}
+
+static void test_audio(void)
+{
+    AUDIO_T    *a;
+    uint32_t   in_bytes, out_bytes, out_errors;
+    int        i, ms;
+
+    printf("audio\n");
+    for (a = _audio, i = 0; i < 2; i++, a++)
+    {
+        a->in.buff = a->in_buff;
+        a->in.buff_size = AUDIO_RING;
+        a->in.srate = 48000;
+        a->out.buff = a->out_buff;
+        a->out.buff_size = AUDIO_RING;
+        a->out.srate = 48000;
+        CHECK(usbh_uac_open(a->uac) == 0, "open");
+        CHECK(usbh_uac_start_audio_in_ring(a->uac, &a->in) == 0, "start audio in");
+        /* fill the out ring to about half before the start */
+        for (a->out.wr = 0; a->out.wr < 4096; a->out.wr += 4, a->out_seq++)
+        {
+            ((uint16_t *)a->out_buff)[a->out.wr / 2] = a->out_seq;
+            ((uint16_t *)a->out_buff)[a->out.wr / 2 + 1] = ~a->out_seq;
+        }
+        CHECK(usbh_uac_start_audio_out_ring(a->uac, &a->out) == 0, "start audio out");
+    }
+
+    for (ms = 0; ms < AUDIO_MS; ms++)
+    {
+        run_ms(1);
+        for (a = _audio, i = 0; i < 2; i++, a++)
+        {
+            audio_drain(a);
+            if (a->out.wr - a->out.rd < 4096)
+                audio_fill(a);
+        }
+    }
+
+    for (a = _audio, i = 0; i < 2; i++, a++)
+    {
+        usbh_uac_stop_audio_in(a->uac);
+        usbh_uac_stop_audio_out(a->uac);
+        sim_uac_stat(a->dev, &in_bytes, &out_bytes, &out_errors);
+        printf("  %s speed: in %u bytes, %u xrun, %u errors; out %u bytes, %u xrun, %u errors\n",
+               (a->uac->udev->speed == SPEED_HIGH) ? "high" : "full", a->in_bytes, a->in.xrun,
+               a->in_errors, out_bytes, a->out.xrun, out_errors);
+        CHECK((a->in_bytes > AUDIO_MS * 192 * 9 / 10) && (a->in_errors == 0) && (a->in.xrun == 0), "audio in");
+        CHECK((out_bytes > AUDIO_MS * 192 * 9 / 10) && (out_errors == 0), "audio out");
+    }
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Test                                                                   */
+/*--------------------------------------------------------------------------*/
+static void sim_test(void)
+{
+    SIM_DEV_T  *hub, *msc, *cdc, *kbd, *uac_hs, *uac_fs;
+    UAC_DEV_T  *uac;
+    double     ms;
+
+    usbh_core_init();
+    usbh_umas_init();
+    usbh_cdc_init();
+    usbh_hid_init();
+    usbh_uac_init();
+    run_ms(100);
+
+    /* high speed hub with a disk, a CDC loopback, a keyboard and an audio device */
+    hub = sim_hub_new(SIM_SPEED_HIGH);
+    msc = sim_msc_new(SIM_SPEED_HIGH, _image, DISK_SECT);
+    cdc = sim_cdc_new(SIM_SPEED_HIGH);
+    kbd = sim_hid_new(SIM_SPEED_FULL);
+    uac_hs = sim_uac_new(SIM_SPEED_HIGH);
+    uac_fs = sim_uac_new(SIM_SPEED_FULL);
+    sim_hub_attach(hub, 1, msc);
+    sim_hub_attach(hub, 2, cdc);
+    sim_hub_attach(hub, 3, kbd);
+    sim_hub_attach(hub, 4, uac_hs);
+    sim_bus_reset_stats();
+    usbh_trace_reset();
+    sim_attach(1, hub);
+    sim_attach(2, uac_fs);
+
+    ms = wait_for(phase1_ready, 5000);
+    printf("enumeration of 6 devices: %.1f ms\n", ms);
+    CHECK(ms >= 0, "devices not found");
+    if (ms < 0)
+        return;
+
+    for (uac = usbh_uac_get_device_list(); uac != NULL; uac = uac->next)
+    {
+        _audio[uac->udev->speed != SPEED_HIGH].uac = uac;
+        _audio[uac->udev->speed != SPEED_HIGH].dev = (uac->udev->speed == SPEED_HIGH) ? uac_hs : uac_fs;
+    }
+
+    test_disk(msc);
+    test_cdc(CDC_SIZE);
+    test_hid(kbd, 10);
+    test_audio();
+    report("high speed hub and full speed audio");
+
+    /* unplug the hub, plug a full speed hub with a CDC loopback and a low speed keyboard */
+    sim_detach(1);
+    ms = wait_for(gone, 1000);
+    printf("disconnect: %.1f ms\n", ms);
+    CHECK(ms >= 0, "devices not removed");
+
+    hub = sim_hub_new(SIM_SPEED_FULL);
+    cdc = sim_cdc_new(SIM_SPEED_FULL);
+    kbd = sim_hid_new(SIM_SPEED_LOW);
+    sim_hub_attach(hub, 1, cdc);
+    sim_hub_attach(hub, 4, kbd);
+    sim_bus_reset_stats();
+    usbh_trace_reset();
+    sim_attach(1, hub);
+
+    ms = wait_for(phase2_ready, 5000);
+    printf("enumeration of 3 devices behind OHCI: %.1f ms\n", ms);
+    CHECK(ms >= 0, "devices not found");
+    if (ms < 0)
+        return;
+
+    test_cdc(CDC_FS_SIZE);
+    test_hid(kbd, 4);
+    report("full speed hub");
+}
+
+int main(void)
+{
+    _image = malloc(DISK_SECT * 512);
+    format_fat16(_image);
+
+    if (sim_run(sim_test) < 0)
+        return 1;
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
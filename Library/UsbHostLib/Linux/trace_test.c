@@ -0,0 +1,177 @@
+/**************************************************************************//**
+ * @file     trace_test.c
+ * @version  V1.00
+ * @brief    Host test of the transfer trace of usb_trace.c.
+ *
+ *           Transfers are submitted and completed through the same hooks
+ *           usb_core.c and the host controller drivers call, with the DWT
+ *           cycle counter of NuMicro.h set by the test. The test checks the endpoint statistics
+ *           and histograms, the slot lookup when an endpoint moves or a
+ *           device reconnects, and the order and overflow of the trace
+ *           ring, then times a submit and done pair.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "usbh_lib.h"
+
+#if !ENABLE_USB_TRACE
+#error "build with -DENABLE_USB_TRACE=1"
+#endif
+
+static UDEV_T     _udev;
+static EP_INFO_T  _ep_in, _ep_out;
+
+static void  setup_dev(UDEV_T *udev, int dev_num)
+{
+    memset(udev, 0, sizeof(*udev));
+    udev->dev_num = dev_num;
+}
+
+static void  setup_ep(EP_INFO_T *ep, uint8_t addr, uint8_t attr, uint8_t garbage)
+{
+    memset(ep, 0, sizeof(*ep));
+    ep->bEndpointAddress = addr;
+    ep->bmAttributes = attr;
+    ep->wMaxPacketSize = 512;
+    ep->trace_idx = garbage;            /* not cleared by whoever allocated it        */
+}
+
+/* One transfer of <len> bytes that <got> bytes came back for, <us> after it was submitted */
+static void  xfer(UDEV_T *udev, EP_INFO_T *ep, uint32_t len, uint32_t got, uint32_t us, int retry, int status)
+{
+    UTR_T   utr;
+
+    memset(&utr, 0, sizeof(utr));
+    utr.udev = udev;
+    utr.ep = ep;
+    utr.data_len = len;
+    USB_TRACE_SUBMIT(&utr, ep);
+    DWT->CYCCNT += us * 192;               /* SystemCoreClock is 192 MHz                 */
+    utr.xfer_len = got;
+    USB_TRACE_RETRY(&utr, retry);
+    USB_TRACE_DONE(&utr, status);
+}
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+int main(void)
+{
+    USBH_TRACE_EP_T   *st;
+    USBH_TRACE_EVT_T  evt[USB_TRACE_RING_SIZE + 8];
+    UDEV_T            udev2;
+    EP_INFO_T         ep_moved;
+    struct timespec   t0, t1;
+    uint32_t          i, n;
+    double            ns;
+    int               ret = 0;
+
+    usbh_trace_reset();
+    setup_dev(&_udev, 3);
+    setup_ep(&_ep_in, 0x81, EP_ATTR_TT_BULK, 0);        /* 0 would be a valid slot     */
+    setup_ep(&_ep_out, 0x02, EP_ATTR_TT_BULK, 0xA5);
+
+    /* statistics */
+    printf("endpoint statistics\n");
+    for (i = 0; i < 100; i++)
+        xfer(&_udev, &_ep_in, 512, 512, 1 + i, 0, 0);       /* 1..100 us                  */
+    xfer(&_udev, &_ep_in, 512, 13, 5000, 0, 0);             /* short                      */
+    xfer(&_udev, &_ep_in, 512, 0, 1000000, 3, USBH_ERR_TRANSACTION);
+    xfer(&_udev, &_ep_in, 512, 0, 7, 0, USBH_ERR_ABORT);
+    xfer(&_udev, &_ep_out, 64, 64, 2, 1, 0);
+    xfer(&_udev, &_udev.ep0, 18, 18, 300, 0, 0);
+    xfer(&_udev, &_udev.ep0, 8, 0, 1000000, 0, USBH_ERR_TIMEOUT);
+
+    st = usbh_trace_get_ep(0);
+    CHECK((st != NULL) && (st->dev_num == 3) && (st->ep_addr == 0x81) && (st->ep_type == EP_ATTR_TT_BULK), "slot 0");
+    CHECK(st->xfers == 103, "xfers %u", st->xfers);
+    CHECK(st->bytes == 100 * 512 + 13, "bytes %u", st->bytes);
+    CHECK((st->short_xfers == 1) && (st->halts == 1) && (st->aborts == 1) && (st->retries == 3),
+          "short %u, halts %u, aborts %u, retries %u", st->short_xfers, st->halts, st->aborts, st->retries);
+    CHECK(st->lat_max == 1000000 * 192, "lat_max %u", st->lat_max);
+
+    /* unit 128 ticks = 2/3 us: 1 us in [1], 2 us in [2], 3..5 us in [3], 6..10 us in [4] ... */
+    CHECK((st->lat_hist[0] == 0) && (st->lat_hist[1] == 1) && (st->lat_hist[2] == 1) &&
+          (st->lat_hist[3] == 3) && (st->lat_hist[4] == 6) && (st->lat_hist[5] == 11), "latency histogram");
+    CHECK(st->lat_hist[USBH_TRACE_HIST_NUM - 1] == 1, "latency histogram top %u", st->lat_hist[USBH_TRACE_HIST_NUM - 1]);
+    for (i = 0, n = 0; i < USBH_TRACE_HIST_NUM; i++)
+        n += st->lat_hist[i];
+    CHECK(n == st->xfers, "latency histogram sum %u", n);
+    CHECK((st->size_hist[0] == 2) && (st->size_hist[4] == 1) && (st->size_hist[10] == 100), "size histogram");
+
+    st = usbh_trace_get_ep(1);
+    CHECK((st != NULL) && (st->ep_addr == 0x02) && (st->xfers == 1) && (st->retries == 1), "slot 1");
+    st = usbh_trace_get_ep(2);
+    CHECK((st != NULL) && (st->ep_addr == 0) && (st->ep_type == EP_ATTR_TT_CTRL) && (st->aborts == 1), "control");
+    CHECK(usbh_trace_get_ep(3) == NULL, "slot 3 in use");
+
+    /* an EP_INFO_T moved, as by usbh_set_interface(), and a device reconnected */
+    setup_ep(&ep_moved, 0x81, EP_ATTR_TT_BULK, 1);          /* hint points to 0x02        */
+    xfer(&_udev, &ep_moved, 512, 512, 1, 0, 0);
+    setup_dev(&udev2, 3);
+    setup_ep(&_ep_out, 0x02, EP_ATTR_TT_BULK, 0);
+    xfer(&udev2, &_ep_out, 64, 64, 1, 0, 0);
+    CHECK((usbh_trace_get_ep(0)->xfers == 104) && (usbh_trace_get_ep(1)->xfers == 2) &&
+          (usbh_trace_get_ep(3) == NULL), "endpoint not found again");
+
+    /* the table runs full: the others are logged only */
+    setup_dev(&udev2, 9);
+    for (i = 0; i < USB_TRACE_EP_NUM; i++)
+    {
+        setup_ep(&ep_moved, 0x81 + i, EP_ATTR_TT_INT, 0);
+        xfer(&udev2, &ep_moved, 8, 8, 1, 0, 0);
+    }
+    CHECK((usbh_trace_get_ep(USB_TRACE_EP_NUM - 1) != NULL) && (usbh_trace_get_ep(USB_TRACE_EP_NUM) == NULL), "table full");
+
+    usbh_trace_dump();
+
+    /* trace ring */
+    printf("trace ring\n");
+    usbh_trace_reset();
+    DWT->CYCCNT = 1000;
+    xfer(&_udev, &_ep_in, 512, 100, 10, 2, 0);
+    n = usbh_trace_read(evt, 8);
+    CHECK(n == 2, "%u events", n);
+    CHECK((evt[0].type == USBH_TRACE_SUBMIT) && (evt[0].time == 1000) && (evt[0].len == 512) &&
+          (evt[0].dev_num == 3) && (evt[0].ep_addr == 0x81), "submit event");
+    CHECK((evt[1].type == USBH_TRACE_DONE) && (evt[1].time == 1000 + 10 * 192) && (evt[1].len == 100) &&
+          (evt[1].retries == 2) && (evt[1].status == 0), "done event");
+
+    for (i = 0; i < USB_TRACE_RING_SIZE; i++)
+        xfer(&_udev, &_ep_in, i, i, 1, 0, 0);
+    n = usbh_trace_read(evt, USB_TRACE_RING_SIZE + 8);
+    printf("  %u events read, %u lost\n", n, usbh_trace_lost());
+    CHECK((n == USB_TRACE_RING_SIZE) && (usbh_trace_lost() == USB_TRACE_RING_SIZE), "overflow");
+    for (i = 0; i < n; i++)
+    {
+        if ((evt[i].len != i / 2) || (evt[i].type != ((i & 1) ? USBH_TRACE_DONE : USBH_TRACE_SUBMIT)))
+            break;
+    }
+    CHECK(i == n, "event %u out of order", i);
+    xfer(&_udev, &_ep_in, 7, 7, 1, 0, 0);
+    CHECK((usbh_trace_read(evt, 8) == 2) && (evt[0].len == 7), "logging after overflow");
+
+    /* cost of a submit and done pair, the ring read as it fills */
+    usbh_trace_reset();
+    n = 1000000;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < n; i++)
+    {
+        xfer(&_udev, &_ep_in, 512, 512, 1, 0, 0);
+        if ((i & 63) == 63)
+            usbh_trace_read(evt, 128);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+    printf("  submit + done + read: %.1f ns per transfer, %u lost\n", ns, usbh_trace_lost());
+    CHECK((usbh_trace_lost() == 0) && (usbh_trace_get_ep(0)->xfers == n), "trace lost transfers");
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
@@ -0,0 +1,363 @@
+/**************************************************************************//**
+ * @file     uac_ring_test.c
+ * @version  V1.00
+ * @brief    Host test of the ring buffer streaming of uac_ring.c on a
+ *           simulated audio device.
+ *
+ *           usbh_iso_xfer() queues the UTRs of the stream, and the
+ *           simulated device completes the oldest one every 8 packet
+ *           intervals. A producer fills the audio out ring at a clock
+ *           slightly off the USB clock, the test checks that every byte
+ *           sent is the next byte of the stream and that the packet size
+ *           adjustment holds the ring level between the watermarks. For
+ *           audio in it checks the data read from the ring and the
+ *           overrun count when the ring is not read.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_uac.h"
+#include "../src_uac/uac.h"
+
+#define SRATE               48000
+#define FRAME_SIZE          4           /* 16-bit stereo                              */
+#define EP_MPS              64
+#define RING_SIZE           (4096 + EP_MPS * IF_PER_UTR)
+
+
+/*--------------------------------------------------------------------------*/
+/*   Simulated audio device                                                 */
+/*--------------------------------------------------------------------------*/
+static UDEV_T     _udev;
+static IFACE_T    _iface_in, _iface_out;
+static DESC_IF_T  _ifd;
+static AS_FT1_T   _ft;
+static UAC_DEV_T  _uac;
+
+static UTR_T      *_queue[8];           /* isochronous transfers queued               */
+static int        _queue_n;
+static uint32_t   _dev_pos;             /* stream byte the device expects or sends next */
+static int        _data_err, _pkt_max, _pkt_min;
+static uint32_t   _rand = 1;
+
+static uint32_t sim_rand(void)
+{
+    _rand = _rand * 1103515245 + 12345;
+    return (_rand >> 16) & 0x7FFF;
+}
+
+static uint8_t stream_byte(uint32_t pos)
+{
+    return (uint8_t)((pos * 7) ^ (pos >> 8));
+}
+
+/* Complete the oldest transfer, as the device would after 8 packet intervals */
+static void sim_interrupt(void)
+{
+    UTR_T    *utr;
+    uint32_t n;
+    int      i, j;
+
+    if (_queue_n == 0)
+        return;
+    utr = _queue[0];
+    _queue_n--;
+    memmove(_queue, _queue + 1, _queue_n * sizeof(_queue[0]));
+
+    for (i = 0; i < IF_PER_UTR; i++)
+    {
+        if (utr->ep->bEndpointAddress & EP_ADDR_DIR_IN)
+        {
+            /* 11 or 13 sample frames per 2 packets, about 48 kHz at 8000 packets/s */
+            n = ((sim_rand() & 1) ? 7 : 5) * FRAME_SIZE;
+            for (j = 0; j < n; j++)
+                utr->iso_buff[i][j] = stream_byte(_dev_pos++);
+        }
+        else
+        {
+            n = utr->iso_xlen[i];
+            for (j = 0; j < n; j++)
+            {
+                if (utr->iso_buff[i][j] != stream_byte(_dev_pos++))
+                    _data_err++;
+            }
+            if (n > _pkt_max)
+                _pkt_max = n;
+            if (n < _pkt_min)
+                _pkt_min = n;
+        }
+        utr->iso_xlen[i] = n;
+        utr->iso_status[i] = 0;
+    }
+    utr->func(utr);
+}
+
+int usbh_iso_xfer(UTR_T *utr)
+{
+    _queue[_queue_n++] = utr;
+    return 0;
+}
+
+int usbh_quit_utr(UTR_T *utr)
+{
+    int   i;
+
+    for (i = 0; i < _queue_n; i++)
+    {
+        if (_queue[i] == utr)
+        {
+            _queue_n--;
+            memmove(_queue + i, _queue + i + 1, (_queue_n - i) * sizeof(_queue[0]));
+            break;
+        }
+    }
+    return 0;
+}
+
+int usbh_set_interface(IFACE_T *iface, uint16_t alt_setting)
+{
+    iface->aif = &iface->alt[alt_setting];
+    return 0;
+}
+
+int usbh_ctrl_xfer(UDEV_T *udev, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                   uint16_t wLength, uint8_t *buff, uint32_t *xfer_len, uint32_t timeout)
+{
+    return USBH_ERR_NOT_SUPPORTED;
+}
+
+int uac_parse_streaming_interface(UAC_DEV_T *uac, IFACE_T *iface, uint8_t bAlternateSetting)
+{
+    AS_IF_T  *asif = (iface == uac->asif_in.iface) ? &uac->asif_in : &uac->asif_out;
+
+    asif->ft = &_ft;
+    return 0;
+}
+
+static void setup_iface(IFACE_T *iface, uint8_t ep_addr)
+{
+    iface->udev = &_udev;
+    iface->num_alt = 2;
+    iface->alt[0].ifd = &_ifd;          /* no endpoint in alternate setting 0         */
+    iface->alt[1].ifd = (DESC_IF_T *)calloc(1, sizeof(DESC_IF_T));
+    iface->alt[1].ifd->bNumEndpoints = 1;
+    iface->alt[1].ep[0].bEndpointAddress = ep_addr;
+    iface->alt[1].ep[0].bmAttributes = EP_ATTR_TT_ISO;
+    iface->alt[1].ep[0].bInterval = 1;
+    iface->alt[1].ep[0].wMaxPacketSize = EP_MPS;
+    iface->aif = &iface->alt[0];
+}
+
+static void setup_uac(void)
+{
+    _udev.speed = SPEED_HIGH;
+    setup_iface(&_iface_in, 0x81);
+    setup_iface(&_iface_out, 0x02);
+    _uac.udev = &_udev;
+    _uac.asif_in.iface = &_iface_in;
+    _uac.asif_out.iface = &_iface_out;
+    _uac.state = UAC_STATE_READY;
+
+    _ft.bNrChannels = 2;
+    _ft.bSubframeSize = 2;
+    _ft.bSamFreqType = 1;
+    _ft.tSamFreq[0][0] = SRATE & 0xFF;
+    _ft.tSamFreq[0][1] = (SRATE >> 8) & 0xFF;
+    _ft.tSamFreq[0][2] = SRATE >> 16;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Test                                                                   */
+/*--------------------------------------------------------------------------*/
+static uint8_t    _buff[RING_SIZE];
+static uint32_t   _host_pos;            /* stream byte the application writes or reads next */
+
+/* Write <bytes> of the stream to the audio out ring, as much as fits */
+static void ring_write(UAC_RING_T *ring, uint32_t bytes)
+{
+    uint8_t  *p;
+    uint32_t len, i;
+
+    while (bytes > 0)
+    {
+        p = usbh_uac_ring_write_ptr(ring, &len);
+        if (len == 0)
+            break;
+        if (len > bytes)
+            len = bytes;
+        for (i = 0; i < len; i++)
+            p[i] = stream_byte(_host_pos++);
+        usbh_uac_ring_write_done(ring, len);
+        bytes -= len;
+    }
+}
+
+/* Read the audio in ring, returns the number of bytes that differ from the stream */
+static int ring_read(UAC_RING_T *ring)
+{
+    uint8_t  *p;
+    uint32_t len, i;
+    int      err = 0;
+
+    for (;;)
+    {
+        p = usbh_uac_ring_read_ptr(ring, &len);
+        if (len == 0)
+            break;
+        for (i = 0; i < len; i++)
+        {
+            if (p[i] != stream_byte(_host_pos++))
+                err++;
+        }
+        usbh_uac_ring_read_done(ring, len);
+    }
+    return err;
+}
+
+/*
+ *  Play with a producer whose clock is <ppm> off the USB clock, for <utrs> transfers.
+ *  Returns the lowest and highest ring level after the first second.
+ */
+static void play(UAC_RING_T *ring, int ppm, int utrs, uint32_t *lo, uint32_t *hi)
+{
+    uint64_t  acc = 0;
+    uint32_t  frames, level;
+    int       n;
+
+    *lo = 0xFFFFFFFF;
+    *hi = 0;
+    for (n = 0; n < utrs; n++)
+    {
+        /* the producer makes SRATE * (1 + ppm / 1e6) frames per second, 1000 UTRs */
+        acc += (uint64_t)SRATE * (1000000 + ppm);
+        frames = acc / 1000000000ULL;
+        acc -= (uint64_t)frames * 1000000000ULL;
+        ring_write(ring, frames * FRAME_SIZE);
+
+        sim_interrupt();
+
+        level = ring->wr - ring->rd;
+        if (n >= 1000)
+        {
+            if (level < *lo)
+                *lo = level;
+            if (level > *hi)
+                *hi = level;
+        }
+    }
+}
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+int main(void)
+{
+    UAC_RING_T       ring;
+    USBH_MEM_STAT_T  stat;
+    uint32_t         lo, hi, n;
+    int              ret = 0, err, ppm;
+
+    usbh_memory_init();
+    setup_uac();
+
+    /* too small a ring */
+    memset(&ring, 0, sizeof(ring));
+    ring.buff = _buff;
+    ring.buff_size = EP_MPS * IF_PER_UTR * 3;
+    CHECK(usbh_uac_start_audio_out_ring(&_uac, &ring) == UAC_RET_INVALID, "small ring taken");
+    CHECK(_queue_n == 0, "transfers started");
+
+    /* audio out with the producer clock fast and slow */
+    for (ppm = -2000; ppm <= 2000; ppm += 4000)
+    {
+        printf("audio out, producer %+d ppm\n", ppm);
+        memset(&ring, 0, sizeof(ring));
+        ring.buff = _buff;
+        ring.buff_size = sizeof(_buff);
+        _host_pos = _dev_pos = 0;
+        _data_err = _pkt_max = 0;
+        _pkt_min = EP_MPS;
+
+        /* prefill half a ring at the start of buff */
+        for (n = 0; n < 2048; n++)
+            _buff[n] = stream_byte(_host_pos++);
+        ring.wr = 2048;
+        CHECK(usbh_uac_start_audio_out_ring(&_uac, &ring) == 0, "usbh_uac_start_audio_out_ring");
+        CHECK((ring.size == 4096) && (ring.frame_size == FRAME_SIZE), "ring size %d", ring.size);
+        CHECK(_queue_n == NUM_UTR, "%d transfers queued", _queue_n);
+        CHECK(usbh_uac_start_audio_out_ring(&_uac, &ring) == UAC_RET_IS_STREAMING, "started twice");
+
+        play(&ring, ppm, 10000, &lo, &hi);
+        printf("  %u packets of %d..%d bytes, %u longer, %u shorter, level %u..%u, latency %u us\n",
+               ring.packets, _pkt_min, _pkt_max, ring.adj_up, ring.adj_down, lo, hi,
+               usbh_uac_ring_latency(&ring));
+        CHECK(_data_err == 0, "%d bytes sent differ from the stream", _data_err);
+        CHECK(_dev_pos + (ring.wr - ring.rd) == _host_pos, "bytes lost");
+        CHECK(ring.xrun == 0, "%u underruns", ring.xrun);
+        CHECK((lo >= ring.lo_mark - EP_MPS * IF_PER_UTR * NUM_UTR) && (hi <= ring.hi_mark + EP_MPS * IF_PER_UTR),
+              "ring level %u..%u outside the watermarks", lo, hi);
+        CHECK((ppm > 0) ? (ring.adj_up > 0) : (ring.adj_down > 0), "packet size not adjusted");
+        CHECK((_pkt_min == 5 * FRAME_SIZE) || (_pkt_max == 7 * FRAME_SIZE), "packet sizes %d..%d", _pkt_min, _pkt_max);
+
+        usbh_uac_stop_audio_out(&_uac);
+        CHECK((_queue_n == 0) && (_uac.asif_out.ring == NULL), "not stopped");
+    }
+
+    /* the producer stops: packets are cut short, the stream stays intact */
+    printf("audio out underrun\n");
+    memset(&ring, 0, sizeof(ring));
+    ring.buff = _buff;
+    ring.buff_size = sizeof(_buff);
+    _host_pos = _dev_pos = 0;
+    _data_err = 0;
+    CHECK(usbh_uac_start_audio_out_ring(&_uac, &ring) == 0, "usbh_uac_start_audio_out_ring");
+    play(&ring, 0, 500, &lo, &hi);
+    for (n = 0; n < 100; n++)
+        sim_interrupt();
+    play(&ring, 0, 1500, &lo, &hi);
+    printf("  %u underruns, %u bytes sent\n", ring.xrun, _dev_pos);
+    CHECK(ring.xrun > 0, "no underrun");
+    CHECK(_data_err == 0, "%d bytes sent differ from the stream", _data_err);
+    usbh_uac_stop_audio_out(&_uac);
+
+    /* audio in, read as it comes */
+    printf("audio in\n");
+    memset(&ring, 0, sizeof(ring));
+    ring.buff = _buff;
+    ring.buff_size = sizeof(_buff);
+    _host_pos = _dev_pos = 0;
+    CHECK(usbh_uac_start_audio_in_ring(&_uac, &ring) == 0, "usbh_uac_start_audio_in_ring");
+    err = 0;
+    for (n = 0; n < 5000; n++)
+    {
+        sim_interrupt();
+        if (n % 3 == 0)
+            err += ring_read(&ring);
+    }
+    err += ring_read(&ring);
+    printf("  %u packets, %u bytes, %u overruns\n", ring.packets, _host_pos, ring.xrun);
+    CHECK(err == 0, "%d bytes read differ from the stream", err);
+    CHECK((_host_pos == _dev_pos) && (ring.xrun == 0), "bytes lost");
+
+    /* not read: the ring fills up and packets are dropped */
+    for (n = 0; n < 200; n++)
+        sim_interrupt();
+    printf("  not read: level %u of %u, latency %u us, %u overruns\n", ring.wr - ring.rd, ring.size,
+           usbh_uac_ring_latency(&ring), ring.xrun);
+    CHECK((ring.xrun > 0) && (ring.wr - ring.rd <= ring.size), "overrun");
+    CHECK(usbh_uac_ring_latency(&ring) == (ring.wr - ring.rd) / FRAME_SIZE * 1000000ULL / SRATE, "latency");
+    usbh_uac_stop_audio_in(&_uac);
+    CHECK((_queue_n == 0) && (_uac.asif_in.ring == NULL), "not stopped");
+
+    usbh_memory_stat(&stat);
+    CHECK((stat.utr.used == 0) && (stat.heap_used == 0), "UTRs or memory left in use");
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
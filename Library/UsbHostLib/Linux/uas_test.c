@@ -0,0 +1,639 @@
+/**************************************************************************//**
+ * @file     uas_test.c
+ * @version  V1.00
+ * @brief    Host test of the UAS transport of msc_uas.c on a simulated device.
+ *
+ *           The simulated device sits behind usbh_bulk_xfer(). It keeps the
+ *           commands it receives in a task set, runs them in random order
+ *           with READ READY/WRITE READY, data and SENSE IUs on its four
+ *           pipes, and makes the transfer-done callbacks from a simulated
+ *           interrupt. The test checks the data, that UMAS_UAS_QDEPTH
+ *           commands are outstanding, TASK SET FULL handling, recovery from
+ *           a STALLed data pipe and from a lost command, and disconnect.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "usb.h"
+#include "msc.h"
+
+#define SIM_SECT            4096        /* 2 MB disk                                  */
+#define SIM_PIPE_UTRS       8
+#define TEST_REQS           64
+#define TEST_SECT           8           /* 4 KB per request                           */
+
+
+/*--------------------------------------------------------------------------*/
+/*   Simulated UAS device                                                   */
+/*--------------------------------------------------------------------------*/
+enum { PIPE_CMD, PIPE_STAT, PIPE_DATA_IN, PIPE_DATA_OUT, PIPE_NUM };
+
+typedef struct
+{
+    int      tag;
+    int      seq;                       /* number of the command, from 0              */
+    uint8_t  cdb[16];
+} SIM_CMD_T;
+
+static uint8_t    _disk[SIM_SECT * 512];
+static EP_INFO_T  *_pipe_ep[PIPE_NUM];
+static UTR_T      *_pipe[PIPE_NUM][SIM_PIPE_UTRS];     /* UTRs waiting on each pipe  */
+static int        _pipe_n[PIPE_NUM];
+
+static SIM_CMD_T  _task_set[32];        /* commands received, not started             */
+static int        _task_n;
+static int        _task_max = 32;       /* task set size of the device                */
+static SIM_CMD_T  _data_cmd;            /* command whose READY IU was queued          */
+static int        _data_active, _data_ready_sent;
+static UTR_T      *_data_done_utr;      /* data transfer done, not called back yet    */
+
+static uint8_t    _iu[32][64];          /* IUs to send on the status pipe             */
+static int        _iu_len[32], _iu_n;
+
+static uint32_t   _ticks, _rand = 1;
+static int        _in_irq;
+
+static int        _cmd_cnt;             /* COMMAND IUs received                       */
+static int        _stall_cmd = -1;      /* STALL the data of this command             */
+static int        _drop_cmd = -1;       /* ignore this command                        */
+static int        _hold;                /* accept commands but do not run them        */
+static int        _max_out;             /* most commands held by the device           */
+static int        _task_set_full, _lu_resets, _clear_halts;
+
+static uint32_t sim_rand(void)
+{
+    _rand = _rand * 1103515245 + 12345;
+    return (_rand >> 16) & 0x7FFF;
+}
+
+static void sim_reset(void)
+{
+    memset(_pipe_n, 0, sizeof(_pipe_n));
+    _task_n = _iu_n = 0;
+    _data_active = _data_ready_sent = 0;
+    _data_done_utr = NULL;
+    _cmd_cnt = _max_out = 0;
+    _task_set_full = _lu_resets = _clear_halts = 0;
+    _stall_cmd = _drop_cmd = -1;
+    _hold = 0;
+    _task_max = 32;
+}
+
+/* the host controller calls back a UTR from its interrupt */
+static void sim_utr_done(UTR_T *utr, int status, uint32_t len)
+{
+    uint32_t  primask = __host_primask;
+
+    utr->status = status;
+    utr->xfer_len = len;
+    utr->bIsTransferDone = 1;
+    __host_primask = 1;
+    if (utr->func)
+        utr->func(utr);
+    __host_primask = primask;
+}
+
+static UTR_T * pipe_pop(int pipe)
+{
+    UTR_T  *utr = _pipe[pipe][0];
+
+    _pipe_n[pipe]--;
+    memmove(&_pipe[pipe][0], &_pipe[pipe][1], _pipe_n[pipe] * sizeof(UTR_T *));
+    return utr;
+}
+
+static void queue_iu(int id, int tag, int status_or_code)
+{
+    uint8_t  *iu = _iu[_iu_n];
+
+    memset(iu, 0, 64);
+    iu[0] = id;
+    iu[2] = tag >> 8;
+    iu[3] = tag & 0xFF;
+    if (id == 0x03)
+    {
+        iu[6] = status_or_code;         /* SENSE IU, no sense data                    */
+        _iu_len[_iu_n] = 16;
+    }
+    else if (id == 0x04)
+    {
+        iu[7] = status_or_code;         /* RESPONSE IU                                */
+        _iu_len[_iu_n] = 8;
+    }
+    else
+    {
+        _iu_len[_iu_n] = 4;             /* READ READY, WRITE READY                    */
+    }
+    _iu_n++;
+}
+
+static uint32_t cdb_lba(uint8_t *cdb)
+{
+    return ((uint32_t)cdb[2] << 24) | (cdb[3] << 16) | (cdb[4] << 8) | cdb[5];
+}
+
+static uint32_t cdb_len(uint8_t *cdb)
+{
+    return ((cdb[7] << 8) | cdb[8]) * 512;
+}
+
+/* COMMAND or TASK MANAGEMENT IU on the command pipe */
+static int sim_command_pipe(void)
+{
+    UTR_T      *utr;
+    uint8_t    *iu;
+    SIM_CMD_T  *cmd;
+    int        tag;
+
+    if (_pipe_n[PIPE_CMD] == 0)
+        return 0;
+    utr = pipe_pop(PIPE_CMD);
+    iu = utr->buff;
+    tag = (iu[2] << 8) | iu[3];
+
+    if (iu[0] == 0x05)
+    {
+        /* LOGICAL UNIT RESET aborts all commands */
+        _lu_resets++;
+        _task_n = 0;
+        _data_active = 0;
+        _iu_n = 0;
+        queue_iu(0x04, tag, 0x00);
+    }
+    else if (_cmd_cnt++ == _drop_cmd)
+    {
+        /* lost */
+    }
+    else if (_task_n + _data_active >= _task_max)
+    {
+        _task_set_full++;
+        queue_iu(0x03, tag, 0x28);
+    }
+    else
+    {
+        cmd = &_task_set[_task_n++];
+        cmd->tag = tag;
+        cmd->seq = _cmd_cnt - 1;
+        memcpy(cmd->cdb, &iu[16], 16);
+        if (_task_n + _data_active > _max_out)
+            _max_out = _task_n + _data_active;
+    }
+    sim_utr_done(utr, 0, utr->data_len);
+    return 1;
+}
+
+/* the device starts one of the commands of its task set, in any order */
+static int sim_start_command(void)
+{
+    int   i;
+
+    if (_data_active || (_task_n == 0) || _hold)
+        return 0;
+
+    i = sim_rand() % _task_n;
+    _data_cmd = _task_set[i];
+    _task_n--;
+    memmove(&_task_set[i], &_task_set[i+1], (_task_n - i) * sizeof(SIM_CMD_T));
+
+    switch (_data_cmd.cdb[0])
+    {
+    case READ_10:
+    case READ_CAPACITY:
+        queue_iu(0x06, _data_cmd.tag, 0);
+        break;
+    case WRITE_10:
+        queue_iu(0x07, _data_cmd.tag, 0);
+        break;
+    default:
+        queue_iu(0x03, _data_cmd.tag, 0x00);
+        return 1;
+    }
+    _data_active = 1;
+    _data_ready_sent = 0;
+    return 1;
+}
+
+static int sim_status_pipe(void)
+{
+    UTR_T  *utr;
+
+    if ((_pipe_n[PIPE_STAT] == 0) || (_iu_n == 0))
+        return 0;
+    utr = pipe_pop(PIPE_STAT);
+    if ((_data_active) && (_iu[0][0] == 0x06 || _iu[0][0] == 0x07))
+        _data_ready_sent = 1;
+    memcpy(utr->buff, _iu[0], _iu_len[0]);
+    sim_utr_done(utr, 0, _iu_len[0]);
+    _iu_n--;
+    memmove(&_iu[0], &_iu[1], _iu_n * sizeof(_iu[0]));
+    memmove(&_iu_len[0], &_iu_len[1], _iu_n * sizeof(int));
+    return 1;
+}
+
+static int sim_data_pipe(void)
+{
+    UTR_T     *utr;
+    uint32_t  lba, len;
+    int       pipe;
+
+    if (!_data_active || !_data_ready_sent || (_data_done_utr != NULL))
+        return 0;
+    pipe = (_data_cmd.cdb[0] == WRITE_10) ? PIPE_DATA_OUT : PIPE_DATA_IN;
+    if (_pipe_n[pipe] == 0)
+        return 0;
+    utr = pipe_pop(pipe);
+
+    if (_data_cmd.seq == _stall_cmd)
+    {
+        _stall_cmd = -1;
+        _data_active = 0;
+        sim_utr_done(utr, USBH_ERR_STALL, 0);
+        return 1;
+    }
+
+    lba = cdb_lba(_data_cmd.cdb);
+    len = cdb_len(_data_cmd.cdb);
+    if (_data_cmd.cdb[0] == READ_CAPACITY)
+    {
+        len = 8;
+        memset(utr->buff, 0, 8);
+        utr->buff[2] = ((SIM_SECT - 1) >> 8) & 0xFF;
+        utr->buff[3] = (SIM_SECT - 1) & 0xFF;
+        utr->buff[6] = 0x02;
+    }
+    else if (_data_cmd.cdb[0] == READ_10)
+        memcpy(utr->buff, &_disk[lba * 512], len);
+    else
+        memcpy(&_disk[lba * 512], utr->buff, len);
+    if (utr->data_len != len)
+        printf("tag %d: data length %u, expected %u\n", _data_cmd.tag, (unsigned)utr->data_len, (unsigned)len);
+
+    _data_active = 0;
+    queue_iu(0x03, _data_cmd.tag, 0x00);
+    utr->xfer_len = len;
+    _data_done_utr = utr;               /* its callback may come after the SENSE IU   */
+    return 1;
+}
+
+static int sim_data_done(void)
+{
+    UTR_T  *utr = _data_done_utr;
+
+    if (utr == NULL)
+        return 0;
+    _data_done_utr = NULL;
+    sim_utr_done(utr, 0, utr->xfer_len);
+    return 1;
+}
+
+/* one interrupt of the simulated host controller */
+static void sim_interrupt(void)
+{
+    static int (* const event[])(void) =
+    {
+        sim_command_pipe, sim_start_command, sim_status_pipe, sim_data_pipe, sim_data_done
+    };
+    int   i, progress;
+
+    _ticks++;
+    if (_in_irq)
+        return;
+    _in_irq = 1;
+    do
+    {
+        progress = 0;
+        for (i = 0; i < 5; i++)
+            progress |= event[(i + sim_rand()) % 5]();
+    }
+    while (progress);
+    _in_irq = 0;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   USB Host library functions the transport calls                         */
+/*--------------------------------------------------------------------------*/
+uint32_t get_ticks(void)
+{
+    if (!__host_primask)
+        sim_interrupt();                /* as if the interrupt came while polling     */
+    return _ticks;
+}
+
+int usbh_bulk_xfer(UTR_T *utr)
+{
+    int   pipe;
+
+    for (pipe = 0; pipe < PIPE_NUM; pipe++)
+    {
+        if (utr->ep == _pipe_ep[pipe])
+            break;
+    }
+    if ((pipe >= PIPE_NUM) || (_pipe_n[pipe] >= SIM_PIPE_UTRS))
+        return USBH_ERR_NOT_FOUND;
+    _pipe[pipe][_pipe_n[pipe]++] = utr;
+    return 0;
+}
+
+int usbh_quit_utr(UTR_T *utr)
+{
+    int   pipe, i;
+
+    if (utr == _data_done_utr)
+        _data_done_utr = NULL;
+    for (pipe = 0; pipe < PIPE_NUM; pipe++)
+    {
+        for (i = 0; i < _pipe_n[pipe]; i++)
+        {
+            if (_pipe[pipe][i] == utr)
+            {
+                _pipe_n[pipe]--;
+                memmove(&_pipe[pipe][i], &_pipe[pipe][i+1], (_pipe_n[pipe] - i) * sizeof(UTR_T *));
+            }
+        }
+    }
+    sim_utr_done(utr, USBH_ERR_ABORT, 0);
+    return 0;
+}
+
+int usbh_clear_halt(UDEV_T *udev, uint16_t ep_addr)
+{
+    _clear_halts++;
+    return 0;
+}
+
+void msc_reset(MSC_T *msc)
+{
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Test                                                                   */
+/*--------------------------------------------------------------------------*/
+
+/* alternate setting 0 bulk-only, alternate setting 1 UAS */
+static uint8_t  _cfd[MAX_DESC_BUFF_SIZE] =
+{
+    0x09, 0x02, 85, 0x00, 0x01, 0x01, 0x00, 0x80, 0x32,
+    0x09, 0x04, 0x00, 0x00, 0x02, 0x08, 0x06, 0x50, 0x00,
+    0x07, 0x05, 0x81, 0x02, 0x00, 0x02, 0x00,
+    0x07, 0x05, 0x02, 0x02, 0x00, 0x02, 0x00,
+    0x09, 0x04, 0x00, 0x01, 0x04, 0x08, 0x06, 0x62, 0x00,
+    0x07, 0x05, 0x01, 0x02, 0x00, 0x02, 0x00,   0x04, 0x24, 0x01, 0x00,
+    0x07, 0x05, 0x82, 0x02, 0x00, 0x02, 0x00,   0x04, 0x24, 0x02, 0x00,
+    0x07, 0x05, 0x83, 0x02, 0x00, 0x02, 0x00,   0x04, 0x24, 0x03, 0x00,
+    0x07, 0x05, 0x04, 0x02, 0x00, 0x02, 0x00,   0x04, 0x24, 0x04, 0x00,
+};
+
+static UDEV_T      _udev;
+static IFACE_T     _iface;
+static MSC_T       _msc;
+static UMAS_REQ_T  _req[TEST_REQS];
+static uint8_t     _buff[TEST_REQS][TEST_SECT * 512];
+static int         _done_order[TEST_REQS], _done_n;
+
+static void setup_iface(void)
+{
+    static const uint8_t  ep_addr[6] = { 0x81, 0x02, 0x01, 0x82, 0x83, 0x04 };
+    int   i;
+
+    _udev.cfd_buff = _cfd;
+    _iface.udev = &_udev;
+    _iface.num_alt = 2;
+    _iface.alt[0].ifd = (DESC_IF_T *)&_cfd[9];
+    _iface.alt[1].ifd = (DESC_IF_T *)&_cfd[32];
+    for (i = 0; i < 6; i++)
+    {
+        EP_INFO_T  *ep = (i < 2) ? &_iface.alt[0].ep[i] : &_iface.alt[1].ep[i-2];
+
+        ep->bEndpointAddress = ep_addr[i];
+        ep->bmAttributes = EP_ATTR_TT_BULK;
+        ep->wMaxPacketSize = 512;
+    }
+    _iface.aif = &_iface.alt[1];
+}
+
+static int open_uas(void)
+{
+    UAS_XPORT_T  *uas;
+
+    uas = uas_xport_alloc(&_udev, &_iface.alt[1]);
+    if (uas == NULL)
+        return -1;
+    _pipe_ep[PIPE_CMD] = uas->ep_cmd;
+    _pipe_ep[PIPE_STAT] = uas->ep_stat;
+    _pipe_ep[PIPE_DATA_IN] = uas->ep_data_in;
+    _pipe_ep[PIPE_DATA_OUT] = uas->ep_data_out;
+
+    memset(&_msc, 0, sizeof(_msc));
+    _msc.iface = &_iface;
+    _msc.ep_bulk_in = uas->ep_data_in;
+    _msc.ep_bulk_out = uas->ep_data_out;
+    _msc.uas = uas;
+    sim_reset();
+    return 0;
+}
+
+static void req_done(UMAS_REQ_T *req)
+{
+    _done_order[_done_n++] = (int)(req - _req);
+}
+
+/* Queue <n> requests of TEST_SECT sectors, request i at sector i * TEST_SECT */
+static void submit_requests(int n, int bIsWrite)
+{
+    struct bulk_cb_wrap  *cbw;
+    uint32_t  lba;
+    int       i;
+
+    _done_n = 0;
+    for (i = 0; i < n; i++)
+    {
+        cbw = (struct bulk_cb_wrap *)_req[i].cbw;
+        memset(cbw, 0, sizeof(*cbw));
+        lba = i * TEST_SECT;
+        cbw->Flags = bIsWrite ? 0 : 0x80;
+        cbw->Length = 10;
+        cbw->DataTransferLength = TEST_SECT * 512;
+        cbw->CDB[0] = bIsWrite ? WRITE_10 : READ_10;
+        cbw->CDB[2] = (lba >> 24) & 0xFF;
+        cbw->CDB[3] = (lba >> 16) & 0xFF;
+        cbw->CDB[4] = (lba >> 8) & 0xFF;
+        cbw->CDB[5] = lba & 0xFF;
+        cbw->CDB[8] = TEST_SECT;
+        _req[i].buff = _buff[i];
+        _req[i].bIsDataIn = !bIsWrite;
+        _req[i].timeout = 1500;
+        _req[i].func = req_done;
+        msc_xport_submit(&_msc, &_req[i]);
+    }
+}
+
+/* Queue <n> requests and wait for all, return the number of requests done out of order */
+static int run_requests(int n, int bIsWrite)
+{
+    uint32_t  t0;
+    int       i, out_of_order = 0;
+
+    submit_requests(n, bIsWrite);
+    t0 = _ticks;
+    while ((_done_n < n) && (_ticks - t0 < 100000))
+    {
+        sim_interrupt();
+        uas_xport_poll(_msc.uas);
+    }
+    if (_done_n < n)
+    {
+        printf("  %d of %d requests done\n", _done_n, n);
+        return -1;
+    }
+    for (i = 0; i < n; i++)
+    {
+        if (_done_order[i] != i)
+            out_of_order++;
+    }
+    return out_of_order;
+}
+
+static void fill_buffers(int n, int seed)
+{
+    int   i, j;
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j < TEST_SECT * 512; j++)
+            _buff[i][j] = (uint8_t)(i * 31 + j * 7 + seed + (j >> 9));
+}
+
+static int check_buffers(int n, int seed, int skip)
+{
+    int   i, j;
+
+    for (i = 0; i < n; i++)
+    {
+        if (i == skip)
+            continue;
+        for (j = 0; j < TEST_SECT * 512; j++)
+            if (_buff[i][j] != (uint8_t)(i * 31 + j * 7 + seed + (j >> 9)))
+                return -1;
+    }
+    return 0;
+}
+
+/* Requests that failed, with the index of the last one in <*idx> */
+static int count_failed(int n, int status, int *idx)
+{
+    int   i, cnt = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        if (_req[i].status == status)
+        {
+            *idx = i;
+            cnt++;
+        }
+        else if (_req[i].status != 0)
+        {
+            printf("  request %d status %d\n", i, _req[i].status);
+            cnt += 100;
+        }
+    }
+    return cnt;
+}
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+int main(void)
+{
+    USBH_MEM_STAT_T  stat;
+    int    ret = 0, n, idx = -1;
+
+    usbh_memory_init();
+    setup_iface();
+
+    CHECK(uas_xport_alloc(&_udev, &_iface.alt[0]) == NULL, "bulk-only alternate setting taken as UAS");
+
+    /* queued writes then reads, run by the device in random order */
+    printf("%d writes and %d reads of %d KB, %d tags\n", TEST_REQS, TEST_REQS, TEST_SECT / 2, UMAS_UAS_QDEPTH);
+    CHECK(open_uas() == 0, "uas_xport_alloc");
+    fill_buffers(TEST_REQS, 1);
+    n = run_requests(TEST_REQS, 1);
+    CHECK(n >= 0, "writes not done");
+    printf("  writes: %d completed out of order, device held up to %d commands\n", n, _max_out);
+    CHECK(_max_out == UMAS_UAS_QDEPTH, "%d commands outstanding", _max_out);
+    memset(_buff, 0, sizeof(_buff));
+    n = run_requests(TEST_REQS, 0);
+    CHECK((n > 0) || ((n == 0) && (UMAS_UAS_QDEPTH == 1)), "reads not done or all in order");
+    printf("  reads: %d completed out of order\n", n);
+    CHECK(count_failed(TEST_REQS, 1, &idx) == 0, "requests failed");
+    CHECK(check_buffers(TEST_REQS, 1, -1) == 0, "data read back differs");
+
+    /* a simple SCSI command through run_scsi_command() */
+    memset(&_msc.cmd_blk, 0, sizeof(_msc.cmd_blk));
+    _msc.cmd_blk.Flags = 0x80;
+    _msc.cmd_blk.Length = 10;
+    _msc.cmd_blk.CDB[0] = READ_CAPACITY;
+    CHECK(run_scsi_command(&_msc, _msc.scsi_buff, 8, 1, 100) == 0, "READ CAPACITY");
+    CHECK(((_msc.scsi_buff[2] << 8) | _msc.scsi_buff[3]) == SIM_SECT - 1, "READ CAPACITY data");
+    uas_xport_free(_msc.uas);
+
+    /* a device with a shorter task set than our queue */
+    printf("device task set of 2\n");
+    CHECK(open_uas() == 0, "uas_xport_alloc");
+    _task_max = 2;
+    memset(_buff, 0, sizeof(_buff));
+    CHECK(run_requests(TEST_REQS, 0) >= 0, "reads not done");
+    printf("  %d TASK SET FULL, queue depth lowered to %d\n", _task_set_full, _msc.uas->qdepth);
+    CHECK(((_task_set_full > 0) && (_msc.uas->qdepth == 2)) || (UMAS_UAS_QDEPTH <= 2), "queue depth not lowered");
+    CHECK(count_failed(TEST_REQS, 1, &idx) == 0, "requests failed");
+    CHECK(check_buffers(TEST_REQS, 1, -1) == 0, "data read back differs");
+    uas_xport_free(_msc.uas);
+
+    /* the device STALLs the data pipe of a command */
+    printf("data pipe STALL\n");
+    CHECK(open_uas() == 0, "uas_xport_alloc");
+    _stall_cmd = 3;
+    memset(_buff, 0, sizeof(_buff));
+    CHECK(run_requests(16, 0) >= 0, "reads not done");
+    CHECK(count_failed(16, USBH_ERR_STALL, &idx) == 1, "not exactly one request failed");
+    printf("  request %d failed, %d LU reset, %d clear halt\n", idx, _lu_resets, _clear_halts);
+    CHECK((_lu_resets == 1) && (_clear_halts == 4), "recovery");
+    CHECK(check_buffers(16, 1, idx) == 0, "data of the other requests differs");
+    uas_xport_free(_msc.uas);
+
+    /* the device loses a command */
+    printf("lost command\n");
+    CHECK(open_uas() == 0, "uas_xport_alloc");
+    _drop_cmd = 5;
+    memset(_buff, 0, sizeof(_buff));
+    CHECK(run_requests(16, 0) >= 0, "reads not done");
+    CHECK(count_failed(16, USBH_ERR_TIMEOUT, &idx) == 1, "not exactly one request timed out");
+    printf("  request %d timed out, %d LU reset\n", idx, _lu_resets);
+    CHECK(_lu_resets == 1, "recovery");
+    CHECK(check_buffers(16, 1, idx) == 0, "data of the other requests differs");
+    uas_xport_free(_msc.uas);
+
+    /* disconnect with commands outstanding and queued */
+    printf("disconnect\n");
+    CHECK(open_uas() == 0, "uas_xport_alloc");
+    _hold = 1;                          /* nothing completes                          */
+    submit_requests(16, 0);
+    for (n = 0; n < 10; n++)
+        sim_interrupt();
+    CHECK((_done_n == 0) && (_max_out == UMAS_UAS_QDEPTH), "commands not outstanding");
+    uas_xport_detach(_msc.uas);
+    for (n = 0; n < PIPE_NUM; n++)
+        while (_pipe_n[n] > 0)
+            usbh_quit_utr(_pipe[n][0]);
+    uas_xport_free(_msc.uas);
+    CHECK((_done_n == 16) && (count_failed(16, UMAS_ERR_DRIVE_NOT_FOUND, &idx) == 16), "requests not failed");
+
+    usbh_memory_stat(&stat);
+    CHECK((stat.utr.used == 0) && (stat.heap_used == 0), "UTRs or memory left in use");
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
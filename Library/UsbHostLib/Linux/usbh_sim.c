@@ -0,0 +1,1629 @@
+/**************************************************************************//**
+ * @file     usbh_sim.c
+ * @version  V1.00
+ * @brief    Simulated EHCI and OHCI host controllers of the M480 for the Linux
+ *           build of the USB Host library. The models run the schedules the
+ *           drivers build against simulated devices, raise the interrupts of
+ *           the controllers and account the bus time used.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <ucontext.h>
+
+#include "NuMicro.h"
+
+#include "usb.h"
+#include "hub.h"
+#include "usbh_sim.h"
+
+/*
+ *  Register accesses. The library objects are compiled with -fsanitize=thread and
+ *  --param tsan-distinguish-volatile=1, every volatile access calls a __tsan_volatile_*
+ *  hook before it is made. A write to a controller register is remembered and applied
+ *  at the next hook or model entry, after the store has been made: the register then
+ *  holds the value written and the model turns it into what the hardware would make of
+ *  it, W1C bits cleared, read-only bits restored and so on. A read of a register takes
+ *  REG_READ_NS of simulated time, which runs the (micro)frames due.
+ */
+#define REG_READ_NS          100            /* simulated time a register read takes       */
+#define TICK_NS              10000000ULL    /* get_ticks() unit, 10 ms                    */
+#define TICK_POLL_NS         10000          /* simulated time a get_ticks() call takes    */
+#define UFRAME_NS            125000
+#define FRAME_NS             1000000
+#define OHCI_PORT_RESET_NS   10000000ULL
+
+#define IRQ_OHCI             0x1
+#define IRQ_EHCI             0x2
+#define IRQ_LOOP_MAX         16
+
+/* bus time in byte times */
+#define HS_UFRAME_BYTES      7500
+#define HS_PERIODIC_BYTES    6000           /* 80% of a micro-frame                       */
+#define HS_OVERHEAD          55
+#define HS_ISO_OVERHEAD      38
+#define HS_SPLIT_OVERHEAD    (2 * HS_OVERHEAD)
+#define FS_FRAME_BYTES       1500
+#define FS_PERIODIC_BYTES    1350           /* 90% of a frame                             */
+#define FS_OVERHEAD          13
+#define FS_ISO_OVERHEAD      9
+#define LS_FACTOR            8
+
+#define EP0_IDLE             0
+#define EP0_DATA_IN          1
+#define EP0_DATA_OUT         2
+#define EP0_STATUS_IN        3
+#define EP0_STATUS_OUT       4
+#define EP0_STALL            5
+
+#define ITEM_MAX             256            /* loop guard for schedule walks              */
+#define NAK_LIST_MAX         64
+
+#define PTR(a)               ((void *)(uintptr_t)(a))
+#define ADDR(p)              ((uint32_t)(uintptr_t)(p))
+#define RO_REG(r)            (*(uint32_t *)&(r))    /* a read-only register, as the HC sets it */
+#define IN_REGS(a, r)        (((uint8_t *)(a) >= (uint8_t *)&(r)) && ((uint8_t *)(a) < (uint8_t *)(&(r) + 1)))
+
+USBH_T      __host_usbh;
+HSUSBH_T    __host_hsusbh;
+
+extern void EHCI_IRQHandler(void);
+extern void OHCI_IRQHandler(void);
+
+static uint64_t        _now;                /* simulated time in ns                       */
+static uint64_t        _next_uframe, _next_frame;
+
+static uint32_t        *_wr_reg;            /* register written, not applied yet          */
+static uint32_t        _wr_old;
+
+static uint32_t        _irq_en;
+static int             _in_irq;
+
+static SIM_DEV_T       *_root_dev[2];       /* devices on the root ports                  */
+static uint64_t        _ohci_reset_end[2];
+
+static uint32_t        _ehci_pend;          /* USTSR bits raised at the end of the uframe */
+static uint32_t        _ohci_done;          /* done queue, written to the HCCA at frame end */
+
+static SIM_BUS_STAT_T  _stat[2];
+
+static void  sim_advance(uint64_t ns);
+static void  sim_irq(void);
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Devices                                                                              */
+/*----------------------------------------------------------------------------------------*/
+
+void  sim_dev_init(SIM_DEV_T *dev, const SIM_CLASS_T *cls, int speed,
+                   const uint8_t *dev_desc, const uint8_t *cfg_desc)
+{
+    const uint8_t  *d, *end;
+
+    dev->cls = cls;
+    dev->speed = speed;
+    dev->dev_desc = dev_desc;
+    dev->cfg_desc = cfg_desc;
+
+    memset(dev->ep_type, 0xFF, sizeof(dev->ep_type));
+    end = cfg_desc + (cfg_desc[2] | (cfg_desc[3] << 8));
+    for (d = cfg_desc; (d < end) && (d[0] != 0); d += d[0])
+    {
+        if (d[1] == USB_DT_ENDPOINT)
+            dev->ep_type[d[2] >> 7][d[2] & 0xF] = d[3] & EP_ATTR_TT_MASK;
+    }
+    sim_dev_reset(dev);
+}
+
+void  sim_dev_reset(SIM_DEV_T *dev)
+{
+    dev->addr = 0;
+    dev->config = 0;
+    memset(dev->alt, 0, sizeof(dev->alt));
+    memset(dev->toggle, 0, sizeof(dev->toggle));
+    memset(dev->halt, 0, sizeof(dev->halt));
+    dev->ep0_stage = EP0_IDLE;
+    if (dev->cls->event)
+        dev->cls->event(dev, SIM_EV_RESET, 0);
+}
+
+/* Reset the toggles and halts of the endpoints of interface <ifnum> */
+static void  dev_reset_iface_eps(SIM_DEV_T *dev, int ifnum)
+{
+    const uint8_t  *d, *end;
+    int            in_if = 0;
+
+    end = dev->cfg_desc + (dev->cfg_desc[2] | (dev->cfg_desc[3] << 8));
+    for (d = dev->cfg_desc; (d < end) && (d[0] != 0); d += d[0])
+    {
+        if (d[1] == USB_DT_INTERFACE)
+            in_if = (d[2] == ifnum);
+        else if ((d[1] == USB_DT_ENDPOINT) && in_if)
+        {
+            dev->toggle[d[2] >> 7][d[2] & 0xF] = 0;
+            dev->halt[d[2] >> 7][d[2] & 0xF] = 0;
+        }
+    }
+}
+
+static int  dev_string(SIM_DEV_T *dev, int idx, uint8_t *data)
+{
+    const char  *s = dev->cls->name;
+    int         i;
+
+    if (idx == 0)
+    {
+        data[0] = 4;
+        data[1] = USB_DT_STRING;
+        data[2] = 0x09;
+        data[3] = 0x04;
+        return 4;
+    }
+    for (i = 0; s[i] && (i < 60); i++)
+    {
+        data[2 + i * 2] = s[i];
+        data[3 + i * 2] = 0;
+    }
+    data[0] = 2 + i * 2;
+    data[1] = USB_DT_STRING;
+    return data[0];
+}
+
+/* Standard request. Returns the IN data length, 0 or SIM_STALL. */
+static int  dev_std_request(SIM_DEV_T *dev, const uint8_t *setup, uint8_t *data)
+{
+    int   recip = setup[0] & 0x1F;
+    int   wValue = setup[2] | (setup[3] << 8);
+    int   wIndex = setup[4] | (setup[5] << 8);
+    int   ep = wIndex & 0xF, in = (wIndex >> 7) & 1;
+    int   len;
+
+    switch (setup[1])
+    {
+    case USB_REQ_GET_STATUS:
+        data[0] = (recip == REQ_TYPE_TO_EP) ? dev->halt[in][ep] : 0;
+        data[1] = 0;
+        return 2;
+
+    case USB_REQ_CLEAR_FEATURE:
+    case USB_REQ_SET_FEATURE:
+        if ((recip == REQ_TYPE_TO_EP) && (wValue == 0) && (ep != 0))
+        {
+            if (dev->ep_type[in][ep] == 0xFF)
+                return SIM_STALL;
+            dev->halt[in][ep] = (setup[1] == USB_REQ_SET_FEATURE);
+            if (setup[1] == USB_REQ_CLEAR_FEATURE)
+            {
+                dev->toggle[in][ep] = 0;
+                if (dev->cls->event)
+                    dev->cls->event(dev, SIM_EV_CLEAR_HALT, wIndex & 0x8F);
+            }
+        }
+        return 0;
+
+    case USB_REQ_SET_ADDRESS:
+        dev->new_addr = wValue & 0x7F;      /* in the status stage                        */
+        return 0;
+
+    case USB_REQ_GET_DESCRIPTOR:
+        if (recip != REQ_TYPE_TO_DEV)
+            break;
+        switch (wValue >> 8)
+        {
+        case USB_DT_DEVICE:
+            memcpy(data, dev->dev_desc, 18);
+            return 18;
+        case USB_DT_CONFIGURATION:
+            len = dev->cfg_desc[2] | (dev->cfg_desc[3] << 8);
+            memcpy(data, dev->cfg_desc, len);
+            return len;
+        case USB_DT_STRING:
+            return dev_string(dev, wValue & 0xFF, data);
+        }
+        return SIM_STALL;
+
+    case 0x08:                              /* GET_CONFIGURATION                          */
+        data[0] = dev->config;
+        return 1;
+
+    case USB_REQ_SET_CONFIGURATION:
+        dev->config = wValue;
+        memset(dev->alt, 0, sizeof(dev->alt));
+        memset(dev->toggle, 0, sizeof(dev->toggle));
+        memset(dev->halt, 0, sizeof(dev->halt));
+        if (dev->cls->event)
+            dev->cls->event(dev, SIM_EV_CONFIG, wValue);
+        return 0;
+
+    case 0x0A:                              /* GET_INTERFACE                              */
+        data[0] = dev->alt[wIndex & 7];
+        return 1;
+
+    case USB_REQ_SET_INTERFACE:
+        dev->alt[wIndex & 7] = wValue;
+        dev_reset_iface_eps(dev, wIndex);
+        if (dev->cls->event)
+            dev->cls->event(dev, SIM_EV_ALT, wIndex);
+        return 0;
+    }
+
+    /* descriptors of an interface and anything else go to the class */
+    if (dev->cls->ctrl)
+        return dev->cls->ctrl(dev, setup, data);
+    return SIM_STALL;
+}
+
+static void  ep0_setup(SIM_DEV_T *dev)
+{
+    const uint8_t  *s = dev->setup;
+    int            wLength = s[6] | (s[7] << 8);
+    int            len;
+
+    dev->ep0_pos = 0;
+    if (!(s[0] & REQ_TYPE_IN) && (wLength > 0))
+    {
+        dev->ep0_len = (wLength < sizeof(dev->ep0_buf)) ? wLength : sizeof(dev->ep0_buf);
+        dev->ep0_stage = EP0_DATA_OUT;
+        return;
+    }
+
+    if ((s[0] & 0x60) == USB_DT_STANDARD)
+        len = dev_std_request(dev, s, dev->ep0_buf);
+    else
+        len = dev->cls->ctrl ? dev->cls->ctrl(dev, s, dev->ep0_buf) : SIM_STALL;
+
+    if (len < 0)
+        dev->ep0_stage = EP0_STALL;
+    else if (s[0] & REQ_TYPE_IN)
+    {
+        dev->ep0_len = (len < wLength) ? len : wLength;
+        dev->ep0_stage = EP0_DATA_IN;
+    }
+    else
+        dev->ep0_stage = EP0_STATUS_IN;
+}
+
+/* A transaction on the control endpoint. The SETUP, data and status stages share the toggle. */
+static int  ep0_xact(SIM_DEV_T *dev, int pid, int toggle, uint8_t *buf, int len, SIM_BUS_STAT_T *st)
+{
+    int   mps = dev->dev_desc[7];
+    int   expect, n, r;
+
+    if (pid == SIM_PID_SETUP)
+    {
+        if ((len != 8) || (toggle != 0))
+        {
+            dev->toggle_err++;
+            st->toggle_err++;
+        }
+        memcpy(dev->setup, buf, 8);
+        dev->toggle[0][0] = 1;
+        ep0_setup(dev);
+        return 8;
+    }
+
+    if (dev->ep0_stage == EP0_STALL)
+        return SIM_STALL;
+
+    expect = ((dev->ep0_stage == EP0_DATA_IN) && (pid == SIM_PID_IN)) ||
+             ((dev->ep0_stage == EP0_DATA_OUT) && (pid == SIM_PID_OUT)) ? dev->toggle[0][0] : 1;
+    if (toggle != expect)
+    {
+        dev->toggle_err++;
+        st->toggle_err++;
+        if (pid == SIM_PID_OUT)
+            return len;                     /* ACKed and ignored                          */
+    }
+
+    switch (dev->ep0_stage)
+    {
+    case EP0_DATA_IN:
+        if (pid == SIM_PID_OUT)             /* status stage                               */
+        {
+            dev->ep0_stage = EP0_IDLE;
+            return 0;
+        }
+        n = dev->ep0_len - dev->ep0_pos;
+        if (n > mps)
+            n = mps;
+        if (n > len)
+            n = len;
+        memcpy(buf, dev->ep0_buf + dev->ep0_pos, n);
+        dev->ep0_pos += n;
+        dev->toggle[0][0] ^= 1;
+        return n;
+
+    case EP0_DATA_OUT:
+        if (pid == SIM_PID_IN)
+            return SIM_STALL;
+        n = dev->ep0_len - dev->ep0_pos;
+        if (n > len)
+            n = len;
+        memcpy(dev->ep0_buf + dev->ep0_pos, buf, n);
+        dev->ep0_pos += n;
+        dev->toggle[0][0] ^= 1;
+        if (dev->ep0_pos >= dev->ep0_len)
+        {
+            if ((dev->setup[0] & 0x60) == USB_DT_STANDARD)
+                r = SIM_STALL;
+            else
+                r = dev->cls->ctrl ? dev->cls->ctrl(dev, dev->setup, dev->ep0_buf) : SIM_STALL;
+            dev->ep0_stage = (r < 0) ? EP0_STALL : EP0_STATUS_IN;
+        }
+        return len;
+
+    case EP0_STATUS_IN:
+        if (pid == SIM_PID_OUT)
+            return SIM_STALL;
+        dev->ep0_stage = EP0_IDLE;
+        if (((dev->setup[0] & 0x60) == USB_DT_STANDARD) && (dev->setup[1] == USB_REQ_SET_ADDRESS))
+            dev->addr = dev->new_addr;
+        return 0;
+    }
+    return SIM_STALL;
+}
+
+/*
+ *  One transaction with <dev>. Returns the number of bytes moved, SIM_NAK, SIM_STALL or
+ *  SIM_NORESP. A data toggle mismatch is counted: an OUT packet is ACKed and dropped,
+ *  an IN packet is lost, the device has moved on and the host retries.
+ */
+static int  dev_xact(SIM_DEV_T *dev, int pid, int ep, int toggle, uint8_t *buf, int len,
+                     int iso, SIM_BUS_STAT_T *st)
+{
+    int   in = (pid == SIM_PID_IN);
+    int   r;
+
+    if (dev == NULL)
+        return SIM_NORESP;
+    if (ep == 0)
+        return ep0_xact(dev, pid, toggle, buf, len, st);
+    if ((pid == SIM_PID_SETUP) || (dev->config == 0) || (dev->ep_type[in][ep] == 0xFF))
+        return SIM_STALL;
+
+    if (iso)
+    {
+        r = dev->cls->xfer(dev, ep | (in ? 0x80 : 0), buf, len);
+        if (r < 0)
+            return in ? 0 : len;            /* isochronous endpoints do not handshake     */
+        return in ? r : len;
+    }
+
+    if (dev->halt[in][ep])
+        return SIM_STALL;
+    if (!in && (toggle != dev->toggle[0][ep]))
+    {
+        dev->toggle_err++;
+        st->toggle_err++;
+        return len;
+    }
+    r = dev->cls->xfer(dev, ep | (in ? 0x80 : 0), buf, len);
+    if (r == SIM_STALL)
+        dev->halt[in][ep] = 1;
+    if (r < 0)
+        return r;
+    if (in && (toggle != dev->toggle[1][ep]))
+    {
+        dev->toggle[1][ep] ^= 1;
+        dev->toggle_err++;
+        st->toggle_err++;
+        return SIM_NAK;
+    }
+    dev->toggle[in][ep] ^= 1;
+    return in ? r : len;
+}
+
+/* The device with address <addr> below <dev>, through enabled hub ports */
+static SIM_DEV_T * dev_find(SIM_DEV_T *dev, int addr)
+{
+    SIM_DEV_T  *d;
+    int        i;
+
+    if (dev->addr == addr)
+        return dev;
+    for (i = 1; i <= dev->nports; i++)
+    {
+        if ((dev->port_dev[i] != NULL) && (dev->port_sts[i] & PORT_S_ENABLE) &&
+                ((d = dev_find(dev->port_dev[i], addr)) != NULL))
+            return d;
+    }
+    return NULL;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Root ports                                                                           */
+/*----------------------------------------------------------------------------------------*/
+
+/* Root port 1 is routed to EHCI unless released to OHCI, root port 2 is OHCI only. */
+static int  ehci_owns(int p)
+{
+    return (p == 0) && (__host_hsusbh.UCFGR & HSUSBH_UCFGR_CF_Msk) &&
+           !(__host_hsusbh.UPSCR[0] & HSUSBH_UPSCR_PO_Msk);
+}
+
+/* Update the connect status of both controllers after a connect or a change of the owner */
+static void  port_route(int p)
+{
+    HSUSBH_T  *hs = &__host_hsusbh;
+    USBH_T    *u = &__host_usbh;
+    SIM_DEV_T *dev = _root_dev[p];
+    uint32_t  v;
+    int       on_ehci, on_ohci;
+
+    on_ehci = (dev != NULL) && ehci_owns(p);
+    on_ohci = (dev != NULL) && !ehci_owns(p);
+
+    v = hs->UPSCR[p];
+    if (!!(v & HSUSBH_UPSCR_CCS_Msk) != on_ehci)
+    {
+        v ^= HSUSBH_UPSCR_CCS_Msk;
+        v |= HSUSBH_UPSCR_CSC_Msk;
+        if (!on_ehci && (v & HSUSBH_UPSCR_PE_Msk))
+            v = (v & ~HSUSBH_UPSCR_PE_Msk) | HSUSBH_UPSCR_PEC_Msk;
+        hs->USTSR |= HSUSBH_USTSR_PCD_Msk;
+    }
+    hs->UPSCR[p] = v;
+
+    v = u->HcRhPortStatus[p];
+    if (!!(v & USBH_HcRhPortStatus_CCS_Msk) != on_ohci)
+    {
+        v ^= USBH_HcRhPortStatus_CCS_Msk;
+        v |= USBH_HcRhPortStatus_CSC_Msk;
+        if (!on_ohci)
+        {
+            if (v & USBH_HcRhPortStatus_PES_Msk)
+                v |= USBH_HcRhPortStatus_PESC_Msk;
+            v &= ~(USBH_HcRhPortStatus_PES_Msk | USBH_HcRhPortStatus_PSS_Msk | USBH_HcRhPortStatus_PRS_Msk);
+        }
+        u->HcInterruptStatus |= USBH_HcInterruptStatus_RHSC_Msk;
+    }
+    v &= ~USBH_HcRhPortStatus_LSDA_Msk;
+    if (on_ohci && (dev->speed == SIM_SPEED_LOW))
+        v |= USBH_HcRhPortStatus_LSDA_Msk;
+    u->HcRhPortStatus[p] = v;
+}
+
+/**
+  * @brief    Connect a device to a root port.
+  * @param[in]  port   Root port, 1 or 2
+  * @param[in]  dev    The device
+  */
+void  sim_attach(int port, SIM_DEV_T *dev)
+{
+    sim_dev_reset(dev);
+    dev->parent = NULL;
+    dev->port = port;
+    _root_dev[port - 1] = dev;
+    port_route(port - 1);
+}
+
+/**
+  * @brief    Disconnect the device on a root port. A port released to OHCI goes back to EHCI.
+  * @param[in]  port   Root port, 1 or 2
+  */
+void  sim_detach(int port)
+{
+    _root_dev[port - 1] = NULL;
+    port_route(port - 1);
+    if (port == 1)
+    {
+        __host_hsusbh.UPSCR[0] &= ~HSUSBH_UPSCR_PO_Msk;
+        port_route(0);
+    }
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Bus time                                                                             */
+/*----------------------------------------------------------------------------------------*/
+
+static int  hs_cost(int len, int type, int split)
+{
+    if (type == EP_ATTR_TT_ISO)
+        return len + HS_ISO_OVERHEAD;
+    return len + (split ? HS_SPLIT_OVERHEAD : HS_OVERHEAD);
+}
+
+static int  fs_cost(int len, int type, int ls)
+{
+    int  cost = len * 7 / 6 + ((type == EP_ATTR_TT_ISO) ? FS_ISO_OVERHEAD : FS_OVERHEAD);
+
+    return ls ? cost * LS_FACTOR : cost;
+}
+
+static void  bus_used(SIM_BUS_STAT_T *st, int type, int cost, int len)
+{
+    st->used[type] += cost;
+    st->payload[type] += len;
+}
+
+static void  bus_nak(SIM_BUS_STAT_T *st, int type, int cost)
+{
+    st->used[type] += cost;
+    st->nak_time += cost;
+    st->naks++;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   EHCI                                                                                 */
+/*----------------------------------------------------------------------------------------*/
+
+static void  ehci_reset(void)
+{
+    HSUSBH_T  *hs = &__host_hsusbh;
+
+    hs->UCMDR = 0x80000;
+    hs->USTSR = HSUSBH_USTSR_HCHalted_Msk;
+    hs->UIENR = 0;
+    hs->UFINDR = 0;
+    hs->UPFLBAR = 0;
+    hs->UCALAR = 0;
+    hs->UCFGR = 0;
+    hs->UPSCR[0] = HSUSBH_UPSCR_PO_Msk;
+    hs->UPSCR[1] = HSUSBH_UPSCR_PO_Msk;
+    _ehci_pend = 0;
+    port_route(0);
+}
+
+static void  ehci_port_write(int p, uint32_t old, uint32_t val)
+{
+    HSUSBH_T  *hs = &__host_hsusbh;
+    SIM_DEV_T *dev = _root_dev[p];
+    uint32_t  rw = HSUSBH_UPSCR_PP_Msk | HSUSBH_UPSCR_SUSPEND_Msk | HSUSBH_UPSCR_FPR_Msk | HSUSBH_UPSCR_PTC_Msk;
+    uint32_t  v;
+
+    v = old & ~(val & (HSUSBH_UPSCR_CSC_Msk | HSUSBH_UPSCR_PEC_Msk | HSUSBH_UPSCR_OCC_Msk));
+    if (!(val & HSUSBH_UPSCR_PE_Msk))
+        v &= ~HSUSBH_UPSCR_PE_Msk;          /* software can only disable the port         */
+    v = (v & ~rw) | (val & rw);
+
+    if ((val & HSUSBH_UPSCR_PRST_Msk) && !(old & HSUSBH_UPSCR_PRST_Msk))
+    {
+        v = (v | HSUSBH_UPSCR_PRST_Msk) & ~HSUSBH_UPSCR_PE_Msk;
+        if (dev && ehci_owns(p))
+            sim_dev_reset(dev);
+    }
+    else if (!(val & HSUSBH_UPSCR_PRST_Msk) && (old & HSUSBH_UPSCR_PRST_Msk))
+    {
+        /* end of reset: only a high speed device enables the port */
+        v &= ~HSUSBH_UPSCR_PRST_Msk;
+        if (dev && ehci_owns(p) && (dev->speed == SIM_SPEED_HIGH))
+            v |= HSUSBH_UPSCR_PE_Msk;
+    }
+
+    hs->UPSCR[p] = (v & ~HSUSBH_UPSCR_PO_Msk) | (val & HSUSBH_UPSCR_PO_Msk);
+    if ((old ^ val) & HSUSBH_UPSCR_PO_Msk)
+    {
+        if (val & HSUSBH_UPSCR_PO_Msk)
+            hs->UPSCR[p] &= ~HSUSBH_UPSCR_PE_Msk;
+        port_route(p);
+    }
+}
+
+static void  ehci_write(uint32_t *reg, uint32_t old, uint32_t val)
+{
+    HSUSBH_T  *hs = &__host_hsusbh;
+    int       p;
+
+    if (reg == &hs->UCMDR)
+    {
+        if (val & HSUSBH_UCMDR_HCRST_Msk)
+        {
+            ehci_reset();
+            return;
+        }
+        hs->UCMDR = val | (old & HSUSBH_UCMDR_IAAD_Msk);    /* IAAD is cleared by the HC  */
+        hs->USTSR &= ~(HSUSBH_USTSR_HCHalted_Msk | HSUSBH_USTSR_PSS_Msk | HSUSBH_USTSR_ASS_Msk);
+        if (!(val & HSUSBH_UCMDR_RUN_Msk))
+            hs->USTSR |= HSUSBH_USTSR_HCHalted_Msk;
+        if (val & HSUSBH_UCMDR_PSEN_Msk)
+            hs->USTSR |= HSUSBH_USTSR_PSS_Msk;
+        if (val & HSUSBH_UCMDR_ASEN_Msk)
+            hs->USTSR |= HSUSBH_USTSR_ASS_Msk;
+    }
+    else if (reg == &hs->USTSR)
+        hs->USTSR = old & ~(val & 0x3F);
+    else if (reg == &hs->UIENR)
+        hs->UIENR = val & 0x3F;
+    else if (reg == &hs->UPFLBAR)
+        hs->UPFLBAR = val & ~0xFFF;
+    else if (reg == &hs->UCALAR)
+        hs->UCALAR = val & ~0x1F;
+    else if (reg == &hs->UCFGR)
+    {
+        hs->UCFGR = val & HSUSBH_UCFGR_CF_Msk;
+        if ((val & HSUSBH_UCFGR_CF_Msk) && !(old & HSUSBH_UCFGR_CF_Msk))
+        {
+            for (p = 0; p < 2; p++)
+                hs->UPSCR[p] &= ~HSUSBH_UPSCR_PO_Msk;
+        }
+        port_route(0);
+    }
+    else if ((reg == &hs->UPSCR[0]) || (reg == &hs->UPSCR[1]))
+        ehci_port_write(reg - (uint32_t *)&hs->UPSCR[0], old, val);
+    else if ((reg == &hs->EHCVNR) || (reg == &hs->EHCSPR) || (reg == &hs->EHCCPR) || (reg == &hs->UFINDR))
+        *reg = old;
+}
+
+/* The device a QH or iTD addresses, NULL if it is not there at that speed or hub port */
+static SIM_DEV_T * ehci_route(int addr, int eps, int tt_hub, int tt_port)
+{
+    SIM_DEV_T  *dev, *d, *h;
+
+    if (!ehci_owns(0) || !(__host_hsusbh.UPSCR[0] & HSUSBH_UPSCR_PE_Msk) || (_root_dev[0] == NULL))
+        return NULL;
+    dev = dev_find(_root_dev[0], addr);
+    if (dev == NULL)
+        return NULL;
+    if (eps == 2)
+        return (dev->speed == SIM_SPEED_HIGH) ? dev : NULL;
+
+    /* split transaction: through the TT of the nearest high speed hub */
+    if (dev->speed != ((eps == 1) ? SIM_SPEED_LOW : SIM_SPEED_FULL))
+        return NULL;
+    for (d = dev, h = dev->parent; (h != NULL) && (h->speed != SIM_SPEED_HIGH); d = h, h = h->parent)
+        ;
+    if ((h == NULL) || (h->addr != tt_hub) || (d->port != tt_port))
+        return NULL;
+    return dev;
+}
+
+/* Copy between <buf> and a buffer page list, as the HC crosses pages */
+static void  ehci_copy(uint32_t *bptr, int pg, int off, uint8_t *buf, int len, int to_mem)
+{
+    uint8_t  *p;
+    int      n;
+
+    while (len > 0)
+    {
+        p = (uint8_t *)PTR((bptr[pg] & ~0xFFF) + off);
+        n = (len < 4096 - off) ? len : 4096 - off;
+        if (to_mem)
+            memcpy(p, buf, n);
+        else
+            memcpy(buf, p, n);
+        buf += n;
+        len -= n;
+        pg++;
+        off = 0;
+    }
+}
+
+/*
+ *  One transaction of the qTD at the head of <qh>. Returns 1 if it made progress, 0 if the
+ *  QH has nothing to do, -1 if the endpoint NAKed or did not answer, -2 if the rest of the
+ *  micro-frame is too short for the packet.
+ */
+static int  ehci_qh(QH_T *qh, int type, int *budget)
+{
+    SIM_BUS_STAT_T  *st = &_stat[SIM_EHCI];
+    qTD_T     *qtd;
+    SIM_DEV_T *dev;
+    uint8_t   buf[1024];
+    uint32_t  chr = qh->Chrst, tok;
+    int       pid, todo, mps, eps, n, r, cost, pg, off, cerr;
+
+    tok = qh->OL_Token;
+    if (tok & QTD_STS_HALT)
+        return 0;
+    if (!(tok & QTD_STS_ACTIVE))
+    {
+        /* advance the queue: load the next qTD into the overlay */
+        if (qh->OL_Next_qTD & QTD_LIST_END)
+            return 0;
+        qtd = QTD_PTR(qh->OL_Next_qTD);
+        if (!(qtd->Token & QTD_STS_ACTIVE))
+            return 0;
+        qh->Curr_qTD = ADDR(qtd);
+        qh->OL_Next_qTD = qtd->Next_qTD;
+        qh->OL_Alt_Next_qTD = qtd->Alt_Next_qTD;
+        tok = qtd->Token;
+        if (!(chr & QH_DTC))
+            tok = (tok & ~QTD_DT) | (qh->OL_Token & QTD_DT);
+        memcpy(qh->OL_Bptr, qtd->Bptr, sizeof(qh->OL_Bptr));
+        qh->OL_Token = tok;
+    }
+    qtd = QTD_PTR(qh->Curr_qTD);
+
+    pid = (tok & QTD_PID_Msk) >> 8;
+    todo = QTD_TODO_LEN(tok);
+    mps = (chr >> 16) & 0x7FF;
+    eps = (chr >> 12) & 0x3;
+    n = (todo < mps) ? todo : mps;
+    cost = hs_cost(n, type, eps != 2);
+    if (cost > *budget)
+        return -2;
+
+    pg = (tok >> 12) & 0x7;
+    off = qh->OL_Bptr[0] & 0xFFF;
+    if (pid != SIM_PID_IN)
+        ehci_copy(qh->OL_Bptr, pg, off, buf, n, 0);
+
+    dev = ehci_route(chr & 0x7F, eps, (qh->Cap >> QH_HUB_ADDR_Pos) & 0x7F, (qh->Cap >> QH_HUB_PORT_Pos) & 0x7F);
+    r = dev_xact(dev, pid, (chr >> 8) & 0xF, (tok & QTD_DT) ? 1 : 0, buf, n, 0, st);
+
+    if ((r == SIM_NAK) || (r == SIM_NORESP))
+    {
+        bus_nak(st, type, hs_cost(0, type, eps != 2));
+        *budget -= hs_cost(0, type, eps != 2);
+    }
+    if (r == SIM_NAK)
+        return -1;
+    if (r == SIM_NORESP)
+    {
+        st->xact_err++;
+        cerr = (tok >> 10) & 0x3;
+        tok |= QTD_STS_XactErr;
+        if (cerr == 1)
+            tok = (tok & ~(QTD_ERR_COUNTER | QTD_STS_ACTIVE)) | QTD_STS_HALT;
+        else if (cerr > 1)
+            tok = (tok & ~QTD_ERR_COUNTER) | ((cerr - 1) << 10);
+        qh->OL_Token = tok;
+        qtd->Token = tok;
+        if (tok & QTD_STS_HALT)
+        {
+            _ehci_pend |= HSUSBH_USTSR_UERRINT_Msk | ((tok & QTD_IOC) ? HSUSBH_USTSR_USBINT_Msk : 0);
+            return 1;
+        }
+        return -1;
+    }
+    if (r == SIM_STALL)
+    {
+        bus_used(st, type, hs_cost(0, type, eps != 2), 0);
+        *budget -= hs_cost(0, type, eps != 2);
+        st->stalls++;
+        tok = (tok & ~QTD_STS_ACTIVE) | QTD_STS_HALT;
+        qh->OL_Token = tok;
+        qtd->Token = tok;
+        _ehci_pend |= HSUSBH_USTSR_UERRINT_Msk | ((tok & QTD_IOC) ? HSUSBH_USTSR_USBINT_Msk : 0);
+        return 1;
+    }
+
+    bus_used(st, type, hs_cost(r, type, eps != 2), r);
+    *budget -= hs_cost(r, type, eps != 2);
+    if (pid == SIM_PID_IN)
+        ehci_copy(qh->OL_Bptr, pg, off, buf, r, 1);
+    if (pid == SIM_PID_SETUP)
+        r = n;
+    off += r;
+    pg += off >> 12;
+    off &= 0xFFF;
+    todo -= r;
+    qh->OL_Bptr[0] = (qh->OL_Bptr[0] & ~0xFFF) | off;
+    tok = (tok & ~((0x7FFFUL << QTD_TODO_LEN_Pos) | (0x7 << 12))) | ((uint32_t)todo << QTD_TODO_LEN_Pos) | (pg << 12);
+    tok ^= QTD_DT;
+
+    if ((todo == 0) || ((pid == SIM_PID_IN) && (r < n)))
+    {
+        tok &= ~QTD_STS_ACTIVE;
+        if ((todo > 0) && !(qh->OL_Alt_Next_qTD & QTD_LIST_END))
+            qh->OL_Next_qTD = qh->OL_Alt_Next_qTD;
+        if ((tok & QTD_IOC) || (todo > 0))
+            _ehci_pend |= HSUSBH_USTSR_USBINT_Msk;
+    }
+    qh->OL_Token = tok;
+    qtd->Token = tok;
+    return 1;
+}
+
+static void  ehci_itd(iTD_T *itd, int uf, int *budget)
+{
+    SIM_BUS_STAT_T  *st = &_stat[SIM_EHCI];
+    SIM_DEV_T *dev;
+    uint8_t   buf[3072];
+    uint32_t  t = itd->Transaction[uf];
+    int       len, pg, off, in, mps, r;
+
+    if (!(t & ITD_STATUS_ACTIVE))
+        return;
+    len = ITD_XFER_LEN(t);
+    pg = (t >> ITD_PG_Pos) & 0x7;
+    off = t & ITD_XFER_OFF_Msk;
+    in = (itd->Bptr[1] & ITD_DIR_IN) ? 1 : 0;
+    mps = ITD_MAX_PKTSZ(itd);
+    if (in && (len > mps))
+        len = mps;
+    if (!in)
+        ehci_copy(itd->Bptr, pg, off, buf, len, 0);
+
+    dev = ehci_route(ITD_DEV_ADDR(itd), 2, 0, 0);
+    r = dev_xact(dev, in ? SIM_PID_IN : SIM_PID_OUT, ITD_EP_NUM(itd), 0, buf, len, 1, st);
+    t &= ~ITD_STATUS_ACTIVE;
+    if (r < 0)
+    {
+        t |= ITD_STATUS_XACT_ERR;
+        st->xact_err++;
+        r = 0;
+    }
+    else if (in)
+    {
+        ehci_copy(itd->Bptr, pg, off, buf, r, 1);
+        t = (t & ~(0xFFFUL << ITD_XLEN_Pos)) | ((uint32_t)r << ITD_XLEN_Pos);
+    }
+    itd->Transaction[uf] = t;
+    bus_used(st, EP_ATTR_TT_ISO, hs_cost(r, EP_ATTR_TT_ISO, 0), r);
+    *budget -= hs_cost(r, EP_ATTR_TT_ISO, 0);
+    if (t & ITD_IOC)
+        _ehci_pend |= HSUSBH_USTSR_USBINT_Msk;
+}
+
+static void  ehci_periodic(int frame, int uf, int *budget)
+{
+    uint32_t  link;
+    QH_T      *qh;
+    int       n;
+
+    link = ((uint32_t *)PTR(__host_hsusbh.UPFLBAR))[frame];
+    for (n = 0; !(link & 0x1) && (n < ITEM_MAX); n++)
+    {
+        switch ((link >> 1) & 0x3)
+        {
+        case 0:                             /* iTD                                        */
+            ehci_itd(ITD_PTR(link), uf, budget);
+            link = ITD_PTR(link)->Next_Link;
+            break;
+        case 1:                             /* QH, one transaction in its S-mask uframes  */
+            qh = QH_PTR(link);
+            if ((qh->Cap & QH_S_MASK_Msk) & (1 << uf))
+            {
+                /* a full/low speed transaction is done at the start split */
+                if (ehci_qh(qh, EP_ATTR_TT_INT, budget) == -2)
+                    _stat[SIM_EHCI].periodic_over++;
+            }
+            link = qh->HLink;
+            break;
+        case 2:                             /* siTD, not modeled                          */
+            link = SITD_PTR(link)->Next_Link;
+            break;
+        default:
+            link = QH_HLNK_END;
+            break;
+        }
+    }
+}
+
+/* Round robin over the QHs of the asynchronous list, a transaction each per pass */
+static void  ehci_async(int *budget)
+{
+    QH_T  *head, *qh, *naked[NAK_LIST_MAX];
+    int   i, n, r, nnak = 0, progress;
+
+    head = QH_PTR(__host_hsusbh.UCALAR);
+    if (head == NULL)
+        return;
+    do
+    {
+        progress = 0;
+        qh = head;
+        n = 0;
+        do
+        {
+            for (i = 0; (i < nnak) && (naked[i] != qh); i++)
+                ;
+            if (i == nnak)
+            {
+                r = ehci_qh(qh, (qh->Chrst & (0xF << 8)) ? EP_ATTR_TT_BULK : EP_ATTR_TT_CTRL, budget);
+                if (r == 1)
+                    progress = 1;
+                else if (r == -2)
+                    return;
+                else if ((r == -1) && (nnak < NAK_LIST_MAX))
+                    naked[nnak++] = qh;     /* retried in the next micro-frame            */
+            }
+            qh = QH_PTR(qh->HLink);
+        }
+        while ((qh != head) && (++n < ITEM_MAX));
+    }
+    while (progress && (*budget > 0));
+}
+
+static void  ehci_uframe(void)
+{
+    HSUSBH_T        *hs = &__host_hsusbh;
+    SIM_BUS_STAT_T  *st = &_stat[SIM_EHCI];
+    uint32_t  fi;
+    int       budget, pbudget;
+
+    if (!(hs->UCMDR & HSUSBH_UCMDR_RUN_Msk))
+        return;
+
+    fi = (hs->UFINDR + 1) & 0x3FFF;
+    hs->UFINDR = fi;
+    if ((fi & 0x1FFF) == 0)
+        _ehci_pend |= HSUSBH_USTSR_FLR_Msk;
+    if (hs->UCMDR & HSUSBH_UCMDR_IAAD_Msk)
+    {
+        /* nothing is cached across micro-frames, the doorbell is answered at once */
+        hs->UCMDR &= ~HSUSBH_UCMDR_IAAD_Msk;
+        _ehci_pend |= HSUSBH_USTSR_IAA_Msk;
+    }
+
+    st->frames++;
+    st->capacity += HS_UFRAME_BYTES;
+    pbudget = HS_PERIODIC_BYTES;
+    if (hs->UCMDR & HSUSBH_UCMDR_PSEN_Msk)
+        ehci_periodic((fi >> 3) & (FL_SIZE - 1), fi & 0x7, &pbudget);
+    if (HS_PERIODIC_BYTES - pbudget > st->periodic_max)
+        st->periodic_max = HS_PERIODIC_BYTES - pbudget;
+
+    budget = HS_UFRAME_BYTES - (HS_PERIODIC_BYTES - pbudget);
+    if (hs->UCMDR & HSUSBH_UCMDR_ASEN_Msk)
+        ehci_async(&budget);
+
+    hs->USTSR |= _ehci_pend;
+    _ehci_pend = 0;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   OHCI                                                                                 */
+/*----------------------------------------------------------------------------------------*/
+
+static void  ohci_reset(void)
+{
+    USBH_T  *u = &__host_usbh;
+    int     p;
+
+    RO_REG(u->HcRevision) = 0x10;
+    u->HcControl = 0;
+    u->HcCommandStatus = 0;
+    u->HcInterruptStatus = 0;
+    u->HcInterruptEnable = u->HcInterruptDisable = 0;
+    u->HcHCCA = 0;
+    u->HcControlHeadED = u->HcBulkHeadED = 0;
+    u->HcDoneHead = 0;
+    u->HcFmInterval = 0x2EDF;
+    RO_REG(u->HcFmNumber) = 0;
+    u->HcRhDescriptorA = 0x2;
+    u->HcRhStatus = 0;
+    _ohci_done = 0;
+    for (p = 0; p < 2; p++)
+    {
+        u->HcRhPortStatus[p] = 0;
+        port_route(p);
+    }
+}
+
+static void  ohci_port_write(int p, uint32_t old, uint32_t val)
+{
+    uint32_t  v;
+
+    v = old & ~(val & 0x1F0000);            /* CSC, PESC, PSSC, OCIC and PRSC are W1C     */
+    if (v & USBH_HcRhPortStatus_CCS_Msk)
+    {
+        if (val & USBH_HcRhPortStatus_PES_Msk)          /* SetPortEnable                  */
+            v |= USBH_HcRhPortStatus_PES_Msk;
+        if (val & USBH_HcRhPortStatus_PSS_Msk)          /* SetPortSuspend                 */
+            v |= USBH_HcRhPortStatus_PSS_Msk;
+        if ((val & USBH_HcRhPortStatus_POCI_Msk) && (v & USBH_HcRhPortStatus_PSS_Msk))
+            v = (v & ~USBH_HcRhPortStatus_PSS_Msk) | USBH_HcRhPortStatus_PSSC_Msk;
+        if (val & USBH_HcRhPortStatus_PRS_Msk)          /* SetPortReset                   */
+        {
+            v = (v | USBH_HcRhPortStatus_PRS_Msk) & ~USBH_HcRhPortStatus_PES_Msk;
+            _ohci_reset_end[p] = _now + OHCI_PORT_RESET_NS;
+            sim_dev_reset(_root_dev[p]);
+        }
+    }
+    if (val & USBH_HcRhPortStatus_CCS_Msk)              /* ClearPortEnable                */
+        v &= ~USBH_HcRhPortStatus_PES_Msk;
+    if (val & USBH_HcRhPortStatus_PPS_Msk)              /* SetPortPower                   */
+        v |= USBH_HcRhPortStatus_PPS_Msk;
+    if (val & USBH_HcRhPortStatus_LSDA_Msk)             /* ClearPortPower                 */
+        v &= ~USBH_HcRhPortStatus_PPS_Msk;
+    __host_usbh.HcRhPortStatus[p] = v;
+}
+
+static void  ohci_write(uint32_t *reg, uint32_t old, uint32_t val)
+{
+    USBH_T  *u = &__host_usbh;
+
+    if (reg == &u->HcCommandStatus)
+    {
+        if (val & USBH_HcCommandStatus_HCR_Msk)
+        {
+            ohci_reset();                   /* completes at once                          */
+            return;
+        }
+        u->HcCommandStatus = old | (val & (USBH_HcCommandStatus_CLF_Msk | USBH_HcCommandStatus_BLF_Msk));
+    }
+    else if (reg == &u->HcInterruptStatus)
+        u->HcInterruptStatus = old & ~val;
+    else if (reg == &u->HcInterruptEnable)
+        u->HcInterruptEnable = u->HcInterruptDisable = old | val;
+    else if (reg == &u->HcInterruptDisable)
+        u->HcInterruptEnable = u->HcInterruptDisable = old & ~val;
+    else if (reg == &u->HcHCCA)
+        u->HcHCCA = val & ~0xFF;
+    else if (reg == &u->HcRhStatus)
+    {
+        u->HcRhStatus = old & USBH_HcRhStatus_DRWE_Msk;
+        if (val & USBH_HcRhStatus_DRWE_Msk)
+            u->HcRhStatus |= USBH_HcRhStatus_DRWE_Msk;
+        if (val & USBH_HcRhStatus_CRWE_Msk)
+            u->HcRhStatus &= ~USBH_HcRhStatus_DRWE_Msk;
+    }
+    else if ((reg == &u->HcRhPortStatus[0]) || (reg == &u->HcRhPortStatus[1]))
+        ohci_port_write(reg - (uint32_t *)&u->HcRhPortStatus[0], old, val);
+    else if (reg == &u->HcRhDescriptorA)
+        u->HcRhDescriptorA = (val & ~USBH_HcRhDescriptorA_NDP_Msk) | 0x2;
+    else if ((reg == &u->HcRevision) || (reg == &u->HcDoneHead) || (reg == &u->HcFmRemaining) ||
+             (reg == &u->HcFmNumber))
+        *reg = old;
+}
+
+static SIM_DEV_T * ohci_route(int addr, int ls)
+{
+    SIM_DEV_T  *dev;
+    int        p;
+
+    for (p = 0; p < 2; p++)
+    {
+        if ((_root_dev[p] == NULL) || ehci_owns(p) || !(__host_usbh.HcRhPortStatus[p] & USBH_HcRhPortStatus_PES_Msk))
+            continue;
+        dev = dev_find(_root_dev[p], addr);
+        if (dev != NULL)
+            return ((dev->speed == SIM_SPEED_LOW) == (ls != 0)) ? dev : NULL;
+    }
+    return NULL;
+}
+
+/* Retire the TD at the head of <ed> to the done queue */
+static void  ohci_retire(ED_T *ed, TD_T *td, int cc, int carry, int halt)
+{
+    uint32_t  next = td->NextTD;
+
+    TD_CC_SET(td->Info, cc);
+    ed->HeadP = (next & ~0xF) | (carry ? 0x2 : 0) | (halt ? ED_HEADP_HALT : 0);
+    td->NextTD = _ohci_done;
+    _ohci_done = ADDR(td);
+}
+
+static int  ohci_iso_td(ED_T *ed, int *budget, uint16_t fn)
+{
+    SIM_BUS_STAT_T  *st = &_stat[SIM_OHCI];
+    TD_T      *td;
+    uint32_t  addr;
+    int       in, mps, len, r, cost;
+
+    while (1)
+    {
+        td = (TD_T *)PTR(ed->HeadP & ~0xF);
+        if ((td == NULL) || ((ed->HeadP & ~0xF) == (ed->TailP & ~0xF)))
+            return 0;
+        r = (int16_t)(fn - (td->Info & 0xFFFF));
+        if (r < 0)
+            return 0;                       /* not its frame yet                          */
+        if (r == 0)
+            break;
+        ohci_retire(ed, td, 8, ed->HeadP & 0x2, 0);     /* DataOverrun, frame missed      */
+    }
+
+    in = ((ed->Info & ED_DIR_Msk) == ED_DIR_IN);
+    mps = (ed->Info >> ED_CTRL_MPS_Pos) & 0x7FF;
+    addr = (td->CBP & ~0xFFF) | (td->PSW[0] & 0xFFF);
+    len = td->BE - addr + 1;
+    if (len > mps)
+        len = mps;
+    cost = fs_cost(len, EP_ATTR_TT_ISO, 0);
+    if (cost > *budget)
+    {
+        st->periodic_over++;
+        return -2;
+    }
+
+    r = dev_xact(ohci_route(ed->Info & ED_FUNC_ADDR_Msk, 0), in ? SIM_PID_IN : SIM_PID_OUT,
+                 (ed->Info >> ED_CTRL_EN_Pos) & 0xF, 0, (uint8_t *)PTR(addr), len, 1, st);
+    if (r < 0)
+    {
+        td->PSW[0] = (td->PSW[0] & 0xFFFF0000) | (5 << 12);    /* DeviceNotResponding    */
+        st->xact_err++;
+        r = 0;
+    }
+    else if (in)
+        td->PSW[0] = (td->PSW[0] & 0xFFFF0000) | (((r < len) ? 9 : 0) << 12) | r;
+    else
+        td->PSW[0] = td->PSW[0] & 0xFFFF0000;
+    bus_used(st, EP_ATTR_TT_ISO, fs_cost(r, EP_ATTR_TT_ISO, 0), r);
+    *budget -= fs_cost(r, EP_ATTR_TT_ISO, 0);
+    ohci_retire(ed, td, 0, ed->HeadP & 0x2, 0);
+    return 1;
+}
+
+/* One transaction of the TD at the head of <ed>. Returns as ehci_qh(). */
+static int  ohci_ed(ED_T *ed, int type, int *budget, uint16_t fn)
+{
+    SIM_BUS_STAT_T  *st = &_stat[SIM_OHCI];
+    TD_T      *td;
+    uint32_t  info = ed->Info;
+    int       dir, pid, mps, tog, rem, n, r, ls, ec;
+
+    if ((info & ED_SKIP) || (ed->HeadP & ED_HEADP_HALT))
+        return 0;
+    td = (TD_T *)PTR(ed->HeadP & ~0xF);
+    if ((td == NULL) || ((ed->HeadP & ~0xF) == (ed->TailP & ~0xF)))
+        return 0;
+    if (info & ED_FORMAT_ISO)
+        return (__host_usbh.HcControl & USBH_HcControl_IE_Msk) ? ohci_iso_td(ed, budget, fn) : 0;
+
+    dir = (info & ED_DIR_Msk) >> ED_CTRL_DIR_Pos;
+    if ((dir == 0) || (dir == 3))
+        dir = (td->Info & TD_DP) >> 19;
+    pid = (dir == 0) ? SIM_PID_SETUP : ((dir == 1) ? SIM_PID_OUT : SIM_PID_IN);
+    mps = (info & ED_MAX_PK_SIZE_Msk) >> ED_CTRL_MPS_Pos;
+    ls = (info & ED_SPEED_Msk) ? 1 : 0;
+    tog = (td->Info & (1 << 25)) ? ((td->Info >> 24) & 1) : ((ed->HeadP >> 1) & 1);
+    rem = td->CBP ? (int)(td->BE - td->CBP + 1) : 0;
+    n = (rem < mps) ? rem : mps;
+    if (fs_cost(n, type, ls) > *budget)
+        return -2;
+
+    r = dev_xact(ohci_route(info & ED_FUNC_ADDR_Msk, ls), pid, (info & ED_EP_ADDR_Msk) >> ED_CTRL_EN_Pos,
+                 tog, (uint8_t *)PTR(td->CBP), n, 0, st);
+
+    if (r == SIM_NAK)
+    {
+        bus_nak(st, type, fs_cost(0, type, ls));
+        *budget -= fs_cost(0, type, ls);
+        return -1;
+    }
+    if (r == SIM_NORESP)
+    {
+        bus_nak(st, type, fs_cost(0, type, ls));
+        *budget -= fs_cost(0, type, ls);
+        st->xact_err++;
+        ec = TD_EC_GET(td->Info) + 1;
+        if (ec >= 3)
+        {
+            ohci_retire(ed, td, 5, tog, 1);         /* DeviceNotResponding                */
+            return 1;
+        }
+        td->Info = (td->Info & ~(0x3 << 26)) | (ec << 26);
+        return -1;
+    }
+    if (r == SIM_STALL)
+    {
+        bus_used(st, type, fs_cost(0, type, ls), 0);
+        *budget -= fs_cost(0, type, ls);
+        st->stalls++;
+        ohci_retire(ed, td, 4, tog, 1);             /* STALL                              */
+        return 1;
+    }
+
+    bus_used(st, type, fs_cost(r, type, ls), r);
+    *budget -= fs_cost(r, type, ls);
+    if (pid == SIM_PID_SETUP)
+        r = n;
+    tog ^= 1;
+    td->Info &= ~(0x3 << 26);
+    if (td->Info & (1 << 25))
+        td->Info = (td->Info & ~(1 << 24)) | (tog << 24);
+    else
+        ed->HeadP = (ed->HeadP & ~0x2) | (tog << 1);
+
+    if (r == rem)
+    {
+        td->CBP = 0;
+        ohci_retire(ed, td, 0, tog, 0);
+    }
+    else
+    {
+        td->CBP += r;
+        if ((pid == SIM_PID_IN) && (r < n))
+        {
+            if (td->Info & TD_R)
+                ohci_retire(ed, td, 0, tog, 0);
+            else
+                ohci_retire(ed, td, 9, tog, 1);     /* DataUnderrun                       */
+        }
+    }
+    return 1;
+}
+
+/* Round robin over the control and bulk lists, a transaction per ED and pass */
+static void  ohci_async(int *budget, uint16_t fn)
+{
+    USBH_T  *u = &__host_usbh;
+    ED_T    *ed, *naked[NAK_LIST_MAX];
+    int     i, n, r, l, nnak = 0, progress, found[2] = { 0, 0 };
+    uint32_t  head[2], flag[2] = { USBH_HcCommandStatus_CLF_Msk, USBH_HcCommandStatus_BLF_Msk };
+
+    head[0] = (u->HcControl & USBH_HcControl_CLE_Msk) ? u->HcControlHeadED : 0;
+    head[1] = (u->HcControl & USBH_HcControl_BLE_Msk) ? u->HcBulkHeadED : 0;
+    do
+    {
+        progress = 0;
+        for (l = 0; l < 2; l++)
+        {
+            if (!(u->HcCommandStatus & flag[l]))
+                continue;
+            for (ed = (ED_T *)PTR(head[l]), n = 0; (ed != NULL) && (n < ITEM_MAX); ed = (ED_T *)PTR(ed->NextED), n++)
+            {
+                for (i = 0; (i < nnak) && (naked[i] != ed); i++)
+                    ;
+                if (i < nnak)
+                {
+                    found[l] = 1;
+                    continue;
+                }
+                r = ohci_ed(ed, l ? EP_ATTR_TT_BULK : EP_ATTR_TT_CTRL, budget, fn);
+                if (r != 0)
+                    found[l] = 1;
+                if (r == 1)
+                    progress = 1;
+                else if (r == -2)
+                    return;
+                else if ((r == -1) && (nnak < NAK_LIST_MAX))
+                    naked[nnak++] = ed;
+            }
+        }
+    }
+    while (progress && (*budget > 0));
+
+    /* the HC clears CLF and BLF when it finds nothing to do on the list */
+    for (l = 0; l < 2; l++)
+    {
+        if (!found[l])
+            u->HcCommandStatus &= ~flag[l];
+    }
+}
+
+static void  ohci_frame(void)
+{
+    USBH_T          *u = &__host_usbh;
+    SIM_BUS_STAT_T  *st = &_stat[SIM_OHCI];
+    HCCA_T    *hcca;
+    ED_T      *ed;
+    uint16_t  fn;
+    int       p, n, budget, pbudget;
+
+    for (p = 0; p < 2; p++)
+    {
+        if ((u->HcRhPortStatus[p] & USBH_HcRhPortStatus_PRS_Msk) && (_now >= _ohci_reset_end[p]))
+        {
+            u->HcRhPortStatus[p] &= ~USBH_HcRhPortStatus_PRS_Msk;
+            u->HcRhPortStatus[p] |= USBH_HcRhPortStatus_PRSC_Msk;
+            if (u->HcRhPortStatus[p] & USBH_HcRhPortStatus_CCS_Msk)
+                u->HcRhPortStatus[p] |= USBH_HcRhPortStatus_PES_Msk;
+            u->HcInterruptStatus |= USBH_HcInterruptStatus_RHSC_Msk;
+        }
+    }
+
+    if ((u->HcControl & USBH_HcControl_HCFS_Msk) != HCFS_OPER)
+        return;
+
+    fn = (u->HcFmNumber + 1) & 0xFFFF;
+    RO_REG(u->HcFmNumber) = fn;
+    hcca = (HCCA_T *)PTR(u->HcHCCA);
+    if (hcca == NULL)
+        return;
+    hcca->frame_no = fn;
+    hcca->pad1 = 0;
+    u->HcInterruptStatus |= USBH_HcInterruptStatus_SF_Msk;
+
+    st->frames++;
+    st->capacity += FS_FRAME_BYTES;
+    pbudget = FS_PERIODIC_BYTES;
+    if (u->HcControl & USBH_HcControl_PLE_Msk)
+    {
+        for (ed = (ED_T *)PTR(hcca->int_table[fn & 31]), n = 0; (ed != NULL) && (n < ITEM_MAX);
+                ed = (ED_T *)PTR(ed->NextED), n++)
+        {
+            if (ohci_ed(ed, (ed->Info & ED_FORMAT_ISO) ? EP_ATTR_TT_ISO : EP_ATTR_TT_INT, &pbudget, fn) == -2)
+                st->periodic_over++;
+        }
+    }
+    if (FS_PERIODIC_BYTES - pbudget > st->periodic_max)
+        st->periodic_max = FS_PERIODIC_BYTES - pbudget;
+
+    budget = FS_FRAME_BYTES - (FS_PERIODIC_BYTES - pbudget);
+    ohci_async(&budget, fn);
+
+    if (_ohci_done && !(u->HcInterruptStatus & USBH_HcInterruptStatus_WDH_Msk))
+    {
+        hcca->done_head = _ohci_done;
+        _ohci_done = 0;
+        u->HcInterruptStatus |= USBH_HcInterruptStatus_WDH_Msk;
+    }
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Time, register hooks and interrupts                                                  */
+/*----------------------------------------------------------------------------------------*/
+
+static void  reg_commit(void)
+{
+    uint32_t  *reg = _wr_reg;
+
+    if (reg == NULL)
+        return;
+    _wr_reg = NULL;
+    if (IN_REGS(reg, __host_hsusbh))
+        ehci_write(reg, _wr_old, *reg);
+    else
+        ohci_write(reg, _wr_old, *reg);
+}
+
+/* Run the (micro)frames due in the next <ns> */
+static void  sim_advance(uint64_t ns)
+{
+    uint64_t  end = _now + ns;
+
+    while ((_next_uframe <= end) || (_next_frame <= end))
+    {
+        if (_next_uframe <= _next_frame)
+        {
+            _now = _next_uframe;
+            _next_uframe += UFRAME_NS;
+            ehci_uframe();
+        }
+        else
+        {
+            _now = _next_frame;
+            _next_frame += FRAME_NS;
+            ohci_frame();
+        }
+    }
+    _now = end;
+}
+
+static int  ehci_irq_pending(void)
+{
+    return (__host_hsusbh.USTSR & __host_hsusbh.UIENR & 0x3F) != 0;
+}
+
+static int  ohci_irq_pending(void)
+{
+    USBH_T  *u = &__host_usbh;
+
+    return (u->HcInterruptEnable & USBH_HcInterruptEnable_MIE_Msk) &&
+           (u->HcInterruptStatus & u->HcInterruptEnable & 0x7F);
+}
+
+/* Run the interrupt handlers while an enabled interrupt is pending and not masked */
+static void  sim_irq(void)
+{
+    int  n;
+
+    reg_commit();
+    if (_in_irq || __host_primask)
+        return;
+    _in_irq = 1;
+    for (n = 0; n < IRQ_LOOP_MAX; n++)
+    {
+        if ((_irq_en & IRQ_EHCI) && ehci_irq_pending())
+            EHCI_IRQHandler();
+        else if ((_irq_en & IRQ_OHCI) && ohci_irq_pending())
+            OHCI_IRQHandler();
+        else
+            break;
+        reg_commit();
+    }
+    _in_irq = 0;
+}
+
+void  __tsan_volatile_write1(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_write2(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_write4(void *addr)
+{
+    reg_commit();
+    if (IN_REGS(addr, __host_hsusbh) || IN_REGS(addr, __host_usbh))
+    {
+        _wr_reg = (uint32_t *)addr;
+        _wr_old = *(uint32_t *)addr;
+    }
+}
+
+void  __tsan_volatile_write8(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_read1(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_read2(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_read4(void *addr)
+{
+    reg_commit();
+    if (IN_REGS(addr, __host_hsusbh) || IN_REGS(addr, __host_usbh))
+        sim_advance(REG_READ_NS);
+    else if (addr == &__host_dwt.CYCCNT)
+        __host_dwt.CYCCNT = (uint32_t)(_now * 192 / 1000);
+}
+
+void  __tsan_volatile_read8(void *addr)
+{
+    reg_commit();
+}
+
+/* the plain accesses are not of interest */
+void  __tsan_init(void) {}
+void  __tsan_read1(void *addr) {}
+void  __tsan_read2(void *addr) {}
+void  __tsan_read4(void *addr) {}
+void  __tsan_read8(void *addr) {}
+void  __tsan_read16(void *addr) {}
+void  __tsan_write1(void *addr) {}
+void  __tsan_write2(void *addr) {}
+void  __tsan_write4(void *addr) {}
+void  __tsan_write8(void *addr) {}
+void  __tsan_write16(void *addr) {}
+void  __tsan_unaligned_read2(void *addr) {}
+void  __tsan_unaligned_read4(void *addr) {}
+void  __tsan_unaligned_read8(void *addr) {}
+void  __tsan_unaligned_write2(void *addr) {}
+void  __tsan_unaligned_write4(void *addr) {}
+void  __tsan_unaligned_write8(void *addr) {}
+void  __tsan_read_range(void *addr, unsigned long size) {}
+void  __tsan_write_range(void *addr, unsigned long size) {}
+void  __tsan_func_entry(void *pc) {}
+void  __tsan_func_exit(void) {}
+void  __tsan_atomic_thread_fence(int mo) {}
+
+void  __host_irq_unmask(void)
+{
+    sim_irq();
+}
+
+void  NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    reg_commit();
+    _irq_en |= (IRQn == HSUSBH_IRQn) ? IRQ_EHCI : IRQ_OHCI;
+    sim_irq();
+}
+
+void  NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    reg_commit();
+    _irq_en &= ~((IRQn == HSUSBH_IRQn) ? IRQ_EHCI : IRQ_OHCI);
+}
+
+uint32_t  get_ticks(void)
+{
+    reg_commit();
+    sim_advance(TICK_POLL_NS);
+    sim_irq();
+    return (uint32_t)(_now / TICK_NS);
+}
+
+void  delay_us(int usec)
+{
+    int   n;
+
+    reg_commit();
+    while (usec > 0)
+    {
+        n = (usec < 125) ? usec : 125;
+        sim_advance(n * 1000ULL);
+        sim_irq();
+        usec -= n;
+    }
+}
+
+/**
+  * @brief    Simulated time since sim_run().
+  * @return   Time in ns.
+  */
+uint64_t  sim_time_ns(void)
+{
+    return _now;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Statistics                                                                           */
+/*----------------------------------------------------------------------------------------*/
+
+/**
+  * @brief    Get the bus statistics of a host controller.
+  * @param[in]  hc     SIM_EHCI or SIM_OHCI
+  * @param[out] st     The statistics
+  */
+void  sim_bus_stat(int hc, SIM_BUS_STAT_T *st)
+{
+    *st = _stat[hc];
+}
+
+/**
+  * @brief    Clear the bus statistics of both host controllers.
+  */
+void  sim_bus_reset_stats(void)
+{
+    memset(_stat, 0, sizeof(_stat));
+}
+
+static double  pct(uint64_t part, uint64_t whole)
+{
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+/**
+  * @brief    Print the bus utilization of both host controllers since sim_bus_reset_stats().
+  */
+void  sim_bus_report(void)
+{
+    static const char  *name[2] = { "EHCI", "OHCI" };
+    SIM_BUS_STAT_T  *st;
+    uint64_t  used, payload;
+    int       hc;
+
+    printf("bus  (u)frames  busy%%  ctrl%%   iso%%  bulk%%   int%%  NAK%%  payload KB  peak periodic%%  "
+           "NAKs  stalls  no resp  toggle err\n");
+    for (hc = 0; hc < 2; hc++)
+    {
+        st = &_stat[hc];
+        used = st->used[0] + st->used[1] + st->used[2] + st->used[3];
+        payload = st->payload[0] + st->payload[1] + st->payload[2] + st->payload[3];
+        printf("%s %10llu %6.2f %6.2f %6.2f %6.2f %6.2f %5.2f %11llu %15.1f %6u %7u %8u %11u\n",
+               name[hc], (unsigned long long)st->frames, pct(used, st->capacity),
+               pct(st->used[EP_ATTR_TT_CTRL], st->capacity), pct(st->used[EP_ATTR_TT_ISO], st->capacity),
+               pct(st->used[EP_ATTR_TT_BULK], st->capacity), pct(st->used[EP_ATTR_TT_INT], st->capacity),
+               pct(st->nak_time, st->capacity), (unsigned long long)(payload / 1024),
+               pct(st->periodic_max, (hc == SIM_EHCI) ? HS_UFRAME_BYTES : FS_FRAME_BYTES),
+               st->naks, st->stalls, st->xact_err, st->toggle_err);
+    }
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Runner                                                                               */
+/*----------------------------------------------------------------------------------------*/
+
+static uint8_t     _sim_stack[1024 * 1024] __attribute__((aligned(16)));
+static ucontext_t  _main_ctx, _sim_ctx;
+
+/**
+  * @brief    Reset the simulated controllers and run <body> on a stack the drivers can
+  *           address with 32 bits.
+  * @param[in]  body   The test
+  * @return   0, or -1 if the test could not be started.
+  */
+int  sim_run(void (*body)(void))
+{
+    mallopt(M_MMAP_MAX, 0);                 /* keep the heap below 4 GB, in the brk area  */
+
+    if ((uintptr_t)(_sim_stack + sizeof(_sim_stack)) > 0xFFFFFFFFUL)
+    {
+        printf("sim_run - link with -no-pie!\n");
+        return -1;
+    }
+
+    _now = 0;
+    _next_uframe = UFRAME_NS;
+    _next_frame = FRAME_NS;
+    _irq_en = 0;
+    _root_dev[0] = _root_dev[1] = NULL;
+    ehci_reset();
+    ohci_reset();
+    sim_bus_reset_stats();
+
+    getcontext(&_sim_ctx);
+    _sim_ctx.uc_stack.ss_sp = _sim_stack;
+    _sim_ctx.uc_stack.ss_size = sizeof(_sim_stack);
+    _sim_ctx.uc_link = &_main_ctx;
+    makecontext(&_sim_ctx, body, 0);
+    swapcontext(&_main_ctx, &_sim_ctx);
+    return 0;
+}
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
@@ -0,0 +1,149 @@
+/**************************************************************************//**
+ * @file     usbh_sim.h
+ * @version  V1.00
+ * @brief    Simulated EHCI and OHCI host controllers and USB devices for the
+ *           Linux build of the USB Host library.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef _USBH_SIM_H_
+#define _USBH_SIM_H_
+
+#include <stdint.h>
+
+/*
+ *  usbh_sim.c models the EHCI and OHCI controllers of the M480 at register level, with
+ *  the M480 port routing: root port 1 is shared by EHCI and OHCI, root port 2 belongs to
+ *  OHCI. The controllers walk the schedules the drivers build in (micro)frames of
+ *  simulated time and run the transactions against simulated devices. Simulated time only
+ *  passes in get_ticks(), delay_us() and register reads, the CPU is infinitely fast.
+ *
+ *  The library objects are built with -fsanitize=thread, but linked without the TSan
+ *  runtime: the volatile register accesses call the __tsan_volatile_* hooks of usbh_sim.c,
+ *  which apply the register semantics. All addresses must fit in 32 bits, the program is
+ *  linked with -no-pie, sim_run() moves malloc() off mmap() and runs the test on a static
+ *  stack.
+ */
+
+#define SIM_SPEED_LOW       0
+#define SIM_SPEED_FULL      1
+#define SIM_SPEED_HIGH      2
+
+#define SIM_PID_OUT         0
+#define SIM_PID_IN          1
+#define SIM_PID_SETUP       2
+
+/* transaction results, other than the number of bytes */
+#define SIM_NAK             (-1)
+#define SIM_STALL           (-2)
+#define SIM_NORESP          (-3)
+
+/* SIM_CLASS_T::event() */
+#define SIM_EV_RESET        0           /* bus reset                                      */
+#define SIM_EV_CONFIG       1           /* SET_CONFIGURATION, arg is the configuration    */
+#define SIM_EV_ALT          2           /* SET_INTERFACE, arg is the interface            */
+#define SIM_EV_CLEAR_HALT   3           /* CLEAR_FEATURE(ENDPOINT_HALT), arg is the endpoint */
+
+#define SIM_HUB_PORTS       4
+
+typedef struct sim_dev_t  SIM_DEV_T;
+
+/*
+ *  A device class. Standard requests are handled by usbh_sim.c, class and vendor requests
+ *  and the descriptors addressed to an interface are passed to ctrl(). ctrl() returns the
+ *  number of bytes it wrote to data for an IN request, 0 for an OUT request, whose data
+ *  comes in data, or SIM_STALL. xfer() moves the data of one transaction on a non-control
+ *  endpoint; it returns the bytes read from or written to buf, SIM_NAK or SIM_STALL.
+ *  Data toggles and halts are kept by usbh_sim.c.
+ */
+typedef struct
+{
+    const char  *name;
+    int   (*ctrl)(SIM_DEV_T *dev, const uint8_t *setup, uint8_t *data);
+    int   (*xfer)(SIM_DEV_T *dev, uint8_t ep_addr, uint8_t *buf, int len);
+    void  (*event)(SIM_DEV_T *dev, int ev, int arg);
+} SIM_CLASS_T;
+
+struct sim_dev_t
+{
+    const SIM_CLASS_T *cls;
+    int            speed;               /* SIM_SPEED_*                                    */
+    const uint8_t  *dev_desc;
+    const uint8_t  *cfg_desc;
+    void           *priv;               /* class data                                     */
+
+    /* device state, kept by usbh_sim.c */
+    uint8_t        addr;
+    uint8_t        new_addr;            /* SET_ADDRESS, takes effect in the status stage  */
+    uint8_t        config;
+    uint8_t        alt[8];
+    uint8_t        ep_type[2][16];      /* [IN][number], 0xFF if no such endpoint         */
+    uint8_t        toggle[2][16];
+    uint8_t        halt[2][16];
+
+    /* control endpoint */
+    uint8_t        setup[8];
+    uint8_t        ep0_buf[1024];
+    int            ep0_stage;
+    int            ep0_len;
+    int            ep0_pos;
+
+    /* topology; a hub keeps the status of its downstream ports here */
+    SIM_DEV_T      *parent;
+    int            port;
+    int            nports;
+    SIM_DEV_T      *port_dev[SIM_HUB_PORTS + 1];
+    uint16_t       port_sts[SIM_HUB_PORTS + 1];
+    uint16_t       port_chg[SIM_HUB_PORTS + 1];
+    uint64_t       port_reset_end[SIM_HUB_PORTS + 1];
+
+    uint32_t       toggle_err;          /* data toggle mismatches seen by this device     */
+};
+
+/* bus statistics of a host controller */
+typedef struct
+{
+    uint64_t  frames;                   /* (micro)frames run                              */
+    uint64_t  capacity;                 /* bus time in byte times                         */
+    uint64_t  used[4];                  /* bus time by transfer type EP_ATTR_TT_*         */
+    uint64_t  payload[4];               /* data bytes by transfer type                    */
+    uint64_t  nak_time;                 /* bus time of NAKed transactions                 */
+    uint32_t  naks;
+    uint32_t  stalls;
+    uint32_t  xact_err;                 /* transactions nobody answered                   */
+    uint32_t  toggle_err;
+    uint32_t  periodic_max;             /* most periodic bus time in a (micro)frame       */
+    uint32_t  periodic_over;            /* (micro)frames over the periodic limit          */
+} SIM_BUS_STAT_T;
+
+#define SIM_EHCI            0
+#define SIM_OHCI            1
+
+/* usbh_sim.c */
+extern int        sim_run(void (*body)(void));
+extern uint64_t   sim_time_ns(void);
+extern void       sim_attach(int port, SIM_DEV_T *dev);
+extern void       sim_detach(int port);
+extern void       sim_dev_init(SIM_DEV_T *dev, const SIM_CLASS_T *cls, int speed,
+                               const uint8_t *dev_desc, const uint8_t *cfg_desc);
+extern void       sim_dev_reset(SIM_DEV_T *dev);
+extern void       sim_bus_stat(int hc, SIM_BUS_STAT_T *st);
+extern void       sim_bus_reset_stats(void);
+extern void       sim_bus_report(void);
+
+/* sim_dev.c */
+extern SIM_DEV_T  *sim_hub_new(int speed);
+extern void       sim_hub_attach(SIM_DEV_T *hub, int port, SIM_DEV_T *dev);
+extern void       sim_hub_detach(SIM_DEV_T *hub, int port);
+extern SIM_DEV_T  *sim_msc_new(int speed, uint8_t *image, uint32_t sectors);
+extern void       sim_msc_set_latency(SIM_DEV_T *dev, uint32_t us);
+extern void       sim_msc_stall_next_read(SIM_DEV_T *dev);
+extern SIM_DEV_T  *sim_cdc_new(int speed);
+extern SIM_DEV_T  *sim_hid_new(int speed);
+extern int        sim_hid_report(SIM_DEV_T *dev, const uint8_t *report);
+extern SIM_DEV_T  *sim_uac_new(int speed);
+extern void       sim_uac_stat(SIM_DEV_T *dev, uint32_t *in_bytes, uint32_t *out_bytes, uint32_t *out_errors);
+
+#endif  /* _USBH_SIM_H_ */
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
@@ -48,9 +48,21 @@
 /*   Memory allocation settings                                                           */
 /*----------------------------------------------------------------------------------------*/
 
+#ifndef STATIC_MEMORY_ALLOC
 #define STATIC_MEMORY_ALLOC    0       /* pre-allocate static memory blocks. No dynamic memory aloocation.
                                           But the maximum number of connected devices and transfers are
                                           limited.  */
+#endif
+
+/* Object pools of STATIC_MEMORY_ALLOC. UTRs, devices and descriptor buffers are taken from these
+   instead of the heap, so that transfers make no malloc()/free() calls. Interface and class
+   driver data are still allocated from the heap, once per device at enumeration.
+   usbh_memory_stat() reports the high-water mark and failed allocations of each pool.               */
+
+#define MAX_UDEV_NUM           8       /*!< Maximum number of connected devices, hubs included        */
+#define MAX_UTR_NUM           32       /*!< Maximum number of transfer requests at the same time      */
+#define MAX_DESC_BUFF_NUM      (MAX_UDEV_NUM+1)  /*!< A configuration descriptor buffer per device,
+                                                      one more for temporary use                    */
 
 #define MAX_UDEV_DRIVER        8       /*!< Maximum number of registered drivers                      */
 #define MAX_ALT_PER_IFACE      8       /*!< maximum number of alternative interfaces per interface    */
@@ -61,9 +73,34 @@
    are all allocated from this pool. Allocated unit size is determined by MEM_POOL_UNIT_SIZE.
    May allocate one or more units depend on hardware descriptor type.                                 */
 
+#ifndef MEM_POOL_UNIT_SIZE
 #define MEM_POOL_UNIT_SIZE     64      /*!< A fixed hard coding setting. Do not change it!            */
+#endif
 #define MEM_POOL_UNIT_NUM     256      /*!< Increase this or heap size if memory allocate failed.     */
 
+/*----------------------------------------------------------------------------------------*/
+/*   Mass storage settings                                                                */
+/*----------------------------------------------------------------------------------------*/
+
+/* Sector cache of usbh_umas_read()/usbh_umas_write(). Small reads fill a whole line, small writes
+   are kept until the line is evicted or FatFs asks for CTRL_SYNC, then the dirty sectors of a
+   line are written with as few WRITE(10) as possible. Reads and writes of a line or more go to
+   the disk directly. Takes UMAS_CACHE_LINES * UMAS_CACHE_LINE_SECT * 512 bytes of RAM.        */
+
+#ifndef UMAS_CACHE_LINES
+#define UMAS_CACHE_LINES       4       /*!< Number of cache lines, 0 to disable the cache             */
+#endif
+#define UMAS_CACHE_LINE_SECT   8       /*!< Sectors per cache line, 1 to 32                           */
+#define UMAS_CACHE_READ_AHEAD  1       /*!< 1: read the next line in the background on sequential reads */
+
+/* USB Attached SCSI. The UAS alternate setting of a device is used instead of bulk-only when it has
+   one. Up to UMAS_UAS_QDEPTH commands are sent to the device, which runs them in any order.       */
+
+#define UMAS_USE_UAS           1       /*!< 1: prefer UAS over bulk-only transport                    */
+#ifndef UMAS_UAS_QDEPTH
+#define UMAS_UAS_QDEPTH        4       /*!< UAS commands outstanding per device, 1 to 16              */
+#endif
+
 /*----------------------------------------------------------------------------------------*/
 /*   Re-defined staff for various compiler                                                */
 /*----------------------------------------------------------------------------------------*/
@@ -80,6 +117,24 @@
 //#define ENABLE_VERBOSE_DEBUG              /* verbos debug messages                      */
 //#define DUMP_DESCRIPTOR                     /* dump descriptors                           */
 
+/* Transfer trace. Every UTR is timed from submit to done with USB_TRACE_TIMER(), counted in the
+   statistics of its endpoint and logged in a ring of events. See usbh_trace_dump(). With
+   ENABLE_USB_TRACE 0 the hooks in usb_core.c, ehci.c and ohci.c compile to nothing.             */
+
+#ifndef ENABLE_USB_TRACE
+#define ENABLE_USB_TRACE       0       /*!< 1: enable transfer trace                                  */
+#endif
+#define USB_TRACE_EP_NUM       16      /*!< Endpoints with statistics, the others are only logged     */
+#define USB_TRACE_RING_SIZE    256     /*!< Events in the trace ring, a power of 2 below 65536        */
+#define USB_TRACE_HIST_SHIFT   7       /*!< Latency histogram unit is 2^USB_TRACE_HIST_SHIFT ticks    */
+
+#ifndef USB_TRACE_TIMER                /* Cortex-M4 DWT cycle counter                                 */
+#define USB_TRACE_TIMER()      (DWT->CYCCNT)
+#define USB_TRACE_TIMER_INIT() do { CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+                                    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; } while (0)
+#define USB_TRACE_TIMER_MHZ    (SystemCoreClock / 1000000)
+#endif
+
 #ifdef ENABLE_ERROR_MSG
 #define USB_error            printf
 #else
@@ -108,6 +108,7 @@ enum OCHI_CC_CODE
 /* TD control field */
 #define TD_CC                     0xF0000000
 #define TD_CC_GET(td)             ((td >>28) & 0x0F)
+#define TD_EC_GET(td)             ((td >>26) & 0x03)
 #define TD_CC_SET(td, cc)         (td) = ((td) & 0x0FFFFFFF) | (((cc) & 0x0F) << 28)
 #define TD_T_DATA0                0x02000000
 #define TD_T_DATA1                0x03000000
@@ -327,6 +327,9 @@ typedef struct ep_info_t
     uint8_t     bToggle;
     uint16_t    wMaxPacketSize;
     void        *hw_pipe;               /*!< point to the HC assocaied endpoint    \hideinitializer */
+#if ENABLE_USB_TRACE
+    uint8_t     trace_idx;              /*!< trace statistics slot, a hint         \hideinitializer */
+#endif
 }   EP_INFO_T;
 
 typedef struct udev_t
@@ -394,6 +397,11 @@ typedef struct utr_t
     void        *context;             /*!< point to deivce proprietary data area \hideinitializer */
     FUNC_UTR_T  func;                 /*!< tansfer done call-back function       \hideinitializer */
     struct utr_t  *next;              /* point to the next UTR of the same endpoint. \hideinitializer */
+#if ENABLE_USB_TRACE
+    uint32_t    trace_t0;             /*!< USB_TRACE_TIMER() at submit           \hideinitializer */
+    uint8_t     trace_idx;            /*!< trace statistics slot of the endpoint \hideinitializer */
+    uint8_t     trace_retry;          /*!< transaction errors retried by the HC  \hideinitializer */
+#endif
 } UTR_T;
 
 
@@ -408,6 +416,14 @@ extern HC_DRV_T    ehci_driver;
 
 extern UDEV_T * g_udev_list;
 
+/*
+ *  Hub events, work for usbh_pooling_hubs() posted from interrupt context
+ */
+#define HUB_EV_EHCI_RH      0x1         /* EHCI root hub port change                      */
+#define HUB_EV_OHCI_RH      0x2         /* OHCI root hub status change                    */
+#define HUB_EV_HUB          0x4         /* status change of an external hub               */
+#define HUB_EV_ALL          0x7
+
 /*----------------------------------------------------------------------------------*/
 /*  USB stack exported functions                                                    */
 /*----------------------------------------------------------------------------------*/
@@ -433,6 +449,8 @@ extern void usbh_memory_init(void);
 extern uint32_t  usbh_memory_used(void);
 extern void * usbh_alloc_mem(int size);
 extern void usbh_free_mem(void *p, int size);
+extern uint8_t * usbh_alloc_desc_buff(void);
+extern void usbh_free_desc_buff(uint8_t *buff);
 extern int  alloc_dev_address(void);
 extern void free_dev_address(int dev_addr);
 extern UDEV_T * alloc_device(void);
@@ -454,6 +472,7 @@ extern void free_ehci_siTD(siTD_T *sitd);
 
 
 extern void usbh_hub_init(void);
+extern void usbh_hub_event(uint32_t events);
 extern int  connect_device(UDEV_T *);
 extern void disconnect_device(UDEV_T *);
 extern int  usbh_register_driver(UDEV_DRV_T *driver);
@@ -476,6 +495,21 @@ extern int usbh_iso_xfer(UTR_T *utr);
 extern int usbh_quit_utr(UTR_T *utr);
 extern int usbh_quit_xfer(UDEV_T *udev, EP_INFO_T *ep);
 
+/*
+ *  Transfer trace hooks, see usb_trace.c
+ */
+#if ENABLE_USB_TRACE
+extern void usbh_trace_submit(UTR_T *utr, EP_INFO_T *ep);
+extern void usbh_trace_done(UTR_T *utr, int status);
+#define USB_TRACE_SUBMIT(utr, ep)     usbh_trace_submit(utr, ep)
+#define USB_TRACE_DONE(utr, status)   usbh_trace_done(utr, status)
+#define USB_TRACE_RETRY(utr, n)       ((utr)->trace_retry += (n))
+#else
+#define USB_TRACE_SUBMIT(utr, ep)
+#define USB_TRACE_DONE(utr, status)
+#define USB_TRACE_RETRY(utr, n)
+#endif
+
 
 /// @endcond HIDDEN_SYMBOLS
 
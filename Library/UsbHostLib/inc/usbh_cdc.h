@@ -30,6 +30,19 @@ extern "C"
 #define CDC_STATUS_BUFF_SIZE    64
 #define CDC_RX_BUFF_SIZE        64
 
+#ifndef CDC_RX_UTR_NUM
+#define CDC_RX_UTR_NUM          4           /* bulk-in transfers in flight in ring mode  */
+#endif
+#ifndef CDC_RX_XFER_SIZE
+#define CDC_RX_XFER_SIZE        512         /* bytes per bulk-in transfer in ring mode   */
+#endif
+#ifndef CDC_TX_UTR_NUM
+#define CDC_TX_UTR_NUM          2           /* bulk-out transfers in flight in ring mode */
+#endif
+#ifndef CDC_TX_XFER_SIZE
+#define CDC_TX_XFER_SIZE        1024        /* maximum bytes per bulk-out transfer       */
+#endif
+
 /* Interface Class Codes (defined in usbh.h) */
 //#define USB_CLASS_COMM        0x02
 //#define USB_CLASS_DATA        0x0A
@@ -168,6 +181,24 @@ typedef struct __attribute__((__packed__)) line_coding_t
 }  LINE_CODING_T;
 #endif
 
+/*
+ *  Ring mode statistics, see usbh_cdc_get_stat()
+ */
+typedef struct cdc_stat_t
+{
+    uint32_t   rx_bytes;               /* Bytes received into the receive ring                    */
+    uint32_t   rx_xfers;               /* Bulk-in transfers done                                  */
+    uint32_t   rx_full;                /* Bulk-in transfers held back because the ring was full   */
+    uint32_t   rx_errors;              /* Bulk-in transfers failed                                */
+    uint32_t   rx_peak;                /* Highest number of bytes in the receive ring             */
+    uint32_t   rx_rate;                /* Bytes per second received since the previous call       */
+    uint32_t   tx_bytes;               /* Bytes sent from the send ring                           */
+    uint32_t   tx_xfers;               /* Bulk-out transfers done                                 */
+    uint32_t   tx_full;                /* usbh_cdc_send_data() calls refused, send ring full      */
+    uint32_t   tx_errors;              /* Bulk-out transfers failed, their data is lost           */
+    uint32_t   tx_rate;                /* Bytes per second sent since the previous call           */
+}  CDC_STAT_T;
+
 /*
  * USB-specific CDC device struct
  */
@@ -187,6 +218,24 @@ typedef struct cdc_dev_t
     CDC_CB_FUNC         *sts_func;      /* Interrupt in data received callback                */
     CDC_CB_FUNC         *rx_func;       /* Bulk in data received callabck                     */
     uint8_t             rx_busy;        /* Bulk in transfer is on going                       */
+    uint8_t             rx_parked;      /* Ring mode bulk in URBs waiting for room, bit mask  */
+    uint8_t             tx_busy;        /* Ring mode bulk out URBs in transfer, bit mask      */
+    UTR_T               *utr_rx_ring[CDC_RX_UTR_NUM];   /* Ring mode bulk in URBs             */
+    uint8_t             *rx_ring;       /* Receive ring, NULL if not in ring mode             */
+    uint32_t            rx_ring_size;
+    volatile uint32_t   rx_wr;          /* Bytes written to the receive ring, free running    */
+    volatile uint32_t   rx_rd;          /* Bytes read from the receive ring, free running     */
+    uint32_t            rx_reserved;    /* Room kept in the ring for bulk in URBs in flight   */
+    UTR_T               *utr_tx_ring[CDC_TX_UTR_NUM];   /* Ring mode bulk out URBs            */
+    uint8_t             *tx_ring;       /* Send ring, NULL if not in ring mode                */
+    uint32_t            tx_ring_size;
+    volatile uint32_t   tx_wr;          /* Bytes queued in the send ring, free running        */
+    uint32_t            tx_sched;       /* Bytes given to bulk out URBs, free running         */
+    volatile uint32_t   tx_rd;          /* Bytes sent, free running                           */
+    CDC_STAT_T          stat;           /* Ring mode statistics                               */
+    uint32_t            stat_ticks;     /* Time of the previous usbh_cdc_get_stat()           */
+    uint32_t            stat_rx_bytes;  /* rx_bytes at the previous usbh_cdc_get_stat()       */
+    uint32_t            stat_tx_bytes;  /* tx_bytes at the previous usbh_cdc_get_stat()       */
     struct cdc_dev_t    *next;
 }   CDC_DEV_T;
 
@@ -36,6 +36,7 @@ extern "C"
 
 #define CONFIG_HID_MAX_DEV          4      /*!< Maximum number of HID devices (interface) allowed at the same time.  */
 #define CONFIG_HID_DEV_MAX_PIPE     8      /*!< Maximum number of interrupt in/out pipes allowed per HID device      */
+#define CONFIG_HID_MAX_REPORT       16     /*!< Maximum number of reports (report ID and type) in a report map       */
 
 /// @cond HIDDEN_SYMBOLS
 #define USB_DT_HID                  (REQ_TYPE_CLASS_DEV | 0x01)
@@ -54,6 +55,18 @@ extern "C"
 #define RT_OUTPUT                   2      /*!< Report type: Output              \hideinitializer */
 #define RT_FEATURE                  3      /*!< Report type: Feature             \hideinitializer */
 
+/* HID field flags, bits 7~0 of the Input, Output or Feature item */
+#define HID_FIELD_CONSTANT          0x01   /*!< Constant, not data               \hideinitializer */
+#define HID_FIELD_VARIABLE          0x02   /*!< Variable, else array             \hideinitializer */
+#define HID_FIELD_RELATIVE          0x04   /*!< Relative, else absolute          \hideinitializer */
+#define HID_FIELD_WRAP              0x08   /*!< Wrap                             \hideinitializer */
+#define HID_FIELD_NONLINEAR         0x10   /*!< Non linear                       \hideinitializer */
+#define HID_FIELD_NO_PREFERRED      0x20   /*!< No preferred state               \hideinitializer */
+#define HID_FIELD_NULL_STATE        0x40   /*!< Has null state                   \hideinitializer */
+#define HID_FIELD_VOLATILE          0x80   /*!< Volatile (Output and Feature)    \hideinitializer */
+
+#define HID_USAGE(page, id)         (((uint32_t)(page) << 16) | (id))   /*!< Usage of a usage page and usage ID  \hideinitializer */
+
 
 /*@}*/ /* end of group USBH_EXPORTED_CONSTANTS */
 
@@ -81,6 +94,44 @@ typedef struct usbhid_dev
     struct usbhid_dev   *next;          /*!< Point to the next HID device                      */
 } HID_DEV_T;                            /*! HID device structure                               */
 
+/*---------------------------------------------------------------------------------------------*/
+/*  Report descriptor compiled by usbh_hid_parse_report_map()                                  */
+/*---------------------------------------------------------------------------------------------*/
+/*! A field of a report: report count elements of the same usage and size \hideinitializer     */
+typedef struct hid_field_t
+{
+    uint32_t      usage;                /*!< Usage page in bits 31~16, usage ID in bits 15~0. The usage minimum of arrays */
+    int32_t       logical_min;          /*!< Logical minimum                                   */
+    int32_t       logical_max;          /*!< Logical maximum                                   */
+    uint32_t      mask;                 /*!< Mask of bit_size bits                             */
+    uint16_t      bit_offset;           /*!< Bit offset of the first element in the report, including the report ID byte */
+    uint16_t      count;                /*!< Number of elements                                */
+    uint8_t       bit_size;             /*!< Bits per element, 1 to 32                         */
+    uint8_t       sign_shift;           /*!< 32 - bit_size if logical_min is negative, else 0  */
+    uint8_t       report_id;            /*!< Report ID, 0 if the device has no report IDs      */
+    uint8_t       report_type;          /*!< RT_INPUT, RT_OUTPUT or RT_FEATURE                 */
+    uint8_t       flags;                /*!< HID_FIELD_CONSTANT, HID_FIELD_VARIABLE, ...       */
+} HID_FIELD_T;
+
+/*! Size of a report \hideinitializer                                                          */
+typedef struct hid_report_t
+{
+    uint8_t       id;                   /*!< Report ID                                         */
+    uint8_t       type;                 /*!< RT_INPUT, RT_OUTPUT or RT_FEATURE                 */
+    uint16_t      bits;                 /*!< Report size in bits, not including the report ID byte */
+} HID_REPORT_T;
+
+/*! Report map \hideinitializer                                                                */
+typedef struct hid_report_map_t
+{
+    HID_FIELD_T   *field;               /*!< Field table supplied by the caller                */
+    uint16_t      max_field;            /*!< Number of entries of the field table              */
+    uint16_t      num_field;            /*!< Number of fields parsed                           */
+    uint8_t       num_report;           /*!< Number of reports parsed                          */
+    uint8_t       report_id_used;       /*!< Reports start with a report ID byte               */
+    HID_REPORT_T  report[CONFIG_HID_MAX_REPORT];  /*!< Reports                                 */
+} HID_REPORT_MAP_T;
+
 /*@}*/ /* end of group USBH_EXPORTED_STRUCTURES */
 
 
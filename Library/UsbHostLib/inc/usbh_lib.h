@@ -112,17 +112,124 @@ extern "C"
 struct udev_t;
 typedef void (CONN_FUNC)(struct udev_t *udev, int param);
 
+typedef void (HUB_EVENT_FUNC)(void);        /*!< hub event callback function, called in interrupt context \hideinitializer */
+
 struct line_coding_t;
 struct cdc_dev_t;
+struct cdc_stat_t;
 typedef void (CDC_CB_FUNC)(struct cdc_dev_t *cdev, uint8_t *rdata, int data_len);
 
 struct usbhid_dev;
+struct hid_report_map_t;
+struct hid_field_t;
 typedef void (HID_IR_FUNC)(struct usbhid_dev *hdev, uint16_t ep_addr, int status, uint8_t *rdata, uint32_t data_len);    /*!< interrupt in callback function \hideinitializer */
 typedef void (HID_IW_FUNC)(struct usbhid_dev *hdev, uint16_t ep_addr, int status, uint8_t *wbuff, uint32_t *data_len);   /*!< interrupt out callback function \hideinitializer */
 
 struct uac_dev_t;
+struct uac_ring_t;
 typedef int (UAC_CB_FUNC)(struct uac_dev_t *dev, uint8_t *data, int len);    /*!< audio in callback function \hideinitializer */
 
+struct umas_req_t;
+typedef void (UMAS_DONE_FUNC)(struct umas_req_t *req);   /*!< mass storage request done callback function \hideinitializer */
+
+/*! Mass storage read/write request, see usbh_umas_read_async() and usbh_umas_write_async() \hideinitializer */
+typedef struct umas_req_t
+{
+    int             drv_no;                 /*!< FATFS drive volume number                     */
+    uint32_t        sec_no;                 /*!< Sector number of the start sector             */
+    int             sec_cnt;                /*!< Number of sectors                             */
+    uint8_t         *buff;                  /*!< Data buffer                                   */
+    UMAS_DONE_FUNC  *func;                  /*!< Called when done, may be in interrupt context */
+    void            *context;               /*!< Free for use by the caller                    */
+    volatile uint8_t  bIsDone;              /*!< Request done?                                 */
+    int             status;                 /*!< 0 on success, otherwise an error code         */
+    /// @cond HIDDEN_SYMBOLS
+    uint32_t        cbw[8];                 /* command block wrapper, word aligned             */
+    uint8_t         bIsDataIn;              /* data phase direction                            */
+    int             timeout;                /* ticks from the start of the command             */
+    void            *msc;                   /* MSC_T of the LUN                                */
+    struct umas_req_t *next;                /* next request in the queue of the device         */
+    /// @endcond HIDDEN_SYMBOLS
+} UMAS_REQ_T;
+
+/*! Sector cache statistics of usbh_umas_read() and usbh_umas_write(), see usbh_umas_cache_stat() \hideinitializer */
+typedef struct
+{
+    uint32_t  read_sect;                    /*!< Sectors read                                  */
+    uint32_t  read_hit;                     /*!< Sectors read from the cache                   */
+    uint32_t  ra_hit;                       /*!< Sectors read from lines filled by read-ahead  */
+    uint32_t  write_sect;                   /*!< Sectors written                               */
+    uint32_t  read_cmds;                    /*!< READ(10) commands issued, read-ahead included */
+    uint32_t  ra_cmds;                      /*!< READ(10) commands issued by read-ahead        */
+    uint32_t  write_cmds;                   /*!< WRITE(10) commands issued                     */
+} UMAS_CACHE_STAT_T;
+
+/*! Current and maximum number of descriptors in use \hideinitializer */
+typedef struct
+{
+    uint16_t  used;                         /*!< Number in use                                 */
+    uint16_t  max_used;                     /*!< High-water mark of used                       */
+} USBH_MEM_CNT_T;
+
+/*! Host controller descriptor pool, object pool and heap usage, see usbh_memory_stat() \hideinitializer */
+typedef struct
+{
+    USBH_MEM_CNT_T  pool;                   /*!< Pool units, MEM_POOL_UNIT_SIZE bytes each     */
+    USBH_MEM_CNT_T  ed;                     /*!< OHCI EDs                                      */
+    USBH_MEM_CNT_T  td;                     /*!< OHCI TDs                                      */
+    USBH_MEM_CNT_T  qh;                     /*!< EHCI QHs                                      */
+    USBH_MEM_CNT_T  qtd;                    /*!< EHCI qTDs                                     */
+    USBH_MEM_CNT_T  itd;                    /*!< EHCI iTDs, two pool units each                */
+    USBH_MEM_CNT_T  sitd;                   /*!< EHCI siTDs                                    */
+    USBH_MEM_CNT_T  utr;                    /*!< Transfer requests (UTR_T)                     */
+    USBH_MEM_CNT_T  udev;                   /*!< Devices (UDEV_T)                              */
+    USBH_MEM_CNT_T  desc_buff;              /*!< Descriptor buffers, MAX_DESC_BUFF_SIZE bytes  */
+    uint32_t  alloc_fail;                   /*!< Descriptor allocations failed, pool full      */
+    uint32_t  utr_fail;                     /*!< UTR allocations failed, MAX_UTR_NUM in use    */
+    uint32_t  udev_fail;                    /*!< Device allocations failed, MAX_UDEV_NUM in use */
+    uint32_t  desc_buff_fail;               /*!< Descriptor buffer allocations failed, MAX_DESC_BUFF_NUM in use */
+    uint32_t  heap_calls;                   /*!< malloc() and free() calls made by the library */
+    int32_t   heap_used;                    /*!< Bytes of heap in use by USB Host library      */
+    int32_t   heap_max_used;                /*!< High-water mark of heap_used                  */
+} USBH_MEM_STAT_T;
+
+#define USBH_TRACE_HIST_NUM     16          /*!< Buckets of the trace histograms \hideinitializer */
+#define USBH_TRACE_SUBMIT       1           /*!< Trace event of a UTR submitted  \hideinitializer */
+#define USBH_TRACE_DONE         2           /*!< Trace event of a UTR done       \hideinitializer */
+
+/*! Transfer statistics of an endpoint, see usbh_trace_get_ep() \hideinitializer */
+typedef struct
+{
+    uint8_t   dev_num;                      /*!< Device number                                 */
+    uint8_t   ep_addr;                      /*!< Endpoint address, 0 for the control pipe      */
+    uint8_t   ep_type;                      /*!< EP_ATTR_TT_CTRL/ISO/BULK/INT                  */
+    uint32_t  xfers;                        /*!< Transfers done                                */
+    uint32_t  bytes;                        /*!< Bytes transferred                             */
+    uint32_t  short_xfers;                  /*!< Transfers ended by a short packet             */
+    uint32_t  halts;                        /*!< Transfers failed, the endpoint halted         */
+    uint32_t  aborts;                       /*!< Transfers quit, aborted or timed out          */
+    uint32_t  retries;                      /*!< Transaction errors retried by the controller  */
+    uint32_t  lat_max;                      /*!< Longest submit to done time, timer ticks      */
+    uint32_t  lat_hist[USBH_TRACE_HIST_NUM];  /*!< Submit to done time. [0] below one unit of
+                                                   2^USB_TRACE_HIST_SHIFT ticks, [i] below 2^i
+                                                   units, the last one all longer              */
+    uint32_t  size_hist[USBH_TRACE_HIST_NUM]; /*!< Bytes transferred. [0] none, [i] below 2^i,
+                                                   the last one all larger                     */
+} USBH_TRACE_EP_T;
+
+/*! Trace event, see usbh_trace_read() \hideinitializer */
+typedef struct
+{
+    uint32_t  time;                         /*!< USB_TRACE_TIMER() at the event                */
+    uint32_t  len;                          /*!< Submit: bytes requested, done: transferred    */
+    int16_t   status;                       /*!< Done: transfer status                         */
+    uint8_t   dev_num;                      /*!< Device number                                 */
+    uint8_t   ep_addr;                      /*!< Endpoint address                              */
+    uint8_t   type;                         /*!< USBH_TRACE_SUBMIT or USBH_TRACE_DONE          */
+    uint8_t   retries;                      /*!< Done: transaction errors retried              */
+    uint16_t  seq;                          /*!< Internal, marks the event written             */
+} USBH_TRACE_EVT_T;
+
 /*@}*/ /* end of group USBH_EXPORTED_STRUCT */
 
 
@@ -139,8 +246,21 @@ typedef int (UAC_CB_FUNC)(struct uac_dev_t *dev, uint8_t *data, int len);    /*!
 extern void usbh_core_init(void);
 extern int  usbh_pooling_hubs(void);
 extern void usbh_install_conn_callback(CONN_FUNC *conn_func, CONN_FUNC *disconn_func);
+extern void usbh_install_hub_event_callback(HUB_EVENT_FUNC *func);
+extern int  usbh_hub_event_pending(void);
 extern void usbh_suspend(void);
 extern void usbh_resume(void);
+
+/*------------------------------------------------------------------*/
+/*                                                                  */
+/*  USB Host transfer trace APIs, ENABLE_USB_TRACE of config.h      */
+/*                                                                  */
+/*------------------------------------------------------------------*/
+extern void usbh_trace_reset(void);
+extern USBH_TRACE_EP_T * usbh_trace_get_ep(int idx);
+extern int  usbh_trace_read(USBH_TRACE_EVT_T *evt, int max);
+extern uint32_t usbh_trace_lost(void);
+extern void usbh_trace_dump(void);
 extern struct udev_t * usbh_find_device(char *hub_id, int port);
 /**
  * @brief  A function return current tick count.
@@ -165,6 +285,12 @@ extern int32_t  usbh_cdc_set_control_line_state(struct cdc_dev_t *cdev, int acti
 extern int32_t  usbh_cdc_start_polling_status(struct cdc_dev_t *cdev, CDC_CB_FUNC *func);
 extern int32_t  usbh_cdc_start_to_receive_data(struct cdc_dev_t *cdev, CDC_CB_FUNC *func);
 extern int32_t  usbh_cdc_send_data(struct cdc_dev_t *cdev, uint8_t *buff, int buff_len);
+extern int32_t  usbh_cdc_start_receive_ring(struct cdc_dev_t *cdev, uint8_t *ring, uint32_t ring_size);
+extern int32_t  usbh_cdc_read(struct cdc_dev_t *cdev, uint8_t *buff, uint32_t buff_len);
+extern int32_t  usbh_cdc_set_send_ring(struct cdc_dev_t *cdev, uint8_t *ring, uint32_t ring_size);
+extern int32_t  usbh_cdc_send_pending(struct cdc_dev_t *cdev);
+extern void     usbh_cdc_stop_ring(struct cdc_dev_t *cdev);
+extern void     usbh_cdc_get_stat(struct cdc_dev_t *cdev, struct cdc_stat_t *stat);
 
 
 /*------------------------------------------------------------------*/
@@ -185,6 +311,10 @@ extern int32_t  usbh_hid_start_int_read(struct usbhid_dev *hdev, uint8_t ep_addr
 extern int32_t  usbh_hid_stop_int_read(struct usbhid_dev *hdev, uint8_t ep_addr);
 extern int32_t  usbh_hid_start_int_write(struct usbhid_dev *hdev, uint8_t ep_addr, HID_IW_FUNC *func);
 extern int32_t  usbh_hid_stop_int_write(struct usbhid_dev *hdev, uint8_t ep_addr);
+extern int32_t  usbh_hid_parse_report_map(uint8_t *desc, int desc_len, struct hid_report_map_t *map);
+extern struct hid_field_t * usbh_hid_find_field(struct hid_report_map_t *map, int rtp_typ, uint32_t usage);
+extern int32_t  usbh_hid_report_length(struct hid_report_map_t *map, int rtp_typ, int rtp_id);
+extern int32_t  usbh_hid_get_field(struct hid_field_t *field, int idx, uint8_t *data, uint32_t data_len, int32_t *value);
 
 /*------------------------------------------------------------------*/
 /*                                                                  */
@@ -196,6 +326,12 @@ extern int  usbh_umas_disk_status(int drv_no);
 extern int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
 extern int  usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
 extern int  usbh_umas_ioctl(int drv_no, int cmd, void *buff);
+extern int  usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff,
+                                 UMAS_REQ_T *req, UMAS_DONE_FUNC *func, void *context);
+extern int  usbh_umas_write_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff,
+                                  UMAS_REQ_T *req, UMAS_DONE_FUNC *func, void *context);
+extern void usbh_umas_poll(void);
+extern void usbh_umas_cache_stat(UMAS_CACHE_STAT_T *stat);
 /// @cond HIDDEN_SYMBOLS
 extern int  usbh_umas_reset_disk(int drv_no);
 /// @endcond HIDDEN_SYMBOLS
@@ -218,6 +354,13 @@ extern int usbh_uac_start_audio_in(struct uac_dev_t *uac, UAC_CB_FUNC *func);
 extern int usbh_uac_stop_audio_in(struct uac_dev_t *audev);
 extern int usbh_uac_start_audio_out(struct uac_dev_t *uac, UAC_CB_FUNC *func);
 extern int usbh_uac_stop_audio_out(struct uac_dev_t *audev);
+extern int usbh_uac_start_audio_in_ring(struct uac_dev_t *uac, struct uac_ring_t *ring);
+extern int usbh_uac_start_audio_out_ring(struct uac_dev_t *uac, struct uac_ring_t *ring);
+extern uint8_t * usbh_uac_ring_read_ptr(struct uac_ring_t *ring, uint32_t *len);
+extern void usbh_uac_ring_read_done(struct uac_ring_t *ring, uint32_t len);
+extern uint8_t * usbh_uac_ring_write_ptr(struct uac_ring_t *ring, uint32_t *len);
+extern void usbh_uac_ring_write_done(struct uac_ring_t *ring, uint32_t len);
+extern uint32_t usbh_uac_ring_latency(struct uac_ring_t *ring);
 
 
 /// @cond HIDDEN_SYMBOLS
@@ -227,6 +370,7 @@ extern void dump_ehci_regs(void);
 extern void dump_ohci_ports(void);
 extern void dump_ehci_ports(void);
 extern uint32_t  usbh_memory_used(void);
+extern void  usbh_memory_stat(USBH_MEM_STAT_T *stat);
 
 /// @endcond HIDDEN_SYMBOLS
 
@@ -73,6 +73,34 @@
 */
 
 
+/*----------------------------------------------------------------------------------------*/
+/*  Audio stream ring buffer, see usbh_uac_start_audio_in_ring()                          */
+/*----------------------------------------------------------------------------------------*/
+typedef struct uac_ring_t
+{
+    /* Set by the caller before the stream is started */
+    uint8_t        *buff;                   /*!< PCM ring memory, including the guard area at its end */
+    uint32_t       buff_size;               /*!< Size of buff in bytes                    */
+    uint32_t       srate;                   /*!< Sampling rate in Hz. 0: the first rate of the format descriptor */
+    uint32_t       lo_mark;                 /*!< Audio out: send shorter packets below this level. 0: 1/4 of the ring */
+    uint32_t       hi_mark;                 /*!< Audio out: send longer packets above this level. 0: 3/4 of the ring */
+    /* Set by usbh_uac_start_audio_in_ring() or usbh_uac_start_audio_out_ring() */
+    uint32_t       size;                    /*!< Ring size in bytes, a multiple of frame_size */
+    uint16_t       frame_size;              /*!< Bytes per sample frame, all channels     */
+    volatile uint32_t  wr;                  /*!< Bytes written to the ring, free running  */
+    volatile uint32_t  rd;                  /*!< Bytes read from the ring, free running   */
+    uint32_t       packets;                 /*!< Isochronous packets transferred          */
+    uint32_t       xrun;                    /*!< Audio in packets dropped on a full ring, audio out packets cut short by an empty ring */
+    uint32_t       adj_up;                  /*!< Audio out packets sent one sample frame longer */
+    uint32_t       adj_down;                /*!< Audio out packets sent one sample frame shorter */
+    /// @cond HIDDEN_SYMBOLS
+    uint32_t       sched;                   /* audio out: end of the data given to UTRs   */
+    uint32_t       acc;                     /* audio out: sampling rate accumulator       */
+    uint32_t       pkt_rate;                /* isochronous packets per second             */
+    uint32_t       utr_len[NUM_UTR];        /* audio out: bytes of the ring in each UTR   */
+    /// @endcond HIDDEN_SYMBOLS
+}  UAC_RING_T;
+
 /*----------------------------------------------------------------------------------------*/
 /*  Audio Control Interface                                                               */
 /*----------------------------------------------------------------------------------------*/
@@ -98,6 +126,7 @@ typedef struct as_if_t
     AC_OT_T        *ot;                     /*!< Point to the Output Terminal connected with USB IN endpoint */
     AS_FT1_T       *ft;                     /*!< Point to Format type descriptor, support Type-I only */
     CS_EP_T        *cs_epd;                 /*!< Point to AS Isochronous Audio Data Endpoint Descriptor */
+    UAC_RING_T     *ring;                   /*!< Ring buffer of the stream, NULL if callback mode */
     uint8_t        flag_streaming;          /*!< audio is streaming or not                */
 }  AS_IF_T;
 
@@ -128,6 +157,7 @@ extern int uac_parse_control_interface(UAC_DEV_T *uac, IFACE_T *iface);
 extern int uac_parse_streaming_interface(UAC_DEV_T *uac, IFACE_T *iface, uint8_t bAlternateSetting);
 extern int usbh_uac_find_best_alt(IFACE_T *iface, uint8_t dir, uint8_t attr, int pkt_sz, uint8_t *bAlternateSetting);
 extern int usbh_uac_find_max_alt(IFACE_T *iface, uint8_t dir, uint8_t attr, uint8_t *bAlternateSetting);
+extern int uac_open_stream(UAC_DEV_T *uac, AS_IF_T *asif, uint8_t dir);
 
 /// @endcond HIDDEN_SYMBOLS
 
@@ -31,6 +31,8 @@
 
 /// @cond HIDDEN_SYMBOLS
 #define USB_XFER_TIMEOUT             100
+
+extern int32_t cdc_ring_send(CDC_DEV_T *cdev, uint8_t *buff, int buff_len);
 /// @endcond /* HIDDEN_SYMBOLS */
 
 /**
@@ -314,6 +316,9 @@ int32_t usbh_cdc_start_to_receive_data(CDC_DEV_T *cdev, CDC_CB_FUNC *func)
     if (!func)
         return USBH_ERR_INVALID_PARAM;
 
+    if (cdev->rx_ring != NULL)
+        return USBH_ERR_NOT_EXPECTED;       /* receiving in ring mode                     */
+
     ep = cdev->ep_rx;
     if (ep == NULL)
     {
@@ -372,6 +377,8 @@ static void  cdc_bulk_out_irq(UTR_T *utr)
 /// @endcond /* HIDDEN_SYMBOLS */
 /**
  * @brief  Send a block of data via CDC device's bulk-out transfer pipe.
+ *         If a send ring was set by usbh_cdc_set_send_ring(), the data is queued and the
+ *         function returns at once, or returns USBH_ERR_MEMORY_OUT if the ring has no room.
  *  @param[in] cdev      CDC device
  *  @param[in] buff      Buffer contains the data block to be send.
  *  @param[in] buff_len  Length in byte of data to be send
@@ -389,6 +396,9 @@ int32_t usbh_cdc_send_data(CDC_DEV_T *cdev, uint8_t *buff, int buff_len)
     if ((cdev == NULL) || (cdev->iface_data == NULL))
         return USBH_ERR_NOT_FOUND;
 
+    if (cdev->tx_ring != NULL)
+        return cdc_ring_send(cdev, buff, buff_len);
+
     ep = cdev->ep_tx;
     if (ep == NULL)
     {
@@ -236,6 +236,7 @@ static void  cdc_disconnect(IFACE_T *iface)
         free_utr(cdev->utr_rx);
         cdev->utr_rx = NULL;
     }
+    usbh_cdc_stop_ring(cdev);                    /* Release ring mode UTRs                     */
 
     if_cdc->context = NULL;
     if_data->context = NULL;
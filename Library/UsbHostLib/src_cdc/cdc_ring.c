@@ -0,0 +1,524 @@
+/**************************************************************************//**
+ * @file     cdc_ring.c
+ * @version  V1.00
+ * @brief    M480 MCU USB Host CDC library, ring buffered bulk transfer
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "NuMicro.h"
+
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_cdc.h"
+
+
+/** @addtogroup LIBRARY Library
+  @{
+*/
+
+/** @addtogroup USBH_Library USB Host Library
+  @{
+*/
+
+/** @addtogroup USBH_EXPORTED_FUNCTIONS USB Host Exported Functions
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/*
+ *  In ring mode the bulk-in pipe is kept busy with CDC_RX_UTR_NUM transfers, so that the
+ *  device never waits for the application to start the next one, and the data is appended to
+ *  a receive ring of the application. wr and rd of both rings are free running byte counters,
+ *  a ring holds wr - rd bytes.
+ *
+ *  A bulk-in transfer is submitted only when the receive ring has room for all of its data
+ *  besides the room kept for the transfers already in flight. Otherwise it is parked and the
+ *  device is NAKed until usbh_cdc_read() frees the room, so no received byte is ever dropped.
+ *
+ *  Bulk-out transfers are sent from the send ring itself. Each one takes the data from
+ *  tx_sched up to the ring end or CDC_TX_XFER_SIZE bytes. Transfers of an endpoint complete in
+ *  the order they were submitted, which is what tx_rd relies on.
+ */
+
+static void  rx_submit(CDC_DEV_T *cdev, int idx)
+{
+    UTR_T      *utr = cdev->utr_rx_ring[idx];
+    uint32_t   room;
+    int        ret;
+
+    room = cdev->rx_ring_size - (cdev->rx_wr - cdev->rx_rd) - cdev->rx_reserved;
+    if (room < utr->data_len)
+    {
+        cdev->rx_parked |= (1 << idx);
+        cdev->stat.rx_full++;
+        return;
+    }
+
+    cdev->rx_reserved += utr->data_len;
+    utr->xfer_len = 0;
+    ret = usbh_bulk_xfer(utr);
+    if (ret < 0)
+    {
+        CDC_DBGMSG("Error - failed to submit bulk in request (%d)", ret);
+        cdev->rx_reserved -= utr->data_len;
+        cdev->stat.rx_errors++;
+    }
+}
+
+/*
+ * CDC BULK-in complete function of ring mode
+ */
+static void  cdc_ring_in_irq(UTR_T *utr)
+{
+    CDC_DEV_T   *cdev = (CDC_DEV_T *)utr->context;
+    uint32_t    off, len, n;
+    int         idx;
+
+    if (cdev->rx_ring == NULL)
+        return;
+
+    cdev->rx_reserved -= utr->data_len;
+
+    if (utr->status)
+    {
+        /* The transfer is not resubmitted, the pipe probably halted. */
+        CDC_DBGMSG("cdc_ring_in_irq - has error: 0x%x\n", utr->status);
+        cdev->stat.rx_errors++;
+        return;
+    }
+
+    len = utr->xfer_len;
+    off = cdev->rx_wr % cdev->rx_ring_size;
+    n = cdev->rx_ring_size - off;
+    if (n > len)
+        n = len;
+    memcpy(cdev->rx_ring + off, utr->buff, n);
+    memcpy(cdev->rx_ring, utr->buff + n, len - n);
+    cdev->rx_wr += len;
+
+    cdev->stat.rx_bytes += len;
+    cdev->stat.rx_xfers++;
+    if (cdev->rx_wr - cdev->rx_rd > cdev->stat.rx_peak)
+        cdev->stat.rx_peak = cdev->rx_wr - cdev->rx_rd;
+
+    for (idx = 0; idx < CDC_RX_UTR_NUM; idx++)
+    {
+        if (cdev->utr_rx_ring[idx] == utr)
+            break;
+    }
+    rx_submit(cdev, idx);
+}
+
+/* Give the queued data to idle bulk-out UTRs. Called with interrupts disabled or from the IRQ. */
+static void  tx_kick(CDC_DEV_T *cdev)
+{
+    UTR_T      *utr;
+    uint32_t   off, len;
+    int        idx, ret;
+
+    for (idx = 0; (idx < CDC_TX_UTR_NUM) && (cdev->tx_sched != cdev->tx_wr); idx++)
+    {
+        if (cdev->tx_busy & (1 << idx))
+            continue;
+
+        off = cdev->tx_sched % cdev->tx_ring_size;
+        len = cdev->tx_wr - cdev->tx_sched;
+        if (len > cdev->tx_ring_size - off)
+            len = cdev->tx_ring_size - off;
+        if (len > CDC_TX_XFER_SIZE)
+            len = CDC_TX_XFER_SIZE;
+
+        utr = cdev->utr_tx_ring[idx];
+        utr->buff = cdev->tx_ring + off;
+        utr->data_len = len;
+        utr->xfer_len = 0;
+        cdev->tx_sched += len;
+
+        cdev->tx_busy |= (1 << idx);
+        ret = usbh_bulk_xfer(utr);
+        if (ret < 0)
+        {
+            /* The data is dropped, otherwise a dead pipe would hold the ring forever. */
+            CDC_DBGMSG("Error - failed to submit bulk out request (%d)", ret);
+            cdev->tx_busy &= ~(1 << idx);
+            cdev->tx_rd += len;
+            cdev->stat.tx_errors++;
+        }
+    }
+}
+
+/*
+ * CDC BULK-out complete function of ring mode
+ */
+static void  cdc_ring_out_irq(UTR_T *utr)
+{
+    CDC_DEV_T   *cdev = (CDC_DEV_T *)utr->context;
+    int         idx;
+
+    if (cdev->tx_ring == NULL)
+        return;
+
+    for (idx = 0; idx < CDC_TX_UTR_NUM; idx++)
+    {
+        if (cdev->utr_tx_ring[idx] == utr)
+            cdev->tx_busy &= ~(1 << idx);
+    }
+
+    cdev->tx_rd += utr->data_len;
+    if (utr->status)
+    {
+        CDC_DBGMSG("cdc_ring_out_irq - has error: 0x%x\n", utr->status);
+        cdev->stat.tx_errors++;
+    }
+    else
+    {
+        cdev->stat.tx_bytes += utr->xfer_len;
+        cdev->stat.tx_xfers++;
+    }
+
+    tx_kick(cdev);
+}
+
+static void  free_rx_ring(CDC_DEV_T *cdev)
+{
+    int   i;
+
+    for (i = 0; i < CDC_RX_UTR_NUM; i++)
+    {
+        if (cdev->utr_rx_ring[i] == NULL)
+            continue;
+        if (cdev->utr_rx_ring[i]->buff)
+            usbh_free_mem(cdev->utr_rx_ring[i]->buff, cdev->utr_rx_ring[i]->data_len);
+        free_utr(cdev->utr_rx_ring[i]);
+        cdev->utr_rx_ring[i] = NULL;
+    }
+    cdev->rx_ring = NULL;
+    cdev->rx_parked = 0;
+    cdev->rx_reserved = 0;
+}
+
+static void  free_tx_ring(CDC_DEV_T *cdev)
+{
+    int   i;
+
+    for (i = 0; i < CDC_TX_UTR_NUM; i++)
+    {
+        if (cdev->utr_tx_ring[i] == NULL)
+            continue;
+        free_utr(cdev->utr_tx_ring[i]);
+        cdev->utr_tx_ring[i] = NULL;
+    }
+    cdev->tx_ring = NULL;
+    cdev->tx_busy = 0;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+ *  @brief  Make CDC device receive bulk-in data into a ring buffer.
+ *          CDC_RX_UTR_NUM bulk-in transfers are kept in flight and the data is read with
+ *          usbh_cdc_read(). When the ring is full the device is held off, no data is dropped.
+ *          Ring mode and usbh_cdc_start_to_receive_data() exclude each other.
+ *  @param[in] cdev        CDC device
+ *  @param[in] ring        Receive ring buffer
+ *  @param[in] ring_size   Size in bytes of the ring buffer. Should be several CDC_RX_XFER_SIZE.
+ *  @return   Success or not.
+ * @retval   0           Success
+ * @retval   Otherwise   Failed
+ */
+int32_t usbh_cdc_start_receive_ring(CDC_DEV_T *cdev, uint8_t *ring, uint32_t ring_size)
+{
+    EP_INFO_T   *ep;
+    UTR_T       *utr;
+    uint32_t    xfer_size, primask;
+    int         i;
+
+    if ((cdev == NULL) || (cdev->iface_data == NULL))
+        return USBH_ERR_NOT_FOUND;
+
+    if (cdev->rx_busy || (cdev->rx_ring != NULL))
+        return USBH_ERR_NOT_EXPECTED;
+
+    ep = cdev->ep_rx;
+    if (ep == NULL)
+    {
+        ep = usbh_iface_find_ep(cdev->iface_data, 0, EP_ADDR_DIR_IN | EP_ATTR_TT_BULK);
+        if (ep == NULL)
+        {
+            CDC_DBGMSG("Bulk-in endpoint not found in this CDC device!\n");
+            return USBH_ERR_EP_NOT_FOUND;
+        }
+        cdev->ep_rx = ep;
+    }
+
+    /* Whole packets only, a short packet ends the transfer early */
+    xfer_size = (CDC_RX_XFER_SIZE / ep->wMaxPacketSize) * ep->wMaxPacketSize;
+    if (xfer_size == 0)
+        xfer_size = ep->wMaxPacketSize;
+
+    if ((ring == NULL) || (ring_size < xfer_size))
+        return USBH_ERR_INVALID_PARAM;
+
+    for (i = 0; i < CDC_RX_UTR_NUM; i++)
+    {
+        utr = alloc_utr(cdev->udev);
+        if (utr == NULL)
+        {
+            CDC_DBGMSG("Failed to allocated UTR!\n");
+            free_rx_ring(cdev);
+            return USBH_ERR_MEMORY_OUT;
+        }
+        cdev->utr_rx_ring[i] = utr;
+
+        utr->buff = (uint8_t *)usbh_alloc_mem(xfer_size);
+        if (utr->buff == NULL)
+        {
+            free_rx_ring(cdev);
+            return USBH_ERR_MEMORY_OUT;
+        }
+        utr->context = cdev;
+        utr->ep = ep;
+        utr->data_len = xfer_size;
+        utr->func = cdc_ring_in_irq;
+    }
+
+    cdev->rx_ring_size = ring_size;
+    cdev->rx_wr = cdev->rx_rd = 0;
+    cdev->rx_reserved = 0;
+    cdev->rx_parked = 0;
+    cdev->rx_ring = ring;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    for (i = 0; i < CDC_RX_UTR_NUM; i++)
+        rx_submit(cdev, i);
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+/**
+ *  @brief  Read received data from the receive ring. Does not wait.
+ *  @param[in]  cdev       CDC device
+ *  @param[out] buff       Buffer to take the data
+ *  @param[in]  buff_len   Size in bytes of buff
+ *  @return   Number of bytes read, or a negative error code.
+ */
+int32_t usbh_cdc_read(CDC_DEV_T *cdev, uint8_t *buff, uint32_t buff_len)
+{
+    uint32_t   off, len, n, primask;
+    int        i;
+
+    if ((cdev == NULL) || (cdev->rx_ring == NULL))
+        return USBH_ERR_NOT_FOUND;
+
+    len = cdev->rx_wr - cdev->rx_rd;
+    if (len > buff_len)
+        len = buff_len;
+
+    off = cdev->rx_rd % cdev->rx_ring_size;
+    n = cdev->rx_ring_size - off;
+    if (n > len)
+        n = len;
+    memcpy(buff, cdev->rx_ring + off, n);
+    memcpy(buff + n, cdev->rx_ring, len - n);
+    cdev->rx_rd += len;
+
+    if (cdev->rx_parked)
+    {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        for (i = 0; i < CDC_RX_UTR_NUM; i++)
+        {
+            if (cdev->rx_parked & (1 << i))
+            {
+                cdev->rx_parked &= ~(1 << i);
+                rx_submit(cdev, i);
+            }
+        }
+        __set_PRIMASK(primask);
+    }
+    return (int32_t)len;
+}
+
+/**
+ *  @brief  Give CDC device a send ring, so that usbh_cdc_send_data() queues the data and returns
+ *          at once. The ring is sent with CDC_TX_UTR_NUM bulk-out transfers. Set ring to NULL
+ *          to return to blocking send; data still queued is discarded.
+ *  @param[in] cdev        CDC device
+ *  @param[in] ring        Send ring buffer, or NULL
+ *  @param[in] ring_size   Size in bytes of the ring buffer
+ *  @return   Success or not.
+ * @retval   0           Success
+ * @retval   Otherwise   Failed
+ */
+int32_t usbh_cdc_set_send_ring(CDC_DEV_T *cdev, uint8_t *ring, uint32_t ring_size)
+{
+    EP_INFO_T   *ep;
+    UTR_T       *utr;
+    int         i;
+
+    if ((cdev == NULL) || (cdev->iface_data == NULL))
+        return USBH_ERR_NOT_FOUND;
+
+    if (cdev->tx_ring != NULL)
+    {
+        if (cdev->tx_busy)
+            usbh_quit_xfer(cdev->udev, cdev->ep_tx);
+        free_tx_ring(cdev);
+    }
+
+    if (ring == NULL)
+        return 0;
+
+    if (ring_size == 0)
+        return USBH_ERR_INVALID_PARAM;
+
+    ep = cdev->ep_tx;
+    if (ep == NULL)
+    {
+        ep = usbh_iface_find_ep(cdev->iface_data, 0, EP_ADDR_DIR_OUT | EP_ATTR_TT_BULK);
+        if (ep == NULL)
+        {
+            CDC_DBGMSG("Bulk-out endpoint not found in this CDC device!\n");
+            return USBH_ERR_EP_NOT_FOUND;
+        }
+        cdev->ep_tx = ep;
+    }
+
+    for (i = 0; i < CDC_TX_UTR_NUM; i++)
+    {
+        utr = alloc_utr(cdev->udev);
+        if (utr == NULL)
+        {
+            CDC_DBGMSG("Failed to allocated UTR!\n");
+            free_tx_ring(cdev);
+            return USBH_ERR_MEMORY_OUT;
+        }
+        cdev->utr_tx_ring[i] = utr;
+        utr->context = cdev;
+        utr->ep = ep;
+        utr->func = cdc_ring_out_irq;
+    }
+
+    cdev->tx_ring_size = ring_size;
+    cdev->tx_wr = cdev->tx_rd = cdev->tx_sched = 0;
+    cdev->tx_busy = 0;
+    cdev->tx_ring = ring;
+    return 0;
+}
+
+/// @cond HIDDEN_SYMBOLS
+/*
+ *  usbh_cdc_send_data() of ring mode. All or nothing, so that a message is never cut.
+ */
+int32_t cdc_ring_send(CDC_DEV_T *cdev, uint8_t *buff, int buff_len)
+{
+    uint32_t   off, n, primask;
+
+    if (buff_len < 0)
+        return USBH_ERR_INVALID_PARAM;
+
+    if ((uint32_t)buff_len > cdev->tx_ring_size - (cdev->tx_wr - cdev->tx_rd))
+    {
+        cdev->stat.tx_full++;
+        return USBH_ERR_MEMORY_OUT;
+    }
+
+    off = cdev->tx_wr % cdev->tx_ring_size;
+    n = cdev->tx_ring_size - off;
+    if (n > (uint32_t)buff_len)
+        n = buff_len;
+    memcpy(cdev->tx_ring + off, buff, n);
+    memcpy(cdev->tx_ring, buff + n, buff_len - n);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    cdev->tx_wr += buff_len;
+    tx_kick(cdev);
+    __set_PRIMASK(primask);
+    return 0;
+}
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+ *  @brief  Get the number of bytes in the send ring not sent yet.
+ *  @param[in] cdev        CDC device
+ *  @return   Bytes pending. 0 if the device has no send ring.
+ */
+int32_t usbh_cdc_send_pending(CDC_DEV_T *cdev)
+{
+    if ((cdev == NULL) || (cdev->tx_ring == NULL))
+        return 0;
+    return (int32_t)(cdev->tx_wr - cdev->tx_rd);
+}
+
+/**
+ *  @brief  Stop ring mode receive and send, and release their transfers.
+ *  @param[in] cdev        CDC device
+ *  @return   None
+ */
+void usbh_cdc_stop_ring(CDC_DEV_T *cdev)
+{
+    if (cdev == NULL)
+        return;
+
+    if (cdev->rx_ring != NULL)
+    {
+        cdev->rx_ring = NULL;
+        usbh_quit_xfer(cdev->udev, cdev->ep_rx);
+        free_rx_ring(cdev);
+    }
+
+    if (cdev->tx_ring != NULL)
+    {
+        cdev->tx_ring = NULL;
+        usbh_quit_xfer(cdev->udev, cdev->ep_tx);
+        free_tx_ring(cdev);
+    }
+}
+
+/**
+ *  @brief  Get the ring mode statistics. rx_rate and tx_rate are averaged over the time since
+ *          the previous call.
+ *  @param[in]  cdev       CDC device
+ *  @param[out] stat       Statistics
+ *  @return   None
+ */
+void usbh_cdc_get_stat(CDC_DEV_T *cdev, CDC_STAT_T *stat)
+{
+    uint32_t   ticks, primask;
+
+    if ((cdev == NULL) || (stat == NULL))
+        return;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    ticks = get_ticks() - cdev->stat_ticks;
+    if (ticks > 0)
+    {
+        /* get_ticks() counts 10 ms */
+        cdev->stat.rx_rate = (uint32_t)((uint64_t)(cdev->stat.rx_bytes - cdev->stat_rx_bytes) * 100 / ticks);
+        cdev->stat.tx_rate = (uint32_t)((uint64_t)(cdev->stat.tx_bytes - cdev->stat_tx_bytes) * 100 / ticks);
+        cdev->stat_ticks += ticks;
+        cdev->stat_rx_bytes = cdev->stat.rx_bytes;
+        cdev->stat_tx_bytes = cdev->stat.tx_bytes;
+    }
+    *stat = cdev->stat;
+    __set_PRIMASK(primask);
+}
+
+/*@}*/ /* end of group USBH_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group USBH_Library */
+
+/*@}*/ /* end of group Library */
+
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
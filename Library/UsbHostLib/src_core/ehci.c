@@ -296,7 +296,8 @@ static int  ehci_init(void)
     /*------------------------------------------------------------------------------------*/
 
     _ehci->UCFGR = 0x1;                          /* enable port routing to EHCI           */
-    _ehci->UIENR = HSUSBH_UIENR_USBIEN_Msk | HSUSBH_UIENR_UERRIEN_Msk | HSUSBH_UIENR_HSERREN_Msk | HSUSBH_UIENR_IAAEN_Msk;
+    _ehci->UIENR = HSUSBH_UIENR_USBIEN_Msk | HSUSBH_UIENR_UERRIEN_Msk | HSUSBH_UIENR_HSERREN_Msk | HSUSBH_UIENR_IAAEN_Msk |
+                   HSUSBH_UIENR_PCIEN_Msk;
 
     delay_us(1000);                              /* delay 1 ms                            */
 
@@ -625,12 +626,17 @@ static int ehci_ctrl_xfer(UTR_T *utr)
     return 0;
 }
 
+/*
+ *  Bulk UTRs are queued on the QH. The qTDs of a new UTR are chained after the last
+ *  qTD of the QH, so that the host controller goes on with the next UTR without waiting
+ *  for software. UTRs are called back in the order they were submitted.
+ */
 static int ehci_bulk_xfer(UTR_T *utr)
 {
     UDEV_T     *udev;
     EP_INFO_T  *ep = utr->ep;
     QH_T       *qh;
-    qTD_T      *qtd, *qtd_pre;
+    qTD_T      *qtd, *qtd_pre, *qtd_list;
     uint32_t   data_len, xfer_len;
     uint8_t    *buff;
     uint32_t   token;
@@ -644,10 +650,6 @@ static int ehci_bulk_xfer(UTR_T *utr)
     if (ep->hw_pipe != NULL)
     {
         qh = (QH_T *)ep->hw_pipe ;
-        if (qh->qtd_list)
-        {
-            return USBH_ERR_EHCI_QH_BUSY;
-        }
     }
     else
     {
@@ -664,6 +666,7 @@ static int ehci_bulk_xfer(UTR_T *utr)
     /*------------------------------------------------------------------------------------*/
     data_len = utr->data_len;
     buff = utr->buff;
+    qtd_list = NULL;
     qtd_pre = NULL;
 
     while (data_len > 0)
@@ -671,11 +674,10 @@ static int ehci_bulk_xfer(UTR_T *utr)
         qtd = alloc_ehci_qTD(utr);
         if (qtd == NULL)                    /* failed to allocate a qTD                   */
         {
-            qtd = qh->qtd_list;
-            while (qtd != NULL)
+            while (qtd_list != NULL)        /* free qTDs of this UTR only                 */
             {
-                qtd_pre = qtd;
-                qtd = qtd->next;
+                qtd_pre = qtd_list;
+                qtd_list = qtd_list->next;
                 free_ehci_qTD(qtd_pre);
             }
             if (is_new_qh)
@@ -700,7 +702,6 @@ static int ehci_bulk_xfer(UTR_T *utr)
         qtd->Next_qTD = (uint32_t)_ghost_qtd;
         qtd->Alt_Next_qTD = QTD_LIST_END; //(uint32_t)_ghost_qtd;
         write_qtd_bptr(qtd, (uint32_t)buff, xfer_len);
-        append_to_qtd_list_of_QH(qh, qtd);
         qtd->Token = (xfer_len << 16) | token;
 
         buff += xfer_len;                   /* advanced buffer pointer                    */
@@ -713,23 +714,57 @@ static int ehci_bulk_xfer(UTR_T *utr)
         }
 
         if (qtd_pre != NULL)
+        {
             qtd_pre->Next_qTD = (uint32_t)qtd;
+            qtd_pre->next = qtd;
+        }
+        else
+        {
+            qtd_list = qtd;
+        }
         qtd_pre = qtd;
     }
 
-    //USB_debug("utr=0x%x, qh=0x%x, qtd=0x%x\n", (int)utr, (int)qh, (int)qh->qtd_list);
+    //USB_debug("utr=0x%x, qh=0x%x, qtd=0x%x\n", (int)utr, (int)qh, (int)qtd_list);
+
+    /*------------------------------------------------------------------------------------*/
+    /* Queue the qTDs on the QH                                                           */
+    /*------------------------------------------------------------------------------------*/
+    DISABLE_EHCI_IRQ();
+    if (qh->qtd_list == NULL)
+    {
+        qh->qtd_list = qtd_list;
+//      qh->Curr_qTD = 0; //(uint32_t)qtd;
+        qh->OL_Next_qTD = (uint32_t)qtd_list;
+//      qh->OL_Alt_Next_qTD = QTD_LIST_END;
+    }
+    else
+    {
+        qtd = qh->qtd_list;                 /* find the last qTD of the previous UTRs     */
+        while (qtd->next != NULL)
+            qtd = qtd->next;
 
-    qtd = qh->qtd_list;
+        qtd->next = qtd_list;
+        qtd->Next_qTD = (uint32_t)qtd_list; /* the HC goes on with this UTR after it      */
 
-//    qh->Curr_qTD = 0; //(uint32_t)qtd;
-    qh->OL_Next_qTD = (uint32_t)qtd;
-//  qh->OL_Alt_Next_qTD = QTD_LIST_END;
+        /*
+         *  If the HC had loaded the last qTD before it was linked, the overlay still
+         *  points to the ghost qTD. scan_asynchronous_list() restarts the QH in the
+         *  rare case the HC was just between reading the qTD and updating Curr_qTD.
+         *  A new QH has Curr_qTD set before the HC loaded anything, its overlay still
+         *  points to the first qTD and must be left alone.
+         */
+        if ((QTD_PTR(qh->Curr_qTD) == qtd) && (QTD_PTR(qh->OL_Next_qTD) == _ghost_qtd))
+            qh->OL_Next_qTD = (uint32_t)qtd_list;
+    }
+    ENABLE_EHCI_IRQ();
 
     /*------------------------------------------------------------------------------------*/
     /* Link QH and start asynchronous transfer                                            */
     /*------------------------------------------------------------------------------------*/
     if (is_new_qh)
     {
+        qtd = qtd_list;
         memcpy(&(qh->OL_Bptr[0]), &(qtd->Bptr[0]), 20);
         qh->Curr_qTD = (uint32_t)qtd;
 
@@ -890,11 +925,16 @@ static int visit_qtd(qTD_T *qtd)
 
     if ((qtd->Token & QTD_STS_ACTIVE) == 0)
     {
+        /* CERR counts down from 3 on each transaction error the HC retried             */
+        USB_TRACE_RETRY(qtd->utr, 3 - ((qtd->Token & QTD_ERR_COUNTER) >> 10));
+
         if (qtd->Token & (QTD_STS_HALT | QTD_STS_DATA_BUFF_ERR | QTD_STS_BABBLE | QTD_STS_XactErr | QTD_STS_MISS_MF))
         {
             USB_error("qTD error token=0x%x!  0x%x\n", qtd->Token, qtd->Bptr[0]);
+            /* halted without an error of its own: the device answered STALL */
             if (qtd->utr->status == 0)
-                qtd->utr->status = USBH_ERR_TRANSACTION;
+                qtd->utr->status = ((qtd->Token & (QTD_STS_DATA_BUFF_ERR | QTD_STS_BABBLE | QTD_STS_XactErr |
+                                                   QTD_STS_MISS_MF)) == 0) ? USBH_ERR_STALL : USBH_ERR_TRANSACTION;
         }
         else
         {
@@ -912,57 +952,88 @@ static int visit_qtd(qTD_T *qtd)
 static void scan_asynchronous_list()
 {
     QH_T    *qh, *qh_tmp;
-    qTD_T   *q_pre, *qtd, *qtd_tmp;
+    qTD_T   *qtd;
     UTR_T   *utr;
+    int     is_halted;
 
     qh =  QH_PTR(_H_qh->HLink);
     while (qh != _H_qh)
     {
         // USB_debug("Scan qh=0x%x, 0x%x\n", (int)qh, qh->OL_Token);
 
-        utr = NULL;
-        qtd = qh->qtd_list;
-        while (qtd != NULL)
+        qh_tmp = qh;
+        qh = QH_PTR(qh->HLink);                  /* advance to the next QH                */
+
+        /*
+         *  qTDs are retired in order. A UTR is called back once its last qTD is retired,
+         *  which keeps the call-backs of UTRs queued on the same QH in submit order.
+         */
+        while ((qtd = qh_tmp->qtd_list) != NULL)
         {
-            if (visit_qtd(qtd))                  /* if TRUE, reclaim this qtd             */
-            {
-                /* qTD is completed, will remove it      */
-                utr = qtd->utr;
-                if (qtd == qh->qtd_list)
-                    qh->qtd_list = qtd->next;    /* unlink the qTD from qtd_list          */
-                else
-                    q_pre->next = qtd->next;     /* unlink the qTD from qtd_list          */
+            if (!visit_qtd(qtd))                 /* not completed yet                     */
+                break;
 
-                qtd_tmp = qtd;                   /* remember this qTD for freeing later   */
-                qtd = qtd->next;                 /* advance to the next qTD               */
+            utr = qtd->utr;
+            is_halted = (qtd->Token & QTD_STS_HALT) ? 1 : 0;
 
-                qtd_tmp->next = qh->done_list;   /* push this qTD to QH's done list       */
-                qh->done_list = qtd_tmp;
+            qh_tmp->qtd_list = qtd->next;        /* unlink the qTD from qtd_list          */
+            qtd->next = qh_tmp->done_list;       /* push this qTD to QH's done list       */
+            qh_tmp->done_list = qtd;
+
+            if (is_halted)
+            {
+                /* QH halted, the remaining qTDs of this UTR will never be executed       */
+                while ((qh_tmp->qtd_list != NULL) && (qh_tmp->qtd_list->utr == utr))
+                {
+                    qtd = qh_tmp->qtd_list;
+                    qh_tmp->qtd_list = qtd->next;
+                    qtd->next = qh_tmp->done_list;
+                    qh_tmp->done_list = qtd;
+                }
             }
-            else
+            else if ((qh_tmp->qtd_list != NULL) && (qh_tmp->qtd_list->utr == utr))
             {
-                q_pre = qtd;                     /* remember this qTD as a preceder       */
-                qtd = qtd->next;                 /* advance to next qTD                   */
+                continue;                        /* UTR still has qTDs to be done         */
             }
-        }
 
-        qh_tmp = qh;
-        qh = QH_PTR(qh->HLink);                  /* advance to the next QH                */
+            if ((qh_tmp->qtd_list == NULL) || is_halted)
+            {
+                // printf("T %d [%d]\n", (qh_tmp->Chrst>>8)&0xf, (qh_tmp->OL_Token&QTD_DT) ? 1 : 0);
+                if (qh_tmp->OL_Token & QTD_DT)
+                    utr->ep->bToggle = 1;
+                else
+                    utr->ep->bToggle = 0;
+            }
 
-        /* If all TDs are done, call-back to requester and then remove this QH.           */
-        if ((qh_tmp->qtd_list == NULL) && utr)
-        {
-            // printf("T %d [%d]\n", (qh_tmp->Chrst>>8)&0xf, (qh_tmp->OL_Token&QTD_DT) ? 1 : 0);
-            if (qh_tmp->OL_Token & QTD_DT)
-                utr->ep->bToggle = 1;
-            else
-                utr->ep->bToggle = 0;
+            if (is_halted && (qh_tmp->qtd_list != NULL))
+            {
+                /*
+                 *  UTRs queued behind the halted one cannot proceed. Remove the QH, they
+                 *  will be called back with USBH_ERR_ABORT by iaad_remove_qh().
+                 */
+                move_qh_to_remove_list(qh_tmp);
+                utr->ep->hw_pipe = NULL;
+            }
 
+            USB_TRACE_DONE(utr, utr->status);
             utr->bIsTransferDone = 1;
             if (utr->func)
                 utr->func(utr);
 
             _ehci->UCMDR |= HSUSBH_UCMDR_IAAD_Msk;   /* trigger IAA to reclaim done_list  */
+
+            if (is_halted)
+                break;
+        }
+
+        /*
+         *  Restart the QH if the HC has stopped on the ghost qTD while qTDs are still
+         *  queued. See ehci_bulk_xfer().
+         */
+        if ((qh_tmp->qtd_list != NULL) && !(qh_tmp->OL_Token & (QTD_STS_ACTIVE | QTD_STS_HALT)) &&
+                (QTD_PTR(qh_tmp->OL_Next_qTD) == _ghost_qtd))
+        {
+            qh_tmp->OL_Next_qTD = (uint32_t)qh_tmp->qtd_list;
         }
     }
 }
@@ -1007,6 +1078,7 @@ static void scan_periodic_frame_list()
             else
                 utr->ep->bToggle = 0;
 
+            USB_TRACE_DONE(utr, utr->status);
             utr->bIsTransferDone = 1;
             if (utr->func)
                 utr->func(utr);
@@ -1047,19 +1119,22 @@ void iaad_remove_qh()
             free_ehci_qTD(qtd);
         }
 
-        if (qh->qtd_list != NULL)           /* still have incomplete qTDs?               */
+        while (qh->qtd_list != NULL)        /* still have incomplete qTDs?               */
         {
-            utr = qh->qtd_list->utr;
-            while (qh->qtd_list)
+            qtd = qh->qtd_list;
+            qh->qtd_list = qtd->next;
+            utr = qtd->utr;
+            free_ehci_qTD(qtd);
+
+            /* call back each queued UTR once its last qTD is freed                       */
+            if ((qh->qtd_list == NULL) || (qh->qtd_list->utr != utr))
             {
-                qtd = qh->qtd_list;
-                qh->qtd_list = qtd->next;
-                free_ehci_qTD(qtd);
+                utr->status = USBH_ERR_ABORT;
+                USB_TRACE_DONE(utr, utr->status);
+                utr->bIsTransferDone = 1;
+                if (utr->func)
+                    utr->func(utr);         /* call back                                  */
             }
-            utr->status = USBH_ERR_ABORT;
-            utr->bIsTransferDone = 1;
-            if (utr->func)
-                utr->func(utr);             /* call back                                  */
         }
         free_ehci_QH(qh);                   /* free the QH                                */
     }
@@ -1105,12 +1180,11 @@ void EHCI_IRQHandler(void)
 
     // USB_debug("Eirq USTSR=0x%x\n", intsts);
 
-    if (intsts & HSUSBH_USTSR_UERRINT_Msk)
-    {
-        // USB_error("Transfer error!\n");
-    }
-
-    if (intsts & HSUSBH_USTSR_USBINT_Msk)
+    /*
+     *  A qTD that halts on an error raises USBINT only if it has IOC set, as the last qTD
+     *  of a UTR has. The error of any other qTD is seen by USBERRINT alone.
+     */
+    if (intsts & (HSUSBH_USTSR_USBINT_Msk | HSUSBH_USTSR_UERRINT_Msk))
     {
         /* some transfers completed, travel asynchronous */
         /* and periodic lists to find and reclaim them.  */
@@ -1123,6 +1197,11 @@ void EHCI_IRQHandler(void)
     {
         iaad_remove_qh();
     }
+
+    if (intsts & HSUSBH_USTSR_PCD_Msk)
+    {
+        usbh_hub_event(HUB_EV_EHCI_RH);     /* handled by ehci_rh_polling()               */
+    }
 }
 
 static UDEV_T * ehci_find_device_by_port(int port)
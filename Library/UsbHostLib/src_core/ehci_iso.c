@@ -105,6 +105,7 @@ static int  review_itd(iTD_T *itd)
 
     if (utr->td_cnt == 0)                   /* All iTD of this UTR done                   */
     {
+        USB_TRACE_DONE(utr, utr->status);
         utr->bIsTransferDone = 1;
         if (utr->func)
             utr->func(utr);
@@ -180,6 +181,7 @@ static int  review_sitd(siTD_T *sitd)
 
     if (utr->td_cnt == 0)                   /* All iTD of this UTR done                   */
     {
+        USB_TRACE_DONE(utr, utr->status);
         utr->bIsTransferDone = 1;
         if (utr->func)
             utr->func(utr);
@@ -886,6 +888,7 @@ int ehci_quit_iso_xfer(UTR_T *utr, EP_INFO_T *ep)
 
         if (utr->td_cnt == 0)               /* All iTD of this UTR done                   */
         {
+            USB_TRACE_DONE(utr, USBH_ERR_ABORT);
             utr->bIsTransferDone = 1;
             if (utr->func)
                 utr->func(utr);
@@ -25,6 +25,9 @@
 
 static HUB_DEV_T  g_hub_dev[MAX_HUB_DEVICE];
 
+static volatile uint32_t  _hub_events;      /* HUB_EV_xxx not handled by usbh_pooling_hubs() yet */
+static HUB_EVENT_FUNC     *_hub_event_func;
+
 static int do_port_reset(HUB_DEV_T *hub, int port);
 
 static HUB_DEV_T *alloc_hub_device(void)
@@ -194,6 +197,7 @@ static void hub_status_irq(UTR_T *utr)
             hub->sc_bitmap |= (utr->buff[i] << (i * 8));
         }
         // HUB_DBGMSG("hub_status_irq - status bitmap: 0x%x\n", hub->sc_bitmap);
+        usbh_hub_event(HUB_EV_HUB);
     }
 }
 
@@ -617,9 +621,27 @@ static int  hub_polling(void)
 void usbh_hub_init(void)
 {
     memset((char *)&g_hub_dev[0], 0, sizeof(g_hub_dev));
+    _hub_events = HUB_EV_ALL;               /* look at the ports connected before init    */
+    _hub_event_func = NULL;
     usbh_register_driver(&hub_driver);
 }
 
+/*
+ *  Post hub events for usbh_pooling_hubs(). Called by the EHCI and OHCI interrupt handlers
+ *  and hub_status_irq().
+ */
+void usbh_hub_event(uint32_t events)
+{
+    uint32_t  primask = __get_PRIMASK();
+
+    __disable_irq();
+    _hub_events |= events;
+    __set_PRIMASK(primask);
+
+    if (_hub_event_func)
+        _hub_event_func();
+}
+
 
 /// @endcond HIDDEN_SYMBOLS
 
@@ -628,14 +650,25 @@ void usbh_hub_init(void)
   *           change found, USB stack will manage the hub events in this function call.
   *           In this function, USB stack enumerates newly connected devices and remove staff
   *           of disconnected devices. User's application should periodically invoke this
-  *           function.
+  *           function, or invoke it whenever usbh_hub_event_pending() says there is work,
+  *           see usbh_install_hub_event_callback().
   * @return   There's hub port change or not.
   * @retval   0   No any hub port status changes found.
   * @retval   1   There's hub port status changes.
   */
 int  usbh_pooling_hubs(void)
 {
-    int   ret, change = 0;
+    int       ret, change = 0;
+    uint32_t  primask;
+
+    /*
+     *  Take the events posted so far. Events posted while they are handled below are
+     *  left for the next call.
+     */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    _hub_events = 0;
+    __set_PRIMASK(primask);
 
 #ifdef ENABLE_EHCI
     if ((SYS->CSERVER & SYS_CSERVER_VERSION_Msk) == 0x0)    /* Only M480MD has EHCI. */
@@ -674,6 +707,33 @@ int  usbh_pooling_hubs(void)
 }
 
 
+/**
+  * @brief    Check if there are hub events, root hub or hub port changes, that have not been
+  *           handled by usbh_pooling_hubs() yet. The events are posted by the USB Host
+  *           interrupts, so an application can sleep until one comes instead of calling
+  *           usbh_pooling_hubs() in a busy loop. Disable interrupts before the check and sleep
+  *           with __WFI(), so that an event posted in between is not missed.
+  * @return   There are hub events pending or not.
+  * @retval   0   No hub events pending.
+  * @retval   1   usbh_pooling_hubs() has work to do.
+  */
+int  usbh_hub_event_pending(void)
+{
+    return (_hub_events != 0) ? 1 : 0;
+}
+
+/**
+  * @brief    Install a function to be called when a hub event is posted. It is called in
+  *           interrupt context, and can be used to wake up the task that calls
+  *           usbh_pooling_hubs(), for example by giving a semaphore from the interrupt.
+  * @param[in]  func    Hub event callback function. NULL to remove it.
+  * @return   None.
+  */
+void usbh_install_hub_event_callback(HUB_EVENT_FUNC *func)
+{
+    _hub_event_func = func;
+}
+
 /**
   * @brief    Find the device under the specified hub port.
   * @param[in]  hub_id    Hub identify ID
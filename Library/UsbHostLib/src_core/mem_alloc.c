@@ -31,11 +31,37 @@ static uint8_t  _mem_pool[MEM_POOL_UNIT_NUM][MEM_POOL_UNIT_SIZE];
 #else
 static uint8_t _mem_pool[MEM_POOL_UNIT_NUM][MEM_POOL_UNIT_SIZE] __attribute__((aligned(32)));
 #endif
-static uint8_t  _unit_used[MEM_POOL_UNIT_NUM];
+
+/*
+ *  Units in use are marked in the bitmap _unit_map, bit (n % 32) of word (n / 32) for unit n.
+ *  A free unit is found with a count-trailing-zeros of an inverted map word, and a unit is
+ *  freed by computing its index from its address, so neither walks the units one by one.
+ */
+#define MEM_POOL_MAP_SIZE      ((MEM_POOL_UNIT_NUM + 31) / 32)
+
+static uint32_t  _unit_map[MEM_POOL_MAP_SIZE];
 
 static volatile int  _usbh_mem_used;
 static volatile int  _usbh_max_mem_used;
-static volatile int  _mem_pool_used;
+
+static USBH_MEM_STAT_T  _mem_stat;
+
+#if STATIC_MEMORY_ALLOC
+/*
+ *  UTR_T, UDEV_T and descriptor buffers are taken from fixed-size object pools instead of the
+ *  heap, so that transfers and device enumeration make no malloc()/free() calls. An object in
+ *  use has its bit set in the map of its pool, which is searched like _unit_map.
+ */
+#define OBJ_MAP_SIZE(n)        (((n) + 31) / 32)
+
+static UTR_T     _utr_pool[MAX_UTR_NUM];
+static UDEV_T    _udev_pool[MAX_UDEV_NUM];
+static uint32_t  _desc_buff_pool[MAX_DESC_BUFF_NUM][MAX_DESC_BUFF_SIZE / 4];    /* word aligned */
+
+static uint32_t  _utr_map[OBJ_MAP_SIZE(MAX_UTR_NUM)];
+static uint32_t  _udev_map[OBJ_MAP_SIZE(MAX_UDEV_NUM)];
+static uint32_t  _desc_buff_map[OBJ_MAP_SIZE(MAX_DESC_BUFF_NUM)];
+#endif
 
 
 UDEV_T * g_udev_list;
@@ -51,6 +77,8 @@ static  int  _sidx = 0;;
 
 void usbh_memory_init(void)
 {
+    int   i;
+
     if (sizeof(TD_T) > MEM_POOL_UNIT_SIZE)
     {
         USB_error("TD_T - MEM_POOL_UNIT_SIZE too small!\n");
@@ -66,10 +94,18 @@ void usbh_memory_init(void)
     _usbh_mem_used = 0L;
     _usbh_max_mem_used = 0L;
 
-    memset(_unit_used, 0, sizeof(_unit_used));
-    _mem_pool_used = 0;
+    memset(_unit_map, 0, sizeof(_unit_map));
+    for (i = MEM_POOL_UNIT_NUM; i < MEM_POOL_MAP_SIZE * 32; i++)
+        _unit_map[i / 32] |= (1UL << (i % 32));     /* units beyond the pool are never free */
+    memset(&_mem_stat, 0, sizeof(_mem_stat));
     _sidx = 0;
 
+#if STATIC_MEMORY_ALLOC
+    memset(_utr_map, 0, sizeof(_utr_map));
+    memset(_udev_map, 0, sizeof(_udev_map));
+    memset(_desc_buff_map, 0, sizeof(_desc_buff_map));
+#endif
+
     g_udev_list = NULL;
 
     memset(_dev_addr_pool, 0, sizeof(_dev_addr_pool));
@@ -78,10 +114,32 @@ void usbh_memory_init(void)
 
 uint32_t  usbh_memory_used(void)
 {
-    printf("USB static memory: %d/%d, heap used: %d\n", _mem_pool_used, MEM_POOL_UNIT_NUM, _usbh_mem_used);
+    printf("USB static memory: %d/%d (max %d), heap used: %d (max %d)\n", _mem_stat.pool.used, MEM_POOL_UNIT_NUM,
+           _mem_stat.pool.max_used, _usbh_mem_used, _usbh_max_mem_used);
+    printf("UTR: %d (max %d), device: %d (max %d), descriptor buffer: %d (max %d), heap calls: %d\n",
+           _mem_stat.utr.used, _mem_stat.utr.max_used, _mem_stat.udev.used, _mem_stat.udev.max_used,
+           _mem_stat.desc_buff.used, _mem_stat.desc_buff.max_used, _mem_stat.heap_calls);
     return _usbh_mem_used;
 }
 
+/**
+  * @brief    Get the usage of the host controller descriptor pool, of the UTR, device and
+  *           descriptor buffer objects, and of the heap.
+  * @param[out] stat   Current and maximum number of each descriptor and object type in use.
+  * @return   None
+  */
+void  usbh_memory_stat(USBH_MEM_STAT_T *stat)
+{
+    uint32_t  primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    *stat = _mem_stat;
+    stat->heap_used = _usbh_mem_used;
+    stat->heap_max_used = _usbh_max_mem_used;
+    __set_PRIMASK(primask);
+}
+
 static void  memory_counter(int size)
 {
     _usbh_mem_used += size;
@@ -89,26 +147,241 @@ static void  memory_counter(int size)
         _usbh_max_mem_used = _usbh_mem_used;
 }
 
-void * usbh_alloc_mem(int size)
+static void  mem_stat_add(USBH_MEM_CNT_T *cnt, int n)
+{
+    cnt->used += n;
+    if (cnt->used > cnt->max_used)
+        cnt->max_used = cnt->used;
+}
+
+static void * heap_alloc(int size)
 {
     void  *p;
 
+    _mem_stat.heap_calls++;
     p = malloc(size);
+    if (p != NULL)
+    {
+        memset(p, 0, size);
+        memory_counter(size);
+    }
+    return p;
+}
+
+static void  heap_free(void *p, int size)
+{
+    _mem_stat.heap_calls++;
+    free(p);
+    memory_counter(0-size);
+}
+
+#if STATIC_MEMORY_ALLOC
+/*
+ *  Take a free object of an object pool of <num> objects. Returns its index, or -1 and
+ *  counts a failure in <fail> if all of them are in use.
+ */
+static int  obj_alloc(uint32_t map[], int num, USBH_MEM_CNT_T *cnt, uint32_t *fail)
+{
+    uint32_t  primask, free_bits;
+    int       widx, idx;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    for (widx = 0; widx < OBJ_MAP_SIZE(num); widx++)
+    {
+        free_bits = ~map[widx];
+        if (free_bits == 0)
+            continue;
+
+        idx = widx * 32 + __CLZ(__RBIT(free_bits));
+        if (idx >= num)
+            break;                          /* only bits beyond the pool are clear        */
+        map[widx] |= (1UL << (idx % 32));
+        mem_stat_add(cnt, 1);
+        __set_PRIMASK(primask);
+        return idx;
+    }
+    (*fail)++;
+    __set_PRIMASK(primask);
+    return -1;
+}
+
+/*
+ *  Give object <p> back to its pool of <num> objects of <size> bytes at <pool>.
+ *  Returns -1 if <p> is not an allocated object.
+ */
+static int  obj_free(uint32_t map[], void *p, void *pool, int size, int num, USBH_MEM_CNT_T *cnt)
+{
+    uint32_t  primask, bit;
+    uint32_t  offset;
+    int       idx;
+
+    offset = (uint32_t)((uint8_t *)p - (uint8_t *)pool);
+    idx = offset / size;
+    if (((uint8_t *)p < (uint8_t *)pool) || (offset % size) || (idx >= num))
+        return -1;
+
+    bit = 1UL << (idx % 32);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if ((map[idx / 32] & bit) == 0)
+    {
+        __set_PRIMASK(primask);
+        return -1;                          /* not allocated                              */
+    }
+    map[idx / 32] &= ~bit;
+    cnt->used--;
+    __set_PRIMASK(primask);
+    return 0;
+}
+#else
+/*
+ *  Count an object taken (n = 1) or given back (n = -1). The counters are shared with the
+ *  transfer-done callbacks, which may free UTRs from interrupt context.
+ */
+static void  obj_count(USBH_MEM_CNT_T *cnt, int n)
+{
+    uint32_t  primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    mem_stat_add(cnt, n);
+    __set_PRIMASK(primask);
+}
+#endif
+
+/*
+ *  Allocate <unit_cnt> (1 or 2) adjacent pool units, searching from unit <start> on and
+ *  wrapping around. Returns the index of the first unit, or -1 if the pool is full.
+ */
+static int  pool_alloc(int start, int unit_cnt, USBH_MEM_CNT_T *type_cnt)
+{
+    uint32_t  primask, free_bits, mask;
+    int       widx, i, bit;
+
+    widx = start / 32;
+    mask = 0xFFFFFFFFUL << (start % 32);   /* first look at the units from <start> on    */
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    for (i = 0; i <= MEM_POOL_MAP_SIZE; i++)
+    {
+        free_bits = ~_unit_map[widx];
+        if (unit_cnt == 2)
+            free_bits &= (free_bits >> 1);  /* bit n set: unit n and n+1 are free         */
+        free_bits &= mask;
+
+        if (free_bits != 0)
+        {
+            bit = __CLZ(__RBIT(free_bits));
+            _unit_map[widx] |= ((unit_cnt == 2) ? 3UL : 1UL) << bit;
+            mem_stat_add(&_mem_stat.pool, unit_cnt);
+            mem_stat_add(type_cnt, 1);
+            __set_PRIMASK(primask);
+            return widx * 32 + bit;
+        }
+
+        widx = (widx + 1) % MEM_POOL_MAP_SIZE;
+        if (i == MEM_POOL_MAP_SIZE - 1)
+            mask = ~(0xFFFFFFFFUL << (start % 32));  /* units before <start>  */
+        else
+            mask = 0xFFFFFFFFUL;
+    }
+    _mem_stat.alloc_fail++;
+    __set_PRIMASK(primask);
+    return -1;
+}
+
+/*
+ *  Free the <unit_cnt> units of pool memory <p>. Returns -1 if <p> is not an allocated unit.
+ */
+static int  pool_free(void *p, int unit_cnt, USBH_MEM_CNT_T *type_cnt)
+{
+    uint32_t  primask, bits;
+    uint32_t  offset;
+    int       idx;
+
+    offset = (uint32_t)((uint8_t *)p - &_mem_pool[0][0]);
+    idx = offset / MEM_POOL_UNIT_SIZE;
+    if (((uint8_t *)p < &_mem_pool[0][0]) || (offset % MEM_POOL_UNIT_SIZE) || (idx + unit_cnt > MEM_POOL_UNIT_NUM))
+        return -1;
+
+    bits = ((unit_cnt == 2) ? 3UL : 1UL) << (idx % 32);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if ((_unit_map[idx / 32] & bits) != bits)
+    {
+        __set_PRIMASK(primask);
+        return -1;                          /* not allocated                              */
+    }
+    _unit_map[idx / 32] &= ~bits;
+    _mem_stat.pool.used -= unit_cnt;
+    type_cnt->used--;
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+void * usbh_alloc_mem(int size)
+{
+    void  *p;
+
+    p = heap_alloc(size);
     if (p == NULL)
     {
         USB_error("usbh_alloc_mem failed! %d\n", size);
         return NULL;
     }
-
-    memset(p, 0, size);
-    memory_counter(size);
     return p;
 }
 
 void usbh_free_mem(void *p, int size)
 {
-    free(p);
-    memory_counter(0-size);
+    heap_free(p, size);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*   Descriptor buffer (MAX_DESC_BUFF_SIZE bytes) allocate/free             */
+/*--------------------------------------------------------------------------*/
+
+uint8_t * usbh_alloc_desc_buff(void)
+{
+    uint8_t  *buff;
+#if STATIC_MEMORY_ALLOC
+    int      i;
+
+    i = obj_alloc(_desc_buff_map, MAX_DESC_BUFF_NUM, &_mem_stat.desc_buff, &_mem_stat.desc_buff_fail);
+    if (i < 0)
+    {
+        USB_error("usbh_alloc_desc_buff failed!\n");
+        return NULL;
+    }
+    buff = (uint8_t *)_desc_buff_pool[i];
+    memset(buff, 0, MAX_DESC_BUFF_SIZE);
+#else
+    buff = (uint8_t *)usbh_alloc_mem(MAX_DESC_BUFF_SIZE);
+    if (buff == NULL)
+        return NULL;
+    obj_count(&_mem_stat.desc_buff, 1);
+#endif
+    return buff;
+}
+
+void usbh_free_desc_buff(uint8_t *buff)
+{
+    if (buff == NULL)
+        return;
+
+#if STATIC_MEMORY_ALLOC
+    if (obj_free(_desc_buff_map, buff, _desc_buff_pool, MAX_DESC_BUFF_SIZE,
+                 MAX_DESC_BUFF_NUM, &_mem_stat.desc_buff) < 0)
+        USB_error("usbh_free_desc_buff - not found!\n");
+#else
+    usbh_free_mem(buff, MAX_DESC_BUFF_SIZE);
+    obj_count(&_mem_stat.desc_buff, -1);
+#endif
 }
 
 
@@ -119,15 +392,26 @@ void usbh_free_mem(void *p, int size)
 UDEV_T * alloc_device(void)
 {
     UDEV_T  *udev;
+#if STATIC_MEMORY_ALLOC
+    int     i;
 
-    udev = malloc(sizeof(*udev));
-    if (udev == NULL)
+    i = obj_alloc(_udev_map, MAX_UDEV_NUM, &_mem_stat.udev, &_mem_stat.udev_fail);
+    if (i < 0)
     {
         USB_error("alloc_device failed!\n");
         return NULL;
     }
+    udev = &_udev_pool[i];
     memset(udev, 0, sizeof(*udev));
-    memory_counter(sizeof(*udev));
+#else
+    udev = heap_alloc(sizeof(*udev));
+    if (udev == NULL)
+    {
+        USB_error("alloc_device failed!\n");
+        return NULL;
+    }
+    obj_count(&_mem_stat.udev, 1);
+#endif
     udev->cur_conf = -1;                    /* must! used to identify the first SET CONFIGURATION */
     udev->next = g_udev_list;               /* chain to global device list */
     g_udev_list = udev;
@@ -141,8 +425,7 @@ void free_device(UDEV_T *udev)
     if (udev == NULL)
         return;
 
-    if (udev->cfd_buff != NULL)
-        usbh_free_mem(udev->cfd_buff, MAX_DESC_BUFF_SIZE);
+    usbh_free_desc_buff(udev->cfd_buff);
 
     /*
      *  Remove it from the global device list
@@ -165,8 +448,13 @@ void free_device(UDEV_T *udev)
         }
     }
 
-    free(udev);
-    memory_counter(-sizeof(*udev));
+#if STATIC_MEMORY_ALLOC
+    if (obj_free(_udev_map, udev, _udev_pool, sizeof(UDEV_T), MAX_UDEV_NUM, &_mem_stat.udev) < 0)
+        USB_error("free_device - not found!\n");
+#else
+    heap_free(udev, sizeof(*udev));
+    obj_count(&_mem_stat.udev, -1);
+#endif
 }
 
 int  alloc_dev_address(void)
@@ -202,15 +490,26 @@ void  free_dev_address(int dev_addr)
 UTR_T * alloc_utr(UDEV_T *udev)
 {
     UTR_T  *utr;
+#if STATIC_MEMORY_ALLOC
+    int    i;
 
-    utr = malloc(sizeof(*utr));
-    if (utr == NULL)
+    i = obj_alloc(_utr_map, MAX_UTR_NUM, &_mem_stat.utr, &_mem_stat.utr_fail);
+    if (i < 0)
     {
         USB_error("alloc_utr failed!\n");
         return NULL;
     }
-    memory_counter(sizeof(*utr));
+    utr = &_utr_pool[i];
     memset(utr, 0, sizeof(*utr));
+#else
+    utr = heap_alloc(sizeof(*utr));
+    if (utr == NULL)
+    {
+        USB_error("alloc_utr failed!\n");
+        return NULL;
+    }
+    obj_count(&_mem_stat.utr, 1);
+#endif
     utr->udev = udev;
     mem_debug("[ALLOC] [UTR] - 0x%x\n", (int)utr);
     return utr;
@@ -222,8 +521,13 @@ void free_utr(UTR_T *utr)
         return;
 
     mem_debug("[FREE] [UTR] - 0x%x\n", (int)utr);
-    free(utr);
-    memory_counter(0-(int)sizeof(*utr));
+#if STATIC_MEMORY_ALLOC
+    if (obj_free(_utr_map, utr, _utr_pool, sizeof(UTR_T), MAX_UTR_NUM, &_mem_stat.utr) < 0)
+        USB_error("free_utr - not found!\n");
+#else
+    heap_free(utr, sizeof(*utr));
+    obj_count(&_mem_stat.utr, -1);
+#endif
 }
 
 /*--------------------------------------------------------------------------*/
@@ -235,17 +539,13 @@ ED_T * alloc_ohci_ED(void)
     int    i;
     ED_T   *ed;
 
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    i = pool_alloc(0, 1, &_mem_stat.ed);
+    if (i >= 0)
     {
-        if (_unit_used[i] == 0)
-        {
-            _unit_used[i] = 1;
-            _mem_pool_used++;
-            ed = (ED_T *)&_mem_pool[i];
-            memset(ed, 0, sizeof(*ed));
-            mem_debug("[ALLOC] [ED] - 0x%x\n", (int)ed);
-            return ed;
-        }
+        ed = (ED_T *)&_mem_pool[i];
+        memset(ed, 0, sizeof(*ed));
+        mem_debug("[ALLOC] [ED] - 0x%x\n", (int)ed);
+        return ed;
     }
     USB_error("alloc_ohci_ED failed!\n");
     return NULL;
@@ -253,17 +553,10 @@ ED_T * alloc_ohci_ED(void)
 
 void free_ohci_ED(ED_T *ed)
 {
-    int      i;
-
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    if (pool_free(ed, 1, &_mem_stat.ed) == 0)
     {
-        if ((uint32_t)&_mem_pool[i] == (uint32_t)ed)
-        {
-            mem_debug("[FREE]  [ED] - 0x%x\n", (int)ed);
-            _unit_used[i] = 0;
-            _mem_pool_used--;
-            return;
-        }
+        mem_debug("[FREE]  [ED] - 0x%x\n", (int)ed);
+        return;
     }
     USB_debug("free_ohci_ED - not found! (ignored in case of multiple UTR)\n");
 }
@@ -276,19 +569,15 @@ TD_T * alloc_ohci_TD(UTR_T *utr)
     int    i;
     TD_T   *td;
 
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    i = pool_alloc(0, 1, &_mem_stat.td);
+    if (i >= 0)
     {
-        if (_unit_used[i] == 0)
-        {
-            _unit_used[i] = 1;
-            _mem_pool_used++;
-            td = (TD_T *)&_mem_pool[i];
-
-            memset(td, 0, sizeof(*td));
-            td->utr = utr;
-            mem_debug("[ALLOC] [TD] - 0x%x\n", (int)td);
-            return td;
-        }
+        td = (TD_T *)&_mem_pool[i];
+
+        memset(td, 0, sizeof(*td));
+        td->utr = utr;
+        mem_debug("[ALLOC] [TD] - 0x%x\n", (int)td);
+        return td;
     }
     USB_error("alloc_ohci_TD failed!\n");
     return NULL;
@@ -296,17 +585,10 @@ TD_T * alloc_ohci_TD(UTR_T *utr)
 
 void free_ohci_TD(TD_T *td)
 {
-    int   i;
-
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    if (pool_free(td, 1, &_mem_stat.td) == 0)
     {
-        if ((uint32_t)&_mem_pool[i] == (uint32_t)td)
-        {
-            mem_debug("[FREE]  [TD] - 0x%x\n", (int)td);
-            _unit_used[i] = 0;
-            _mem_pool_used--;
-            return;
-        }
+        mem_debug("[FREE]  [TD] - 0x%x\n", (int)td);
+        return;
     }
     USB_error("free_ohci_TD - not found!\n");
 }
@@ -317,26 +599,19 @@ void free_ohci_TD(TD_T *td)
 QH_T * alloc_ehci_QH(void)
 {
     int    i;
-    QH_T   *qh = NULL;
+    QH_T   *qh;
 
-    for (i = (_sidx+1) % MEM_POOL_UNIT_NUM; i != _sidx; i = (i+1) % MEM_POOL_UNIT_NUM)
-    {
-        if (_unit_used[i] == 0)
-        {
-            _unit_used[i] = 1;
-            _sidx = i;
-            _mem_pool_used++;
-            qh = (QH_T *)&_mem_pool[i];
-            memset(qh, 0, sizeof(*qh));
-            mem_debug("[ALLOC] [QH] - 0x%x\n", (int)qh);
-            break;
-        }
-    }
-    if (qh == NULL)
+    i = pool_alloc((_sidx+1) % MEM_POOL_UNIT_NUM, 1, &_mem_stat.qh);
+    if (i < 0)
     {
         USB_error("alloc_ehci_QH failed!\n");
         return NULL;
     }
+    _sidx = i;
+    qh = (QH_T *)&_mem_pool[i];
+    memset(qh, 0, sizeof(*qh));
+    mem_debug("[ALLOC] [QH] - 0x%x\n", (int)qh);
+
     qh->Curr_qTD        = QTD_LIST_END;
     qh->OL_Next_qTD     = QTD_LIST_END;
     qh->OL_Alt_Next_qTD = QTD_LIST_END;
@@ -346,17 +621,10 @@ QH_T * alloc_ehci_QH(void)
 
 void free_ehci_QH(QH_T *qh)
 {
-    int      i;
-
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    if (pool_free(qh, 1, &_mem_stat.qh) == 0)
     {
-        if ((uint32_t)&_mem_pool[i] == (uint32_t)qh)
-        {
-            mem_debug("[FREE]  [QH] - 0x%x\n", (int)qh);
-            _unit_used[i] = 0;
-            _mem_pool_used--;
-            return;
-        }
+        mem_debug("[FREE]  [QH] - 0x%x\n", (int)qh);
+        return;
     }
     USB_debug("free_ehci_QH - not found! (ignored in case of multiple UTR)\n");
 }
@@ -369,23 +637,19 @@ qTD_T * alloc_ehci_qTD(UTR_T *utr)
     int     i;
     qTD_T   *qtd;
 
-    for (i = (_sidx+1) % MEM_POOL_UNIT_NUM; i != _sidx; i = (i+1) % MEM_POOL_UNIT_NUM)
+    i = pool_alloc((_sidx+1) % MEM_POOL_UNIT_NUM, 1, &_mem_stat.qtd);
+    if (i >= 0)
     {
-        if (_unit_used[i] == 0)
-        {
-            _unit_used[i] = 1;
-            _sidx = i;
-            _mem_pool_used++;
-            qtd = (qTD_T *)&_mem_pool[i];
-
-            memset(qtd, 0, sizeof(*qtd));
-            qtd->Next_qTD     = QTD_LIST_END;
-            qtd->Alt_Next_qTD = QTD_LIST_END;
-            qtd->Token        = 0x1197B7F; // QTD_STS_HALT;  visit_qtd() will not remove a qTD with this mark. It means the qTD still not ready for transfer.
-            qtd->utr = utr;
-            mem_debug("[ALLOC] [qTD] - 0x%x\n", (int)qtd);
-            return qtd;
-        }
+        _sidx = i;
+        qtd = (qTD_T *)&_mem_pool[i];
+
+        memset(qtd, 0, sizeof(*qtd));
+        qtd->Next_qTD     = QTD_LIST_END;
+        qtd->Alt_Next_qTD = QTD_LIST_END;
+        qtd->Token        = 0x1197B7F; // QTD_STS_HALT;  visit_qtd() will not remove a qTD with this mark. It means the qTD still not ready for transfer.
+        qtd->utr = utr;
+        mem_debug("[ALLOC] [qTD] - 0x%x\n", (int)qtd);
+        return qtd;
     }
     USB_error("alloc_ehci_qTD failed!\n");
     return NULL;
@@ -393,17 +657,10 @@ qTD_T * alloc_ehci_qTD(UTR_T *utr)
 
 void free_ehci_qTD(qTD_T *qtd)
 {
-    int   i;
-
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    if (pool_free(qtd, 1, &_mem_stat.qtd) == 0)
     {
-        if ((uint32_t)&_mem_pool[i] == (uint32_t)qtd)
-        {
-            mem_debug("[FREE]  [qTD] - 0x%x\n", (int)qtd);
-            _unit_used[i] = 0;
-            _mem_pool_used--;
-            return;
-        }
+        mem_debug("[FREE]  [qTD] - 0x%x\n", (int)qtd);
+        return;
     }
     USB_error("free_ehci_qTD 0x%x - not found!\n", (int)qtd);
 }
@@ -416,21 +673,14 @@ iTD_T * alloc_ehci_iTD(void)
     int     i;
     iTD_T   *itd;
 
-    for (i = (_sidx+1) % MEM_POOL_UNIT_NUM; i != _sidx; i = (i+1) % MEM_POOL_UNIT_NUM)
+    i = pool_alloc((_sidx+1) % MEM_POOL_UNIT_NUM, 2, &_mem_stat.itd);
+    if (i >= 0)
     {
-        if (i+2 >= MEM_POOL_UNIT_NUM)
-            continue;
-
-        if ((_unit_used[i] == 0) && (_unit_used[i+1] == 0))
-        {
-            _unit_used[i] = _unit_used[i+1] = 1;
-            _sidx = i+1;
-            _mem_pool_used += 2;
-            itd = (iTD_T *)&_mem_pool[i];
-            memset(itd, 0, sizeof(*itd));
-            mem_debug("[ALLOC] [iTD] - 0x%x\n", (int)itd);
-            return itd;
-        }
+        _sidx = i+1;
+        itd = (iTD_T *)&_mem_pool[i];
+        memset(itd, 0, sizeof(*itd));
+        mem_debug("[ALLOC] [iTD] - 0x%x\n", (int)itd);
+        return itd;
     }
     USB_error("alloc_ehci_iTD failed!\n");
     return NULL;
@@ -438,17 +688,10 @@ iTD_T * alloc_ehci_iTD(void)
 
 void free_ehci_iTD(iTD_T *itd)
 {
-    int   i;
-
-    for (i = 0; i+1 < MEM_POOL_UNIT_NUM; i++)
+    if (pool_free(itd, 2, &_mem_stat.itd) == 0)
     {
-        if ((uint32_t)&_mem_pool[i] == (uint32_t)itd)
-        {
-            mem_debug("[FREE]  [iTD] - 0x%x\n", (int)itd);
-            _unit_used[i] = _unit_used[i+1] = 0;
-            _mem_pool_used -= 2;
-            return;
-        }
+        mem_debug("[FREE]  [iTD] - 0x%x\n", (int)itd);
+        return;
     }
     USB_error("free_ehci_iTD 0x%x - not found!\n", (int)itd);
 }
@@ -461,18 +704,14 @@ siTD_T * alloc_ehci_siTD(void)
     int     i;
     siTD_T  *sitd;
 
-    for (i = (_sidx+1) % MEM_POOL_UNIT_NUM; i != _sidx; i = (i+1) % MEM_POOL_UNIT_NUM)
+    i = pool_alloc((_sidx+1) % MEM_POOL_UNIT_NUM, 1, &_mem_stat.sitd);
+    if (i >= 0)
     {
-        if (_unit_used[i] == 0)
-        {
-            _unit_used[i] = 1;
-            _sidx = i;
-            _mem_pool_used ++;
-            sitd = (siTD_T *)&_mem_pool[i];
-            memset(sitd, 0, sizeof(*sitd));
-            mem_debug("[ALLOC] [siTD] - 0x%x\n", (int)sitd);
-            return sitd;
-        }
+        _sidx = i;
+        sitd = (siTD_T *)&_mem_pool[i];
+        memset(sitd, 0, sizeof(*sitd));
+        mem_debug("[ALLOC] [siTD] - 0x%x\n", (int)sitd);
+        return sitd;
     }
     USB_error("alloc_ehci_siTD failed!\n");
     return NULL;
@@ -480,17 +719,10 @@ siTD_T * alloc_ehci_siTD(void)
 
 void free_ehci_siTD(siTD_T *sitd)
 {
-    int   i;
-
-    for (i = 0; i < MEM_POOL_UNIT_NUM; i++)
+    if (pool_free(sitd, 1, &_mem_stat.sitd) == 0)
     {
-        if ((uint32_t)&_mem_pool[i] == (uint32_t)sitd)
-        {
-            mem_debug("[FREE]  [siTD] - 0x%x\n", (int)sitd);
-            _unit_used[i] = 0;
-            _mem_pool_used--;
-            return;
-        }
+        mem_debug("[FREE]  [siTD] - 0x%x\n", (int)sitd);
+        return;
     }
     USB_error("free_ehci_siTD 0x%x - not found!\n", (int)sitd);
 }
@@ -61,7 +61,6 @@ static void add_to_ED_remove_list(ED_T *ed)
     ENABLE_OHCI_IRQ();
     _ohci->HcInterruptStatus = USBH_HcInterruptStatus_SF_Msk;
     _ohci->HcInterruptEnable |= USBH_HcInterruptEnable_SF_Msk;
-    delay_us(2000);                         /* Full speed wait 2 ms is enough             */
 }
 
 static int ohci_reset(void)
@@ -209,7 +208,8 @@ static int  ohci_init(void)
     _ohci->HcRhStatus = USBH_HcRhStatus_LPSC_Msk;
 #endif
 
-    _ohci->HcInterruptEnable = USBH_HcInterruptEnable_MIE_Msk | USBH_HcInterruptEnable_WDH_Msk | USBH_HcInterruptEnable_SF_Msk;
+    _ohci->HcInterruptEnable = USBH_HcInterruptEnable_MIE_Msk | USBH_HcInterruptEnable_WDH_Msk | USBH_HcInterruptEnable_SF_Msk |
+                               USBH_HcInterruptEnable_RHSC_Msk;
 
     /* POTPGT delay is bits 24-31, in 20 ms units.                                         */
     delay_us(20000);
@@ -285,6 +285,7 @@ static int ohci_quit_xfer(UTR_T *utr, EP_INFO_T *ep)
         add_to_ED_remove_list(ed);
         ep->hw_pipe = NULL;
     }
+    delay_us(2000);                         /* Full speed wait 2 ms is enough             */
 
     return 0;
 }
@@ -463,34 +464,33 @@ static int ohci_ctrl_xfer(UTR_T *utr)
     return 0;
 }
 
+/*
+ *  A bulk ED always ends with a dummy TD, the one TailP points to. A new UTR is written
+ *  into the dummy TD and the TDs chained after it, and a new dummy TD becomes the tail.
+ *  The host controller stops at TailP, so UTRs can be queued on an ED while it is
+ *  being processed. They are called back in the order they were submitted.
+ */
 static int ohci_bulk_xfer(UTR_T *utr)
 {
     UDEV_T     *udev = utr->udev;
     EP_INFO_T  *ep = utr->ep;
     ED_T       *ed;
-    TD_T       *td, *td_p, *td_list = NULL;
+    TD_T       *td, *td_p, *td_dummy, *td_list = NULL;
     uint32_t   info;
     uint32_t   data_len, xfer_len;
     int8_t     bIsNewED = 0;
     uint8_t    *buff;
 
     /*------------------------------------------------------------------------------------*/
-    /*  Check if there's uncompleted transfer on this endpoint...                         */
-    /*  Prepare ED                                                                        */
+    /*  Find the ED of this endpoint or prepare a new one                                 */
     /*------------------------------------------------------------------------------------*/
     info = ed_make_info(udev, ep);
 
-    /* Check if there's any transfer pending on this endpoint... */
     ed = (ED_T *)_ohci->HcBulkHeadED;       /* get the head of bulk endpoint list         */
     while (ed != NULL)
     {
-        if (ed->Info == info)               /* have transfer of this EP not completed?    */
-        {
-            if ((ed->HeadP & 0xFFFFFFF0) != (ed->TailP & 0xFFFFFFF0))
-                return USBH_ERR_OHCI_EP_BUSY;     /* endpoint is busy                     */
-            else
-                break;                      /* ED already there...                        */
-        }
+        if (ed->Info == info)               /* ED already there...                        */
+            break;
         ed = (ED_T *)ed->NextED;
     }
 
@@ -500,11 +500,22 @@ static int ohci_bulk_xfer(UTR_T *utr)
         ed = alloc_ohci_ED();               /* allocate an Endpoint Descriptor            */
         if (ed == NULL)
             return USBH_ERR_MEMORY_OUT;
+        td = alloc_ohci_TD(NULL);           /* the dummy TD of an empty ED                */
+        if (td == NULL)
+        {
+            free_ohci_ED(ed);
+            return USBH_ERR_MEMORY_OUT;
+        }
         ed->Info = info;
-        ed->HeadP = 0;
+        ed->HeadP = (uint32_t)td;
+        ed->TailP = (uint32_t)td;
         ED_debug("Link BULK ED 0x%x: 0x%x 0x%x 0x%x 0x%x\n", (int)ed, ed->Info, ed->TailP, ed->HeadP, ed->NextED);
     }
 
+    td_dummy = alloc_ohci_TD(NULL);         /* the new tail of ED                         */
+    if (td_dummy == NULL)
+        goto mem_out;
+
     ep->hw_pipe = (void *)ed;
 
     /*------------------------------------------------------------------------------------*/
@@ -513,6 +524,7 @@ static int ohci_bulk_xfer(UTR_T *utr)
     utr->td_cnt = 0;
     data_len = utr->data_len;
     buff = utr->buff;
+    td_p = NULL;
 
     do
     {
@@ -528,9 +540,17 @@ static int ohci_bulk_xfer(UTR_T *utr)
         else
             xfer_len = data_len;            /* remaining data length < 4K                 */
 
-        td = alloc_ohci_TD(utr);            /* allocate a TD                              */
-        if (td == NULL)
-            goto mem_out;
+        if (td_list == NULL)
+        {
+            td = (TD_T *)ed->TailP;         /* the first TD is the current dummy TD       */
+            td->utr = utr;
+        }
+        else
+        {
+            td = alloc_ohci_TD(utr);        /* allocate a TD                              */
+            if (td == NULL)
+                goto mem_out;
+        }
         /* fill this TD                               */
         write_td(td, info, buff, xfer_len);
         td->ed = ed;
@@ -542,29 +562,23 @@ static int ohci_bulk_xfer(UTR_T *utr)
 
         /* chain to end of TD list */
         if (td_list == NULL)
-        {
             td_list = td;
-        }
         else
-        {
-            td_p = td_list;
-            while (td_p->NextTD != 0)
-                td_p = (TD_T *)td_p->NextTD;
             td_p->NextTD = (uint32_t)td;
-        }
-
+        td_p = td;
     }
     while (data_len > 0);
 
+    td->NextTD = (uint32_t)td_dummy;
+
     /*------------------------------------------------------------------------------------*/
     /*  Start transfer                                                                    */
     /*------------------------------------------------------------------------------------*/
     utr->status = 0;
     DISABLE_OHCI_IRQ();
-    ed->HeadP = (ed->HeadP & 0x2) | (uint32_t)td_list;       /* keep toggleCarry bit      */
+    ed->TailP = (uint32_t)td_dummy;         /* hand the TDs over to the HC                */
     if (bIsNewED)
     {
-        ed->HeadP = (uint32_t)td_list;
         /* Link ED to OHCI Bulk List */
         ed->NextED = _ohci->HcBulkHeadED;
         _ohci->HcBulkHeadED = (uint32_t)ed;
@@ -576,13 +590,26 @@ static int ohci_bulk_xfer(UTR_T *utr)
     return 0;
 
 mem_out:
-    while (td_list != NULL)
+    if (td_list != NULL)
     {
-        td = td_list;
-        td_list = (TD_T *)td_list->NextTD;
-        free_ohci_TD(td);
+        td = (TD_T *)td_list->NextTD;       /* keep the dummy TD, free the others         */
+        td_list->NextTD = 0;
+        td_list->utr = NULL;
+        while (td != NULL)
+        {
+            td_p = td;
+            td = (TD_T *)td->NextTD;
+            free_ohci_TD(td_p);
+        }
+    }
+    if (td_dummy != NULL)
+        free_ohci_TD(td_dummy);
+    if (bIsNewED)
+    {
+        free_ohci_TD((TD_T *)ed->TailP);
+        free_ohci_ED(ed);
+        ep->hw_pipe = NULL;
     }
-    free_ohci_ED(ed);
     return USBH_ERR_MEMORY_OUT;
 }
 
@@ -861,6 +888,8 @@ static int ohci_rh_polling(void)
     UDEV_T    *udev;
     int       ret;
 
+    _ohci->HcRhStatus = USBH_HcRhStatus_OCIC_Msk;                  /* clear over-current change */
+
     for (i = 0; i < 2; i++)
     {
         if (((SYS->CSERVER & SYS_CSERVER_VERSION_Msk) == 0x1) && (i == 0))
@@ -934,6 +963,8 @@ static int ohci_rh_polling(void)
             change = 1;
         }
     }
+
+    _ohci->HcInterruptEnable = USBH_HcInterruptEnable_RHSC_Msk;    /* disabled by OHCI_IRQHandler() */
     return change;
 }
 
@@ -979,6 +1010,7 @@ void td_done(TD_T *td)
     else
     {
         cc = TD_CC_GET(info);
+        USB_TRACE_RETRY(utr, TD_EC_GET(info));
 
         /* short packet is fine */
         if ((cc != CC_NOERROR) && (cc != CC_DATA_UNDERRUN))
@@ -988,6 +1020,16 @@ void td_done(TD_T *td)
                 utr->status = USBH_ERR_STALL;
             else
                 utr->status = USBH_ERR_TRANSFER;
+
+            /*
+             *  The ED is halted. Remove it, so that the remaining TDs of this UTR and
+             *  the UTRs queued behind it are called back by remove_ed().
+             */
+            if (((info & TD_TYPE_Msk) == TD_TYPE_BULK) && (utr->ep->hw_pipe == (void *)td->ed))
+            {
+                add_to_ED_remove_list(td->ed);
+                utr->ep->hw_pipe = NULL;
+            }
         }
 
         switch (info & TD_TYPE_Msk)
@@ -1019,6 +1061,7 @@ td_out:
     /* If all TDs are done, call-back to requester. */
     if (utr->td_cnt == 0)
     {
+        USB_TRACE_DONE(utr, utr->status);
         utr->bIsTransferDone = 1;
         if (utr->func)
             utr->func(utr);
@@ -1125,10 +1168,15 @@ static void remove_ed()
                     free_ohci_TD(td);
                     td = td_next;
 
+                    if (utr == NULL)        /* the dummy TD at the tail of ED             */
+                        continue;
+
                     utr->td_cnt--;
                     if (utr->td_cnt == 0)
                     {
-                        utr->status = USBH_ERR_ABORT;
+                        if (utr->status == 0)
+                            utr->status = USBH_ERR_ABORT;
+                        USB_TRACE_DONE(utr, utr->status);
                         utr->bIsTransferDone = 1;
                         if (utr->func)
                             utr->func(utr);
@@ -1203,7 +1251,9 @@ void OHCI_IRQHandler(void)
 
     if (int_sts & USBH_HcInterruptStatus_RHSC_Msk)
     {
+        /* port change bits stay set until ohci_rh_polling(), which enables RHSC again */
         _ohci->HcInterruptDisable = USBH_HcInterruptDisable_RHSC_Msk;
+        usbh_hub_event(HUB_EV_OHCI_RH);
     }
 
     _ohci->HcInterruptStatus = int_sts;
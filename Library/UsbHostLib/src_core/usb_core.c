@@ -58,6 +58,10 @@ void  usbh_core_init()
 
     usbh_memory_init();
 
+#if ENABLE_USB_TRACE
+    usbh_trace_reset();
+#endif
+
     _ohci->HcMiscControl |= USBH_HcMiscControl_OCAL_Msk; /* Over-current active low  */
     //_ohci->HcMiscControl &= ~USBH_HcMiscControl_OCAL_Msk; /* Over-current active high  */
 
@@ -279,9 +283,11 @@ int usbh_ctrl_xfer(UDEV_T *udev, uint8_t bmRequestType, uint8_t bRequest, uint16
     utr->buff = buff;
     utr->data_len = wLength;
     utr->bIsTransferDone = 0;
+    USB_TRACE_SUBMIT(utr, &udev->ep0);
     status = udev->hc_driver->ctrl_xfer(utr);
     if (status < 0)
     {
+        USB_TRACE_DONE(utr, status);
         udev->ep0.hw_pipe = NULL;
         free_utr(utr);
         return status;
@@ -292,6 +298,7 @@ int usbh_ctrl_xfer(UDEV_T *udev, uint8_t bmRequestType, uint8_t bRequest, uint16
     {
         if (get_ticks() - t0 > timeout)
         {
+            USB_TRACE_DONE(utr, USBH_ERR_TIMEOUT);
             usbh_quit_utr(utr);
             free_utr(utr);
             udev->ep0.hw_pipe = NULL;
@@ -314,14 +321,28 @@ int usbh_ctrl_xfer(UDEV_T *udev, uint8_t bmRequestType, uint8_t bRequest, uint16
 /**
   * @brief    Execute a bulk transfer request. This function will return immediately after
   *           issued the bulk transfer. USB stack will later call back utr->func() once the bulk
-  *           transfer was done or aborted.
+  *           transfer was done or aborted. Several UTRs can be issued to the same endpoint
+  *           before the first one is done. They are queued and called back in issue order.
+  *           If a transfer fails with the endpoint halted, the UTRs queued behind it are
+  *           called back with USBH_ERR_ABORT. Quitting one of the queued UTRs also aborts
+  *           all the others of its endpoint.
   * @param[in]  utr    The bulk transfer request.
   * @retval   0     Transfer success
   * @retval   < 0   Failed. Refer to error code definitions.
   */
 int usbh_bulk_xfer(UTR_T *utr)
 {
+#if ENABLE_USB_TRACE
+    int   ret;
+
+    USB_TRACE_SUBMIT(utr, utr->ep);
+    ret = utr->udev->hc_driver->bulk_xfer(utr);
+    if (ret < 0)
+        USB_TRACE_DONE(utr, ret);
+    return ret;
+#else
     return utr->udev->hc_driver->bulk_xfer(utr);
+#endif
 }
 
 /**
@@ -334,7 +355,17 @@ int usbh_bulk_xfer(UTR_T *utr)
   */
 int usbh_int_xfer(UTR_T *utr)
 {
+#if ENABLE_USB_TRACE
+    int   ret;
+
+    USB_TRACE_SUBMIT(utr, utr->ep);
+    ret = utr->udev->hc_driver->int_xfer(utr);
+    if (ret < 0)
+        USB_TRACE_DONE(utr, ret);
+    return ret;
+#else
     return utr->udev->hc_driver->int_xfer(utr);
+#endif
 }
 
 /**
@@ -357,7 +388,19 @@ int usbh_iso_xfer(UTR_T *utr)
         printf("iso_xfer - 0x%x\n", (int)utr->udev->hc_driver->iso_xfer);
         return -1;
     }
+#if ENABLE_USB_TRACE
+    {
+        int   ret;
+
+        USB_TRACE_SUBMIT(utr, utr->ep);
+        ret = utr->udev->hc_driver->iso_xfer(utr);
+        if (ret < 0)
+            USB_TRACE_DONE(utr, ret);
+        return ret;
+    }
+#else
     return utr->udev->hc_driver->iso_xfer(utr);
+#endif
 }
 
 /**
@@ -1001,7 +1044,7 @@ int  connect_device(UDEV_T *udev)
         USB_debug("Warning! This device has multiple configurations [%d]. \n", udev->descriptor.bNumConfigurations);
     }
 
-    conf = (DESC_CONF_T *)usbh_alloc_mem(MAX_DESC_BUFF_SIZE);
+    conf = (DESC_CONF_T *)usbh_alloc_desc_buff();
     if (conf == NULL)
     {
         free_dev_address(udev->dev_num);
@@ -1023,7 +1066,7 @@ int  connect_device(UDEV_T *udev)
 #endif
 
 #if 0  /* printf string descriptors, for debug only */
-    str_buff = (uint8_t *)usbh_alloc_mem(MAX_DESC_BUFF_SIZE);
+    str_buff = usbh_alloc_desc_buff();
     if (udev->descriptor.iManufacturer != 0)
     {
         usbh_get_string_descriptor(udev, udev->descriptor.iManufacturer, str_buff, MAX_DESC_BUFF_SIZE);
@@ -1039,7 +1082,7 @@ int  connect_device(UDEV_T *udev)
         usbh_get_string_descriptor(udev, udev->descriptor.iSerialNumber, str_buff, MAX_DESC_BUFF_SIZE);
         print_usb_string("Serial Number: ", str_buff);
     }
-    usbh_free_mem(str_buff, MAX_DESC_BUFF_SIZE);
+    usbh_free_desc_buff(str_buff);
 #endif
 
     /* Always select the first configuration */
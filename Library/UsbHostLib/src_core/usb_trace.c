@@ -0,0 +1,307 @@
+/**************************************************************************//**
+ * @file     usb_trace.c
+ * @version  V1.00
+ * @brief    USB host library transfer trace.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "NuMicro.h"
+
+#include "usb.h"
+
+#if ENABLE_USB_TRACE
+
+/** @addtogroup LIBRARY Library
+  @{
+*/
+
+/** @addtogroup USBH_Library USB Host Library
+  @{
+*/
+
+/** @addtogroup USBH_EXPORTED_FUNCTIONS USB Host Exported Functions
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+/*
+ *  usbh_trace_submit() is called by usbh_ctrl_xfer(), usbh_bulk_xfer(), usbh_int_xfer() and
+ *  usbh_iso_xfer(), usbh_trace_done() by the host controller drivers right before a UTR is
+ *  called back. Both may run in thread and in interrupt context.
+ *
+ *  The statistics slot of an endpoint is cached in EP_INFO_T and checked against the device
+ *  number and endpoint address, so that it is searched for only once per endpoint and an
+ *  EP_INFO_T reused for another endpoint finds its own slot. A slot is kept for the device
+ *  number and endpoint address it was first used by, the statistics of a device that
+ *  reconnects with the same number go on in it. The counters of a slot are updated with
+ *  interrupts disabled.
+ *
+ *  An event is claimed in the trace ring with LDREX/STREX on _trace_wr, so that an interrupt
+ *  can log between the claim and the write of an event of the thread. The seq of an event is
+ *  written last, usbh_trace_read() stops at an event claimed but not written yet. When the ring
+ *  is full new events are dropped and counted in _trace_lost.
+ */
+
+static USBH_TRACE_EP_T   _trace_ep[USB_TRACE_EP_NUM];
+static int               _trace_ep_cnt;
+
+static USBH_TRACE_EVT_T  _trace_ring[USB_TRACE_RING_SIZE];
+static volatile uint32_t _trace_wr, _trace_rd;
+static volatile uint32_t _trace_lost;
+
+static const char        *_ep_type_name[4] = { "ctrl", "iso", "bulk", "int" };
+
+#define TRACE_EP_ADDR(udev, ep)     (((ep) == &(udev)->ep0) ? 0 : (ep)->bEndpointAddress)
+
+/* Find or assign the statistics slot of <ep>. USB_TRACE_EP_NUM if the table is full. */
+static int  trace_find_ep(UDEV_T *udev, EP_INFO_T *ep)
+{
+    uint32_t  primask;
+    uint8_t   ep_addr;
+    int       i;
+
+    ep_addr = TRACE_EP_ADDR(udev, ep);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    for (i = 0; i < _trace_ep_cnt; i++)
+    {
+        if ((_trace_ep[i].dev_num == udev->dev_num) && (_trace_ep[i].ep_addr == ep_addr))
+            break;
+    }
+    if ((i == _trace_ep_cnt) && (i < USB_TRACE_EP_NUM))
+    {
+        _trace_ep[i].dev_num = udev->dev_num;
+        _trace_ep[i].ep_addr = ep_addr;
+        _trace_ep[i].ep_type = (ep_addr == 0) ? EP_ATTR_TT_CTRL : (ep->bmAttributes & EP_ATTR_TT_MASK);
+        _trace_ep_cnt++;
+    }
+    if (i < USB_TRACE_EP_NUM)
+        ep->trace_idx = i;
+    __set_PRIMASK(primask);
+    return i;
+}
+
+static void  trace_log(UTR_T *utr, uint32_t time, uint8_t type, uint32_t len, int status)
+{
+    USBH_TRACE_EVT_T  *evt;
+    uint32_t          wr;
+
+    do
+    {
+        wr = __LDREXW(&_trace_wr);
+        if (wr - _trace_rd >= USB_TRACE_RING_SIZE)
+        {
+            __CLREX();
+            _trace_lost++;
+            return;
+        }
+    }
+    while (__STREXW(wr + 1, &_trace_wr));
+
+    evt = &_trace_ring[wr & (USB_TRACE_RING_SIZE - 1)];
+    evt->time = time;
+    evt->len = len;
+    evt->status = status;
+    evt->dev_num = utr->udev->dev_num;
+    evt->ep_addr = (utr->ep == NULL) ? 0 : utr->ep->bEndpointAddress;
+    evt->type = type;
+    evt->retries = utr->trace_retry;
+    __DMB();
+    evt->seq = (uint16_t)(wr + 1);
+}
+
+void  usbh_trace_submit(UTR_T *utr, EP_INFO_T *ep)
+{
+    UDEV_T    *udev = utr->udev;
+    uint32_t  idx = ep->trace_idx;
+
+    if ((idx >= _trace_ep_cnt) || (_trace_ep[idx].dev_num != udev->dev_num) ||
+            (_trace_ep[idx].ep_addr != TRACE_EP_ADDR(udev, ep)))
+        idx = trace_find_ep(udev, ep);
+
+    utr->trace_idx = idx;
+    utr->trace_retry = 0;
+    utr->trace_t0 = USB_TRACE_TIMER();
+    trace_log(utr, utr->trace_t0, USBH_TRACE_SUBMIT, utr->data_len, 0);
+}
+
+void  usbh_trace_done(UTR_T *utr, int status)
+{
+    USBH_TRACE_EP_T  *st;
+    uint32_t         t, lat, len, lb, sb, primask;
+    int              i;
+
+    t = USB_TRACE_TIMER();
+    lat = t - utr->trace_t0;
+
+    if ((utr->ep != NULL) && ((utr->ep->bmAttributes & EP_ATTR_TT_MASK) == EP_ATTR_TT_ISO))
+    {
+        for (i = 0, len = 0; i < IF_PER_UTR; i++)
+            len += utr->iso_xlen[i];
+    }
+    else
+        len = utr->xfer_len;
+
+    trace_log(utr, t, USBH_TRACE_DONE, len, status);
+
+    if (utr->trace_idx >= USB_TRACE_EP_NUM)
+        return;
+    st = &_trace_ep[utr->trace_idx];
+
+    lb = 32 - __CLZ(lat >> USB_TRACE_HIST_SHIFT);
+    sb = 32 - __CLZ(len);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    st->xfers++;
+    st->bytes += len;
+    st->retries += utr->trace_retry;
+    if (status == 0)
+    {
+        if ((len < utr->data_len) && (st->ep_type != EP_ATTR_TT_ISO))
+            st->short_xfers++;
+    }
+    else if ((status == USBH_ERR_ABORT) || (status == USBH_ERR_TIMEOUT))
+        st->aborts++;
+    else
+        st->halts++;
+
+    if (lat > st->lat_max)
+        st->lat_max = lat;
+    st->lat_hist[(lb < USBH_TRACE_HIST_NUM) ? lb : USBH_TRACE_HIST_NUM - 1]++;
+    st->size_hist[(sb < USBH_TRACE_HIST_NUM) ? sb : USBH_TRACE_HIST_NUM - 1]++;
+    __set_PRIMASK(primask);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief    Clear the transfer statistics and the trace ring, and start the trace timer.
+  *           Called by usbh_core_init().
+  * @return   None
+  */
+void  usbh_trace_reset(void)
+{
+    uint32_t  primask;
+
+    USB_TRACE_TIMER_INIT();
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    memset(_trace_ep, 0, sizeof(_trace_ep));
+    memset(_trace_ring, 0, sizeof(_trace_ring));
+    _trace_ep_cnt = 0;
+    _trace_wr = _trace_rd = 0;
+    _trace_lost = 0;
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief    Get the transfer statistics of an endpoint.
+  * @param[in]  idx    Index of the endpoint, from 0 in the order they were first used.
+  * @return   The statistics, NULL if no endpoint has this index.
+  */
+USBH_TRACE_EP_T * usbh_trace_get_ep(int idx)
+{
+    if ((idx < 0) || (idx >= _trace_ep_cnt))
+        return NULL;
+    return &_trace_ep[idx];
+}
+
+/**
+  * @brief    Take events from the trace ring, oldest first. The events can be sent to a
+  *           host PC over UART or USB. Must not be called from more than one context.
+  * @param[out] evt    Buffer for the events
+  * @param[in]  max    Size of evt in events
+  * @return   Number of events taken.
+  */
+int  usbh_trace_read(USBH_TRACE_EVT_T *evt, int max)
+{
+    USBH_TRACE_EVT_T  *e;
+    int               n = 0;
+
+    while ((n < max) && (_trace_rd != _trace_wr))
+    {
+        e = &_trace_ring[_trace_rd & (USB_TRACE_RING_SIZE - 1)];
+        if (e->seq != (uint16_t)(_trace_rd + 1))
+            break;                          /* claimed, not written yet                   */
+        __DMB();
+        evt[n++] = *e;
+        __DMB();
+        _trace_rd++;
+    }
+    return n;
+}
+
+/**
+  * @brief    Get the number of events dropped because the trace ring was full.
+  * @return   Events dropped since usbh_trace_reset().
+  */
+uint32_t  usbh_trace_lost(void)
+{
+    return _trace_lost;
+}
+
+/**
+  * @brief    Print the transfer statistics of all endpoints and the events in the trace ring.
+  * @return   None
+  */
+void  usbh_trace_dump(void)
+{
+    USBH_TRACE_EP_T   *st;
+    USBH_TRACE_EVT_T  evt;
+    uint32_t          mhz = USB_TRACE_TIMER_MHZ;
+    int               i, b;
+
+    printf("dev  ep type    xfers      bytes  short  halts aborts retries  max us\n");
+    for (i = 0; (st = usbh_trace_get_ep(i)) != NULL; i++)
+    {
+        printf("%3d  %02x %-4s %8u %10u %6u %6u %6u %7u %7u\n", st->dev_num, st->ep_addr,
+               _ep_type_name[st->ep_type & 3], st->xfers, st->bytes, st->short_xfers,
+               st->halts, st->aborts, st->retries, st->lat_max / mhz);
+
+        printf("    latency:");
+        for (b = 0; b < USBH_TRACE_HIST_NUM; b++)
+        {
+            if (st->lat_hist[b])
+                printf(" %s%u us: %u", (b < USBH_TRACE_HIST_NUM - 1) ? "<" : ">=",
+                       ((1u << (b + USB_TRACE_HIST_SHIFT)) >> (b < USBH_TRACE_HIST_NUM - 1 ? 0 : 1)) / mhz,
+                       st->lat_hist[b]);
+        }
+        printf("\n    size:");
+        for (b = 0; b < USBH_TRACE_HIST_NUM; b++)
+        {
+            if (st->size_hist[b])
+                printf(" %s%u: %u", (b < USBH_TRACE_HIST_NUM - 1) ? "<" : ">=",
+                       (b < USBH_TRACE_HIST_NUM - 1) ? (1u << b) : (1u << (b - 1)), st->size_hist[b]);
+        }
+        printf("\n");
+    }
+
+    printf("events (%u lost):\n", _trace_lost);
+    while (usbh_trace_read(&evt, 1))
+    {
+        printf("%10u us  %3d %02x %s %6u", evt.time / mhz, evt.dev_num, evt.ep_addr,
+               (evt.type == USBH_TRACE_SUBMIT) ? "submit" : "done  ", evt.len);
+        if (evt.type == USBH_TRACE_DONE)
+            printf("  status %d, %d retries", evt.status, evt.retries);
+        printf("\n");
+    }
+}
+
+/*@}*/ /* end of group USBH_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group USBH_Library */
+
+/*@}*/ /* end of group LIBRARY */
+
+#endif  /* ENABLE_USB_TRACE */
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
@@ -0,0 +1,483 @@
+/**************************************************************************//**
+ * @file     hid_parser.c
+ * @version  V1.00
+ * @brief    M480 USB Host HID driver, report descriptor parser.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "NuMicro.h"
+
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_hid.h"
+
+
+/// @cond HIDDEN_SYMBOLS
+
+/*
+ *  The report descriptor is compiled once into a table of fields. A field is one usage, or
+ *  the elements of an array, with its report ID, bit offset, size and logical range. The
+ *  value of an element is then taken from a report with a fixed number of byte loads and
+ *  shifts, whatever its size and position.
+ */
+
+#define HID_MAX_USAGE_RANGE     16          /* usages and usage ranges of a main item     */
+#define HID_MAX_PUSH            4           /* depth of the Push/Pop global item stack    */
+
+/* Item type */
+#define ITEM_MAIN               0
+#define ITEM_GLOBAL             1
+#define ITEM_LOCAL              2
+#define ITEM_LONG               0xFE        /* prefix byte of long items                  */
+
+/* Main item tags */
+#define MAIN_INPUT              0x8
+#define MAIN_OUTPUT             0x9
+#define MAIN_COLLECTION         0xA
+#define MAIN_FEATURE            0xB
+#define MAIN_END_COLLECTION     0xC
+
+/* Global item tags */
+#define GLOBAL_USAGE_PAGE       0x0
+#define GLOBAL_LOGICAL_MIN      0x1
+#define GLOBAL_LOGICAL_MAX      0x2
+#define GLOBAL_REPORT_SIZE      0x7
+#define GLOBAL_REPORT_ID        0x8
+#define GLOBAL_REPORT_COUNT     0x9
+#define GLOBAL_PUSH             0xA
+#define GLOBAL_POP              0xB
+
+/* Local item tags */
+#define LOCAL_USAGE             0x0
+#define LOCAL_USAGE_MIN         0x1
+#define LOCAL_USAGE_MAX         0x2
+
+typedef struct
+{
+    uint32_t   usage_page;
+    uint32_t   logical_min;                 /* item data as is, sign is decided by main item */
+    uint32_t   logical_max;
+    uint8_t    logical_min_size;
+    uint8_t    logical_max_size;
+    uint8_t    report_size;
+    uint8_t    report_id;
+    uint32_t   report_count;
+}  HID_GLOBAL_T;
+
+typedef struct
+{
+    uint32_t   min;                         /* page in bits 31~16                         */
+    uint32_t   max;
+}  HID_USAGE_RANGE_T;
+
+typedef struct
+{
+    HID_GLOBAL_T       global;
+    HID_GLOBAL_T       stack[HID_MAX_PUSH];
+    int                sp;
+    HID_USAGE_RANGE_T  usage[HID_MAX_USAGE_RANGE];
+    int                num_usage;
+    int                usage_min_pending;   /* Usage Minimum seen, waiting for the maximum */
+    int                depth;               /* collection depth                           */
+}  HID_PARSER_T;
+
+
+static int32_t  sign_extend(uint32_t data, int size)
+{
+    if (size == 1)
+        return (int8_t)data;
+    if (size == 2)
+        return (int16_t)data;
+    return (int32_t)data;
+}
+
+/* Usage of element <idx> of a main item */
+static uint32_t  element_usage(HID_PARSER_T *p, uint32_t idx)
+{
+    HID_USAGE_RANGE_T  *r;
+    int                i;
+
+    if (p->num_usage == 0)
+        return 0;
+
+    for (i = 0; i < p->num_usage; i++)
+    {
+        r = &p->usage[i];
+        if (idx <= r->max - r->min)
+            return r->min + idx;
+        idx -= r->max - r->min + 1;
+    }
+    return p->usage[p->num_usage - 1].max;  /* more elements than usages, repeat the last */
+}
+
+static HID_REPORT_T * find_report(HID_REPORT_MAP_T *map, int type, int id)
+{
+    int   i;
+
+    for (i = 0; i < map->num_report; i++)
+    {
+        if ((map->report[i].type == type) && (map->report[i].id == id))
+            return &map->report[i];
+    }
+    return NULL;
+}
+
+static int  add_main_item(HID_PARSER_T *p, HID_REPORT_MAP_T *map, int type, uint32_t data)
+{
+    HID_GLOBAL_T  *g = &p->global;
+    HID_REPORT_T  *rpt;
+    HID_FIELD_T   *f = NULL;
+    uint32_t      i, usage, bit_offset;
+    int32_t       lmin, lmax;
+
+    rpt = find_report(map, type, g->report_id);
+    if (rpt == NULL)
+    {
+        if (map->num_report >= CONFIG_HID_MAX_REPORT)
+            return HID_RET_NOT_SUPPORTED;
+        rpt = &map->report[map->num_report++];
+        rpt->id = g->report_id;
+        rpt->type = type;
+        rpt->bits = 0;
+    }
+
+    bit_offset = rpt->bits + (map->report_id_used ? 8 : 0);
+    if (rpt->bits + g->report_size * g->report_count > 0xFFF0)
+        return HID_RET_INVALID_PARAMETER;
+    rpt->bits += g->report_size * g->report_count;
+
+    /* padding and fields wider than 32 bits take space only */
+    if ((data & HID_FIELD_CONSTANT) || (g->report_size == 0) || (g->report_size > 32) ||
+            (g->report_count == 0))
+        return 0;
+
+    lmin = sign_extend(g->logical_min, g->logical_min_size);
+    if (lmin < 0)
+        lmax = sign_extend(g->logical_max, g->logical_max_size);
+    else
+        lmax = (int32_t)g->logical_max;     /* e.g. 0xFF in one byte is 255               */
+
+    for (i = 0; i < g->report_count; i++)
+    {
+        usage = element_usage(p, i);
+
+        /* elements of the same usage are one field, so are all elements of an array */
+        if ((f != NULL) && ((f->usage == usage) || !(data & HID_FIELD_VARIABLE)))
+        {
+            f->count++;
+            continue;
+        }
+
+        if (map->num_field >= map->max_field)
+            return HID_RET_OUT_OF_MEMORY;
+        f = &map->field[map->num_field++];
+        f->usage = usage;
+        f->logical_min = lmin;
+        f->logical_max = lmax;
+        f->mask = (g->report_size == 32) ? 0xFFFFFFFF : ((1UL << g->report_size) - 1);
+        f->bit_offset = bit_offset + i * g->report_size;
+        f->count = 1;
+        f->bit_size = g->report_size;
+        f->sign_shift = (lmin < 0) ? (32 - g->report_size) : 0;
+        f->report_id = g->report_id;
+        f->report_type = type;
+        f->flags = data & 0xFF;
+    }
+    return 0;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup LIBRARY Library
+  @{
+*/
+
+/** @addtogroup USBH_Library USB Host Library
+  @{
+*/
+
+/** @addtogroup USBH_EXPORTED_FUNCTIONS USB Host Exported Functions
+  @{
+*/
+
+/**
+ *  @brief  Compile a report descriptor into a table of fields. Read the descriptor with
+ *          usbh_hid_get_report_descriptor() and compile it once, then take field values from
+ *          reports with usbh_hid_get_field().
+ *  @param[in]  desc       Report descriptor
+ *  @param[in]  desc_len   Length of the report descriptor
+ *  @param[in,out] map     Report map. The caller sets map->field and map->max_field to the
+ *                         field table before the call.
+ *  @return   Number of fields or error code.
+ *  @retval   HID_RET_INVALID_PARAMETER   Malformed report descriptor
+ *  @retval   HID_RET_OUT_OF_MEMORY       The field table is full.
+ *  @retval   HID_RET_NOT_SUPPORTED       More than CONFIG_HID_MAX_REPORT reports or too many
+ *                                        usages or Push items.
+ *  @retval   Otherwise   Number of fields in map->field.
+ */
+int32_t  usbh_hid_parse_report_map(uint8_t *desc, int desc_len, HID_REPORT_MAP_T *map)
+{
+    HID_PARSER_T  parser;
+    HID_PARSER_T  *p = &parser;
+    uint8_t       *end = desc + desc_len;
+    uint32_t      data;
+    int           size, type, tag, ret;
+
+    if ((desc == NULL) || (map == NULL) || (map->field == NULL))
+        return HID_RET_INVALID_PARAMETER;
+
+    memset(p, 0, sizeof(*p));
+    map->num_field = 0;
+    map->num_report = 0;
+    map->report_id_used = 0;
+
+    while (desc < end)
+    {
+        if (*desc == ITEM_LONG)             /* long items carry no report fields          */
+        {
+            if ((desc + 3 > end) || (desc + 3 + desc[1] > end))
+                return HID_RET_INVALID_PARAMETER;
+            desc += 3 + desc[1];
+            continue;
+        }
+
+        size = desc[0] & 0x3;
+        if (size == 3)
+            size = 4;
+        type = (desc[0] >> 2) & 0x3;
+        tag = desc[0] >> 4;
+        if (desc + 1 + size > end)
+            return HID_RET_INVALID_PARAMETER;
+
+        data = 0;
+        switch (size)
+        {
+        case 4:
+            data = ((uint32_t)desc[4] << 24) | ((uint32_t)desc[3] << 16);
+        case 2:
+            data |= desc[2] << 8;
+        case 1:
+            data |= desc[1];
+        }
+        desc += 1 + size;
+
+        if (type == ITEM_MAIN)
+        {
+            switch (tag)
+            {
+            case MAIN_INPUT:
+                ret = add_main_item(p, map, RT_INPUT, data);
+                break;
+            case MAIN_OUTPUT:
+                ret = add_main_item(p, map, RT_OUTPUT, data);
+                break;
+            case MAIN_FEATURE:
+                ret = add_main_item(p, map, RT_FEATURE, data);
+                break;
+            case MAIN_COLLECTION:
+                p->depth++;
+                ret = 0;
+                break;
+            case MAIN_END_COLLECTION:
+                if (p->depth == 0)
+                    return HID_RET_INVALID_PARAMETER;
+                p->depth--;
+                ret = 0;
+                break;
+            default:
+                ret = 0;
+                break;
+            }
+            if (ret < 0)
+                return ret;
+            p->num_usage = 0;               /* local items end with the main item         */
+            p->usage_min_pending = 0;
+        }
+        else if (type == ITEM_GLOBAL)
+        {
+            switch (tag)
+            {
+            case GLOBAL_USAGE_PAGE:
+                p->global.usage_page = data & 0xFFFF;
+                break;
+            case GLOBAL_LOGICAL_MIN:
+                p->global.logical_min = data;
+                p->global.logical_min_size = size;
+                break;
+            case GLOBAL_LOGICAL_MAX:
+                p->global.logical_max = data;
+                p->global.logical_max_size = size;
+                break;
+            case GLOBAL_REPORT_SIZE:
+                if (data > 0xFF)
+                    return HID_RET_INVALID_PARAMETER;
+                p->global.report_size = data;
+                break;
+            case GLOBAL_REPORT_ID:
+                if ((data == 0) || (data > 0xFF))
+                    return HID_RET_INVALID_PARAMETER;
+                p->global.report_id = data;
+                map->report_id_used = 1;
+                break;
+            case GLOBAL_REPORT_COUNT:
+                if (data > 0xFFFF)
+                    return HID_RET_INVALID_PARAMETER;
+                p->global.report_count = data;
+                break;
+            case GLOBAL_PUSH:
+                if (p->sp >= HID_MAX_PUSH)
+                    return HID_RET_NOT_SUPPORTED;
+                p->stack[p->sp++] = p->global;
+                break;
+            case GLOBAL_POP:
+                if (p->sp == 0)
+                    return HID_RET_INVALID_PARAMETER;
+                p->global = p->stack[--p->sp];
+                break;
+            default:                        /* physical range and units are not used      */
+                break;
+            }
+        }
+        else if (type == ITEM_LOCAL)
+        {
+            if (size < 4)                   /* usage ID only, of the current usage page   */
+                data = HID_USAGE(p->global.usage_page, data & 0xFFFF);
+
+            switch (tag)
+            {
+            case LOCAL_USAGE:
+            case LOCAL_USAGE_MIN:
+                if (p->num_usage >= HID_MAX_USAGE_RANGE)
+                    return HID_RET_NOT_SUPPORTED;
+                p->usage[p->num_usage].min = data;
+                p->usage[p->num_usage].max = data;
+                p->num_usage++;
+                p->usage_min_pending = (tag == LOCAL_USAGE_MIN);
+                break;
+            case LOCAL_USAGE_MAX:
+                if (!p->usage_min_pending || (data < p->usage[p->num_usage - 1].min))
+                    return HID_RET_INVALID_PARAMETER;
+                p->usage[p->num_usage - 1].max = data;
+                p->usage_min_pending = 0;
+                break;
+            default:                        /* designators, strings and delimiters        */
+                break;
+            }
+        }
+    }
+
+    if (p->depth != 0)
+        return HID_RET_INVALID_PARAMETER;
+
+    return map->num_field;
+}
+
+/**
+ *  @brief  Find the field of a usage in a report map.
+ *  @param[in]  map        Report map compiled by usbh_hid_parse_report_map()
+ *  @param[in]  rtp_typ    Report type, \ref RT_INPUT, \ref RT_OUTPUT or \ref RT_FEATURE
+ *  @param[in]  usage      Usage, as HID_USAGE(usage page, usage ID). For arrays, the usage minimum.
+ *  @return   The first field of the usage, or NULL if not found.
+ */
+HID_FIELD_T * usbh_hid_find_field(HID_REPORT_MAP_T *map, int rtp_typ, uint32_t usage)
+{
+    int   i;
+
+    for (i = 0; i < map->num_field; i++)
+    {
+        if ((map->field[i].report_type == rtp_typ) && (map->field[i].usage == usage))
+            return &map->field[i];
+    }
+    return NULL;
+}
+
+/**
+ *  @brief  Get the length of a report.
+ *  @param[in]  map        Report map compiled by usbh_hid_parse_report_map()
+ *  @param[in]  rtp_typ    Report type, \ref RT_INPUT, \ref RT_OUTPUT or \ref RT_FEATURE
+ *  @param[in]  rtp_id     Report ID, 0 if the device has no report IDs.
+ *  @return   Report length in bytes, including the report ID byte, or error code.
+ *  @retval   HID_RET_INVALID_PARAMETER   No such report.
+ */
+int32_t  usbh_hid_report_length(HID_REPORT_MAP_T *map, int rtp_typ, int rtp_id)
+{
+    HID_REPORT_T  *rpt;
+
+    rpt = find_report(map, rtp_typ, rtp_id);
+    if (rpt == NULL)
+        return HID_RET_INVALID_PARAMETER;
+    return (rpt->bits + 7) / 8 + (map->report_id_used ? 1 : 0);
+}
+
+/**
+ *  @brief  Get the value of an element of a field from a report. This takes the same time for
+ *          any field, it can be called from the interrupt-in callback of usbh_hid_start_int_read().
+ *  @param[in]  field      Field of a report map, see usbh_hid_find_field()
+ *  @param[in]  idx        Element of the field, 0 to field->count - 1.
+ *  @param[in]  data       Report, starting with the report ID byte if the device has report IDs.
+ *  @param[in]  data_len   Length of the report
+ *  @param[out] value      Value of the element, sign extended if the logical minimum is negative.
+ *                         For arrays, the index in the usage range of the key or button.
+ *  @return   Success or not.
+ *  @retval   HID_RET_OK                  Success
+ *  @retval   HID_RET_INVALID_PARAMETER   idx is out of range, the report has another report ID
+ *                                        or is too short for the element.
+ */
+int32_t  usbh_hid_get_field(HID_FIELD_T *field, int idx, uint8_t *data, uint32_t data_len, int32_t *value)
+{
+    uint8_t    *p;
+    uint32_t   bit, shift, nbytes, v, hi = 0;
+
+    if ((uint32_t)idx >= field->count)
+        return HID_RET_INVALID_PARAMETER;
+
+    if ((field->report_id != 0) && ((data_len == 0) || (data[0] != field->report_id)))
+        return HID_RET_INVALID_PARAMETER;
+
+    bit = field->bit_offset + idx * field->bit_size;
+    shift = bit & 0x7;
+    nbytes = (shift + field->bit_size + 7) >> 3;
+    if ((bit >> 3) + nbytes > data_len)
+        return HID_RET_INVALID_PARAMETER;
+
+    /* load the 1 to 5 bytes holding the element, little endian */
+    p = data + (bit >> 3);
+    v = 0;
+    switch (nbytes)
+    {
+    case 5:
+        hi = p[4];
+    case 4:
+        v = (uint32_t)p[3] << 24;
+    case 3:
+        v |= (uint32_t)p[2] << 16;
+    case 2:
+        v |= (uint32_t)p[1] << 8;
+    default:
+        v |= p[0];
+    }
+
+    v >>= shift;
+    if (nbytes == 5)                        /* shift is not 0                             */
+        v |= hi << (32 - shift);
+    v &= field->mask;
+
+    if (field->sign_shift)
+        *value = (int32_t)(v << field->sign_shift) >> field->sign_shift;
+    else
+        *value = (int32_t)v;
+    return HID_RET_OK;
+}
+
+/*@}*/ /* end of group USBH_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group USBH_Library */
+
+/*@}*/ /* end of group LIBRARY */
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
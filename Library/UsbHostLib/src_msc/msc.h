@@ -40,6 +40,7 @@
 #define MSC_SPROTO_CBI            0x00   /* Control/Bulk/Interrupt        */
 #define MSC_SPROTO_CB             0x01   /* Control/Bulk w/o interrupt    */
 #define MSC_SPROTO_BULK           0x50   /* Bulk only                     */
+#define MSC_SPROTO_UAS            0x62   /* USB Attached SCSI             */
 #define MSC_SPROTO_DPCM_USB       0xf0   /* Combination CB/SDDR09         */
 
 
@@ -89,6 +90,74 @@ struct bulk_cs_wrap
 
 #define SCSI_BUFF_LEN             36
 
+/*
+ *  Bulk-only transport of a mass storage interface, shared by the MSC_T instances of its LUNs.
+ *  Commands are queued and run one at a time. The CBW, data and CSW UTRs of a command are all
+ *  submitted when it starts, and the next command is started from the interrupt that completes
+ *  the CSW of the previous one.
+ */
+#define MSC_XP_IDLE               0      /* no command on the bus                         */
+#define MSC_XP_BUSY               1      /* the command at the queue head is running      */
+#define MSC_XP_ERROR              2      /* it failed, waiting for msc_xport_poll()       */
+#define MSC_XP_RECOVER            3      /* msc_xport_poll() is recovering the transport  */
+
+typedef struct msc_xport_t
+{
+    UTR_T       *utr_cbw;                /* bulk-out UTR of the command block wrapper     */
+    UTR_T       *utr_data;               /* UTR of the data phase                         */
+    UTR_T       *utr_csw;                /* bulk-in UTR of the command status wrapper     */
+    uint32_t    csw[4];                  /* command status wrapper, word aligned          */
+    UMAS_REQ_T  *req_head;               /* running request, then the queued ones         */
+    UMAS_REQ_T  *req_tail;
+    volatile uint8_t  state;             /* MSC_XP_xxx                                    */
+    uint8_t     utr_pending;             /* UTRs of the running command not done yet      */
+    uint8_t     bDetached;               /* interface disconnected, fail all requests     */
+    UTR_T       *err_utr;                /* UTR that failed                               */
+    int         err;                     /* its status                                    */
+    uint32_t    t0;                      /* get_ticks() at the start of the command       */
+    uint32_t    tag;                     /* tag of the next CBW                           */
+}  MSC_XPORT_T;
+
+/*
+ *  USB Attached SCSI transport, without streams (USB 2.0). A command IU is sent on the command
+ *  pipe for each queued request while a tag is free. The device picks the command to run and
+ *  asks for its data with a READ READY or WRITE READY IU on the status pipe, then reports its
+ *  status with a SENSE IU. The state is one of MSC_XP_xxx.
+ */
+#define UAS_STAT_IU_LEN           64     /* SENSE IU with up to 48 bytes of sense data    */
+
+typedef struct
+{
+    UMAS_REQ_T  *req;                    /* request of this tag, NULL if the tag is free  */
+    uint32_t    t0;                      /* get_ticks() when the command IU was sent      */
+    int         status;                  /* from its SENSE or RESPONSE IU                 */
+    uint8_t     bStatusIn;               /* SENSE or RESPONSE IU received                 */
+}  UAS_TAG_T;
+
+typedef struct uas_xport_t
+{
+    EP_INFO_T   *ep_cmd;                 /* command pipe, bulk-out                        */
+    EP_INFO_T   *ep_stat;                /* status pipe, bulk-in                          */
+    EP_INFO_T   *ep_data_in;             /* data-in pipe                                  */
+    EP_INFO_T   *ep_data_out;            /* data-out pipe                                 */
+    UTR_T       *utr_cmd;                /* UTR of the command IU being sent              */
+    UTR_T       *utr_stat;               /* UTR reading the status pipe                   */
+    UTR_T       *utr_data;               /* UTR of the data transfer                      */
+    uint32_t    cmd_iu[8];               /* command IU, word aligned                      */
+    uint32_t    stat_iu[UAS_STAT_IU_LEN/4];  /* IU read from the status pipe              */
+    UAS_TAG_T   tag[UMAS_UAS_QDEPTH];    /* commands sent, tag n is tag[n-1]              */
+    UMAS_REQ_T  *req_head;               /* requests not sent yet                         */
+    UMAS_REQ_T  *req_tail;
+    volatile uint8_t  state;             /* MSC_XP_xxx                                    */
+    uint8_t     bDetached;               /* interface disconnected, fail all requests     */
+    uint8_t     qdepth;                  /* tags in use at most, lowered on TASK SET FULL */
+    uint8_t     active;                  /* tags in use                                   */
+    uint8_t     data_tag;                /* tag of the data transfer, 0 if none           */
+    uint8_t     ready_tag;               /* tag of a READY IU waiting for the data UTR    */
+    uint8_t     err_tag;                 /* tag of the failed command, 0 if not known     */
+    int         err;                     /* its status                                    */
+}  UAS_XPORT_T;
+
 typedef struct msc_t
 {
     IFACE_T     *iface;
@@ -99,18 +168,38 @@ typedef struct msc_t
     uint8_t     lun;                     /* MSC lun of this instance                      */
     uint8_t     root;                    /* root instance?                                */
     struct bulk_cb_wrap  cmd_blk;        /* MSC Bulk-only command block                   */
-    struct bulk_cs_wrap  cmd_status;     /* MSC Bulk-only command status                  */
     uint8_t     scsi_buff[SCSI_BUFF_LEN];/* buffer for SCSI commands                      */
     uint32_t    uTotalSectorN;
     uint32_t    nSectorSize;
     uint32_t    uDiskSize;
+    MSC_XPORT_T *xport;                  /* bulk-only transport, shared by all LUNs       */
+    UAS_XPORT_T *uas;                    /* UAS transport instead of xport, or NULL       */
     int         drv_no;                  /* Logical drive number associated with this instance */
     FATFS       fatfs_vol;               /* FATFS volumn                                  */
     struct msc_t  *next;                 /* point to next MSC device                      */
 }  MSC_T;
 
 
+extern void msc_reset(MSC_T *msc);
+extern int  msc_bulk_transfer(MSC_T *msc, EP_INFO_T *ep, uint8_t *data_buff, int data_len, int timeout_ticks);
 extern int  run_scsi_command(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataIn, int timeout_ticks);
+extern int  umas_dev_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+extern int  umas_dev_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+extern int  umas_cache_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+extern int  umas_cache_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+extern int  umas_cache_flush(int drv_no);
+extern void umas_cache_invalidate(int drv_no);
+extern MSC_XPORT_T * msc_xport_alloc(UDEV_T *udev);
+extern void msc_xport_free(MSC_XPORT_T *xp);
+extern void msc_xport_detach(MSC_XPORT_T *xp);
+extern void msc_xport_submit(MSC_T *msc, UMAS_REQ_T *req);
+extern void msc_xport_poll(MSC_XPORT_T *xp);
+extern int  msc_xport_wait(MSC_T *msc, UMAS_REQ_T *req);
+extern UAS_XPORT_T * uas_xport_alloc(UDEV_T *udev, ALT_IFACE_T *aif);
+extern void uas_xport_free(UAS_XPORT_T *xp);
+extern void uas_xport_detach(UAS_XPORT_T *xp);
+extern void uas_xport_submit(MSC_T *msc, UMAS_REQ_T *req);
+extern void uas_xport_poll(UAS_XPORT_T *xp);
 
 
 /// @endcond
@@ -0,0 +1,463 @@
+/**************************************************************************//**
+ * @file     msc_cache.c
+ * @version  V1.00
+ * @brief    Sector cache of the USB mass storage driver
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "diskio.h"                // FATFS header
+#include "usb.h"
+#include "msc.h"
+
+
+/// @cond HIDDEN_SYMBOLS
+
+static UMAS_CACHE_STAT_T  _cache_stat;
+
+static int  dev_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    _cache_stat.read_cmds++;
+    return umas_dev_read(drv_no, sec_no, sec_cnt, buff);
+}
+
+static int  dev_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    _cache_stat.write_cmds++;
+    return umas_dev_write(drv_no, sec_no, sec_cnt, buff);
+}
+
+#if (UMAS_CACHE_LINES > 0)
+
+/*
+ *  A line holds UMAS_CACHE_LINE_SECT sectors from a sector number that is a multiple of
+ *  UMAS_CACHE_LINE_SECT. Bit n of <valid> and <dirty> is for sector sec_no + n.
+ */
+#define LINE_SECT           UMAS_CACHE_LINE_SECT
+#define LINE_BASE(s)        ((s) - ((s) % LINE_SECT))
+
+#define LINE_FREE           0
+#define LINE_READY          1
+#define LINE_FILLING        2               /* read-ahead in progress                     */
+
+typedef struct
+{
+    uint32_t    sec_no;                     /* first sector of the line                   */
+    int         drv_no;                     /* FATFS drive number                         */
+    volatile uint8_t  state;                /* LINE_xxx                                   */
+    uint8_t     bPrefetch;                  /* filled by read-ahead                       */
+    volatile uint32_t valid;                /* sectors in the buffer                      */
+    uint32_t    dirty;                      /* sectors to be written to the disk          */
+    uint32_t    lru;                        /* _lru_clock of the last access              */
+    uint8_t     *buff;
+    UMAS_REQ_T  req;                        /* read-ahead request                         */
+} CACHE_LINE_T;
+
+#ifdef __ICCARM__
+#pragma data_alignment=32
+static uint8_t  _line_buff[UMAS_CACHE_LINES][LINE_SECT * 512];
+#else
+static uint8_t  _line_buff[UMAS_CACHE_LINES][LINE_SECT * 512] __attribute__((aligned(32)));
+#endif
+
+static CACHE_LINE_T  _line[UMAS_CACHE_LINES];
+static uint32_t      _lru_clock;
+static int           _seq_drv = -1;         /* drive and sector following the last read   */
+static uint32_t      _seq_next;
+
+
+static uint32_t  disk_sectors(int drv_no)
+{
+    uint32_t   sec_cnt;
+
+    if (usbh_umas_ioctl(drv_no, GET_SECTOR_COUNT, &sec_cnt) != RES_OK)
+        return 0;
+    return sec_cnt;
+}
+
+static CACHE_LINE_T * find_line(int drv_no, uint32_t base)
+{
+    int   i;
+
+    for (i = 0; i < UMAS_CACHE_LINES; i++)
+    {
+        if ((_line[i].state != LINE_FREE) && (_line[i].drv_no == drv_no) && (_line[i].sec_no == base))
+            return &_line[i];
+    }
+    return NULL;
+}
+
+static void wait_line(CACHE_LINE_T *line)
+{
+    while (line->state == LINE_FILLING)
+        usbh_umas_poll();
+}
+
+/*
+ *  Write the dirty sectors of <line>, one WRITE(10) for each run of adjacent ones.
+ */
+static int  flush_line(CACHE_LINE_T *line)
+{
+    int   i, n, ret;
+
+    wait_line(line);
+    i = 0;
+    while (line->dirty != 0)
+    {
+        while (!(line->dirty & (1UL << i)))
+            i++;
+        for (n = 1; (i + n < LINE_SECT) && (line->dirty & (1UL << (i + n))); n++)
+            ;
+        ret = dev_write(line->drv_no, line->sec_no + i, n, line->buff + i * 512);
+        if (ret < 0)
+            return ret;
+        line->dirty &= ~(((n >= 32) ? 0xFFFFFFFFUL : ((1UL << n) - 1)) << i);
+        i += n;
+    }
+    return 0;
+}
+
+/*
+ *  Get a line for sectors <base>... of <drv_no>: a free one, else the least recently used one.
+ *  A dirty line is written back first. With <bNoFlush> set, for read-ahead, neither a dirty line
+ *  nor the line accessed last is taken.
+ */
+static CACHE_LINE_T * alloc_line(int drv_no, uint32_t base, int bNoFlush)
+{
+    CACHE_LINE_T  *line = NULL;
+    int     i;
+
+    for (i = 0; i < UMAS_CACHE_LINES; i++)
+    {
+        if (_line[i].state == LINE_FREE)
+        {
+            line = &_line[i];
+            break;
+        }
+        if ((_line[i].state == LINE_FILLING) ||
+                (bNoFlush && (_line[i].dirty || (_line[i].lru == _lru_clock))))
+            continue;
+        if ((line == NULL) || ((int32_t)(_line[i].lru - line->lru) < 0))
+            line = &_line[i];
+    }
+    if (line == NULL)
+        return NULL;
+
+    if ((line->state != LINE_FREE) && (flush_line(line) < 0))
+        return NULL;
+
+    line->drv_no = drv_no;
+    line->sec_no = base;
+    line->valid = 0;
+    line->dirty = 0;
+    line->bPrefetch = 0;
+    line->lru = ++_lru_clock;
+    line->buff = _line_buff[line - _line];
+    line->state = LINE_READY;
+    return line;
+}
+
+static void free_line(CACHE_LINE_T *line)
+{
+    line->state = LINE_FREE;
+    line->valid = 0;
+    line->dirty = 0;
+}
+
+/*
+ *  Read the sectors of <line> that are not in it yet. Dirty sectors are written first, so that
+ *  the whole line can be read with one READ(10).
+ */
+static int  fill_line(CACHE_LINE_T *line)
+{
+    uint32_t  total;
+    int       n, ret;
+
+    ret = flush_line(line);
+    if (ret < 0)
+        return ret;
+
+    n = LINE_SECT;
+    total = disk_sectors(line->drv_no);
+    if (line->sec_no + n > total)
+        n = (total > line->sec_no) ? (total - line->sec_no) : 0;
+
+    ret = dev_read(line->drv_no, line->sec_no, n, line->buff);
+    if (ret < 0)
+    {
+        free_line(line);
+        return ret;
+    }
+    line->valid = (n >= 32) ? 0xFFFFFFFFUL : ((1UL << n) - 1);
+    line->bPrefetch = 0;
+    return 0;
+}
+
+/* Read-ahead request done. Called in USB Host interrupt context. */
+static void read_ahead_done(UMAS_REQ_T *req)
+{
+    CACHE_LINE_T  *line = (CACHE_LINE_T *)req->context;
+
+    if (req->status == 0)
+    {
+        line->valid = (req->sec_cnt >= 32) ? 0xFFFFFFFFUL : ((1UL << req->sec_cnt) - 1);
+        line->state = LINE_READY;
+    }
+    else
+    {
+        free_line(line);
+    }
+}
+
+/*
+ *  Start reading line <base> of <drv_no> in the background, unless it is cached already or
+ *  only a dirty line could make room for it.
+ */
+static void read_ahead(int drv_no, uint32_t base)
+{
+    CACHE_LINE_T  *line;
+    uint32_t  total;
+    int       n;
+
+    total = disk_sectors(drv_no);
+    if ((base >= total) || (find_line(drv_no, base) != NULL))
+        return;
+
+    line = alloc_line(drv_no, base, 1);
+    if (line == NULL)
+        return;
+
+    n = (base + LINE_SECT > total) ? (total - base) : LINE_SECT;
+    line->bPrefetch = 1;
+    line->state = LINE_FILLING;
+    if (usbh_umas_read_async(drv_no, base, n, line->buff, &line->req, read_ahead_done, line) < 0)
+    {
+        free_line(line);
+        return;
+    }
+    _cache_stat.read_cmds++;
+    _cache_stat.ra_cmds++;
+}
+
+int  umas_cache_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    CACHE_LINE_T  *line;
+    uint32_t  sec, bit;
+    int       i, ret, bIsSeq;
+
+    bIsSeq = ((drv_no == _seq_drv) && (sec_no == _seq_next));
+    _seq_drv = drv_no;
+    _seq_next = sec_no + sec_cnt;
+    _cache_stat.read_sect += sec_cnt;
+
+    if (sec_cnt >= LINE_SECT)
+    {
+        /* large read: from the disk, then the sectors not written back yet over it          */
+        ret = dev_read(drv_no, sec_no, sec_cnt, buff);
+        if (ret < 0)
+            return ret;
+        for (i = 0; i < UMAS_CACHE_LINES; i++)
+        {
+            line = &_line[i];
+            if ((line->state != LINE_READY) || (line->drv_no != drv_no) || (line->dirty == 0))
+                continue;
+            for (sec = line->sec_no, bit = 1; sec < line->sec_no + LINE_SECT; sec++, bit <<= 1)
+            {
+                if ((line->dirty & bit) && (sec >= sec_no) && (sec < sec_no + sec_cnt))
+                    memcpy(buff + (sec - sec_no) * 512, line->buff + (sec - line->sec_no) * 512, 512);
+            }
+        }
+        return 0;
+    }
+
+    for (sec = sec_no; sec < sec_no + sec_cnt; sec++, buff += 512)
+    {
+        line = find_line(drv_no, LINE_BASE(sec));
+        if (line != NULL)
+            wait_line(line);
+        if ((line == NULL) || (line->state == LINE_FREE))
+            line = alloc_line(drv_no, LINE_BASE(sec), 0);
+        if (line == NULL)
+        {
+            ret = dev_read(drv_no, sec, 1, buff);   /* no line can be evicted               */
+            if (ret < 0)
+                return ret;
+            continue;
+        }
+
+        bit = 1UL << (sec - line->sec_no);
+        if (line->valid & bit)
+        {
+            _cache_stat.read_hit++;
+            if (line->bPrefetch)
+                _cache_stat.ra_hit++;
+        }
+        else
+        {
+            ret = fill_line(line);
+            if (ret < 0)
+                return ret;
+            if (!(line->valid & bit))
+                return UMAS_ERR_IVALID_PARM;    /* beyond the end of the disk                 */
+        }
+        memcpy(buff, line->buff + (sec - line->sec_no) * 512, 512);
+        line->lru = ++_lru_clock;
+    }
+
+    if (bIsSeq && UMAS_CACHE_READ_AHEAD)
+        read_ahead(drv_no, LINE_BASE(sec_no + sec_cnt - 1) + LINE_SECT);
+    return 0;
+}
+
+int  umas_cache_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    CACHE_LINE_T  *line;
+    uint32_t  sec, bit;
+    int       i, ret;
+
+    _cache_stat.write_sect += sec_cnt;
+
+    if (sec_cnt >= LINE_SECT)
+    {
+        /* large write: to the disk, and update the cached copies of the sectors             */
+        ret = dev_write(drv_no, sec_no, sec_cnt, buff);
+        if (ret < 0)
+            return ret;
+        for (i = 0; i < UMAS_CACHE_LINES; i++)
+        {
+            line = &_line[i];
+            if ((line->state == LINE_FREE) || (line->drv_no != drv_no) ||
+                    (line->sec_no + LINE_SECT <= sec_no) || (line->sec_no >= sec_no + sec_cnt))
+                continue;
+            wait_line(line);
+            if (line->state == LINE_FREE)
+                continue;                       /* its read-ahead failed                      */
+            for (sec = line->sec_no, bit = 1; sec < line->sec_no + LINE_SECT; sec++, bit <<= 1)
+            {
+                if ((sec >= sec_no) && (sec < sec_no + sec_cnt))
+                {
+                    memcpy(line->buff + (sec - line->sec_no) * 512, buff + (sec - sec_no) * 512, 512);
+                    line->valid |= bit;
+                    line->dirty &= ~bit;
+                }
+            }
+        }
+        return 0;
+    }
+
+    for (sec = sec_no; sec < sec_no + sec_cnt; sec++, buff += 512)
+    {
+        line = find_line(drv_no, LINE_BASE(sec));
+        if (line != NULL)
+            wait_line(line);
+        if ((line == NULL) || (line->state == LINE_FREE))
+            line = alloc_line(drv_no, LINE_BASE(sec), 0);
+        if (line == NULL)
+        {
+            ret = dev_write(drv_no, sec, 1, buff);  /* no line can be evicted               */
+            if (ret < 0)
+                return ret;
+            continue;
+        }
+
+        bit = 1UL << (sec - line->sec_no);
+        memcpy(line->buff + (sec - line->sec_no) * 512, buff, 512);
+        line->valid |= bit;
+        line->dirty |= bit;
+        line->lru = ++_lru_clock;
+    }
+    return 0;
+}
+
+/*
+ *  Write all dirty lines of <drv_no>, or of all drives if <drv_no> is negative, in ascending
+ *  sector order.
+ */
+int  umas_cache_flush(int drv_no)
+{
+    CACHE_LINE_T  *line;
+    int   i, ret;
+
+    for ( ; ; )
+    {
+        line = NULL;
+        for (i = 0; i < UMAS_CACHE_LINES; i++)
+        {
+            if ((_line[i].state == LINE_FREE) || (_line[i].dirty == 0) ||
+                    ((drv_no >= 0) && (_line[i].drv_no != drv_no)))
+                continue;
+            if ((line == NULL) || (_line[i].sec_no < line->sec_no))
+                line = &_line[i];
+        }
+        if (line == NULL)
+            return 0;
+
+        ret = flush_line(line);
+        if (ret < 0)
+            return ret;
+    }
+}
+
+/*
+ *  Drop the lines of a drive that is gone. Its read-ahead requests have been failed.
+ */
+void umas_cache_invalidate(int drv_no)
+{
+    int   i;
+
+    for (i = 0; i < UMAS_CACHE_LINES; i++)
+    {
+        if (_line[i].drv_no == drv_no)
+            free_line(&_line[i]);
+    }
+    if (_seq_drv == drv_no)
+        _seq_drv = -1;
+}
+
+#else   /* UMAS_CACHE_LINES == 0 */
+
+int  umas_cache_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    _cache_stat.read_sect += sec_cnt;
+    return dev_read(drv_no, sec_no, sec_cnt, buff);
+}
+
+int  umas_cache_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    _cache_stat.write_sect += sec_cnt;
+    return dev_write(drv_no, sec_no, sec_cnt, buff);
+}
+
+int  umas_cache_flush(int drv_no)
+{
+    return 0;
+}
+
+void umas_cache_invalidate(int drv_no)
+{
+}
+
+#endif  /* UMAS_CACHE_LINES */
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+  * @brief       Get the sector cache statistics of usbh_umas_read() and usbh_umas_write().
+  *
+  * @param[out]  stat    Sectors read and written, cache hits and commands issued since
+  *                      usbh_umas_init().
+  * @return      None
+  */
+void usbh_umas_cache_stat(UMAS_CACHE_STAT_T *stat)
+{
+    *stat = _cache_stat;
+}
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
+
@@ -138,6 +138,9 @@ void msc_reset(MSC_T *msc)
     uint32_t  read_len;
     int       ret;
 
+    if (msc->uas != NULL)
+        return;                             /* UAS recovers in uas_xport_poll()           */
+
     msc_debug_msg("Reset MSC device...\n");
 
     ret = usbh_ctrl_xfer(udev, REQ_TYPE_OUT | REQ_TYPE_CLASS_DEV | REQ_TYPE_TO_IFACE,
@@ -238,38 +241,20 @@ static int  msc_test_unit_ready(MSC_T *msc)
     return ret;
 }
 
-/**
-  * @brief       Read a number of contiguous sectors from mass storage device.
-  *
-  * @param[in]   drv_no    FATFS drive volume number.
-  * @param[in]   sec_no    Sector number of the start sector.
-  * @param[in]   sec_cnt   Number of sectors to be read.
-  * @param[out]  buff      Memory buffer to store data read from disk.
-  *
-  * @retval      0       Success
-  * @retval      - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
-  * @retval      - \ref UMAS_ERR_IO      Failed to read disk.
-  */
-int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+/*
+ *  Prepare <req> as a READ(10) or WRITE(10) command of <sec_cnt> sectors from <sec_no>.
+ */
+static void umas_rw_req(MSC_T *msc, UMAS_REQ_T *req, uint8_t op, uint32_t sec_no, int sec_cnt, uint8_t *buff)
 {
-    MSC_T   *msc;
-    struct bulk_cb_wrap  *cmd_blk;         /* MSC Bulk-only command block   */
-    int   ret;
-
-    //msc_debug_msg("usbh_umas_read - %d, %d\n", sec_no, sec_cnt);
-
-    msc = find_msc_by_drive(drv_no);
-    if (msc == NULL)
-        return UMAS_ERR_DRIVE_NOT_FOUND;
-
-    cmd_blk = &msc->cmd_blk;
+    struct bulk_cb_wrap  *cmd_blk = (struct bulk_cb_wrap *)req->cbw;   /* MSC Bulk-only command block */
 
-    //msc_debug_msg("read sector 0x%x\n", sector_no);
     memset(cmd_blk, 0, sizeof(*cmd_blk));
 
-    cmd_blk->Flags   = 0x80;
+    cmd_blk->Flags   = (op == READ_10) ? 0x80 : 0;
     cmd_blk->Length  = 10;
-    cmd_blk->CDB[0]  = READ_10;
+    cmd_blk->DataTransferLength = sec_cnt * 512;
+    cmd_blk->Lun     = msc->lun;
+    cmd_blk->CDB[0]  = op;
     cmd_blk->CDB[1]  = msc->lun << 5;
     cmd_blk->CDB[2]  = (sec_no >> 24) & 0xFF;
     cmd_blk->CDB[3]  = (sec_no >> 16) & 0xFF;
@@ -278,7 +263,35 @@ int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
     cmd_blk->CDB[7]  = (sec_cnt >> 8) & 0xFF;
     cmd_blk->CDB[8]  = sec_cnt & 0xFF;
 
-    ret = run_scsi_command(msc, buff, sec_cnt * 512, 1, 500);
+    req->drv_no = msc->drv_no;
+    req->sec_no = sec_no;
+    req->sec_cnt = sec_cnt;
+    req->buff = buff;
+    req->bIsDataIn = (op == READ_10) ? 1 : 0;
+    req->timeout = 1500;                    /* 500 ticks for each of CBW, data and CSW    */
+}
+
+/*
+ *  READ(10) and WRITE(10) to the device, waiting for the command to complete.
+ *  Used by the sector cache of msc_cache.c.
+ */
+int  umas_dev_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    MSC_T       *msc;
+    UMAS_REQ_T  req;
+    int         ret;
+
+    //msc_debug_msg("umas_dev_read - %d, %d\n", sec_no, sec_cnt);
+
+    msc = find_msc_by_drive(drv_no);
+    if (msc == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    umas_rw_req(msc, &req, READ_10, sec_no, sec_cnt, buff);
+    req.func = NULL;
+
+    msc_xport_submit(msc, &req);
+    ret = msc_xport_wait(msc, &req);
     if (ret != 0)
     {
         msc_debug_msg("usbh_umas_read failed! [%d]\n", ret);
@@ -287,6 +300,51 @@ int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
     return 0;
 }
 
+int  umas_dev_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    MSC_T       *msc;
+    UMAS_REQ_T  req;
+    int         ret;
+
+    //msc_debug_msg("umas_dev_write - %d, %d\n", sec_no, sec_cnt);
+
+    msc = find_msc_by_drive(drv_no);
+    if (msc == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    umas_rw_req(msc, &req, WRITE_10, sec_no, sec_cnt, buff);
+    req.func = NULL;
+
+    msc_xport_submit(msc, &req);
+    ret = msc_xport_wait(msc, &req);
+    if (ret < 0)
+    {
+        msc_debug_msg("usbh_umas_write failed!\n");
+        return UMAS_ERR_IO;
+    }
+    return 0;
+}
+
+/**
+  * @brief       Read a number of contiguous sectors from mass storage device.
+  *
+  * @param[in]   drv_no    FATFS drive volume number.
+  * @param[in]   sec_no    Sector number of the start sector.
+  * @param[in]   sec_cnt   Number of sectors to be read.
+  * @param[out]  buff      Memory buffer to store data read from disk.
+  *
+  * @retval      0       Success
+  * @retval      - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
+  * @retval      - \ref UMAS_ERR_IO      Failed to read disk.
+  */
+int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    if (find_msc_by_drive(drv_no) == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    return umas_cache_read(drv_no, sec_no, sec_cnt, buff);
+}
+
 /**
   * @brief       Write a number of contiguous sectors to mass storage device.
   *
@@ -300,38 +358,97 @@ int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
   * @retval      - \ref UMAS_ERR_IO      Failed to write disk.
   */
 int  usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    if (find_msc_by_drive(drv_no) == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    return umas_cache_write(drv_no, sec_no, sec_cnt, buff);
+}
+
+/**
+  * @brief       Queue a read of a number of contiguous sectors from mass storage device.
+  *              Commands to a device run one after the other in the order they were queued,
+  *              the next one is started as soon as the previous one completes.
+  *
+  * @param[in]   drv_no    FATFS drive volume number.
+  * @param[in]   sec_no    Sector number of the start sector.
+  * @param[in]   sec_cnt   Number of sectors to be read.
+  * @param[out]  buff      Memory buffer to store data read from disk.
+  * @param[in]   req       Request, must be kept until it is done.
+  * @param[in]   func      Called when the request is done, with req->status 0 on success.
+  *                        Called from interrupt context, or from usbh_umas_poll() if the
+  *                        command failed. May be NULL, then poll req->bIsDone.
+  * @param[in]   context   Copied to req->context.
+  *
+  * @retval      0       Request queued
+  * @retval      - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
+  * @note        usbh_umas_poll() must be called while requests are queued, to time out and
+  *              recover failed commands.
+  */
+int  usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff,
+                          UMAS_REQ_T *req, UMAS_DONE_FUNC *func, void *context)
 {
     MSC_T   *msc;
-    struct bulk_cb_wrap  *cmd_blk;         /* MSC Bulk-only command block   */
-    int   ret;
 
-    //msc_debug_msg("usbh_umas_write - %d, %d\n", sec_no, sec_cnt);
+    msc = find_msc_by_drive(drv_no);
+    if (msc == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    umas_rw_req(msc, req, READ_10, sec_no, sec_cnt, buff);
+    req->func = func;
+    req->context = context;
+    msc_xport_submit(msc, req);
+    return 0;
+}
+
+/**
+  * @brief       Queue a write of a number of contiguous sectors to mass storage device.
+  *              See usbh_umas_read_async().
+  *
+  * @param[in]   drv_no    FATFS drive volume number.
+  * @param[in]   sec_no    Sector number of the start sector.
+  * @param[in]   sec_cnt   Number of sectors to be written.
+  * @param[in]   buff      Memory buffer hold the data to be written.
+  * @param[in]   req       Request, must be kept until it is done.
+  * @param[in]   func      Called when the request is done, with req->status 0 on success.
+  * @param[in]   context   Copied to req->context.
+  *
+  * @retval      0       Request queued
+  * @retval      - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
+  */
+int  usbh_umas_write_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff,
+                           UMAS_REQ_T *req, UMAS_DONE_FUNC *func, void *context)
+{
+    MSC_T   *msc;
 
     msc = find_msc_by_drive(drv_no);
     if (msc == NULL)
         return UMAS_ERR_DRIVE_NOT_FOUND;
 
-    cmd_blk = &msc->cmd_blk;
-    memset((uint8_t *)&(msc->cmd_blk), 0, sizeof(msc->cmd_blk));
+    umas_rw_req(msc, req, WRITE_10, sec_no, sec_cnt, buff);
+    req->func = func;
+    req->context = context;
+    msc_xport_submit(msc, req);
+    return 0;
+}
 
-    cmd_blk->Flags   = 0;
-    cmd_blk->Length  = 10;
-    cmd_blk->CDB[0]  = WRITE_10;
-    cmd_blk->CDB[1]  = msc->lun << 5;
-    cmd_blk->CDB[2]  = (sec_no >> 24) & 0xFF;
-    cmd_blk->CDB[3]  = (sec_no >> 16) & 0xFF;
-    cmd_blk->CDB[4]  = (sec_no >> 8) & 0xFF;
-    cmd_blk->CDB[5]  = sec_no & 0xFF;
-    cmd_blk->CDB[7]  = (sec_cnt >> 8) & 0xFF;
-    cmd_blk->CDB[8]  = sec_cnt & 0xFF;
+/**
+  * @brief       Time out and recover failed mass storage commands. Call it from the main
+  *              loop while requests of usbh_umas_read_async() or usbh_umas_write_async()
+  *              are queued. Not needed by the blocking functions.
+  * @return      None
+  */
+void usbh_umas_poll(void)
+{
+    MSC_T  *msc;
 
-    ret = run_scsi_command(msc, buff, sec_cnt * 512, 0, 500);
-    if (ret < 0)
+    for (msc = g_msc_list; msc != NULL; msc = msc->next)
     {
-        msc_debug_msg("usbh_umas_write failed!\n");
-        return UMAS_ERR_IO;
+        if (msc->uas != NULL)
+            uas_xport_poll(msc->uas);
+        else
+            msc_xport_poll(msc->xport);
     }
-    return 0;
 }
 
 /**
@@ -356,6 +473,8 @@ int  usbh_umas_ioctl(int drv_no, int cmd, void *buff)
     switch (cmd)
     {
     case CTRL_SYNC:
+        if (umas_cache_flush(drv_no) < 0)
+            return RES_ERROR;
         return RES_OK;
 
     case GET_SECTOR_COUNT:
@@ -526,7 +645,7 @@ static int msc_probe(IFACE_T *iface)
     ALT_IFACE_T   *aif = iface->aif;
     DESC_IF_T     *ifd;
     MSC_T         *msc;
-    int           i;
+    int           i, ret;
 
     ifd = aif->ifd;
 
@@ -571,17 +690,118 @@ static int msc_probe(IFACE_T *iface)
 
     msc->iface = iface;
 
+    msc->xport = msc_xport_alloc(iface->udev);
+    if (msc->xport == NULL)
+    {
+        usbh_free_mem(msc, sizeof(*msc));
+        return USBH_ERR_MEMORY_OUT;
+    }
+
     msc_debug_msg("USB Mass Storage device found. Iface:%d, Alt Iface:%d, bep_in:0x%x, bep_out:0x%x\n", ifd->bInterfaceNumber, ifd->bAlternateSetting, msc->ep_bulk_in->bEndpointAddress, msc->ep_bulk_out->bEndpointAddress);
 
     get_max_lun(msc);
 
-    return umass_init_device(msc);
+    ret = umass_init_device(msc);
+    if (ret < 0)
+    {
+        /* no LUN was added to g_msc_list */
+        msc_xport_detach(msc->xport);
+        for (i = 0; i < aif->ifd->bNumEndpoints; i++)
+            iface->udev->hc_driver->quit_xfer(NULL, &(aif->ep[i]));
+        msc_xport_free(msc->xport);
+        usbh_free_mem(msc, sizeof(*msc));
+    }
+    return ret;
 }
 
+#if UMAS_USE_UAS
+/*
+ *  Probe the UAS alternate setting of a mass storage interface. If it has none, or the disk
+ *  cannot be initialized with it, the interface is left at its first alternate setting for
+ *  msc_probe().
+ */
+static int uas_probe(IFACE_T *iface)
+{
+    ALT_IFACE_T   *aif = NULL;
+    DESC_IF_T     *ifd;
+    UAS_XPORT_T   *uas;
+    MSC_T         *msc;
+    int           i, ret;
+
+    for (i = 0; i < iface->num_alt; i++)
+    {
+        ifd = iface->alt[i].ifd;
+        if ((ifd->bInterfaceClass == USB_CLASS_MASS_STORAGE) && (ifd->bInterfaceSubClass == MSC_SCLASS_SCSI) &&
+                (ifd->bInterfaceProtocol == MSC_SPROTO_UAS))
+        {
+            aif = &iface->alt[i];
+            break;
+        }
+    }
+    if (aif == NULL)
+        return USBH_ERR_NOT_MATCHED;
+
+    uas = uas_xport_alloc(iface->udev, aif);
+    if (uas == NULL)
+        return USBH_ERR_NOT_SUPPORTED;
+
+    msc = usbh_alloc_mem(sizeof(*msc));
+    if (msc == NULL)
+    {
+        uas_xport_free(uas);
+        return USBH_ERR_MEMORY_OUT;
+    }
+    msc->uid = get_ticks();
+    msc->iface = iface;
+    msc->ep_bulk_in = uas->ep_data_in;
+    msc->ep_bulk_out = uas->ep_data_out;
+    msc->uas = uas;
+    msc->max_lun = 0;                       /* no GET MAX LUN request in UAS              */
+
+    ret = usbh_set_interface(iface, aif->ifd->bAlternateSetting);
+    if (ret == 0)
+    {
+        msc_debug_msg("UAS device found. Iface:%d, Alt Iface:%d, cmd:0x%x, stat:0x%x, in:0x%x, out:0x%x\n",
+                      aif->ifd->bInterfaceNumber, aif->ifd->bAlternateSetting, uas->ep_cmd->bEndpointAddress,
+                      uas->ep_stat->bEndpointAddress, uas->ep_data_in->bEndpointAddress, uas->ep_data_out->bEndpointAddress);
+        ret = umass_init_device(msc);
+        if (ret < 0)
+            usbh_set_interface(iface, iface->alt[0].ifd->bAlternateSetting);   /* back to bulk-only */
+    }
+
+    if (ret < 0)
+    {
+        /* no LUN was added to g_msc_list */
+        uas_xport_detach(uas);
+        for (i = 0; i < aif->ifd->bNumEndpoints; i++)
+            iface->udev->hc_driver->quit_xfer(NULL, &(aif->ep[i]));
+        uas_xport_free(uas);
+        usbh_free_mem(msc, sizeof(*msc));
+    }
+    return ret;
+}
+#endif
+
 static void msc_disconnect(IFACE_T *iface)
 {
     int    i;
     MSC_T  *msc_p, *msc;
+    MSC_XPORT_T  *xport = NULL;
+    UAS_XPORT_T  *uas = NULL;
+
+    for (msc = g_msc_list; msc != NULL; msc = msc->next)
+    {
+        if (msc->iface == iface)
+        {
+            xport = msc->xport;             /* shared by all LUNs of this interface       */
+            uas = msc->uas;
+            if (uas != NULL)
+                uas_xport_detach(uas);
+            else
+                msc_xport_detach(xport);
+            break;
+        }
+    }
 
     /*
      *  Remove any hardware EP/QH from Host Controller hardware list.
@@ -592,6 +812,11 @@ static void msc_disconnect(IFACE_T *iface)
         iface->udev->hc_driver->quit_xfer(NULL, &(iface->aif->ep[i]));
     }
 
+    if (uas != NULL)
+        uas_xport_free(uas);                /* fail the requests still queued             */
+    else if (xport != NULL)
+        msc_xport_free(xport);
+
     /*
      *  unmount drive and remove it from MSC device list
      */
@@ -601,6 +826,7 @@ static void msc_disconnect(IFACE_T *iface)
         msc_p = msc->next;
         if (msc->iface == iface)
         {
+            umas_cache_invalidate(msc->drv_no);
             fatfs_drive_free(msc->drv_no);
             msc_list_remove(msc);
             usbh_free_mem(msc, sizeof(*msc));
@@ -617,12 +843,23 @@ UDEV_DRV_T  msc_driver =
     NULL
 };
 
+#if UMAS_USE_UAS
+UDEV_DRV_T  uas_driver =
+{
+    uas_probe,
+    msc_disconnect,
+    NULL,
+    NULL
+};
+#endif
+
 
 /// @endcond HIDDEN_SYMBOLS
 
 
 /**
-  * @brief       Register and initialize USB Host Mass Storage driver.
+  * @brief       Register and initialize USB Host Mass Storage driver. With UMAS_USE_UAS the
+  *              UAS driver is registered first, so that it gets the interfaces it can drive.
   *
   * @retval      0    Success.
   * @retval      1    Failed.
@@ -631,6 +868,10 @@ int  usbh_umas_init(void)
 {
     fatfs_drive_int();
     g_msc_list = NULL;
+#if UMAS_USE_UAS
+    if (usbh_register_driver(&uas_driver) < 0)
+        return USBH_ERR_MEMORY_OUT;
+#endif
     return usbh_register_driver(&msc_driver);
 }
 
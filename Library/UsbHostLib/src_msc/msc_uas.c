@@ -0,0 +1,649 @@
+/**************************************************************************//**
+ * @file     msc_uas.c
+ * @version  V1.00
+ * @brief    USB Attached SCSI transport of the USB mass storage driver
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "diskio.h"                // FATFS header
+#include "usb.h"
+#include "msc.h"
+
+
+/// @cond HIDDEN_SYMBOLS
+
+#define UAS_DT_PIPE_USAGE         0x24   /* Pipe Usage descriptor after each endpoint     */
+
+#define UAS_PIPE_COMMAND          1      /* bPipeID of the Pipe Usage descriptor          */
+#define UAS_PIPE_STATUS           2
+#define UAS_PIPE_DATA_IN          3
+#define UAS_PIPE_DATA_OUT         4
+
+/* Information unit IDs */
+#define UAS_IU_COMMAND            0x01
+#define UAS_IU_SENSE              0x03
+#define UAS_IU_RESPONSE           0x04
+#define UAS_IU_TASK_MGMT          0x05
+#define UAS_IU_READ_READY         0x06
+#define UAS_IU_WRITE_READY        0x07
+
+#define UAS_CMD_IU_LEN            32     /* COMMAND IU with a 16 bytes CDB                */
+#define UAS_TMF_IU_LEN            16
+
+#define UAS_TMF_LU_RESET          0x08   /* LOGICAL UNIT RESET task management function   */
+#define UAS_RC_TMF_COMPLETE       0x00   /* RESPONSE IU response codes                    */
+#define UAS_RC_TMF_SUCCEEDED      0x08
+#define UAS_TMF_TAG               (UMAS_UAS_QDEPTH + 1)
+
+#define SCSI_STAT_GOOD            0x00
+#define SCSI_STAT_BUSY            0x08
+#define SCSI_STAT_TASK_SET_FULL   0x28
+
+
+/*
+ *  Find the four pipes from the Pipe Usage descriptors that follow the endpoint descriptors
+ *  of <aif> in the configuration descriptor.
+ */
+static int  uas_find_pipes(UDEV_T *udev, ALT_IFACE_T *aif, UAS_XPORT_T *xp)
+{
+    DESC_CONF_T  *config = (DESC_CONF_T *)udev->cfd_buff;
+    EP_INFO_T    *ep = NULL;
+    uint8_t      *p, *end;
+    int          i, len;
+
+    len = config->wTotalLength;
+    if (len > MAX_DESC_BUFF_SIZE)
+        len = MAX_DESC_BUFF_SIZE;
+    end = udev->cfd_buff + len;
+
+    for (p = (uint8_t *)aif->ifd + aif->ifd->bLength; (p + 2 <= end) && (p[0] >= 2); p += p[0])
+    {
+        if (p[1] == USB_DT_INTERFACE)
+            break;
+
+        if (p[1] == USB_DT_ENDPOINT)
+        {
+            ep = NULL;
+            for (i = 0; i < aif->ifd->bNumEndpoints; i++)
+            {
+                if (aif->ep[i].bEndpointAddress == p[2])
+                    ep = &aif->ep[i];
+            }
+            continue;
+        }
+
+        if ((p[1] != UAS_DT_PIPE_USAGE) || (p[0] < 4) || (ep == NULL) ||
+                ((ep->bmAttributes & EP_ATTR_TT_MASK) != EP_ATTR_TT_BULK))
+            continue;
+
+        switch (p[2])
+        {
+        case UAS_PIPE_COMMAND:
+            xp->ep_cmd = ep;
+            break;
+        case UAS_PIPE_STATUS:
+            xp->ep_stat = ep;
+            break;
+        case UAS_PIPE_DATA_IN:
+            xp->ep_data_in = ep;
+            break;
+        case UAS_PIPE_DATA_OUT:
+            xp->ep_data_out = ep;
+            break;
+        }
+    }
+
+    if ((xp->ep_cmd == NULL) || (xp->ep_stat == NULL) || (xp->ep_data_in == NULL) || (xp->ep_data_out == NULL) ||
+            ((xp->ep_cmd->bEndpointAddress & EP_ADDR_DIR_MASK) != EP_ADDR_DIR_OUT) ||
+            ((xp->ep_stat->bEndpointAddress & EP_ADDR_DIR_MASK) != EP_ADDR_DIR_IN) ||
+            ((xp->ep_data_in->bEndpointAddress & EP_ADDR_DIR_MASK) != EP_ADDR_DIR_IN) ||
+            ((xp->ep_data_out->bEndpointAddress & EP_ADDR_DIR_MASK) != EP_ADDR_DIR_OUT))
+    {
+        msc_debug_msg("UAS pipe usage descriptors not found!\n");
+        return USBH_ERR_NOT_SUPPORTED;
+    }
+    return 0;
+}
+
+/*
+ *  Create the UAS transport of alternate setting <aif>. Returns NULL if it does not have the
+ *  four UAS pipes or out of memory.
+ */
+UAS_XPORT_T * uas_xport_alloc(UDEV_T *udev, ALT_IFACE_T *aif)
+{
+    UAS_XPORT_T  *xp;
+
+    xp = (UAS_XPORT_T *)usbh_alloc_mem(sizeof(*xp));
+    if (xp == NULL)
+        return NULL;
+
+    if (uas_find_pipes(udev, aif, xp) < 0)
+    {
+        usbh_free_mem(xp, sizeof(*xp));
+        return NULL;
+    }
+
+    xp->utr_cmd = alloc_utr(udev);
+    xp->utr_stat = alloc_utr(udev);
+    xp->utr_data = alloc_utr(udev);
+    if ((xp->utr_cmd == NULL) || (xp->utr_stat == NULL) || (xp->utr_data == NULL))
+    {
+        uas_xport_free(xp);
+        return NULL;
+    }
+    xp->utr_cmd->bIsTransferDone = 1;       /* UTRs are "done" until first submitted      */
+    xp->utr_stat->bIsTransferDone = 1;
+    xp->utr_data->bIsTransferDone = 1;
+    xp->qdepth = UMAS_UAS_QDEPTH;
+    xp->state = MSC_XP_IDLE;
+    return xp;
+}
+
+static void uas_cmd_done(UTR_T *utr);
+static void uas_stat_done(UTR_T *utr);
+static void uas_data_done(UTR_T *utr);
+
+static int  uas_utr_submit(UAS_XPORT_T *xp, UTR_T *utr, EP_INFO_T *ep, uint8_t *buff, uint32_t len,
+                           FUNC_UTR_T func)
+{
+    int   ret;
+
+    utr->ep = ep;
+    utr->buff = buff;
+    utr->data_len = len;
+    utr->xfer_len = 0;
+    utr->status = 0;
+    utr->td_cnt = 0;
+    utr->context = xp;
+    utr->func = func;
+    utr->bIsTransferDone = 0;
+
+    ret = usbh_bulk_xfer(utr);
+    if (ret < 0)
+        utr->bIsTransferDone = 1;           /* not on the bus                             */
+    return ret;
+}
+
+/*
+ *  The command of <tag_no> (0 if not known) failed. uas_xport_poll() will recover.
+ */
+static void uas_error(UAS_XPORT_T *xp, int tag_no, int err)
+{
+    if (xp->state != MSC_XP_BUSY)
+        return;
+    msc_debug_msg("UAS tag %d failed [%d]\n", tag_no, err);
+    xp->err_tag = tag_no;
+    xp->err = err;
+    xp->state = MSC_XP_ERROR;
+}
+
+/*
+ *  Keep a read of the status pipe on the bus while commands are outstanding.
+ */
+static void uas_post_stat(UAS_XPORT_T *xp)
+{
+    int   ret;
+
+    if ((xp->state != MSC_XP_BUSY) || (xp->active == 0) || !xp->utr_stat->bIsTransferDone)
+        return;
+
+    ret = uas_utr_submit(xp, xp->utr_stat, xp->ep_stat, (uint8_t *)xp->stat_iu, UAS_STAT_IU_LEN, uas_stat_done);
+    if (ret < 0)
+        uas_error(xp, 0, ret);
+}
+
+/*
+ *  Send the COMMAND IU of the first queued request if a tag is free and the command pipe is
+ *  idle. Called with interrupts disabled or from the transfer-done callback.
+ */
+static void uas_kick(UAS_XPORT_T *xp)
+{
+    struct bulk_cb_wrap  *cbw;
+    UMAS_REQ_T  *req;
+    UAS_TAG_T   *t;
+    uint8_t     *iu = (uint8_t *)xp->cmd_iu;
+    int         tag_no, ret;
+
+    if ((xp->state != MSC_XP_IDLE) && (xp->state != MSC_XP_BUSY))
+        return;
+
+    if ((xp->req_head != NULL) && (xp->active < xp->qdepth) && xp->utr_cmd->bIsTransferDone)
+    {
+        for (tag_no = 1; xp->tag[tag_no-1].req != NULL; tag_no++)
+            ;
+        req = xp->req_head;
+        xp->req_head = req->next;
+        if (xp->req_head == NULL)
+            xp->req_tail = NULL;
+
+        t = &xp->tag[tag_no-1];
+        t->req = req;
+        t->t0 = get_ticks();
+        t->status = 0;
+        t->bStatusIn = 0;
+        xp->active++;
+        xp->state = MSC_XP_BUSY;
+
+        cbw = (struct bulk_cb_wrap *)req->cbw;
+        memset(iu, 0, UAS_CMD_IU_LEN);
+        iu[0] = UAS_IU_COMMAND;
+        iu[2] = (tag_no >> 8) & 0xFF;
+        iu[3] = tag_no & 0xFF;              /* task attribute SIMPLE, no additional CDB   */
+        iu[9] = cbw->Lun;                   /* single level LUN                           */
+        memcpy(&iu[16], cbw->CDB, 16);
+
+        ret = uas_utr_submit(xp, xp->utr_cmd, xp->ep_cmd, iu, UAS_CMD_IU_LEN, uas_cmd_done);
+        if (ret < 0)
+        {
+            uas_error(xp, tag_no, ret);
+            return;
+        }
+    }
+    uas_post_stat(xp);
+}
+
+/*
+ *  Complete the command of <tag_no> with <status>. The next command is sent before the
+ *  callback of this one is made.
+ */
+static void uas_complete(UAS_XPORT_T *xp, int tag_no, int status)
+{
+    UAS_TAG_T   *t = &xp->tag[tag_no-1];
+    UMAS_REQ_T  *req = t->req;
+
+    t->req = NULL;
+    xp->active--;
+    if ((xp->active == 0) && (xp->req_head == NULL) && (xp->state == MSC_XP_BUSY))
+        xp->state = MSC_XP_IDLE;
+    else
+        uas_kick(xp);
+
+    req->status = status;
+    req->bIsDone = 1;
+    if (req->func)
+        req->func(req);
+}
+
+/*
+ *  Put the command of <tag_no> back to the head of the queue, to be sent again.
+ */
+static void uas_requeue(UAS_XPORT_T *xp, int tag_no)
+{
+    UAS_TAG_T   *t = &xp->tag[tag_no-1];
+    UMAS_REQ_T  *req = t->req;
+
+    t->req = NULL;
+    xp->active--;
+    req->next = xp->req_head;
+    xp->req_head = req;
+    if (xp->req_tail == NULL)
+        xp->req_tail = req;
+}
+
+static void uas_start_data(UAS_XPORT_T *xp, int tag_no)
+{
+    UMAS_REQ_T  *req = xp->tag[tag_no-1].req;
+    struct bulk_cb_wrap  *cbw = (struct bulk_cb_wrap *)req->cbw;
+    int   ret;
+
+    xp->data_tag = tag_no;
+    ret = uas_utr_submit(xp, xp->utr_data, req->bIsDataIn ? xp->ep_data_in : xp->ep_data_out,
+                         req->buff, cbw->DataTransferLength, uas_data_done);
+    if (ret < 0)
+        uas_error(xp, tag_no, ret);
+}
+
+static void uas_cmd_done(UTR_T *utr)
+{
+    UAS_XPORT_T  *xp = (UAS_XPORT_T *)utr->context;
+
+    if (xp->state != MSC_XP_BUSY)
+        return;                             /* aborted by uas_xport_poll() recovery       */
+
+    if (utr->status < 0)
+    {
+        uas_error(xp, ((uint8_t *)xp->cmd_iu)[3], utr->status);
+        return;
+    }
+    uas_kick(xp);
+}
+
+static void uas_stat_done(UTR_T *utr)
+{
+    UAS_XPORT_T  *xp = (UAS_XPORT_T *)utr->context;
+    uint8_t      *iu = (uint8_t *)xp->stat_iu;
+    UAS_TAG_T    *t;
+    int          tag_no;
+
+    if (xp->state != MSC_XP_BUSY)
+        return;                             /* aborted by uas_xport_poll() recovery       */
+
+    if (utr->status < 0)
+    {
+        uas_error(xp, 0, utr->status);
+        return;
+    }
+
+    tag_no = (iu[2] << 8) | iu[3];
+    if ((utr->xfer_len < 4) || (tag_no < 1) || (tag_no > UMAS_UAS_QDEPTH) || (xp->tag[tag_no-1].req == NULL))
+    {
+        msc_debug_msg("UAS IU 0x%x of unknown tag %d\n", iu[0], tag_no);
+        uas_error(xp, 0, UMAS_ERR_CMD_STATUS);
+        return;
+    }
+    t = &xp->tag[tag_no-1];
+
+    switch (iu[0])
+    {
+    case UAS_IU_READ_READY:
+    case UAS_IU_WRITE_READY:
+        if ((iu[0] == UAS_IU_READ_READY) != (t->req->bIsDataIn != 0))
+        {
+            uas_error(xp, tag_no, UMAS_ERR_CMD_STATUS);
+            return;
+        }
+        if (xp->data_tag == 0)
+            uas_start_data(xp, tag_no);
+        else
+            xp->ready_tag = tag_no;         /* start it when the data pipe is free        */
+        break;
+
+    case UAS_IU_SENSE:
+        if (utr->xfer_len < 16)
+        {
+            uas_error(xp, tag_no, UMAS_ERR_CMD_STATUS);
+            return;
+        }
+        if (((iu[6] == SCSI_STAT_TASK_SET_FULL) || (iu[6] == SCSI_STAT_BUSY)) &&
+                (xp->active > 1) && (xp->data_tag != tag_no))
+        {
+            /* the device queue is shorter than ours, send it again after another one is done */
+            msc_debug_msg("UAS task set full at %d commands\n", xp->active);
+            xp->qdepth = xp->active - 1;
+            uas_requeue(xp, tag_no);
+            break;
+        }
+        t->status = (iu[6] == SCSI_STAT_GOOD) ? 0 : UMAS_ERR_CMD_STATUS;
+        t->bStatusIn = 1;
+        if (xp->data_tag != tag_no)
+            uas_complete(xp, tag_no, t->status);
+        break;
+
+    case UAS_IU_RESPONSE:
+        msc_debug_msg("UAS tag %d response code 0x%x\n", tag_no, iu[7]);
+        t->status = UMAS_ERR_CMD_STATUS;
+        t->bStatusIn = 1;
+        if (xp->data_tag != tag_no)
+            uas_complete(xp, tag_no, t->status);
+        break;
+
+    default:
+        uas_error(xp, tag_no, UMAS_ERR_CMD_STATUS);
+        return;
+    }
+    uas_post_stat(xp);
+}
+
+static void uas_data_done(UTR_T *utr)
+{
+    UAS_XPORT_T  *xp = (UAS_XPORT_T *)utr->context;
+    int          tag_no = xp->data_tag;
+
+    if (xp->state != MSC_XP_BUSY)
+        return;                             /* aborted by uas_xport_poll() recovery       */
+
+    if (utr->status < 0)
+    {
+        uas_error(xp, tag_no, utr->status);
+        return;
+    }
+
+    xp->data_tag = 0;
+    if (xp->tag[tag_no-1].bStatusIn)
+        uas_complete(xp, tag_no, xp->tag[tag_no-1].status);     /* SENSE IU came first  */
+
+    if ((xp->ready_tag != 0) && (xp->state == MSC_XP_BUSY))
+    {
+        tag_no = xp->ready_tag;
+        xp->ready_tag = 0;
+        uas_start_data(xp, tag_no);
+    }
+}
+
+/*
+ *  Queue <req> to the UAS transport of <msc>. It is sent at once if a tag is free.
+ *  May be called from a request done callback.
+ */
+void uas_xport_submit(MSC_T *msc, UMAS_REQ_T *req)
+{
+    UAS_XPORT_T  *xp = msc->uas;
+    uint32_t     primask;
+
+    req->msc = msc;
+    req->next = NULL;
+    req->status = 0;
+    req->bIsDone = 0;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (xp->req_tail == NULL)
+        xp->req_head = req;
+    else
+        xp->req_tail->next = req;
+    xp->req_tail = req;
+
+    uas_kick(xp);
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  Send a LOGICAL UNIT RESET task management IU and read its RESPONSE IU. SENSE IUs of the
+ *  commands it aborts may come first.
+ */
+static int  uas_lu_reset(UAS_XPORT_T *xp, MSC_T *msc)
+{
+    uint8_t  *iu;
+    int      i, ret;
+
+    iu = (uint8_t *)xp->cmd_iu;
+    memset(iu, 0, UAS_TMF_IU_LEN);
+    iu[0] = UAS_IU_TASK_MGMT;
+    iu[3] = UAS_TMF_TAG;
+    iu[4] = UAS_TMF_LU_RESET;
+    iu[9] = msc->lun;
+
+    ret = msc_bulk_transfer(msc, xp->ep_cmd, iu, UAS_TMF_IU_LEN, 100);
+    if (ret < 0)
+        return ret;
+
+    iu = (uint8_t *)xp->stat_iu;
+    for (i = 0; i <= UMAS_UAS_QDEPTH; i++)
+    {
+        ret = msc_bulk_transfer(msc, xp->ep_stat, iu, UAS_STAT_IU_LEN, 300);
+        if (ret < 0)
+            return ret;
+        if ((iu[0] == UAS_IU_RESPONSE) && (iu[3] == UAS_TMF_TAG))
+        {
+            if ((iu[7] == UAS_RC_TMF_COMPLETE) || (iu[7] == UAS_RC_TMF_SUCCEEDED))
+                return 0;
+            return UMAS_ERR_CMD_STATUS;
+        }
+    }
+    return UMAS_ERR_CMD_STATUS;
+}
+
+/*
+ *  Remove <utr> from the bus and wait for the host controller driver to call it back.
+ */
+static void uas_quit_utr(UTR_T *utr)
+{
+    uint32_t   t0;
+
+    if (utr->bIsTransferDone)
+        return;
+
+    usbh_quit_utr(utr);
+    t0 = get_ticks();
+    while (!utr->bIsTransferDone && (get_ticks() - t0 < 10))
+        ;
+    utr->bIsTransferDone = 1;
+}
+
+/*
+ *  UAS error recovery. The UTRs still on the bus are removed, the pipes cleared and the
+ *  logical unit reset, which aborts all commands of the device. The failed command is
+ *  completed with the error, the others are sent again.
+ */
+static void uas_recover(UAS_XPORT_T *xp)
+{
+    MSC_T     *msc;
+    UDEV_T    *udev;
+    uint32_t  primask;
+    int       i, tag_no, ret;
+
+    tag_no = xp->err_tag;
+    if ((tag_no == 0) || (xp->tag[tag_no-1].req == NULL))
+    {
+        /* the failed command is not known, blame the oldest one */
+        tag_no = 0;
+        for (i = 1; i <= UMAS_UAS_QDEPTH; i++)
+        {
+            if ((xp->tag[i-1].req != NULL) &&
+                    ((tag_no == 0) || ((int32_t)(xp->tag[i-1].t0 - xp->tag[tag_no-1].t0) < 0)))
+                tag_no = i;
+        }
+    }
+    if (tag_no == 0)
+    {
+        xp->state = MSC_XP_IDLE;            /* nothing outstanding to recover             */
+        return;
+    }
+
+    msc = (MSC_T *)xp->tag[tag_no-1].req->msc;
+    udev = msc->iface->udev;
+    msc_debug_msg("UAS command of tag %d failed [%d], recovering...\n", tag_no, xp->err);
+
+    uas_quit_utr(xp->utr_cmd);
+    uas_quit_utr(xp->utr_stat);
+    uas_quit_utr(xp->utr_data);
+
+    usbh_clear_halt(udev, xp->ep_cmd->bEndpointAddress);
+    usbh_clear_halt(udev, xp->ep_stat->bEndpointAddress);
+    usbh_clear_halt(udev, xp->ep_data_in->bEndpointAddress);
+    usbh_clear_halt(udev, xp->ep_data_out->bEndpointAddress);
+
+    ret = uas_lu_reset(xp, msc);
+    if (ret < 0)
+        msc_debug_msg("UAS logical unit reset failed! [%d]\n", ret);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (!xp->bDetached)
+    {
+        for (i = UMAS_UAS_QDEPTH; i >= 1; i--)
+        {
+            if ((i != tag_no) && (xp->tag[i-1].req != NULL))
+                uas_requeue(xp, i);         /* aborted by the reset, send it again        */
+        }
+        xp->data_tag = 0;
+        xp->ready_tag = 0;
+        xp->state = MSC_XP_BUSY;
+        uas_complete(xp, tag_no, xp->err);
+    }
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  Time out the outstanding commands and recover the transport from a failed one.
+ *  Must not be called from interrupt context.
+ */
+void uas_xport_poll(UAS_XPORT_T *xp)
+{
+    uint32_t    primask, now;
+    int         i;
+
+    now = get_ticks();
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (xp->state == MSC_XP_BUSY)
+    {
+        for (i = 0; i < UMAS_UAS_QDEPTH; i++)
+        {
+            if ((xp->tag[i].req != NULL) && ((int32_t)(now - xp->tag[i].t0) > xp->tag[i].req->timeout))
+            {
+                uas_error(xp, i + 1, USBH_ERR_TIMEOUT);
+                break;
+            }
+        }
+    }
+    if (xp->state != MSC_XP_ERROR)
+    {
+        __set_PRIMASK(primask);
+        return;
+    }
+    xp->state = MSC_XP_RECOVER;
+    __set_PRIMASK(primask);
+
+    uas_recover(xp);
+}
+
+/*
+ *  The interface is going away. Stop sending commands, the callbacks of the UTRs aborted
+ *  by the disconnect are ignored.
+ */
+void uas_xport_detach(UAS_XPORT_T *xp)
+{
+    uint32_t    primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    xp->bDetached = 1;
+    xp->state = MSC_XP_RECOVER;
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  Fail the commands outstanding and queued, then release the transport. The endpoints
+ *  must have been quit.
+ */
+void uas_xport_free(UAS_XPORT_T *xp)
+{
+    UMAS_REQ_T  *req;
+    int         i;
+
+    for (i = UMAS_UAS_QDEPTH; i >= 1; i--)
+    {
+        if (xp->tag[i-1].req != NULL)
+            uas_requeue(xp, i);
+    }
+
+    while (xp->req_head != NULL)
+    {
+        req = xp->req_head;
+        xp->req_head = req->next;
+        req->status = UMAS_ERR_DRIVE_NOT_FOUND;
+        req->bIsDone = 1;
+        if (req->func)
+            req->func(req);
+    }
+    xp->req_tail = NULL;
+
+    if (xp->utr_cmd)
+        free_utr(xp->utr_cmd);
+    if (xp->utr_stat)
+        free_utr(xp->utr_stat);
+    if (xp->utr_data)
+        free_utr(xp->utr_data);
+    usbh_free_mem(xp, sizeof(*xp));
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
+
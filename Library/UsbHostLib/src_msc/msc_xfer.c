@@ -63,55 +63,352 @@ int msc_bulk_transfer(MSC_T *msc, EP_INFO_T *ep, uint8_t *data_buff, int data_le
 }
 
 
-static int  do_scsi_command(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataIn, int timeout_ticks)
+/*--------------------------------------------------------------------------*/
+/*   Bulk-only transport command engine                                     */
+/*--------------------------------------------------------------------------*/
+
+MSC_XPORT_T * msc_xport_alloc(UDEV_T *udev)
 {
-    int   ret;
-    struct bulk_cb_wrap  *cmd_blk = &msc->cmd_blk;         /* MSC Bulk-only command block   */
-    struct bulk_cs_wrap  *cmd_status = &msc->cmd_status;;  /* MSC Bulk-only command status  */
+    MSC_XPORT_T  *xp;
 
-    cmd_blk->Signature = MSC_CB_SIGN;
-    cmd_blk->Tag = __tag++;
-    cmd_blk->DataTransferLength = data_len;
-    cmd_blk->Lun = msc->lun;
+    xp = (MSC_XPORT_T *)usbh_alloc_mem(sizeof(*xp));
+    if (xp == NULL)
+        return NULL;
 
-    ret = msc_bulk_transfer(msc, msc->ep_bulk_out, (uint8_t *)cmd_blk, 31, timeout_ticks);
-    if (ret < 0)
-        return ret;
+    xp->utr_cbw = alloc_utr(udev);
+    xp->utr_data = alloc_utr(udev);
+    xp->utr_csw = alloc_utr(udev);
+    if ((xp->utr_cbw == NULL) || (xp->utr_data == NULL) || (xp->utr_csw == NULL))
+    {
+        msc_xport_free(xp);
+        return NULL;
+    }
+    xp->utr_data->bIsTransferDone = 1;      /* UTRs are "done" until first submitted      */
+    xp->utr_cbw->bIsTransferDone = 1;
+    xp->utr_csw->bIsTransferDone = 1;
+    xp->state = MSC_XP_IDLE;
+    return xp;
+}
+
+static void xport_utr_init(MSC_XPORT_T *xp, UTR_T *utr, EP_INFO_T *ep, uint8_t *buff, uint32_t len);
+static void xport_utr_done(UTR_T *utr);
+
+/*
+ *  Start the request at the queue head. Its CBW, data and CSW UTRs are submitted together,
+ *  the host controller driver queues the ones of the same endpoint one after the other and
+ *  splits the data phase into a chain of qTDs/TDs. Called with interrupts disabled or from
+ *  the transfer-done callback.
+ */
+static void xport_start(MSC_XPORT_T *xp)
+{
+    UMAS_REQ_T  *req = xp->req_head;
+    MSC_T       *msc = (MSC_T *)req->msc;
+    struct bulk_cb_wrap  *cbw = (struct bulk_cb_wrap *)req->cbw;
+    UTR_T       *utr[3];
+    int         i, n, ret;
+
+    cbw->Signature = MSC_CB_SIGN;
+    cbw->Tag = __tag++;
 
-    msc_debug_msg("    [XFER] MSC CMD OK.\n");
+    xp->state = MSC_XP_BUSY;
+    xp->err_utr = NULL;
+    xp->err = 0;
+    xp->t0 = get_ticks();
 
-    if (data_len > 0)
+    n = 0;
+    xport_utr_init(xp, xp->utr_cbw, msc->ep_bulk_out, (uint8_t *)cbw, MSC_CB_WRAP_LEN);
+    utr[n++] = xp->utr_cbw;
+    if (cbw->DataTransferLength > 0)
     {
-        if (bIsDataIn)
-            ret = msc_bulk_transfer(msc, msc->ep_bulk_in, buff, data_len, 500);
-        else
-            ret = msc_bulk_transfer(msc, msc->ep_bulk_out, buff, data_len, 500);
+        xport_utr_init(xp, xp->utr_data, req->bIsDataIn ? msc->ep_bulk_in : msc->ep_bulk_out,
+                       req->buff, cbw->DataTransferLength);
+        utr[n++] = xp->utr_data;
+    }
+    xport_utr_init(xp, xp->utr_csw, msc->ep_bulk_in, (uint8_t *)xp->csw, MSC_CS_WRAP_LEN);
+    utr[n++] = xp->utr_csw;
+
+    xp->utr_pending = n;
+    for (i = 0; i < n; i++)
+    {
+        ret = usbh_bulk_xfer(utr[i]);
         if (ret < 0)
-            return ret;
-        msc_debug_msg("    [XFER] MSC DATA OK.\n");
+        {
+            msc_debug_msg("MSC command start failed! [%d]\n", ret);
+            for ( ; i < n; i++)
+                utr[i]->bIsTransferDone = 1;    /* not on the bus                             */
+            xp->err = ret;
+            xp->state = MSC_XP_ERROR;
+            return;
+        }
     }
+}
 
-    ret = msc_bulk_transfer(msc, msc->ep_bulk_in, (uint8_t *)cmd_status, 13, timeout_ticks);
-    if (ret < 0)
-        return ret;
+static void xport_utr_init(MSC_XPORT_T *xp, UTR_T *utr, EP_INFO_T *ep, uint8_t *buff, uint32_t len)
+{
+    utr->ep = ep;
+    utr->buff = buff;
+    utr->data_len = len;
+    utr->xfer_len = 0;
+    utr->status = 0;
+    utr->td_cnt = 0;
+    utr->context = xp;
+    utr->func = xport_utr_done;
+    utr->bIsTransferDone = 0;
+}
+
+/*
+ *  Complete the request at the queue head with <status>. The next request is started
+ *  before the callback of this one is made. Called with interrupts disabled or from the
+ *  transfer-done callback.
+ */
+static void xport_complete(MSC_XPORT_T *xp, int status)
+{
+    UMAS_REQ_T  *req = xp->req_head;
+
+    xp->req_head = req->next;
+    if (xp->req_head == NULL)
+    {
+        xp->req_tail = NULL;
+        xp->state = MSC_XP_IDLE;
+    }
+    else
+    {
+        xport_start(xp);
+    }
+
+    req->status = status;
+    req->bIsDone = 1;
+    if (req->func)
+        req->func(req);
+}
+
+static void xport_utr_done(UTR_T *utr)
+{
+    MSC_XPORT_T  *xp = (MSC_XPORT_T *)utr->context;
+    struct bulk_cb_wrap  *cbw;
+    struct bulk_cs_wrap  *csw = (struct bulk_cs_wrap *)xp->csw;
 
-    msc_debug_msg("    [XFER] MSC STATUS OK.\n");
+    if (xp->state != MSC_XP_BUSY)
+        return;                             /* aborted by msc_xport_poll() recovery       */
 
-    if (cmd_status->Status != 0)
+    if (utr->status < 0)
+    {
+        xp->err_utr = utr;
+        xp->err = utr->status;
+        xp->state = MSC_XP_ERROR;           /* msc_xport_poll() will recover             */
+        return;
+    }
+
+    if (--xp->utr_pending > 0)
+        return;
+
+    cbw = (struct bulk_cb_wrap *)xp->req_head->cbw;
+    if ((xp->utr_csw->xfer_len != MSC_CS_WRAP_LEN) || (csw->Signature != MSC_CS_SIGN) ||
+            (csw->Tag != cbw->Tag) || (csw->Status == MSC_STAT_PHASE))
+    {
+        msc_debug_msg("    !! CSW not valid, len %d, status %d.\n", xp->utr_csw->xfer_len, csw->Status);
+        xp->err_utr = xp->utr_csw;
+        xp->err = UMAS_ERR_CMD_STATUS;
+        xp->state = MSC_XP_ERROR;
+        return;
+    }
+
+    if (csw->Status != MSC_STAT_OK)
     {
         msc_debug_msg("    !! CSW status error.\n");
-        return UMAS_ERR_CMD_STATUS;
+        xport_complete(xp, UMAS_ERR_CMD_STATUS);
+        return;
+    }
+    xport_complete(xp, 0);
+}
+
+/*
+ *  Queue <req> to the transport of <msc>, bulk-only or UAS. It is started at once if the
+ *  transport is idle.
+ *  May be called from a request done callback.
+ */
+void msc_xport_submit(MSC_T *msc, UMAS_REQ_T *req)
+{
+    MSC_XPORT_T  *xp = msc->xport;
+    uint32_t     primask;
+
+    if (msc->uas != NULL)
+    {
+        uas_xport_submit(msc, req);
+        return;
+    }
+
+    req->msc = msc;
+    req->next = NULL;
+    req->status = 0;
+    req->bIsDone = 0;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (xp->req_tail == NULL)
+        xp->req_head = req;
+    else
+        xp->req_tail->next = req;
+    xp->req_tail = req;
+
+    if (xp->state == MSC_XP_IDLE)
+        xport_start(xp);
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  Bulk-only transport error recovery for the failed request <req>. The UTRs of it still on
+ *  the bus are removed. A STALLed data or CSW phase is cleared and the CSW read again, any
+ *  other failure gets a reset recovery. Returns the status to complete <req> with.
+ */
+static int  xport_recover(MSC_XPORT_T *xp, UMAS_REQ_T *req)
+{
+    MSC_T   *msc = (MSC_T *)req->msc;
+    UDEV_T  *udev = msc->iface->udev;
+    struct bulk_cb_wrap  *cbw = (struct bulk_cb_wrap *)req->cbw;
+    struct bulk_cs_wrap  *csw = (struct bulk_cs_wrap *)xp->csw;
+    int     ret;
+
+    msc_debug_msg("MSC command 0x%x failed [%d], recovering...\n", cbw->CDB[0], xp->err);
+
+    if (!xp->utr_cbw->bIsTransferDone)
+        usbh_quit_utr(xp->utr_cbw);
+    if (!xp->utr_data->bIsTransferDone)
+        usbh_quit_utr(xp->utr_data);
+    if (!xp->utr_csw->bIsTransferDone)
+        usbh_quit_utr(xp->utr_csw);
+
+    if ((xp->err == USBH_ERR_STALL) && (xp->err_utr != NULL) && (xp->err_utr != xp->utr_cbw))
+    {
+        usbh_clear_halt(udev, xp->err_utr->ep->bEndpointAddress);
+
+        ret = msc_bulk_transfer(msc, msc->ep_bulk_in, (uint8_t *)csw, MSC_CS_WRAP_LEN, req->timeout);
+        if (ret == USBH_ERR_STALL)
+        {
+            usbh_clear_halt(udev, msc->ep_bulk_in->bEndpointAddress);
+            ret = msc_bulk_transfer(msc, msc->ep_bulk_in, (uint8_t *)csw, MSC_CS_WRAP_LEN, req->timeout);
+        }
+        if ((ret == 0) && (csw->Signature == MSC_CS_SIGN) && (csw->Tag == cbw->Tag) &&
+                (csw->Status != MSC_STAT_PHASE))
+            return xp->err;
+    }
+
+    msc_reset(msc);
+    return xp->err;
+}
+
+/*
+ *  Time out the running request and recover the transport from a failed one.
+ *  Must not be called from interrupt context.
+ */
+void msc_xport_poll(MSC_XPORT_T *xp)
+{
+    UMAS_REQ_T  *req;
+    uint32_t    primask;
+    int         status;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    req = xp->req_head;
+    if ((xp->state == MSC_XP_BUSY) && (get_ticks() - xp->t0 > req->timeout))
+    {
+        xp->err_utr = NULL;
+        xp->err = USBH_ERR_TIMEOUT;
+        xp->state = MSC_XP_ERROR;
+    }
+    if (xp->state != MSC_XP_ERROR)
+    {
+        __set_PRIMASK(primask);
+        return;
     }
-    msc_debug_msg("    [CSW] status OK.\n");
+    xp->state = MSC_XP_RECOVER;
+    __set_PRIMASK(primask);
 
-    msc_debug_msg("SCSI command 0x%0x done.\n", cmd_blk->CDB[0]);
-    return 0;
+    status = xport_recover(xp, req);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (!xp->bDetached)
+        xport_complete(xp, status);
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  Wait for <req> of <msc> to be done. Returns its status.
+ */
+int  msc_xport_wait(MSC_T *msc, UMAS_REQ_T *req)
+{
+    while (!req->bIsDone)
+    {
+        if (msc->uas != NULL)
+            uas_xport_poll(msc->uas);
+        else
+            msc_xport_poll(msc->xport);
+    }
+    return req->status;
+}
+
+/*
+ *  The interface is going away. Stop starting requests, the callbacks of the UTRs aborted
+ *  by the disconnect are ignored.
+ */
+void msc_xport_detach(MSC_XPORT_T *xp)
+{
+    uint32_t    primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    xp->bDetached = 1;
+    xp->state = MSC_XP_RECOVER;
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  Fail the requests still queued, then release the transport. The endpoints must have
+ *  been quit.
+ */
+void msc_xport_free(MSC_XPORT_T *xp)
+{
+    UMAS_REQ_T  *req;
+
+    while (xp->req_head != NULL)
+    {
+        req = xp->req_head;
+        xp->req_head = req->next;
+        req->status = UMAS_ERR_DRIVE_NOT_FOUND;
+        req->bIsDone = 1;
+        if (req->func)
+            req->func(req);
+    }
+    xp->req_tail = NULL;
+
+    free_utr(xp->utr_cbw);
+    free_utr(xp->utr_data);
+    free_utr(xp->utr_csw);
+    usbh_free_mem(xp, sizeof(*xp));
 }
 
 
 int  run_scsi_command(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataIn, int timeout_ticks)
 {
-    return do_scsi_command(msc, buff, data_len, bIsDataIn, timeout_ticks);
+    UMAS_REQ_T  req;
+    struct bulk_cb_wrap  *cbw = (struct bulk_cb_wrap *)req.cbw;
+    int   ret;
+
+    memcpy(cbw, &msc->cmd_blk, sizeof(msc->cmd_blk));
+    cbw->DataTransferLength = data_len;
+    cbw->Lun = msc->lun;
+
+    req.buff = buff;
+    req.bIsDataIn = bIsDataIn;
+    req.timeout = timeout_ticks * 2 + ((data_len > 0) ? 500 : 0);  /* CBW, data and CSW    */
+    req.func = NULL;
+
+    msc_xport_submit(msc, &req);
+    ret = msc_xport_wait(msc, &req);
+
+    msc_debug_msg("SCSI command 0x%0x done [%d].\n", cbw->CDB[0], ret);
+    return ret;
 }
 
 /*** (C) COPYRIGHT 2017 Nuvoton Technology Corp. ***/
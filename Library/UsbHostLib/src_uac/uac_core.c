@@ -501,6 +501,65 @@ int  usbh_uac_find_best_alt(IFACE_T *iface, uint8_t dir, uint8_t attr, int pkt_s
 }
 
 
+/**
+ *  @brief    Select the alternative interface of an audio streaming interface whose isochronous
+ *            endpoint has the maximum packet size, and find that endpoint.
+ *  @param[in]  uac       Audio Class device
+ *  @param[in]  asif      Audio streaming interface, uac->asif_in or uac->asif_out
+ *  @param[in]  dir       Endpoint direction, EP_ADDR_DIR_IN or EP_ADDR_DIR_OUT
+ *  @return   Success or not. The endpoint is asif->ep on success.
+ *  @retval     0         Success.
+ *  @retval    Otherwise  Failed
+ */
+int  uac_open_stream(UAC_DEV_T *uac, AS_IF_T *asif, uint8_t dir)
+{
+    IFACE_T      *iface = asif->iface;
+    ALT_IFACE_T  *aif;
+    EP_INFO_T    *ep;
+    uint8_t      bAlternateSetting;
+    int          i, ret;
+
+    /*------------------------------------------------------------------------------------*/
+    /*  Select the maximum packet size alternative interface                              */
+    /*------------------------------------------------------------------------------------*/
+    if (usbh_uac_find_max_alt(iface, dir, EP_ATTR_TT_ISO, &bAlternateSetting) != 0)
+        return UAC_RET_FUNC_NOT_FOUND;
+
+    ret = usbh_set_interface(iface, bAlternateSetting);
+    if (ret < 0)
+    {
+        UAC_ERRMSG("Failed to set interface %d, %d! (%d)\n", iface->if_num, bAlternateSetting, ret);
+        return ret;
+    }
+
+    ret = uac_parse_streaming_interface(uac, iface, bAlternateSetting);
+    if (ret < 0)
+        return ret;
+
+    /*------------------------------------------------------------------------------------*/
+    /*  Find the endpoint                                                                 */
+    /*------------------------------------------------------------------------------------*/
+    asif->ep = NULL;
+    aif = iface->aif;
+    for (i = 0; i < aif->ifd->bNumEndpoints; i++)
+    {
+        ep = &(aif->ep[i]);
+
+        if (((ep->bEndpointAddress & EP_ADDR_DIR_MASK) == dir) &&
+                ((ep->bmAttributes & EP_ATTR_TT_MASK) == EP_ATTR_TT_ISO))
+        {
+            asif->ep = ep;
+            UAC_DBGMSG("Audio %s endpoint 0x%x found, size: %d\n", (dir == EP_ADDR_DIR_IN) ? "in" : "out",
+                       ep->bEndpointAddress, ep->wMaxPacketSize);
+            break;
+        }
+    }
+    if (asif->ep == NULL)
+        return UAC_RET_FUNC_NOT_FOUND;
+
+    return 0;
+}
+
 static void iso_in_irq(UTR_T *utr)
 {
     UAC_DEV_T   *uac = (UAC_DEV_T *)utr->context;
@@ -555,11 +614,9 @@ int usbh_uac_start_audio_in(UAC_DEV_T *uac, UAC_CB_FUNC *func)
     UDEV_T       *udev = uac->udev;
     AS_IF_T      *asif = &uac->asif_in;
     IFACE_T      *iface = uac->asif_in.iface;
-    ALT_IFACE_T  *aif;
     EP_INFO_T    *ep;
     UTR_T        *utr;
     uint8_t      *buff;
-    uint8_t      bAlternateSetting;
     int          i, j, ret;
 
     if (!uac || !iface)
@@ -568,44 +625,11 @@ int usbh_uac_start_audio_in(UAC_DEV_T *uac, UAC_CB_FUNC *func)
     if (asif->flag_streaming)
         return UAC_RET_IS_STREAMING;
 
-    /*------------------------------------------------------------------------------------*/
-    /*  Select the maximum packet size alternative interface                              */
-    /*------------------------------------------------------------------------------------*/
-    if (usbh_uac_find_max_alt(iface, EP_ADDR_DIR_IN, EP_ATTR_TT_ISO, &bAlternateSetting) != 0)
-        return UAC_RET_FUNC_NOT_FOUND;
-
     uac->func_au_in = func;
 
-    ret = usbh_set_interface(iface, bAlternateSetting);
+    ret = uac_open_stream(uac, asif, EP_ADDR_DIR_IN);
     if (ret < 0)
-    {
-        UAC_ERRMSG("Failed to set interface %d, %d! (%d)\n", iface->if_num, bAlternateSetting, ret);
         return ret;
-    }
-
-    ret = uac_parse_streaming_interface(uac, iface, bAlternateSetting);
-    if (ret < 0)
-        return ret;
-
-    /*------------------------------------------------------------------------------------*/
-    /*  Find the endpoint                                                                 */
-    /*------------------------------------------------------------------------------------*/
-    asif->ep = NULL;
-    aif = asif->iface->aif;
-    for (i = 0; i < aif->ifd->bNumEndpoints; i++)
-    {
-        ep = &(aif->ep[i]);
-
-        if (((ep->bEndpointAddress & EP_ADDR_DIR_MASK) == EP_ADDR_DIR_IN) &&
-                ((ep->bmAttributes & EP_ATTR_TT_MASK) == EP_ATTR_TT_ISO))
-        {
-            asif->ep = ep;
-            UAC_DBGMSG("Audio in endpoint 0x%x found, size: %d\n", ep->bEndpointAddress, ep->wMaxPacketSize);
-            break;
-        }
-    }
-    if (asif->ep == NULL)
-        return UAC_RET_FUNC_NOT_FOUND;
     ep = asif->ep;
 
 #ifdef UAC_DEBUG
@@ -725,6 +749,7 @@ int usbh_uac_stop_audio_in(UAC_DEV_T *uac)
     if ((asif->utr[0] != NULL) &&
             (asif->utr[0]->buff != NULL))       /* free audio buffer                          */
         usbh_free_mem(asif->utr[0]->buff, asif->utr[0]->data_len * NUM_UTR);
+    asif->ring = NULL;
 
     for (i = 0; i < NUM_UTR; i++)           /* free all UTRs                              */
     {
@@ -797,11 +822,9 @@ int usbh_uac_start_audio_out(UAC_DEV_T *uac, UAC_CB_FUNC *func)
     UDEV_T       *udev = uac->udev;
     AS_IF_T      *asif = &uac->asif_out;
     IFACE_T      *iface = uac->asif_out.iface;
-    ALT_IFACE_T  *aif;
     EP_INFO_T    *ep;
     UTR_T        *utr;
     uint8_t      *buff;
-    uint8_t      bAlternateSetting;
     int          i, j, ret;
 
     if (!uac || !func || !iface)
@@ -810,44 +833,11 @@ int usbh_uac_start_audio_out(UAC_DEV_T *uac, UAC_CB_FUNC *func)
     if (asif->flag_streaming)
         return UAC_RET_IS_STREAMING;
 
-    /*------------------------------------------------------------------------------------*/
-    /*  Select the maximum packet size alternative interface                              */
-    /*------------------------------------------------------------------------------------*/
-    if (usbh_uac_find_max_alt(iface, EP_ADDR_DIR_OUT, EP_ATTR_TT_ISO, &bAlternateSetting) != 0)
-        return UAC_RET_FUNC_NOT_FOUND;
-
     uac->func_au_out = func;
 
-    ret = usbh_set_interface(iface, bAlternateSetting);
+    ret = uac_open_stream(uac, asif, EP_ADDR_DIR_OUT);
     if (ret < 0)
-    {
-        UAC_ERRMSG("Failed to set interface %d, %d! (%d)\n", iface->if_num, bAlternateSetting, ret);
         return ret;
-    }
-
-    ret = uac_parse_streaming_interface(uac, iface, bAlternateSetting);
-    if (ret < 0)
-        return ret;
-
-    /*------------------------------------------------------------------------------------*/
-    /*  Find the endpoint                                                                 */
-    /*------------------------------------------------------------------------------------*/
-    asif->ep = NULL;
-    aif = asif->iface->aif;
-    for (i = 0; i < aif->ifd->bNumEndpoints; i++)
-    {
-        ep = &(aif->ep[i]);
-
-        if (((ep->bEndpointAddress & EP_ADDR_DIR_MASK) == EP_ADDR_DIR_OUT) &&
-                ((ep->bmAttributes & EP_ATTR_TT_MASK) == EP_ATTR_TT_ISO))
-        {
-            asif->ep = ep;
-            UAC_DBGMSG("Audio in endpoint 0x%x found, size: %d\n", ep->bEndpointAddress, ep->wMaxPacketSize);
-            break;
-        }
-    }
-    if (asif->ep == NULL)
-        return UAC_RET_FUNC_NOT_FOUND;
     ep = asif->ep;
 
 #ifdef UAC_DEBUG
@@ -947,6 +937,8 @@ int usbh_uac_stop_audio_out(UAC_DEV_T *uac)
     AS_IF_T      *asif = &uac->asif_out;
     int          i, ret;
 
+    asif->flag_streaming = 0;               /* no resubmit from the aborted UTRs          */
+
     /* Set interface alternative settings */
     if (uac->state != UAC_STATE_DISCONNECTING)
     {
@@ -963,8 +955,10 @@ int usbh_uac_stop_audio_out(UAC_DEV_T *uac)
             usbh_quit_utr(asif->utr[i]);
     }
 
-    if ((asif->utr[0] != NULL) &&
-            (asif->utr[0]->buff != NULL))       /* free audio buffer                          */
+    if (asif->ring != NULL)
+        asif->ring = NULL;                  /* UTR buffers are in the ring of the caller  */
+    else if ((asif->utr[0] != NULL) &&
+             (asif->utr[0]->buff != NULL))  /* free audio buffer                          */
         usbh_free_mem(asif->utr[0]->buff, asif->utr[0]->data_len * NUM_UTR);
 
     for (i = 0; i < NUM_UTR; i++)           /* free all UTRs                              */
@@ -981,8 +975,6 @@ int usbh_uac_stop_audio_out(UAC_DEV_T *uac)
             uac->state = UAC_STATE_READY;
         }
     }
-    asif->flag_streaming = 0;
-
     return UAC_RET_OK;
 }
 
@@ -0,0 +1,518 @@
+/**************************************************************************//**
+ * @file     uac_ring.c
+ * @version  V1.00
+ * @brief    M480 MCU USB Host Audio Class driver, ring buffer streaming
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "NuMicro.h"
+
+#include "usb.h"
+#include "usbh_lib.h"
+#include "usbh_uac.h"
+#include "uac.h"
+
+
+/// @cond HIDDEN_SYMBOLS
+
+/*
+ *  In ring buffer mode the PCM data of a stream is kept in a ring of the caller, so that there
+ *  is no callback per isochronous packet. wr and rd are free running byte counters, the ring
+ *  holds wr - rd bytes.
+ *
+ *  Audio out packets are sent from the ring itself. The packets of a UTR are cut one after
+ *  the other from ring->sched, and a UTR whose packets run past the end of the ring has the
+ *  part from the ring start copied to the guard area behind the ring, so that its buffer is
+ *  contiguous as the iTD, siTD and OHCI TD require. The packet size follows the sampling rate,
+ *  one sample frame more when the ring is above hi_mark and one less below lo_mark, so that
+ *  the rate sent tracks the clock of the producer of the ring.
+ *
+ *  Audio in packets have the length the device chooses, and where a packet goes in the ring is
+ *  known only after the packets before it arrived. They are received in the UTR buffers and
+ *  appended to the ring from the transfer done interrupt.
+ */
+
+/* Isochronous packets per second, for the interval the host controller drivers schedule */
+static uint32_t  ring_packet_rate(UAC_DEV_T *uac, EP_INFO_T *ep)
+{
+    uint32_t   interval = 1;
+
+    while ((interval * 2 <= ep->bInterval) && (interval < 64))
+        interval *= 2;
+
+    if (uac->udev->speed == SPEED_HIGH)
+        return 8000 / interval;             /* micro-frames                               */
+    return 1000 / interval;
+}
+
+/* Set up <ring> for the stream of <asif>, whose endpoint was selected by uac_open_stream() */
+static int  ring_init(UAC_DEV_T *uac, AS_IF_T *asif, UAC_RING_T *ring)
+{
+    AS_FT1_T   *ft = asif->ft;
+    uint32_t   guard;
+
+    if ((ft == NULL) || (ft->bNrChannels == 0) || (ft->bSubframeSize == 0))
+        return UAC_RET_DEV_NOT_SUPPORTED;
+
+    ring->frame_size = ft->bNrChannels * ft->bSubframeSize;
+    if (ring->srate == 0)
+        ring->srate = ft->tSamFreq[0][0] | (ft->tSamFreq[0][1] << 8) | (ft->tSamFreq[0][2] << 16);
+
+    /*
+     *  The guard area takes the part of a UTR past the ring end. The ring must hold more than
+     *  the data of all UTRs.
+     */
+    guard = asif->ep->wMaxPacketSize * IF_PER_UTR;
+    if ((ring->buff == NULL) || (ring->srate == 0) || (ring->buff_size < guard * (NUM_UTR + 2)))
+        return UAC_RET_INVALID;
+
+    ring->size = (ring->buff_size - guard) / ring->frame_size * ring->frame_size;
+    if (ring->lo_mark == 0)
+        ring->lo_mark = ring->size / 4;
+    if (ring->hi_mark == 0)
+        ring->hi_mark = ring->size * 3 / 4;
+
+    ring->wr = ring->rd = ring->sched = 0;
+    ring->packets = ring->xrun = ring->adj_up = ring->adj_down = 0;
+    ring->acc = 0;
+    ring->pkt_rate = ring_packet_rate(uac, asif->ep);
+    return 0;
+}
+
+/* Size of the next audio out packet */
+static uint32_t  ring_out_packet_size(UAC_RING_T *ring, uint16_t wMaxPacketSize)
+{
+    uint32_t   frames, len, avail, level;
+
+    ring->acc += ring->srate;
+    frames = ring->acc / ring->pkt_rate;
+    ring->acc -= frames * ring->pkt_rate;
+
+    level = ring->wr - ring->rd;
+    if ((level > ring->hi_mark) && ((frames + 1) * ring->frame_size <= wMaxPacketSize))
+    {
+        frames++;                           /* the producer is ahead of the USB clock     */
+        ring->adj_up++;
+    }
+    else if ((level < ring->lo_mark) && (frames > 1))
+    {
+        frames--;                           /* the producer is behind                     */
+        ring->adj_down++;
+    }
+
+    len = frames * ring->frame_size;
+    if (len > wMaxPacketSize)
+        len = wMaxPacketSize / ring->frame_size * ring->frame_size;
+
+    avail = ring->wr - ring->sched;
+    if (len > avail)
+    {
+        len = avail / ring->frame_size * ring->frame_size;
+        ring->xrun++;                       /* underrun                                   */
+    }
+    return len;
+}
+
+/* Give the next audio out packets of the ring to <utr>, the <idx>-th UTR of the stream */
+static void  ring_out_fill_utr(UAC_RING_T *ring, UTR_T *utr, int idx)
+{
+    uint8_t    *buff;
+    uint32_t   pos, len, total = 0;
+    int        i;
+
+    pos = ring->sched % ring->size;
+    buff = ring->buff + pos;
+    for (i = 0; i < IF_PER_UTR; i++)
+    {
+        len = ring_out_packet_size(ring, utr->ep->wMaxPacketSize);
+        utr->iso_buff[i] = buff + total;
+        utr->iso_xlen[i] = len;
+        total += len;
+        ring->sched += len;
+    }
+
+    if (pos + total > ring->size)           /* runs past the ring end into the guard area */
+        memcpy(ring->buff + ring->size, ring->buff, pos + total - ring->size);
+
+    utr->buff = buff;
+    utr->data_len = total;
+    ring->utr_len[idx] = total;
+}
+
+static int  ring_utr_index(AS_IF_T *asif, UTR_T *utr)
+{
+    int   i;
+
+    for (i = 0; i < NUM_UTR - 1; i++)
+    {
+        if (asif->utr[i] == utr)
+            break;
+    }
+    return i;
+}
+
+static void iso_ring_out_irq(UTR_T *utr)
+{
+    UAC_DEV_T   *uac = (UAC_DEV_T *)utr->context;
+    UAC_RING_T  *ring;
+    int         i, idx, ret;
+
+    /* We don't want to do anything if we are about to be removed! */
+    if (!uac || !uac->udev)
+        return;
+
+    if ((uac->asif_out.flag_streaming == 0) || (uac->asif_out.ring == NULL))
+        return;
+
+    ring = uac->asif_out.ring;
+    idx = ring_utr_index(&uac->asif_out, utr);
+
+    utr->bIsoNewSched = 0;
+
+    for (i = 0; i < IF_PER_UTR; i++)
+    {
+        if (utr->iso_status[i] != 0)
+        {
+            if ((utr->iso_status[i] == USBH_ERR_NOT_ACCESS0) || (utr->iso_status[i] == USBH_ERR_NOT_ACCESS1))
+                utr->bIsoNewSched = 1;
+        }
+    }
+    ring->packets += IF_PER_UTR;
+    ring->rd += ring->utr_len[idx];         /* sent, the producer may use the space again */
+
+    ring_out_fill_utr(ring, utr, idx);
+
+    /* schedule the following isochronous transfers */
+    ret = usbh_iso_xfer(utr);
+    if (ret < 0)
+        UAC_DBGMSG("usbh_iso_xfer failed!\n");
+}
+
+/* Append <len> bytes to the audio in ring */
+static void  ring_put(UAC_RING_T *ring, uint8_t *data, uint32_t len)
+{
+    uint32_t   pos, n;
+
+    pos = ring->wr % ring->size;
+    n = ring->size - pos;
+    if (n > len)
+        n = len;
+    memcpy(ring->buff + pos, data, n);
+    if (len > n)
+        memcpy(ring->buff, data + n, len - n);
+    ring->wr += len;
+}
+
+static void iso_ring_in_irq(UTR_T *utr)
+{
+    UAC_DEV_T   *uac = (UAC_DEV_T *)utr->context;
+    UAC_RING_T  *ring;
+    int         i, ret;
+
+    /* We don't want to do anything if we are about to be removed! */
+    if (!uac || !uac->udev)
+        return;
+
+    if ((uac->asif_in.flag_streaming == 0) || (uac->asif_in.ring == NULL))
+        return;
+
+    ring = uac->asif_in.ring;
+
+    utr->bIsoNewSched = 0;
+
+    for (i = 0; i < IF_PER_UTR; i++)
+    {
+        if (utr->iso_status[i] == 0)
+        {
+            if (utr->iso_xlen[i] > ring->size - (ring->wr - ring->rd))
+                ring->xrun++;               /* overrun, drop the packet                   */
+            else if (utr->iso_xlen[i] > 0)
+                ring_put(ring, utr->iso_buff[i], utr->iso_xlen[i]);
+            ring->packets++;
+        }
+        else
+        {
+            UAC_DBGMSG("Iso %d err - %d\n", i, utr->iso_status[i]);
+            if ((utr->iso_status[i] == USBH_ERR_NOT_ACCESS0) || (utr->iso_status[i] == USBH_ERR_NOT_ACCESS1))
+                utr->bIsoNewSched = 1;
+        }
+        utr->iso_xlen[i] = utr->ep->wMaxPacketSize;
+    }
+
+    /* schedule the following isochronous transfers */
+    ret = usbh_iso_xfer(utr);
+    if (ret < 0)
+        UAC_DBGMSG("usbh_iso_xfer failed!\n");
+}
+
+/* Allocate the UTRs of <asif> and start them, the buffers are set up by the caller */
+static int  ring_start_utrs(UAC_DEV_T *uac, AS_IF_T *asif, uint8_t *buff, FUNC_UTR_T func)
+{
+    UTR_T      *utr;
+    int        i, j, ret;
+
+    for (i = 0; i < NUM_UTR; i++)
+    {
+        utr = alloc_utr(uac->udev);
+        if (utr == NULL)
+            return USBH_ERR_MEMORY_OUT;
+        asif->utr[i] = utr;
+        utr->context = uac;
+        utr->ep = asif->ep;
+        utr->func = func;
+
+        if (buff != NULL)                   /* audio in, receive in the UTR buffers       */
+        {
+            utr->buff = buff + (asif->ep->wMaxPacketSize * IF_PER_UTR * i);
+            utr->data_len = asif->ep->wMaxPacketSize * IF_PER_UTR;
+            for (j = 0; j < IF_PER_UTR; j++)
+            {
+                utr->iso_xlen[j] = asif->ep->wMaxPacketSize;
+                utr->iso_buff[j] = utr->buff + (asif->ep->wMaxPacketSize * j);
+            }
+        }
+        else                                /* audio out, send from the ring              */
+        {
+            ring_out_fill_utr(asif->ring, utr, i);
+        }
+    }
+
+    asif->utr[0]->bIsoNewSched = 1;
+
+    for (i = 0; i < NUM_UTR; i++)
+    {
+        ret = usbh_iso_xfer(asif->utr[i]);
+        if (ret < 0)
+        {
+            UAC_DBGMSG("Error - failed to start UTR %d isochronous transfer (%d)", i, ret);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/* Quit and free the UTRs of a stream that failed to start */
+static void  ring_free_utrs(AS_IF_T *asif, uint8_t *buff)
+{
+    int   i;
+
+    for (i = 0; i < NUM_UTR; i++)
+    {
+        if (asif->utr[i])
+            usbh_quit_utr(asif->utr[i]);
+    }
+    asif->flag_streaming = 0;
+    asif->ring = NULL;
+
+    if (buff != NULL)
+        usbh_free_mem(buff, asif->ep->wMaxPacketSize * IF_PER_UTR * NUM_UTR);
+
+    for (i = 0; i < NUM_UTR; i++)
+    {
+        if (asif->utr[i])
+            free_utr(asif->utr[i]);
+        asif->utr[i] = NULL;
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup LIBRARY Library
+  @{
+*/
+
+/** @addtogroup USBH_Library USB Host Library
+  @{
+*/
+
+/** @addtogroup USBH_EXPORTED_FUNCTIONS USB Host Exported Functions
+  @{
+*/
+
+/**
+ *  @brief  Start to receive audio data from UAC device into a ring buffer. (Microphone)
+ *          The received data is appended to the ring from the transfer done interrupt, and
+ *          read with usbh_uac_ring_read_ptr() and usbh_uac_ring_read_done(). Stop it with
+ *          usbh_uac_stop_audio_in().
+ *  @param[in] uac        Audio Class device
+ *  @param[in] ring       Ring buffer. The caller sets buff, buff_size and srate before the call.
+ *                        buff_size must be at least (NUM_UTR + 2) times 8 packets of the endpoint.
+ *  @return   Success or not.
+ *  @retval    0          Success
+ *  @retval    Otherwise  Failed
+ */
+int usbh_uac_start_audio_in_ring(UAC_DEV_T *uac, UAC_RING_T *ring)
+{
+    AS_IF_T      *asif;
+    uint8_t      *buff;
+    int          ret;
+
+    if (!uac || !ring || !uac->asif_in.iface)
+        return UAC_RET_DEV_NOT_FOUND;
+
+    asif = &uac->asif_in;
+    if (asif->flag_streaming)
+        return UAC_RET_IS_STREAMING;
+
+    ret = uac_open_stream(uac, asif, EP_ADDR_DIR_IN);
+    if (ret < 0)
+        return ret;
+
+    ret = ring_init(uac, asif, ring);
+    if (ret < 0)
+        return ret;
+
+    buff = (uint8_t *)usbh_alloc_mem(asif->ep->wMaxPacketSize * IF_PER_UTR * NUM_UTR);
+    if (buff == NULL)
+        return USBH_ERR_MEMORY_OUT;
+
+    asif->ring = ring;
+    asif->flag_streaming = 1;               /* before the first transfer done interrupt   */
+    ret = ring_start_utrs(uac, asif, buff, iso_ring_in_irq);
+    if (ret < 0)
+    {
+        ring_free_utrs(asif, buff);
+        return ret;
+    }
+    uac->state = UAC_STATE_RUNNING;
+    return UAC_RET_OK;
+}
+
+/**
+ *  @brief  Start to transmit audio data from a ring buffer to UAC device. (Speaker)
+ *          The isochronous packets are sent from the ring directly. Write the ring with
+ *          usbh_uac_ring_write_ptr() and usbh_uac_ring_write_done(), and fill it to about
+ *          half before the call. The packet size is adjusted to keep the ring level between
+ *          lo_mark and hi_mark. Stop it with usbh_uac_stop_audio_out().
+ *  @param[in] uac        Audio Class device
+ *  @param[in] ring       Ring buffer. The caller sets buff, buff_size, srate, lo_mark and hi_mark
+ *                        before the call. buff_size must be at least (NUM_UTR + 2) times 8 packets
+ *                        of the endpoint. The last 8 packets of buff are the guard area.
+ *  @return   Success or not.
+ *  @retval    0          Success
+ *  @retval    Otherwise  Failed
+ */
+int usbh_uac_start_audio_out_ring(UAC_DEV_T *uac, UAC_RING_T *ring)
+{
+    AS_IF_T      *asif;
+    uint32_t     wr;
+    int          ret;
+
+    if (!uac || !ring || !uac->asif_out.iface)
+        return UAC_RET_DEV_NOT_FOUND;
+
+    asif = &uac->asif_out;
+    if (asif->flag_streaming)
+        return UAC_RET_IS_STREAMING;
+
+    ret = uac_open_stream(uac, asif, EP_ADDR_DIR_OUT);
+    if (ret < 0)
+        return ret;
+
+    wr = ring->wr;                          /* keep the data written before the start     */
+    ret = ring_init(uac, asif, ring);
+    if (ret < 0)
+        return ret;
+    if (wr > ring->size)
+        return UAC_RET_INVALID;
+    ring->wr = wr;
+
+    asif->ring = ring;
+    asif->flag_streaming = 1;
+    ret = ring_start_utrs(uac, asif, NULL, iso_ring_out_irq);
+    if (ret < 0)
+    {
+        ring_free_utrs(asif, NULL);
+        return ret;
+    }
+    uac->state = UAC_STATE_RUNNING;
+    return UAC_RET_OK;
+}
+
+/**
+ *  @brief  Get the data of an audio in ring that can be read without wrapping around.
+ *  @param[in]  ring      Ring buffer
+ *  @param[out] len       Number of bytes at the returned address.
+ *  @return   Address of the oldest data in the ring.
+ */
+uint8_t * usbh_uac_ring_read_ptr(UAC_RING_T *ring, uint32_t *len)
+{
+    uint32_t   pos, n;
+
+    pos = ring->rd % ring->size;
+    n = ring->wr - ring->rd;
+    if (n > ring->size - pos)
+        n = ring->size - pos;
+    *len = n;
+    return ring->buff + pos;
+}
+
+/**
+ *  @brief  Release data read from an audio in ring.
+ *  @param[in]  ring      Ring buffer
+ *  @param[in]  len       Number of bytes read, at most the length from usbh_uac_ring_read_ptr().
+ *  @return   None.
+ */
+void usbh_uac_ring_read_done(UAC_RING_T *ring, uint32_t len)
+{
+    ring->rd += len;
+}
+
+/**
+ *  @brief  Get the free space of an audio out ring that can be written without wrapping around.
+ *          To fill the ring before usbh_uac_start_audio_out_ring(), copy the data to the start
+ *          of buff and set ring->wr to its length.
+ *  @param[in]  ring      Ring buffer
+ *  @param[out] len       Number of bytes at the returned address.
+ *  @return   Address to write at.
+ */
+uint8_t * usbh_uac_ring_write_ptr(UAC_RING_T *ring, uint32_t *len)
+{
+    uint32_t   pos, n;
+
+    pos = ring->wr % ring->size;
+    n = ring->size - (ring->wr - ring->rd);
+    if (n > ring->size - pos)
+        n = ring->size - pos;
+    *len = n;
+    return ring->buff + pos;
+}
+
+/**
+ *  @brief  Queue data written to an audio out ring.
+ *  @param[in]  ring      Ring buffer
+ *  @param[in]  len       Number of bytes written, at most the length from usbh_uac_ring_write_ptr().
+ *  @return   None.
+ */
+void usbh_uac_ring_write_done(UAC_RING_T *ring, uint32_t len)
+{
+    ring->wr += len;
+}
+
+/**
+ *  @brief  Latency of the audio in a ring.
+ *  @param[in]  ring      Ring buffer
+ *  @return   Playing time of the data in the ring, in microseconds.
+ */
+uint32_t usbh_uac_ring_latency(UAC_RING_T *ring)
+{
+    uint32_t   frames;
+
+    if ((ring->frame_size == 0) || (ring->srate == 0))
+        return 0;
+    frames = (ring->wr - ring->rd) / ring->frame_size;
+    return (uint32_t)(((uint64_t)frames * 1000000) / ring->srate);
+}
+
+/*@}*/ /* end of group USBH_EXPORTED_FUNCTIONS */
+
+/*@}*/ /* end of group USBH_Library */
+
+/*@}*/ /* end of group LIBRARY */
+
+/*** (C) COPYRIGHT 2019 Nuvoton Technology Corp. ***/
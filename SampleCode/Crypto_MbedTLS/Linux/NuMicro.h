@@ -0,0 +1,118 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @version  V1.00
+ * @brief    Host stand-in of the M480 device header for the Linux build of
+ *           the CRYPTO driver and the mbedtls hardware glue. It provides the
+ *           CRPT and SYS register files, which crpt_model.c models, and the
+ *           CMSIS functions the driver uses.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* crpt_model.c is built with hidden symbols, all of these are shared with it */
+#pragma GCC visibility push(default)
+
+/* The model writes the read-only registers, so none of them is const */
+#define __I     volatile
+#define __O     volatile
+#define __IO    volatile
+
+#include "sys_reg.h"
+#include "crypto_reg.h"
+
+typedef enum
+{
+    CRPT_IRQn                     = 71,       /*!< CRPT Interrupt                                   */
+} IRQn_Type;
+
+/*
+ *  The CRPT registers and the NVIC functions are provided by crpt_model.c. SYS->CSERVER
+ *  reads 0, an M480MD, which runs HMAC with every SHA mode.
+ */
+extern CRPT_T  __host_crpt;
+__attribute__((weak)) SYS_T  __host_sys;
+
+#define SYS                  (&__host_sys)
+#define CRPT                 (&__host_crpt)
+
+#define outpw(port,value)    (*((volatile uint32_t *)(uintptr_t)(port)) = (value))
+#define inpw(port)           (*((volatile uint32_t *)(uintptr_t)(port)))
+
+extern void NVIC_EnableIRQ(IRQn_Type IRQn);
+extern void NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* Provided by the test, like on the board */
+extern void CRYPTO_IRQHandler(void);
+
+/*
+ *  Single threaded. The model runs CRYPTO_IRQHandler() only while __host_primask is 0, as
+ *  __disable_irq() would mask it, and __host_irq_unmask() runs the interrupt that became
+ *  pending while masked.
+ */
+__attribute__((weak)) volatile uint32_t  __host_primask;
+extern void __host_irq_unmask(void);
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return __host_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t priMask)
+{
+    __host_primask = priMask;
+    if (priMask == 0UL)
+        __host_irq_unmask();
+}
+
+static inline void __disable_irq(void)
+{
+    __host_primask = 1UL;
+}
+
+static inline void __enable_irq(void)
+{
+    __host_primask = 0UL;
+    __host_irq_unmask();
+}
+
+/*
+ *  DWT cycle counter of the job statistics. It counts the register polls of the model.
+ */
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+__attribute__((weak)) DWT_Type        __host_dwt;
+__attribute__((weak)) CoreDebug_Type  __host_core_debug;
+__attribute__((weak)) uint32_t        SystemCoreClock = 192000000UL;
+
+#define DWT                         (&__host_dwt)
+#define CoreDebug                   (&__host_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+#include "crypto.h"
+
+#pragma GCC visibility pop
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,392 @@
+/**************************************************************************//**
+ * @file     aes_test.c
+ * @version  V1.00
+ * @brief    Host test of the AES engine glue of aes.c on the register model.
+ *
+ *           Runs the test_suit_aes vectors, once with word aligned buffers,
+ *           which the engine reads directly, and once off by one byte, which
+ *           go through the DMA bounce buffers. Bulk CBC, CFB and CTR data is
+ *           checked against the software reference at every alignment, with
+ *           the IV carried across calls of odd sizes, and with more contexts
+ *           than the engine has key channels, so that keys are evicted and
+ *           reloaded between the calls of a stream.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "mbedtls/aes.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define BULK_LEN        1024                    /* 16 bounce buffers of 64 bytes          */
+#define CTX_NUM         6                       /* more than the 4 key channels           */
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+static uint8_t  _src[BULK_LEN + 8] __attribute__((aligned(4)));
+static uint8_t  _dst[BULK_LEN + 8] __attribute__((aligned(4)));
+static uint8_t  _ref[BULK_LEN + 8];
+
+static const char  *mode_name(uint32_t mode)
+{
+    static const char  *name[] = { "ECB", "CBC", "CFB", "OFB", "CTR" };
+
+    return name[mode];
+}
+
+/* One vector of a .data file at buffer offset <off> */
+static int  run_vector(TEST_CASE_T *tc, int off)
+{
+    mbedtls_aes_context  ctx;
+    uint8_t   key[32], iv[16], expect[64], *src = _src + off, *dst = _dst + off;
+    int       keylen, len, enc, r = 0, expect_ret = 0;
+    size_t    iv_off = 0;
+    const char  *f = tc->func;
+
+    enc = (strstr(f, "encrypt") != NULL);
+    keylen = test_unhex(tc->argv[0], key);
+    if (strstr(f, "_ecb"))
+    {
+        len = test_unhex(tc->argv[1], src);
+        test_unhex(tc->argv[2], expect);
+        expect_ret = atoi(tc->argv[3]);
+    }
+    else
+    {
+        test_unhex(tc->argv[1], iv);
+        len = test_unhex(tc->argv[2], src);
+        test_unhex(tc->argv[3], expect);
+        if (tc->argc > 4)
+            expect_ret = atoi(tc->argv[4]);
+    }
+
+    mbedtls_aes_init(&ctx);
+    if (enc || strstr(f, "_cfb"))
+        mbedtls_aes_setkey_enc(&ctx, key, keylen * 8);
+    else
+        mbedtls_aes_setkey_dec(&ctx, key, keylen * 8);
+
+    if (strstr(f, "_ecb"))
+        r = mbedtls_aes_crypt_ecb(&ctx, enc ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, src, dst);
+    else if (strstr(f, "_cbc"))
+        r = mbedtls_aes_crypt_cbc(&ctx, enc ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, len, iv, src, dst);
+    else if (strstr(f, "_cfb128"))
+        r = mbedtls_aes_crypt_cfb128(&ctx, enc ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, len, &iv_off, iv, src, dst);
+    else if (strstr(f, "_cfb8"))
+        r = mbedtls_aes_crypt_cfb8(&ctx, enc ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, len, iv, src, dst);
+    else
+        return -1;
+    mbedtls_aes_free(&ctx);
+
+    if (r != expect_ret)
+        return -1;
+    if ((r == 0) && memcmp(dst, expect, len))
+        return -1;
+    return 0;
+}
+
+static void  test_vectors(const char *name)
+{
+    TEST_CASE_T  tc;
+    FILE  *fp;
+    int   n = 0, off;
+
+    fp = test_data_open("test_suit_aes", name);
+    CHECK(fp != NULL, "%s", name);
+    if (fp == NULL)
+        return;
+
+    memset(&tc, 0, sizeof(tc));
+    while (test_data_next(fp, &tc))
+    {
+        for (off = 0; off < 2; off++)
+        {
+            CHECK(run_vector(&tc, off) == 0, "%s line %d, %s, buffers %s", name, tc.line_no, tc.desc,
+                  off ? "unaligned" : "aligned");
+        }
+        n++;
+    }
+    fclose(fp);
+    printf("%s: %d vectors\n", name, n);
+}
+
+static void  fill(uint8_t *buf, int len, uint32_t seed)
+{
+    while (len-- > 0)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        *buf++ = (uint8_t)(seed >> 16);
+    }
+}
+
+/*
+ *  Bulk data at every alignment of source and destination. The aligned case is a single
+ *  DMA transfer, the others bounce through NUVOTON_AES_DMA_BUFF_SIZE byte chunks.
+ */
+static void  test_alignment(void)
+{
+    static const uint32_t  modes[] = { AES_MODE_CBC, AES_MODE_CFB, AES_MODE_CTR };
+    mbedtls_aes_context  ctx;
+    CRPT_MODEL_STAT_T    st;
+    uint8_t   key[32], iv[16], iv0[16], ref_iv[16], stream[16];
+    int       m, enc, so, dof, r = 0;
+    size_t    off;
+
+    fill(key, 32, 1);
+    fill(iv0, 16, 2);
+
+    for (m = 0; m < 3; m++)
+    {
+        for (enc = 0; enc < 2; enc++)
+        {
+            for (so = 0; so < 4; so++)
+            {
+                for (dof = 0; dof < 4; dof++)
+                {
+                    fill(_src + so, BULK_LEN, 3 + so);
+                    memcpy(ref_iv, iv0, 16);
+                    ref_aes_crypt(modes[m], enc, key, 256, ref_iv, _src + so, _ref, BULK_LEN);
+
+                    mbedtls_aes_init(&ctx);
+                    if (enc || (modes[m] != AES_MODE_CBC))
+                        mbedtls_aes_setkey_enc(&ctx, key, 256);
+                    else
+                        mbedtls_aes_setkey_dec(&ctx, key, 256);
+                    memcpy(iv, iv0, 16);
+                    off = 0;
+
+                    crpt_model_clear_stat();
+                    if (modes[m] == AES_MODE_CBC)
+                        r = mbedtls_aes_crypt_cbc(&ctx, enc, BULK_LEN, iv, _src + so, _dst + dof);
+                    else if (modes[m] == AES_MODE_CFB)
+                        r = mbedtls_aes_crypt_cfb128(&ctx, enc, BULK_LEN, &off, iv, _src + so, _dst + dof);
+                    else
+                        r = mbedtls_aes_crypt_ctr(&ctx, BULK_LEN, &off, iv, stream, _src + so, _dst + dof);
+                    crpt_model_stat(CRPT_JOB_AES, &st);
+                    mbedtls_aes_free(&ctx);
+
+                    CHECK((r == 0) && (memcmp(_dst + dof, _ref, BULK_LEN) == 0),
+                          "%s %s, source +%d, destination +%d", mode_name(modes[m]),
+                          enc ? "encrypt" : "decrypt", so, dof);
+                    CHECK(memcmp(iv, ref_iv, 16) == 0, "%s %s IV, source +%d, destination +%d",
+                          mode_name(modes[m]), enc ? "encrypt" : "decrypt", so, dof);
+                    CHECK(st.u32Ops == (((so | dof) == 0) ? 1U : BULK_LEN / NUVOTON_AES_DMA_BUFF_SIZE),
+                          "%s, source +%d, destination +%d: %u transfers", mode_name(modes[m]), so, dof, st.u32Ops);
+                }
+            }
+        }
+    }
+    printf("bulk CBC/CFB/CTR at all alignments: done\n");
+}
+
+/* Next piece size of a split stream, multiples of 16 for CBC */
+static int  piece_len(int i, uint32_t mode)
+{
+    static const int  len[] = { 1, 15, 16, 17, 33, 64, 65, 100, 129, 7, 48, 200 };
+
+    if (mode == AES_MODE_CBC)
+        return ((len[i % 12] + 15) / 16) * 16;
+    return len[i % 12];
+}
+
+/*
+ *  The same streams split into calls of odd sizes. The contexts are used in turn, more of
+ *  them than there are key channels, so each call finds its key evicted and reloads it
+ *  while its IV, CFB offset and CTR counter must carry over from the previous call.
+ */
+static void  test_streams(void)
+{
+    static const uint32_t  modes[] = { AES_MODE_CBC, AES_MODE_CFB, AES_MODE_CTR };
+    mbedtls_aes_context  ctx[CTX_NUM];
+    uint8_t   key[CTX_NUM][32], iv[CTX_NUM][16], stream[CTX_NUM][16];
+    uint8_t   *out[CTX_NUM], ref_iv[16];
+    size_t    off[CTX_NUM];
+    int       pos[CTX_NUM], piece[CTX_NUM];
+    int       c, m, enc, n, busy, r;
+
+    for (c = 0; c < CTX_NUM; c++)
+        out[c] = malloc(BULK_LEN);
+
+    for (m = 0; m < 3; m++)
+    {
+        for (enc = 0; enc < 2; enc++)
+        {
+            memset(&nvt_aes_stats, 0, sizeof(nvt_aes_stats));
+            for (c = 0; c < CTX_NUM; c++)
+            {
+                fill(key[c], 32, 10 + c);
+                fill(iv[c], 16, 20 + c);
+                mbedtls_aes_init(&ctx[c]);
+                if (enc || (modes[m] != AES_MODE_CBC))
+                    mbedtls_aes_setkey_enc(&ctx[c], key[c], 128 + 64 * (c % 3));
+                else
+                    mbedtls_aes_setkey_dec(&ctx[c], key[c], 128 + 64 * (c % 3));
+                off[c] = 0;
+                pos[c] = 0;
+                piece[c] = c;
+            }
+            fill(_src, BULK_LEN, 5);
+
+            /* round robin over the contexts, one piece each */
+            r = 0;
+            do
+            {
+                busy = 0;
+                for (c = 0; c < CTX_NUM; c++)
+                {
+                    n = piece_len(piece[c]++, modes[m]);
+                    if (n > BULK_LEN - pos[c])
+                        n = BULK_LEN - pos[c];
+                    if (n == 0)
+                        continue;
+                    busy = 1;
+                    if (modes[m] == AES_MODE_CBC)
+                        r |= mbedtls_aes_crypt_cbc(&ctx[c], enc, n, iv[c], _src + pos[c], out[c] + pos[c]);
+                    else if (modes[m] == AES_MODE_CFB)
+                        r |= mbedtls_aes_crypt_cfb128(&ctx[c], enc, n, &off[c], iv[c], _src + pos[c],
+                                                      out[c] + pos[c]);
+                    else
+                        r |= mbedtls_aes_crypt_ctr(&ctx[c], n, &off[c], iv[c], stream[c], _src + pos[c],
+                                                   out[c] + pos[c]);
+                    pos[c] += n;
+                }
+            } while (busy);
+            CHECK(r == 0, "%s stream returned an error", mode_name(modes[m]));
+
+            for (c = 0; c < CTX_NUM; c++)
+            {
+                fill(ref_iv, 16, 20 + c);
+                ref_aes_crypt(modes[m], enc, key[c], 128 + 64 * (c % 3), ref_iv, _src, _ref, BULK_LEN);
+                CHECK(memcmp(out[c], _ref, BULK_LEN) == 0, "%s %s stream of context %d",
+                      mode_name(modes[m]), enc ? "encrypt" : "decrypt", c);
+                mbedtls_aes_free(&ctx[c]);
+            }
+            CHECK(nvt_aes_stats.channel_steals > 0, "%s: no key channel was stolen", mode_name(modes[m]));
+        }
+    }
+    printf("split streams over %d contexts: %u key loads, %u channel steals, %u hits\n", CTX_NUM,
+           nvt_aes_stats.key_loads, nvt_aes_stats.channel_steals, nvt_aes_stats.key_hits);
+
+    for (c = 0; c < CTX_NUM; c++)
+        free(out[c]);
+}
+
+/* Up to 4 contexts keep their keys loaded, a fifth one evicts the least recently used */
+static void  test_channels(void)
+{
+    mbedtls_aes_context  ctx[5];
+    CRPT_MODEL_STAT_T    st;
+    uint8_t   key[5][16], blk[16], out[16], ref[16];
+    int       c, i;
+
+    for (c = 0; c < 5; c++)
+    {
+        fill(key[c], 16, 30 + c);
+        mbedtls_aes_init(&ctx[c]);
+        mbedtls_aes_setkey_enc(&ctx[c], key[c], 128);
+    }
+    nvt_aes_flush_channels();
+    memset(&nvt_aes_stats, 0, sizeof(nvt_aes_stats));
+    crpt_model_clear_stat();
+    fill(blk, 16, 40);
+
+    for (i = 0; i < 10; i++)
+    {
+        for (c = 0; c < 4; c++)
+            mbedtls_aes_crypt_ecb(&ctx[c], MBEDTLS_AES_ENCRYPT, blk, out);
+    }
+    crpt_model_stat(CRPT_JOB_AES, &st);
+    CHECK((nvt_aes_stats.key_loads == 4) && (nvt_aes_stats.key_hits == 36) && (nvt_aes_stats.channel_steals == 0),
+          "4 contexts: %u loads, %u hits, %u steals", nvt_aes_stats.key_loads, nvt_aes_stats.key_hits,
+          nvt_aes_stats.channel_steals);
+    CHECK(st.u32KeyLoads == 4, "4 contexts: the engine saw %u keys", st.u32KeyLoads);
+
+    /* ctx[0] is the least recently used, the fifth context takes its channel */
+    mbedtls_aes_crypt_ecb(&ctx[4], MBEDTLS_AES_ENCRYPT, blk, out);
+    mbedtls_aes_crypt_ecb(&ctx[1], MBEDTLS_AES_ENCRYPT, blk, out);
+    CHECK((nvt_aes_stats.key_loads == 5) && (nvt_aes_stats.channel_steals == 1),
+          "fifth context: %u loads, %u steals", nvt_aes_stats.key_loads, nvt_aes_stats.channel_steals);
+    mbedtls_aes_crypt_ecb(&ctx[0], MBEDTLS_AES_ENCRYPT, blk, out);
+    CHECK(nvt_aes_stats.key_loads == 6, "evicted context reloaded: %u loads", nvt_aes_stats.key_loads);
+    memset(ref, 0, 16);
+    ref_aes_crypt(AES_MODE_ECB, 1, key[0], 128, ref, blk, ref, 16);
+    CHECK(memcmp(out, ref, 16) == 0, "evicted context, wrong key used");
+
+    /* A new key in a context that holds a channel must be loaded, not the stale one used */
+    fill(key[0], 16, 50);
+    mbedtls_aes_setkey_enc(&ctx[0], key[0], 128);
+    mbedtls_aes_crypt_ecb(&ctx[0], MBEDTLS_AES_ENCRYPT, blk, out);
+    ref_aes_crypt(AES_MODE_ECB, 1, key[0], 128, ref, blk, ref, 16);
+    CHECK(memcmp(out, ref, 16) == 0, "new key of a resident context not loaded");
+
+    /* A context freed and another set up at the same address */
+    mbedtls_aes_free(&ctx[0]);
+    mbedtls_aes_init(&ctx[0]);
+    fill(key[0], 16, 60);
+    mbedtls_aes_setkey_enc(&ctx[0], key[0], 128);
+    mbedtls_aes_crypt_ecb(&ctx[0], MBEDTLS_AES_ENCRYPT, blk, out);
+    ref_aes_crypt(AES_MODE_ECB, 1, key[0], 128, ref, blk, ref, 16);
+    CHECK(memcmp(out, ref, 16) == 0, "context at the address of a freed one used its key");
+
+    for (c = 0; c < 5; c++)
+        mbedtls_aes_free(&ctx[c]);
+    printf("key channels: done\n");
+}
+
+/* An engine error is returned, and the next operation runs normally */
+static void  test_error(void)
+{
+    mbedtls_aes_context  ctx;
+    uint8_t   key[16], iv[16];
+
+    fill(key, 16, 70);
+    memset(iv, 0, 16);
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, key, 128);
+
+    crpt_model_fail(CRPT_JOB_AES, 0);
+    CHECK(mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, 256, iv, _src, _dst) == MBEDTLS_ERR_AES_HW_ACCEL_FAILED,
+          "engine error not returned");
+    CHECK(mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, 256, iv, _src, _dst) == 0,
+          "operation after an engine error");
+    mbedtls_aes_free(&ctx);
+}
+
+static void  aes_test(void)
+{
+    crpt_test_init();
+    crpt_model_check_lock(1);
+
+    test_vectors("test_suite_aes.cbc.data");
+    test_vectors("test_suite_aes.cfb.data");
+    test_vectors("test_suite_aes.ecb.data");
+
+    CHECK(mbedtls_aes_self_test(0) == 0, "mbedtls_aes_self_test");
+
+    test_alignment();
+    test_channels();
+    test_streams();
+    test_error();
+
+    /* and once more with every operation ending a while after START, from the interrupt */
+    crpt_model_set_latency(CRPT_JOB_AES, 20);
+    test_alignment();
+    test_streams();
+}
+
+int main(void)
+{
+    if (crpt_model_run(aes_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
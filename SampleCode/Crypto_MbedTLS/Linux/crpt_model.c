@@ -0,0 +1,1778 @@
+/**************************************************************************//**
+ * @file     crpt_model.c
+ * @version  V1.00
+ * @brief    Register model of the M480 CRPT engines for the Linux build of
+ *           the CRYPTO driver and the mbedtls hardware glue. The engines run
+ *           their operations with a software build of mbedtls, see
+ *           crpt_model.h.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "NuMicro.h"
+
+#include "mbedtls/aes.h"
+#include "mbedtls/bignum.h"
+#include "mbedtls/des.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+
+#include "crpt_model.h"
+
+/*
+ *  Register accesses. The driver objects are compiled with -fsanitize=thread and
+ *  --param tsan-distinguish-volatile=1, every volatile access calls a __tsan_volatile_*
+ *  hook before it is made. A write to a CRPT register is remembered and applied at the
+ *  next hook or model entry, after the store has been made: the register then holds the
+ *  value written and the model turns it into what the engine would make of it, W1C bits
+ *  cleared, read-only registers restored, START run. Every volatile read is a poll of the
+ *  CPU and advances the running operations by one, or ends those of a rate-timed engine
+ *  that are due.
+ */
+#define ENG_CNT              CRPT_JOB_ENGINE_CNT
+#define IRQ_LOOP_MAX         16
+#define IDLE_POLL_MAX        50000000UL     /* polls with no engine busy before a hang is reported */
+
+#define CTL_START            (1UL << 0)
+#define CTL_STOP             (1UL << 1)
+#define SHA_CTL_CSCAD        (1UL << 6)     /* DMA mode bit of CRYPTO_DMA_CONTINUE and CRYPTO_DMA_LAST */
+
+#define PTR(a)               ((uint8_t *)(uintptr_t)(a))
+#define IN_REGS(a, r)        (((uint8_t *)(a) >= (uint8_t *)&(r)) && ((uint8_t *)(a) < (uint8_t *)(&(r) + 1)))
+#define AES_CH(reg, ch)      ((volatile uint32_t *)((uint8_t *)&(reg) + (ch) * 0x3CUL))
+#define TDES_CH(reg, ch)     ((volatile uint32_t *)((uint8_t *)&(reg) + (ch) * 0x40UL))
+#define TDES_SWAP            (CRPT_TDES_CTL_INSWAP_Msk | CRPT_TDES_CTL_OUTSWAP_Msk | CRPT_TDES_CTL_BLKSWAP_Msk)
+
+#define GET_BE32(b)          (((uint32_t)(b)[0] << 24) | ((uint32_t)(b)[1] << 16) | \
+                              ((uint32_t)(b)[2] << 8) | (uint32_t)(b)[3])
+#define PUT_BE32(b, v)       do { (b)[0] = (uint8_t)((v) >> 24); (b)[1] = (uint8_t)((v) >> 16); \
+                                  (b)[2] = (uint8_t)((v) >> 8); (b)[3] = (uint8_t)(v); } while (0)
+
+CRPT_T  __host_crpt;
+
+typedef struct
+{
+    volatile uint32_t  *ctl, *sts;
+    uint32_t  sts_busy, sts_err;    /* STS bits set while an operation runs, after one failed */
+    uint32_t  if_msk, eif_msk;
+    const char  *name;
+} ENG_REG_T;
+
+static const ENG_REG_T  _eng_reg[ENG_CNT] =
+{
+    {
+        &__host_crpt.AES_CTL,  &__host_crpt.AES_STS,  CRPT_AES_STS_BUSY_Msk, CRPT_AES_STS_BUSERR_Msk,
+        CRPT_INTSTS_AESIF_Msk,  CRPT_INTSTS_AESEIF_Msk,  "AES"
+    },
+    {
+        &__host_crpt.TDES_CTL, &__host_crpt.TDES_STS, CRPT_TDES_STS_BUSY_Msk, CRPT_TDES_STS_BUSERR_Msk,
+        CRPT_INTSTS_TDESIF_Msk, CRPT_INTSTS_TDESEIF_Msk, "TDES"
+    },
+    {
+        &__host_crpt.HMAC_CTL, &__host_crpt.HMAC_STS, CRPT_HMAC_STS_BUSY_Msk | CRPT_HMAC_STS_DMABUSY_Msk,
+        CRPT_HMAC_STS_DMAERR_Msk, CRPT_INTSTS_HMACIF_Msk, CRPT_INTSTS_HMACEIF_Msk, "SHA"
+    },
+    {
+        &__host_crpt.ECC_CTL,  &__host_crpt.ECC_STS,  CRPT_ECC_STS_BUSY_Msk | CRPT_ECC_STS_DMABUSY_Msk,
+        CRPT_ECC_STS_BUSERR_Msk, CRPT_INTSTS_ECCIF_Msk,  CRPT_INTSTS_ECCEIF_Msk,  "ECC"
+    },
+};
+
+typedef struct
+{
+    int        busy;
+    uint32_t   left;                /* polls until the running operation ends          */
+    uint32_t   latency;
+    uint32_t   kbps;                /* DMA input rate of a rate-timed engine, 0 none    */
+    uint64_t   start_ns;            /* CLOCK_MONOTONIC start and end of its operation   */
+    uint64_t   end_ns;
+    int32_t    fail_skip;           /* operations to go before an injected error, -1 none */
+    int        fail;                /* the running operation ends with the error flag   */
+    uint8_t    *out;                /* DMA output, written to out_addr when it ends     */
+    uint32_t   out_addr;
+    uint32_t   out_len;
+    uint32_t   out_size;
+    int        out_swap;
+    uint8_t    *in;                 /* DMA input as read at START, checked at the end   */
+    uint32_t   in_addr;
+    uint32_t   in_len;
+    uint32_t   in_size;
+    CRPT_MODEL_STAT_T  stat;
+} ENGINE_T;
+
+static ENGINE_T        _eng[ENG_CNT];
+
+static uint32_t        *_wr_reg;            /* register written, not applied yet          */
+static uint32_t        _wr_old;
+
+static uint32_t        _lock_depth[ENG_CNT];  /* CRPT_JobLock() nesting of each engine    */
+static int             _lock_check;
+
+static uint32_t        _irq_en;
+static int             _in_irq;
+static uint32_t        _irqs;
+static uint32_t        _polls;
+static uint32_t        _idle_polls;
+
+/* AES feedback register of each channel, valid after the first operation of the channel */
+static uint8_t         _aes_fb[4][16];
+static int             _aes_fb_valid[4];
+static uint8_t         _aes_key[4][32];     /* key of the previous operation of each channel */
+
+/* TDES feedback register of each channel, valid after the first operation of the channel */
+static uint8_t         _tdes_fb[4][8];
+static int             _tdes_fb_valid[4];
+static uint8_t         _tdes_key[4][24];    /* keys of the previous operation of each channel */
+
+/* SHA state of the open DMA cascade, and the HMAC_DGST words of the running operation */
+static int             _sha_open;
+static union
+{
+    mbedtls_sha1_context    sha1;
+    mbedtls_sha256_context  sha256;
+    mbedtls_sha512_context  sha512;
+} _sha;
+static uint32_t        _sha_dgst[16];
+static uint32_t        _sha_dgst_cnt;
+
+/* ECC_X1/ECC_Y1 at the end of the running operation */
+static uint32_t        _ecc_x1[18], _ecc_y1[18];
+
+static void  model_irq(void);
+
+
+static void  model_fault(const char *fmt, ...)
+{
+    va_list  ap;
+
+    fflush(stdout);
+    fprintf(stderr, "CRPT model: ");
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/*----------------------------------------------------------------------------------------*/
+/*   DMA                                                                                  */
+/*----------------------------------------------------------------------------------------*/
+
+/*
+ *  The engines move whole words. Without the swap bit of the direction, the bytes of each
+ *  word are reversed on the way, with it they are in memory order.
+ */
+static void  dma_check(const char *what, uint32_t addr, uint32_t len)
+{
+    if (addr & 0x3UL)
+        model_fault("%s DMA address 0x%08x is not word aligned", what, addr);
+    if ((addr == 0UL) && (len != 0UL))
+        model_fault("%s DMA address is 0", what);
+}
+
+static void  swap_words(uint8_t *buf, uint32_t len)
+{
+    uint32_t  i;
+    uint8_t   t;
+
+    for (i = 0UL; i < len; i += 4UL)
+    {
+        t = buf[i];
+        buf[i] = buf[i + 3];
+        buf[i + 3] = t;
+        t = buf[i + 1];
+        buf[i + 1] = buf[i + 2];
+        buf[i + 2] = t;
+    }
+}
+
+/* Read <len> bytes at <addr> into a buffer of the engine, rounded up to words */
+static uint8_t * dma_read(ENGINE_T *en, const char *what, uint32_t addr, uint32_t len, int swap)
+{
+    uint32_t  size = (len + 3UL) & ~3UL;
+
+    dma_check(what, addr, len);
+    if (size > en->out_size)
+    {
+        en->out = realloc(en->out, size);
+        en->in = realloc(en->in, size);
+        if ((en->out == NULL) || (en->in == NULL))
+            model_fault("out of memory");
+        en->out_size = size;
+    }
+    memcpy(en->out, PTR(addr), size);
+    memcpy(en->in, PTR(addr), len);
+    en->in_addr = addr;
+    en->in_len = len;
+    if (!swap)
+        swap_words(en->out, size);
+    en->stat.u64Bytes += len;
+    return en->out;
+}
+
+/* The buffer of dma_read() is written to <addr> when the operation ends */
+static void  dma_write_at_end(ENGINE_T *en, const char *what, uint32_t addr, uint32_t len, int swap)
+{
+    dma_check(what, addr, len);
+    en->out_addr = addr;
+    en->out_len = len;
+    en->out_swap = swap;
+}
+
+/* The engine reads its source while it runs, the CPU must leave it alone until the end */
+static void  dma_check_source(ENGINE_T *en, const char *what)
+{
+    if ((en->in_len != 0UL) && (memcmp(PTR(en->in_addr), en->in, en->in_len) != 0))
+        model_fault("%s source at 0x%08x changed while the engine read it", what, en->in_addr);
+    en->in_len = 0UL;
+}
+
+static void  dma_flush(ENGINE_T *en)
+{
+    if (en->out_len == 0UL)
+        return;
+    if (!en->out_swap)
+        swap_words(en->out, (en->out_len + 3UL) & ~3UL);
+    memcpy(PTR(en->out_addr), en->out, en->out_len);
+    en->out_len = 0UL;
+}
+
+/*----------------------------------------------------------------------------------------*/
+/*   AES                                                                                  */
+/*----------------------------------------------------------------------------------------*/
+
+static void  ctr_inc(uint8_t *ctr, int len)
+{
+    while (len-- > 0)
+    {
+        if (++ctr[len] != 0U)
+            break;
+    }
+}
+
+static void  aes_start(uint32_t ctl)
+{
+    ENGINE_T  *en = &_eng[CRPT_JOB_AES];
+    mbedtls_aes_context  aes;
+    uint32_t  ch, keysz, opmode, cnt, i, n;
+    int       enc;
+    uint8_t   key[32], *fb, *data, blk[16];
+
+    ch = (ctl & CRPT_AES_CTL_CHANNEL_Msk) >> CRPT_AES_CTL_CHANNEL_Pos;
+    keysz = (ctl & CRPT_AES_CTL_KEYSZ_Msk) >> CRPT_AES_CTL_KEYSZ_Pos;
+    opmode = (ctl & CRPT_AES_CTL_OPMODE_Msk) >> CRPT_AES_CTL_OPMODE_Pos;
+    enc = (ctl & CRPT_AES_CTL_ENCRPT_Msk) != 0UL;
+    cnt = *AES_CH(__host_crpt.AES0_CNT, ch);
+
+    if (!(ctl & CRPT_AES_CTL_DMAEN_Msk))
+        model_fault("AES without DMA is not modelled");
+    if (keysz > AES_KEY_SIZE_256)
+        model_fault("AES key size %u", keysz);
+    if (opmode > AES_MODE_CTR)
+        model_fault("AES mode 0x%x is not modelled", opmode);
+    if ((cnt % 16UL) && (opmode != AES_MODE_CTR || !(ctl & CRPT_AES_CTL_DMALAST_Msk)))
+        model_fault("AES transfer of %u bytes is not a multiple of the block", cnt);
+
+    for (i = 0UL; i < 8UL; i++)
+        PUT_BE32(&key[i * 4UL], AES_CH(__host_crpt.AES0_KEY[0], ch)[i]);
+    if (memcmp(key, _aes_key[ch], 32))
+    {
+        memcpy(_aes_key[ch], key, 32);
+        en->stat.u32KeyLoads++;
+    }
+
+    /* A cascaded transfer continues from the feedback of the channel, else the IV is loaded */
+    fb = _aes_fb[ch];
+    if ((ctl & CRPT_AES_CTL_DMACSCAD_Msk) && (opmode != AES_MODE_ECB))
+    {
+        if (!_aes_fb_valid[ch])
+            model_fault("AES channel %u cascades without a previous transfer", ch);
+    }
+    else
+    {
+        for (i = 0UL; i < 4UL; i++)
+            PUT_BE32(&fb[i * 4UL], AES_CH(__host_crpt.AES0_IV[0], ch)[i]);
+    }
+
+    data = dma_read(en, "AES source", *AES_CH(__host_crpt.AES0_SADDR, ch), cnt,
+                    (ctl & CRPT_AES_CTL_INSWAP_Msk) != 0UL);
+
+    mbedtls_aes_init(&aes);
+    if (enc || (opmode >= AES_MODE_CFB))
+        mbedtls_aes_setkey_enc(&aes, key, 128U + keysz * 64U);
+    else
+        mbedtls_aes_setkey_dec(&aes, key, 128U + keysz * 64U);
+
+    for (i = 0UL; i < cnt; i += 16UL)
+    {
+        n = (cnt - i < 16UL) ? cnt - i : 16UL;
+        switch (opmode)
+        {
+        case AES_MODE_ECB:
+            mbedtls_aes_crypt_ecb(&aes, enc ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, &data[i], &data[i]);
+            break;
+
+        case AES_MODE_CBC:
+            if (enc)
+            {
+                for (n = 0UL; n < 16UL; n++)
+                    data[i + n] ^= fb[n];
+                mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, &data[i], &data[i]);
+                memcpy(fb, &data[i], 16);
+            }
+            else
+            {
+                memcpy(blk, &data[i], 16);
+                mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_DECRYPT, &data[i], &data[i]);
+                for (n = 0UL; n < 16UL; n++)
+                    data[i + n] ^= fb[n];
+                memcpy(fb, blk, 16);
+            }
+            break;
+
+        case AES_MODE_CFB:
+            mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, fb, blk);
+            if (!enc)
+                memcpy(fb, &data[i], 16);
+            for (n = 0UL; n < 16UL; n++)
+                data[i + n] ^= blk[n];
+            if (enc)
+                memcpy(fb, &data[i], 16);
+            break;
+
+        case AES_MODE_OFB:
+            mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, fb, fb);
+            for (n = 0UL; n < 16UL; n++)
+                data[i + n] ^= fb[n];
+            break;
+
+        default:    /* CTR */
+            mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, fb, blk);
+            while (n-- > 0UL)
+                data[i + n] ^= blk[n];
+            ctr_inc(fb, 16);
+            break;
+        }
+    }
+    mbedtls_aes_free(&aes);
+    _aes_fb_valid[ch] = 1;
+
+    for (i = 0UL; i < 4UL; i++)
+        __host_crpt.AES_FDBCK[i] = GET_BE32(&fb[i * 4UL]);
+
+    dma_write_at_end(en, "AES destination", *AES_CH(__host_crpt.AES0_DADDR, ch), cnt,
+                     (ctl & CRPT_AES_CTL_OUTSWAP_Msk) != 0UL);
+}
+
+/*----------------------------------------------------------------------------------------*/
+/*   TDES                                                                                 */
+/*----------------------------------------------------------------------------------------*/
+
+/*
+ *  ECB and CBC, the modes of the glue, with the data in memory byte order: INSWAP,
+ *  OUTSWAP and BLKSWAP set together, as des.c does. Keys and IV are in the registers as
+ *  big-endian words, high word first.
+ */
+static void  tdes_start(uint32_t ctl)
+{
+    ENGINE_T  *en = &_eng[CRPT_JOB_TDES];
+    mbedtls_des_context   des;
+    mbedtls_des3_context  des3;
+    uint32_t  ch, opmode, cnt, i, n;
+    int       enc, triple;
+    uint8_t   key[24], *fb, *data, blk[8];
+
+    ch = (ctl & CRPT_TDES_CTL_CHANNEL_Msk) >> CRPT_TDES_CTL_CHANNEL_Pos;
+    opmode = ctl & CRPT_TDES_CTL_OPMODE_Msk;
+    enc = (ctl & CRPT_TDES_CTL_ENCRPT_Msk) != 0UL;
+    triple = (ctl & CRPT_TDES_CTL_TMODE_Msk) != 0UL;
+    cnt = *TDES_CH(__host_crpt.TDES0_CNT, ch);
+
+    if (!(ctl & CRPT_TDES_CTL_DMAEN_Msk))
+        model_fault("TDES without DMA is not modelled");
+    if ((opmode != (TDES_MODE_ECB & CRPT_TDES_CTL_OPMODE_Msk)) &&
+            (opmode != (TDES_MODE_CBC & CRPT_TDES_CTL_OPMODE_Msk)))
+        model_fault("TDES mode 0x%x is not modelled", opmode);
+    if ((ctl & TDES_SWAP) != TDES_SWAP)
+        model_fault("TDES byte order 0x%08x is not modelled", ctl & TDES_SWAP);
+    if (cnt % 8UL)
+        model_fault("TDES transfer of %u bytes is not a multiple of the block", cnt);
+
+    /* KEY1H, KEY1L, KEY2H, KEY2L, KEY3H and KEY3L; two key TDES uses key 1 as key 3 */
+    for (i = 0UL; i < 6UL; i++)
+        PUT_BE32(&key[i * 4UL], TDES_CH(__host_crpt.TDES0_KEY1H, ch)[i]);
+    if (!(ctl & CRPT_TDES_CTL_3KEYS_Msk))
+        memcpy(&key[16], key, 8);
+    if (memcmp(key, _tdes_key[ch], triple ? 24 : 8))
+    {
+        memcpy(_tdes_key[ch], key, 24);
+        en->stat.u32KeyLoads++;
+    }
+
+    fb = _tdes_fb[ch];
+    if ((ctl & CRPT_TDES_CTL_DMACSCAD_Msk) && (opmode != (TDES_MODE_ECB & CRPT_TDES_CTL_OPMODE_Msk)))
+    {
+        if (!_tdes_fb_valid[ch])
+            model_fault("TDES channel %u cascades without a previous transfer", ch);
+    }
+    else
+    {
+        PUT_BE32(&fb[0], *TDES_CH(__host_crpt.TDES0_IVH, ch));
+        PUT_BE32(&fb[4], *TDES_CH(__host_crpt.TDES0_IVL, ch));
+    }
+
+    data = dma_read(en, "TDES source", *TDES_CH(__host_crpt.TDES0_SA, ch), cnt, 1);
+
+    mbedtls_des_init(&des);
+    mbedtls_des3_init(&des3);
+    if (triple && enc)
+        mbedtls_des3_set3key_enc(&des3, key);
+    else if (triple)
+        mbedtls_des3_set3key_dec(&des3, key);
+    else if (enc)
+        mbedtls_des_setkey_enc(&des, key);
+    else
+        mbedtls_des_setkey_dec(&des, key);
+
+    for (i = 0UL; i < cnt; i += 8UL)
+    {
+        if (opmode == (TDES_MODE_CBC & CRPT_TDES_CTL_OPMODE_Msk))
+        {
+            if (enc)
+            {
+                for (n = 0UL; n < 8UL; n++)
+                    data[i + n] ^= fb[n];
+            }
+            else
+            {
+                memcpy(blk, &data[i], 8);
+            }
+        }
+
+        if (triple)
+            mbedtls_des3_crypt_ecb(&des3, &data[i], &data[i]);
+        else
+            mbedtls_des_crypt_ecb(&des, &data[i], &data[i]);
+
+        if (opmode == (TDES_MODE_CBC & CRPT_TDES_CTL_OPMODE_Msk))
+        {
+            if (enc)
+            {
+                memcpy(fb, &data[i], 8);
+            }
+            else
+            {
+                for (n = 0UL; n < 8UL; n++)
+                    data[i + n] ^= fb[n];
+                memcpy(fb, blk, 8);
+            }
+        }
+    }
+    mbedtls_des_free(&des);
+    mbedtls_des3_free(&des3);
+    _tdes_fb_valid[ch] = 1;
+
+    __host_crpt.TDES_FDBCKH = GET_BE32(&fb[0]);
+    __host_crpt.TDES_FDBCKL = GET_BE32(&fb[4]);
+
+    dma_write_at_end(en, "TDES destination", *TDES_CH(__host_crpt.TDES0_DA, ch), cnt, 1);
+}
+
+/*----------------------------------------------------------------------------------------*/
+/*   SHA                                                                                  */
+/*----------------------------------------------------------------------------------------*/
+
+static const mbedtls_md_info_t * sha_md_info(uint32_t opmode)
+{
+    switch (opmode)
+    {
+    case SHA_MODE_SHA1:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
+    case SHA_MODE_SHA224:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA224);
+    case SHA_MODE_SHA256:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    case SHA_MODE_SHA384:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA384);
+    case SHA_MODE_SHA512:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA512);
+    default:
+        model_fault("SHA mode 0x%x", opmode);
+    }
+    return NULL;
+}
+
+static void  sha_update(uint32_t opmode, int first, const uint8_t *data, uint32_t len)
+{
+    switch (opmode)
+    {
+    case SHA_MODE_SHA1:
+        if (first)
+            mbedtls_sha1_starts_ret(&_sha.sha1);
+        mbedtls_sha1_update_ret(&_sha.sha1, data, len);
+        break;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        if (first)
+            mbedtls_sha256_starts_ret(&_sha.sha256, opmode == SHA_MODE_SHA224);
+        mbedtls_sha256_update_ret(&_sha.sha256, data, len);
+        break;
+    default:
+        if (first)
+            mbedtls_sha512_starts_ret(&_sha.sha512, opmode == SHA_MODE_SHA384);
+        mbedtls_sha512_update_ret(&_sha.sha512, data, len);
+        break;
+    }
+}
+
+static void  sha_finish(uint32_t opmode, uint8_t *dgst)
+{
+    switch (opmode)
+    {
+    case SHA_MODE_SHA1:
+        mbedtls_sha1_finish_ret(&_sha.sha1, dgst);
+        break;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        mbedtls_sha256_finish_ret(&_sha.sha256, dgst);
+        break;
+    default:
+        mbedtls_sha512_finish_ret(&_sha.sha512, dgst);
+        break;
+    }
+}
+
+/* HMAC_DGST after a transfer that leaves the cascade open: the running state */
+static void  sha_state(uint32_t opmode)
+{
+    uint32_t  i;
+
+    switch (opmode)
+    {
+    case SHA_MODE_SHA1:
+        memcpy(_sha_dgst, _sha.sha1.state, 5 * 4);
+        _sha_dgst_cnt = 5UL;
+        break;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        memcpy(_sha_dgst, _sha.sha256.state, 8 * 4);
+        _sha_dgst_cnt = 8UL;
+        break;
+    default:
+        for (i = 0UL; i < 8UL; i++)
+        {
+            _sha_dgst[2 * i] = (uint32_t)(_sha.sha512.state[i] >> 32);
+            _sha_dgst[2 * i + 1] = (uint32_t)_sha.sha512.state[i];
+        }
+        _sha_dgst_cnt = 16UL;
+        break;
+    }
+}
+
+/*
+ *  A transfer of the SHA engine hashes HMAC_DMACNT bytes at HMAC_SADDR. CRYPTO_DMA_FIRST
+ *  and CRYPTO_DMA_ONE_SHOT start a message, CRYPTO_DMA_CONTINUE and CRYPTO_DMA_LAST go on
+ *  with the open one; the transfers before the last must be whole blocks. HMAC_DGST holds
+ *  the running state after each transfer and the digest, in big endian words, after the
+ *  last. In HMAC mode the buffer starts with the HMAC_KEYCNT bytes of the key, padded to
+ *  a word, and is hashed in one shot.
+ */
+static void  sha_start(uint32_t ctl)
+{
+    ENGINE_T  *en = &_eng[CRPT_JOB_SHA];
+    const mbedtls_md_info_t  *md;
+    uint32_t  opmode, cnt, keycnt, i;
+    int       last, cscad;
+    uint8_t   *data, dgst[64];
+
+    opmode = (ctl & CRPT_HMAC_CTL_OPMODE_Msk) >> CRPT_HMAC_CTL_OPMODE_Pos;
+    last = (ctl & CRPT_HMAC_CTL_DMALAST_Msk) != 0UL;
+    cscad = (ctl & SHA_CTL_CSCAD) != 0UL;
+    cnt = __host_crpt.HMAC_DMACNT;
+    md = sha_md_info(opmode);
+
+    if (!(ctl & CRPT_HMAC_CTL_DMAEN_Msk))
+        model_fault("SHA without DMA is not modelled");
+    if (cnt == 0UL)
+        model_fault("SHA transfer of 0 bytes");
+    if (cscad && !_sha_open)
+        model_fault("SHA cascade continued without a first transfer");
+    if (!last && (cnt % ((opmode >= SHA_MODE_SHA512) ? 128UL : 64UL)))
+        model_fault("SHA transfer of %u bytes before the last is not a multiple of the block", cnt);
+
+    data = dma_read(en, "SHA source", __host_crpt.HMAC_SADDR, cnt,
+                    (ctl & CRPT_HMAC_CTL_INSWAP_Msk) != 0UL);
+
+    if (ctl & CRPT_HMAC_CTL_HMACEN_Msk)
+    {
+        keycnt = __host_crpt.HMAC_KEYCNT;
+        if (cscad || !last)
+            model_fault("HMAC in a DMA cascade is not modelled");
+        if (((keycnt + 3UL) & ~3UL) > cnt)
+            model_fault("HMAC key of %u bytes in a transfer of %u", keycnt, cnt);
+        mbedtls_md_hmac(md, data, keycnt, &data[(keycnt + 3UL) & ~3UL],
+                        cnt - ((keycnt + 3UL) & ~3UL), dgst);
+        _sha_open = 0;
+    }
+    else
+    {
+        sha_update(opmode, !cscad, data, cnt);
+        _sha_open = !last;
+        if (last)
+            sha_finish(opmode, dgst);
+        else
+            sha_state(opmode);
+    }
+
+    if (last)
+    {
+        _sha_dgst_cnt = mbedtls_md_get_size(md) / 4U;
+        for (i = 0UL; i < _sha_dgst_cnt; i++)
+            _sha_dgst[i] = GET_BE32(&dgst[i * 4UL]);
+    }
+    if (ctl & CRPT_HMAC_CTL_OUTSWAP_Msk)
+        swap_words((uint8_t *)_sha_dgst, _sha_dgst_cnt * 4UL);
+}
+
+static void  sha_end(int fail)
+{
+    uint32_t  i;
+
+    /* A failed transfer leaves HMAC_DGST alone and the message unfinished */
+    if (fail)
+    {
+        _sha_open = 0;
+        return;
+    }
+    for (i = 0UL; i < _sha_dgst_cnt; i++)
+        __host_crpt.HMAC_DGST[i] = _sha_dgst[i];
+}
+
+/*----------------------------------------------------------------------------------------*/
+/*   ECC                                                                                  */
+/*----------------------------------------------------------------------------------------*/
+
+#define ECC_CTL_ECCOP(ctl)   (((ctl) & CRPT_ECC_CTL_ECCOP_Msk) >> CRPT_ECC_CTL_ECCOP_Pos)
+#define ECC_CTL_MODOP(ctl)   (((ctl) & CRPT_ECC_CTL_MODOP_Msk) >> CRPT_ECC_CTL_MODOP_Pos)
+
+/* An affine point, or the point at infinity */
+typedef struct
+{
+    mbedtls_mpi  x, y;
+    int          inf;
+} ECC_PT_T;
+
+/* The 18 words of an ECC register, least significant first */
+static void  ecc_get(mbedtls_mpi *X, volatile uint32_t reg[18])
+{
+    uint8_t   buf[72];
+    uint32_t  i;
+
+    for (i = 0UL; i < 18UL; i++)
+        PUT_BE32(&buf[(17UL - i) * 4UL], reg[i]);
+    mbedtls_mpi_read_binary(X, buf, sizeof(buf));
+}
+
+static void  ecc_put(const mbedtls_mpi *X, uint32_t out[18])
+{
+    uint8_t   buf[72];
+    uint32_t  i;
+
+    if (mbedtls_mpi_write_binary(X, buf, sizeof(buf)) != 0)
+        model_fault("ECC result does not fit the registers");
+    for (i = 0UL; i < 18UL; i++)
+        out[i] = GET_BE32(&buf[(17UL - i) * 4UL]);
+}
+
+static void  ecc_pt_init(ECC_PT_T *P)
+{
+    mbedtls_mpi_init(&P->x);
+    mbedtls_mpi_init(&P->y);
+    P->inf = 1;
+}
+
+static void  ecc_pt_free(ECC_PT_T *P)
+{
+    mbedtls_mpi_free(&P->x);
+    mbedtls_mpi_free(&P->y);
+}
+
+static void  ecc_pt_copy(ECC_PT_T *R, const ECC_PT_T *P)
+{
+    mbedtls_mpi_copy(&R->x, &P->x);
+    mbedtls_mpi_copy(&R->y, &P->y);
+    R->inf = P->inf;
+}
+
+/* R = P + Q on y^2 = x^3 + ax + b over GF(p), R may be P or Q */
+static void  ecc_pt_add(ECC_PT_T *R, const ECC_PT_T *P, const ECC_PT_T *Q,
+                        const mbedtls_mpi *a, const mbedtls_mpi *p)
+{
+    mbedtls_mpi  l, t, x3, y3;
+
+    if (P->inf || Q->inf)
+    {
+        ecc_pt_copy(R, P->inf ? Q : P);
+        return;
+    }
+
+    mbedtls_mpi_init(&l);
+    mbedtls_mpi_init(&t);
+    mbedtls_mpi_init(&x3);
+    mbedtls_mpi_init(&y3);
+
+    if (mbedtls_mpi_cmp_mpi(&P->x, &Q->x) == 0)
+    {
+        if ((mbedtls_mpi_cmp_mpi(&P->y, &Q->y) != 0) || (mbedtls_mpi_cmp_int(&P->y, 0) == 0))
+        {
+            R->inf = 1;
+            goto cleanup;
+        }
+        /* l = (3x^2 + a) / 2y */
+        mbedtls_mpi_mul_mpi(&l, &P->x, &P->x);
+        mbedtls_mpi_mul_int(&l, &l, 3);
+        mbedtls_mpi_add_mpi(&l, &l, a);
+        mbedtls_mpi_add_mpi(&t, &P->y, &P->y);
+    }
+    else
+    {
+        /* l = (y2 - y1) / (x2 - x1) */
+        mbedtls_mpi_sub_mpi(&l, &Q->y, &P->y);
+        mbedtls_mpi_sub_mpi(&t, &Q->x, &P->x);
+    }
+    mbedtls_mpi_mod_mpi(&t, &t, p);
+    mbedtls_mpi_inv_mod(&t, &t, p);
+    mbedtls_mpi_mul_mpi(&l, &l, &t);
+    mbedtls_mpi_mod_mpi(&l, &l, p);
+
+    /* x3 = l^2 - x1 - x2, y3 = l(x1 - x3) - y1 */
+    mbedtls_mpi_mul_mpi(&x3, &l, &l);
+    mbedtls_mpi_sub_mpi(&x3, &x3, &P->x);
+    mbedtls_mpi_sub_mpi(&x3, &x3, &Q->x);
+    mbedtls_mpi_mod_mpi(&x3, &x3, p);
+    mbedtls_mpi_sub_mpi(&y3, &P->x, &x3);
+    mbedtls_mpi_mul_mpi(&y3, &y3, &l);
+    mbedtls_mpi_sub_mpi(&y3, &y3, &P->y);
+    mbedtls_mpi_mod_mpi(&y3, &y3, p);
+
+    mbedtls_mpi_copy(&R->x, &x3);
+    mbedtls_mpi_copy(&R->y, &y3);
+    R->inf = 0;
+
+cleanup:
+    mbedtls_mpi_free(&l);
+    mbedtls_mpi_free(&t);
+    mbedtls_mpi_free(&x3);
+    mbedtls_mpi_free(&y3);
+}
+
+/* Points the engine is given must lie on the curve of ECC_A, ECC_B and ECC_N */
+static void  ecc_pt_check(const char *what, const ECC_PT_T *P, const mbedtls_mpi *a,
+                          const mbedtls_mpi *b, const mbedtls_mpi *p)
+{
+    mbedtls_mpi  l, r;
+
+    mbedtls_mpi_init(&l);
+    mbedtls_mpi_init(&r);
+
+    /* y^2 against x^3 + ax + b */
+    mbedtls_mpi_mul_mpi(&l, &P->y, &P->y);
+    mbedtls_mpi_mod_mpi(&l, &l, p);
+    mbedtls_mpi_mul_mpi(&r, &P->x, &P->x);
+    mbedtls_mpi_add_mpi(&r, &r, a);
+    mbedtls_mpi_mul_mpi(&r, &r, &P->x);
+    mbedtls_mpi_add_mpi(&r, &r, b);
+    mbedtls_mpi_mod_mpi(&r, &r, p);
+    if (mbedtls_mpi_cmp_mpi(&l, &r) != 0)
+        model_fault("ECC point %s is not on the curve of ECC_A, ECC_B and ECC_N", what);
+
+    mbedtls_mpi_free(&l);
+    mbedtls_mpi_free(&r);
+}
+
+/* Jacobian coordinates (X, Y, Z) for x = X/Z^2, y = Y/Z^3, the point at infinity has Z = 0 */
+typedef struct
+{
+    mbedtls_mpi  X, Y, Z;
+} ECC_JPT_T;
+
+static void  mod_mul(mbedtls_mpi *R, const mbedtls_mpi *A, const mbedtls_mpi *B, const mbedtls_mpi *p)
+{
+    mbedtls_mpi_mul_mpi(R, A, B);
+    mbedtls_mpi_mod_mpi(R, R, p);
+}
+
+static void  mod_sub(mbedtls_mpi *R, const mbedtls_mpi *A, const mbedtls_mpi *B, const mbedtls_mpi *p)
+{
+    mbedtls_mpi_sub_mpi(R, A, B);
+    mbedtls_mpi_mod_mpi(R, R, p);
+}
+
+/* J = 2J */
+static void  ecc_jpt_double(ECC_JPT_T *J, const mbedtls_mpi *a, const mbedtls_mpi *p)
+{
+    mbedtls_mpi  S, M, T;
+
+    if (mbedtls_mpi_cmp_int(&J->Y, 0) == 0)
+    {
+        mbedtls_mpi_lset(&J->Z, 0);
+        return;
+    }
+
+    mbedtls_mpi_init(&S);
+    mbedtls_mpi_init(&M);
+    mbedtls_mpi_init(&T);
+
+    /* S = 4XY^2, M = 3X^2 + aZ^4 */
+    mod_mul(&T, &J->Y, &J->Y, p);
+    mod_mul(&S, &J->X, &T, p);
+    mbedtls_mpi_shift_l(&S, 2);
+    mbedtls_mpi_mod_mpi(&S, &S, p);
+    mod_mul(&M, &J->X, &J->X, p);
+    mbedtls_mpi_mul_int(&M, &M, 3);
+    mod_mul(&T, &J->Z, &J->Z, p);
+    mod_mul(&T, &T, &T, p);
+    mod_mul(&T, &T, a, p);
+    mbedtls_mpi_add_mpi(&M, &M, &T);
+    mbedtls_mpi_mod_mpi(&M, &M, p);
+
+    /* Z' = 2YZ, X' = M^2 - 2S, Y' = M(S - X') - 8Y^4 */
+    mod_mul(&J->Z, &J->Z, &J->Y, p);
+    mbedtls_mpi_shift_l(&J->Z, 1);
+    mbedtls_mpi_mod_mpi(&J->Z, &J->Z, p);
+    mod_mul(&T, &J->Y, &J->Y, p);
+    mod_mul(&T, &T, &T, p);
+    mbedtls_mpi_shift_l(&T, 3);
+    mod_mul(&J->X, &M, &M, p);
+    mod_sub(&J->X, &J->X, &S, p);
+    mod_sub(&J->X, &J->X, &S, p);
+    mod_sub(&J->Y, &S, &J->X, p);
+    mod_mul(&J->Y, &J->Y, &M, p);
+    mod_sub(&J->Y, &J->Y, &T, p);
+
+    mbedtls_mpi_free(&S);
+    mbedtls_mpi_free(&M);
+    mbedtls_mpi_free(&T);
+}
+
+/* J = J + P, P affine */
+static void  ecc_jpt_add(ECC_JPT_T *J, const ECC_PT_T *P, const mbedtls_mpi *a, const mbedtls_mpi *p)
+{
+    mbedtls_mpi  U2, S2, H, R, T;
+
+    if (P->inf)
+        return;
+    if (mbedtls_mpi_cmp_int(&J->Z, 0) == 0)
+    {
+        mbedtls_mpi_copy(&J->X, &P->x);
+        mbedtls_mpi_copy(&J->Y, &P->y);
+        mbedtls_mpi_lset(&J->Z, 1);
+        return;
+    }
+
+    mbedtls_mpi_init(&U2);
+    mbedtls_mpi_init(&S2);
+    mbedtls_mpi_init(&H);
+    mbedtls_mpi_init(&R);
+    mbedtls_mpi_init(&T);
+
+    /* H = x Z^2 - X, R = y Z^3 - Y */
+    mod_mul(&T, &J->Z, &J->Z, p);
+    mod_mul(&U2, &P->x, &T, p);
+    mod_mul(&T, &T, &J->Z, p);
+    mod_mul(&S2, &P->y, &T, p);
+    mod_sub(&H, &U2, &J->X, p);
+    mod_sub(&R, &S2, &J->Y, p);
+
+    if (mbedtls_mpi_cmp_int(&H, 0) == 0)
+    {
+        if (mbedtls_mpi_cmp_int(&R, 0) == 0)
+            ecc_jpt_double(J, a, p);
+        else
+            mbedtls_mpi_lset(&J->Z, 0);
+    }
+    else
+    {
+        /* X3 = R^2 - H^3 - 2XH^2, Y3 = R(XH^2 - X3) - YH^3, Z3 = ZH */
+        mod_mul(&J->Z, &J->Z, &H, p);
+        mod_mul(&T, &H, &H, p);
+        mod_mul(&U2, &J->X, &T, p);         /* XH^2 */
+        mod_mul(&T, &T, &H, p);             /* H^3 */
+        mod_mul(&S2, &J->Y, &T, p);         /* YH^3 */
+        mod_mul(&J->X, &R, &R, p);
+        mod_sub(&J->X, &J->X, &T, p);
+        mod_sub(&J->X, &J->X, &U2, p);
+        mod_sub(&J->X, &J->X, &U2, p);
+        mod_sub(&J->Y, &U2, &J->X, p);
+        mod_mul(&J->Y, &J->Y, &R, p);
+        mod_sub(&J->Y, &J->Y, &S2, p);
+    }
+
+    mbedtls_mpi_free(&U2);
+    mbedtls_mpi_free(&S2);
+    mbedtls_mpi_free(&H);
+    mbedtls_mpi_free(&R);
+    mbedtls_mpi_free(&T);
+}
+
+/* R = kP by double and add */
+static void  ecc_pt_mul(ECC_PT_T *R, const mbedtls_mpi *k, const ECC_PT_T *P,
+                        const mbedtls_mpi *a, const mbedtls_mpi *p)
+{
+    ECC_JPT_T    J;
+    mbedtls_mpi  T;
+    size_t       i;
+
+    mbedtls_mpi_init(&J.X);
+    mbedtls_mpi_init(&J.Y);
+    mbedtls_mpi_init(&J.Z);
+    mbedtls_mpi_init(&T);
+
+    for (i = mbedtls_mpi_bitlen(k); i > 0; i--)
+    {
+        if (mbedtls_mpi_cmp_int(&J.Z, 0) != 0)
+            ecc_jpt_double(&J, a, p);
+        if (mbedtls_mpi_get_bit(k, i - 1))
+            ecc_jpt_add(&J, P, a, p);
+    }
+
+    /* back to affine */
+    R->inf = (mbedtls_mpi_cmp_int(&J.Z, 0) == 0);
+    if (!R->inf)
+    {
+        mbedtls_mpi_inv_mod(&T, &J.Z, p);
+        mod_mul(&J.Z, &T, &T, p);
+        mod_mul(&R->x, &J.X, &J.Z, p);
+        mod_mul(&J.Z, &J.Z, &T, p);
+        mod_mul(&R->y, &J.Y, &J.Z, p);
+    }
+
+    mbedtls_mpi_free(&J.X);
+    mbedtls_mpi_free(&J.Y);
+    mbedtls_mpi_free(&J.Z);
+    mbedtls_mpi_free(&T);
+}
+
+/*
+ *  The engine works on the curve and modulus in ECC_A, ECC_B and ECC_N as it finds them at
+ *  START. Point operations leave the result in ECC_X1/ECC_Y1, the modular ones in ECC_X1:
+ *  X1 + Y1, X1 - Y1, X1 * Y1 or Y1 / X1, modulo N. Only GF(p) is modelled.
+ */
+static void  ecc_start(uint32_t ctl)
+{
+    CRPT_T       *c = &__host_crpt;
+    mbedtls_mpi  a, b, n, k, x, y;
+    ECC_PT_T     P, Q;
+
+    if (ctl & CRPT_ECC_CTL_DMAEN_Msk)
+        model_fault("ECC with DMA is not modelled");
+    if (!(ctl & CRPT_ECC_CTL_FSEL_Msk))
+        model_fault("ECC over GF(2^m) is not modelled");
+
+    mbedtls_mpi_init(&a);
+    mbedtls_mpi_init(&b);
+    mbedtls_mpi_init(&n);
+    mbedtls_mpi_init(&k);
+    mbedtls_mpi_init(&x);
+    mbedtls_mpi_init(&y);
+    ecc_pt_init(&P);
+    ecc_pt_init(&Q);
+
+    ecc_get(&a, c->ECC_A);
+    ecc_get(&b, c->ECC_B);
+    ecc_get(&n, c->ECC_N);
+    ecc_get(&P.x, c->ECC_X1);
+    ecc_get(&P.y, c->ECC_Y1);
+    P.inf = 0;
+    if (mbedtls_mpi_cmp_int(&n, 3) < 0)
+        model_fault("ECC_N is not a modulus");
+
+    switch (ECC_CTL_ECCOP(ctl))
+    {
+    case 0UL:       /* point multiplication */
+        ecc_get(&k, c->ECC_K);
+        ecc_pt_check("X1/Y1", &P, &a, &b, &n);
+        ecc_pt_mul(&P, &k, &P, &a, &n);
+        break;
+
+    case 2UL:       /* point addition */
+        ecc_get(&Q.x, c->ECC_X2);
+        ecc_get(&Q.y, c->ECC_Y2);
+        Q.inf = 0;
+        ecc_pt_check("X1/Y1", &P, &a, &b, &n);
+        ecc_pt_check("X2/Y2", &Q, &a, &b, &n);
+        ecc_pt_add(&P, &P, &Q, &a, &n);
+        break;
+
+    case 1UL:       /* modular operation */
+        mbedtls_mpi_copy(&x, &P.x);
+        mbedtls_mpi_copy(&y, &P.y);
+        switch (ECC_CTL_MODOP(ctl))
+        {
+        case 0UL:
+            if (mbedtls_mpi_inv_mod(&x, &x, &n) != 0)
+                model_fault("ECC modular division by a number without inverse");
+            mbedtls_mpi_mul_mpi(&x, &x, &y);
+            break;
+        case 1UL:
+            mbedtls_mpi_mul_mpi(&x, &x, &y);
+            break;
+        case 2UL:
+            mbedtls_mpi_add_mpi(&x, &x, &y);
+            break;
+        default:
+            mbedtls_mpi_sub_mpi(&x, &x, &y);
+            break;
+        }
+        mbedtls_mpi_mod_mpi(&P.x, &x, &n);
+        break;
+
+    default:
+        model_fault("ECC operation 0x%x", ECC_CTL_ECCOP(ctl));
+    }
+
+    if (P.inf)
+    {
+        mbedtls_mpi_lset(&P.x, 0);
+        mbedtls_mpi_lset(&P.y, 0);
+    }
+    ecc_put(&P.x, _ecc_x1);
+    ecc_put(&P.y, _ecc_y1);
+
+    mbedtls_mpi_free(&a);
+    mbedtls_mpi_free(&b);
+    mbedtls_mpi_free(&n);
+    mbedtls_mpi_free(&k);
+    mbedtls_mpi_free(&x);
+    mbedtls_mpi_free(&y);
+    ecc_pt_free(&P);
+    ecc_pt_free(&Q);
+}
+
+static void  ecc_end(int fail)
+{
+    uint32_t  i;
+
+    if (fail)
+        return;
+    for (i = 0UL; i < 18UL; i++)
+    {
+        __host_crpt.ECC_X1[i] = _ecc_x1[i];
+        __host_crpt.ECC_Y1[i] = _ecc_y1[i];
+    }
+}
+
+/*----------------------------------------------------------------------------------------*/
+/*   Engines                                                                              */
+/*----------------------------------------------------------------------------------------*/
+
+static uint64_t  model_now_ns(void)
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void  model_sleep_until(uint64_t ns)
+{
+    struct timespec  ts;
+
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+    {
+    }
+}
+
+static void  eng_end(int e)
+{
+    ENGINE_T  *en = &_eng[e];
+
+    dma_check_source(en, _eng_reg[e].name);
+    if (en->kbps != 0UL)
+        en->stat.u64BusyNs += en->end_ns - en->start_ns;
+
+    if (en->fail)
+    {
+        en->stat.u32Failed++;
+        en->out_len = 0UL;
+    }
+    else
+    {
+        dma_flush(en);
+    }
+
+    if (e == CRPT_JOB_SHA)
+        sha_end(en->fail);
+    else if (e == CRPT_JOB_ECC)
+        ecc_end(en->fail);
+
+    en->busy = 0;
+    *_eng_reg[e].ctl &= ~CTL_START;
+    *_eng_reg[e].sts &= ~_eng_reg[e].sts_busy;
+    if (en->fail)
+        *_eng_reg[e].sts |= _eng_reg[e].sts_err;
+    __host_crpt.INTSTS |= en->fail ? _eng_reg[e].eif_msk : _eng_reg[e].if_msk;
+}
+
+static void  eng_start(int e, uint32_t ctl)
+{
+    ENGINE_T  *en = &_eng[e];
+
+    en->stat.u32Ops++;
+    en->fail = 0;
+    if (en->fail_skip == 0)
+        en->fail = 1;
+    if (en->fail_skip >= 0)
+        en->fail_skip--;
+    en->in_len = 0UL;
+
+    switch (e)
+    {
+    case CRPT_JOB_AES:
+        aes_start(ctl);
+        break;
+    case CRPT_JOB_TDES:
+        tdes_start(ctl);
+        break;
+    case CRPT_JOB_SHA:
+        sha_start(ctl);
+        break;
+    case CRPT_JOB_ECC:
+        ecc_start(ctl);
+        break;
+    default:
+        model_fault("the %s engine is not modelled", _eng_reg[e].name);
+    }
+
+    en->busy = 1;
+    *_eng_reg[e].sts &= ~_eng_reg[e].sts_err;
+    *_eng_reg[e].sts |= _eng_reg[e].sts_busy;
+
+    /* A rate-timed operation takes the time of its DMA input, one without ends at once */
+    if (en->kbps != 0UL)
+    {
+        en->start_ns = model_now_ns();
+        en->end_ns = en->start_ns + (uint64_t)en->in_len * 1000000ULL / en->kbps;
+        if (en->end_ns == en->start_ns)
+            eng_end(e);
+        return;
+    }
+
+    en->left = en->latency;
+    if (en->left == 0UL)
+        eng_end(e);
+}
+
+static void  ctl_write(int e, uint32_t old, uint32_t val)
+{
+    ENGINE_T  *en = &_eng[e];
+
+    if (val & CTL_STOP)
+    {
+        /* The running operation is abandoned, its output is not written */
+        if (en->busy)
+        {
+            en->busy = 0;
+            en->out_len = 0UL;
+            en->in_len = 0UL;
+            *_eng_reg[e].sts &= ~_eng_reg[e].sts_busy;
+        }
+        if (e == CRPT_JOB_SHA)
+            _sha_open = 0;
+        *_eng_reg[e].ctl = val & ~(CTL_STOP | CTL_START);
+        return;
+    }
+
+    if (en->busy)
+    {
+        model_fault("%s_CTL written with 0x%08x while the engine is busy", _eng_reg[e].name, val);
+    }
+
+    if (val & CTL_START)
+        eng_start(e, val);
+}
+
+/* Engine of the register <reg>, -1 for the shared ones */
+static int  reg_engine(const uint32_t *reg)
+{
+    CRPT_T  *c = &__host_crpt;
+
+    if ((reg >= (uint32_t *)&c->AES_CTL) && (reg < (uint32_t *)&c->TDES_CTL))
+        return CRPT_JOB_AES;
+    if ((reg >= (uint32_t *)&c->TDES_CTL) && (reg < (uint32_t *)&c->HMAC_CTL))
+        return CRPT_JOB_TDES;
+    if ((reg >= (uint32_t *)&c->HMAC_CTL) && (reg <= (uint32_t *)&c->HMAC_DATIN))
+        return CRPT_JOB_SHA;
+    if (reg >= (uint32_t *)&c->ECC_CTL)
+        return CRPT_JOB_ECC;
+    return -1;
+}
+
+/* Apply the write of <reg>, which held <old> */
+static void  reg_write(uint32_t *reg, uint32_t old)
+{
+    CRPT_T    *c = &__host_crpt;
+    uint32_t  val = *reg;
+    int       e;
+
+    _idle_polls = 0UL;
+
+    /* Jobs queued under the lock are started from the interrupt */
+    e = reg_engine(reg);
+    if (_lock_check && !_in_irq && (e >= 0) && (_lock_depth[e] == 0UL))
+        model_fault("%s register at offset 0x%03x written without CRPT_JobLock()", _eng_reg[e].name,
+                    (unsigned)((uint8_t *)reg - (uint8_t *)c));
+
+    if (reg == &c->INTSTS)
+    {
+        c->INTSTS = old & ~val;
+        return;
+    }
+
+    /* read-only */
+    if (IN_REGS(reg, c->AES_FDBCK) || (reg == &c->TDES_FDBCKH) || (reg == &c->TDES_FDBCKL) ||
+        IN_REGS(reg, c->HMAC_DGST) || (reg == &c->AES_DATOUT) || (reg == &c->TDES_DATOUT))
+    {
+        *reg = old;
+        return;
+    }
+
+    for (e = 0; e < (int)ENG_CNT; e++)
+    {
+        if (reg == _eng_reg[e].sts)
+        {
+            *reg = old;
+            return;
+        }
+        if (reg == _eng_reg[e].ctl)
+        {
+            ctl_write(e, old, val);
+            return;
+        }
+    }
+}
+
+static void  reg_commit(void)
+{
+    uint32_t  *reg = _wr_reg;
+
+    if (reg == NULL)
+        return;
+    _wr_reg = NULL;
+    reg_write(reg, _wr_old);
+    model_irq();
+}
+
+/* A register poll of the CPU, the running operations advance by one */
+static void  model_poll(void)
+{
+    int   e, busy = 0;
+
+    _polls++;
+    for (e = 0; e < (int)ENG_CNT; e++)
+    {
+        if (!_eng[e].busy)
+            continue;
+        busy = 1;
+        if (_eng[e].kbps != 0UL)
+        {
+            if (model_now_ns() >= _eng[e].end_ns)
+                eng_end(e);
+        }
+        else if (--_eng[e].left == 0UL)
+        {
+            eng_end(e);
+        }
+    }
+
+    if (busy)
+        _idle_polls = 0UL;
+    else if (++_idle_polls > IDLE_POLL_MAX)
+        model_fault("the CPU polls with all engines idle, INTSTS 0x%08x INTEN 0x%08x",
+                    __host_crpt.INTSTS, __host_crpt.INTEN);
+
+    model_irq();
+}
+
+/* Run CRYPTO_IRQHandler() while an enabled flag is raised and the interrupt not masked */
+static void  model_irq(void)
+{
+    int   n;
+
+    if (!_irq_en || _in_irq || __host_primask)
+        return;
+    _in_irq = 1;
+    for (n = 0; (__host_crpt.INTSTS & __host_crpt.INTEN) != 0UL; n++)
+    {
+        if (n == IRQ_LOOP_MAX)
+            model_fault("CRYPTO_IRQHandler() leaves INTSTS 0x%08x raised", __host_crpt.INTSTS);
+        _irqs++;
+        CRYPTO_IRQHandler();
+        reg_commit();
+    }
+    _in_irq = 0;
+}
+
+#pragma GCC visibility push(default)
+
+void  __tsan_volatile_write4(void *addr)
+{
+    reg_commit();
+    if (IN_REGS(addr, __host_crpt))
+    {
+        _wr_reg = (uint32_t *)addr;
+        _wr_old = *(uint32_t *)addr;
+    }
+}
+
+void  __tsan_volatile_read4(void *addr)
+{
+    reg_commit();
+    if (addr == &__host_dwt.CYCCNT)
+        __host_dwt.CYCCNT = _polls;
+    model_poll();
+}
+
+void  __tsan_volatile_write1(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_write2(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_write8(void *addr)
+{
+    reg_commit();
+}
+
+void  __tsan_volatile_read1(void *addr)
+{
+    reg_commit();
+    model_poll();
+}
+
+void  __tsan_volatile_read2(void *addr)
+{
+    reg_commit();
+    model_poll();
+}
+
+void  __tsan_volatile_read8(void *addr)
+{
+    reg_commit();
+    model_poll();
+}
+
+/* the plain accesses are not of interest */
+void  __tsan_init(void) {}
+void  __tsan_read1(void *addr) {}
+void  __tsan_read2(void *addr) {}
+void  __tsan_read4(void *addr) {}
+void  __tsan_read8(void *addr) {}
+void  __tsan_read16(void *addr) {}
+void  __tsan_write1(void *addr) {}
+void  __tsan_write2(void *addr) {}
+void  __tsan_write4(void *addr) {}
+void  __tsan_write8(void *addr) {}
+void  __tsan_write16(void *addr) {}
+void  __tsan_unaligned_read2(void *addr) {}
+void  __tsan_unaligned_read4(void *addr) {}
+void  __tsan_unaligned_read8(void *addr) {}
+void  __tsan_unaligned_write2(void *addr) {}
+void  __tsan_unaligned_write4(void *addr) {}
+void  __tsan_unaligned_write8(void *addr) {}
+void  __tsan_read_range(void *addr, unsigned long size) {}
+void  __tsan_write_range(void *addr, unsigned long size) {}
+void  __tsan_func_entry(void *pc) {}
+void  __tsan_func_exit(void) {}
+void  __tsan_atomic_thread_fence(int mo) {}
+
+#pragma GCC visibility pop
+
+void  __host_irq_unmask(void)
+{
+    reg_commit();
+    model_irq();
+}
+
+void  NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    reg_commit();
+    _irq_en = 1UL;
+    model_irq();
+}
+
+void  NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    reg_commit();
+    _irq_en = 0UL;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Control and statistics                                                               */
+/*----------------------------------------------------------------------------------------*/
+
+/**
+  * @brief    Let the operations of an engine end after a number of register polls.
+  * @param[in]  u32Engine  CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC
+  * @param[in]  u32Polls   Polls, 0 to end them at START
+  */
+void  crpt_model_set_latency(uint32_t u32Engine, uint32_t u32Polls)
+{
+    _eng[u32Engine].latency = u32Polls;
+}
+
+/**
+  * @brief    Let the operations of an engine take the time of their DMA input at a rate,
+  *           in CLOCK_MONOTONIC time instead of register polls.
+  * @param[in]  u32Engine  CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC
+  * @param[in]  u32KBps    Kilobytes per second, 0 to count polls again
+  */
+void  crpt_model_set_rate(uint32_t u32Engine, uint32_t u32KBps)
+{
+    _eng[u32Engine].kbps = u32KBps;
+}
+
+/* Earliest end of the running rate-timed operations, 0 if there is none */
+static uint64_t  model_next_end(void)
+{
+    uint64_t  next = 0ULL;
+    int   e;
+
+    for (e = 0; e < (int)ENG_CNT; e++)
+    {
+        if (_eng[e].busy && (_eng[e].kbps != 0UL) && ((next == 0ULL) || (_eng[e].end_ns < next)))
+            next = _eng[e].end_ns;
+    }
+    return next;
+}
+
+/* End the rate-timed operations that are due and run their interrupt */
+static void  model_end_due(void)
+{
+    uint64_t  now = model_now_ns();
+    int   e;
+
+    for (e = 0; e < (int)ENG_CNT; e++)
+    {
+        if (_eng[e].busy && (_eng[e].kbps != 0UL) && (now >= _eng[e].end_ns))
+            eng_end(e);
+    }
+    model_irq();
+}
+
+/**
+  * @brief    The CPU is busy with something else, e.g. a transfer of another peripheral,
+  *           until CLOCK_MONOTONIC time u64Ns. Rate-timed operations that are due meanwhile
+  *           end on time and their interrupt runs then, so that queued jobs start.
+  * @param[in]  u64Ns  Nanoseconds of CLOCK_MONOTONIC
+  */
+void  crpt_model_sleep_until(uint64_t u64Ns)
+{
+    uint64_t  next;
+
+    reg_commit();
+    for (next = model_next_end(); (next != 0ULL) && (next <= u64Ns); next = model_next_end())
+    {
+        model_sleep_until(next);
+        model_end_due();
+    }
+    model_sleep_until(u64Ns);
+}
+
+/**
+  * @brief    The CPU waits for an interrupt: until the next rate-timed operation ends, or
+  *           for one register poll if none is running.
+  */
+void  crpt_model_wfi(void)
+{
+    uint64_t  next;
+
+    reg_commit();
+    next = model_next_end();
+    if (next == 0ULL)
+    {
+        model_poll();
+        return;
+    }
+    model_sleep_until(next);
+    model_end_due();
+}
+
+/**
+  * @brief    Let an operation of an engine end with its error flag.
+  * @param[in]  u32Engine  CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC
+  * @param[in]  u32Skip    Operations to run normally before the one that fails
+  */
+void  crpt_model_fail(uint32_t u32Engine, uint32_t u32Skip)
+{
+    _eng[u32Engine].fail_skip = (int32_t)u32Skip;
+}
+
+void  crpt_model_stat(uint32_t u32Engine, CRPT_MODEL_STAT_T *pStat)
+{
+    *pStat = _eng[u32Engine].stat;
+}
+
+void  crpt_model_clear_stat(void)
+{
+    int   e;
+
+    for (e = 0; e < (int)ENG_CNT; e++)
+        memset(&_eng[e].stat, 0, sizeof(_eng[e].stat));
+}
+
+uint32_t  crpt_model_irqs(void)
+{
+    return _irqs;
+}
+
+/**
+  * @brief    CRPT_JobLock() hook of the tests, installed by crpt_test_init().
+  * @param[in]  u32Engine  CRPT_JOB_AES, CRPT_JOB_TDES, CRPT_JOB_SHA or CRPT_JOB_ECC
+  */
+void  crpt_model_lock(uint32_t u32Engine)
+{
+    reg_commit();
+    if (u32Engine >= ENG_CNT)
+        model_fault("CRPT_JobLock() of engine %u", u32Engine);
+    if (_in_irq)
+        model_fault("CRPT_JobLock() of the %s engine from the CRYPTO interrupt", _eng_reg[u32Engine].name);
+    _lock_depth[u32Engine]++;
+}
+
+void  crpt_model_unlock(uint32_t u32Engine)
+{
+    reg_commit();
+    if ((u32Engine >= ENG_CNT) || (_lock_depth[u32Engine] == 0UL))
+        model_fault("CRPT_JobUnlock() of engine %u, which is not locked", u32Engine);
+    _lock_depth[u32Engine]--;
+}
+
+/**
+  * @brief    Require every write to the registers of an engine to be made with the engine
+  *           locked, except the job starts of the CRYPTO interrupt.
+  * @param[in]  iEnable  1 to check, 0 not to
+  */
+void  crpt_model_check_lock(int iEnable)
+{
+    reg_commit();
+    _lock_check = iEnable;
+}
+
+/* CRPT_JobLock() nesting of an engine */
+uint32_t  crpt_model_lock_depth(uint32_t u32Engine)
+{
+    return _lock_depth[u32Engine];
+}
+
+static void  model_reset(void)
+{
+    int   e;
+
+    memset(&__host_crpt, 0, sizeof(__host_crpt));
+    for (e = 0; e < (int)ENG_CNT; e++)
+    {
+        free(_eng[e].out);
+        free(_eng[e].in);
+        memset(&_eng[e], 0, sizeof(_eng[e]));
+        _eng[e].fail_skip = -1;
+    }
+    memset(_aes_fb_valid, 0, sizeof(_aes_fb_valid));
+    memset(_aes_key, 0, sizeof(_aes_key));
+    memset(_tdes_fb_valid, 0, sizeof(_tdes_fb_valid));
+    memset(_tdes_key, 0, sizeof(_tdes_key));
+    _sha_open = 0;
+    memset(_lock_depth, 0, sizeof(_lock_depth));
+    _lock_check = 0;
+    _wr_reg = NULL;
+    _irq_en = 0UL;
+    _in_irq = 0;
+    _irqs = 0UL;
+    _polls = 0UL;
+    _idle_polls = 0UL;
+    __host_primask = 0UL;
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Software reference                                                                   */
+/*----------------------------------------------------------------------------------------*/
+
+void  ref_aes_crypt(uint32_t u32OpMode, int enc, const uint8_t *key, uint32_t u32KeyBits,
+                    uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t len)
+{
+    mbedtls_aes_context  aes;
+    unsigned char  stream[16];
+    size_t   off = 0;
+    int      mode = enc ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT;
+
+    mbedtls_aes_init(&aes);
+    if (enc || (u32OpMode == AES_MODE_CFB) || (u32OpMode == AES_MODE_CTR))
+        mbedtls_aes_setkey_enc(&aes, key, u32KeyBits);
+    else
+        mbedtls_aes_setkey_dec(&aes, key, u32KeyBits);
+
+    switch (u32OpMode)
+    {
+    case AES_MODE_ECB:
+        for (off = 0; off < len; off += 16)
+            mbedtls_aes_crypt_ecb(&aes, mode, &in[off], &out[off]);
+        break;
+    case AES_MODE_CBC:
+        mbedtls_aes_crypt_cbc(&aes, mode, len, iv, in, out);
+        break;
+    case AES_MODE_CFB:
+        mbedtls_aes_crypt_cfb128(&aes, mode, len, &off, iv, in, out);
+        break;
+    case AES_MODE_CTR:
+        mbedtls_aes_crypt_ctr(&aes, len, &off, iv, stream, in, out);
+        break;
+    default:
+        model_fault("reference AES mode 0x%x", u32OpMode);
+    }
+    mbedtls_aes_free(&aes);
+}
+
+void  ref_des_crypt(uint32_t u32OpMode, int enc, const uint8_t *key, uint32_t u32KeyLen,
+                    uint8_t iv[8], const uint8_t *in, uint8_t *out, size_t len)
+{
+    mbedtls_des_context   des;
+    mbedtls_des3_context  des3;
+    size_t   off;
+
+    mbedtls_des_init(&des);
+    mbedtls_des3_init(&des3);
+    switch (u32KeyLen)
+    {
+    case 8:
+        if (enc)
+            mbedtls_des_setkey_enc(&des, key);
+        else
+            mbedtls_des_setkey_dec(&des, key);
+        break;
+    case 16:
+        if (enc)
+            mbedtls_des3_set2key_enc(&des3, key);
+        else
+            mbedtls_des3_set2key_dec(&des3, key);
+        break;
+    default:
+        if (enc)
+            mbedtls_des3_set3key_enc(&des3, key);
+        else
+            mbedtls_des3_set3key_dec(&des3, key);
+        break;
+    }
+
+    if (u32OpMode == TDES_MODE_CBC)
+    {
+        if (u32KeyLen == 8)
+            mbedtls_des_crypt_cbc(&des, enc ? MBEDTLS_DES_ENCRYPT : MBEDTLS_DES_DECRYPT, len, iv, in, out);
+        else
+            mbedtls_des3_crypt_cbc(&des3, enc ? MBEDTLS_DES_ENCRYPT : MBEDTLS_DES_DECRYPT, len, iv, in, out);
+    }
+    else
+    {
+        for (off = 0; off < len; off += 8)
+        {
+            if (u32KeyLen == 8)
+                mbedtls_des_crypt_ecb(&des, &in[off], &out[off]);
+            else
+                mbedtls_des3_crypt_ecb(&des3, &in[off], &out[off]);
+        }
+    }
+    mbedtls_des_free(&des);
+    mbedtls_des3_free(&des3);
+}
+
+void  ref_sha(uint32_t u32OpMode, const uint8_t *in, size_t len, uint8_t *out)
+{
+    mbedtls_md(sha_md_info(u32OpMode), in, len, out);
+}
+
+void  ref_hmac(uint32_t u32OpMode, const uint8_t *key, size_t keylen,
+               const uint8_t *in, size_t len, uint8_t *out)
+{
+    mbedtls_md_hmac(sha_md_info(u32OpMode), key, keylen, in, len, out);
+}
+
+void  ref_gcm(int enc, const uint8_t *key, uint32_t u32KeyBits, const uint8_t *iv, size_t ivlen,
+              const uint8_t *add, size_t addlen, uint32_t u32Ctr,
+              const uint8_t *in, uint8_t *out, size_t len, uint8_t tag[16])
+{
+    mbedtls_gcm_context  gcm;
+
+    mbedtls_gcm_init(&gcm);
+    mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, u32KeyBits);
+    mbedtls_gcm_starts(&gcm, enc ? MBEDTLS_GCM_ENCRYPT : MBEDTLS_GCM_DECRYPT, iv, ivlen, add, addlen);
+    if (u32Ctr != 0UL)
+    {
+        gcm.y[12] = (uint8_t)(u32Ctr >> 24);
+        gcm.y[13] = (uint8_t)(u32Ctr >> 16);
+        gcm.y[14] = (uint8_t)(u32Ctr >> 8);
+        gcm.y[15] = (uint8_t)u32Ctr;
+    }
+    mbedtls_gcm_update(&gcm, len, in, out);
+    mbedtls_gcm_finish(&gcm, tag, 16);
+    mbedtls_gcm_free(&gcm);
+}
+
+
+/*----------------------------------------------------------------------------------------*/
+/*   Runner                                                                               */
+/*----------------------------------------------------------------------------------------*/
+
+static uint8_t     _model_stack[1024 * 1024] __attribute__((aligned(16)));
+static ucontext_t  _main_ctx, _model_ctx;
+
+/**
+  * @brief    Reset the model and run <body> on a stack the driver can address with 32 bits.
+  * @param[in]  body   The test
+  * @return   0, or -1 if the test could not be started.
+  */
+int  crpt_model_run(void (*body)(void))
+{
+    int   e;
+
+    mallopt(M_MMAP_MAX, 0);                 /* keep the heap below 4 GB, in the brk area  */
+
+    if ((uintptr_t)(_model_stack + sizeof(_model_stack)) > 0xFFFFFFFFUL)
+    {
+        printf("crpt_model_run - link with -no-pie!\n");
+        return -1;
+    }
+
+    model_reset();
+
+    getcontext(&_model_ctx);
+    _model_ctx.uc_stack.ss_sp = _model_stack;
+    _model_ctx.uc_stack.ss_size = sizeof(_model_stack);
+    _model_ctx.uc_link = &_main_ctx;
+    makecontext(&_model_ctx, body, 0);
+    swapcontext(&_main_ctx, &_model_ctx);
+    reg_commit();
+
+    for (e = 0; e < (int)ENG_CNT; e++)
+    {
+        if (_lock_depth[e] != 0UL)
+            model_fault("the test ends with the %s engine locked", _eng_reg[e].name);
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+/**************************************************************************//**
+ * @file     crpt_model.h
+ * @version  V1.00
+ * @brief    Register model of the M480 CRPT engines for the Linux build of
+ *           the CRYPTO driver and the mbedtls hardware glue.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef _CRPT_MODEL_H_
+#define _CRPT_MODEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* crpt_model.c is built with hidden symbols */
+#pragma GCC visibility push(default)
+
+/*
+ *  crpt_model.c models the CRPT register file at register level: a write of START to an
+ *  engine control register runs the operation on the DMA buffers and registers the way
+ *  the engine does, with the software reference of mbedtls, then raises the done flag and
+ *  the CRYPTO interrupt. An operation ends at once, or after a number of register polls
+ *  set by crpt_model_set_latency(), so that jobs can queue up behind it. An engine given a
+ *  rate by crpt_model_set_rate() takes the CLOCK_MONOTONIC time of its DMA input instead;
+ *  the CPU spends time elsewhere with crpt_model_sleep_until() and crpt_model_wfi().
+ *
+ *  The model is strict where the hardware is: DMA addresses must be word aligned, a
+ *  cascaded transfer continues the feedback register of the previous transfer of the same
+ *  channel, START is not written while the engine is busy, the DMA source is left alone
+ *  until the operation has ended, a SHA cascade is opened before it is continued. It also
+ *  requires the points of an ECC operation to lie on the curve in ECC_A, ECC_B and ECC_N,
+ *  which catches stale curve registers. A violation, or the CPU waiting for an engine that
+ *  has nothing to do, ends the test with a message.
+ *
+ *  The driver and glue objects are built with -fsanitize=thread, but linked without the
+ *  TSan runtime: their volatile accesses call the __tsan_volatile_* hooks of the model.
+ *  All addresses must fit in 32 bits, the program is linked with -no-pie and
+ *  crpt_model_run() moves malloc() off mmap() and runs the test on a static stack.
+ *
+ *  The test provides CRYPTO_IRQHandler() and enables it with NVIC_EnableIRQ(CRPT_IRQn)
+ *  and the xxx_ENABLE_INT() macros, as on the board.
+ */
+
+typedef struct
+{
+    uint32_t  u32Ops;               /* operations started                              */
+    uint32_t  u32Failed;            /* operations that ended with the error flag       */
+    uint32_t  u32KeyLoads;          /* operations started with other keys than the previous one */
+    uint64_t  u64Bytes;             /* bytes read by DMA                               */
+    uint64_t  u64BusyNs;            /* time the operations of a rate-timed engine took */
+} CRPT_MODEL_STAT_T;
+
+/**
+  * @brief    Reset the model and run <body> on a stack the driver can address with 32 bits.
+  * @param[in]  body   The test
+  * @return   0, or -1 if the test could not be started.
+  */
+int       crpt_model_run(void (*body)(void));
+
+/* Operations of engine u32Engine (CRPT_JOB_xxx) end after u32Polls register polls, 0 at once */
+void      crpt_model_set_latency(uint32_t u32Engine, uint32_t u32Polls);
+
+/* Operations of engine u32Engine take their DMA input at u32KBps kilobytes per second of
+   CLOCK_MONOTONIC time, 0 to count polls again */
+void      crpt_model_set_rate(uint32_t u32Engine, uint32_t u32KBps);
+
+/* The CPU is elsewhere until CLOCK_MONOTONIC time u64Ns, rate-timed operations due
+   meanwhile end on time with their interrupt */
+void      crpt_model_sleep_until(uint64_t u64Ns);
+
+/* The CPU waits for the next rate-timed operation to end, or polls once if none runs */
+void      crpt_model_wfi(void);
+
+/* The operation of engine u32Engine after the next u32Skip ones ends with the error flag */
+void      crpt_model_fail(uint32_t u32Engine, uint32_t u32Skip);
+
+void      crpt_model_stat(uint32_t u32Engine, CRPT_MODEL_STAT_T *pStat);
+void      crpt_model_clear_stat(void);
+
+/* CRYPTO_IRQHandler() calls since crpt_model_run() */
+uint32_t  crpt_model_irqs(void);
+
+/*
+ *  Engine locks. crpt_test_init() installs these with CRPT_JobSetLock(). They count the
+ *  nesting of each engine, which must be back at 0 when the test ends. With checking on,
+ *  a write to an engine register outside the CRYPTO interrupt ends the test unless the
+ *  engine is locked.
+ */
+void      crpt_model_lock(uint32_t u32Engine);
+void      crpt_model_unlock(uint32_t u32Engine);
+void      crpt_model_check_lock(int iEnable);
+uint32_t  crpt_model_lock_depth(uint32_t u32Engine);
+
+/*
+ *  Software reference, mbedtls built without the hardware glue.
+ */
+
+/* AES_MODE_ECB, AES_MODE_CBC, AES_MODE_CFB or AES_MODE_CTR over len bytes; iv[] is updated */
+void      ref_aes_crypt(uint32_t u32OpMode, int enc, const uint8_t *key, uint32_t u32KeyBits,
+                        uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t len);
+
+/* TDES_MODE_ECB or TDES_MODE_CBC over len bytes with a DES (8), two key (16) or three key
+   (24) TDES key; iv[] is updated */
+void      ref_des_crypt(uint32_t u32OpMode, int enc, const uint8_t *key, uint32_t u32KeyLen,
+                        uint8_t iv[8], const uint8_t *in, uint8_t *out, size_t len);
+
+/* Digest of SHA_MODE_xxx over len bytes */
+void      ref_sha(uint32_t u32OpMode, const uint8_t *in, size_t len, uint8_t *out);
+
+/* HMAC with SHA_MODE_xxx */
+void      ref_hmac(uint32_t u32OpMode, const uint8_t *key, size_t keylen,
+                   const uint8_t *in, size_t len, uint8_t *out);
+
+/* AES-GCM over len bytes with a 16 byte tag; u32Ctr, if not 0, replaces the low word of the
+   counter after mbedtls_gcm_starts() */
+void      ref_gcm(int enc, const uint8_t *key, uint32_t u32KeyBits, const uint8_t *iv, size_t ivlen,
+                  const uint8_t *add, size_t addlen, uint32_t u32Ctr,
+                  const uint8_t *in, uint8_t *out, size_t len, uint8_t tag[16]);
+
+#pragma GCC visibility pop
+
+#endif /* _CRPT_MODEL_H_ */
@@ -0,0 +1,380 @@
+/**************************************************************************//**
+ * @file     des_test.c
+ * @version  V1.00
+ * @brief    Host test of the DES and TDES glue of des.c on the register model.
+ *
+ *           Runs the test_suit_des vectors with aligned and unaligned buffers,
+ *           checks bulk ECB and CBC data of DES, two key and three key TDES at
+ *           every alignment against the software reference, carries IVs
+ *           across calls while more contexts than key channels evict each
+ *           other's keys, and checks that engine errors are returned.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "mbedtls/des.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define BULK_LEN        256                     /* 16 bounce buffers of 16 bytes          */
+#define CTX_NUM         6                       /* more than the 4 key channels           */
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+static uint8_t  _src[BULK_LEN + 8] __attribute__((aligned(4)));
+static uint8_t  _dst[BULK_LEN + 8] __attribute__((aligned(4)));
+static uint8_t  _ref[BULK_LEN + 8];
+
+/* A DES or a TDES context, by the key length of 8, 16 or 24 bytes */
+typedef struct
+{
+    int                   keylen;
+    mbedtls_des_context   des;
+    mbedtls_des3_context  des3;
+} DES_CTX_T;
+
+static void  fill(uint8_t *buf, int len, uint32_t seed)
+{
+    while (len-- > 0)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        *buf++ = (uint8_t)(seed >> 16);
+    }
+}
+
+static void  ctx_init(DES_CTX_T *ctx, const uint8_t *key, int keylen, int enc)
+{
+    ctx->keylen = keylen;
+    mbedtls_des_init(&ctx->des);
+    mbedtls_des3_init(&ctx->des3);
+    switch (keylen)
+    {
+    case 8:
+        if (enc)
+            mbedtls_des_setkey_enc(&ctx->des, key);
+        else
+            mbedtls_des_setkey_dec(&ctx->des, key);
+        break;
+    case 16:
+        if (enc)
+            mbedtls_des3_set2key_enc(&ctx->des3, key);
+        else
+            mbedtls_des3_set2key_dec(&ctx->des3, key);
+        break;
+    default:
+        if (enc)
+            mbedtls_des3_set3key_enc(&ctx->des3, key);
+        else
+            mbedtls_des3_set3key_dec(&ctx->des3, key);
+        break;
+    }
+}
+
+static void  ctx_free(DES_CTX_T *ctx)
+{
+    mbedtls_des_free(&ctx->des);
+    mbedtls_des3_free(&ctx->des3);
+}
+
+/* ECB block by block, or CBC in one call */
+static int  ctx_crypt(DES_CTX_T *ctx, uint32_t mode, int enc, uint8_t iv[8],
+                      const uint8_t *in, uint8_t *out, int len)
+{
+    int   i, r = 0;
+
+    if (mode == TDES_MODE_CBC)
+    {
+        if (ctx->keylen == 8)
+            return mbedtls_des_crypt_cbc(&ctx->des, enc ? MBEDTLS_DES_ENCRYPT : MBEDTLS_DES_DECRYPT,
+                                         len, iv, in, out);
+        return mbedtls_des3_crypt_cbc(&ctx->des3, enc ? MBEDTLS_DES_ENCRYPT : MBEDTLS_DES_DECRYPT,
+                                      len, iv, in, out);
+    }
+
+    for (i = 0; (r == 0) && (i < len); i += 8)
+    {
+        if (ctx->keylen == 8)
+            r = mbedtls_des_crypt_ecb(&ctx->des, in + i, out + i);
+        else
+            r = mbedtls_des3_crypt_ecb(&ctx->des3, in + i, out + i);
+    }
+    return r;
+}
+
+static int  run_vector(TEST_CASE_T *tc, int off)
+{
+    DES_CTX_T  ctx;
+    uint8_t   key[24], iv[8], expect[64], *src = _src + off, *dst = _dst + off;
+    int       keylen, len, enc, r, arg = 0, expect_ret = 0;
+    uint32_t  mode;
+    const char  *f = tc->func;
+
+    enc = (strstr(f, "encrypt") != NULL);
+    mode = strstr(f, "_cbc") ? TDES_MODE_CBC : TDES_MODE_ECB;
+
+    /* des3_xxx have the key count first */
+    if (strncmp(f, "des3_", 5) == 0)
+        arg = 1;
+    keylen = test_unhex(tc->argv[arg++], key);
+    if (mode == TDES_MODE_CBC)
+        test_unhex(tc->argv[arg++], iv);
+    len = test_unhex(tc->argv[arg++], src);
+    test_unhex(tc->argv[arg++], expect);
+    if ((mode == TDES_MODE_CBC) && (strcmp(tc->argv[arg], "0") != 0))
+        expect_ret = MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH;
+
+    ctx_init(&ctx, key, keylen, enc);
+    r = ctx_crypt(&ctx, mode, enc, iv, src, dst, len);
+    ctx_free(&ctx);
+
+    if (r != expect_ret)
+        return -1;
+    if ((r == 0) && memcmp(dst, expect, len))
+        return -1;
+    return 0;
+}
+
+static void  test_vectors(void)
+{
+    TEST_CASE_T  tc;
+    FILE  *fp;
+    int   n = 0, off;
+
+    fp = test_data_open("test_suit_des", "test_suite_des.data");
+    CHECK(fp != NULL, "test_suite_des.data");
+    if (fp == NULL)
+        return;
+
+    memset(&tc, 0, sizeof(tc));
+    while (test_data_next(fp, &tc))
+    {
+        /* the weak key, parity and self tests do not reach the engine */
+        if (!strstr(tc.func, "crypt"))
+            continue;
+        for (off = 0; off < 2; off++)
+        {
+            CHECK(run_vector(&tc, off) == 0, "line %d, %s, buffers %s", tc.line_no, tc.desc,
+                  off ? "unaligned" : "aligned");
+        }
+        n++;
+    }
+    fclose(fp);
+    printf("test_suite_des.data: %d vectors\n", n);
+}
+
+/*
+ *  Lengths of a block up to many bounce buffers, at every alignment of source and
+ *  destination: aligned data goes in one transfer, the rest in bounce buffer chunks.
+ */
+static void  test_alignment(void)
+{
+    static const int  keylen[] = { 8, 16, 24 };
+    static const int  len[] = { 8, 16, 24, 40, 136, BULK_LEN };
+    static const uint32_t  mode[] = { TDES_MODE_ECB, TDES_MODE_CBC };
+    DES_CTX_T  ctx;
+    uint8_t   key[24], iv[8], ref_iv[8];
+    int       k, l, m, enc, soff, doff, r;
+
+    fill(key, 24, 1);
+    fill(_src, BULK_LEN + 8, 2);
+
+    for (k = 0; k < 3; k++)
+    {
+        for (m = 0; m < 2; m++)
+        {
+            for (enc = 0; enc < 2; enc++)
+            {
+                ctx_init(&ctx, key, keylen[k], enc);
+                for (l = 0; l < (int)(sizeof(len) / sizeof(len[0])); l++)
+                {
+                    for (soff = 0; soff < 4; soff++)
+                    {
+                        for (doff = 0; doff < 4; doff += 3)
+                        {
+                            fill(iv, 8, 3 + l);
+                            memcpy(ref_iv, iv, 8);
+                            ref_des_crypt(mode[m], enc, key, keylen[k], ref_iv, _src + soff, _ref, len[l]);
+                            memset(_dst, 0, sizeof(_dst));
+                            r = ctx_crypt(&ctx, mode[m], enc, iv, _src + soff, _dst + doff, len[l]);
+                            CHECK((r == 0) && (memcmp(_dst + doff, _ref, len[l]) == 0) &&
+                                  ((mode[m] == TDES_MODE_ECB) || (memcmp(iv, ref_iv, 8) == 0)),
+                                  "%d byte key, %s %s, %d bytes, source +%d, destination +%d", keylen[k],
+                                  (mode[m] == TDES_MODE_CBC) ? "CBC" : "ECB", enc ? "encrypt" : "decrypt",
+                                  len[l], soff, doff);
+                        }
+                    }
+                }
+                ctx_free(&ctx);
+            }
+        }
+    }
+    printf("lengths and alignment: done\n");
+}
+
+/*
+ *  More CBC streams than key channels, each in pieces that end on blocks, interleaved so
+ *  that the contexts evict each other's keys and the IV comes back from the caller.
+ */
+static void  test_streams(void)
+{
+    static const int  piece[] = { 8, 24, 16, 72, 8, 128 };
+    static const int  keylen[] = { 8, 16, 24 };
+    DES_CTX_T  ctx[CTX_NUM];
+    uint8_t   key[CTX_NUM][24], iv[CTX_NUM][8], ref_iv[8], out[CTX_NUM][BULK_LEN];
+    int       c, p, pos;
+
+    fill(_src, BULK_LEN, 10);
+    for (c = 0; c < CTX_NUM; c++)
+    {
+        fill(key[c], 24, 20 + c);
+        fill(iv[c], 8, 30 + c);
+        ctx_init(&ctx[c], key[c], keylen[c % 3], c & 1);
+    }
+
+    for (p = 0, pos = 0; p < (int)(sizeof(piece) / sizeof(piece[0])); pos += piece[p], p++)
+    {
+        for (c = 0; c < CTX_NUM; c++)
+        {
+            /* odd contexts from an unaligned source */
+            CHECK(ctx_crypt(&ctx[c], TDES_MODE_CBC, c & 1, iv[c], _src + pos + (c & 1), out[c] + pos,
+                            piece[p]) == 0, "context %d, piece %d", c, p);
+        }
+    }
+
+    for (c = 0; c < CTX_NUM; c++)
+    {
+        fill(ref_iv, 8, 30 + c);
+        ref_des_crypt(TDES_MODE_CBC, c & 1, key[c], keylen[c % 3], ref_iv, _src + (c & 1), _ref, pos);
+        CHECK((memcmp(out[c], _ref, pos) == 0) && (memcmp(iv[c], ref_iv, 8) == 0),
+              "context %d, %d byte key, %s stream", c, keylen[c % 3], (c & 1) ? "encrypt" : "decrypt");
+        ctx_free(&ctx[c]);
+    }
+    printf("CBC streams: done\n");
+}
+
+/*
+ *  Four contexts keep their keys in the channels, a fifth takes the least recently used
+ *  one, and a new key or a new context at the address of a freed one is loaded.
+ */
+static void  test_channels(void)
+{
+    DES_CTX_T  ctx[5];
+    CRPT_MODEL_STAT_T  st;
+    uint8_t   key[5][24], blk[8], out[8], ref[8], iv[8];
+    int       c, i;
+
+    for (c = 0; c < 5; c++)
+    {
+        fill(key[c], 24, 40 + c);
+        ctx_init(&ctx[c], key[c], (c & 1) ? 24 : 8, 1);
+    }
+    nvt_des_flush_channels();
+    crpt_model_clear_stat();
+    fill(blk, 8, 50);
+
+    for (i = 0; i < 10; i++)
+    {
+        for (c = 0; c < 4; c++)
+            ctx_crypt(&ctx[c], TDES_MODE_ECB, 1, NULL, blk, out, 8);
+    }
+    crpt_model_stat(CRPT_JOB_TDES, &st);
+    CHECK((st.u32Ops == 40UL) && (st.u32KeyLoads == 4UL), "4 contexts: %u operations, the engine saw %u keys",
+          st.u32Ops, st.u32KeyLoads);
+
+    /* ctx[0] is the least recently used, the fifth context takes its channel */
+    ctx_crypt(&ctx[4], TDES_MODE_ECB, 1, NULL, blk, out, 8);
+    ctx_crypt(&ctx[1], TDES_MODE_ECB, 1, NULL, blk, out, 8);
+    ctx_crypt(&ctx[0], TDES_MODE_ECB, 1, NULL, blk, out, 8);
+    crpt_model_stat(CRPT_JOB_TDES, &st);
+    CHECK(st.u32KeyLoads == 6UL, "fifth context and the evicted one: the engine saw %u keys", st.u32KeyLoads);
+    ref_des_crypt(TDES_MODE_ECB, 1, key[0], 8, iv, blk, ref, 8);
+    CHECK(memcmp(out, ref, 8) == 0, "evicted context, wrong key used");
+
+    /* A new key in a context that holds a channel must be loaded, not the stale one used */
+    fill(key[0], 24, 60);
+    mbedtls_des_setkey_enc(&ctx[0].des, key[0]);
+    ctx_crypt(&ctx[0], TDES_MODE_ECB, 1, NULL, blk, out, 8);
+    ref_des_crypt(TDES_MODE_ECB, 1, key[0], 8, iv, blk, ref, 8);
+    CHECK(memcmp(out, ref, 8) == 0, "new key of a resident context not loaded");
+
+    /* A context freed and another set up at the same address */
+    ctx_free(&ctx[1]);
+    fill(key[1], 24, 70);
+    ctx_init(&ctx[1], key[1], 16, 1);
+    ctx_crypt(&ctx[1], TDES_MODE_ECB, 1, NULL, blk, out, 8);
+    ref_des_crypt(TDES_MODE_ECB, 1, key[1], 16, iv, blk, ref, 8);
+    CHECK(memcmp(out, ref, 8) == 0, "context at the address of a freed one used its key");
+
+    for (c = 0; c < 5; c++)
+        ctx_free(&ctx[c]);
+    printf("key channels: done\n");
+}
+
+/* An engine error is returned, in the first or a later bounce buffer, and the next call works */
+static void  test_error(void)
+{
+    DES_CTX_T  ctx;
+    uint8_t   key[24], iv[8], ref_iv[8];
+    int       skip;
+
+    fill(key, 24, 80);
+    fill(_src, BULK_LEN, 81);
+    ctx_init(&ctx, key, 24, 1);
+
+    /* a single block, and the first and a later transfer of unaligned data */
+    crpt_model_fail(CRPT_JOB_TDES, 0);
+    CHECK(ctx_crypt(&ctx, TDES_MODE_ECB, 1, NULL, _src, _dst, 8) == MBEDTLS_ERR_DES_HW_ACCEL_FAILED,
+          "engine error of a single block not returned");
+    for (skip = 0; skip < 3; skip++)
+    {
+        memset(iv, 0, 8);
+        crpt_model_fail(CRPT_JOB_TDES, skip);
+        CHECK(ctx_crypt(&ctx, TDES_MODE_CBC, 1, iv, _src + 1, _dst, BULK_LEN) == MBEDTLS_ERR_DES_HW_ACCEL_FAILED,
+              "engine error in transfer %d not returned", skip);
+    }
+
+    memset(iv, 0, 8);
+    memset(ref_iv, 0, 8);
+    ref_des_crypt(TDES_MODE_CBC, 1, key, 24, ref_iv, _src + 1, _ref, BULK_LEN);
+    CHECK((ctx_crypt(&ctx, TDES_MODE_CBC, 1, iv, _src + 1, _dst, BULK_LEN) == 0) &&
+          (memcmp(_dst, _ref, BULK_LEN) == 0), "operation after an engine error");
+    ctx_free(&ctx);
+    printf("engine errors: done\n");
+}
+
+static void  des_test(void)
+{
+    crpt_test_init();
+    crpt_model_check_lock(1);
+
+    test_vectors();
+    CHECK(mbedtls_des_self_test(0) == 0, "mbedtls_des_self_test");
+
+    test_alignment();
+    test_streams();
+    test_channels();
+    test_error();
+
+    /* and once more with every operation ending a while after START, from the interrupt */
+    crpt_model_set_latency(CRPT_JOB_TDES, 20);
+    test_alignment();
+    test_streams();
+    test_error();
+}
+
+int main(void)
+{
+    if (crpt_model_run(des_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
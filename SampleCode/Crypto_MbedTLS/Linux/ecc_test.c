@@ -0,0 +1,319 @@
+/**************************************************************************//**
+ * @file     ecc_test.c
+ * @version  V1.00
+ * @brief    Host test of the ECC driver APIs of crypto.c on the register
+ *           model.
+ *
+ *           Runs the ECDH primitive vectors of test_suit_ecdh through the
+ *           word array APIs and the hex string APIs in turn, on the same and
+ *           on alternating curves, signs and verifies with both, and checks
+ *           that the curve parameters ecc_init_curve() keeps between calls
+ *           are written again after other code or a CRPT job has used the
+ *           ECC registers.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define VEC_MAX         8
+#define W               ECC_KEY_WORD_MAX
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+/* An ecdh_primitive_testvec: the key pairs of A and B and their shared secret */
+typedef struct
+{
+    E_ECC_CURVE  curve;
+    const char   *name;
+    char         *dA, *xA, *yA, *dB, *xB, *yB, *z;
+    TEST_CASE_T  tc;
+} ECDH_VEC_T;
+
+static ECDH_VEC_T  _vec[VEC_MAX];
+static int         _vec_cnt;
+
+static E_ECC_CURVE  vector_curve(const char *id, const char **name)
+{
+    if (strcmp(id, "MBEDTLS_ECP_DP_SECP192R1") == 0)
+    {
+        *name = "P-192";
+        return CURVE_P_192;
+    }
+    if (strcmp(id, "MBEDTLS_ECP_DP_SECP224R1") == 0)
+    {
+        *name = "P-224";
+        return CURVE_P_224;
+    }
+    if (strcmp(id, "MBEDTLS_ECP_DP_SECP256R1") == 0)
+    {
+        *name = "P-256";
+        return CURVE_P_256;
+    }
+    if (strcmp(id, "MBEDTLS_ECP_DP_SECP384R1") == 0)
+    {
+        *name = "P-384";
+        return CURVE_P_384;
+    }
+    if (strcmp(id, "MBEDTLS_ECP_DP_SECP521R1") == 0)
+    {
+        *name = "P-521";
+        return CURVE_P_521;
+    }
+    return CURVE_UNDEF;
+}
+
+/* A hex number, most significant digit first, into ECC_KEY_WORD_MAX words */
+static void  hex_words(const char *hex, uint32_t w[W])
+{
+    int   i, n = (int)strlen(hex);
+    unsigned int  v;
+    char  digit[2] = { 0, 0 };
+
+    memset(w, 0, W * 4);
+    for (i = 0; i < n; i++)
+    {
+        digit[0] = hex[n - 1 - i];
+        sscanf(digit, "%x", &v);
+        w[i / 8] |= (uint32_t)v << ((i % 8) * 4);
+    }
+}
+
+static int  hex_is(const char *hex, const uint32_t w[W])
+{
+    uint32_t  x[W];
+
+    hex_words(hex, x);
+    return memcmp(x, w, sizeof(x)) == 0;
+}
+
+static void  load_vectors(void)
+{
+    ECDH_VEC_T  *v;
+    FILE  *fp;
+    int   line_no = 0;
+
+    fp = test_data_open("test_suit_ecdh", "test_suite_ecdh.data");
+    CHECK(fp != NULL, "test_suite_ecdh.data");
+    if (fp == NULL)
+        return;
+
+    while (_vec_cnt < VEC_MAX)
+    {
+        v = &_vec[_vec_cnt];
+        v->tc.line_no = line_no;
+        if (!test_data_next(fp, &v->tc))
+            break;
+        line_no = v->tc.line_no;
+
+        if ((strcmp(v->tc.func, "ecdh_primitive_testvec") != 0) || (v->tc.argc != 8))
+            continue;
+        v->curve = vector_curve(v->tc.argv[0], &v->name);
+        if (v->curve == CURVE_UNDEF)
+            continue;
+        v->dA = v->tc.argv[1];
+        v->xA = v->tc.argv[2];
+        v->yA = v->tc.argv[3];
+        v->dB = v->tc.argv[4];
+        v->xB = v->tc.argv[5];
+        v->yB = v->tc.argv[6];
+        v->z  = v->tc.argv[7];
+        _vec_cnt++;
+    }
+    fclose(fp);
+    printf("test_suite_ecdh.data: %d primitive vectors\n", _vec_cnt);
+}
+
+/* ECDH of one vector with the word APIs */
+static void  ecdh_words(ECDH_VEC_T *v)
+{
+    uint32_t  d[W], x[W], y[W], z[W], px[W], py[W];
+
+    hex_words(v->dA, d);
+    hex_words(v->xB, x);
+    hex_words(v->yB, y);
+    CHECK(ECC_GenerateSecretZWords(CRPT, v->curve, d, x, y, z) == 0, "%s: ECC_GenerateSecretZWords", v->name);
+    CHECK(hex_is(v->z, z), "%s: secret of ECC_GenerateSecretZWords", v->name);
+
+    hex_words(v->dB, d);
+    hex_words(v->xA, x);
+    hex_words(v->yA, y);
+    CHECK(ECC_MultiplyWords(CRPT, v->curve, x, y, d, px, py) == 0, "%s: ECC_MultiplyWords", v->name);
+    CHECK(hex_is(v->z, px), "%s: x of ECC_MultiplyWords", v->name);
+}
+
+/* ECDH of one vector with the hex string APIs */
+static void  ecdh_strings(ECDH_VEC_T *v)
+{
+    char      x[160], y[160], z[160];
+    uint32_t  w[W];
+
+    CHECK(ECC_GeneratePublicKey(CRPT, v->curve, v->dA, x, y) == 0, "%s: ECC_GeneratePublicKey", v->name);
+    hex_words(x, w);
+    CHECK(hex_is(v->xA, w), "%s: x of ECC_GeneratePublicKey", v->name);
+    hex_words(y, w);
+    CHECK(hex_is(v->yA, w), "%s: y of ECC_GeneratePublicKey", v->name);
+
+    CHECK(ECC_GenerateSecretZ(CRPT, v->curve, v->dB, v->xA, v->yA, z) == 0, "%s: ECC_GenerateSecretZ", v->name);
+    hex_words(z, w);
+    CHECK(hex_is(v->z, w), "%s: secret of ECC_GenerateSecretZ", v->name);
+
+    CHECK(ECC_Mutiply(CRPT, v->curve, v->xB, v->yB, v->dA, x, y) == 0, "%s: ECC_Mutiply", v->name);
+    hex_words(x, w);
+    CHECK(hex_is(v->z, w), "%s: x of ECC_Mutiply", v->name);
+}
+
+/*
+ *  The word and string APIs in turn: on one curve, where ecc_init_curve() reuses the
+ *  parsed parameters, and across curves, where it parses them again.
+ */
+static void  test_ecdh(void)
+{
+    int   i, r;
+
+    for (i = 0; i < _vec_cnt; i++)
+    {
+        ecdh_words(&_vec[i]);
+        ecdh_strings(&_vec[i]);
+        ecdh_words(&_vec[i]);
+    }
+    for (r = 0; r < 2 * _vec_cnt; r++)
+    {
+        if (r & 1)
+            ecdh_strings(&_vec[r % _vec_cnt]);
+        else
+            ecdh_words(&_vec[(r / 2) % _vec_cnt]);
+    }
+    printf("ECDH, word and string APIs: done\n");
+}
+
+/*
+ *  Sign with A's key and B's private key as the nonce, so R is the x of B's public key,
+ *  with both APIs, and verify with both. ECDSA leaves the curve order in ECC_N.
+ */
+static void  ecdsa(ECDH_VEC_T *v)
+{
+    uint32_t  e[W], d[W], k[W], qx[W], qy[W], R[W], S[W];
+    char      Rs[160], Ss[160];
+
+    hex_words(v->z, e);
+    hex_words(v->dA, d);
+    hex_words(v->dB, k);
+    hex_words(v->xA, qx);
+    hex_words(v->yA, qy);
+
+    CHECK(ECC_GenerateSignatureWords(CRPT, v->curve, e, d, k, R, S) == 0, "%s: ECC_GenerateSignatureWords",
+          v->name);
+    CHECK(hex_is(v->xB, R), "%s: R is not x of kG", v->name);
+
+    CHECK(ECC_GenerateSignature(CRPT, v->curve, v->z, v->dA, v->dB, Rs, Ss) == 0, "%s: ECC_GenerateSignature",
+          v->name);
+    CHECK(hex_is(Rs, R) && hex_is(Ss, S), "%s: the word and string signatures differ", v->name);
+
+    CHECK(ECC_VerifySignature(CRPT, v->curve, v->z, v->xA, v->yA, Rs, Ss) == 0, "%s: ECC_VerifySignature",
+          v->name);
+    CHECK(ECC_VerifySignatureWords(CRPT, v->curve, e, qx, qy, R, S) == 0, "%s: ECC_VerifySignatureWords",
+          v->name);
+    S[0] ^= 1UL;
+    CHECK(ECC_VerifySignatureWords(CRPT, v->curve, e, qx, qy, R, S) == -2, "%s: a bad signature verified",
+          v->name);
+}
+
+static void  test_ecdsa(void)
+{
+    int   i;
+
+    for (i = 0; i < _vec_cnt; i++)
+    {
+        ecdsa(&_vec[i]);
+        ecdh_strings(&_vec[i]);
+        ecdsa(&_vec[i]);
+        ecdh_words(&_vec[i]);
+    }
+    printf("ECDSA, word and string APIs: done\n");
+}
+
+/*
+ *  The curve registers are changed behind the driver between two calls on the same curve,
+ *  by the application and by a modular multiplication run as a CRPT job.
+ */
+static void  test_foreign_writes(void)
+{
+    static CRPT_JOB_REG_T  regs[3 * W + 1];
+    CRPT_JOB_T  job;
+    ECDH_VEC_T  *v = &_vec[0];
+    int   i, n;
+
+    ecdh_words(v);
+
+    for (i = 0; i < W; i++)
+    {
+        CRPT->ECC_A[i] = 0x5A5A5A5AUL;
+        CRPT->ECC_B[i] = 0xA5A5A5A5UL;
+        CRPT->ECC_N[i] = 0xFFFFFFFFUL;
+    }
+    ecdh_strings(v);
+    ecdh_words(v);
+
+    /* 7 * 5 mod 0xFFFFFFFB */
+    for (i = 0, n = 0; i < W; i++)
+    {
+        regs[n].pu32Reg = &CRPT->ECC_N[i];
+        regs[n++].u32Val = (i == 0) ? 0xFFFFFFFBUL : 0UL;
+        regs[n].pu32Reg = &CRPT->ECC_X1[i];
+        regs[n++].u32Val = (i == 0) ? 7UL : 0UL;
+        regs[n].pu32Reg = &CRPT->ECC_Y1[i];
+        regs[n++].u32Val = (i == 0) ? 5UL : 0UL;
+    }
+    regs[n].pu32Reg = &CRPT->ECC_CTL;
+    regs[n++].u32Val = CRPT_ECC_CTL_FSEL_Msk | (1UL << CRPT_ECC_CTL_ECCOP_Pos) |
+                       (1UL << CRPT_ECC_CTL_MODOP_Pos) | CRPT_ECC_CTL_START_Msk;
+
+    memset(&job, 0, sizeof(job));
+    job.u32Engine = CRPT_JOB_ECC;
+    job.pRegs = regs;
+    job.u32RegCnt = n;
+    CHECK((CRPT_JobRun(CRPT, &job) == CRPT_JOB_DONE) && (CRPT->ECC_X1[0] == 35UL), "modular job");
+
+    ecdh_strings(v);
+    ecdsa(v);
+    ecdh_words(v);
+    printf("curve registers written behind the driver: done\n");
+}
+
+static void  ecc_test(void)
+{
+    crpt_test_init();
+
+    load_vectors();
+    CHECK(_vec_cnt > 0, "no vectors");
+    if (_vec_cnt == 0)
+        return;
+
+    test_ecdh();
+    test_ecdsa();
+    test_foreign_writes();
+
+    /* and once more with every operation ending a while after START, from the interrupt */
+    crpt_model_set_latency(CRPT_JOB_ECC, 20);
+    test_ecdh();
+    test_foreign_writes();
+}
+
+int main(void)
+{
+    if (crpt_model_run(ecc_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
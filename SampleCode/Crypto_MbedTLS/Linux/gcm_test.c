@@ -0,0 +1,292 @@
+/**************************************************************************//**
+ * @file     gcm_test.c
+ * @version  V1.00
+ * @brief    Host test of the AES-GCM glue of gcm.c on the register model.
+ *
+ *           The CTR keystream of mbedtls_gcm_update() is streamed by the
+ *           AES engine through two buffers while the CPU runs GHASH. The
+ *           ciphertexts and tags of every key size, IV, additional data and
+ *           message length around the buffer size, in one update and split,
+ *           are checked against the software reference, as are contexts
+ *           interleaving their updates, counters at the 32-bit wrap and
+ *           engine errors.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/aes.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define MSG_LEN         1100                    /* many NUVOTON_AES_DMA_BUFF_SIZE buffers */
+#define BUFF_SIZE       NUVOTON_AES_DMA_BUFF_SIZE
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+static uint8_t  _msg[MSG_LEN + 8];
+static uint8_t  _out[MSG_LEN + 8];
+static uint8_t  _ref[MSG_LEN + 8];
+static uint8_t  _key[32], _iv[16], _add[20];
+
+static void  fill(uint8_t *buf, int len, uint32_t seed)
+{
+    while (len-- > 0)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        *buf++ = (uint8_t)(seed >> 16);
+    }
+}
+
+static void  set_ctr(mbedtls_gcm_context *gcm, uint32_t u32Ctr)
+{
+    gcm->y[12] = (uint8_t)(u32Ctr >> 24);
+    gcm->y[13] = (uint8_t)(u32Ctr >> 16);
+    gcm->y[14] = (uint8_t)(u32Ctr >> 8);
+    gcm->y[15] = (uint8_t)u32Ctr;
+}
+
+/* len bytes in <pieces> updates, all but the last a multiple of 16 bytes */
+static int  gcm_pieces(mbedtls_gcm_context *gcm, int enc, size_t ivlen, size_t addlen, uint32_t u32Ctr,
+                       const uint8_t *in, uint8_t *out, size_t len, int pieces, uint8_t tag[16])
+{
+    size_t    pos, n;
+    int       i, r;
+
+    r = mbedtls_gcm_starts(gcm, enc ? MBEDTLS_GCM_ENCRYPT : MBEDTLS_GCM_DECRYPT, _iv, ivlen, _add, addlen);
+    if (u32Ctr != 0UL)
+        set_ctr(gcm, u32Ctr);
+    for (i = 0, pos = 0; (r == 0) && (i < pieces); i++, pos += n)
+    {
+        n = (i == pieces - 1) ? len - pos : (len / pieces) & ~15UL;
+        r = mbedtls_gcm_update(gcm, n, in + pos, out + pos);
+    }
+    if (r == 0)
+        r = mbedtls_gcm_finish(gcm, tag, 16);
+    return r;
+}
+
+/*
+ *  Every key size with IVs that are and are not 96 bits, with and without additional
+ *  data, for messages around the keystream buffer size, from and to unaligned buffers,
+ *  in one update and in several. Decryption runs in place.
+ */
+static void  test_lengths(void)
+{
+    static const int  keybits[] = { 128, 192, 256 };
+    static const int  ivlen[] = { 12, 7, 16 };
+    static const int  addlen[] = { 0, 13, 20 };
+    static const int  msglen[] = { 0, 1, 15, 16, 17, 63, 64, 65, 127, 128, 129, 200, 257, 513, MSG_LEN };
+    static const int  pieces[] = { 1, 3 };
+    mbedtls_gcm_context  gcm;
+    CRPT_MODEL_STAT_T  st;
+    uint8_t   tag[16], ref_tag[16];
+    int       k, v, n, p, off, r, cnt = 0;
+
+    fill(_key, sizeof(_key), 1);
+    fill(_iv, sizeof(_iv), 2);
+    fill(_add, sizeof(_add), 3);
+    fill(_msg, MSG_LEN + 8, 4);
+
+    for (k = 0; k < 3; k++)
+    {
+        mbedtls_gcm_init(&gcm);
+        CHECK(mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, _key, keybits[k]) == 0, "mbedtls_gcm_setkey");
+
+        for (v = 0; v < 3; v++)
+        {
+            for (n = 0; n < (int)(sizeof(msglen) / sizeof(msglen[0])); n++)
+            {
+                off = (v + n) & 3;
+                ref_gcm(1, _key, keybits[k], _iv, ivlen[v], _add, addlen[v], 0UL, _msg + off, _ref, msglen[n],
+                        ref_tag);
+                for (p = 0; p < 2; p++)
+                {
+                    crpt_model_clear_stat();
+                    memset(_out, 0, sizeof(_out));
+                    r = gcm_pieces(&gcm, 1, ivlen[v], addlen[v], 0UL, _msg + off, _out + 1, msglen[n], pieces[p], tag);
+                    CHECK((r == 0) && (memcmp(_out + 1, _ref, msglen[n]) == 0) && (memcmp(tag, ref_tag, 16) == 0),
+                          "AES-%d: IV %d bytes, %d bytes of data, %d bytes at +%d, %d updates", keybits[k],
+                          ivlen[v], addlen[v], msglen[n], off, pieces[p]);
+                    crpt_model_stat(CRPT_JOB_AES, &st);
+                    CHECK(st.u32Ops >= (uint32_t)(msglen[n] + BUFF_SIZE - 1) / BUFF_SIZE,
+                          "AES-%d: %u engine operations for %d bytes", keybits[k], st.u32Ops, msglen[n]);
+
+                    r = gcm_pieces(&gcm, 0, ivlen[v], addlen[v], 0UL, _out + 1, _out + 1, msglen[n], pieces[p], tag);
+                    CHECK((r == 0) && (memcmp(_out + 1, _msg + off, msglen[n]) == 0) &&
+                          (memcmp(tag, ref_tag, 16) == 0), "AES-%d: in place decryption of %d bytes, %d updates",
+                          keybits[k], msglen[n], pieces[p]);
+                    cnt++;
+                }
+            }
+        }
+        mbedtls_gcm_free(&gcm);
+    }
+    printf("key, IV and message lengths: %d cases, done\n", cnt);
+}
+
+/*
+ *  Two GCM contexts and an AES context with other keys take turns on the engine between
+ *  the updates of a message, each streams its own keystream.
+ */
+static void  test_interleave(void)
+{
+    mbedtls_gcm_context  a, b;
+    mbedtls_aes_context  aes;
+    uint8_t   key_b[32], tag[16], ref_a[MSG_LEN], ref_b[MSG_LEN], ref_tag_a[16], ref_tag_b[16];
+    uint8_t   out_b[MSG_LEN], blk[64], iv[16];
+    int       pos, r;
+
+    fill(_key, sizeof(_key), 5);
+    fill(key_b, sizeof(key_b), 6);
+    fill(_iv, sizeof(_iv), 7);
+    fill(_msg, MSG_LEN, 8);
+    ref_gcm(1, _key, 256, _iv, 12, _add, 0, 0UL, _msg, ref_a, MSG_LEN, ref_tag_a);
+    ref_gcm(1, key_b, 128, _iv, 16, _add, 20, 0UL, _msg, ref_b, MSG_LEN, ref_tag_b);
+
+    mbedtls_gcm_init(&a);
+    mbedtls_gcm_init(&b);
+    mbedtls_aes_init(&aes);
+    r = mbedtls_gcm_setkey(&a, MBEDTLS_CIPHER_ID_AES, _key, 256);
+    r |= mbedtls_gcm_setkey(&b, MBEDTLS_CIPHER_ID_AES, key_b, 128);
+    r |= mbedtls_aes_setkey_enc(&aes, key_b + 16, 128);
+    r |= mbedtls_gcm_starts(&a, MBEDTLS_GCM_ENCRYPT, _iv, 12, _add, 0);
+    r |= mbedtls_gcm_starts(&b, MBEDTLS_GCM_ENCRYPT, _iv, 16, _add, 20);
+
+    for (pos = 0; pos < MSG_LEN; pos += 320)
+    {
+        memset(iv, 0, sizeof(iv));
+        r |= mbedtls_gcm_update(&a, (pos + 320 < MSG_LEN) ? 320 : MSG_LEN - pos, _msg + pos, _out + pos);
+        r |= mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, sizeof(blk), iv, _msg, blk);
+        r |= mbedtls_gcm_update(&b, (pos + 320 < MSG_LEN) ? 320 : MSG_LEN - pos, _msg + pos, out_b + pos);
+    }
+    r |= mbedtls_gcm_finish(&a, tag, 16);
+    CHECK((r == 0) && (memcmp(_out, ref_a, MSG_LEN) == 0) && (memcmp(tag, ref_tag_a, 16) == 0),
+          "first of the interleaved contexts");
+    r = mbedtls_gcm_finish(&b, tag, 16);
+    CHECK((r == 0) && (memcmp(out_b, ref_b, MSG_LEN) == 0) && (memcmp(tag, ref_tag_b, 16) == 0),
+          "second of the interleaved contexts");
+
+    mbedtls_gcm_free(&a);
+    mbedtls_gcm_free(&b);
+    mbedtls_aes_free(&aes);
+    printf("interleaved contexts: done\n");
+}
+
+/*
+ *  The engine counts through all 128 bits of the counter, GCM through the low 32 only: an
+ *  update that would carry out of the low word takes the block by block path.
+ */
+static void  test_wrap(void)
+{
+    static const int  blocks[] = { 1, 16, 17, 63 };
+    mbedtls_gcm_context  gcm;
+    CRPT_MODEL_STAT_T  st;
+    uint8_t   tag[16], ref_tag[16];
+    uint32_t  ctr;
+    int       b, d, r, len;
+
+    fill(_key, sizeof(_key), 9);
+    fill(_iv, sizeof(_iv), 10);
+    fill(_msg, MSG_LEN, 11);
+
+    mbedtls_gcm_init(&gcm);
+    mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, _key, 128);
+
+    for (b = 0; b < 4; b++)
+    {
+        len = blocks[b] * 16 - 5;
+        for (d = -1; d <= 1; d++)
+        {
+            /* the last block uses 0xFFFFFFFF, or wraps to 0 and 1 */
+            ctr = 0xFFFFFFFFUL - (uint32_t)blocks[b] + (uint32_t)(d + 1);
+            ref_gcm(1, _key, 128, _iv, 12, _add, 0, ctr, _msg, _ref, len, ref_tag);
+
+            crpt_model_clear_stat();
+            memset(_out, 0, sizeof(_out));
+            r = gcm_pieces(&gcm, 1, 12, 0, ctr, _msg, _out, len, 1, tag);
+            CHECK((r == 0) && (memcmp(_out, _ref, len) == 0) && (memcmp(tag, ref_tag, 16) == 0),
+                  "%d blocks from counter 0x%08x", blocks[b], (unsigned int)(ctr + 1UL));
+            /* one more for E(K, Y0) of mbedtls_gcm_starts() */
+            crpt_model_stat(CRPT_JOB_AES, &st);
+            if (d < 0)
+                CHECK(st.u32Ops == 1UL + (uint32_t)(len + BUFF_SIZE - 1) / BUFF_SIZE,
+                      "%d blocks up to counter 0xFFFFFFFF: %u engine operations", blocks[b], st.u32Ops);
+            else
+                CHECK(st.u32Ops == 1UL + (uint32_t)blocks[b],
+                      "%d blocks over the wrap: %u engine operations", blocks[b], st.u32Ops);
+        }
+    }
+    mbedtls_gcm_free(&gcm);
+    printf("counter wrap: done\n");
+}
+
+/* An engine error is returned, and the next message is streamed by the engine again */
+static void  test_error(void)
+{
+    mbedtls_gcm_context  gcm;
+    uint8_t   tag[16], ref_tag[16];
+    int       i, skip, r;
+
+    fill(_key, sizeof(_key), 12);
+    fill(_iv, sizeof(_iv), 13);
+    fill(_msg, MSG_LEN, 14);
+    ref_gcm(1, _key, 192, _iv, 12, _add, 13, 0UL, _msg, _ref, MSG_LEN, ref_tag);
+
+    mbedtls_gcm_init(&gcm);
+    mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, _key, 192);
+
+    /* the first, a middle and the last keystream buffer */
+    for (i = 0; i < 3; i++)
+    {
+        skip = i * ((MSG_LEN + BUFF_SIZE - 1) / BUFF_SIZE - 1) / 2;
+        r = mbedtls_gcm_starts(&gcm, MBEDTLS_GCM_ENCRYPT, _iv, 12, _add, 13);
+        CHECK(r == 0, "mbedtls_gcm_starts returned %d", r);
+        crpt_model_fail(CRPT_JOB_AES, (uint32_t)skip);
+        r = mbedtls_gcm_update(&gcm, MSG_LEN, _msg, _out);
+        CHECK(r == MBEDTLS_ERR_AES_HW_ACCEL_FAILED, "error on keystream buffer %d returned %d", skip, r);
+
+        memset(_out, 0, sizeof(_out));
+        r = gcm_pieces(&gcm, 1, 12, 13, 0UL, _msg, _out, MSG_LEN, 1, tag);
+        CHECK((r == 0) && (memcmp(_out, _ref, MSG_LEN) == 0) && (memcmp(tag, ref_tag, 16) == 0),
+              "message after the error on keystream buffer %d", skip);
+    }
+    mbedtls_gcm_free(&gcm);
+    printf("engine errors: done\n");
+}
+
+static void  gcm_test(void)
+{
+    crpt_test_init();
+    crpt_model_check_lock(1);
+
+    CHECK(mbedtls_gcm_self_test(0) == 0, "mbedtls_gcm_self_test");
+
+    test_lengths();
+    test_interleave();
+    test_wrap();
+    test_error();
+
+    /* and once more with the keystream buffers ending a while after START, from the interrupt */
+    crpt_model_set_latency(CRPT_JOB_AES, 20);
+    test_lengths();
+    test_interleave();
+    test_error();
+}
+
+int main(void)
+{
+    if (crpt_model_run(gcm_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
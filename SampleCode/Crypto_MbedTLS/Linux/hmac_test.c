@@ -0,0 +1,275 @@
+/**************************************************************************//**
+ * @file     hmac_test.c
+ * @version  V1.00
+ * @brief    Host test of the HMAC engine glue of md.c on the register model.
+ *
+ *           MACs of every hash, key length and message length around the
+ *           block size and the message buffer, in one call and split, are
+ *           checked against the software reference, on the engine and in
+ *           software. A MAC finished while a hash streams through the engine
+ *           must leave that hash there and be computed in software, and an
+ *           engine error must come back as MBEDTLS_ERR_MD_HW_ACCEL_FAILED.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define MSG_LEN         600                     /* more than NUVOTON_SHA_HMAC_BUFF_SIZE   */
+#define KEY_LEN         200
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+static const uint32_t  _modes[] = { SHA_MODE_SHA1, SHA_MODE_SHA224, SHA_MODE_SHA256, SHA_MODE_SHA384, SHA_MODE_SHA512 };
+
+static uint8_t  _msg[MSG_LEN + 8];
+static uint8_t  _key[KEY_LEN];
+
+static const char  *mode_name(uint32_t mode)
+{
+    switch (mode)
+    {
+    case SHA_MODE_SHA1:
+        return "SHA-1";
+    case SHA_MODE_SHA224:
+        return "SHA-224";
+    case SHA_MODE_SHA256:
+        return "SHA-256";
+    case SHA_MODE_SHA384:
+        return "SHA-384";
+    default:
+        return "SHA-512";
+    }
+}
+
+static const mbedtls_md_info_t  *mode_md(uint32_t mode)
+{
+    switch (mode)
+    {
+    case SHA_MODE_SHA1:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
+    case SHA_MODE_SHA224:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA224);
+    case SHA_MODE_SHA256:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    case SHA_MODE_SHA384:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA384);
+    default:
+        return mbedtls_md_info_from_type(MBEDTLS_MD_SHA512);
+    }
+}
+
+static void  fill(uint8_t *buf, int len, uint32_t seed)
+{
+    while (len-- > 0)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        *buf++ = (uint8_t)(seed >> 16);
+    }
+}
+
+/* MAC of len bytes at in, in <pieces> calls of about the same size, and again after a reset */
+static int  hmac_pieces(mbedtls_md_context_t *ctx, const uint8_t *key, size_t keylen,
+                        const uint8_t *in, size_t len, int pieces, uint8_t *out, uint8_t *out2)
+{
+    size_t    pos, n;
+    int       i, r;
+
+    r = mbedtls_md_hmac_starts(ctx, key, keylen);
+    for (i = 0, pos = 0; (r == 0) && (i < pieces); i++, pos += n)
+    {
+        n = (i == pieces - 1) ? len - pos : len / pieces;
+        r = mbedtls_md_hmac_update(ctx, in + pos, n);
+    }
+    if (r == 0)
+        r = mbedtls_md_hmac_finish(ctx, out);
+
+    if (r == 0)
+        r = mbedtls_md_hmac_reset(ctx);
+    if (r == 0)
+        r = mbedtls_md_hmac_update(ctx, in, len);
+    if (r == 0)
+        r = mbedtls_md_hmac_finish(ctx, out2);
+    return r;
+}
+
+/*
+ *  Empty keys, keys of up to a block and longer ones, which mbedtls hashes first, with
+ *  messages that fit the buffer behind the key and ones that go to software.
+ */
+static void  test_lengths(void)
+{
+    static const int  keylen[] = { 0, 1, 3, 20, 63, 64, 65, 128, 129, KEY_LEN };
+    static const int  msglen[] = { 0, 1, 13, 55, 64, 100, 192, 250, 256, 257, 384, MSG_LEN };
+    static const int  pieces[] = { 1, 3 };
+    mbedtls_md_context_t  ctx;
+    CRPT_MODEL_STAT_T  st;
+    uint8_t   ref[64], out[64], out2[64];
+    int       m, k, n, p, off, r, size;
+
+    fill(_key, KEY_LEN, 1);
+    fill(_msg, MSG_LEN + 8, 2);
+
+    for (m = 0; m < 5; m++)
+    {
+        size = mbedtls_md_get_size(mode_md(_modes[m]));
+        mbedtls_md_init(&ctx);
+        CHECK(mbedtls_md_setup(&ctx, mode_md(_modes[m]), 1) == 0, "%s: mbedtls_md_setup", mode_name(_modes[m]));
+
+        for (k = 0; k < (int)(sizeof(keylen) / sizeof(keylen[0])); k++)
+        {
+            for (n = 0; n < (int)(sizeof(msglen) / sizeof(msglen[0])); n++)
+            {
+                off = (k + n) & 3;
+                ref_hmac(_modes[m], _key, keylen[k], _msg + off, msglen[n], ref);
+                for (p = 0; p < 2; p++)
+                {
+                    memset(out, 0, sizeof(out));
+                    memset(out2, 0, sizeof(out2));
+                    r = hmac_pieces(&ctx, _key, keylen[k], _msg + off, msglen[n], pieces[p], out, out2);
+                    CHECK((r == 0) && (memcmp(out, ref, size) == 0) && (memcmp(out2, ref, size) == 0),
+                          "%s: key %d bytes, message %d bytes at +%d, %d calls", mode_name(_modes[m]),
+                          keylen[k], msglen[n], off, pieces[p]);
+                }
+            }
+        }
+
+        /* a short MAC runs on the engine in one transfer */
+        crpt_model_clear_stat();
+        r = hmac_pieces(&ctx, _key, 20, _msg, 100, 1, out, out2);
+        crpt_model_stat(CRPT_JOB_SHA, &st);
+        CHECK((r == 0) && (st.u32Ops == 2UL), "%s: %u engine operations for two short MACs",
+              mode_name(_modes[m]), st.u32Ops);
+
+        mbedtls_md_free(&ctx);
+    }
+    printf("key and message lengths: done\n");
+}
+
+/*
+ *  A SHA-256 hash owns the engine while MACs are finished: it keeps the engine, the MACs
+ *  are computed in software, and the engine carries the MAC again once the hash is done.
+ */
+static void  test_owned(void)
+{
+    mbedtls_sha256_context  sha;
+    mbedtls_md_context_t    ctx;
+    CRPT_MODEL_STAT_T  st;
+    uint8_t   ref[64], ref_sha256[32], out[64];
+    int       m, r;
+
+    fill(_key, KEY_LEN, 3);
+    fill(_msg, MSG_LEN, 4);
+    ref_sha(SHA_MODE_SHA256, _msg, MSG_LEN, ref_sha256);
+
+    for (m = 0; m < 5; m++)
+    {
+        ref_hmac(_modes[m], _key, 32, _msg, 150, ref);
+        mbedtls_md_init(&ctx);
+        mbedtls_md_setup(&ctx, mode_md(_modes[m]), 1);
+
+        mbedtls_sha256_init(&sha);
+        r = mbedtls_sha256_starts_ret(&sha, 0);
+        r |= mbedtls_sha256_update_ret(&sha, _msg, 200);
+        CHECK(sha.nvt_hw, "SHA-256 did not get the engine");
+
+        crpt_model_clear_stat();
+        r |= mbedtls_md_hmac_starts(&ctx, _key, 32);
+        r |= mbedtls_md_hmac_update(&ctx, _msg, 150);
+        r |= mbedtls_md_hmac_finish(&ctx, out);
+        crpt_model_stat(CRPT_JOB_SHA, &st);
+        CHECK((r == 0) && (memcmp(out, ref, mbedtls_md_get_size(mode_md(_modes[m]))) == 0),
+              "%s: MAC beside a hash on the engine", mode_name(_modes[m]));
+        CHECK(sha.nvt_hw && (st.u32Ops == 0UL), "%s: MAC took the engine from the hash", mode_name(_modes[m]));
+
+        r = mbedtls_sha256_update_ret(&sha, _msg + 200, MSG_LEN - 200);
+        r |= mbedtls_sha256_finish_ret(&sha, out);
+        CHECK((r == 0) && (memcmp(out, ref_sha256, 32) == 0), "%s: hash beside the MAC", mode_name(_modes[m]));
+        mbedtls_sha256_free(&sha);
+
+        /* the same context is back on the engine */
+        crpt_model_clear_stat();
+        r = mbedtls_md_hmac_reset(&ctx);
+        r |= mbedtls_md_hmac_update(&ctx, _msg, 150);
+        r |= mbedtls_md_hmac_finish(&ctx, out);
+        crpt_model_stat(CRPT_JOB_SHA, &st);
+        CHECK((r == 0) && (memcmp(out, ref, mbedtls_md_get_size(mode_md(_modes[m]))) == 0) &&
+              (st.u32Ops == 1UL), "%s: MAC after the hash", mode_name(_modes[m]));
+
+        mbedtls_md_free(&ctx);
+    }
+    printf("engine owned by a hash: done\n");
+}
+
+/* An engine error is returned, the engine is given up and the next MAC runs on it */
+static void  test_error(void)
+{
+    mbedtls_md_context_t  ctx;
+    CRPT_MODEL_STAT_T  st;
+    uint8_t   ref[64], out[64];
+    int       m, r;
+
+    fill(_key, KEY_LEN, 5);
+    fill(_msg, MSG_LEN, 6);
+
+    for (m = 0; m < 5; m++)
+    {
+        ref_hmac(_modes[m], _key, 16, _msg, 80, ref);
+        mbedtls_md_init(&ctx);
+        mbedtls_md_setup(&ctx, mode_md(_modes[m]), 1);
+
+        crpt_model_fail(CRPT_JOB_SHA, 0);
+        r = mbedtls_md_hmac_starts(&ctx, _key, 16);
+        r |= mbedtls_md_hmac_update(&ctx, _msg, 80);
+        CHECK(r == 0, "%s: MAC before the failing transfer returned %d", mode_name(_modes[m]), r);
+        r = mbedtls_md_hmac_finish(&ctx, out);
+        CHECK(r == MBEDTLS_ERR_MD_HW_ACCEL_FAILED, "%s: engine error returned %d", mode_name(_modes[m]), r);
+
+        crpt_model_clear_stat();
+        r = mbedtls_md_hmac_reset(&ctx);
+        r |= mbedtls_md_hmac_update(&ctx, _msg, 80);
+        r |= mbedtls_md_hmac_finish(&ctx, out);
+        crpt_model_stat(CRPT_JOB_SHA, &st);
+        CHECK((r == 0) && (memcmp(out, ref, mbedtls_md_get_size(mode_md(_modes[m]))) == 0) &&
+              (st.u32Ops == 1UL), "%s: MAC after an engine error", mode_name(_modes[m]));
+
+        mbedtls_md_free(&ctx);
+    }
+    printf("engine errors: done\n");
+}
+
+static void  hmac_test(void)
+{
+    crpt_test_init();
+    crpt_model_check_lock(1);
+
+    test_lengths();
+    test_owned();
+    test_error();
+
+    /* and once more with the transfers ending a while after START, the last from the interrupt */
+    crpt_model_set_latency(CRPT_JOB_SHA, 20);
+    test_lengths();
+    test_owned();
+    test_error();
+}
+
+int main(void)
+{
+    if (crpt_model_run(hmac_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
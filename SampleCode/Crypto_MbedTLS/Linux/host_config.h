@@ -0,0 +1,64 @@
+/**************************************************************************//**
+ * @file     host_config.h
+ * @version  V1.00
+ * @brief    mbedtls configuration of the Linux build of the CRPT hardware
+ *           glue. The engines are enabled as in the configuration of the
+ *           board (include/mbedtls/config.h) and run on the register model
+ *           of crpt_model.c.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef MBEDTLS_CONFIG_H
+#define MBEDTLS_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NuMicro.h"
+
+#define NUVOTON_ENABLE_AES
+#define NUVOTON_ENABLE_DES
+#define NUVOTON_ENABLE_SHA
+#define NUVOTON_ENABLE_ECC
+
+/* Small bounce buffers, so that short test buffers already take several chunks */
+#ifndef NUVOTON_AES_DMA_BUFF_SIZE
+#define NUVOTON_AES_DMA_BUFF_SIZE   64
+#endif
+#ifndef NUVOTON_DES_DMA_BUFF_SIZE
+#define NUVOTON_DES_DMA_BUFF_SIZE   16
+#endif
+#define NUVOTON_SHA_HMAC_BUFF_SIZE  256
+
+#define MBEDTLS_SELF_TEST
+
+#define MBEDTLS_CIPHER_MODE_CBC
+#define MBEDTLS_CIPHER_MODE_CFB
+#define MBEDTLS_CIPHER_MODE_CTR
+
+#define MBEDTLS_ECP_DP_SECP192R1_ENABLED
+#define MBEDTLS_ECP_DP_SECP224R1_ENABLED
+#define MBEDTLS_ECP_DP_SECP256R1_ENABLED
+#define MBEDTLS_ECP_DP_SECP384R1_ENABLED
+#define MBEDTLS_ECP_DP_SECP521R1_ENABLED
+#define MBEDTLS_ECP_NIST_OPTIM
+
+#define MBEDTLS_AES_C
+#define MBEDTLS_ASN1_PARSE_C
+#define MBEDTLS_ASN1_WRITE_C
+#define MBEDTLS_BIGNUM_C
+#define MBEDTLS_CIPHER_C
+#define MBEDTLS_DES_C
+#define MBEDTLS_ECDSA_C
+#define MBEDTLS_ECP_C
+#define MBEDTLS_GCM_C
+#define MBEDTLS_MD_C
+#define MBEDTLS_OID_C
+#define MBEDTLS_PKCS5_C
+#define MBEDTLS_SHA1_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_SHA512_C
+
+#include "mbedtls/check_config.h"
+
+#endif /* MBEDTLS_CONFIG_H */
@@ -0,0 +1,528 @@
+/**************************************************************************//**
+ * @file     job_test.c
+ * @version  V1.00
+ * @brief    Host test of the CRPT job queue of crypto.c on the register
+ *           model.
+ *
+ *           Queues jobs on the AES, SHA and ECC engines with the operations
+ *           taking a while, and checks that each engine runs its jobs in
+ *           order, that they are retired and chained from the CRYPTO
+ *           interrupt (also when it was masked for a while, or a completion
+ *           callback submits the next job), that a failed job does not stop
+ *           the queue, and the job statistics.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define JOB_MAX         8
+#define AES_LEN         64
+#define SHA_LEN         200
+#define ECC_P           0xFFFFFFFBUL
+#define LATENCY         25
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+/* A job with its start sequence, data and expected result */
+typedef struct
+{
+    CRPT_JOB_T      job;
+    CRPT_JOB_REG_T  regs[3 * 18 + 1];
+    int             id;
+    int32_t         i32Seen;        /* status when pfnDone was called */
+    uint32_t        au32In[SHA_LEN / 4 + 1];
+    uint32_t        au32Out[AES_LEN / 4];
+    uint8_t         au8Key[16];
+    uint8_t         au8Expect[AES_LEN];
+    uint32_t        au32Result[8];  /* HMAC_DGST or ECC_X1[0], read by pfnDone */
+} TEST_JOB_T;
+
+static TEST_JOB_T  _job[JOB_MAX];
+static TEST_JOB_T  _aes[JOB_MAX], _sha[JOB_MAX], _ecc[JOB_MAX];
+
+/* Order in which pfnDone was called, by job id */
+static int   _done[3 * JOB_MAX];
+static int   _done_cnt;
+
+/* A job pfnDone submits when it is called for _chain_after */
+static TEST_JOB_T  *_chain_after, *_chain_next;
+
+static void  fill(uint8_t *buf, int len, uint32_t seed)
+{
+    int   i;
+
+    for (i = 0; i < len; i++)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+static void  job_done(CRPT_JOB_T *job)
+{
+    TEST_JOB_T  *t = (TEST_JOB_T *)job->pvParam;
+    int   i;
+
+    t->i32Seen = job->i32Status;
+    if (job->u32Engine == CRPT_JOB_SHA)
+    {
+        for (i = 0; i < 8; i++)
+            t->au32Result[i] = CRPT->HMAC_DGST[i];
+    }
+    else if (job->u32Engine == CRPT_JOB_ECC)
+    {
+        t->au32Result[0] = CRPT->ECC_X1[0];
+    }
+    _done[_done_cnt++] = t->id;
+
+    if ((t == _chain_after) && (_chain_next != NULL))
+        CHECK(CRPT_JobSubmit(CRPT, &_chain_next->job) == 0, "submit from pfnDone");
+}
+
+static void  job_init(TEST_JOB_T *t, int id, uint32_t u32Engine, uint32_t u32RegCnt)
+{
+    memset(&t->job, 0, sizeof(t->job));
+    t->job.i32Status = CRPT_JOB_QUEUED;     /* not done before it has run, when submitted by pfnDone */
+    t->id = id;
+    t->i32Seen = 0;
+    t->job.u32Engine = u32Engine;
+    t->job.pRegs = t->regs;
+    t->job.u32RegCnt = u32RegCnt;
+    t->job.pfnDone = job_done;
+    t->job.pvParam = t;
+}
+
+/* ECB encryption of AES_LEN bytes on channel id % 4, the key loaded by the job */
+static void  aes_job(TEST_JOB_T *t, int id)
+{
+    uint8_t   iv[16] = { 0 };
+    uint32_t  ch = (uint32_t)id % 4UL;
+    int       i, n = 0;
+
+    fill(t->au8Key, 16, 0x1000UL + (uint32_t)id);
+    fill((uint8_t *)t->au32In, AES_LEN, 0x2000UL + (uint32_t)id);
+    ref_aes_crypt(AES_MODE_ECB, 1, t->au8Key, 128, iv, (uint8_t *)t->au32In, t->au8Expect, AES_LEN);
+
+    for (i = 0; i < 4; i++)
+    {
+        t->regs[n].pu32Reg = (volatile uint32_t *)((uint8_t *)&CRPT->AES0_KEY[i] + ch * 0x3CUL);
+        t->regs[n++].u32Val = ((uint32_t)t->au8Key[4 * i] << 24) | ((uint32_t)t->au8Key[4 * i + 1] << 16) |
+                              ((uint32_t)t->au8Key[4 * i + 2] << 8) | t->au8Key[4 * i + 3];
+    }
+    t->regs[n].pu32Reg = (volatile uint32_t *)((uint8_t *)&CRPT->AES0_SADDR + ch * 0x3CUL);
+    t->regs[n++].u32Val = (uint32_t)(uintptr_t)t->au32In;
+    t->regs[n].pu32Reg = (volatile uint32_t *)((uint8_t *)&CRPT->AES0_DADDR + ch * 0x3CUL);
+    t->regs[n++].u32Val = (uint32_t)(uintptr_t)t->au32Out;
+    t->regs[n].pu32Reg = (volatile uint32_t *)((uint8_t *)&CRPT->AES0_CNT + ch * 0x3CUL);
+    t->regs[n++].u32Val = AES_LEN;
+    t->regs[n].pu32Reg = &CRPT->AES_CTL;
+    t->regs[n++].u32Val = (ch << CRPT_AES_CTL_CHANNEL_Pos) | (AES_KEY_SIZE_128 << CRPT_AES_CTL_KEYSZ_Pos) |
+                          (AES_MODE_ECB << CRPT_AES_CTL_OPMODE_Pos) | CRPT_AES_CTL_ENCRPT_Msk |
+                          CRPT_AES_CTL_INSWAP_Msk | CRPT_AES_CTL_OUTSWAP_Msk | CRPT_AES_CTL_DMAEN_Msk |
+                          CRPT_AES_CTL_START_Msk;
+    memset(t->au32Out, 0, sizeof(t->au32Out));
+    job_init(t, id, CRPT_JOB_AES, (uint32_t)n);
+}
+
+static int  aes_ok(TEST_JOB_T *t)
+{
+    return memcmp(t->au32Out, t->au8Expect, AES_LEN) == 0;
+}
+
+/* SHA-256 of SHA_LEN bytes in one transfer */
+static void  sha_job(TEST_JOB_T *t, int id)
+{
+    fill((uint8_t *)t->au32In, SHA_LEN, 0x3000UL + (uint32_t)id);
+    ref_sha(SHA_MODE_SHA256, (uint8_t *)t->au32In, SHA_LEN, t->au8Expect);
+
+    t->regs[0].pu32Reg = &CRPT->HMAC_KEYCNT;
+    t->regs[0].u32Val = 0UL;
+    t->regs[1].pu32Reg = &CRPT->HMAC_SADDR;
+    t->regs[1].u32Val = (uint32_t)(uintptr_t)t->au32In;
+    t->regs[2].pu32Reg = &CRPT->HMAC_DMACNT;
+    t->regs[2].u32Val = SHA_LEN;
+    t->regs[3].pu32Reg = &CRPT->HMAC_CTL;
+    t->regs[3].u32Val = (SHA_MODE_SHA256 << CRPT_HMAC_CTL_OPMODE_Pos) | CRPT_HMAC_CTL_INSWAP_Msk |
+                        (CRYPTO_DMA_ONE_SHOT << CRPT_HMAC_CTL_DMALAST_Pos) | CRPT_HMAC_CTL_START_Msk;
+    memset(t->au32Result, 0, sizeof(t->au32Result));
+    job_init(t, id, CRPT_JOB_SHA, 4UL);
+}
+
+static int  sha_ok(TEST_JOB_T *t)
+{
+    int   i;
+
+    for (i = 0; i < 8; i++)
+    {
+        if (t->au32Result[i] != (((uint32_t)t->au8Expect[4 * i] << 24) | ((uint32_t)t->au8Expect[4 * i + 1] << 16) |
+                                 ((uint32_t)t->au8Expect[4 * i + 2] << 8) | t->au8Expect[4 * i + 3]))
+            return 0;
+    }
+    return 1;
+}
+
+/* (id + 2) * (id + 3) mod ECC_P, left in ECC_X1 */
+static void  ecc_job(TEST_JOB_T *t, int id)
+{
+    int   i, n = 0;
+
+    for (i = 0; i < 18; i++)
+    {
+        t->regs[n].pu32Reg = &CRPT->ECC_N[i];
+        t->regs[n++].u32Val = (i == 0) ? ECC_P : 0UL;
+        t->regs[n].pu32Reg = &CRPT->ECC_X1[i];
+        t->regs[n++].u32Val = (i == 0) ? (uint32_t)id + 2UL : 0UL;
+        t->regs[n].pu32Reg = &CRPT->ECC_Y1[i];
+        t->regs[n++].u32Val = (i == 0) ? (uint32_t)id + 3UL : 0UL;
+    }
+    t->regs[n].pu32Reg = &CRPT->ECC_CTL;
+    t->regs[n++].u32Val = CRPT_ECC_CTL_FSEL_Msk | (1UL << CRPT_ECC_CTL_ECCOP_Pos) |
+                          (1UL << CRPT_ECC_CTL_MODOP_Pos) | CRPT_ECC_CTL_START_Msk;
+    t->au32Result[0] = 0UL;
+    job_init(t, id, CRPT_JOB_ECC, (uint32_t)n);
+}
+
+static int  ecc_ok(TEST_JOB_T *t)
+{
+    return t->au32Result[0] == (uint32_t)(((uint64_t)(t->id + 2) * (uint64_t)(t->id + 3)) % ECC_P);
+}
+
+static void  wait_job(TEST_JOB_T *t)
+{
+    while (t->job.i32Status > CRPT_JOB_DONE)
+    {
+    }
+}
+
+static void  reset_done(void)
+{
+    _done_cnt = 0;
+    _chain_after = NULL;
+    _chain_next = NULL;
+    CRPT_JobClearStat();
+}
+
+/*
+ *  Jobs of one engine run one after the other in the order they were submitted, each
+ *  started from the interrupt of the one before.
+ */
+static void  test_order(void)
+{
+    CRPT_JOB_STAT_T  st;
+    uint32_t  irqs;
+    int   i, ok;
+
+    reset_done();
+    crpt_model_set_latency(CRPT_JOB_AES, LATENCY);
+
+    for (i = 0; i < JOB_MAX; i++)
+        aes_job(&_job[i], i);
+
+    irqs = crpt_model_irqs();
+    for (i = 0; i < JOB_MAX; i++)
+        CHECK(CRPT_JobSubmit(CRPT, &_job[i].job) == 0, "CRPT_JobSubmit %d", i);
+
+    CHECK(_job[0].job.i32Status == CRPT_JOB_RUNNING, "first job is not running");
+    for (i = 1; i < JOB_MAX; i++)
+        CHECK(_job[i].job.i32Status == CRPT_JOB_QUEUED, "job %d is not queued", i);
+    CRPT_JobGetStat(CRPT_JOB_AES, &st);
+    CHECK((st.u32Depth == JOB_MAX) && (st.u32Submitted == JOB_MAX), "depth %u after submitting", st.u32Depth);
+
+    wait_job(&_job[JOB_MAX - 1]);
+
+    CHECK(crpt_model_irqs() - irqs == JOB_MAX, "%u interrupts for %d jobs", crpt_model_irqs() - irqs, JOB_MAX);
+    CHECK(_done_cnt == JOB_MAX, "%d jobs done", _done_cnt);
+    for (i = 0, ok = 1; i < _done_cnt; i++)
+        ok &= (_done[i] == i);
+    CHECK(ok, "jobs done out of order");
+    for (i = 0; i < JOB_MAX; i++)
+    {
+        CHECK(_job[i].job.i32Status == CRPT_JOB_DONE, "job %d status %d", i, _job[i].job.i32Status);
+        CHECK(_job[i].i32Seen == CRPT_JOB_RUNNING, "job %d status %d in pfnDone", i, _job[i].i32Seen);
+        CHECK(aes_ok(&_job[i]), "job %d output", i);
+    }
+
+    CRPT_JobGetStat(CRPT_JOB_AES, &st);
+    CHECK((st.u32Submitted == JOB_MAX) && (st.u32Completed == JOB_MAX) && (st.u32Failed == 0UL),
+          "stat submitted %u completed %u failed %u", st.u32Submitted, st.u32Completed, st.u32Failed);
+    CHECK((st.u32Depth == 0UL) && (st.u32MaxDepth == JOB_MAX), "stat depth %u max %u", st.u32Depth, st.u32MaxDepth);
+    CHECK(st.u64BusyCycles >= (uint64_t)JOB_MAX * LATENCY, "stat busy %u", (uint32_t)st.u64BusyCycles);
+
+    printf("job order on one engine: done\n");
+}
+
+/*
+ *  The queues of the engines are independent: AES, SHA and ECC jobs submitted in turn
+ *  overlap, and the shorter operations are done first. The results left in HMAC_DGST and
+ *  ECC_X1 are read in pfnDone, before the next job of the engine overwrites them.
+ */
+static void  test_engines(void)
+{
+    CRPT_JOB_STAT_T  st;
+    int   i, a, s, e, ok;
+
+    reset_done();
+    crpt_model_set_latency(CRPT_JOB_AES, 4 * LATENCY);
+    crpt_model_set_latency(CRPT_JOB_SHA, 2 * LATENCY);
+    crpt_model_set_latency(CRPT_JOB_ECC, LATENCY);
+
+    for (i = 0; i < JOB_MAX; i++)
+    {
+        aes_job(&_aes[i], i);
+        sha_job(&_sha[i], 100 + i);
+        ecc_job(&_ecc[i], 200 + i);
+    }
+    for (i = 0; i < JOB_MAX; i++)
+    {
+        CRPT_JobSubmit(CRPT, &_aes[i].job);
+        CRPT_JobSubmit(CRPT, &_sha[i].job);
+        CRPT_JobSubmit(CRPT, &_ecc[i].job);
+    }
+    wait_job(&_aes[JOB_MAX - 1]);
+    wait_job(&_sha[JOB_MAX - 1]);
+    wait_job(&_ecc[JOB_MAX - 1]);
+
+    /* in order within each engine */
+    for (i = 0, a = 0, s = 100, e = 200, ok = 1; i < _done_cnt; i++)
+    {
+        if (_done[i] < 100)
+            ok &= (_done[i] == a++);
+        else if (_done[i] < 200)
+            ok &= (_done[i] == s++);
+        else
+            ok &= (_done[i] == e++);
+    }
+    CHECK(ok && (_done_cnt == 3 * JOB_MAX), "jobs of an engine done out of order");
+    CHECK((_done[0] == 200) && (_done[_done_cnt - 1] == JOB_MAX - 1), "the engines did not overlap");
+
+    for (i = 0; i < JOB_MAX; i++)
+    {
+        CHECK(aes_ok(&_aes[i]), "AES job %d output", i);
+        CHECK(sha_ok(&_sha[i]), "SHA job %d digest", i);
+        CHECK(ecc_ok(&_ecc[i]), "ECC job %d result 0x%08x", i, _ecc[i].au32Result[0]);
+    }
+
+    for (i = 0; i < (int)CRPT_JOB_ENGINE_CNT; i++)
+    {
+        CRPT_JobGetStat((uint32_t)i, &st);
+        CHECK((st.u32Completed == ((i == CRPT_JOB_TDES) ? 0UL : JOB_MAX)) && (st.u32Depth == 0UL),
+              "engine %d completed %u depth %u", i, st.u32Completed, st.u32Depth);
+    }
+
+    printf("jobs on three engines: done\n");
+}
+
+/*
+ *  With the CRYPTO interrupt masked, a finished job stays running and the next one is not
+ *  started; unmasking retires it and the queue carries on.
+ */
+static void  test_masked(void)
+{
+    uint32_t  irqs;
+    int   i;
+
+    reset_done();
+    crpt_model_set_latency(CRPT_JOB_AES, LATENCY);
+    for (i = 0; i < 3; i++)
+        aes_job(&_job[i], i);
+
+    __disable_irq();
+    for (i = 0; i < 3; i++)
+        CRPT_JobSubmit(CRPT, &_job[i].job);
+    irqs = crpt_model_irqs();
+
+    for (i = 0; i < 4 * LATENCY; i++)
+        (void)CRPT->AES_STS;
+
+    CHECK((CRPT->INTSTS & CRPT_INTSTS_AESIF_Msk) != 0UL, "AESIF not raised");
+    CHECK((_job[0].job.i32Status == CRPT_JOB_RUNNING) && (_job[1].job.i32Status == CRPT_JOB_QUEUED) &&
+          (_done_cnt == 0) && (crpt_model_irqs() == irqs), "jobs retired with the interrupt masked");
+
+    __enable_irq();
+    CHECK(_job[0].job.i32Status == CRPT_JOB_DONE, "first job not retired on unmasking");
+    CHECK(_job[1].job.i32Status == CRPT_JOB_RUNNING, "second job not started on unmasking");
+
+    wait_job(&_job[2]);
+    CHECK((_done_cnt == 3) && (_done[0] == 0) && (_done[1] == 1) && (_done[2] == 2), "masked jobs out of order");
+    for (i = 0; i < 3; i++)
+        CHECK(aes_ok(&_job[i]), "masked job %d output", i);
+
+    printf("jobs with the interrupt masked: done\n");
+}
+
+/*
+ *  pfnDone submits a job of its own engine: behind the queued ones, or at once when the
+ *  queue became empty. Either way it is started once.
+ */
+static void  test_chain(void)
+{
+    int   i;
+
+    reset_done();
+    crpt_model_set_latency(CRPT_JOB_SHA, LATENCY);
+    for (i = 0; i < 4; i++)
+        sha_job(&_job[i], i);
+
+    /* 0 and 1 queued, 0 adds 2 behind 1 */
+    _chain_after = &_job[0];
+    _chain_next = &_job[2];
+    CRPT_JobSubmit(CRPT, &_job[0].job);
+    CRPT_JobSubmit(CRPT, &_job[1].job);
+    wait_job(&_job[2]);
+    CHECK((_done_cnt == 3) && (_done[0] == 0) && (_done[1] == 1) && (_done[2] == 2), "chained behind the queue");
+
+    /* 3 alone, it adds 0 to the idle engine */
+    sha_job(&_job[0], 0);
+    _done_cnt = 0;
+    _chain_after = &_job[3];
+    _chain_next = &_job[0];
+    CRPT_JobSubmit(CRPT, &_job[3].job);
+    wait_job(&_job[0]);
+    CHECK((_done_cnt == 2) && (_done[0] == 3) && (_done[1] == 0), "chained on the idle engine");
+
+    for (i = 0; i < 4; i++)
+        CHECK(sha_ok(&_job[i]), "chained job %d digest", i);
+
+    printf("jobs submitted from pfnDone: done\n");
+}
+
+/*
+ *  A job the engine fails is retired with CRPT_JOB_FAILED and the jobs behind it still run.
+ */
+static void  test_failure(void)
+{
+    CRPT_JOB_STAT_T  st;
+    int   i;
+
+    reset_done();
+    crpt_model_set_latency(CRPT_JOB_AES, LATENCY);
+    for (i = 0; i < 5; i++)
+        aes_job(&_job[i], i);
+
+    crpt_model_fail(CRPT_JOB_AES, 2);
+    for (i = 0; i < 5; i++)
+        CRPT_JobSubmit(CRPT, &_job[i].job);
+    wait_job(&_job[4]);
+
+    for (i = 0; i < 5; i++)
+    {
+        if (i == 2)
+        {
+            CHECK(_job[i].job.i32Status == CRPT_JOB_FAILED, "failed job status %d", _job[i].job.i32Status);
+        }
+        else
+        {
+            CHECK(_job[i].job.i32Status == CRPT_JOB_DONE, "job %d status %d", i, _job[i].job.i32Status);
+            CHECK(aes_ok(&_job[i]), "job %d output", i);
+        }
+    }
+    CHECK((CRPT->AES_STS & CRPT_AES_STS_BUSERR_Msk) == 0UL, "BUSERR left from the failed job");
+
+    CRPT_JobGetStat(CRPT_JOB_AES, &st);
+    CHECK((st.u32Completed == 5UL) && (st.u32Failed == 1UL), "stat completed %u failed %u",
+          st.u32Completed, st.u32Failed);
+
+    /* CRPT_JobRun() reports it too */
+    aes_job(&_job[0], 0);
+    crpt_model_fail(CRPT_JOB_AES, 0);
+    CHECK(CRPT_JobRun(CRPT, &_job[0].job) == CRPT_JOB_FAILED, "CRPT_JobRun of a failing job");
+    aes_job(&_job[0], 0);
+    CHECK(CRPT_JobRun(CRPT, &_job[0].job) == CRPT_JOB_DONE, "CRPT_JobRun after a failure");
+    CHECK(aes_ok(&_job[0]), "CRPT_JobRun output");
+
+    printf("failed jobs: done\n");
+}
+
+static int  _runner_calls;
+
+static int32_t  runner(CRPT_T *crpt, CRPT_JOB_T *job)
+{
+    _runner_calls++;
+    job->pfnDone = NULL;
+    if (CRPT_JobSubmit(crpt, job) != 0)
+        return -1;
+    while (job->i32Status > CRPT_JOB_DONE)
+    {
+    }
+    return job->i32Status;
+}
+
+/*
+ *  CRPT_JobRun() with and without a runner, bad engines, the lock hooks, and the
+ *  statistics that CRPT_JobClearStat() keeps.
+ */
+static void  test_api(void)
+{
+    CRPT_JOB_STAT_T  st;
+
+    reset_done();
+
+    aes_job(&_job[0], 0);
+    _job[0].job.u32Engine = CRPT_JOB_ENGINE_CNT;
+    CHECK(CRPT_JobSubmit(CRPT, &_job[0].job) == -1, "CRPT_JobSubmit of a bad engine");
+    CHECK(CRPT_JobRun(CRPT, &_job[0].job) == -1, "CRPT_JobRun of a bad engine");
+
+    CRPT_JobSetRunner(runner);
+    aes_job(&_job[0], 0);
+    CHECK(CRPT_JobRun(CRPT, &_job[0].job) == CRPT_JOB_DONE, "CRPT_JobRun with a runner");
+    CHECK((_runner_calls == 1) && aes_ok(&_job[0]), "runner not used");
+    CRPT_JobSetRunner(NULL);
+    aes_job(&_job[0], 0);
+    CHECK(CRPT_JobRun(CRPT, &_job[0].job) == CRPT_JOB_DONE, "CRPT_JobRun without a runner");
+    CHECK(_runner_calls == 1, "runner used after removing it");
+
+    CRPT_JobLock(CRPT_JOB_TDES);
+    CRPT_JobLock(CRPT_JOB_TDES);
+    CHECK(crpt_model_lock_depth(CRPT_JOB_TDES) == 2UL, "recursive CRPT_JobLock");
+    CRPT_JobUnlock(CRPT_JOB_TDES);
+    CRPT_JobUnlock(CRPT_JOB_TDES);
+    CHECK(crpt_model_lock_depth(CRPT_JOB_TDES) == 0UL, "CRPT_JobUnlock");
+
+    /* ClearStat keeps the depth of a queue that is not empty */
+    crpt_model_set_latency(CRPT_JOB_AES, LATENCY);
+    aes_job(&_job[0], 0);
+    aes_job(&_job[1], 1);
+    CRPT_JobSubmit(CRPT, &_job[0].job);
+    CRPT_JobSubmit(CRPT, &_job[1].job);
+    CRPT_JobClearStat();
+    CRPT_JobGetStat(CRPT_JOB_AES, &st);
+    CHECK((st.u32Submitted == 0UL) && (st.u32Depth == 2UL) && (st.u32MaxDepth == 2UL),
+          "stat after CRPT_JobClearStat: submitted %u depth %u", st.u32Submitted, st.u32Depth);
+    wait_job(&_job[1]);
+    CRPT_JobGetStat(CRPT_JOB_AES, &st);
+    CHECK((st.u32Completed == 2UL) && (st.u32Depth == 0UL), "stat completed %u depth %u",
+          st.u32Completed, st.u32Depth);
+
+    printf("job API: done\n");
+}
+
+static void  job_test(void)
+{
+    crpt_test_init();
+
+    test_order();
+    test_engines();
+    test_masked();
+    test_chain();
+    test_failure();
+    test_api();
+}
+
+int main(void)
+{
+    if (crpt_model_run(job_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
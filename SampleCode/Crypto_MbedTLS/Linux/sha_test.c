@@ -0,0 +1,441 @@
+/**************************************************************************//**
+ * @file     sha_test.c
+ * @version  V1.00
+ * @brief    Host test of the SHA engine glue of sha1.c, sha256.c and
+ *           sha512.c on the register model.
+ *
+ *           Runs the FIPS 180 vectors of test_suit_sha in one call and
+ *           split over several, from word aligned and unaligned buffers.
+ *           Contexts are cloned at every point of a stream, which moves the
+ *           owner of the engine to software with the state read back from
+ *           HMAC_DGST, and the engine is taken up again by the next context.
+ *           Engine errors of intermediate and last transfers must come back
+ *           as MBEDTLS_ERR_SHAxxx_HW_ACCEL_FAILED.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+
+#include "crpt_model.h"
+#include "test_util.h"
+
+#define MSG_LEN         1000
+#define MSG_MAX         2048                    /* longest vector of the suite            */
+
+#define CHECK(c, ...)   do { if (!(c)) { printf("  FAILED: " __VA_ARGS__); printf("\n"); ret = 1; } } while (0)
+
+static int  ret;
+
+/* A context of any of the SHA modes */
+typedef struct
+{
+    uint32_t  mode;
+    union
+    {
+        mbedtls_sha1_context    sha1;
+        mbedtls_sha256_context  sha256;
+        mbedtls_sha512_context  sha512;
+    } u;
+} HASH_T;
+
+static const uint32_t  _modes[] = { SHA_MODE_SHA1, SHA_MODE_SHA224, SHA_MODE_SHA256, SHA_MODE_SHA384, SHA_MODE_SHA512 };
+
+static uint8_t  _msg[MSG_MAX + 8] __attribute__((aligned(4)));
+
+static const char  *mode_name(uint32_t mode)
+{
+    switch (mode)
+    {
+    case SHA_MODE_SHA1:
+        return "SHA-1";
+    case SHA_MODE_SHA224:
+        return "SHA-224";
+    case SHA_MODE_SHA256:
+        return "SHA-256";
+    case SHA_MODE_SHA384:
+        return "SHA-384";
+    default:
+        return "SHA-512";
+    }
+}
+
+static int  hash_size(uint32_t mode)
+{
+    static const int  size[] = { 20, 0, 0, 0, 32, 28, 64, 48 };
+
+    return size[mode];
+}
+
+static int  hash_block(uint32_t mode)
+{
+    return (mode >= SHA_MODE_SHA512) ? 128 : 64;
+}
+
+static int  hash_starts(HASH_T *h, uint32_t mode)
+{
+    h->mode = mode;
+    switch (mode)
+    {
+    case SHA_MODE_SHA1:
+        mbedtls_sha1_init(&h->u.sha1);
+        return mbedtls_sha1_starts_ret(&h->u.sha1);
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        mbedtls_sha256_init(&h->u.sha256);
+        return mbedtls_sha256_starts_ret(&h->u.sha256, mode == SHA_MODE_SHA224);
+    default:
+        mbedtls_sha512_init(&h->u.sha512);
+        return mbedtls_sha512_starts_ret(&h->u.sha512, mode == SHA_MODE_SHA384);
+    }
+}
+
+static int  hash_update(HASH_T *h, const uint8_t *in, size_t len)
+{
+    switch (h->mode)
+    {
+    case SHA_MODE_SHA1:
+        return mbedtls_sha1_update_ret(&h->u.sha1, in, len);
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        return mbedtls_sha256_update_ret(&h->u.sha256, in, len);
+    default:
+        return mbedtls_sha512_update_ret(&h->u.sha512, in, len);
+    }
+}
+
+static int  hash_finish(HASH_T *h, uint8_t *out)
+{
+    switch (h->mode)
+    {
+    case SHA_MODE_SHA1:
+        return mbedtls_sha1_finish_ret(&h->u.sha1, out);
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        return mbedtls_sha256_finish_ret(&h->u.sha256, out);
+    default:
+        return mbedtls_sha512_finish_ret(&h->u.sha512, out);
+    }
+}
+
+static void  hash_clone(HASH_T *dst, const HASH_T *src)
+{
+    dst->mode = src->mode;
+    switch (src->mode)
+    {
+    case SHA_MODE_SHA1:
+        mbedtls_sha1_init(&dst->u.sha1);
+        mbedtls_sha1_clone(&dst->u.sha1, &src->u.sha1);
+        break;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        mbedtls_sha256_init(&dst->u.sha256);
+        mbedtls_sha256_clone(&dst->u.sha256, &src->u.sha256);
+        break;
+    default:
+        mbedtls_sha512_init(&dst->u.sha512);
+        mbedtls_sha512_clone(&dst->u.sha512, &src->u.sha512);
+        break;
+    }
+}
+
+static void  hash_free(HASH_T *h)
+{
+    switch (h->mode)
+    {
+    case SHA_MODE_SHA1:
+        mbedtls_sha1_free(&h->u.sha1);
+        break;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        mbedtls_sha256_free(&h->u.sha256);
+        break;
+    default:
+        mbedtls_sha512_free(&h->u.sha512);
+        break;
+    }
+}
+
+/* The context streams through the engine */
+static int  hash_on_engine(HASH_T *h)
+{
+    switch (h->mode)
+    {
+    case SHA_MODE_SHA1:
+        return h->u.sha1.nvt_hw;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        return h->u.sha256.nvt_hw;
+    default:
+        return h->u.sha512.nvt_hw;
+    }
+}
+
+static int  hash_hw_error(uint32_t mode)
+{
+    switch (mode)
+    {
+    case SHA_MODE_SHA1:
+        return MBEDTLS_ERR_SHA1_HW_ACCEL_FAILED;
+    case SHA_MODE_SHA224:
+    case SHA_MODE_SHA256:
+        return MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED;
+    default:
+        return MBEDTLS_ERR_SHA512_HW_ACCEL_FAILED;
+    }
+}
+
+static uint32_t  vector_mode(const char *func)
+{
+    if (strcmp(func, "mbedtls_sha1") == 0)
+        return SHA_MODE_SHA1;
+    if (strcmp(func, "sha224") == 0)
+        return SHA_MODE_SHA224;
+    if (strcmp(func, "mbedtls_sha256") == 0)
+        return SHA_MODE_SHA256;
+    if (strcmp(func, "sha384") == 0)
+        return SHA_MODE_SHA384;
+    if (strcmp(func, "mbedtls_sha512") == 0)
+        return SHA_MODE_SHA512;
+    return (uint32_t)-1;
+}
+
+/* Hash len bytes at in, in <pieces> calls of about the same size */
+static int  hash_pieces(uint32_t mode, const uint8_t *in, size_t len, int pieces, uint8_t *out)
+{
+    HASH_T    h;
+    size_t    pos, n;
+    int       i, r;
+
+    r = hash_starts(&h, mode);
+    for (i = 0, pos = 0; (r == 0) && (i < pieces); i++, pos += n)
+    {
+        n = (i == pieces - 1) ? len - pos : len / pieces;
+        r = hash_update(&h, in + pos, n);
+    }
+    if (r == 0)
+        r = hash_finish(&h, out);
+    hash_free(&h);
+    return r;
+}
+
+static void  test_vectors(void)
+{
+    static const int  pieces[] = { 1, 2, 3, 7 };
+    TEST_CASE_T  tc;
+    FILE      *fp;
+    uint8_t   expect[64], out[64];
+    uint32_t  mode;
+    int       len, off, p, n = 0;
+
+    fp = test_data_open("test_suit_sha", "test_suite_shax.data");
+    CHECK(fp != NULL, "test_suite_shax.data");
+    if (fp == NULL)
+        return;
+
+    memset(&tc, 0, sizeof(tc));
+    while (test_data_next(fp, &tc))
+    {
+        mode = vector_mode(tc.func);
+        if (mode == (uint32_t)-1)
+            continue;               /* the self tests, run below */
+
+        test_unhex(tc.argv[1], expect);
+        for (off = 0; off < 2; off++)
+        {
+            len = test_unhex(tc.argv[0], _msg + off);
+            for (p = 0; p < 4; p++)
+            {
+                memset(out, 0, sizeof(out));
+                CHECK((hash_pieces(mode, _msg + off, len, pieces[p], out) == 0) &&
+                      (memcmp(out, expect, hash_size(mode)) == 0),
+                      "line %d, %s, %s input, %d calls", tc.line_no, tc.desc, off ? "unaligned" : "aligned",
+                      pieces[p]);
+            }
+        }
+        n++;
+    }
+    fclose(fp);
+    printf("test_suite_shax.data: %d vectors\n", n);
+}
+
+static void  fill(uint8_t *buf, int len, uint32_t seed)
+{
+    while (len-- > 0)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        *buf++ = (uint8_t)(seed >> 16);
+    }
+}
+
+/*
+ *  A clone moves the owner of the engine to software, with the running state read from
+ *  HMAC_DGST. Both copies must then finish to the digest of the whole message, and the
+ *  engine is free for the next context to start.
+ */
+static void  test_detach(void)
+{
+    static const int  split[] = { 0, 1, 63, 64, 65, 127, 128, 129, 200, 256, 257, 640, 999, 1000 };
+    CRPT_MODEL_STAT_T  st;
+    HASH_T    h, copy, next;
+    uint8_t   ref[64], out[64], out2[64];
+    int       m, s, r;
+
+    fill(_msg, MSG_LEN, 1);
+
+    for (m = 0; m < 5; m++)
+    {
+        ref_sha(_modes[m], _msg, MSG_LEN, ref);
+        for (s = 0; s < (int)(sizeof(split) / sizeof(split[0])); s++)
+        {
+            crpt_model_clear_stat();
+            r = hash_starts(&h, _modes[m]);
+            CHECK(hash_on_engine(&h), "%s: context did not get the engine", mode_name(_modes[m]));
+            r |= hash_update(&h, _msg, split[s]);
+            crpt_model_stat(CRPT_JOB_SHA, &st);
+
+            hash_clone(&copy, &h);
+            CHECK(!hash_on_engine(&h) && !hash_on_engine(&copy), "%s: clone at %d left a context on the engine",
+                  mode_name(_modes[m]), split[s]);
+
+            /* the engine is free again */
+            r |= hash_starts(&next, _modes[m]);
+            CHECK(hash_on_engine(&next), "%s: engine not free after the clone at %d", mode_name(_modes[m]),
+                  split[s]);
+
+            r |= hash_update(&h, _msg + split[s], MSG_LEN - split[s]);
+            r |= hash_update(&copy, _msg + split[s], MSG_LEN - split[s]);
+            r |= hash_update(&next, _msg, MSG_LEN);
+            r |= hash_finish(&h, out);
+            r |= hash_finish(&copy, out2);
+            CHECK((r == 0) && (memcmp(out, ref, hash_size(_modes[m])) == 0) &&
+                  (memcmp(out2, ref, hash_size(_modes[m])) == 0),
+                  "%s: detached at %d after %u transfers", mode_name(_modes[m]), split[s], st.u32Ops);
+            r = hash_finish(&next, out);
+            CHECK((r == 0) && (memcmp(out, ref, hash_size(_modes[m])) == 0),
+                  "%s: context that took the engine up after the clone at %d", mode_name(_modes[m]), split[s]);
+
+            hash_free(&h);
+            hash_free(&copy);
+            hash_free(&next);
+        }
+    }
+    printf("detach and reattach: done\n");
+}
+
+/* A context started while the engine is owned hashes in software, interleaved with the owner */
+static void  test_shared(void)
+{
+    CRPT_MODEL_STAT_T  st;
+    HASH_T    a, b;
+    uint8_t   ref_a[64], ref_b[64], out[64];
+    int       m, pos, r;
+
+    fill(_msg, MSG_LEN, 2);
+
+    for (m = 0; m < 5; m++)
+    {
+        ref_sha(_modes[m], _msg, MSG_LEN, ref_a);
+        ref_sha(_modes[m == 0 ? 4 : 0], _msg + 1, MSG_LEN - 1, ref_b);
+
+        crpt_model_clear_stat();
+        r = hash_starts(&a, _modes[m]);
+        r |= hash_starts(&b, _modes[m == 0 ? 4 : 0]);
+        CHECK(hash_on_engine(&a) && !hash_on_engine(&b), "%s: the engine is owned by one context",
+              mode_name(_modes[m]));
+
+        for (pos = 0; pos < MSG_LEN; pos += 100)
+        {
+            r |= hash_update(&a, _msg + pos, 100);
+            r |= hash_update(&b, _msg + 1 + pos, (pos + 100 < MSG_LEN) ? 100 : 99);
+        }
+        r |= hash_finish(&b, out);
+        CHECK((r == 0) && (memcmp(out, ref_b, hash_size(b.mode)) == 0), "%s in software beside %s",
+              mode_name(b.mode), mode_name(a.mode));
+        r |= hash_finish(&a, out);
+        CHECK((r == 0) && (memcmp(out, ref_a, hash_size(a.mode)) == 0), "%s on the engine beside %s",
+              mode_name(a.mode), mode_name(b.mode));
+        crpt_model_stat(CRPT_JOB_SHA, &st);
+        CHECK(st.u64Bytes == MSG_LEN, "%s: the engine read %u bytes", mode_name(a.mode), (uint32_t)st.u64Bytes);
+
+        hash_free(&a);
+        hash_free(&b);
+    }
+    printf("shared engine: done\n");
+}
+
+/* Engine errors are returned, the engine is given up and the next hash runs on it */
+static void  test_error(void)
+{
+    HASH_T    h;
+    uint8_t   ref[64], out[64];
+    int       m, r;
+
+    fill(_msg, MSG_LEN, 3);
+
+    for (m = 0; m < 5; m++)
+    {
+        ref_sha(_modes[m], _msg, MSG_LEN, ref);
+
+        /* the first, intermediate transfer fails */
+        crpt_model_fail(CRPT_JOB_SHA, 0);
+        hash_starts(&h, _modes[m]);
+        hash_update(&h, _msg, 10);
+        r = hash_update(&h, _msg + 10, MSG_LEN - 10);
+        CHECK(r == hash_hw_error(_modes[m]), "%s: intermediate transfer error returned %d", mode_name(_modes[m]), r);
+        CHECK(!hash_on_engine(&h), "%s: failed context kept the engine", mode_name(_modes[m]));
+        hash_free(&h);
+
+        /* a block and a bit: the block goes in the first transfer, the last one fails */
+        crpt_model_fail(CRPT_JOB_SHA, 1);
+        hash_starts(&h, _modes[m]);
+        r = hash_update(&h, _msg, hash_block(_modes[m]) + 10);
+        CHECK(r == 0, "%s: transfer before the failing one returned %d", mode_name(_modes[m]), r);
+        r = hash_finish(&h, out);
+        CHECK(r == hash_hw_error(_modes[m]), "%s: last transfer error returned %d", mode_name(_modes[m]), r);
+        hash_free(&h);
+
+        r = hash_pieces(_modes[m], _msg, MSG_LEN, 3, out);
+        CHECK((r == 0) && (memcmp(out, ref, hash_size(_modes[m])) == 0), "%s: hash after an engine error",
+              mode_name(_modes[m]));
+    }
+    printf("engine errors: done\n");
+}
+
+static void  sha_test(void)
+{
+    crpt_test_init();
+    crpt_model_check_lock(1);
+
+    test_vectors();
+
+    CHECK(mbedtls_sha1_self_test(0) == 0, "mbedtls_sha1_self_test");
+    CHECK(mbedtls_sha256_self_test(0) == 0, "mbedtls_sha256_self_test");
+    CHECK(mbedtls_sha512_self_test(0) == 0, "mbedtls_sha512_self_test");
+
+    test_detach();
+    test_shared();
+    test_error();
+
+    /* and once more with the transfers ending a while after START, the last from the interrupt */
+    crpt_model_set_latency(CRPT_JOB_SHA, 20);
+    test_vectors();
+    test_detach();
+    test_error();
+}
+
+int main(void)
+{
+    if (crpt_model_run(sha_test) < 0)
+        return 1;
+
+    printf("%u CRYPTO interrupts\n", crpt_model_irqs());
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
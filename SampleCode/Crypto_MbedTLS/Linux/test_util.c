@@ -0,0 +1,133 @@
+/**************************************************************************//**
+ * @file     test_util.c
+ * @version  V1.00
+ * @brief    Helpers shared by the host tests of the CRPT hardware glue.
+ *           Built with the instrumented driver objects, so the interrupt
+ *           flags it clears reach the register model.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "crpt_model.h"
+#include "test_util.h"
+
+volatile int  g_Crypto_Int_done;
+
+/* As in the LwIP samples */
+void CRYPTO_IRQHandler()
+{
+    /* Flags of the engines without CRPT jobs, the job queue handles the others */
+    uint32_t  u32Sts = CRPT_JobIRQHandler(CRPT);
+
+    if (u32Sts & (CRPT_INTSTS_AESIF_Msk | CRPT_INTSTS_AESEIF_Msk))
+    {
+        g_Crypto_Int_done = 1;
+        AES_CLR_INT_FLAG(CRPT);
+    }
+    if (u32Sts & (CRPT_INTSTS_TDESIF_Msk | CRPT_INTSTS_TDESEIF_Msk))
+    {
+        g_Crypto_Int_done = 1;
+        TDES_CLR_INT_FLAG(CRPT);
+    }
+    if (u32Sts & (CRPT_INTSTS_HMACIF_Msk | CRPT_INTSTS_HMACEIF_Msk))
+    {
+        g_Crypto_Int_done = 1;
+        SHA_CLR_INT_FLAG(CRPT);
+    }
+    ECC_Complete(CRPT);
+}
+
+void  crpt_test_init(void)
+{
+    CRPT_JobSetLock(crpt_model_lock, crpt_model_unlock);
+    NVIC_EnableIRQ(CRPT_IRQn);
+    ECC_ENABLE_INT(CRPT);
+    SHA_ENABLE_INT(CRPT);
+    TDES_ENABLE_INT(CRPT);
+    AES_ENABLE_INT(CRPT);
+}
+
+FILE *  test_data_open(const char *dir, const char *name)
+{
+    char  path[256];
+    FILE  *fp;
+
+    snprintf(path, sizeof(path), "../%s/%s", dir, name);
+    fp = fopen(path, "r");
+    if (fp == NULL)
+        printf("cannot open %s, run the test from its directory\n", path);
+    return fp;
+}
+
+static void  strip(char *s)
+{
+    size_t  n = strlen(s);
+
+    while ((n > 0) && ((s[n - 1] == '\n') || (s[n - 1] == '\r') || (s[n - 1] == ' ')))
+        s[--n] = 0;
+}
+
+int  test_data_next(FILE *fp, TEST_CASE_T *tc)
+{
+    char  *p, *q;
+
+    /* description, then optional depends_on, then the function line */
+    do
+    {
+        if (fgets(tc->desc, sizeof(tc->desc), fp) == NULL)
+            return 0;
+        tc->line_no++;
+        strip(tc->desc);
+    } while (tc->desc[0] == 0);
+
+    do
+    {
+        if (fgets(tc->line, sizeof(tc->line), fp) == NULL)
+            return 0;
+        tc->line_no++;
+        strip(tc->line);
+    } while (strncmp(tc->line, "depends_on:", 11) == 0);
+
+    /* func:"arg":"arg":int ... */
+    tc->func = tc->line;
+    tc->argc = 0;
+    p = strchr(tc->line, ':');
+    while ((p != NULL) && (tc->argc < TEST_ARG_MAX))
+    {
+        *p++ = 0;
+        if (*p == '"')
+        {
+            p++;
+            q = strchr(p, '"');
+            if (q == NULL)
+                break;
+            *q++ = 0;
+            tc->argv[tc->argc++] = p;
+            p = (*q == ':') ? q : NULL;
+        }
+        else
+        {
+            tc->argv[tc->argc++] = p;
+            p = strchr(p, ':');
+        }
+    }
+    return 1;
+}
+
+int  test_unhex(const char *hex, uint8_t *out)
+{
+    unsigned int  v;
+    int   n = 0;
+
+    while ((hex[0] != 0) && (hex[1] != 0))
+    {
+        sscanf(hex, "%2x", &v);
+        out[n++] = (uint8_t)v;
+        hex += 2;
+    }
+    return n;
+}
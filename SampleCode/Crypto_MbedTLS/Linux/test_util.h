@@ -0,0 +1,52 @@
+/**************************************************************************//**
+ * @file     test_util.h
+ * @version  V1.00
+ * @brief    Helpers shared by the host tests of the CRPT hardware glue:
+ *           the CRYPTO interrupt handler of the board samples and a reader
+ *           of the mbedtls test suite .data files.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TEST_ARG_MAX        12
+
+/* One test case of a .data file, its arguments with the quotes removed */
+typedef struct
+{
+    int     line_no;
+    char    desc[256];
+    char    line[8192];
+    char    *func;
+    int     argc;
+    char    *argv[TEST_ARG_MAX];
+} TEST_CASE_T;
+
+/**
+  * @brief    Open a .data file of a test suite sample, ../<dir>/<name>.
+  * @return   The file, or NULL with a message printed.
+  */
+FILE *  test_data_open(const char *dir, const char *name);
+
+/**
+  * @brief    Read the next test case. depends_on lines are skipped, all the
+  *           options the suites depend on are enabled in host_config.h.
+  * @return   1, or 0 at the end of the file.
+  */
+int     test_data_next(FILE *fp, TEST_CASE_T *tc);
+
+/* Decode a hex string into out[], returns the byte count */
+int     test_unhex(const char *hex, uint8_t *out);
+
+/* Enable the CRYPTO interrupt and the interrupts of all engines, as the board samples do,
+   and install the engine locks of the model */
+void    crpt_test_init(void);
+
+/* Counted by CRYPTO_IRQHandler() for flags without a job queued */
+extern volatile int  g_Crypto_Int_done;
+
+#endif /* _TEST_UTIL_H_ */
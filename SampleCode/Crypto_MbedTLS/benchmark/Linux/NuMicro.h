@@ -0,0 +1,62 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @version  V1.00
+ * @brief    Host stand-in of the M480 device header for the Linux build of
+ *           the crypto benchmark. It declares just what the TRNG driver
+ *           (Library/StdDriver/src/trng.c) touches; host_trng.c models the
+ *           TRNG register file and the interrupt behind it.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The model writes the read-only registers, so none of them is const */
+#define __I     volatile
+#define __O     volatile
+#define __IO    volatile
+
+#include "trng_reg.h"
+
+typedef struct
+{
+    __IO uint32_t IPRST1;
+} SYS_T;
+
+#define SYS_IPRST1_TRNGRST_Pos      (31)
+#define SYS_IPRST1_TRNGRST_Msk      (0x1ul << SYS_IPRST1_TRNGRST_Pos)
+
+extern SYS_T  g_HostSys;
+extern TRNG_T g_HostTrng;
+
+#define SYS     (&g_HostSys)
+#define TRNG    (&g_HostTrng)
+
+uint32_t CLK_GetHCLKFreq(void);
+
+/* PRIMASK is a lock shared with the TRNG interrupt of the model */
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t u32PriMask);
+void __disable_irq(void);
+
+/* Provided by the application, like on the board */
+void TRNG_IRQHandler(void);
+
+/* Run the TRNG model, one byte every u32ByteNs nanoseconds */
+void host_trng_start(uint32_t u32ByteNs);
+void host_trng_stop(void);
+
+#include "trng.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,198 @@
+/**************************************************************************//**
+ * @file     ecp_comb_gen.c
+ * @version  V1.00
+ * @brief    Generate the fixed-base comb tables of the software point
+ *           multiplication (ecp.c) as const C tables, so they live in flash
+ *           instead of being built on the heap at run time:
+ *
+ *             ./ecp_comb_gen secp256r1 brainpoolP256r1 > ecp_comb_rom.h
+ *
+ *           Without arguments, every short Weierstrass curve of
+ *           host_config.h is emitted. Build the target with
+ *           NUVOTON_ECP_COMB_ROM defined as "ecp_comb_rom.h". The tables
+ *           depend on MBEDTLS_ECP_WINDOW_SIZE; ecp.c ignores a table whose
+ *           size does not match its own.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "mbedtls/ecp.h"
+
+
+#define GEN_MAX_CURVES      16
+
+/* Config switch and enum name of each curve, for the #if around its table */
+static const struct
+{
+    mbedtls_ecp_group_id  id;
+    const char            *pcMacro;
+    const char            *pcEnum;
+} s_aCurve[] =
+{
+    { MBEDTLS_ECP_DP_SECP192R1, "MBEDTLS_ECP_DP_SECP192R1_ENABLED", "MBEDTLS_ECP_DP_SECP192R1" },
+    { MBEDTLS_ECP_DP_SECP224R1, "MBEDTLS_ECP_DP_SECP224R1_ENABLED", "MBEDTLS_ECP_DP_SECP224R1" },
+    { MBEDTLS_ECP_DP_SECP256R1, "MBEDTLS_ECP_DP_SECP256R1_ENABLED", "MBEDTLS_ECP_DP_SECP256R1" },
+    { MBEDTLS_ECP_DP_SECP384R1, "MBEDTLS_ECP_DP_SECP384R1_ENABLED", "MBEDTLS_ECP_DP_SECP384R1" },
+    { MBEDTLS_ECP_DP_SECP521R1, "MBEDTLS_ECP_DP_SECP521R1_ENABLED", "MBEDTLS_ECP_DP_SECP521R1" },
+    { MBEDTLS_ECP_DP_BP256R1,   "MBEDTLS_ECP_DP_BP256R1_ENABLED",   "MBEDTLS_ECP_DP_BP256R1"   },
+    { MBEDTLS_ECP_DP_BP384R1,   "MBEDTLS_ECP_DP_BP384R1_ENABLED",   "MBEDTLS_ECP_DP_BP384R1"   },
+    { MBEDTLS_ECP_DP_BP512R1,   "MBEDTLS_ECP_DP_BP512R1_ENABLED",   "MBEDTLS_ECP_DP_BP512R1"   },
+    { MBEDTLS_ECP_DP_SECP192K1, "MBEDTLS_ECP_DP_SECP192K1_ENABLED", "MBEDTLS_ECP_DP_SECP192K1" },
+    { MBEDTLS_ECP_DP_SECP224K1, "MBEDTLS_ECP_DP_SECP224K1_ENABLED", "MBEDTLS_ECP_DP_SECP224K1" },
+    { MBEDTLS_ECP_DP_SECP256K1, "MBEDTLS_ECP_DP_SECP256K1_ENABLED", "MBEDTLS_ECP_DP_SECP256K1" },
+};
+
+#define GEN_NB_CURVES       (sizeof(s_aCurve) / sizeof(s_aCurve[0]))
+
+
+/*
+ *  One coordinate, least significant word first, two words per NVT_COMB_U64()
+ */
+static void gen_mpi(const char *pcName, const char *pcCoord, size_t i,
+                    const mbedtls_mpi *X, size_t u32Words)
+{
+    unsigned char  au8Buf[MBEDTLS_ECP_MAX_BYTES + 8];
+    const unsigned char  *p;
+    size_t  u32Len = u32Words * 4, w;
+    uint32_t  lo, hi;
+
+    mbedtls_mpi_write_binary(X, au8Buf, u32Len);
+
+    printf("static const mbedtls_mpi_uint nvt_comb_%s_%s%u[] =\n{", pcName, pcCoord, (unsigned)i);
+    for (w = 0; w < u32Words; w += 2)
+    {
+        p = au8Buf + u32Len - 4 * w;
+        lo = ((uint32_t)p[-4] << 24) | ((uint32_t)p[-3] << 16) | ((uint32_t)p[-2] << 8) | p[-1];
+        hi = ((uint32_t)p[-8] << 24) | ((uint32_t)p[-7] << 16) | ((uint32_t)p[-6] << 8) | p[-5];
+        printf("%s NVT_COMB_U64( 0x%08X, 0x%08X ),", (w % 4 == 0) ? "\n   " : "", (unsigned)lo, (unsigned)hi);
+    }
+    printf("\n};\n");
+}
+
+/*
+ *  The table of one curve. Returns its number of points, 0 on failure.
+ */
+static size_t gen_curve(size_t c, const char *pcName)
+{
+    mbedtls_ecp_group  grp;
+    mbedtls_ecp_point  R;
+    mbedtls_mpi  one;
+    size_t  i, u32Words, u32Len = 0;
+    int  ret;
+
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_ecp_point_init(&R);
+    mbedtls_mpi_init(&one);
+
+    /* Any multiplication of G leaves its table in grp.T */
+    ret = mbedtls_ecp_group_load(&grp, s_aCurve[c].id);
+    if (ret == 0)
+        ret = mbedtls_mpi_lset(&one, 1);
+    if (ret == 0)
+        ret = mbedtls_ecp_mul(&grp, &R, &one, &grp.G, NULL, NULL);
+    if (ret == 0 && grp.T == NULL)
+        ret = MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+    if (ret != 0)
+    {
+        fprintf(stderr, "%s: no comb table: -0x%04x\n", pcName, (unsigned)-ret);
+        goto exit;
+    }
+
+    /* Whole 64-bit limbs, so the table builds for either limb size */
+    u32Words = ((mbedtls_mpi_bitlen(&grp.P) + 63) / 64) * 2;
+
+    printf("\n#if defined(%s)\n", s_aCurve[c].pcMacro);
+    for (i = 0; i < grp.T_size; i++)
+    {
+        /* ecp_normalize_jac_many() frees Z of the points it normalizes */
+        if (grp.T[i].Z.p != NULL && mbedtls_mpi_cmp_int(&grp.T[i].Z, 1) != 0)
+        {
+            fprintf(stderr, "%s: point %u is not normalized\n", pcName, (unsigned)i);
+            goto exit;
+        }
+        gen_mpi(pcName, "x", i, &grp.T[i].X, u32Words);
+        gen_mpi(pcName, "y", i, &grp.T[i].Y, u32Words);
+    }
+
+    printf("\nstatic const mbedtls_ecp_point nvt_comb_%s[] =\n{\n", pcName);
+    for (i = 0; i < grp.T_size; i++)
+        printf("    NVT_COMB_POINT( nvt_comb_%s_x%u, nvt_comb_%s_y%u ),\n", pcName, (unsigned)i, pcName, (unsigned)i);
+    printf("};\n#endif\n");
+
+    u32Len = grp.T_size;
+
+exit:
+    mbedtls_mpi_free(&one);
+    mbedtls_ecp_point_free(&R);
+    mbedtls_ecp_group_free(&grp);
+    return u32Len;
+}
+
+int main(int argc, char *argv[])
+{
+    const mbedtls_ecp_curve_info  *pInfo;
+    size_t  au32Curve[GEN_MAX_CURVES], au32Len[GEN_MAX_CURVES];
+    size_t  c, i, n = 0;
+
+    /* Pick the curves */
+    for (c = 0; c < GEN_NB_CURVES; c++)
+    {
+        pInfo = mbedtls_ecp_curve_info_from_grp_id(s_aCurve[c].id);
+        if (pInfo == NULL)
+            continue;
+
+        if (argc > 1)
+        {
+            for (i = 1; i < (size_t)argc; i++)
+            {
+                if (strcmp(argv[i], pInfo->name) == 0)
+                    break;
+            }
+            if (i == (size_t)argc)
+                continue;
+        }
+        au32Curve[n++] = c;
+    }
+
+    for (i = 1; i < (size_t)argc; i++)
+    {
+        pInfo = mbedtls_ecp_curve_info_from_name(argv[i]);
+        for (c = 0; c < n; c++)
+        {
+            if (pInfo != NULL && s_aCurve[au32Curve[c]].id == pInfo->grp_id)
+                break;
+        }
+        if (c == n)
+        {
+            fprintf(stderr, "%s: unknown or not a short Weierstrass curve\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf("/*\n");
+    printf(" * Fixed-base comb tables for ecp.c, see NUVOTON_ECP_COMB_ROM.\n");
+    printf(" * Generated by ecp_comb_gen for MBEDTLS_ECP_WINDOW_SIZE %d. Do not edit.\n", MBEDTLS_ECP_WINDOW_SIZE);
+    printf(" */\n");
+
+    for (c = 0; c < n; c++)
+    {
+        pInfo = mbedtls_ecp_curve_info_from_grp_id(s_aCurve[au32Curve[c]].id);
+        au32Len[c] = gen_curve(au32Curve[c], pInfo->name);
+        if (au32Len[c] == 0)
+            return 1;
+    }
+
+    printf("\nstatic const nvt_ecp_comb_rom_t nvt_ecp_comb_rom[] =\n{\n");
+    for (c = 0; c < n; c++)
+    {
+        pInfo = mbedtls_ecp_curve_info_from_grp_id(s_aCurve[au32Curve[c]].id);
+        printf("#if defined(%s)\n", s_aCurve[au32Curve[c]].pcMacro);
+        printf("    { %s, %u, nvt_comb_%s },\n#endif\n", s_aCurve[au32Curve[c]].pcEnum,
+               (unsigned)au32Len[c], pInfo->name);
+    }
+    printf("    { MBEDTLS_ECP_DP_NONE, 0, NULL },\n};\n");
+
+    return 0;
+}
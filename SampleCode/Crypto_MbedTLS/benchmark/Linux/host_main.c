@@ -0,0 +1,58 @@
+/**************************************************************************//**
+ * @file     host_main.c
+ * @version  V1.00
+ * @brief    Linux entry of the crypto benchmark. Ticks are nanoseconds of
+ *           the monotonic clock. CTR_DRBG is seeded from the TRNG entropy
+ *           pool, running on the TRNG model of host_trng.c. The counters of
+ *           the ECP comb table cache are printed after the run.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <time.h>
+
+#include "NuMicro.h"
+#include "bench.h"
+#include "mbedtls/ecp.h"
+
+#define HOST_TRNG_BYTE_NS   20000   /* Byte time of the TRNG model */
+
+uint32_t bench_get_ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+uint32_t bench_get_tick_hz(void)
+{
+    return 1000000000UL;
+}
+
+void TRNG_IRQHandler(void)
+{
+    TRNG_PoolIRQHandler();
+}
+
+int main(void)
+{
+    TRNG_POOL_STAT_T  stat;
+
+    host_trng_start(HOST_TRNG_BYTE_NS);
+    TRNG_PoolOpen();
+
+    bench_run();
+
+    TRNG_PoolGetStat(&stat);
+    printf("# trng pool: %u/%u bytes, %u harvested, %u consumed, %u stalls, %u pauses\n",
+           (unsigned)stat.u32Level, (unsigned)stat.u32Size, (unsigned)stat.u32Harvested,
+           (unsigned)stat.u32Consumed, (unsigned)stat.u32Stalls, (unsigned)stat.u32Pauses);
+    printf("# ecp comb cache: %u hits (%u rom), %u stores, %u evictions, %u rejects, %u bytes\n",
+           (unsigned)nvt_ecp_comb_stats.hits, (unsigned)nvt_ecp_comb_stats.rom_hits,
+           (unsigned)nvt_ecp_comb_stats.stores, (unsigned)nvt_ecp_comb_stats.evictions,
+           (unsigned)nvt_ecp_comb_stats.rejects, (unsigned)nvt_ecp_comb_stats.bytes);
+
+    host_trng_stop();
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**************************************************************************//**
+ * @file     host_trng.c
+ * @version  V1.00
+ * @brief    Host model of the M480 TRNG register file. A thread plays the
+ *           engine: while TRNGEN is set and the last byte was read, it makes
+ *           a new byte every byte time, sets DVIF and, with DVIEN set, runs
+ *           TRNG_IRQHandler() the way the NVIC would. PRIMASK is a mutex, so
+ *           __disable_irq() keeps the "interrupt" out as on the board.
+ *
+ *           The bytes come from an xorshift generator. This models the
+ *           timing and the register protocol of the TRNG, not its entropy.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <pthread.h>
+#include <time.h>
+
+#include "NuMicro.h"
+
+SYS_T  g_HostSys;
+TRNG_T g_HostTrng;
+
+static pthread_mutex_t   s_tIrqLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread uint32_t s_u32PriMask;     /* PRIMASK of the calling thread */
+
+static pthread_t         s_tEngine;
+static volatile int      s_iRunning;
+static uint32_t          s_u32ByteNs;
+static uint32_t          s_u32Seed;
+
+uint32_t CLK_GetHCLKFreq(void)
+{
+    return 192000000UL;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return s_u32PriMask;
+}
+
+void __disable_irq(void)
+{
+    if (s_u32PriMask == 0UL)
+    {
+        pthread_mutex_lock(&s_tIrqLock);
+        s_u32PriMask = 1UL;
+    }
+}
+
+void __set_PRIMASK(uint32_t u32PriMask)
+{
+    if (u32PriMask != 0UL)
+    {
+        __disable_irq();
+    }
+    else if (s_u32PriMask != 0UL)
+    {
+        s_u32PriMask = 0UL;
+        pthread_mutex_unlock(&s_tIrqLock);
+    }
+}
+
+static void *host_trng_engine(void *pvArg)
+{
+    struct timespec  ts;
+
+    (void)pvArg;
+    ts.tv_sec = s_u32ByteNs / 1000000000UL;
+    ts.tv_nsec = s_u32ByteNs % 1000000000UL;
+
+    while (s_iRunning)
+    {
+        nanosleep(&ts, NULL);
+
+        __disable_irq();
+
+        if (TRNG->ACT & TRNG_ACT_ACT_Msk)
+            TRNG->CTL |= TRNG_CTL_READY_Msk;
+
+        /* DVIF stays set until the driver takes the byte */
+        if (((TRNG->CTL & (TRNG_CTL_TRNGEN_Msk | TRNG_CTL_READY_Msk)) == (TRNG_CTL_TRNGEN_Msk | TRNG_CTL_READY_Msk)) &&
+                ((TRNG->CTL & TRNG_CTL_DVIF_Msk) == 0UL))
+        {
+            s_u32Seed ^= s_u32Seed << 13;
+            s_u32Seed ^= s_u32Seed >> 17;
+            s_u32Seed ^= s_u32Seed << 5;
+            TRNG->DATA = s_u32Seed & 0xffUL;
+            TRNG->CTL |= TRNG_CTL_DVIF_Msk;
+        }
+
+        if ((TRNG->CTL & (TRNG_CTL_DVIF_Msk | TRNG_CTL_DVIEN_Msk)) == (TRNG_CTL_DVIF_Msk | TRNG_CTL_DVIEN_Msk))
+            TRNG_IRQHandler();
+
+        __set_PRIMASK(0UL);
+    }
+    return NULL;
+}
+
+void host_trng_start(uint32_t u32ByteNs)
+{
+    s_u32ByteNs = u32ByteNs;
+    s_u32Seed = (uint32_t)time(NULL) | 1UL;
+    s_iRunning = 1;
+    pthread_create(&s_tEngine, NULL, host_trng_engine, NULL);
+}
+
+void host_trng_stop(void)
+{
+    s_iRunning = 0;
+    pthread_join(s_tEngine, NULL);
+}
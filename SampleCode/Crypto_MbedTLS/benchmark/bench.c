@@ -0,0 +1,665 @@
+/**************************************************************************//**
+ * @file     bench.c
+ * @version  V1.00
+ * @brief    mbedtls crypto benchmark. Measures AES, TDES, SHA, HMAC, PBKDF2,
+ *           ECDH, ECDSA, RSA and CTR_DRBG through the mbedtls API and prints one
+ *           CSV row per primitive and buffer size. The "impl" column tells
+ *           whether the primitive ran on the CRYPTO engine (hw) or in
+ *           software (sw); for the CTR_DRBG reseed, whether the entropy came
+ *           from the TRNG entropy pool (hw) or not (sw).
+ *
+ *           This file does not touch the hardware; the platform supplies
+ *           bench_get_ticks() and bench_get_tick_hz(). It builds both for the
+ *           M480 (see main.c) and as a Linux executable (see Linux/Makefile).
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/des.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+
+#include "bench.h"
+
+
+#define BENCH_MAX_LEN           16384       /* Largest buffer size */
+#define BENCH_MAX_ITER          (1UL << 24) /* Iteration cap of one measurement */
+#define BENCH_PBKDF2_ITER       1000        /* PBKDF2 iteration count of one call */
+
+#ifdef NUVOTON_ENABLE_AES
+#define BENCH_IMPL_AES          "hw"
+#else
+#define BENCH_IMPL_AES          "sw"
+#endif
+
+#ifdef NUVOTON_ENABLE_DES
+#define BENCH_IMPL_DES          "hw"
+#else
+#define BENCH_IMPL_DES          "sw"
+#endif
+
+#ifdef NUVOTON_ENABLE_SHA
+#define BENCH_IMPL_SHA          "hw"
+#else
+#define BENCH_IMPL_SHA          "sw"
+#endif
+
+#ifdef NUVOTON_ENABLE_ECC
+#define BENCH_IMPL_ECC          "hw"
+#else
+#define BENCH_IMPL_ECC          "sw"
+#endif
+
+/* No RSA engine: bignum.c always runs on the CPU, see NUVOTON_MPI_UMAAL */
+#define BENCH_IMPL_MPI          "sw"
+
+#ifndef BENCH_IMPL_TRNG
+#ifdef NUVOTON_ENABLE_TRNG
+#define BENCH_IMPL_TRNG         "hw"
+#else
+#define BENCH_IMPL_TRNG         "sw"
+#endif
+#endif
+
+typedef int (*BENCH_FUNC_T)(uint32_t u32Len);
+
+/* Buffer sizes of the bulk primitives */
+static const uint32_t s_au32Len[] = { 16, 64, 256, 1024, 4096, 16384 };
+
+/* Word arrays, so the buffers are word aligned for the DMA paths */
+static uint32_t s_au32In[BENCH_MAX_LEN / 4];
+static uint32_t s_au32Out[BENCH_MAX_LEN / 4];
+
+#define s_au8In     ((unsigned char *)s_au32In)
+#define s_au8Out    ((unsigned char *)s_au32Out)
+
+static const unsigned char s_au8Key[32] =
+{
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+};
+
+static unsigned char s_au8Iv[16];
+static unsigned char s_au8Tag[16];
+static unsigned char s_au8Digest[64];
+
+static mbedtls_aes_context   s_aes;
+static mbedtls_gcm_context   s_gcm;
+static mbedtls_des_context   s_des;
+static mbedtls_des3_context  s_des3;
+static mbedtls_md_context_t  s_md;
+
+static mbedtls_ecp_group     s_grp;
+static mbedtls_mpi           s_d, s_z, s_r, s_s;
+static mbedtls_ecp_point     s_Q, s_Qpeer;
+
+#if defined(MBEDTLS_RSA_C)
+static mbedtls_rsa_context   s_rsa;
+static unsigned char         s_au8Sig[MBEDTLS_MPI_MAX_SIZE];
+#endif
+
+#if defined(MBEDTLS_CTR_DRBG_C) && defined(MBEDTLS_ENTROPY_C)
+static mbedtls_entropy_context   s_entropy;
+static mbedtls_ctr_drbg_context  s_drbg;
+#endif
+
+static uint32_t  s_u32Seed = 0x12345678;
+
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Measurement                                                                                            */
+/*---------------------------------------------------------------------------------------------------------*/
+
+/*
+ *  Random numbers for key generation, ECDSA nonces and blinding. A plain
+ *  xorshift generator: fine for timing, not for real keys.
+ */
+static int bench_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    (void)p_rng;
+
+    while (len--)
+    {
+        s_u32Seed ^= s_u32Seed << 13;
+        s_u32Seed ^= s_u32Seed >> 17;
+        s_u32Seed ^= s_u32Seed << 5;
+        *output++ = (unsigned char)s_u32Seed;
+    }
+    return 0;
+}
+
+/*
+ *  Time pfn(u32Len), doubling the number of calls until one measurement
+ *  takes at least 1/8 second, and print the result.
+ *
+ *  u32Bytes is the number of bytes one call processes, or 0 for primitives
+ *  without a throughput (ECC). u32OpsPerCall is the number of operations one
+ *  call counts as in the ops_per_sec column (the iteration count for PBKDF2).
+ */
+static void bench_measure(const char *pcImpl, const char *pcName, uint32_t u32Size,
+                          BENCH_FUNC_T pfn, uint32_t u32Len, uint32_t u32Bytes, uint32_t u32OpsPerCall)
+{
+    uint32_t  u32Iter, i, u32Start, u32Ticks;
+    uint64_t  u64Ops, u64Hz;
+    int       ret;
+
+    u64Hz = bench_get_tick_hz();
+
+    for (u32Iter = 1; ; u32Iter <<= 1)
+    {
+        u32Start = bench_get_ticks();
+        for (i = 0; i < u32Iter; i++)
+        {
+            ret = pfn(u32Len);
+            if (ret != 0)
+            {
+                printf("# %s,%s,%u failed: -0x%04x\n", pcImpl, pcName, (unsigned)u32Size, (unsigned)-ret);
+                return;
+            }
+        }
+        u32Ticks = bench_get_ticks() - u32Start;
+
+        if ((u32Ticks >= u64Hz / 8) || (u32Iter >= BENCH_MAX_ITER))
+            break;
+    }
+
+    if (u32Ticks == 0)
+        u32Ticks = 1;
+
+    u64Ops = (uint64_t)u32Iter * u32OpsPerCall;
+
+    /* impl,primitive,size,iterations,ticks_per_op,ops_per_sec */
+    printf("%s,%s,%u,%u,%u,%u,", pcImpl, pcName, (unsigned)u32Size, (unsigned)u32Iter,
+           (unsigned)(u32Ticks / u64Ops), (unsigned)(u64Ops * u64Hz / u32Ticks));
+
+    if (u32Bytes != 0)
+    {
+        uint64_t  u64Bytes = (uint64_t)u32Iter * u32Bytes;
+        uint32_t  u32TicksPerByte100 = (uint32_t)((uint64_t)u32Ticks * 100 / u64Bytes);
+
+        /* bytes_per_sec,ticks_per_byte */
+        printf("%u,%u.%02u\n", (unsigned)(u64Bytes * u64Hz / u32Ticks),
+               (unsigned)(u32TicksPerByte100 / 100), (unsigned)(u32TicksPerByte100 % 100));
+    }
+    else
+    {
+        printf(",\n");
+    }
+}
+
+static void bench_bulk(const char *pcImpl, const char *pcName, BENCH_FUNC_T pfn)
+{
+    uint32_t  i;
+
+    for (i = 0; i < sizeof(s_au32Len) / sizeof(s_au32Len[0]); i++)
+        bench_measure(pcImpl, pcName, s_au32Len[i], pfn, s_au32Len[i], s_au32Len[i], 1);
+}
+
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Primitives                                                                                             */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static int bench_aes_ecb(uint32_t u32Len)
+{
+    uint32_t  i;
+    int       ret;
+
+    for (i = 0; i < u32Len; i += 16)
+    {
+        ret = mbedtls_aes_crypt_ecb(&s_aes, MBEDTLS_AES_ENCRYPT, s_au8In + i, s_au8Out + i);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int bench_aes_cbc(uint32_t u32Len)
+{
+    return mbedtls_aes_crypt_cbc(&s_aes, MBEDTLS_AES_ENCRYPT, u32Len, s_au8Iv, s_au8In, s_au8Out);
+}
+
+static int bench_aes_ctr(uint32_t u32Len)
+{
+    size_t         nc_off = 0;
+    unsigned char  stream_block[16];
+
+    return mbedtls_aes_crypt_ctr(&s_aes, u32Len, &nc_off, s_au8Iv, stream_block, s_au8In, s_au8Out);
+}
+
+static int bench_aes_gcm(uint32_t u32Len)
+{
+    return mbedtls_gcm_crypt_and_tag(&s_gcm, MBEDTLS_GCM_ENCRYPT, u32Len, s_au8Iv, 12,
+                                     NULL, 0, s_au8In, s_au8Out, 16, s_au8Tag);
+}
+
+static int bench_des_cbc(uint32_t u32Len)
+{
+    return mbedtls_des_crypt_cbc(&s_des, MBEDTLS_DES_ENCRYPT, u32Len, s_au8Iv, s_au8In, s_au8Out);
+}
+
+static int bench_des3_ecb(uint32_t u32Len)
+{
+    uint32_t  i;
+    int       ret;
+
+    for (i = 0; i < u32Len; i += 8)
+    {
+        ret = mbedtls_des3_crypt_ecb(&s_des3, s_au8In + i, s_au8Out + i);
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int bench_des3_cbc(uint32_t u32Len)
+{
+    return mbedtls_des3_crypt_cbc(&s_des3, MBEDTLS_DES_ENCRYPT, u32Len, s_au8Iv, s_au8In, s_au8Out);
+}
+
+static int bench_sha1(uint32_t u32Len)
+{
+    return mbedtls_sha1_ret(s_au8In, u32Len, s_au8Digest);
+}
+
+static int bench_sha256(uint32_t u32Len)
+{
+    return mbedtls_sha256_ret(s_au8In, u32Len, s_au8Digest, 0);
+}
+
+static int bench_sha512(uint32_t u32Len)
+{
+    return mbedtls_sha512_ret(s_au8In, u32Len, s_au8Digest, 0);
+}
+
+static int bench_hmac(uint32_t u32Len)
+{
+    int  ret;
+
+    ret = mbedtls_md_hmac_reset(&s_md);
+    if (ret == 0)
+        ret = mbedtls_md_hmac_update(&s_md, s_au8In, u32Len);
+    if (ret == 0)
+        ret = mbedtls_md_hmac_finish(&s_md, s_au8Digest);
+    return ret;
+}
+
+static int bench_pbkdf2(uint32_t u32Len)
+{
+    return mbedtls_pkcs5_pbkdf2_hmac(&s_md, s_au8Key, 16, s_au8Key + 16, 16,
+                                     u32Len, 32, s_au8Digest);
+}
+
+static int bench_ecdh(uint32_t u32Len)
+{
+    (void)u32Len;
+    return mbedtls_ecdh_compute_shared(&s_grp, &s_z, &s_Qpeer, &s_d, bench_rng, NULL);
+}
+
+static int bench_ecdsa_sign(uint32_t u32Len)
+{
+    return mbedtls_ecdsa_sign(&s_grp, &s_r, &s_s, &s_d, s_au8Digest, u32Len, bench_rng, NULL);
+}
+
+static int bench_ecdsa_verify(uint32_t u32Len)
+{
+    return mbedtls_ecdsa_verify(&s_grp, s_au8Digest, u32Len, &s_Q, &s_r, &s_s);
+}
+
+/*
+ *  The same, with the group loaded and freed around each operation, the way
+ *  a TLS handshake or a freshly parsed key uses it.
+ */
+static int bench_ecdsa_sign_fresh(uint32_t u32Len)
+{
+    mbedtls_ecp_group  grp;
+    int  ret;
+
+    mbedtls_ecp_group_init(&grp);
+    ret = mbedtls_ecp_group_load(&grp, s_grp.id);
+    if (ret == 0)
+        ret = mbedtls_ecdsa_sign(&grp, &s_r, &s_s, &s_d, s_au8Digest, u32Len, bench_rng, NULL);
+    mbedtls_ecp_group_free(&grp);
+    return ret;
+}
+
+static int bench_ecdsa_verify_fresh(uint32_t u32Len)
+{
+    mbedtls_ecp_group  grp;
+    int  ret;
+
+    mbedtls_ecp_group_init(&grp);
+    ret = mbedtls_ecp_group_load(&grp, s_grp.id);
+    if (ret == 0)
+        ret = mbedtls_ecdsa_verify(&grp, s_au8Digest, u32Len, &s_Q, &s_r, &s_s);
+    mbedtls_ecp_group_free(&grp);
+    return ret;
+}
+
+#if defined(MBEDTLS_RSA_C)
+/* PKCS#1 v1.5 with SHA-256: the verify of a certificate chain, the sign of a client certificate */
+static int bench_rsa_verify(uint32_t u32Len)
+{
+    (void)u32Len;
+    return mbedtls_rsa_pkcs1_verify(&s_rsa, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256, 32,
+                                    s_au8Digest, s_au8Sig);
+}
+
+static int bench_rsa_sign(uint32_t u32Len)
+{
+    (void)u32Len;
+    return mbedtls_rsa_pkcs1_sign(&s_rsa, bench_rng, NULL, MBEDTLS_RSA_PRIVATE, MBEDTLS_MD_SHA256, 32,
+                                  s_au8Digest, s_au8Sig);
+}
+#endif
+
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Suites                                                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+
+static void bench_aes(void)
+{
+    static const uint32_t  au32KeyBits[] = { 128, 256 };
+    char      acName[24];
+    uint32_t  k;
+
+    for (k = 0; k < 2; k++)
+    {
+        mbedtls_aes_init(&s_aes);
+        mbedtls_aes_setkey_enc(&s_aes, s_au8Key, au32KeyBits[k]);
+
+        sprintf(acName, "aes-%u-ecb", (unsigned)au32KeyBits[k]);
+        bench_bulk(BENCH_IMPL_AES, acName, bench_aes_ecb);
+        sprintf(acName, "aes-%u-cbc", (unsigned)au32KeyBits[k]);
+        bench_bulk(BENCH_IMPL_AES, acName, bench_aes_cbc);
+        sprintf(acName, "aes-%u-ctr", (unsigned)au32KeyBits[k]);
+        bench_bulk(BENCH_IMPL_AES, acName, bench_aes_ctr);
+        mbedtls_aes_free(&s_aes);
+
+        mbedtls_gcm_init(&s_gcm);
+        mbedtls_gcm_setkey(&s_gcm, MBEDTLS_CIPHER_ID_AES, s_au8Key, au32KeyBits[k]);
+        sprintf(acName, "aes-%u-gcm", (unsigned)au32KeyBits[k]);
+        bench_bulk(BENCH_IMPL_AES, acName, bench_aes_gcm);
+        mbedtls_gcm_free(&s_gcm);
+    }
+}
+
+static void bench_des(void)
+{
+    mbedtls_des_init(&s_des);
+    mbedtls_des_setkey_enc(&s_des, s_au8Key);
+    bench_bulk(BENCH_IMPL_DES, "des-cbc", bench_des_cbc);
+    mbedtls_des_free(&s_des);
+
+    mbedtls_des3_init(&s_des3);
+    mbedtls_des3_set3key_enc(&s_des3, s_au8Key);
+    bench_bulk(BENCH_IMPL_DES, "des3-ecb", bench_des3_ecb);
+    bench_bulk(BENCH_IMPL_DES, "des3-cbc", bench_des3_cbc);
+    mbedtls_des3_free(&s_des3);
+}
+
+static void bench_sha(void)
+{
+    bench_bulk(BENCH_IMPL_SHA, "sha1", bench_sha1);
+    bench_bulk(BENCH_IMPL_SHA, "sha256", bench_sha256);
+    bench_bulk(BENCH_IMPL_SHA, "sha512", bench_sha512);
+
+    mbedtls_md_init(&s_md);
+    if (mbedtls_md_setup(&s_md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) != 0)
+    {
+        printf("# hmac-sha256 setup failed\n");
+        return;
+    }
+    mbedtls_md_hmac_starts(&s_md, s_au8Key, 32);
+    bench_bulk(BENCH_IMPL_SHA, "hmac-sha256", bench_hmac);
+
+    /* size is the iteration count; ops_per_sec counts PBKDF2 iterations */
+    bench_measure(BENCH_IMPL_SHA, "pbkdf2-hmac-sha256", BENCH_PBKDF2_ITER,
+                  bench_pbkdf2, BENCH_PBKDF2_ITER, 0, BENCH_PBKDF2_ITER);
+    mbedtls_md_free(&s_md);
+}
+
+static void bench_ecc(void)
+{
+    static const struct
+    {
+        mbedtls_ecp_group_id  id;
+        const char            *pcName;
+    } s_aCurve[] =
+    {
+        { MBEDTLS_ECP_DP_SECP192R1, "p192" },
+        { MBEDTLS_ECP_DP_SECP224R1, "p224" },
+        { MBEDTLS_ECP_DP_SECP256R1, "p256" },
+        { MBEDTLS_ECP_DP_SECP384R1, "p384" },
+        { MBEDTLS_ECP_DP_SECP521R1, "p521" },
+        { MBEDTLS_ECP_DP_BP256R1,   "bp256" },
+        { MBEDTLS_ECP_DP_BP384R1,   "bp384" },
+        { MBEDTLS_ECP_DP_BP512R1,   "bp512" },
+    };
+    char      acName[32];
+    uint32_t  i, u32HashLen;
+    int       ret;
+
+    for (i = 0; i < sizeof(s_aCurve) / sizeof(s_aCurve[0]); i++)
+    {
+        mbedtls_ecp_group_init(&s_grp);
+        mbedtls_ecp_point_init(&s_Q);
+        mbedtls_ecp_point_init(&s_Qpeer);
+        mbedtls_mpi_init(&s_d);
+        mbedtls_mpi_init(&s_z);
+        mbedtls_mpi_init(&s_r);
+        mbedtls_mpi_init(&s_s);
+
+        ret = mbedtls_ecp_group_load(&s_grp, s_aCurve[i].id);
+        if (ret == 0)
+            ret = mbedtls_ecp_gen_keypair(&s_grp, &s_d, &s_Q, bench_rng, NULL);
+        if (ret == 0)
+            ret = mbedtls_ecp_gen_keypair(&s_grp, &s_z, &s_Qpeer, bench_rng, NULL);
+        if (ret != 0)
+        {
+            printf("# %s key generation failed: -0x%04x\n", s_aCurve[i].pcName, (unsigned)-ret);
+            goto next;
+        }
+
+        /* Sign a hash as long as the curve order, at most SHA-512 */
+        u32HashLen = (uint32_t)((s_grp.nbits + 7) / 8);
+        if (u32HashLen > 64)
+            u32HashLen = 64;
+        bench_rng(NULL, s_au8Digest, u32HashLen);
+
+        sprintf(acName, "ecdh-%s", s_aCurve[i].pcName);
+        bench_measure(BENCH_IMPL_ECC, acName, (uint32_t)s_grp.nbits, bench_ecdh, 0, 0, 1);
+
+        sprintf(acName, "ecdsa-sign-%s", s_aCurve[i].pcName);
+        bench_measure(BENCH_IMPL_ECC, acName, (uint32_t)s_grp.nbits, bench_ecdsa_sign, u32HashLen, 0, 1);
+
+        sprintf(acName, "ecdsa-verify-%s", s_aCurve[i].pcName);
+        bench_measure(BENCH_IMPL_ECC, acName, (uint32_t)s_grp.nbits, bench_ecdsa_verify, u32HashLen, 0, 1);
+
+        sprintf(acName, "ecdsa-sign-fresh-%s", s_aCurve[i].pcName);
+        bench_measure(BENCH_IMPL_ECC, acName, (uint32_t)s_grp.nbits, bench_ecdsa_sign_fresh, u32HashLen, 0, 1);
+
+        sprintf(acName, "ecdsa-verify-fresh-%s", s_aCurve[i].pcName);
+        bench_measure(BENCH_IMPL_ECC, acName, (uint32_t)s_grp.nbits, bench_ecdsa_verify_fresh, u32HashLen, 0, 1);
+
+next:
+        mbedtls_mpi_free(&s_s);
+        mbedtls_mpi_free(&s_r);
+        mbedtls_mpi_free(&s_z);
+        mbedtls_mpi_free(&s_d);
+        mbedtls_ecp_point_free(&s_Qpeer);
+        mbedtls_ecp_point_free(&s_Q);
+        mbedtls_ecp_group_free(&s_grp);
+    }
+}
+
+#if defined(MBEDTLS_RSA_C)
+static void bench_rsa(void)
+{
+    /* Fixed keys, e = 65537: generating them would take longer than the whole benchmark */
+    static const struct
+    {
+        uint32_t    u32Bits;
+        const char  *pcP, *pcQ;
+    } s_aKey[] =
+    {
+        {
+            1024,
+            "E08CE71F506DD871A389E718461A3E2264E8A7116C7F605B1BC530573E0398DA"
+            "C286170EDE9343DF245716D7ADBA7C833C6878A51AC70508394F5470725E36DB",
+            "DF6E39CCDE12F916C3D189B2104D7167D17CB97537B5FD7E4B97FA3283BF9F90"
+            "1F736523D91DC84D540AD328E6D016505A2AE0F3500629F153B7449B46EBFC45"
+        },
+        {
+            2048,
+            "E8159BE8F8D03ACDF47D0FEAFF66668E5D50AFF873ACF23F0A6760633A1CA71B"
+            "5D2F4DC32A69BB8D16E23914932C6DFDFE5742951C78C98E5D46DBD65F7BE65A"
+            "EB2821DEB23C5F0CC54982E84F9D673AF26C2457AE0C997FF9DF042730C1A5C6"
+            "BEFD04FB9E94BF48DC024640CA6E2473C909851BE832D78A2F9828B80A33797B",
+            "C900A2578CE23299BAFDD407EA9F31016A61B401B1B7B9F1A4259582FB3CAA21"
+            "6A04ACCAA4ED902C2D350D0E37FE0F2E5248D9095DDC16944F620261FBF71DEC"
+            "61FDFB2EEF998C10979DCD57129B40A613A9B7342875798E21897B8AF9EDD81E"
+            "6E961B710F9516B0317FF8663AC11266AECCE992A913666EAF2A6120AB0AA86D"
+        },
+    };
+    mbedtls_mpi  P, Q, E;
+    char      acName[24];
+    uint32_t  i;
+    int       ret;
+
+#if defined(MBEDTLS_SELF_TEST)
+    /* Includes the UMAAL kernels against their C reference */
+    printf("# %s,mpi self test %s\n", BENCH_IMPL_MPI, (mbedtls_mpi_self_test(0) == 0) ? "passed" : "FAILED");
+#endif
+
+    bench_rng(NULL, s_au8Digest, 32);
+
+    for (i = 0; i < sizeof(s_aKey) / sizeof(s_aKey[0]); i++)
+    {
+        mbedtls_rsa_init(&s_rsa, MBEDTLS_RSA_PKCS_V15, 0);
+        mbedtls_mpi_init(&P);
+        mbedtls_mpi_init(&Q);
+        mbedtls_mpi_init(&E);
+
+        ret = mbedtls_mpi_read_string(&P, 16, s_aKey[i].pcP);
+        if (ret == 0)
+            ret = mbedtls_mpi_read_string(&Q, 16, s_aKey[i].pcQ);
+        if (ret == 0)
+            ret = mbedtls_mpi_lset(&E, 65537);
+        if (ret == 0)
+            ret = mbedtls_rsa_import(&s_rsa, NULL, &P, &Q, NULL, &E);
+        if (ret == 0)
+            ret = mbedtls_rsa_complete(&s_rsa);
+        if (ret == 0)
+            ret = bench_rsa_sign(0);
+        if (ret != 0)
+        {
+            printf("# rsa-%u key setup failed: -0x%04x\n", (unsigned)s_aKey[i].u32Bits, (unsigned)-ret);
+            goto next;
+        }
+
+        sprintf(acName, "rsa-verify-%u", (unsigned)s_aKey[i].u32Bits);
+        bench_measure(BENCH_IMPL_MPI, acName, s_aKey[i].u32Bits, bench_rsa_verify, 0, 0, 1);
+
+        sprintf(acName, "rsa-sign-%u", (unsigned)s_aKey[i].u32Bits);
+        bench_measure(BENCH_IMPL_MPI, acName, s_aKey[i].u32Bits, bench_rsa_sign, 0, 0, 1);
+
+next:
+        mbedtls_mpi_free(&E);
+        mbedtls_mpi_free(&Q);
+        mbedtls_mpi_free(&P);
+        mbedtls_rsa_free(&s_rsa);
+    }
+}
+#endif
+
+#if defined(MBEDTLS_CTR_DRBG_C) && defined(MBEDTLS_ENTROPY_C)
+static int bench_drbg_reseed(uint32_t u32Len)
+{
+    (void)u32Len;
+    return mbedtls_ctr_drbg_reseed(&s_drbg, NULL, 0);
+}
+
+static int bench_drbg_random(uint32_t u32Len)
+{
+    uint32_t  i, n;
+    int       ret;
+
+    for (i = 0; i < u32Len; i += n)
+    {
+        n = u32Len - i;
+        if (n > MBEDTLS_CTR_DRBG_MAX_REQUEST)
+            n = MBEDTLS_CTR_DRBG_MAX_REQUEST;
+        if ((ret = mbedtls_ctr_drbg_random(&s_drbg, s_au8Out + i, n)) != 0)
+            return ret;
+    }
+    return 0;
+}
+
+static void bench_drbg(void)
+{
+    int  ret;
+
+    mbedtls_entropy_init(&s_entropy);
+    mbedtls_ctr_drbg_init(&s_drbg);
+
+    ret = mbedtls_ctr_drbg_seed(&s_drbg, mbedtls_entropy_func, &s_entropy, NULL, 0);
+    if (ret != 0)
+    {
+        printf("# %s,ctr_drbg seed failed: -0x%04x\n", BENCH_IMPL_TRNG, (unsigned)-ret);
+        goto exit;
+    }
+
+    /* size is the entropy length; sustained reseeds run at the TRNG harvest rate */
+    bench_measure(BENCH_IMPL_TRNG, "ctr_drbg-reseed", MBEDTLS_CTR_DRBG_ENTROPY_LEN,
+                  bench_drbg_reseed, 0, 0, 1);
+    bench_bulk(BENCH_IMPL_AES, "ctr_drbg", bench_drbg_random);
+
+exit:
+    mbedtls_ctr_drbg_free(&s_drbg);
+    mbedtls_entropy_free(&s_entropy);
+}
+#endif
+
+void bench_run(void)
+{
+    uint32_t  i;
+
+    for (i = 0; i < BENCH_MAX_LEN; i++)
+        s_au8In[i] = (unsigned char)i;
+
+    printf("# tick_hz=%u\n", (unsigned)bench_get_tick_hz());
+    printf("impl,primitive,size,iterations,ticks_per_op,ops_per_sec,bytes_per_sec,ticks_per_byte\n");
+
+    bench_aes();
+    bench_des();
+    bench_sha();
+    bench_ecc();
+#if defined(MBEDTLS_RSA_C)
+    bench_rsa();
+#endif
+#if defined(MBEDTLS_CTR_DRBG_C) && defined(MBEDTLS_ENTROPY_C)
+    bench_drbg();
+#endif
+
+    printf("# done\n");
+}
@@ -0,0 +1,33 @@
+/**************************************************************************//**
+ * @file     bench.h
+ * @version  V1.00
+ * @brief    mbedtls crypto benchmark
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Provided by the platform: a free running 32-bit tick counter and its frequency.                        */
+/*---------------------------------------------------------------------------------------------------------*/
+uint32_t bench_get_ticks(void);
+uint32_t bench_get_tick_hz(void);
+
+/*---------------------------------------------------------------------------------------------------------*/
+/*  Run every benchmark and print the results as CSV.                                                      */
+/*---------------------------------------------------------------------------------------------------------*/
+void bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,27 @@
+/**************************************************************************//**
+ * @file     bench_config.h
+ * @version  V1.00
+ * @brief    mbedtls configuration of the crypto benchmark: the BSP default
+ *           configuration with CTR_DRBG seeded from the TRNG entropy pool,
+ *           and the CRYPTO engine and the TRNG switched off when the project
+ *           defines BENCH_SOFTWARE. Run both builds to compare the hardware
+ *           and software rows of the same primitive.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __BENCH_CONFIG_H__
+#define __BENCH_CONFIG_H__
+
+#include "mbedtls/config.h"
+
+#ifdef BENCH_SOFTWARE
+#undef NUVOTON_ENABLE_AES
+#undef NUVOTON_ENABLE_DES
+#undef NUVOTON_ENABLE_SHA
+#undef NUVOTON_ENABLE_ECC
+#else
+#undef MBEDTLS_TEST_NULL_ENTROPY
+#define NUVOTON_ENABLE_TRNG
+#endif
+
+#endif /* __BENCH_CONFIG_H__ */
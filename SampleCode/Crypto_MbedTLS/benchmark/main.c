@@ -0,0 +1,152 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @version  V1.00
+ * @brief    mbedtls crypto benchmark. Prints the throughput and latency of
+ *           the mbedtls primitives as CSV on UART0, timed with the DWT cycle
+ *           counter. Build with BENCH_SOFTWARE defined to measure the
+ *           software implementations instead of the CRYPTO engine and the
+ *           TRNG entropy pool.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+
+#include "bench.h"
+
+
+
+uint32_t bench_get_ticks(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t bench_get_tick_hz(void)
+{
+    return SystemCoreClock;
+}
+
+void SYS_Init(void)
+{
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Set XT1_OUT(PF.2) and XT1_IN(PF.3) to input mode */
+    PF->MODE &= ~(GPIO_MODE_MODE2_Msk | GPIO_MODE_MODE3_Msk);
+
+    /* Enable HXT clock */
+    CLK_EnableXtalRC(CLK_PWRCTL_HXTEN_Msk);
+
+    /* Wait for HXT clock ready */
+    CLK_WaitClockReady(CLK_STATUS_HXTSTB_Msk);
+
+    /* Switch HCLK clock source to HXT */
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HXT,CLK_CLKDIV0_HCLK(1));
+
+    /* Set core clock as PLL_CLOCK from PLL */
+    CLK_SetCoreClock(FREQ_192MHZ);
+
+    /* Set both PCLK0 and PCLK1 as HCLK/2 */
+    CLK->PCLKDIV = CLK_PCLKDIV_APB0DIV_DIV2 | CLK_PCLKDIV_APB1DIV_DIV2;
+
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as HXT and UART module clock divider as 1 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UART0SEL_HXT, CLK_CLKDIV0_UART0(1));
+
+    /* Enable CRYPTO module clock */
+    CLK_EnableModuleClock(CRPT_MODULE);
+
+#ifndef BENCH_SOFTWARE
+    /* Enable TRNG module clock. TRNG runs from LIRC through the RTC clock. */
+    CLK_EnableModuleClock(TRNG_MODULE);
+    CLK->PWRCTL |= CLK_PWRCTL_LIRCEN_Msk;
+    while((CLK->STATUS & CLK_STATUS_LIRCSTB_Msk) == 0);
+    RTC->LXTCTL |= 0x81;
+#endif
+
+    /* Update System Core Clock */
+    SystemCoreClockUpdate();
+
+    /* Set GPB multi-function pins for UART0 RXD and TXD */
+    SYS->GPB_MFPH &= ~(SYS_GPB_MFPH_PB12MFP_Msk | SYS_GPB_MFPH_PB13MFP_Msk);
+    SYS->GPB_MFPH |= (SYS_GPB_MFPH_PB12MFP_UART0_RXD | SYS_GPB_MFPH_PB13MFP_UART0_TXD);
+
+#ifndef BENCH_SOFTWARE
+    /* Start the entropy pool that seeds CTR_DRBG */
+    TRNG_PoolOpen();
+    TRNG_SET_CLKP(0);                  /* PCLK is 96 MHz */
+#endif
+
+    /* Lock protected registers */
+    SYS_LockReg();
+}
+
+void UART0_Init(void)
+{
+    /* Configure UART0 and set UART0 baud rate */
+    UART_Open(UART0, 115200);
+}
+
+void TRNG_IRQHandler()
+{
+    TRNG_PoolIRQHandler();
+}
+
+void CRYPTO_IRQHandler()
+{
+    CRPT_JobIRQHandler(CRPT);
+    ECC_Complete(CRPT);
+}
+
+int main(void)
+{
+    static const char *s_apcEngine[] = { "aes", "tdes", "sha", "ecc" };
+    CRPT_JOB_STAT_T  stat;
+    TRNG_POOL_STAT_T pool;
+    uint32_t  i;
+
+    SYS_Init();                        /* Init System, IP clock and multi-function I/O */
+
+    UART0_Init();                      /* Initialize UART0 */
+
+    printf("+----------------------------------------+\n");
+    printf("|  Crypto mbedtls benchmark              |\n");
+    printf("+----------------------------------------+\n");
+
+    /* Start the DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    NVIC_EnableIRQ(CRPT_IRQn);
+    AES_ENABLE_INT(CRPT);
+    TDES_ENABLE_INT(CRPT);
+    SHA_ENABLE_INT(CRPT);
+    ECC_ENABLE_INT(CRPT);
+#ifndef BENCH_SOFTWARE
+    NVIC_EnableIRQ(TRNG_IRQn);
+#endif
+
+    CRPT_JobClearStat();
+
+    bench_run();
+
+    /* Engine occupancy over the whole run, from the CRPT job queue */
+    for (i = 0; i < sizeof(s_apcEngine) / sizeof(s_apcEngine[0]); i++)
+    {
+        CRPT_JobGetStat(i, &stat);
+        printf("# %s engine: %u jobs, %u failed, %u busy Mcycles\n", s_apcEngine[i],
+               (unsigned)stat.u32Completed, (unsigned)stat.u32Failed,
+               (unsigned)(stat.u64BusyCycles / 1000000));
+    }
+
+    TRNG_PoolGetStat(&pool);
+    printf("# trng pool: %u/%u bytes, %u harvested, %u consumed, %u stalls, %u pauses\n",
+           (unsigned)pool.u32Level, (unsigned)pool.u32Size, (unsigned)pool.u32Harvested,
+           (unsigned)pool.u32Consumed, (unsigned)pool.u32Stalls, (unsigned)pool.u32Pauses);
+
+    while (1);
+}
@@ -1027,7 +1027,10 @@ volatile int  g_Crypto_Int_done = 0;
 
 void CRYPTO_IRQHandler()
 {
-    if (TDES_GET_INT_FLAG(CRPT))
+    /* Flags of the engines without CRPT jobs, the job queue handles the others */
+    uint32_t  u32Sts = CRPT_JobIRQHandler(CRPT);
+
+    if (u32Sts & (CRPT_INTSTS_TDESIF_Msk | CRPT_INTSTS_TDESEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         TDES_CLR_INT_FLAG(CRPT);
@@ -1005,7 +1005,10 @@ volatile int  g_Crypto_Int_done = 0;
 
 void CRYPTO_IRQHandler()
 {
-    if (SHA_GET_INT_FLAG(CRPT))
+    /* Flags of the engines without CRPT jobs, the job queue handles the others */
+    uint32_t  u32Sts = CRPT_JobIRQHandler(CRPT);
+
+    if (u32Sts & (CRPT_INTSTS_HMACIF_Msk | CRPT_INTSTS_HMACEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         SHA_CLR_INT_FLAG(CRPT);
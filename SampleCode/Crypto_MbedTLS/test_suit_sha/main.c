@@ -426,6 +426,136 @@ exit:
     return;
 }
 
+/*
+ *  Two SHA-256 contexts hashing interleaved, one of them cloned half way as
+ *  the TLS Finished computation does. Only the first context can stream
+ *  through the engine; the clone moves it to software mid-message.
+ */
+void test_suite_sha256_interleave()
+{
+    static const unsigned char abc_sum[32] =
+    {
+        0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA,
+        0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+        0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C,
+        0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD
+    };
+    static const unsigned char a1000_sum[32] =
+    {
+        0x41, 0xED, 0xEC, 0xE4, 0x2D, 0x63, 0xE8, 0xD9,
+        0xBF, 0x51, 0x5A, 0x9B, 0xA6, 0x93, 0x2E, 0x1C,
+        0x20, 0xCB, 0xC9, 0xF5, 0xA5, 0xD1, 0x34, 0x64,
+        0x5A, 0xDB, 0x5D, 0xB1, 0xB9, 0x73, 0x7E, 0xA3
+    };
+    mbedtls_sha256_context ctx1, ctx2, clone;
+    unsigned char buf[1000], sum[32];
+    int i;
+
+    memset(buf, 'a', sizeof(buf));
+    mbedtls_sha256_init( &ctx1 );
+    mbedtls_sha256_init( &ctx2 );
+    mbedtls_sha256_init( &clone );
+
+    mbedtls_sha256_starts_ret( &ctx1, 0 );
+    mbedtls_sha256_starts_ret( &ctx2, 0 );
+    for (i = 0; i < 1000; i += 100)
+    {
+        mbedtls_sha256_update_ret( &ctx1, buf + i, 100 );
+        if (i == 0)
+            mbedtls_sha256_update_ret( &ctx2, (const unsigned char *)"abc", 3 );
+        if (i == 500)
+            mbedtls_sha256_clone( &clone, &ctx1 );
+    }
+    mbedtls_sha256_update_ret( &clone, buf, 400 );
+
+    mbedtls_sha256_finish_ret( &ctx1, sum );
+    TEST_ASSERT( memcmp( sum, a1000_sum, 32 ) == 0 );
+    mbedtls_sha256_finish_ret( &ctx2, sum );
+    TEST_ASSERT( memcmp( sum, abc_sum, 32 ) == 0 );
+    mbedtls_sha256_finish_ret( &clone, sum );
+    TEST_ASSERT( memcmp( sum, a1000_sum, 32 ) == 0 );
+    printf("SHA-256 interleave and clone test passed.\n");
+
+exit:
+    mbedtls_sha256_free( &ctx1 );
+    mbedtls_sha256_free( &ctx2 );
+    mbedtls_sha256_free( &clone );
+}
+
+/*
+ *  Streaming throughput through the engine against the software SHA-256
+ *  compression function.
+ */
+#define BENCH_DATA_LEN      4096
+#define BENCH_LOOPS         256
+
+#ifdef __ICCARM__
+#pragma data_alignment=4
+static uint8_t  bench_buff[BENCH_DATA_LEN];
+#else
+static uint8_t  bench_buff[BENCH_DATA_LEN] __attribute__((aligned (4)));
+#endif
+
+volatile uint32_t  g_tick_cnt;
+
+void SysTick_Handler(void)
+{
+    g_tick_cnt++;
+}
+
+static void bench_report(char *name, uint32_t ticks)
+{
+    uint32_t  kbytes = (BENCH_DATA_LEN / 1024) * BENCH_LOOPS;
+
+    if (ticks == 0)
+        ticks = 1;
+    printf("  %-28s %6d ms  %6d KB/s\n", name, ticks, (kbytes * 1000) / ticks);
+}
+
+void sha_stream_benchmark()
+{
+    mbedtls_sha256_context ctx;
+    unsigned char sum[32];
+    uint32_t  t0;
+    int  i, loop;
+
+    memset(bench_buff, 0x5A, sizeof(bench_buff));
+    g_tick_cnt = 0;
+    SysTick_Config(SystemCoreClock / 1000);
+
+    printf("\nSHA-256 throughput:\n");
+
+    mbedtls_sha256_init( &ctx );
+    mbedtls_sha256_starts_ret( &ctx, 0 );
+    t0 = g_tick_cnt;
+    for (loop = 0; loop < BENCH_LOOPS; loop++)
+        for (i = 0; i < BENCH_DATA_LEN; i += 64)
+            mbedtls_internal_sha256_process( &ctx, &bench_buff[i] );
+    bench_report("software compression", g_tick_cnt - t0);
+    mbedtls_sha256_free( &ctx );
+
+    mbedtls_sha256_init( &ctx );
+    mbedtls_sha256_starts_ret( &ctx, 0 );
+    t0 = g_tick_cnt;
+    for (loop = 0; loop < BENCH_LOOPS; loop++)
+        mbedtls_sha256_update_ret( &ctx, bench_buff, BENCH_DATA_LEN );
+    mbedtls_sha256_finish_ret( &ctx, sum );
+    bench_report("engine stream, 4 KB updates", g_tick_cnt - t0);
+    mbedtls_sha256_free( &ctx );
+
+    mbedtls_sha256_init( &ctx );
+    mbedtls_sha256_starts_ret( &ctx, 0 );
+    t0 = g_tick_cnt;
+    for (loop = 0; loop < BENCH_LOOPS; loop++)
+        for (i = 0; i < BENCH_DATA_LEN; i += 100)
+            mbedtls_sha256_update_ret( &ctx, &bench_buff[i], (BENCH_DATA_LEN - i < 100) ? BENCH_DATA_LEN - i : 100 );
+    mbedtls_sha256_finish_ret( &ctx, sum );
+    bench_report("engine stream, 100 B updates", g_tick_cnt - t0);
+    mbedtls_sha256_free( &ctx );
+
+    SysTick->CTRL = 0;
+}
+
 
 /*----------------------------------------------------------------------------*/
 /* Test dispatch code */
@@ -728,7 +858,10 @@ volatile int  g_Crypto_Int_done = 0;
 
 void CRYPTO_IRQHandler()
 {
-    if (SHA_GET_INT_FLAG(CRPT))
+    /* Flags of the engines without CRPT jobs, the job queue handles the others */
+    uint32_t  u32Sts = CRPT_JobIRQHandler(CRPT);
+
+    if (u32Sts & (CRPT_INTSTS_HMACIF_Msk | CRPT_INTSTS_HMACEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         SHA_CLR_INT_FLAG(CRPT);
@@ -790,6 +923,9 @@ int main(void)
         printf("PASS count: %d\n", pass_cnt);
     }
     printf("All test file done.\n");
+
+    test_suite_sha256_interleave();
+    sha_stream_benchmark();
     while (1);
 }
 
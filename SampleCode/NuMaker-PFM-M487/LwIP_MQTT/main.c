@@ -126,17 +126,20 @@ volatile int  g_Crypto_Int_done = 0;
 
 void CRYPTO_IRQHandler()
 {
-    if (AES_GET_INT_FLAG(CRPT))
+    /* Flags of the engines without CRPT jobs, the job queue handles the others */
+    uint32_t  u32Sts = CRPT_JobIRQHandler(CRPT);
+
+    if (u32Sts & (CRPT_INTSTS_AESIF_Msk | CRPT_INTSTS_AESEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         AES_CLR_INT_FLAG(CRPT);
     }
-    if (TDES_GET_INT_FLAG(CRPT))
+    if (u32Sts & (CRPT_INTSTS_TDESIF_Msk | CRPT_INTSTS_TDESEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         TDES_CLR_INT_FLAG(CRPT);
     }
-    if (SHA_GET_INT_FLAG(CRPT))
+    if (u32Sts & (CRPT_INTSTS_HMACIF_Msk | CRPT_INTSTS_HMACEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         SHA_CLR_INT_FLAG(CRPT);
@@ -145,12 +148,74 @@ void CRYPTO_IRQHandler()
     ECC_Complete(CRPT);
 }
 
+/* Completion callback of a CRPT job, wakes up the task waiting for it */
+static void crpt_job_wake(CRPT_JOB_T *job)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    vTaskNotifyGiveFromISR((TaskHandle_t)job->pvParam, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* CRPT_JobRun() runner: block the calling task instead of spinning on the engine */
+static int32_t crpt_job_run(CRPT_T *crpt, CRPT_JOB_T *job)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        job->pfnDone = NULL;
+        if (CRPT_JobSubmit(crpt, job) != 0)
+            return -1;
+        while (job->i32Status > CRPT_JOB_DONE);
+        return job->i32Status;
+    }
+
+    job->pfnDone = crpt_job_wake;
+    job->pvParam = xTaskGetCurrentTaskHandle();
+    if (CRPT_JobSubmit(crpt, job) != 0)
+        return -1;
 
+    while (job->i32Status > CRPT_JOB_DONE)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return job->i32Status;
+}
+
+/* One recursive mutex per CRPT engine */
+static SemaphoreHandle_t  s_axCrptLock[CRPT_JOB_ENGINE_CNT];
+
+/*
+ * CRPT_JobLock() hook. The mbedtls glue holds an engine for a whole sequence: key and IV
+ * registers, a DMA cascade, the shared DMA buffers of aes.c, gcm.c and des.c and the SHA
+ * engine owner. crpt_job_run() sleeps in the middle of such a sequence, so another task
+ * using the same engine must wait here rather than overwrite them.
+ */
+static void crpt_lock(uint32_t u32Engine)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        xSemaphoreTakeRecursive(s_axCrptLock[u32Engine], portMAX_DELAY);
+}
+
+static void crpt_unlock(uint32_t u32Engine)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        xSemaphoreGiveRecursive(s_axCrptLock[u32Engine]);
+}
+
+
+
+static int32_t crpt_job_run(CRPT_T *crpt, CRPT_JOB_T *job);
+static void crpt_lock(uint32_t u32Engine);
+static void crpt_unlock(uint32_t u32Engine);
 
 int main(void)
 {
+    uint32_t  i;
+
     /* Configure the hardware ready to run the test. */
     prvSetupHardware();
+    CRPT_JobSetRunner(crpt_job_run);
+    for (i = 0; i < CRPT_JOB_ENGINE_CNT; i++)
+        s_axCrptLock[i] = xSemaphoreCreateRecursiveMutex();
+    CRPT_JobSetLock(crpt_lock, crpt_unlock);
 
     xTaskCreate( vMqttTask, "MQTT", TCPIP_THREAD_STACKSIZE, NULL, mainCHECK_TASK_PRIORITY, NULL );//350
 
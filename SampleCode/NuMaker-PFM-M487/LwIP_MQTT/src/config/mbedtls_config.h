@@ -51,6 +51,11 @@ extern void print_hex(uint8_t *hex, int len);
 #define NUVOTON_ENABLE_SHA
 #define NUVOTON_ENABLE_ECC
 
+/**
+ *  RSA (certificate chain verify) on the Cortex-M4 UMAAL bignum kernels
+ */
+#define NUVOTON_MPI_UMAAL
+
 extern volatile int g_Crypto_Int_done;
 
 
@@ -120,10 +120,23 @@ unsigned char my_mac_addr[6] = {0x00, 0x00, 0x00, 0x55, 0x66, 0x77};
 struct netif netif;
 static void vSslTask( void *pvParameters );
 
+static int32_t crpt_job_run(CRPT_T *crpt, CRPT_JOB_T *job);
+static void crpt_lock(uint32_t u32Engine);
+static void crpt_unlock(uint32_t u32Engine);
+
+/* One recursive mutex per CRPT engine, see crpt_lock() */
+static SemaphoreHandle_t  s_axCrptLock[CRPT_JOB_ENGINE_CNT];
+
 int main(void)
 {
+    uint32_t  i;
+
     /* Configure the hardware ready to run the test. */
     prvSetupHardware();
+    CRPT_JobSetRunner(crpt_job_run);
+    for (i = 0; i < CRPT_JOB_ENGINE_CNT; i++)
+        s_axCrptLock[i] = xSemaphoreCreateRecursiveMutex();
+    CRPT_JobSetLock(crpt_lock, crpt_unlock);
 
     xTaskCreate( vSslTask, "ssl", TCPIP_THREAD_STACKSIZE, NULL, mainCHECK_TASK_PRIORITY, NULL );
 
@@ -171,6 +184,7 @@ static void prvSetupHardware( void )
     CLK_EnableModuleClock(UART0_MODULE);
     CLK_EnableModuleClock(EMAC_MODULE);
     CLK_EnableModuleClock(CRPT_MODULE);
+    CLK_EnableModuleClock(TRNG_MODULE);
 
     /* Select IP clock source */
     CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL1_UART0SEL_HXT, CLK_CLKDIV0_UART0(1));
@@ -201,17 +215,30 @@ static void prvSetupHardware( void )
                   (GPIO_SLEWCTL_HIGH << GPIO_SLEWCTL_HSREN11_Pos) |
                   (GPIO_SLEWCTL_HIGH << GPIO_SLEWCTL_HSREN12_Pos);
 
+    /* TRNG runs from LIRC through the RTC clock */
+    CLK->PWRCTL |= CLK_PWRCTL_LIRCEN_Msk;
+    while((CLK->STATUS & CLK_STATUS_LIRCSTB_Msk) == 0);
+    RTC->LXTCTL |= 0x81;
+
+    /* Start the entropy pool that seeds mbedtls_ctr_drbg, see NUVOTON_ENABLE_TRNG */
+    TRNG_PoolOpen();
+    TRNG_SET_CLKP(0);                  /* PCLK is 96 MHz */
+
     /* Lock protected registers */
     SYS_LockReg();
 
     /* Init UART to 115200-8n1 for print message */
     UART_Open(UART0, 115200);
 
+    /* Completion callbacks use the FreeRTOS FromISR API */
+    NVIC_SetPriority(CRPT_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1);
     NVIC_EnableIRQ(CRPT_IRQn);
     ECC_ENABLE_INT(CRPT);
     SHA_ENABLE_INT(CRPT);
     TDES_ENABLE_INT(CRPT);
     AES_ENABLE_INT(CRPT);
+
+    NVIC_EnableIRQ(TRNG_IRQn);
 }
 /*-----------------------------------------------------------*/
 
@@ -306,19 +333,27 @@ static void vSslTask( void *pvParameters )
 }
 
 
+void TRNG_IRQHandler()
+{
+    TRNG_PoolIRQHandler();
+}
+
 void CRYPTO_IRQHandler()
 {
-    if (AES_GET_INT_FLAG(CRPT))
+    /* Flags of the engines without CRPT jobs, the job queue handles the others */
+    uint32_t  u32Sts = CRPT_JobIRQHandler(CRPT);
+
+    if (u32Sts & (CRPT_INTSTS_AESIF_Msk | CRPT_INTSTS_AESEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         AES_CLR_INT_FLAG(CRPT);
     }
-    if (TDES_GET_INT_FLAG(CRPT))
+    if (u32Sts & (CRPT_INTSTS_TDESIF_Msk | CRPT_INTSTS_TDESEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         TDES_CLR_INT_FLAG(CRPT);
     }
-    if (SHA_GET_INT_FLAG(CRPT))
+    if (u32Sts & (CRPT_INTSTS_HMACIF_Msk | CRPT_INTSTS_HMACEIF_Msk))
     {
         g_Crypto_Int_done = 1;
         SHA_CLR_INT_FLAG(CRPT);
@@ -326,3 +361,52 @@ void CRYPTO_IRQHandler()
     ECC_Complete(CRPT);
 }
 
+/* Completion callback of a CRPT job, wakes up the task waiting for it */
+static void crpt_job_wake(CRPT_JOB_T *job)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    vTaskNotifyGiveFromISR((TaskHandle_t)job->pvParam, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* CRPT_JobRun() runner: block the calling task instead of spinning on the engine */
+static int32_t crpt_job_run(CRPT_T *crpt, CRPT_JOB_T *job)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        job->pfnDone = NULL;
+        if (CRPT_JobSubmit(crpt, job) != 0)
+            return -1;
+        while (job->i32Status > CRPT_JOB_DONE);
+        return job->i32Status;
+    }
+
+    job->pfnDone = crpt_job_wake;
+    job->pvParam = xTaskGetCurrentTaskHandle();
+    if (CRPT_JobSubmit(crpt, job) != 0)
+        return -1;
+
+    while (job->i32Status > CRPT_JOB_DONE)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return job->i32Status;
+}
+
+/*
+ * CRPT_JobLock() hook. The mbedtls glue holds an engine for a whole sequence: key and IV
+ * registers, a DMA cascade, the shared DMA buffers of aes.c, gcm.c and des.c and the SHA
+ * engine owner. crpt_job_run() sleeps in the middle of such a sequence, so another task
+ * using the same engine must wait here rather than overwrite them.
+ */
+static void crpt_lock(uint32_t u32Engine)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        xSemaphoreTakeRecursive(s_axCrptLock[u32Engine], portMAX_DELAY);
+}
+
+static void crpt_unlock(uint32_t u32Engine)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        xSemaphoreGiveRecursive(s_axCrptLock[u32Engine]);
+}
+
@@ -51,6 +51,18 @@ extern void print_hex(uint8_t *hex, int len);
 #define NUVOTON_ENABLE_SHA
 #define NUVOTON_ENABLE_ECC
 
+/**
+ *  Seed the entropy module from the TRNG entropy pool, see
+ *  nvt_trng_entropy_poll(). main.c starts the pool with TRNG_PoolOpen() and
+ *  keeps it filled from TRNG_IRQHandler().
+ */
+#define NUVOTON_ENABLE_TRNG
+
+/**
+ *  RSA (certificate chain verify) on the Cortex-M4 UMAAL bignum kernels
+ */
+#define NUVOTON_MPI_UMAAL
+
 extern volatile int g_Crypto_Int_done;
 
 
@@ -475,7 +487,7 @@ extern volatile int g_Crypto_Int_done;
  * Requires MBEDTLS_ENTROPY_C, MBEDTLS_NO_DEFAULT_ENTROPY_SOURCES
  *
  */
-#define MBEDTLS_TEST_NULL_ENTROPY
+//#define MBEDTLS_TEST_NULL_ENTROPY
 
 /**
  * \def MBEDTLS_ENTROPY_HARDWARE_ALT
@@ -219,6 +219,15 @@ int32_t main(void)
 
     while (1)
     {
+        /*
+         *  Sleep until a USB Host interrupt posts a port change. Interrupts are disabled
+         *  around the check, and __WFI() still wakes up on a pending interrupt.
+         */
+        __disable_irq();
+        if (!usbh_hub_event_pending())
+            __WFI();
+        __enable_irq();
+
         if (usbh_pooling_hubs())             /* USB Host port detect polling and management */
         {
             // usbh_memory_used();           /* print out USB memory allocating information */
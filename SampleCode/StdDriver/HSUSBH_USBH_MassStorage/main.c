@@ -351,6 +351,93 @@ unsigned long get_fattime (void)
 static FIL file1, file2;        /* File objects */
 
 
+#define STREAM_REQ_NUM      2                   /* requests kept queued by the stream test     */
+#define STREAM_BUFF_SIZE    (16*1024)           /* bytes read by each request                  */
+#define STREAM_TEST_SIZE    0x800000            /* bytes read by the stream test               */
+
+static UMAS_REQ_T  stream_req[STREAM_REQ_NUM];
+#ifdef __ICCARM__
+#pragma data_alignment=32
+static BYTE  stream_buff[STREAM_REQ_NUM][STREAM_BUFF_SIZE];
+#else
+static BYTE  stream_buff[STREAM_REQ_NUM][STREAM_BUFF_SIZE] __attribute__((aligned(32)));
+#endif
+static volatile uint32_t  stream_next_sec, stream_end_sec, stream_bytes;
+static volatile int       stream_err;
+
+/*
+ *  Mass storage read request done callback of the stream test. The request is queued again
+ *  for the next sectors, so that the disk always has a command waiting.
+ *  NOTICE: This callback function is in USB Host interrupt context!
+ */
+void stream_read_done(UMAS_REQ_T *req)
+{
+    if (req->status != 0)
+    {
+        stream_err = req->status;
+        return;
+    }
+    stream_bytes += req->sec_cnt * 512;
+    if (stream_next_sec < stream_end_sec)
+    {
+        usbh_umas_read_async(req->drv_no, stream_next_sec, STREAM_BUFF_SIZE/512, req->buff,
+                             req, stream_read_done, NULL);
+        stream_next_sec += STREAM_BUFF_SIZE/512;
+    }
+}
+
+/*
+ *  Read STREAM_TEST_SIZE bytes from sector <sec_no> on, blocking reads first, then with
+ *  STREAM_REQ_NUM requests queued.
+ */
+void stream_read_test(int drv_no, uint32_t sec_no)
+{
+    uint32_t  t, i;
+    int       ret;
+
+    printf("Blocking read, %d KB per read...\n", STREAM_BUFF_SIZE/1024);
+    timer_init();
+    for (i = 0; i < STREAM_TEST_SIZE/STREAM_BUFF_SIZE; i++)
+    {
+        ret = usbh_umas_read(drv_no, sec_no + i * (STREAM_BUFF_SIZE/512), STREAM_BUFF_SIZE/512, stream_buff[0]);
+        if (ret != 0)
+        {
+            printf("read failed at %d, rc=%d\n", sec_no + i * (STREAM_BUFF_SIZE/512), ret);
+            return;
+        }
+    }
+    t = get_timer_value();
+    printf("time = %d.%02d, %d KB/s\n", t/100, t % 100, ((STREAM_TEST_SIZE * 100) / (t ? t : 1))/1024);
+
+    printf("Queued read, %d requests of %d KB...\n", STREAM_REQ_NUM, STREAM_BUFF_SIZE/1024);
+    stream_next_sec = sec_no;
+    stream_end_sec = sec_no + STREAM_TEST_SIZE/512;
+    stream_bytes = 0;
+    stream_err = 0;
+    timer_init();
+    for (i = 0; i < STREAM_REQ_NUM; i++)
+    {
+        usbh_umas_read_async(drv_no, stream_next_sec, STREAM_BUFF_SIZE/512, stream_buff[i],
+                             &stream_req[i], stream_read_done, NULL);
+        stream_next_sec += STREAM_BUFF_SIZE/512;
+    }
+    while ((stream_bytes < STREAM_TEST_SIZE) && (stream_err == 0))
+        usbh_umas_poll();
+    for (i = 0; i < STREAM_REQ_NUM; i++)
+    {
+        while (!stream_req[i].bIsDone)
+            usbh_umas_poll();
+    }
+    t = get_timer_value();
+    if (stream_err)
+    {
+        printf("read failed, rc=%d\n", stream_err);
+        return;
+    }
+    printf("time = %d.%02d, %d KB/s\n", t/100, t % 100, ((STREAM_TEST_SIZE * 100) / (t ? t : 1))/1024);
+}
+
+
 /*
  *  Interrupt-In transfer data delivery callback function.
  */
@@ -638,6 +725,11 @@ int32_t main(void)
                 printf("Raw write speed: %d KB/s\n", ((0x800000 * 100) / p1)/1024);
                 break;
 
+            case 's' :  /* ds [<lba>] - queued sector read performance test */
+                if (!xatoi(&ptr, &p2)) p2 = 10000;
+                stream_read_test(3, p2);
+                break;
+
             case 'z' :  /* dz - file read/write performance test */
 #if 0
                 printf("File write performance test...\n");
@@ -1107,7 +1199,7 @@ int32_t main(void)
             printf(
                 _T("n: - Change default drive (USB drive is 3~7)\n")
                 _T("dd [<lba>] - Dump sector\n")
-                //_T("ds <pd#> - Show disk status\n")
+                _T("ds [<lba>] - Blocking and queued sector read speed\n")
                 _T("\n")
                 _T("bd <ofs> - Dump working buffer\n")
                 _T("be <ofs> [<data>] ... - Edit working buffer\n")
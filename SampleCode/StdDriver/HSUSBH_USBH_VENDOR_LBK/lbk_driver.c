@@ -40,6 +40,12 @@ typedef struct lbk_device_t
 
 volatile struct lbk_device_t  g_lbk_dev;
 
+static uint32_t  _bulk_stream_buff[BULK_UTR_NUM][BULK_XFER_SIZE/4];
+static volatile int       _bulk_stream_run;    /* re-submit the completed UTRs while set   */
+static volatile int       _bulk_stream_idle;   /* number of UTRs not re-submitted          */
+static volatile int       _bulk_stream_err;
+static volatile uint32_t  _bulk_stream_len;
+
 
 /*
  *  Issue a vendor command REQ_SET_DATA to send data to Vendor LBK device.
@@ -193,6 +199,100 @@ int lbk_bulk_read(uint8_t *data_buff, int data_len, int timeout_ticks)
     return ret;
 }
 
+static void  bulk_stream_done(UTR_T *utr)
+{
+    _bulk_stream_len += utr->xfer_len;
+
+    if ((utr->status != 0) && (_bulk_stream_err == 0))
+        _bulk_stream_err = utr->status;
+
+    if (_bulk_stream_run && (_bulk_stream_err == 0))
+    {
+        utr->xfer_len = 0;
+        utr->bIsTransferDone = 0;
+        if (usbh_bulk_xfer(utr) == 0)
+            return;
+        _bulk_stream_err = USBH_ERR_TRANSFER;
+    }
+    _bulk_stream_idle++;
+}
+
+/*
+ *  Keep <utr_num> bulk transfers of <data_len> bytes queued on the bulk-in or bulk-out
+ *  endpoint of Vendor LBK device for <run_ticks> ticks. A transfer is issued again as soon
+ *  as it is done, while the other ones keep the bus busy.
+ *  <total_len> returns the number of bytes transferred.
+ */
+int lbk_bulk_stream(int bIsIn, int utr_num, int data_len, uint32_t run_ticks, uint32_t *total_len)
+{
+    UTR_T     *utr[BULK_UTR_NUM];
+    uint32_t  t0;
+    int       i, utr_cnt, ret = 0;
+
+    *total_len = 0;
+
+    if ((g_lbk_dev.udev == NULL) || (g_lbk_dev.ep_bulk_in == NULL) || (g_lbk_dev.ep_bulk_out == NULL))
+        return -1;
+
+    if ((utr_num < 1) || (utr_num > BULK_UTR_NUM) || (data_len < 1) || (data_len > BULK_XFER_SIZE))
+        return USBH_ERR_INVALID_PARAM;
+
+    _bulk_stream_run = 1;
+    _bulk_stream_idle = 0;
+    _bulk_stream_err = 0;
+    _bulk_stream_len = 0;
+
+    for (utr_cnt = 0; utr_cnt < utr_num; utr_cnt++)
+    {
+        utr[utr_cnt] = alloc_utr(g_lbk_dev.udev);
+        if (!utr[utr_cnt])
+        {
+            ret = USBH_ERR_MEMORY_OUT;
+            break;
+        }
+
+        utr[utr_cnt]->ep = bIsIn ? g_lbk_dev.ep_bulk_in : g_lbk_dev.ep_bulk_out;
+        utr[utr_cnt]->buff = (uint8_t *)_bulk_stream_buff[utr_cnt];
+        utr[utr_cnt]->data_len = data_len;
+        utr[utr_cnt]->xfer_len = 0;
+        utr[utr_cnt]->func = bulk_stream_done;
+        utr[utr_cnt]->bIsTransferDone = 0;
+
+        ret = usbh_bulk_xfer(utr[utr_cnt]);
+        if (ret < 0)
+        {
+            free_utr(utr[utr_cnt]);
+            break;
+        }
+    }
+
+    t0 = get_ticks();
+    while ((ret == 0) && (_bulk_stream_err == 0) && (get_ticks() - t0 < run_ticks))
+        ;
+
+    _bulk_stream_run = 0;                   /* let the queued transfers drain             */
+
+    t0 = get_ticks();
+    while ((utr_cnt > 0) && (_bulk_stream_idle < utr_cnt))
+    {
+        if (get_ticks() - t0 > 100)
+        {
+            usbh_quit_utr(utr[0]);          /* aborts all UTRs queued on the endpoint     */
+            ret = USBH_ERR_TIMEOUT;
+            break;
+        }
+    }
+
+    for (i = 0; i < utr_cnt; i++)
+        free_utr(utr[i]);
+
+    *total_len = _bulk_stream_len;
+
+    if (ret == 0)
+        ret = _bulk_stream_err;
+    return ret;
+}
+
 static void  int_in_done(UTR_T *utr)
 {
     int         ret;
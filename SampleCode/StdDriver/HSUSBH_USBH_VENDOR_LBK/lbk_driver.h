@@ -22,6 +22,9 @@
 
 #define ISO_UTR_NUM       2
 
+#define BULK_UTR_NUM      4             /* maximum number of bulk UTRs queued by lbk_bulk_stream() */
+#define BULK_XFER_SIZE    8192          /* maximum transfer length of each of them                 */
+
 typedef int (INT_CB_FUNC)(int status, uint8_t *rdata, int data_len);
 typedef int (ISO_CB_FUNC)(uint8_t *rdata, int data_len);
 
@@ -37,6 +40,7 @@ extern int  lbk_vendor_set_data(uint8_t *buff);
 extern int  lbk_vendor_get_data(uint8_t *buff);
 extern int  lbk_bulk_write(uint8_t *data_buff, int data_len, int timeout_ticks);
 extern int  lbk_bulk_read(uint8_t *data_buff, int data_len, int timeout_ticks);
+extern int  lbk_bulk_stream(int bIsIn, int utr_num, int data_len, uint32_t run_ticks, uint32_t *total_len);
 extern int  lbk_interrupt_in_start(INT_CB_FUNC *func);
 extern void lbk_interrupt_in_stop(void);
 extern int  lbk_interrupt_out_start(INT_CB_FUNC *func);
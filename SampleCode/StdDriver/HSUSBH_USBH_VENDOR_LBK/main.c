@@ -302,6 +302,40 @@ void demo_bulk_xfer(void)
     }
 }
 
+/*
+ *  Compare the bulk throughput of one transfer at a time with several transfers
+ *  queued on the endpoint, which leaves the host controller no idle time between them.
+ */
+void demo_bulk_throughput(void)
+{
+    uint32_t   t0, ticks, total_len;
+    int        bIsIn, utr_num, ret;
+
+    printf("\nBulk throughput, %d bytes per transfer, 2 seconds each:\n\n", BULK_XFER_SIZE);
+    printf("  Direction   Queued transfers   KB/s\n");
+
+    for (bIsIn = 0; bIsIn <= 1; bIsIn++)
+    {
+        for (utr_num = 1; utr_num <= BULK_UTR_NUM; utr_num *= 2)
+        {
+            if (!lbk_device_is_connected())
+                return;
+
+            t0 = get_ticks();
+            ret = lbk_bulk_stream(bIsIn, utr_num, BULK_XFER_SIZE, 200, &total_len);
+            ticks = get_ticks() - t0;
+            if (ret < 0)
+            {
+                printf("Bulk transfer failed (%d). Stop bulk throughput test.\n", ret);
+                return;
+            }
+
+            printf("  %-9s   %16d   %d\n", bIsIn ? "Bulk-in" : "Bulk-out", utr_num,
+                   (ticks > 0) ? (int)(total_len / 1024 * 100 / ticks) : 0);
+        }
+    }
+}
+
 int int_in_callback(int status, uint8_t *rdata, int data_len)
 {
     if (status < 0)
@@ -449,6 +483,7 @@ void vendor_lbk_demo(void)
         printf("| [2] Bulk transfer demo                   |\n");
         printf("| [3] Interrupt transfer demo              |\n");
         printf("| [4] Isochronous transfer demo            |\n");
+        printf("| [5] Bulk throughput demo                 |\n");
         printf("+------------------------------------------+\n");
 
         usbh_memory_used();
@@ -477,6 +512,10 @@ void vendor_lbk_demo(void)
         case '4':
             demo_isochronous_xfer();
             break;
+
+        case '5':
+            demo_bulk_throughput();
+            break;
         }
 
         usbh_pooling_hubs();
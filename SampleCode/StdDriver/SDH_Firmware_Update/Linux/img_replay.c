@@ -0,0 +1,335 @@
+/**************************************************************************//**
+ * @file     img_replay.c
+ * @version  V1.00
+ * @brief    Replay an update image through img_verify.c on the host, with
+ *           the storage, the flash and the SHA engine throttled to given
+ *           throughputs. The SHA jobs and the signature check run on
+ *           crypto.c and the CRPT register model of Crypto_MbedTLS/Linux:
+ *
+ *             ./img_replay -s AP.BIN AP.SIG          sign with the sample key
+ *             ./img_replay [-r kBps] [-p kBps] [-h kBps] AP.BIN AP.SIG
+ *
+ *           The image is verified and programmed twice: serially (read it
+ *           all, hash it in place, then program it) and pipelined
+ *           (IMGV_VerifyStream programming each chunk from the buffer it is
+ *           hashed from, as sd_update.c does). Both digests must agree with a
+ *           plain mbedtls SHA-256 of the file, and the flash with the file.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NuMicro.h"
+#include "crpt_model.h"
+#include "test_util.h"
+#include "img_verify.h"
+#include "image_key.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/sha256.h"
+
+#define REPLAY_IMAGE_MAX    (2UL * 1024UL * 1024UL)
+#define REPLAY_READ_KBPS    4000UL      /* SD card through FatFs                  */
+#define REPLAY_HASH_KBPS    4000UL      /* SHA engine                             */
+#define REPLAY_PROG_KBPS    16000UL     /* flash programming                      */
+
+/* The sample private key of image_key.h. Never ship a key like this. */
+static const uint8_t s_au8SampleKey[32] =
+{
+    0xC1, 0xCF, 0x3E, 0x64, 0xD8, 0xC7, 0x7D, 0x1E, 0xB8, 0x0C, 0x0E, 0xAF, 0x2F, 0xCF, 0x41, 0x01,
+    0xB9, 0xB9, 0x67, 0x2B, 0xE9, 0x2A, 0x5B, 0xBD, 0x48, 0xD8, 0x4B, 0x4A, 0x46, 0x39, 0xEC, 0x96,
+};
+
+/* Whole image for the serial run, word aligned for the SHA DMA */
+static uint32_t s_au32Image[REPLAY_IMAGE_MAX / 4UL];
+
+/* The flash programmed by the pipelined run */
+static uint8_t  s_au8Flash[REPLAY_IMAGE_MAX];
+
+/* Arguments and result of replay_run() */
+static const char  *s_pcImage, *s_pcSig;
+static uint32_t  s_u32ReadKBps = REPLAY_READ_KBPS, s_u32ProgKBps = REPLAY_PROG_KBPS;
+static uint32_t  s_u32HashKBps = REPLAY_HASH_KBPS;
+static int  s_iResult;
+
+typedef struct
+{
+    FILE      *pFile;
+    uint32_t  u32KBps;
+    uint32_t  u32ProgKBps;
+    uint64_t  u64BusyNs;                /* time spent in reads and programming    */
+} REPLAY_READER_T;
+
+
+static uint64_t replay_now_ns(void)
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Keep the CPU busy until u32Len bytes at u32KBps have passed since u64Start, the SHA jobs
+   go on meanwhile */
+static void replay_throttle(REPLAY_READER_T *pReader, uint64_t u64Start, uint32_t u32Len, uint32_t u32KBps)
+{
+    crpt_model_sleep_until(u64Start + (uint64_t)u32Len * 1000000ULL / u32KBps);
+
+    pReader->u64BusyNs += replay_now_ns() - u64Start;
+}
+
+/* IMGV_READ_FUNC of the replayed file, no faster than u32KBps */
+static int32_t replay_read(void *pvParam, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    REPLAY_READER_T  *pReader = (REPLAY_READER_T *)pvParam;
+    uint64_t  u64Start = replay_now_ns();
+
+    if (fread(pu8Buf, 1, u32Len, pReader->pFile) != u32Len)
+        return -1;
+
+    replay_throttle(pReader, u64Start, u32Len, pReader->u32KBps);
+    return 0;
+}
+
+/* IMGV_WRITE_FUNC into s_au8Flash, no faster than u32ProgKBps */
+static int32_t replay_program(void *pvParam, const uint8_t *pu8Buf, uint32_t u32Offset, uint32_t u32Len)
+{
+    REPLAY_READER_T  *pReader = (REPLAY_READER_T *)pvParam;
+    uint64_t  u64Start = replay_now_ns();
+
+    memcpy(&s_au8Flash[u32Offset], pu8Buf, u32Len);
+
+    replay_throttle(pReader, u64Start, u32Len, pReader->u32ProgKBps);
+    return 0;
+}
+
+static int replay_load(const char *pcName, uint8_t *pu8Buf, uint32_t u32Max, uint32_t *pu32Len)
+{
+    FILE  *pFile = fopen(pcName, "rb");
+
+    if (pFile == NULL)
+    {
+        perror(pcName);
+        return -1;
+    }
+    *pu32Len = (uint32_t)fread(pu8Buf, 1, u32Max, pFile);
+    fclose(pFile);
+    return 0;
+}
+
+/* Deterministic ECDSA (RFC 6979) over the SHA-256 of the image */
+static int replay_sign(const char *pcImage, const char *pcSig)
+{
+    mbedtls_ecp_group  grp;
+    mbedtls_mpi  d, r, s;
+    unsigned char  au8Hash[32], au8Sig[IMGV_SIG_SIZE];
+    uint32_t  u32Len;
+    FILE  *pFile;
+    int   ret;
+
+    if (replay_load(pcImage, (uint8_t *)s_au32Image, sizeof(s_au32Image), &u32Len) != 0)
+        return 1;
+    mbedtls_sha256_ret((const unsigned char *)s_au32Image, u32Len, au8Hash, 0);
+
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+
+    ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (ret == 0)
+        ret = mbedtls_mpi_read_binary(&d, s_au8SampleKey, sizeof(s_au8SampleKey));
+    if (ret == 0)
+        ret = mbedtls_ecdsa_sign_det(&grp, &r, &s, &d, au8Hash, sizeof(au8Hash), MBEDTLS_MD_SHA256);
+    if (ret == 0)
+        ret = mbedtls_mpi_write_binary(&r, au8Sig, 32);
+    if (ret == 0)
+        ret = mbedtls_mpi_write_binary(&s, au8Sig + 32, 32);
+
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&d);
+    mbedtls_ecp_group_free(&grp);
+
+    if (ret != 0)
+    {
+        fprintf(stderr, "signing failed: -0x%04x\n", (unsigned)-ret);
+        return 1;
+    }
+
+    pFile = fopen(pcSig, "wb");
+    if (pFile == NULL || fwrite(au8Sig, 1, sizeof(au8Sig), pFile) != sizeof(au8Sig))
+    {
+        perror(pcSig);
+        return 1;
+    }
+    fclose(pFile);
+    printf("%s: %u bytes signed into %s\n", pcImage, (unsigned)u32Len, pcSig);
+    return 0;
+}
+
+static int replay_verify(const char *pcImage, const char *pcSig, uint32_t u32ReadKBps, uint32_t u32ProgKBps,
+                         uint32_t u32HashKBps)
+{
+    REPLAY_READER_T  reader;
+    CRPT_MODEL_STAT_T  hash;
+    IMGV_STAT_T  stat;
+    uint8_t   au8Sig[IMGV_SIG_SIZE];
+    unsigned char  au8Hash[32];
+    uint32_t  au32Serial[8], au32Stream[8], au32Ref[8];
+    uint32_t  u32Len, i;
+    uint64_t  u64Start, u64SerialNs, u64StreamNs, u64ReadNs;
+    int32_t   i32Serial, i32Stream;
+
+    if (replay_load(pcSig, au8Sig, sizeof(au8Sig), &u32Len) != 0)
+        return 1;
+    if (u32Len != IMGV_SIG_SIZE)
+    {
+        fprintf(stderr, "%s: not a %u byte signature\n", pcSig, (unsigned)IMGV_SIG_SIZE);
+        return 1;
+    }
+
+    reader.pFile = fopen(pcImage, "rb");
+    if (reader.pFile == NULL)
+    {
+        perror(pcImage);
+        return 1;
+    }
+    fseek(reader.pFile, 0, SEEK_END);
+    u32Len = (uint32_t)ftell(reader.pFile);
+    if (u32Len > REPLAY_IMAGE_MAX)
+    {
+        fprintf(stderr, "%s: larger than %u bytes\n", pcImage, (unsigned)REPLAY_IMAGE_MAX);
+        return 1;
+    }
+
+    /* The SHA engine as the board runs it, from the job queue of the CRYPTO interrupt */
+    crpt_test_init();
+    crpt_model_check_lock(1);
+    crpt_model_set_rate(CRPT_JOB_SHA, u32HashKBps);
+
+    /* Serial: the whole image is read, hashed and then programmed */
+    rewind(reader.pFile);
+    reader.u32KBps = u32ReadKBps;
+    reader.u32ProgKBps = u32ProgKBps;
+    reader.u64BusyNs = 0ULL;
+    u64Start = replay_now_ns();
+    for (i = 0UL; i < u32Len; i += IMGV_CHUNK_SIZE)
+    {
+        if (replay_read(&reader, (uint8_t *)s_au32Image + i, (u32Len - i < IMGV_CHUNK_SIZE) ? u32Len - i : IMGV_CHUNK_SIZE) != 0)
+            return 1;
+    }
+    i32Serial = IMGV_HashMemory((uint32_t)(uintptr_t)s_au32Image, u32Len, au32Serial);
+    if (i32Serial == IMGV_OK)
+        i32Serial = IMGV_VerifyDigest(au32Serial, g_au8ImageKey, au8Sig);
+    if (i32Serial == IMGV_OK)
+    {
+        for (i = 0UL; i < u32Len; i += IMGV_CHUNK_SIZE)
+            replay_throttle(&reader, replay_now_ns(), (u32Len - i < IMGV_CHUNK_SIZE) ? u32Len - i : IMGV_CHUNK_SIZE,
+                            u32ProgKBps);
+    }
+    u64SerialNs = replay_now_ns() - u64Start;
+
+    mbedtls_sha256_ret((const unsigned char *)s_au32Image, u32Len, au8Hash, 0);
+    for (i = 0UL; i < 8UL; i++)
+    {
+        au32Ref[i] = ((uint32_t)au8Hash[i * 4UL] << 24) | ((uint32_t)au8Hash[i * 4UL + 1UL] << 16) |
+                     ((uint32_t)au8Hash[i * 4UL + 2UL] << 8) | (uint32_t)au8Hash[i * 4UL + 3UL];
+    }
+
+    /* Pipelined: reads and programming overlap the SHA jobs */
+    rewind(reader.pFile);
+    reader.u64BusyNs = 0ULL;
+    memset(s_au8Flash, 0xFF, u32Len);
+    crpt_model_clear_stat();
+    u64Start = replay_now_ns();
+    i32Stream = IMGV_HashStream(replay_read, replay_program, &reader, u32Len, au32Stream, &stat);
+    if (i32Stream == IMGV_OK)
+        i32Stream = IMGV_VerifyDigest(au32Stream, g_au8ImageKey, au8Sig);
+    u64StreamNs = replay_now_ns() - u64Start;
+    u64ReadNs = reader.u64BusyNs;
+    crpt_model_stat(CRPT_JOB_SHA, &hash);
+    fclose(reader.pFile);
+
+    printf("# image %s, %u bytes, %u byte chunks, read %u kB/s, program %u kB/s, hash %u kB/s\n", pcImage,
+           (unsigned)u32Len, (unsigned)IMGV_CHUNK_SIZE, (unsigned)u32ReadKBps, (unsigned)u32ProgKBps,
+           (unsigned)u32HashKBps);
+    printf("digest   ");
+    for (i = 0UL; i < 8UL; i++)
+        printf("%08x", (unsigned)au32Ref[i]);
+    printf("\n");
+    printf("serial    %8.2f ms, %s\n", u64SerialNs / 1e6, (i32Serial == IMGV_OK) ? "valid" : "rejected");
+    printf("pipelined %8.2f ms, %s (read and program %.2f ms, hash %.2f ms, %u chunks, %u hash waits)\n",
+           u64StreamNs / 1e6, (i32Stream == IMGV_OK) ? "valid" : "rejected", u64ReadNs / 1e6, hash.u64BusyNs / 1e6,
+           (unsigned)stat.u32Chunks, (unsigned)stat.u32HashWaits);
+
+    if (((i32Serial == IMGV_OK) || (i32Serial == IMGV_ERR_SIG)) &&
+            memcmp(au32Serial, au32Ref, sizeof(au32Ref)) != 0)
+    {
+        printf("FAIL: serial digest differs from mbedtls\n");
+        return 2;
+    }
+    if (((i32Stream == IMGV_OK) || (i32Stream == IMGV_ERR_SIG)) &&
+            memcmp(au32Stream, au32Ref, sizeof(au32Ref)) != 0)
+    {
+        printf("FAIL: pipelined digest differs from mbedtls\n");
+        return 2;
+    }
+    if ((i32Stream != IMGV_ERR_READ) && memcmp(s_au8Flash, s_au32Image, u32Len) != 0)
+    {
+        printf("FAIL: programmed bytes differ from the image\n");
+        return 2;
+    }
+    if (i32Serial != i32Stream)
+    {
+        printf("FAIL: serial and pipelined results differ\n");
+        return 2;
+    }
+    return (i32Stream == IMGV_OK) ? 0 : 1;
+}
+
+static void replay_run(void)
+{
+    s_iResult = replay_verify(s_pcImage, s_pcSig, s_u32ReadKBps, s_u32ProgKBps, s_u32HashKBps);
+}
+
+static void replay_usage(void)
+{
+    fprintf(stderr, "usage: img_replay -s IMAGE SIG\n"
+            "       img_replay [-r read_kBps] [-p program_kBps] [-h hash_kBps] IMAGE SIG\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int  i = 1;
+
+    if (argc == 4 && strcmp(argv[1], "-s") == 0)
+        return replay_sign(argv[2], argv[3]);
+
+    while (i + 1 < argc && argv[i][0] == '-')
+    {
+        if (strcmp(argv[i], "-r") == 0)
+            s_u32ReadKBps = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "-p") == 0)
+            s_u32ProgKBps = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "-h") == 0)
+            s_u32HashKBps = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        else
+            break;
+        i += 2;
+    }
+    if (argc - i != 2 || s_u32ReadKBps == 0UL || s_u32ProgKBps == 0UL || s_u32HashKBps == 0UL)
+    {
+        replay_usage();
+        return 1;
+    }
+
+    /* img_verify.c and crypto.c run on the 32-bit addressable stack of the model */
+    s_pcImage = argv[i];
+    s_pcSig = argv[i + 1];
+    if (crpt_model_run(replay_run) != 0)
+        return 1;
+    return s_iResult;
+}
@@ -0,0 +1,25 @@
+/**************************************************************************//**
+ * @file     image_key.h
+ * @version  V1.00
+ * @brief    Public key the update images of this sample must be signed with.
+ *           It is the sample key of Linux/img_replay, which signs images
+ *           ("img_replay -s AP.BIN AP.SIG"). Replace it with the key of your
+ *           own signing server in a product.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __IMAGE_KEY_H__
+#define __IMAGE_KEY_H__
+
+#include "img_verify.h"
+
+/* ECDSA P-256 public key, Qx || Qy, big endian */
+static const uint8_t  g_au8ImageKey[IMGV_KEY_SIZE] =
+{
+    0x81, 0x6B, 0x58, 0xAC, 0x95, 0xE3, 0xD8, 0x24, 0xC0, 0x3F, 0x04, 0x7C, 0x2E, 0xB4, 0x08, 0x40,
+    0x1E, 0x85, 0x1B, 0x18, 0x1D, 0x81, 0xAF, 0x9B, 0x00, 0x5E, 0x05, 0x07, 0x89, 0xED, 0x38, 0xFC,
+    0x2A, 0x0C, 0x2D, 0x16, 0xF5, 0x99, 0xBD, 0xBF, 0xFD, 0xF9, 0xC2, 0xBA, 0x02, 0x6C, 0xF8, 0xBD,
+    0x9C, 0x73, 0xF5, 0x75, 0x71, 0x75, 0x60, 0xC3, 0x22, 0x36, 0xC9, 0x17, 0x59, 0x9D, 0x6F, 0xC4,
+};
+
+#endif /* __IMAGE_KEY_H__ */
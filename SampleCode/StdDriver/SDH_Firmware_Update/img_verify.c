@@ -0,0 +1,336 @@
+/**************************************************************************//**
+ * @file     img_verify.c
+ * @version  V1.00
+ * @brief    Streaming SHA-256/ECDSA P-256 verification of firmware images.
+ *           Reading and hashing run in parallel on two chunk buffers: while
+ *           the SHA engine hashes one chunk by DMA, it is written out and the
+ *           next one is read into the other buffer.
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <string.h>
+
+#include "NuMicro.h"
+#include "img_verify.h"
+
+#if (IMGV_CHUNK_SIZE % 64UL) != 0UL
+#error "IMGV_CHUNK_SIZE must be a multiple of the SHA-256 block size"
+#endif
+
+/* The SHA DMA reads whole words, so both buffers are word arrays */
+static uint32_t  s_au32Chunk[2][IMGV_CHUNK_SIZE / 4UL];
+
+static CRPT_JOB_REG_T  s_aJobRegs[2][3];
+static CRPT_JOB_T      s_aJob[2];
+
+/* Order n of the P-256 group, least significant word first */
+static const uint32_t  s_au32P256N[8] =
+{
+    0xFC632551UL, 0xF3B9CAC2UL, 0xA7179E84UL, 0xBCE6FAADUL,
+    0xFFFFFFFFUL, 0xFFFFFFFFUL, 0x00000000UL, 0xFFFFFFFFUL
+};
+
+
+/* Queue one SHA DMA transfer of an open cascade on the job queue of the engine */
+static void imgv_submit(uint32_t u32Idx, uint32_t u32Addr, uint32_t u32Len, uint32_t u32Ctl, uint32_t u32DMAMode)
+{
+    CRPT_JOB_T      *job = &s_aJob[u32Idx];
+    CRPT_JOB_REG_T  *regs = s_aJobRegs[u32Idx];
+
+    regs[0].pu32Reg = &CRPT->HMAC_SADDR;
+    regs[0].u32Val  = u32Addr;
+    regs[1].pu32Reg = &CRPT->HMAC_DMACNT;
+    regs[1].u32Val  = u32Len;
+    regs[2].pu32Reg = &CRPT->HMAC_CTL;
+    regs[2].u32Val  = u32Ctl | CRPT_HMAC_CTL_START_Msk | (u32DMAMode << CRPT_HMAC_CTL_DMALAST_Pos);
+
+    memset(job, 0, sizeof(CRPT_JOB_T));
+    job->u32Engine = CRPT_JOB_SHA;
+    job->pRegs     = regs;
+    job->u32RegCnt = 3UL;
+
+    CRPT_JobSubmit(CRPT, job);
+}
+
+/* Control word of the cascade, without the START and DMA mode bits */
+static uint32_t imgv_sha_open(void)
+{
+    SHA_Open(CRPT, SHA_MODE_SHA256, SHA_IN_SWAP, 0UL);
+    return CRPT->HMAC_CTL & ~(CRPT_HMAC_CTL_START_Msk | (0x7UL << CRPT_HMAC_CTL_DMALAST_Pos));
+}
+
+/* Big endian bytes to an ECC_xxxWords number, least significant word first */
+static void imgv_bytes_to_words(const uint8_t au8In[], uint32_t au32Out[])
+{
+    uint32_t  i;
+
+    memset(au32Out, 0, ECC_KEY_WORD_MAX * 4UL);
+    for (i = 0UL; i < 8UL; i++)
+    {
+        au32Out[i] = ((uint32_t)au8In[28UL - i * 4UL] << 24) | ((uint32_t)au8In[29UL - i * 4UL] << 16) |
+                     ((uint32_t)au8In[30UL - i * 4UL] << 8) | (uint32_t)au8In[31UL - i * 4UL];
+    }
+}
+
+/* The ECC engine does not check it: R and S of a valid signature are in 1..n-1 */
+static int32_t imgv_in_range(const uint32_t au32X[])
+{
+    int32_t  i;
+    uint32_t u32Or = 0UL;
+
+    for (i = 0; i < 8; i++)
+    {
+        u32Or |= au32X[i];
+    }
+    if (u32Or == 0UL)
+    {
+        return 0;
+    }
+
+    for (i = 7; i >= 0; i--)
+    {
+        if (au32X[i] != s_au32P256N[i])
+        {
+            return (au32X[i] < s_au32P256N[i]) ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
+/**
+  * @brief  Compute the SHA-256 digest of an image delivered by a read function.
+  * @param[in]  pfnRead     Reads the next bytes of the image.
+  * @param[in]  pfnWrite    Takes each chunk read, may be NULL.
+  * @param[in]  pvParam     Passed to pfnRead and pfnWrite.
+  * @param[in]  u32ImageLen Image size in bytes.
+  * @param[out] au32Digest  The digest, as HMAC_DGST0~7 hold it.
+  * @param[out] pStat       Statistics of the run, may be NULL.
+  * @return  IMGV_OK, IMGV_ERR_READ, IMGV_ERR_WRITE or IMGV_ERR_HASH. An empty image
+  *          is a read error.
+  * @details  Chunk n is written and chunk n+1 read while the engine hashes chunk n.
+  *           pfnRead and pfnWrite run in the caller's context and may block; the SHA
+  *           jobs go on from the CRYPTO interrupt meanwhile. Nothing is known about
+  *           the signature while chunks are written.
+  */
+int32_t IMGV_HashStream(IMGV_READ_FUNC pfnRead, IMGV_WRITE_FUNC pfnWrite, void *pvParam, uint32_t u32ImageLen,
+                        uint32_t au32Digest[8], IMGV_STAT_T *pStat)
+{
+    IMGV_STAT_T  stat;
+    uint32_t  u32Ctl, u32Left, u32Len, u32Idx, u32DMAMode;
+    int32_t   i32Ret = IMGV_OK;
+
+    if (u32ImageLen == 0UL)
+    {
+        return IMGV_ERR_READ;
+    }
+
+    memset(&stat, 0, sizeof(stat));
+    s_aJob[0].i32Status = CRPT_JOB_DONE;
+    s_aJob[1].i32Status = CRPT_JOB_DONE;
+
+    u32Left = u32ImageLen;
+    u32Idx  = 0UL;
+
+    u32Len = (u32Left < IMGV_CHUNK_SIZE) ? u32Left : IMGV_CHUNK_SIZE;
+    if (pfnRead(pvParam, (uint8_t *)s_au32Chunk[0], u32Len) != 0)
+    {
+        return IMGV_ERR_READ;
+    }
+
+    /* The cascade runs in the engine from the first job to SHA_Read() */
+    CRPT_JobLock(CRPT_JOB_SHA);
+    u32Ctl = imgv_sha_open();
+
+    for (;;)
+    {
+        u32Left -= u32Len;
+        if (stat.u32Chunks == 0UL)
+        {
+            u32DMAMode = (u32Left == 0UL) ? CRYPTO_DMA_ONE_SHOT : CRYPTO_DMA_FIRST;
+        }
+        else
+        {
+            u32DMAMode = (u32Left == 0UL) ? CRYPTO_DMA_LAST : CRYPTO_DMA_CONTINUE;
+        }
+
+        imgv_submit(u32Idx, (uint32_t)(uintptr_t)s_au32Chunk[u32Idx], u32Len, u32Ctl, u32DMAMode);
+
+        /* The engine only reads the buffer, so the chunk is written out meanwhile */
+        if ((pfnWrite != NULL) &&
+                (pfnWrite(pvParam, (const uint8_t *)s_au32Chunk[u32Idx], stat.u32Bytes, u32Len) != 0))
+        {
+            i32Ret = IMGV_ERR_WRITE;
+            break;
+        }
+        stat.u32Chunks++;
+        stat.u32Bytes += u32Len;
+
+        if (u32Left == 0UL)
+        {
+            break;
+        }
+
+        /* The other buffer is free once the engine is done with its chunk */
+        u32Idx ^= 1UL;
+        if (s_aJob[u32Idx].i32Status > CRPT_JOB_DONE)
+        {
+            stat.u32HashWaits++;
+            while (s_aJob[u32Idx].i32Status > CRPT_JOB_DONE)
+            {
+                IMGV_IDLE();
+            }
+        }
+        if (s_aJob[u32Idx].i32Status != CRPT_JOB_DONE)
+        {
+            i32Ret = IMGV_ERR_HASH;
+            break;
+        }
+
+        u32Len = (u32Left < IMGV_CHUNK_SIZE) ? u32Left : IMGV_CHUNK_SIZE;
+        if (pfnRead(pvParam, (uint8_t *)s_au32Chunk[u32Idx], u32Len) != 0)
+        {
+            i32Ret = IMGV_ERR_READ;
+            break;
+        }
+    }
+
+    /* Never leave a job that points into the buffers behind, even on errors */
+    while ((s_aJob[0].i32Status > CRPT_JOB_DONE) || (s_aJob[1].i32Status > CRPT_JOB_DONE))
+    {
+        IMGV_IDLE();
+    }
+    if ((i32Ret == IMGV_OK) &&
+            ((s_aJob[0].i32Status != CRPT_JOB_DONE) || (s_aJob[1].i32Status != CRPT_JOB_DONE)))
+    {
+        i32Ret = IMGV_ERR_HASH;
+    }
+
+    if (i32Ret == IMGV_OK)
+    {
+        SHA_Read(CRPT, au32Digest);
+    }
+    CRPT_JobUnlock(CRPT_JOB_SHA);
+
+    if (pStat != NULL)
+    {
+        *pStat = stat;
+    }
+    return i32Ret;
+}
+
+/**
+  * @brief  Compute the SHA-256 digest of an image the SHA DMA can read in place,
+  *         such as one in APROM or in the SPIM direct memory mapped area.
+  * @param[in]  u32Addr     Word aligned start address of the image.
+  * @param[in]  u32ImageLen Image size in bytes.
+  * @param[out] au32Digest  The digest, as HMAC_DGST0~7 hold it.
+  * @return  IMGV_OK or IMGV_ERR_HASH.
+  */
+int32_t IMGV_HashMemory(uint32_t u32Addr, uint32_t u32ImageLen, uint32_t au32Digest[8])
+{
+    uint32_t  u32Ctl;
+    int32_t   i32Ret = IMGV_ERR_HASH;
+
+    CRPT_JobLock(CRPT_JOB_SHA);
+    u32Ctl = imgv_sha_open();
+
+    /* Nothing to read, so nothing to overlap: one job over the whole image */
+    imgv_submit(0UL, u32Addr, u32ImageLen, u32Ctl, CRYPTO_DMA_ONE_SHOT);
+    while (s_aJob[0].i32Status > CRPT_JOB_DONE)
+    {
+        IMGV_IDLE();
+    }
+    if (s_aJob[0].i32Status == CRPT_JOB_DONE)
+    {
+        SHA_Read(CRPT, au32Digest);
+        i32Ret = IMGV_OK;
+    }
+    CRPT_JobUnlock(CRPT_JOB_SHA);
+    return i32Ret;
+}
+
+/**
+  * @brief  Check an ECDSA P-256 signature of a SHA-256 digest.
+  * @param[in]  au32Digest  The digest, as IMGV_HashStream() returns it.
+  * @param[in]  au8Key      The public key, IMGV_KEY_SIZE bytes.
+  * @param[in]  au8Sig      The signature, IMGV_SIG_SIZE bytes.
+  * @return  IMGV_OK or IMGV_ERR_SIG.
+  */
+int32_t IMGV_VerifyDigest(const uint32_t au32Digest[8], const uint8_t au8Key[], const uint8_t au8Sig[])
+{
+    uint32_t  au32E[ECC_KEY_WORD_MAX], au32R[ECC_KEY_WORD_MAX], au32S[ECC_KEY_WORD_MAX];
+    uint32_t  au32X[ECC_KEY_WORD_MAX], au32Y[ECC_KEY_WORD_MAX];
+    uint32_t  i;
+    int32_t   i32Ret;
+
+    /* HMAC_DGST0 holds the most significant word of the digest */
+    memset(au32E, 0, sizeof(au32E));
+    for (i = 0UL; i < 8UL; i++)
+    {
+        au32E[i] = au32Digest[7UL - i];
+    }
+
+    imgv_bytes_to_words(&au8Key[0], au32X);
+    imgv_bytes_to_words(&au8Key[32], au32Y);
+    imgv_bytes_to_words(&au8Sig[0], au32R);
+    imgv_bytes_to_words(&au8Sig[32], au32S);
+
+    if (!imgv_in_range(au32R) || !imgv_in_range(au32S))
+    {
+        return IMGV_ERR_SIG;
+    }
+
+    /* The curve registers and the parsed curve of crypto.c are shared */
+    CRPT_JobLock(CRPT_JOB_ECC);
+    i32Ret = ECC_VerifySignatureWords(CRPT, CURVE_P_256, au32E, au32X, au32Y, au32R, au32S);
+    CRPT_JobUnlock(CRPT_JOB_ECC);
+
+    return (i32Ret == 0) ? IMGV_OK : IMGV_ERR_SIG;
+}
+
+/**
+  * @brief  Hash an image delivered by a read function and check its signature.
+  * @param[in]  pfnRead     Reads the next bytes of the image.
+  * @param[in]  pfnWrite    Takes each chunk read, may be NULL.
+  * @param[in]  pvParam     Passed to pfnRead and pfnWrite.
+  * @param[in]  u32ImageLen Image size in bytes.
+  * @param[in]  au8Key      The public key, IMGV_KEY_SIZE bytes.
+  * @param[in]  au8Sig      The signature, IMGV_SIG_SIZE bytes.
+  * @param[out] pStat       Statistics of the run, may be NULL.
+  * @return  IMGV_OK, IMGV_ERR_READ, IMGV_ERR_WRITE, IMGV_ERR_HASH or IMGV_ERR_SIG.
+  * @details  Whatever pfnWrite wrote must not be used unless IMGV_OK is returned.
+  */
+int32_t IMGV_VerifyStream(IMGV_READ_FUNC pfnRead, IMGV_WRITE_FUNC pfnWrite, void *pvParam, uint32_t u32ImageLen,
+                          const uint8_t au8Key[], const uint8_t au8Sig[], IMGV_STAT_T *pStat)
+{
+    uint32_t  au32Digest[8];
+    int32_t   i32Ret;
+
+    i32Ret = IMGV_HashStream(pfnRead, pfnWrite, pvParam, u32ImageLen, au32Digest, pStat);
+    if (i32Ret == IMGV_OK)
+    {
+        i32Ret = IMGV_VerifyDigest(au32Digest, au8Key, au8Sig);
+    }
+    return i32Ret;
+}
+
+/**
+  * @brief  Hash an image in memory and check its signature.
+  * @param[in]  u32Addr     Word aligned start address of the image.
+  * @param[in]  u32ImageLen Image size in bytes.
+  * @param[in]  au8Key      The public key, IMGV_KEY_SIZE bytes.
+  * @param[in]  au8Sig      The signature, IMGV_SIG_SIZE bytes.
+  * @return  IMGV_OK, IMGV_ERR_HASH or IMGV_ERR_SIG.
+  */
+int32_t IMGV_VerifyMemory(uint32_t u32Addr, uint32_t u32ImageLen, const uint8_t au8Key[], const uint8_t au8Sig[])
+{
+    uint32_t  au32Digest[8];
+    int32_t   i32Ret;
+
+    i32Ret = IMGV_HashMemory(u32Addr, u32ImageLen, au32Digest);
+    if (i32Ret == IMGV_OK)
+    {
+        i32Ret = IMGV_VerifyDigest(au32Digest, au8Key, au8Sig);
+    }
+    return i32Ret;
+}
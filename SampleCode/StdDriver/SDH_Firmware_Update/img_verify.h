@@ -0,0 +1,81 @@
+/**************************************************************************//**
+ * @file     img_verify.h
+ * @version  V1.00
+ * @brief    Streaming SHA-256/ECDSA P-256 verification of firmware images.
+ *
+ *           The image is read in IMGV_CHUNK_SIZE chunks into two buffers. Each
+ *           chunk is handed to the SHA engine as a DMA cascade job while the
+ *           next one is read into the other buffer, so a verification takes
+ *           about max(read time, hash time) instead of their sum. A write
+ *           function may take each chunk from the same buffer, e.g. to program
+ *           it, so the bytes written are the bytes hashed. The ECDSA check
+ *           runs on the final digest.
+ *
+ *           The CRYPTO interrupt must be enabled for SHA and ECC, and
+ *           CRYPTO_IRQHandler() must call CRPT_JobIRQHandler() and ECC_Complete().
+ *
+ * @copyright (C) 2019 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __IMG_VERIFY_H__
+#define __IMG_VERIFY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef IMGV_CHUNK_SIZE
+#define IMGV_CHUNK_SIZE         4096UL  /*!< Bytes per read and per SHA job, a multiple of 64 */
+#endif
+
+#ifndef IMGV_IDLE
+#define IMGV_IDLE()                     /*!< Run while waiting for the SHA engine, e.g. to yield to other tasks */
+#endif
+
+#define IMGV_KEY_SIZE           64UL    /*!< Qx || Qy of a P-256 public key, big endian  */
+#define IMGV_SIG_SIZE           64UL    /*!< R || S of a P-256 signature, big endian     */
+
+#define IMGV_OK                 0L      /*!< Image hashed, signature valid               */
+#define IMGV_ERR_READ           (-1L)   /*!< Read function failed                        */
+#define IMGV_ERR_HASH           (-2L)   /*!< SHA engine reported an error                */
+#define IMGV_ERR_SIG            (-3L)   /*!< Signature does not match the image          */
+#define IMGV_ERR_WRITE          (-4L)   /*!< Write function failed                       */
+
+/**
+  * @brief  Read the next u32Len bytes of the image into pu8Buf.
+  * @return 0 on success, otherwise the image is rejected.
+  */
+typedef int32_t (*IMGV_READ_FUNC)(void *pvParam, uint8_t *pu8Buf, uint32_t u32Len);
+
+/**
+  * @brief  Take the u32Len bytes of the image at u32Offset, just read and queued for
+  *         hashing. Runs while the engine hashes them; pu8Buf is word aligned.
+  * @return 0 on success, otherwise the image is rejected.
+  */
+typedef int32_t (*IMGV_WRITE_FUNC)(void *pvParam, const uint8_t *pu8Buf, uint32_t u32Offset, uint32_t u32Len);
+
+/**
+  * @brief  Statistics of one IMGV_HashStream() run.
+  */
+typedef struct
+{
+    uint32_t  u32Bytes;                 /*!< Image bytes hashed                          */
+    uint32_t  u32Chunks;                /*!< SHA jobs submitted                          */
+    uint32_t  u32HashWaits;             /*!< Reads that had to wait for the engine to free a buffer */
+} IMGV_STAT_T;
+
+int32_t IMGV_HashStream(IMGV_READ_FUNC pfnRead, IMGV_WRITE_FUNC pfnWrite, void *pvParam, uint32_t u32ImageLen,
+                        uint32_t au32Digest[8], IMGV_STAT_T *pStat);
+int32_t IMGV_HashMemory(uint32_t u32Addr, uint32_t u32ImageLen, uint32_t au32Digest[8]);
+int32_t IMGV_VerifyDigest(const uint32_t au32Digest[8], const uint8_t au8Key[], const uint8_t au8Sig[]);
+int32_t IMGV_VerifyStream(IMGV_READ_FUNC pfnRead, IMGV_WRITE_FUNC pfnWrite, void *pvParam, uint32_t u32ImageLen,
+                          const uint8_t au8Key[], const uint8_t au8Sig[], IMGV_STAT_T *pStat);
+int32_t IMGV_VerifyMemory(uint32_t u32Addr, uint32_t u32ImageLen, const uint8_t au8Key[], const uint8_t au8Sig[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMG_VERIFY_H__ */
@@ -49,7 +49,13 @@
      |                           |
      +---------------------------+   0x000000
 */
-extern void sdh_firmware_update(void);     /* SDH0 firmware update main function          */
+extern int  sdh_firmware_update(void);     /* SDH0 firmware update main function          */
+
+void CRYPTO_IRQHandler(void)
+{
+    CRPT_JobIRQHandler(CRPT);               /* SHA jobs of the image verifier             */
+    ECC_Complete(CRPT);                     /* signature check                            */
+}
 
 void SDH0_IRQHandler(void)
 {
@@ -172,6 +178,7 @@ void SYS_Init(void)
     /* Enable IP clock */
     CLK_EnableModuleClock(SDH0_MODULE);
     CLK_EnableModuleClock(UART0_MODULE);
+    CLK_EnableModuleClock(CRPT_MODULE);
 
     /* User can use SystemCoreClockUpdate() to calculate PllClock, SystemCoreClock and CycylesPerUs automatically. */
     SystemCoreClockUpdate();
@@ -213,7 +220,15 @@ int32_t main(void)
     FMC_Open();                             /* Enable FMC ISP functions                   */
     SDH_Open_Disk(SDH0, CardDetect_From_GPIO);
 
-    sdh_firmware_update();
+    NVIC_EnableIRQ(CRPT_IRQn);              /* Images are verified by the CRYPTO engines  */
+    SHA_ENABLE_INT(CRPT);
+    ECC_ENABLE_INT(CRPT);
+
+    if (sdh_firmware_update() != 0)
+    {
+        printf("APROM holds no valid image, not booting it.\n");
+        while (1);
+    }
 
     SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;   /* disable SYSTICK (prevent interrupt)   */
 
@@ -11,18 +11,23 @@
 #include "NuMicro.h"
 #include "ff.h"
 #include "diskio.h"
+#include "img_verify.h"
+#include "image_key.h"
 
 #define SDH0_DRIVE          0               /* Assigned SDH0 drive number in FATFS        */
 
 #define APROM_FILE_NAME     "AP.BIN"        /* pre-defined APROM firmware update image    */
 #define SPROM_FILE_NAME     "SP.BIN"        /* pre-defined SPROM firmware update image    */
 #define DATA_FILE_NAME      "DATA.BIN"      /* pre-defined Data Flash update image        */
+#define APROM_SIG_NAME      "AP.SIG"        /* ECDSA P-256 signature of APROM image       */
+#define SPROM_SIG_NAME      "SP.SIG"        /* ECDSA P-256 signature of SPROM image       */
 
 
 TCHAR sd_path[] = { '0', ':', 0 };    /* SD drive started from 0 */
 uint8_t   _Buff[FMC_FLASH_PAGE_SIZE];
 FILINFO   Finfo;
 FIL       file1;
+FIL       file2;
 
 int  do_dir()
 {
@@ -72,7 +77,7 @@ int  do_dir()
 }
 
 
-int  program_flash_page(uint32_t page_addr, uint32_t *buff, int count)
+int  program_flash_page(uint32_t page_addr, uint32_t *buff, uint32_t count)
 {
     uint32_t  addr;                         /* flash address                              */
     uint32_t  *p = buff;                    /* data buffer pointer                        */
@@ -103,7 +108,102 @@ int  program_flash_page(uint32_t page_addr, uint32_t *buff, int count)
 }
 
 
-void sdh_firmware_update()
+#if (IMGV_CHUNK_SIZE % FMC_FLASH_PAGE_SIZE) != 0
+#error "Image chunks must start on flash pages"
+#endif
+
+/* Flash target of an image being verified and programmed */
+typedef struct
+{
+    FIL       *fp;                          /* opened image file                          */
+    uint32_t  u32Base;                      /* flash address of the image                 */
+    uint32_t  u32Hold;                      /* leading bytes kept in _Buff until verified */
+} IMAGE_UPDATE_T;
+
+
+/* IMGV_READ_FUNC of an opened image file                                                */
+static int32_t read_image(void *param, uint8_t *buff, uint32_t len)
+{
+    UINT  cnt;
+
+    if ((f_read(((IMAGE_UPDATE_T *)param)->fp, buff, len, &cnt) != FR_OK) || (cnt != len))
+        return -1;                          /* read failed or file shorter than expected  */
+    return 0;
+}
+
+
+/* IMGV_WRITE_FUNC: program a chunk from the buffer the SHA engine is hashing            */
+static int32_t program_image(void *param, const uint8_t *buff, uint32_t offset, uint32_t len)
+{
+    IMAGE_UPDATE_T  *upd = (IMAGE_UPDATE_T *)param;
+    uint32_t  n;
+
+    for (; len > 0; buff += n, offset += n, len -= n)
+    {
+        n = (len < FMC_FLASH_PAGE_SIZE) ? len : FMC_FLASH_PAGE_SIZE;
+        if (offset < upd->u32Hold)          /* programmed once the signature is valid     */
+            memcpy(&_Buff[offset], buff, n);
+        else if (program_flash_page(upd->u32Base + offset, (uint32_t *)buff, n) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  Program an opened image file to flash while it is read and hashed, see img_verify.c.
+ *  Each chunk is programmed from the buffer it was hashed from, so the flash holds the
+ *  bytes that were verified. The first u32Hold bytes (a page at most) are kept in _Buff
+ *  and only programmed after the signature has been checked: for APROM that page holds
+ *  the vector table, and it is erased before the rest is programmed, so an image that
+ *  fails never boots.
+ */
+int  update_image(FIL *fp, char *sig_name, uint32_t u32Base, uint32_t u32Hold)
+{
+    IMAGE_UPDATE_T  upd;
+    uint8_t      sig[IMGV_SIG_SIZE];        /* R || S of the image signature              */
+    IMGV_STAT_T  stat;                      /* pipeline statistics                        */
+    UINT         cnt;
+    int32_t      ret;
+
+    if (f_open(&file2, sig_name, FA_OPEN_EXISTING | FA_READ))
+    {
+        printf("Signature [%s] not found, image rejected.\n", sig_name);
+        return -1;
+    }
+    ret = f_read(&file2, sig, IMGV_SIG_SIZE, &cnt);
+    f_close(&file2);
+    if ((ret != FR_OK) || (cnt != IMGV_SIG_SIZE))
+    {
+        printf("Signature [%s] is not %d bytes, image rejected.\n", sig_name, (int)IMGV_SIG_SIZE);
+        return -1;
+    }
+
+    upd.fp = fp;
+    upd.u32Base = u32Base;
+    upd.u32Hold = (f_size(fp) < u32Hold) ? f_size(fp) : u32Hold;
+
+    if (f_size(fp) > upd.u32Hold)           /* the old image is about to be overwritten   */
+        FMC_Erase(u32Base);
+
+    ret = IMGV_VerifyStream(read_image, program_image, &upd, f_size(fp), g_au8ImageKey, sig, &stat);
+    printf("Programmed and verified %d bytes in %d chunks, %d reads waited for SHA.\n",
+           stat.u32Bytes, stat.u32Chunks, stat.u32HashWaits);
+    if (ret != IMGV_OK)
+    {
+        printf("Image verification failed (%d), image rejected.\n", ret);
+        return -1;
+    }
+
+    /* valid: the held back bytes make the image usable                                  */
+    return program_flash_page(u32Base, (uint32_t *)_Buff, upd.u32Hold);
+}
+
+
+/*
+ *  Returns -1 if an APROM update failed and APROM holds no valid image, otherwise 0.
+ */
+int  sdh_firmware_update()
 {
     uint32_t   addr, dfba;
     UINT       cnt;
@@ -112,7 +212,7 @@ void sdh_firmware_update()
     f_chdrive(sd_path);                   /* set default path                           */
 
     if (do_dir() < 0)                       /* Open root directory and print out.         */
-        return;                             /* Cannot open root directory. USB disk may   */
+        return 0;                           /* Cannot open root directory. USB disk may   */
     /* not be connected.                          */
 
     /*------------------------------------------------------------------------------------*/
@@ -128,27 +228,13 @@ void sdh_firmware_update()
         printf("APROM image [%s] found, start update APROM firmware...\n", APROM_FILE_NAME);
         FMC_ENABLE_AP_UPDATE();             /* enable APROM update                        */
 
-        for (addr = 0; ; addr += FMC_FLASH_PAGE_SIZE)
+        if (update_image(&file1, APROM_SIG_NAME, 0, FMC_FLASH_PAGE_SIZE) != 0)
         {
-            cnt = FMC_FLASH_PAGE_SIZE;      /* read a flash page size data from file      */
-            res = f_read(&file1, _Buff, cnt, &cnt);   /* read file                        */
-            if ((res == FR_OK) && cnt)      /* read operation success?                    */
-            {
-                /* update APROM firmware page                 */
-                if (program_flash_page(addr, (uint32_t *)_Buff, cnt) != 0)
-                {
-                    f_close(&file1);        /* program failed! Close file.                */
-                    return;                 /* Abort...                                   */
-                }
-            }
-            else
-                break;                      /* read file failed or reached end-of-file    */
+            printf("APROM update failed!\n");     /* bad or unsigned image               */
+            f_close(&file1);                /* Close file.                                */
+            return -1;                      /* Abort...                                   */
         }
-
-        if (f_eof(&file1))                  /* reach end-of-file?                         */
-            printf("APROM update success.\n");     /* firmware update success             */
-        else
-            printf("APROM update failed!\n");      /* firmware update failed              */
+        printf("APROM update success.\n"); /* firmware update success                    */
 
         f_close(&file1);                    /* close file                                 */
     }
@@ -164,23 +250,22 @@ void sdh_firmware_update()
     else
     {
         printf("SPROM image [%s] found, start update SPROM firmware...\n", SPROM_FILE_NAME);
-        FMC_ENABLE_SP_UPDATE();             /* Enable SPROM update                        */
-        cnt = FMC_FLASH_PAGE_SIZE;          /* read a flash page size data from file      */
-        res = f_read(&file1, _Buff, cnt, &cnt);  /* read file                             */
-        if ((res == FR_OK) && cnt)          /* read operation success?                    */
+        if (f_size(&file1) > FMC_FLASH_PAGE_SIZE)
         {
-            /* update SPROM firmware page                 */
-            if (program_flash_page(FMC_SPROM_BASE, (uint32_t *)_Buff, cnt) != 0)
-            {
-                f_close(&file1);            /* program failed! Close file.                */
-                return;                     /* Abort...                                   */
-            }
+            printf("SPROM image is larger than a page, image rejected.\n");
+            f_close(&file1);
+            return 0;
         }
+        FMC_ENABLE_SP_UPDATE();             /* Enable SPROM update                        */
 
-        if (f_eof(&file1))                  /* reach end-of-file?                         */
-            printf("SPROM update success.\n");   /* firmware update success               */
-        else
-            printf("SPROM update failed!\n");    /* firmware update failed                */
+        /* SPROM is a single page, held back as a whole until the signature is checked  */
+        if (update_image(&file1, SPROM_SIG_NAME, FMC_SPROM_BASE, FMC_FLASH_PAGE_SIZE) != 0)
+        {
+            printf("SPROM update failed!\n");   /* bad or unsigned image, SPROM untouched */
+            f_close(&file1);                /* Close file.                                */
+            return 0;                       /* Abort...                                   */
+        }
+        printf("SPROM update success.\n");   /* firmware update success                  */
 
         f_close(&file1);                    /* close file                                 */
     }
@@ -191,7 +276,7 @@ void sdh_firmware_update()
     if (FMC_Read(FMC_USER_CONFIG_0) & 0x1)   /* Data Flash is enabled?                     */
     {
         printf("Data Flash is not enabled.\n");  /* Data Flash is not enabled             */
-        return;                             /* Skip Data Flash update                     */
+        return 0;                           /* Skip Data Flash update                     */
     }
 
     dfba = FMC_ReadDataFlashBaseAddr();     /* get Data Flash base address                */
@@ -215,7 +300,7 @@ void sdh_firmware_update()
                 {
                     /* program failed                             */
                     f_close(&file1);        /* close file                                 */
-                    return;                 /* Abort...                                   */
+                    return 0;               /* Abort...                                   */
                 }
             }
             else                            /* Read failed or reached end-of-file         */
@@ -229,6 +314,7 @@ void sdh_firmware_update()
 
         f_close(&file1);                    /* close file                                 */
     }
+    return 0;
 }
 
 
@@ -619,6 +619,75 @@ MBEDTLS_DEPRECATED void mbedtls_aes_decrypt( mbedtls_aes_context *ctx,
  */
 int mbedtls_aes_self_test( int verbose );
 
+#ifdef NUVOTON_ENABLE_AES
+
+/**
+ * \brief          Usage counters of the AES engine key channels.
+ */
+typedef struct
+{
+    uint32_t  key_hits;         /*!< Operations that found their key already loaded. */
+    uint32_t  key_loads;        /*!< Key register reloads. */
+    uint32_t  channel_steals;   /*!< Channels taken over from another context. */
+} nvt_aes_stats_t;
+
+extern nvt_aes_stats_t  nvt_aes_stats;
+
+/**
+ * \brief          Forget which keys are loaded in the AES engine channels.
+ *
+ *                 Call this after using the AES engine directly through the
+ *                 CRYPTO driver (AES_SetKey() etc.), so that every context
+ *                 reloads its key on next use.
+ */
+void nvt_aes_flush_channels( void );
+
+/**
+ * \brief          A CTR mode DMA stream on the AES engine.
+ */
+typedef struct
+{
+    int             ch;         /*!< Key channel. */
+    uint32_t        ctl;        /*!< AES_CTL of the next transfer. */
+    CRPT_JOB_REG_T  regs[4];    /*!< Register writes of the transfer in flight. */
+    CRPT_JOB_T      job;        /*!< The transfer in flight. */
+} nvt_aes_stream_t;
+
+/**
+ * \brief          Bind a CTR stream to the key of \p ctx and load the
+ *                 initial counter block.
+ *
+ *                 The caller must hold the AES engine, taken with
+ *                 CRPT_JobLock( CRPT_JOB_AES ), from here until the last
+ *                 nvt_aes_stream_wait() of the stream.
+ *
+ * \return         \c 0 on success.
+ */
+int nvt_aes_stream_start( nvt_aes_stream_t *st, mbedtls_aes_context *ctx,
+                          const unsigned char ctr[16] );
+
+/**
+ * \brief          Queue the next \p len bytes (a multiple of 16) of the
+ *                 stream and return without waiting. \p src and \p dst
+ *                 must be word aligned. The counter carries on from the
+ *                 previous transfer, and counts through all 128 bits.
+ *
+ * \return         \c 0 on success.
+ */
+int nvt_aes_stream_submit( nvt_aes_stream_t *st, const void *src, void *dst,
+                           uint32_t len, int last );
+
+/**
+ * \brief          Wait for the transfer queued by nvt_aes_stream_submit().
+ *                 Must be called before the next submit.
+ *
+ * \return         \c 0 on success, #MBEDTLS_ERR_AES_HW_ACCEL_FAILED if
+ *                 the engine reported an error.
+ */
+int nvt_aes_stream_wait( nvt_aes_stream_t *st );
+
+#endif  // NUVOTON_ENABLE_AES
+
 #ifdef __cplusplus
 }
 #endif
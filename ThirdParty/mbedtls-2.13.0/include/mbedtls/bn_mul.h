@@ -34,6 +34,7 @@
  *         . SPARC v8             . ARM v3+
  *         . Alpha                . MIPS32
  *         . C, longlong          . C, generic
+ *         . Cortex-M4 (UMAAL)
  */
 #ifndef MBEDTLS_BN_MUL_H
 #define MBEDTLS_BN_MUL_H
@@ -46,6 +47,44 @@
 #define asm __asm
 #endif
 
+#if defined(NUVOTON_MPI_UMAAL)
+/*
+ * Nuvoton M480, Cortex-M4: UMAAL RdLo, RdHi, Rn, Rm computes
+ * RdHi:RdLo = Rn * Rm + RdLo + RdHi, i.e. one whole limb of a
+ * multiply-accumulate, carry in and carry out included, in a single cycle.
+ * MULADDC_UMAAL( lo, hi, a, b ) is that step for GCC and armclang, Keil
+ * armcc and IAR. bignum.c also builds its fused Montgomery row on it, and
+ * has a portable C version for the targets without UMAAL.
+ */
+#if defined(__GNUC__) && defined(__thumb2__) && defined(__ARM_FEATURE_DSP) && \
+    ( !defined(__ARMCC_VERSION) || __ARMCC_VERSION >= 6000000 )
+#define MULADDC_UMAAL( lo, hi, a, b )                           \
+    asm( "umaal   %0, %1, %2, %3" : "+r" (lo), "+r" (hi) : "r" (a), "r" (b) )
+#elif defined(__CC_ARM) && defined(__TARGET_ARCH_7E_M)
+#define MULADDC_UMAAL( lo, hi, a, b )                           \
+    __asm { UMAAL lo, hi, a, b }
+#elif defined(__ICCARM__) && defined(__ARM7EM__) && ( __CORE__ == __ARM7EM__ )
+#define MULADDC_UMAAL( lo, hi, a, b )                           \
+    asm( "umaal   %0, %1, %2, %3" : "+r" (lo), "+r" (hi) : "r" (a), "r" (b) )
+#endif
+
+#if defined(MULADDC_UMAAL)
+
+#define MULADDC_INIT                    \
+{                                       \
+    mbedtls_mpi_uint r0, r1;
+
+#define MULADDC_CORE                    \
+    r0 = *(s++); r1 = *d;               \
+    MULADDC_UMAAL( r1, c, b, r0 );      \
+    *(d++) = r1;
+
+#define MULADDC_STOP                    \
+}
+
+#endif /* MULADDC_UMAAL */
+#endif /* NUVOTON_MPI_UMAAL */
+
 /* armcc5 --gnu defines __GNUC__ but doesn't support GNU's extended asm */
 #if defined(__GNUC__) && \
     ( !defined(__ARMCC_VERSION) || __ARMCC_VERSION >= 6000000 )
@@ -580,7 +619,7 @@
 #define MULADDC_CANNOT_USE_R7
 #endif
 
-#if defined(__arm__) && !defined(MULADDC_CANNOT_USE_R7)
+#if defined(__arm__) && !defined(MULADDC_CANNOT_USE_R7) && !defined(MULADDC_CORE)
 
 #if defined(__thumb__) && !defined(__thumb2__)
 
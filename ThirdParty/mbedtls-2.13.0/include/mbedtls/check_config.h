@@ -151,10 +151,15 @@
 #endif
 #if defined(MBEDTLS_TEST_NULL_ENTROPY) && \
      ( defined(MBEDTLS_ENTROPY_NV_SEED) || defined(MBEDTLS_ENTROPY_HARDWARE_ALT) || \
-    defined(MBEDTLS_HAVEGE_C) )
+    defined(MBEDTLS_HAVEGE_C) || defined(NUVOTON_ENABLE_TRNG) )
 #error "MBEDTLS_TEST_NULL_ENTROPY defined, but entropy sources too"
 #endif
 
+#if defined(NUVOTON_ENABLE_TRNG) && \
+    ( !defined(MBEDTLS_ENTROPY_C) || !defined(MBEDTLS_SHA256_C) )
+#error "NUVOTON_ENABLE_TRNG defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_GCM_C) && (                                        \
         !defined(MBEDTLS_AES_C) && !defined(MBEDTLS_CAMELLIA_C) )
 #error "MBEDTLS_GCM_C defined, but not all prerequisites"
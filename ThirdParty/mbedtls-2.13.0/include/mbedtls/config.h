@@ -51,6 +51,67 @@ extern void print_hex(uint8_t *hex, int len);
 #define NUVOTON_ENABLE_SHA
 #define NUVOTON_ENABLE_ECC
 
+/**
+ *  Byte size of the AES DMA bounce buffers. Bulk CBC/CFB/CTR operations on
+ *  buffers that are not word aligned are copied through them in chunks of
+ *  this size. GCM generates its keystream in two buffers of this size.
+ *  Must be a multiple of 16.
+ */
+#define NUVOTON_AES_DMA_BUFF_SIZE   256
+
+/**
+ *  Byte size of the DES/3DES DMA bounce buffers. Bulk CBC operations on
+ *  buffers that are not word aligned are copied through them in chunks of
+ *  this size. Must be a multiple of 8.
+ */
+#define NUVOTON_DES_DMA_BUFF_SIZE   64
+
+/**
+ *  Byte size of the message buffer of an HMAC context. A MAC over at most
+ *  this many bytes is computed by the CRPT HMAC engine in one DMA transfer,
+ *  a longer one falls back to the software ipad/opad construction. Must be
+ *  a multiple of 4.
+ */
+#define NUVOTON_SHA_HMAC_BUFF_SIZE  256
+
+/**
+ *  Seed the entropy module from the TRNG entropy pool, see
+ *  nvt_trng_entropy_poll(). The application starts the pool with
+ *  TRNG_PoolOpen() and keeps it filled by calling TRNG_PoolIRQHandler() from
+ *  TRNG_IRQHandler(), or TRNG_PoolHarvest() from its idle loop.
+ *  MBEDTLS_TEST_NULL_ENTROPY must be undefined.
+ */
+//#define NUVOTON_ENABLE_TRNG
+
+/**
+ *  Without NUVOTON_ENABLE_ECC, ecp.c keeps the fixed-base comb table of each
+ *  curve in a heap cache of at most this many bytes, so a group loaded per
+ *  handshake does not rebuild it. Least recently used tables are evicted.
+ *  0 disables the cache; nvt_ecp_comb_cache_flush() empties it.
+ */
+#define NUVOTON_ECP_COMB_CACHE_SIZE 8192
+
+/**
+ *  Header with const comb tables for flash, written by ecp_comb_gen of the
+ *  Linux build of SampleCode/Crypto_MbedTLS/benchmark. They are used before
+ *  the heap cache. Without NUVOTON_ENABLE_ECC only.
+ */
+//#define NUVOTON_ECP_COMB_ROM        "ecp_comb_rom.h"
+
+/**
+ *  The M480 has no RSA engine. With this, bignum.c multiplies with the
+ *  Cortex-M4 UMAAL kernels of bn_mul.h (GCC, armclang, Keil armcc and IAR)
+ *  and runs Montgomery multiplication as one fused pass per limb. Requires
+ *  MBEDTLS_HAVE_ASM; without a UMAAL toolchain the fused pass uses its C
+ *  version. MBEDTLS_SELF_TEST checks the kernels against a C reference.
+ */
+#define NUVOTON_MPI_UMAAL
+
+/**
+ *  The application's CRYPTO_IRQHandler() must call CRPT_JobIRQHandler() and
+ *  ECC_Complete(), which complete the AES, TDES, SHA and ECC jobs of this
+ *  port.
+ */
 extern volatile int g_Crypto_Int_done;
 
 
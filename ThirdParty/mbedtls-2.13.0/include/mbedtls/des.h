@@ -343,6 +343,17 @@ void mbedtls_des_setkey( uint32_t SK[32],
  */
 int mbedtls_des_self_test( int verbose );
 
+#ifdef NUVOTON_ENABLE_DES
+/**
+ * \brief          Forget which keys are loaded in the TDES engine channels.
+ *
+ *                 Call this after using the TDES engine directly through the
+ *                 CRYPTO driver (TDES_SetKey() etc.), so that every context
+ *                 reloads its key on next use.
+ */
+void nvt_des_flush_channels( void );
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -757,16 +757,34 @@ int mbedtls_ecp_self_test( int verbose );
 
 #endif /* MBEDTLS_SELF_TEST */
 
-extern size_t  tmp_len;
-extern char  tmp_str[MBEDTLS_ECP_MAX_PT_LEN];
+#ifndef NUVOTON_ENABLE_ECC
 
-#ifdef NUVOTON_ENABLE_ECC
+/**
+ * \brief          Counters of the fixed-base comb table cache of the
+ *                 software point multiplication.
+ */
+typedef struct
+{
+    uint32_t  hits;             /*!< Multiplications by G that found their table in the heap cache. */
+    uint32_t  rom_hits;         /*!< Multiplications by G that found their table in flash. */
+    uint32_t  stores;           /*!< Tables built and kept in the heap cache. */
+    uint32_t  evictions;        /*!< Tables freed to make room for another curve. */
+    uint32_t  rejects;          /*!< Tables larger than NUVOTON_ECP_COMB_CACHE_SIZE. */
+    size_t    bytes;            /*!< Heap held by the cache now. */
+} nvt_ecp_comb_stats_t;
+
+extern nvt_ecp_comb_stats_t  nvt_ecp_comb_stats;
 
-extern char  tmp_x_str[MBEDTLS_ECP_MAX_PT_LEN];
-extern char  tmp_y_str[MBEDTLS_ECP_MAX_PT_LEN];
-extern char  tmp_1_str[MBEDTLS_ECP_MAX_PT_LEN];
-extern char  tmp_2_str[MBEDTLS_ECP_MAX_PT_LEN];
-extern char  tmp_3_str[MBEDTLS_ECP_MAX_PT_LEN];
+/**
+ * \brief          Free the tables of the comb table cache.
+ *
+ *                 Tables generated into flash stay in use.
+ */
+void nvt_ecp_comb_cache_flush( void );
+
+#endif  // !NUVOTON_ENABLE_ECC
+
+#ifdef NUVOTON_ENABLE_ECC
 
 struct curve_map  {
 	mbedtls_ecp_group_id  id;
@@ -792,6 +810,8 @@ static const struct curve_map curve_map_tbl[] =
 
 
 extern E_ECC_CURVE nuvoton_get_curve(mbedtls_ecp_group_id id);
+extern int nuvoton_mpi_to_words(const mbedtls_mpi *X, uint32_t au32Words[]);
+extern int nuvoton_words_to_mpi(mbedtls_mpi *X, const uint32_t au32Words[]);
 #endif  // NUVOTON_ENABLE_ECC
 
 
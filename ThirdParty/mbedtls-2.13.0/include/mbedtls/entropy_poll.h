@@ -93,6 +93,22 @@ int mbedtls_hardware_poll( void *data,
                            unsigned char *output, size_t len, size_t *olen );
 #endif
 
+#if defined(NUVOTON_ENABLE_TRNG)
+#define NUVOTON_ENTROPY_MIN_TRNG    32  /**< Minimum for the TRNG entropy pool source */
+
+/**
+ * \brief           Entropy poll callback for the TRNG entropy pool
+ *
+ *                  Takes raw TRNG bytes from the pool that TRNG_PoolOpen()
+ *                  keeps filled and compresses them 2:1 with SHA-256, so a
+ *                  poll only waits for the TRNG when the pool runs dry.
+ *
+ * \note            This must accept NULL as its first argument.
+ */
+int nvt_trng_entropy_poll( void *data,
+                           unsigned char *output, size_t len, size_t *olen );
+#endif
+
 #if defined(MBEDTLS_ENTROPY_NV_SEED)
 /**
  * \brief           Entropy poll callback for a non-volatile seed file
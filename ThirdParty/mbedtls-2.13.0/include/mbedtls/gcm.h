@@ -66,6 +66,10 @@ typedef struct mbedtls_gcm_context
     int mode;                             /*!< The operation to perform:
                                                #MBEDTLS_GCM_ENCRYPT or
                                                #MBEDTLS_GCM_DECRYPT. */
+#ifdef NUVOTON_ENABLE_AES
+    uint32_t nvt_M[16][4];                /*!< HTable as 32-bit words, most significant first. */
+    int nvt_hw;                           /*!< The keystream comes from the AES engine. */
+#endif
 }
 mbedtls_gcm_context;
 
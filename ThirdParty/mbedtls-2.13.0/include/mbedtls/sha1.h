@@ -63,6 +63,9 @@ typedef struct mbedtls_sha1_context
     uint32_t total[2];          /*!< The number of Bytes processed.  */
     uint32_t state[5];          /*!< The intermediate digest state.  */
     unsigned char buffer[64];   /*!< The data block being processed. */
+#ifdef NUVOTON_ENABLE_SHA
+    int nvt_hw;                 /*!< The hash runs on the CRPT SHA engine. */
+#endif
 }
 mbedtls_sha1_context;
 
@@ -60,6 +60,9 @@ typedef struct mbedtls_sha256_context
     unsigned char buffer[64];   /*!< The data block being processed. */
     int is224;                  /*!< Determines which function to use:
                                      0: Use SHA-256, or 1: Use SHA-224. */
+#ifdef NUVOTON_ENABLE_SHA
+    int nvt_hw;                 /*!< The hash runs on the CRPT SHA engine. */
+#endif
 }
 mbedtls_sha256_context;
 
@@ -265,6 +268,20 @@ MBEDTLS_DEPRECATED void mbedtls_sha256( const unsigned char *input,
  */
 int mbedtls_sha256_self_test( int verbose );
 
+#ifdef NUVOTON_ENABLE_SHA
+
+/*
+ * The CRPT SHA engine is shared by the SHA-1, SHA-224/256 and SHA-384/512
+ * contexts. One context at a time streams its message through it; the
+ * others hash in software. See sha256.c.
+ */
+int  nvt_sha_claim( void *ctx, uint32_t u32OpMode );
+void nvt_sha_release( void *ctx );
+int  nvt_sha_feed( const unsigned char *data, size_t len, int last );
+int  nvt_sha_read_state( uint32_t au32State[], int wcnt );
+
+#endif  // NUVOTON_ENABLE_SHA
+
 #ifdef __cplusplus
 }
 #endif
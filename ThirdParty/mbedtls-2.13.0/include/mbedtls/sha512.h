@@ -59,6 +59,9 @@ typedef struct mbedtls_sha512_context
     unsigned char buffer[128];  /*!< The data block being processed. */
     int is384;                  /*!< Determines which function to use:
                                      0: Use SHA-512, or 1: Use SHA-384. */
+#ifdef NUVOTON_ENABLE_SHA
+    int nvt_hw;                 /*!< The hash runs on the CRPT SHA engine. */
+#endif
 }
 mbedtls_sha512_context;
 
@@ -55,14 +55,32 @@
 
 #ifdef NUVOTON_ENABLE_AES
 
+/*
+ * The bulk CBC/CFB/CTR path runs whole buffers through the engine in one
+ * DMA cascade. Caller buffers that are not word aligned are bounced through
+ * these buffers, NUVOTON_AES_DMA_BUFF_SIZE bytes at a time.
+ *
+ * The buffers, the key channel table below and the engine registers are
+ * shared by all contexts: every sequence that uses them holds the AES engine
+ * with CRPT_JobLock(), so tasks of an RTOS that installed a lock with
+ * CRPT_JobSetLock() take turns.
+ */
+#ifndef NUVOTON_AES_DMA_BUFF_SIZE
+#define NUVOTON_AES_DMA_BUFF_SIZE   256
+#endif
+
+#if ( NUVOTON_AES_DMA_BUFF_SIZE < 16 ) || ( NUVOTON_AES_DMA_BUFF_SIZE % 16 )
+#error "NUVOTON_AES_DMA_BUFF_SIZE must be a non-zero multiple of 16"
+#endif
+
 #ifdef __ICCARM__
 #pragma data_alignment=4
-static uint8_t src_dma_buff[16];
+static uint8_t src_dma_buff[NUVOTON_AES_DMA_BUFF_SIZE];
 #pragma data_alignment=4
-static uint8_t dst_dma_buff[16];
+static uint8_t dst_dma_buff[NUVOTON_AES_DMA_BUFF_SIZE];
 #else
-static uint8_t src_dma_buff[16] __attribute__((aligned (4)));
-static uint8_t dst_dma_buff[16] __attribute__((aligned (4)));
+static uint8_t src_dma_buff[NUVOTON_AES_DMA_BUFF_SIZE] __attribute__((aligned (4)));
+static uint8_t dst_dma_buff[NUVOTON_AES_DMA_BUFF_SIZE] __attribute__((aligned (4)));
 #endif
 
 #define GET_UINT32_BE(n,b,i)                            \
@@ -531,61 +549,316 @@ static void aes_gen_tables( void )
 
 
 #ifdef NUVOTON_ENABLE_AES
-static int nvt_aes_setkey(const unsigned char *key,  int nr)
+/*
+ * Each of the four AES channels keeps its own key registers. A context is
+ * bound to a channel the first time it is used and its key stays resident
+ * there; the key is only rewritten when the channel has been handed to a
+ * different context in the meantime. Channels are reassigned least recently
+ * used first.
+ */
+#define NVT_AES_CHANNEL_NUM     4
+#define NVT_AES_CH_REG(reg, ch) ( (uint32_t *)( (uint32_t)&(reg) + (ch) * 0x3CUL ) )
+
+static struct
 {
-    int        i;
-    uint32_t   *aes_key = (uint32_t *)&CRPT->AES0_KEY[0];
+    const mbedtls_aes_context *owner;   /* context whose key is loaded, or NULL */
+    uint32_t  last_use;                 /* LRU stamp */
+} nvt_aes_channel[NVT_AES_CHANNEL_NUM];
+
+static uint32_t  nvt_aes_use_stamp;
 
-    CRPT->AES_CTL |= ( ((nr-10)/2) << CRPT_AES_CTL_KEYSZ_Pos); 
+nvt_aes_stats_t  nvt_aes_stats;
+
+static void nvt_aes_setkey( const unsigned char *key, int ch )
+{
+    int        i;
+    uint32_t   *aes_key = NVT_AES_CH_REG( CRPT->AES0_KEY[0], ch );
 
     for( i = 0; i < 8; i++ )
     {
         GET_UINT32_BE( aes_key[i], key, i << 2 );
     }
+}
+
+/*
+ * Drop the binding of a context, so a later context at the same address
+ * (or the same context with a new key) reloads the key registers.
+ */
+static void nvt_aes_release_channel( const mbedtls_aes_context *ctx )
+{
+    int   ch;
+
+    CRPT_JobLock( CRPT_JOB_AES );
+    for( ch = 0; ch < NVT_AES_CHANNEL_NUM; ch++ )
+    {
+        if( nvt_aes_channel[ch].owner == ctx )
+            nvt_aes_channel[ch].owner = NULL;
+    }
+    CRPT_JobUnlock( CRPT_JOB_AES );
+}
+
+/*
+ * Return the channel holding the key of ctx, loading it into the least
+ * recently used channel first if it is not resident. The caller holds the
+ * AES engine.
+ */
+static int nvt_aes_get_channel( const mbedtls_aes_context *ctx )
+{
+    int   ch, victim = 0;
+
+    nvt_aes_use_stamp++;
+
+    for( ch = 0; ch < NVT_AES_CHANNEL_NUM; ch++ )
+    {
+        if( nvt_aes_channel[ch].owner == ctx )
+        {
+            nvt_aes_channel[ch].last_use = nvt_aes_use_stamp;
+            nvt_aes_stats.key_hits++;
+            return( ch );
+        }
+        if( nvt_aes_channel[victim].owner != NULL &&
+            ( nvt_aes_channel[ch].owner == NULL ||
+              nvt_aes_channel[ch].last_use < nvt_aes_channel[victim].last_use ) )
+            victim = ch;
+    }
+
+    if( nvt_aes_channel[victim].owner != NULL )
+        nvt_aes_stats.channel_steals++;
+
+    nvt_aes_setkey( (const unsigned char *)ctx->rk, victim );
+    nvt_aes_channel[victim].owner = ctx;
+    nvt_aes_channel[victim].last_use = nvt_aes_use_stamp;
+    nvt_aes_stats.key_loads++;
+
+    return( victim );
+}
+
+void nvt_aes_flush_channels( void )
+{
+    CRPT_JobLock( CRPT_JOB_AES );
+    memset( nvt_aes_channel, 0, sizeof( nvt_aes_channel ) );
+    CRPT_JobUnlock( CRPT_JOB_AES );
+}
+
+/*
+ * Queue one DMA transfer of channel ch on the CRPT job queue and wait for
+ * it; CRPT_JobRun() blocks the calling task if the application installed
+ * an RTOS runner.
+ */
+static int nvt_aes_run( int ch, const void *src, void *dst, uint32_t cnt, uint32_t ctl )
+{
+    CRPT_JOB_REG_T  regs[4];
+    CRPT_JOB_T      job;
+
+    regs[0].pu32Reg = NVT_AES_CH_REG( CRPT->AES0_SADDR, ch );
+    regs[0].u32Val  = (uint32_t)src;
+    regs[1].pu32Reg = NVT_AES_CH_REG( CRPT->AES0_DADDR, ch );
+    regs[1].u32Val  = (uint32_t)dst;
+    regs[2].pu32Reg = NVT_AES_CH_REG( CRPT->AES0_CNT, ch );
+    regs[2].u32Val  = cnt;
+    regs[3].pu32Reg = &CRPT->AES_CTL;
+    regs[3].u32Val  = ctl | CRPT_AES_CTL_START_Msk;
+
+    memset( &job, 0, sizeof( job ) );
+    job.u32Engine = CRPT_JOB_AES;
+    job.pRegs     = regs;
+    job.u32RegCnt = 4;
+
+    if( CRPT_JobRun( CRPT, &job ) != CRPT_JOB_DONE )
+        return( MBEDTLS_ERR_AES_HW_ACCEL_FAILED );
+
     return( 0 );
 }
 
+/*
+ * AES_CTL value selecting the channel and key size of ctx.
+ */
+static uint32_t nvt_aes_ctl( const mbedtls_aes_context *ctx, int ch, uint32_t opmode, int mode )
+{
+    uint32_t   ctl;
+
+    ctl = ( (uint32_t) ch << CRPT_AES_CTL_CHANNEL_Pos ) |
+          ( (uint32_t)( ( ctx->nr - 10 ) / 2 ) << CRPT_AES_CTL_KEYSZ_Pos ) |
+          ( opmode << CRPT_AES_CTL_OPMODE_Pos ) |
+          CRPT_AES_CTL_INSWAP_Msk | CRPT_AES_CTL_OUTSWAP_Msk | CRPT_AES_CTL_DMAEN_Msk;
+    if( mode == MBEDTLS_AES_ENCRYPT )
+        ctl |= CRPT_AES_CTL_ENCRPT_Msk;
+
+    return( ctl );
+}
+
+static int nvt_aes_crypt_block( mbedtls_aes_context *ctx, int mode,
+                                const unsigned char input[16],
+                                unsigned char output[16] )
+{
+    int   ch, ret;
+
+    CRPT_JobLock( CRPT_JOB_AES );
+
+    ch = nvt_aes_get_channel( ctx );
+
+    memcpy( src_dma_buff, input, 16 );
+
+    ret = nvt_aes_run( ch, src_dma_buff, dst_dma_buff, 16,
+                       nvt_aes_ctl( ctx, ch, AES_MODE_ECB, mode ) | CRPT_AES_CTL_DMACSCAD_Msk );
+
+    memcpy( output, dst_dma_buff, 16 );
+
+    CRPT_JobUnlock( CRPT_JOB_AES );
+    return( ret );
+}
+
 int nvt_mbedtls_internal_aes_encrypt( mbedtls_aes_context *ctx,
                                   const unsigned char input[16],
                                   unsigned char output[16] )
 {
-	nvt_aes_setkey((uint8_t *)ctx->rk, ctx->nr);
-	
-	CRPT->AES0_SADDR = (uint32_t)src_dma_buff;
-	CRPT->AES0_DADDR = (uint32_t)dst_dma_buff;
-	CRPT->AES0_CNT = 16;
-	
-	memcpy((uint8_t *)src_dma_buff, input, 16);
-
-	g_Crypto_Int_done = 0;
-	CRPT->AES_CTL |= CRPT_AES_CTL_INSWAP_Msk | CRPT_AES_CTL_OUTSWAP_Msk;
-	CRPT->AES_CTL |= CRPT_AES_CTL_ENCRPT_Msk | CRPT_AES_CTL_DMAEN_Msk | CRPT_AES_CTL_DMACSCAD_Msk | CRPT_AES_CTL_START_Msk;
-	while (g_Crypto_Int_done == 0);
-	
-	memcpy(output, (uint8_t *)dst_dma_buff, 16);
-	return 0;
+    return( nvt_aes_crypt_block( ctx, MBEDTLS_AES_ENCRYPT, input, output ) );
 }
 
 int nvt_mbedtls_internal_aes_decrypt( mbedtls_aes_context *ctx,
                                   const unsigned char input[16],
                                   unsigned char output[16] )
 {
-	nvt_aes_setkey((uint8_t *)ctx->rk, ctx->nr);
-
-	CRPT->AES0_SADDR = (uint32_t)src_dma_buff;
-	CRPT->AES0_DADDR = (uint32_t)dst_dma_buff;
-	CRPT->AES0_CNT = 16;
-	
-	memcpy((uint8_t *)src_dma_buff, input, 16);
-
-    g_Crypto_Int_done = 0;
-    CRPT->AES_CTL |= CRPT_AES_CTL_INSWAP_Msk | CRPT_AES_CTL_OUTSWAP_Msk;	
-	CRPT->AES_CTL &= ~CRPT_AES_CTL_ENCRPT_Msk;
-	CRPT->AES_CTL |=  CRPT_AES_CTL_DMAEN_Msk | CRPT_AES_CTL_DMACSCAD_Msk | CRPT_AES_CTL_START_Msk;
-	while (g_Crypto_Int_done == 0);
-	
-	memcpy(output, (uint8_t *)dst_dma_buff, 16);
-	return 0;
+    return( nvt_aes_crypt_block( ctx, MBEDTLS_AES_DECRYPT, input, output ) );
+}
+
+#if defined(MBEDTLS_CIPHER_MODE_CBC) || defined(MBEDTLS_CIPHER_MODE_CFB) || \
+    defined(MBEDTLS_CIPHER_MODE_CTR)
+/*
+ * Run a multiple of 16 bytes through the engine in hardware chaining mode.
+ *
+ * The first DMA transfer loads the IV from iv[]; every following transfer
+ * sets DMACSCAD so the engine continues from its own feedback register. When
+ * both caller buffers are word aligned the engine reads and writes them
+ * directly in a single transfer, otherwise the data is bounced through
+ * src_dma_buff/dst_dma_buff. iv[] itself is not updated here.
+ */
+static int nvt_aes_crypt_dma( mbedtls_aes_context *ctx,
+                              uint32_t opmode,
+                              int mode,
+                              size_t length,
+                              const unsigned char iv[16],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    int        i, ch, ret = 0;
+    uint32_t   ctl, chunk;
+    uint32_t   *aes_iv;
+    int        direct;
+
+    if( length == 0 )
+        return( 0 );
+
+    direct = ( ( ( (uint32_t)input | (uint32_t)output ) & 0x3 ) == 0 );
+
+    /* The cascade and the bounce buffers are ours until the last transfer */
+    CRPT_JobLock( CRPT_JOB_AES );
+
+    ch = nvt_aes_get_channel( ctx );
+
+    aes_iv = NVT_AES_CH_REG( CRPT->AES0_IV[0], ch );
+    for( i = 0; i < 4; i++ )
+    {
+        GET_UINT32_BE( aes_iv[i], iv, i << 2 );
+    }
+
+    ctl = nvt_aes_ctl( ctx, ch, opmode, mode );
+
+    while( length > 0 )
+    {
+        if( direct )
+            chunk = length;
+        else
+            chunk = ( length > NUVOTON_AES_DMA_BUFF_SIZE ) ? NUVOTON_AES_DMA_BUFF_SIZE : length;
+
+        if( direct )
+        {
+            ret = nvt_aes_run( ch, input, output, chunk,
+                               ctl | ( ( chunk == length ) ? CRPT_AES_CTL_DMALAST_Msk : 0 ) );
+        }
+        else
+        {
+            memcpy( src_dma_buff, input, chunk );
+            ret = nvt_aes_run( ch, src_dma_buff, dst_dma_buff, chunk,
+                               ctl | ( ( chunk == length ) ? CRPT_AES_CTL_DMALAST_Msk : 0 ) );
+            memcpy( output, dst_dma_buff, chunk );
+        }
+        if( ret != 0 )
+            break;
+
+        /* Later transfers continue from the engine's feedback register */
+        ctl |= CRPT_AES_CTL_DMACSCAD_Msk;
+
+        input  += chunk;
+        output += chunk;
+        length -= chunk;
+    }
+
+    CRPT_JobUnlock( CRPT_JOB_AES );
+    return( ret );
+}
+#endif /* MBEDTLS_CIPHER_MODE_CBC || MBEDTLS_CIPHER_MODE_CFB || MBEDTLS_CIPHER_MODE_CTR */
+
+/*
+ * Engine CTR stream for callers that overlap their own work with the
+ * engine, see gcm.c. One transfer is in flight at a time. The caller holds
+ * the AES engine from nvt_aes_stream_start() until the last transfer is
+ * done.
+ */
+int nvt_aes_stream_start( nvt_aes_stream_t *st, mbedtls_aes_context *ctx,
+                          const unsigned char ctr[16] )
+{
+    int        i;
+    uint32_t   *aes_iv;
+
+    st->ch = nvt_aes_get_channel( ctx );
+
+    aes_iv = NVT_AES_CH_REG( CRPT->AES0_IV[0], st->ch );
+    for( i = 0; i < 4; i++ )
+    {
+        GET_UINT32_BE( aes_iv[i], ctr, i << 2 );
+    }
+
+    st->ctl = nvt_aes_ctl( ctx, st->ch, AES_MODE_CTR, MBEDTLS_AES_ENCRYPT );
+
+    return( 0 );
+}
+
+int nvt_aes_stream_submit( nvt_aes_stream_t *st, const void *src, void *dst,
+                           uint32_t len, int last )
+{
+    st->regs[0].pu32Reg = NVT_AES_CH_REG( CRPT->AES0_SADDR, st->ch );
+    st->regs[0].u32Val  = (uint32_t)src;
+    st->regs[1].pu32Reg = NVT_AES_CH_REG( CRPT->AES0_DADDR, st->ch );
+    st->regs[1].u32Val  = (uint32_t)dst;
+    st->regs[2].pu32Reg = NVT_AES_CH_REG( CRPT->AES0_CNT, st->ch );
+    st->regs[2].u32Val  = len;
+    st->regs[3].pu32Reg = &CRPT->AES_CTL;
+    st->regs[3].u32Val  = st->ctl | ( last ? CRPT_AES_CTL_DMALAST_Msk : 0 ) |
+                          CRPT_AES_CTL_START_Msk;
+
+    memset( &st->job, 0, sizeof( st->job ) );
+    st->job.u32Engine = CRPT_JOB_AES;
+    st->job.pRegs     = st->regs;
+    st->job.u32RegCnt = 4;
+
+    /* The next transfer continues from the engine's counter */
+    st->ctl |= CRPT_AES_CTL_DMACSCAD_Msk;
+
+    if( CRPT_JobSubmit( CRPT, &st->job ) != 0 )
+        return( MBEDTLS_ERR_AES_HW_ACCEL_FAILED );
+
+    return( 0 );
+}
+
+int nvt_aes_stream_wait( nvt_aes_stream_t *st )
+{
+    while( st->job.i32Status > CRPT_JOB_DONE );
+
+    if( st->job.i32Status != CRPT_JOB_DONE )
+        return( MBEDTLS_ERR_AES_HW_ACCEL_FAILED );
+
+    return( 0 );
 }
 
 #endif
@@ -595,7 +868,10 @@ void mbedtls_aes_init( mbedtls_aes_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_aes_context ) );
 #ifdef NUVOTON_ENABLE_AES
+	CRPT_JobLock( CRPT_JOB_AES );
 	CRPT->AES_CTL = 0;
+	nvt_aes_release_channel( ctx );
+	CRPT_JobUnlock( CRPT_JOB_AES );
 #endif	
 }
 
@@ -604,6 +880,9 @@ void mbedtls_aes_free( mbedtls_aes_context *ctx )
     if( ctx == NULL )
         return;
 
+#ifdef NUVOTON_ENABLE_AES
+    nvt_aes_release_channel( ctx );
+#endif
     mbedtls_platform_zeroize( ctx, sizeof( mbedtls_aes_context ) );
 }
 
@@ -660,6 +939,11 @@ int mbedtls_aes_setkey_enc( mbedtls_aes_context *ctx, const unsigned char *key,
 #endif
     ctx->rk = RK = ctx->buf;
 
+#ifdef NUVOTON_ENABLE_AES
+    /* A resident copy of the old key must not be reused */
+    nvt_aes_release_channel( ctx );
+#endif
+
 #if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
     if( mbedtls_aesni_has_support( MBEDTLS_AESNI_AES ) )
         return( mbedtls_aesni_setkey_enc( (unsigned char *) ctx->rk, key, keybits ) );
@@ -763,6 +1047,13 @@ int mbedtls_aes_setkey_dec( mbedtls_aes_context *ctx, const unsigned char *key,
 #endif
     ctx->rk = RK = ctx->buf;
 
+#ifdef NUVOTON_ENABLE_AES
+    /* The engine runs its own key schedule in both directions, so it is
+     * loaded with the cipher key from the head of rk, as for encryption */
+    ret = mbedtls_aes_setkey_enc( ctx, key, keybits );
+    goto exit;
+#endif
+
     /* Also checks keybits */
     if( ( ret = mbedtls_aes_setkey_enc( &cty, key, keybits ) ) != 0 )
         goto exit;
@@ -1092,7 +1383,6 @@ int mbedtls_aes_crypt_ecb( mbedtls_aes_context *ctx,
 #endif
 
 #ifdef NUVOTON_ENABLE_AES
-    CRPT->AES_CTL |= (AES_MODE_ECB << CRPT_AES_CTL_OPMODE_Pos);
     if( mode == MBEDTLS_AES_ENCRYPT )
         return( nvt_mbedtls_internal_aes_encrypt( ctx, input, output ) );
     else
@@ -1134,6 +1424,27 @@ int mbedtls_aes_crypt_cbc( mbedtls_aes_context *ctx,
     }
 #endif
 
+#ifdef NUVOTON_ENABLE_AES
+    if( length > 0 )
+    {
+        int ret;
+
+        /* The next IV is the last ciphertext block, which an in-place
+         * decryption is about to overwrite */
+        if( mode == MBEDTLS_AES_DECRYPT )
+            memcpy( temp, input + length - 16, 16 );
+
+        ret = nvt_aes_crypt_dma( ctx, AES_MODE_CBC, mode, length, iv, input, output );
+        if( ret != 0 )
+            return( ret );
+
+        if( mode == MBEDTLS_AES_DECRYPT )
+            memcpy( iv, temp, 16 );
+        else
+            memcpy( iv, output + length - 16, 16 );
+    }
+    (void) i;
+#else
     if( mode == MBEDTLS_AES_DECRYPT )
     {
         while( length > 0 )
@@ -1166,6 +1477,7 @@ int mbedtls_aes_crypt_cbc( mbedtls_aes_context *ctx,
             length -= 16;
         }
     }
+#endif /* NUVOTON_ENABLE_AES */
 
     return( 0 );
 }
@@ -1344,6 +1656,44 @@ int mbedtls_aes_crypt_cfb128( mbedtls_aes_context *ctx,
 {
     int c;
     size_t n = *iv_off;
+#ifdef NUVOTON_ENABLE_AES
+    size_t blocks;
+    unsigned char temp[16];
+
+    /* Use up the keystream left from a previous call, then hand all whole
+     * blocks to the engine in one CFB cascade */
+    while( n != 0 && length > 0 )
+    {
+        c = *input++;
+        *output++ = (unsigned char)( c ^ iv[n] );
+        iv[n] = ( mode == MBEDTLS_AES_DECRYPT ) ? (unsigned char) c : output[-1];
+
+        n = ( n + 1 ) & 0x0F;
+        length--;
+    }
+
+    blocks = length & ~( (size_t) 0x0F );
+    if( blocks > 0 )
+    {
+        int ret;
+
+        if( mode == MBEDTLS_AES_DECRYPT )
+            memcpy( temp, input + blocks - 16, 16 );
+
+        ret = nvt_aes_crypt_dma( ctx, AES_MODE_CFB, mode, blocks, iv, input, output );
+        if( ret != 0 )
+            return( ret );
+
+        if( mode == MBEDTLS_AES_DECRYPT )
+            memcpy( iv, temp, 16 );
+        else
+            memcpy( iv, output + blocks - 16, 16 );
+
+        input  += blocks;
+        output += blocks;
+        length -= blocks;
+    }
+#endif /* NUVOTON_ENABLE_AES */
 
     if( mode == MBEDTLS_AES_DECRYPT )
     {
@@ -1458,10 +1808,49 @@ int mbedtls_aes_crypt_ctr( mbedtls_aes_context *ctx,
 {
     int c, i;
     size_t n = *nc_off;
+#ifdef NUVOTON_ENABLE_AES
+    size_t blocks, carry;
+#endif
 
     if ( n > 0x0F )
         return( MBEDTLS_ERR_AES_BAD_INPUT_DATA );
 
+#ifdef NUVOTON_ENABLE_AES
+    /* Use up the keystream left from a previous call, then let the engine
+     * generate and apply the keystream for all whole blocks */
+    while( n != 0 && length > 0 )
+    {
+        *output++ = (unsigned char)( *input++ ^ stream_block[n] );
+
+        n = ( n + 1 ) & 0x0F;
+        length--;
+    }
+
+    blocks = length & ~( (size_t) 0x0F );
+    if( blocks > 0 )
+    {
+        int ret;
+
+        ret = nvt_aes_crypt_dma( ctx, AES_MODE_CTR, MBEDTLS_AES_ENCRYPT, blocks,
+                                 nonce_counter, input, output );
+        if( ret != 0 )
+            return( ret );
+
+        /* Advance the big-endian counter past the blocks just consumed */
+        carry = blocks >> 4;
+        for( i = 16; i > 0 && carry != 0; i-- )
+        {
+            carry += nonce_counter[i - 1];
+            nonce_counter[i - 1] = (unsigned char) carry;
+            carry >>= 8;
+        }
+
+        input  += blocks;
+        output += blocks;
+        length -= blocks;
+    }
+#endif /* NUVOTON_ENABLE_AES */
+
     while( length-- )
     {
         if( n == 0 ) {
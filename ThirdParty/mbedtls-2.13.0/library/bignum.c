@@ -1556,6 +1556,83 @@ static void mpi_montg_init( mbedtls_mpi_uint *mm, const mbedtls_mpi *N )
     *mm = ~x + 1;
 }
 
+#if defined(NUVOTON_MPI_UMAAL)
+#if !defined(MULADDC_UMAAL) && defined(MBEDTLS_HAVE_UDBL)
+/*
+ * Portable C version of the UMAAL step of bn_mul.h: hi:lo = a * b + lo + hi
+ */
+#define MULADDC_UMAAL( lo, hi, a, b )                                   \
+    do {                                                                \
+        mbedtls_t_udbl r_ = (mbedtls_t_udbl)( a ) * ( b ) + ( lo ) + ( hi ); \
+        ( lo ) = (mbedtls_mpi_uint) r_;                                 \
+        ( hi ) = (mbedtls_mpi_uint)( r_ >> biL );                       \
+    } while( 0 )
+#endif
+
+#if defined(MULADDC_UMAAL)
+#define NVT_MPI_MONTMUL_ROW
+#endif
+#endif /* NUVOTON_MPI_UMAAL */
+
+#if defined(NVT_MPI_MONTMUL_ROW)
+/*
+ * One row of the Montgomery multiplication: d += u0 * B + u1 * N, with B of
+ * m <= n limbs and N of n limbs, the carry propagated into d[n] and up.
+ * Does both multiply-accumulates in one pass over d, which is loaded and
+ * stored once instead of twice, four limbs per loop.
+ */
+static void mpi_montmul_row( size_t m, size_t n, const mbedtls_mpi_uint *B,
+                             const mbedtls_mpi_uint *N, mbedtls_mpi_uint *d,
+                             mbedtls_mpi_uint u0, mbedtls_mpi_uint u1 )
+{
+    mbedtls_mpi_uint c0 = 0, c1 = 0, r0, r1, r2, r3;
+    size_t i;
+
+    for( i = 0; i + 4 <= m; i += 4 )
+    {
+        r0 = d[i]; r1 = d[i + 1]; r2 = d[i + 2]; r3 = d[i + 3];
+
+        MULADDC_UMAAL( r0, c0, u0, B[i] );
+        MULADDC_UMAAL( r0, c1, u1, N[i] );
+        MULADDC_UMAAL( r1, c0, u0, B[i + 1] );
+        MULADDC_UMAAL( r1, c1, u1, N[i + 1] );
+        MULADDC_UMAAL( r2, c0, u0, B[i + 2] );
+        MULADDC_UMAAL( r2, c1, u1, N[i + 2] );
+        MULADDC_UMAAL( r3, c0, u0, B[i + 3] );
+        MULADDC_UMAAL( r3, c1, u1, N[i + 3] );
+
+        d[i] = r0; d[i + 1] = r1; d[i + 2] = r2; d[i + 3] = r3;
+    }
+
+    for( ; i < m; i++ )
+    {
+        r0 = d[i];
+        MULADDC_UMAAL( r0, c0, u0, B[i] );
+        MULADDC_UMAAL( r0, c1, u1, N[i] );
+        d[i] = r0;
+    }
+
+    /* Past the end of B, c0 is a plain carry to add in */
+    for( ; i < n; i++ )
+    {
+        r0 = d[i];
+        MULADDC_UMAAL( r0, c1, u1, N[i] );
+        r0 += c0; c0 = ( r0 < c0 );
+        d[i] = r0;
+    }
+
+    /* Both carries, c1:c0 = c0 + c1, from d[n] up */
+    c0 += c1; c1 = ( c0 < c1 );
+    d += n;
+    *d += c0; c1 += ( *d < c0 ); d++;
+
+    while( c1 != 0 )
+    {
+        *d += c1; c1 = ( *d < c1 ); d++;
+    }
+}
+#endif /* NVT_MPI_MONTMUL_ROW */
+
 /*
  * Montgomery multiplication: A = A * B * R^-1 mod N  (HAC 14.36)
  */
@@ -1582,8 +1659,12 @@ static int mpi_montmul( mbedtls_mpi *A, const mbedtls_mpi *B, const mbedtls_mpi
         u0 = A->p[i];
         u1 = ( d[0] + u0 * B->p[0] ) * mm;
 
+#if defined(NVT_MPI_MONTMUL_ROW)
+        mpi_montmul_row( m, n, B->p, N->p, d, u0, u1 );
+#else
         mpi_mul_hlp( m, B->p, d, u0 );
         mpi_mul_hlp( n, N->p, d, u1 );
+#endif
 
         *d++ = u0; d[n + 1] = 0;
     }
@@ -2302,6 +2383,100 @@ static const int gcd_pairs[GCD_PAIR_COUNT][3] =
     { 768454923, 542167814, 1 }
 };
 
+#if defined(NVT_MPI_MONTMUL_ROW) && defined(MBEDTLS_HAVE_UDBL)
+#define NVT_MPI_TEST_LIMBS  40
+
+/*
+ * Plain double-width reference of mpi_mul_hlp()
+ */
+static void mpi_ref_mul_hlp( size_t i, const mbedtls_mpi_uint *s,
+                             mbedtls_mpi_uint *d, mbedtls_mpi_uint b )
+{
+    mbedtls_t_udbl r;
+    mbedtls_mpi_uint c = 0;
+
+    for( ; i > 0; i--, s++, d++ )
+    {
+        r = (mbedtls_t_udbl) *s * b + *d + c;
+        *d = (mbedtls_mpi_uint) r;
+        c = (mbedtls_mpi_uint)( r >> biL );
+    }
+
+    for( ; c != 0; d++ )
+    {
+        *d += c; c = ( *d < c );
+    }
+}
+
+static mbedtls_mpi_uint mpi_test_limb( uint32_t *x, int ones )
+{
+    mbedtls_mpi_uint r = 0;
+    size_t i;
+
+    if( ones )
+        return( ~(mbedtls_mpi_uint) 0 );
+
+    for( i = 0; i < ciL; i += 4 )
+    {
+        *x ^= *x << 13; *x ^= *x >> 17; *x ^= *x << 5;
+        r = ( r << 16 << 16 ) | *x;
+    }
+
+    return( r );
+}
+
+/*
+ * The multiply-accumulate kernels against each other over random operands,
+ * and all-ones ones for the longest carry chains: the fused Montgomery row,
+ * two mpi_mul_hlp() calls and the reference must give the same d.
+ * Returns the failing operand length, 0 if all agree.
+ */
+static size_t mpi_kernel_test( void )
+{
+    mbedtls_mpi_uint B[NVT_MPI_TEST_LIMBS], N[NVT_MPI_TEST_LIMBS], u0, u1;
+    mbedtls_mpi_uint d0[NVT_MPI_TEST_LIMBS + 3], d1[NVT_MPI_TEST_LIMBS + 3];
+    mbedtls_mpi_uint d2[NVT_MPI_TEST_LIMBS + 3];
+    uint32_t x = 0x2545F491;
+    size_t i, m, n, k;
+    int ones;
+
+    for( n = 1; n <= NVT_MPI_TEST_LIMBS; n++ )
+    {
+        for( k = 0; k < 6; k++ )
+        {
+            /* B as long as N, one limb and half as long */
+            m = ( k % 3 == 0 ) ? n : ( k % 3 == 1 ) ? n - 1 : n / 2;
+            ones = ( k >= 3 );
+
+            for( i = 0; i < n; i++ )
+            {
+                B[i] = mpi_test_limb( &x, ones );
+                N[i] = mpi_test_limb( &x, ones );
+                d0[i] = mpi_test_limb( &x, ones );
+            }
+            d0[n] = d0[n + 1] = d0[n + 2] = 0;
+            u0 = mpi_test_limb( &x, ones );
+            u1 = mpi_test_limb( &x, ones );
+
+            memcpy( d1, d0, ( n + 3 ) * ciL );
+            memcpy( d2, d0, ( n + 3 ) * ciL );
+
+            mpi_montmul_row( m, n, B, N, d0, u0, u1 );
+            mpi_mul_hlp( m, B, d1, u0 );
+            mpi_mul_hlp( n, N, d1, u1 );
+            mpi_ref_mul_hlp( m, B, d2, u0 );
+            mpi_ref_mul_hlp( n, N, d2, u1 );
+
+            if( memcmp( d0, d2, ( n + 3 ) * ciL ) != 0 ||
+                memcmp( d1, d2, ( n + 3 ) * ciL ) != 0 )
+                return( n );
+        }
+    }
+
+    return( 0 );
+}
+#endif /* NVT_MPI_MONTMUL_ROW && MBEDTLS_HAVE_UDBL */
+
 /*
  * Checkup routine
  */
@@ -2449,6 +2624,23 @@ int mbedtls_mpi_self_test( int verbose )
     if( verbose != 0 )
         mbedtls_printf( "passed\n" );
 
+#if defined(NVT_MPI_MONTMUL_ROW) && defined(MBEDTLS_HAVE_UDBL)
+    if( verbose != 0 )
+        mbedtls_printf( "  MPI test #6 (UMAAL kernels): " );
+
+    if( ( i = (int) mpi_kernel_test() ) != 0 )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "failed at %d limbs\n", i );
+
+        ret = 1;
+        goto cleanup;
+    }
+
+    if( verbose != 0 )
+        mbedtls_printf( "passed\n" );
+#endif
+
 cleanup:
 
     if( ret != 0 && verbose != 0 )
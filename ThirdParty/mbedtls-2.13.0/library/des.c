@@ -48,14 +48,28 @@
 #endif /* MBEDTLS_SELF_TEST */
 
 #ifdef NUVOTON_ENABLE_DES
+/*
+ * DMA bounce buffers. Buffers that are not word aligned are copied through
+ * these, NUVOTON_DES_DMA_BUFF_SIZE bytes at a time. Like the key channel
+ * table below they are shared by all contexts and only used with the TDES
+ * engine held by CRPT_JobLock().
+ */
+#ifndef NUVOTON_DES_DMA_BUFF_SIZE
+#define NUVOTON_DES_DMA_BUFF_SIZE   64
+#endif
+
+#if ( NUVOTON_DES_DMA_BUFF_SIZE < 8 ) || ( NUVOTON_DES_DMA_BUFF_SIZE % 8 )
+#error "NUVOTON_DES_DMA_BUFF_SIZE must be a non-zero multiple of 8"
+#endif
+
 #ifdef __ICCARM__
 #pragma data_alignment=4
-static uint8_t src_dma_buff[16];
+static uint8_t src_dma_buff[NUVOTON_DES_DMA_BUFF_SIZE];
 #pragma data_alignment=4
-static uint8_t dst_dma_buff[16];
+static uint8_t dst_dma_buff[NUVOTON_DES_DMA_BUFF_SIZE];
 #else
-static uint8_t src_dma_buff[16] __attribute__((aligned (4)));
-static uint8_t dst_dma_buff[16] __attribute__((aligned (4)));
+static uint8_t src_dma_buff[NUVOTON_DES_DMA_BUFF_SIZE] __attribute__((aligned (4)));
+static uint8_t dst_dma_buff[NUVOTON_DES_DMA_BUFF_SIZE] __attribute__((aligned (4)));
 #endif
 #endif
 
@@ -318,12 +332,211 @@ static const uint32_t RHs[16] =
 
 #define SWAP(a,b) { uint32_t t = a; a = b; b = t; t = 0; }
 
+#ifdef NUVOTON_ENABLE_DES
+/*
+ * The engine key and mode of a context live at the start of its sk[] array:
+ * key 1..3 high and low words, followed by the TDES_CTL bits of the key.
+ * Like the AES port, each of the four TDES channels keeps its own key
+ * registers; a context is bound to a channel on first use and its key stays
+ * resident there until the channel is handed to another context. Channels
+ * are reassigned least recently used first.
+ */
+#define NVT_DES_SK_CTL          6
+
+#define NVT_DES_CHANNEL_NUM     4
+#define NVT_DES_CH_REG(reg, ch) ( (uint32_t *)( (uint32_t)&(reg) + (ch) * 0x40UL ) )
+
+static struct
+{
+    const uint32_t  *owner;     /* sk[] of the context whose key is loaded, or NULL */
+    uint32_t        last_use;   /* LRU stamp */
+} nvt_des_channel[NVT_DES_CHANNEL_NUM];
+
+static uint32_t  nvt_des_use_stamp;
+
+static void nvt_des_release_channel( const uint32_t *sk )
+{
+    int   ch;
+
+    CRPT_JobLock( CRPT_JOB_TDES );
+    for( ch = 0; ch < NVT_DES_CHANNEL_NUM; ch++ )
+    {
+        if( nvt_des_channel[ch].owner == sk )
+            nvt_des_channel[ch].owner = NULL;
+    }
+    CRPT_JobUnlock( CRPT_JOB_TDES );
+}
+
+/*
+ * Return the channel holding the key of sk[], loading it into the least
+ * recently used channel first if it is not resident. The caller holds the
+ * TDES engine.
+ */
+static int nvt_des_get_channel( const uint32_t *sk )
+{
+    int        i, ch, victim = 0;
+    uint32_t   *des_key;
+
+    nvt_des_use_stamp++;
+
+    for( ch = 0; ch < NVT_DES_CHANNEL_NUM; ch++ )
+    {
+        if( nvt_des_channel[ch].owner == sk )
+        {
+            nvt_des_channel[ch].last_use = nvt_des_use_stamp;
+            return( ch );
+        }
+        if( nvt_des_channel[victim].owner != NULL &&
+            ( nvt_des_channel[ch].owner == NULL ||
+              nvt_des_channel[ch].last_use < nvt_des_channel[victim].last_use ) )
+            victim = ch;
+    }
+
+    /* KEY1H, KEY1L, KEY2H, KEY2L, KEY3H and KEY3L are consecutive */
+    des_key = NVT_DES_CH_REG( CRPT->TDES0_KEY1H, victim );
+    for( i = 0; i < 6; i++ )
+        des_key[i] = sk[i];
+
+    nvt_des_channel[victim].owner = sk;
+    nvt_des_channel[victim].last_use = nvt_des_use_stamp;
+
+    return( victim );
+}
+
+void nvt_des_flush_channels( void )
+{
+    CRPT_JobLock( CRPT_JOB_TDES );
+    memset( nvt_des_channel, 0, sizeof( nvt_des_channel ) );
+    CRPT_JobUnlock( CRPT_JOB_TDES );
+}
+
+/*
+ * Keep a key in sk[]. key2 and key3 are the byte offsets of the second and
+ * third key in key[], ctl the TDES_CTL bits of the key.
+ */
+static void nvt_des_store_key( uint32_t *sk, const unsigned char *key,
+                               int key2, int key3, uint32_t ctl )
+{
+    /* A resident copy of the old key must not be reused */
+    nvt_des_release_channel( sk );
+
+    GET_UINT32_BE( sk[0], key, 0 );
+    GET_UINT32_BE( sk[1], key, 4 );
+    GET_UINT32_BE( sk[2], key, key2 );
+    GET_UINT32_BE( sk[3], key, key2 + 4 );
+    GET_UINT32_BE( sk[4], key, key3 );
+    GET_UINT32_BE( sk[5], key, key3 + 4 );
+    sk[NVT_DES_SK_CTL] = ctl;
+}
+
+/*
+ * Queue one DMA transfer of channel ch on the CRPT job queue and wait for
+ * it.
+ */
+static int nvt_des_run( int ch, const void *src, void *dst, uint32_t cnt, uint32_t ctl )
+{
+    CRPT_JOB_REG_T  regs[4];
+    CRPT_JOB_T      job;
+
+    regs[0].pu32Reg = NVT_DES_CH_REG( CRPT->TDES0_SA, ch );
+    regs[0].u32Val  = (uint32_t)src;
+    regs[1].pu32Reg = NVT_DES_CH_REG( CRPT->TDES0_DA, ch );
+    regs[1].u32Val  = (uint32_t)dst;
+    regs[2].pu32Reg = NVT_DES_CH_REG( CRPT->TDES0_CNT, ch );
+    regs[2].u32Val  = cnt;
+    regs[3].pu32Reg = &CRPT->TDES_CTL;
+    regs[3].u32Val  = ctl | CRPT_TDES_CTL_START_Msk;
+
+    memset( &job, 0, sizeof( job ) );
+    job.u32Engine = CRPT_JOB_TDES;
+    job.pRegs     = regs;
+    job.u32RegCnt = 4;
+
+    if( CRPT_JobRun( CRPT, &job ) != CRPT_JOB_DONE )
+        return( MBEDTLS_ERR_DES_HW_ACCEL_FAILED );
+
+    return( 0 );
+}
+
+/*
+ * Run a multiple of 8 bytes through the engine with the key in sk[], in
+ * ECB or hardware CBC mode (opmode is TDES_MODE_ECB or TDES_MODE_CBC).
+ *
+ * The first DMA transfer loads the IV from iv[]; every following transfer
+ * sets DMACSCAD so the engine chains on from its own feedback register.
+ * Word aligned caller buffers are read and written directly in a single
+ * transfer, others are bounced through src_dma_buff/dst_dma_buff. iv[]
+ * itself is not updated here.
+ */
+static int nvt_des_crypt_dma( const uint32_t *sk, uint32_t opmode, size_t length,
+                              const unsigned char iv[8],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    int        ch, ret = 0;
+    uint32_t   ctl, chunk;
+    int        direct;
+
+    direct = ( ( ( (uint32_t)input | (uint32_t)output ) & 0x3 ) == 0 );
+
+    /* The cascade and the bounce buffers are ours until the last transfer */
+    CRPT_JobLock( CRPT_JOB_TDES );
+
+    ch = nvt_des_get_channel( sk );
+
+    if( iv != NULL )
+    {
+        GET_UINT32_BE( *NVT_DES_CH_REG( CRPT->TDES0_IVH, ch ), iv, 0 );
+        GET_UINT32_BE( *NVT_DES_CH_REG( CRPT->TDES0_IVL, ch ), iv, 4 );
+    }
+
+    ctl = ( (uint32_t) ch << CRPT_TDES_CTL_CHANNEL_Pos ) | sk[NVT_DES_SK_CTL] |
+          ( opmode & CRPT_TDES_CTL_OPMODE_Msk ) |
+          CRPT_TDES_CTL_INSWAP_Msk | CRPT_TDES_CTL_OUTSWAP_Msk |
+          CRPT_TDES_CTL_BLKSWAP_Msk | CRPT_TDES_CTL_DMAEN_Msk;
+
+    while( length > 0 )
+    {
+        if( direct )
+            chunk = length;
+        else
+            chunk = ( length > NUVOTON_DES_DMA_BUFF_SIZE ) ? NUVOTON_DES_DMA_BUFF_SIZE : length;
+
+        if( direct )
+        {
+            ret = nvt_des_run( ch, input, output, chunk,
+                               ctl | ( ( chunk == length ) ? CRPT_TDES_CTL_DMALAST_Msk : 0 ) );
+        }
+        else
+        {
+            memcpy( src_dma_buff, input, chunk );
+            ret = nvt_des_run( ch, src_dma_buff, dst_dma_buff, chunk,
+                               ctl | ( ( chunk == length ) ? CRPT_TDES_CTL_DMALAST_Msk : 0 ) );
+            memcpy( output, dst_dma_buff, chunk );
+        }
+        if( ret != 0 )
+            break;
+
+        /* Later transfers continue from the engine's feedback register */
+        ctl |= CRPT_TDES_CTL_DMACSCAD_Msk;
+
+        input  += chunk;
+        output += chunk;
+        length -= chunk;
+    }
+
+    CRPT_JobUnlock( CRPT_JOB_TDES );
+    return( ret );
+}
+
+#endif /* NUVOTON_ENABLE_DES */
+
 void mbedtls_des_init( mbedtls_des_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_des_context ) );
 #ifdef NUVOTON_ENABLE_DES
-	CRPT->TDES_CTL = 0;
-#endif	
+    nvt_des_release_channel( ctx->sk );
+#endif
 }
 
 void mbedtls_des_free( mbedtls_des_context *ctx )
@@ -331,6 +544,9 @@ void mbedtls_des_free( mbedtls_des_context *ctx )
     if( ctx == NULL )
         return;
 
+#ifdef NUVOTON_ENABLE_DES
+    nvt_des_release_channel( ctx->sk );
+#endif
     mbedtls_platform_zeroize( ctx, sizeof( mbedtls_des_context ) );
 }
 
@@ -338,8 +554,8 @@ void mbedtls_des3_init( mbedtls_des3_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_des3_context ) );
 #ifdef NUVOTON_ENABLE_DES
-	CRPT->TDES_CTL = 0;
-#endif	
+    nvt_des_release_channel( ctx->sk );
+#endif
 }
 
 void mbedtls_des3_free( mbedtls_des3_context *ctx )
@@ -347,6 +563,9 @@ void mbedtls_des3_free( mbedtls_des3_context *ctx )
     if( ctx == NULL )
         return;
 
+#ifdef NUVOTON_ENABLE_DES
+    nvt_des_release_channel( ctx->sk );
+#endif
     mbedtls_platform_zeroize( ctx, sizeof( mbedtls_des3_context ) );
 }
 
@@ -514,89 +733,54 @@ void mbedtls_des_setkey( uint32_t SK[32], const unsigned char key[MBEDTLS_DES_KE
 
 int mbedtls_des_setkey_enc( mbedtls_des_context *ctx, const unsigned char key[MBEDTLS_DES_KEY_SIZE] )
 {
-	GET_UINT32_BE(CRPT->TDES0_KEY1H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY1L, key, 4);
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_ENCRPT_Msk;
-	return 0;
+    nvt_des_store_key( ctx->sk, key, 0, 0, CRPT_TDES_CTL_ENCRPT_Msk );
+    return( 0 );
 }
 
 int mbedtls_des_setkey_dec( mbedtls_des_context *ctx, const unsigned char key[MBEDTLS_DES_KEY_SIZE] )
 {
-	GET_UINT32_BE(CRPT->TDES0_KEY1H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY1L, key, 4);
-	CRPT->TDES_CTL &= ~CRPT_TDES_CTL_ENCRPT_Msk;
-	return 0;
+    nvt_des_store_key( ctx->sk, key, 0, 0, 0 );
+    return( 0 );
 }
 
 int mbedtls_des3_set2key_enc( mbedtls_des3_context *ctx,
                       const unsigned char key[MBEDTLS_DES_KEY_SIZE * 2] )
 {
-	GET_UINT32_BE(CRPT->TDES0_KEY1H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY1L, key, 4);
-	GET_UINT32_BE(CRPT->TDES0_KEY2H, key, 8);
-	GET_UINT32_BE(CRPT->TDES0_KEY2L, key, 12);
-	GET_UINT32_BE(CRPT->TDES0_KEY3H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY3L, key, 4);
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_ENCRPT_Msk;
-	return 0;
+    nvt_des_store_key( ctx->sk, key, 8, 0, CRPT_TDES_CTL_ENCRPT_Msk |
+                       CRPT_TDES_CTL_TMODE_Msk | CRPT_TDES_CTL_3KEYS_Msk );
+    return( 0 );
 }
 
 int mbedtls_des3_set2key_dec( mbedtls_des3_context *ctx,
                       const unsigned char key[MBEDTLS_DES_KEY_SIZE * 2] )
 {
-	GET_UINT32_BE(CRPT->TDES0_KEY1H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY1L, key, 4);
-	GET_UINT32_BE(CRPT->TDES0_KEY2H, key, 8);
-	GET_UINT32_BE(CRPT->TDES0_KEY2L, key, 12);
-	GET_UINT32_BE(CRPT->TDES0_KEY3H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY3L, key, 4);
-	CRPT->TDES_CTL &= ~CRPT_TDES_CTL_ENCRPT_Msk;
-	return 0;
+    nvt_des_store_key( ctx->sk, key, 8, 0,
+                       CRPT_TDES_CTL_TMODE_Msk | CRPT_TDES_CTL_3KEYS_Msk );
+    return( 0 );
 }
 
 int mbedtls_des3_set3key_enc( mbedtls_des3_context *ctx,
                       const unsigned char key[MBEDTLS_DES_KEY_SIZE * 3] )
 {
-	GET_UINT32_BE(CRPT->TDES0_KEY1H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY1L, key, 4);
-	GET_UINT32_BE(CRPT->TDES0_KEY2H, key, 8);
-	GET_UINT32_BE(CRPT->TDES0_KEY2L, key, 12);
-	GET_UINT32_BE(CRPT->TDES0_KEY3H, key, 16);
-	GET_UINT32_BE(CRPT->TDES0_KEY3L, key, 20);
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_ENCRPT_Msk;
-	return 0;
+    nvt_des_store_key( ctx->sk, key, 8, 16, CRPT_TDES_CTL_ENCRPT_Msk |
+                       CRPT_TDES_CTL_TMODE_Msk | CRPT_TDES_CTL_3KEYS_Msk );
+    return( 0 );
 }
 
 int mbedtls_des3_set3key_dec( mbedtls_des3_context *ctx,
                       const unsigned char key[MBEDTLS_DES_KEY_SIZE * 3] )
 {
-	GET_UINT32_BE(CRPT->TDES0_KEY1H, key, 0);
-	GET_UINT32_BE(CRPT->TDES0_KEY1L, key, 4);
-	GET_UINT32_BE(CRPT->TDES0_KEY2H, key, 8);
-	GET_UINT32_BE(CRPT->TDES0_KEY2L, key, 12);
-	GET_UINT32_BE(CRPT->TDES0_KEY3H, key, 16);
-	GET_UINT32_BE(CRPT->TDES0_KEY3L, key, 20);
-	CRPT->TDES_CTL &= ~CRPT_TDES_CTL_ENCRPT_Msk;
-	return 0;
+    nvt_des_store_key( ctx->sk, key, 8, 16,
+                       CRPT_TDES_CTL_TMODE_Msk | CRPT_TDES_CTL_3KEYS_Msk );
+    return( 0 );
 }
 
 int mbedtls_des_crypt_ecb( mbedtls_des_context *ctx,
                     const unsigned char input[8],
                     unsigned char output[8] )
 {
-	CRPT->TDES0_SA = (uint32_t)src_dma_buff;
-	CRPT->TDES0_DA = (uint32_t)dst_dma_buff;
-	CRPT->TDES0_CNT = 8;
-	
-	memcpy(src_dma_buff, input, 8);
-	g_Crypto_Int_done = 0;
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_INSWAP_Msk | CRPT_TDES_CTL_OUTSWAP_Msk | CRPT_TDES_CTL_BLKSWAP_Msk;
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_DMAEN_Msk | CRPT_TDES_CTL_DMACSCAD_Msk | CRPT_TDES_CTL_START_Msk;
-	while (g_Crypto_Int_done == 0);
-	
-	memcpy(output, dst_dma_buff, 8);
-	return 0;
-}                    
+    return( nvt_des_crypt_dma( ctx->sk, TDES_MODE_ECB, 8, NULL, input, output ) );
+}
 
 #else  /* !NUVOTON_ENABLE_DES */
 /*
@@ -783,6 +967,27 @@ int mbedtls_des_crypt_cbc( mbedtls_des_context *ctx,
     if( length % 8 )
         return( MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH );
 
+#ifdef NUVOTON_ENABLE_DES
+    if( length > 0 )
+    {
+        int ret;
+
+        /* The next IV is the last ciphertext block, which an in-place
+         * decryption is about to overwrite */
+        if( mode == MBEDTLS_DES_DECRYPT )
+            memcpy( temp, input + length - 8, 8 );
+
+        ret = nvt_des_crypt_dma( ctx->sk, TDES_MODE_CBC, length, iv, input, output );
+        if( ret != 0 )
+            return( ret );
+
+        if( mode == MBEDTLS_DES_DECRYPT )
+            memcpy( iv, temp, 8 );
+        else
+            memcpy( iv, output + length - 8, 8 );
+    }
+    (void) i;
+#else
     if( mode == MBEDTLS_DES_ENCRYPT )
     {
         while( length > 0 )
@@ -815,6 +1020,7 @@ int mbedtls_des_crypt_cbc( mbedtls_des_context *ctx,
             length -= 8;
         }
     }
+#endif /* NUVOTON_ENABLE_DES */
 
     return( 0 );
 }
@@ -827,19 +1033,8 @@ int mbedtls_des3_crypt_ecb( mbedtls_des3_context *ctx,
                      const unsigned char input[8],
                      unsigned char output[8] )
 {
-	CRPT->TDES0_SA = (uint32_t)src_dma_buff;
-	CRPT->TDES0_DA = (uint32_t)dst_dma_buff;
-	CRPT->TDES0_CNT = 8;
-	
-	memcpy(src_dma_buff, input, 8);
-	g_Crypto_Int_done = 0;
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_INSWAP_Msk | CRPT_TDES_CTL_OUTSWAP_Msk | CRPT_TDES_CTL_BLKSWAP_Msk;
-	CRPT->TDES_CTL |= CRPT_TDES_CTL_DMAEN_Msk | CRPT_TDES_CTL_DMACSCAD_Msk | CRPT_TDES_CTL_3KEYS_Msk | CRPT_TDES_CTL_TMODE_Msk | CRPT_TDES_CTL_START_Msk;
-	while (g_Crypto_Int_done == 0);
-	
-	memcpy(output, dst_dma_buff, 8);
-	return 0;
-}                    
+    return( nvt_des_crypt_dma( ctx->sk, TDES_MODE_ECB, 8, NULL, input, output ) );
+}
 
 #else
 /*
@@ -905,6 +1100,27 @@ int mbedtls_des3_crypt_cbc( mbedtls_des3_context *ctx,
     if( length % 8 )
         return( MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH );
 
+#ifdef NUVOTON_ENABLE_DES
+    if( length > 0 )
+    {
+        int ret;
+
+        /* The next IV is the last ciphertext block, which an in-place
+         * decryption is about to overwrite */
+        if( mode == MBEDTLS_DES_DECRYPT )
+            memcpy( temp, input + length - 8, 8 );
+
+        ret = nvt_des_crypt_dma( ctx->sk, TDES_MODE_CBC, length, iv, input, output );
+        if( ret != 0 )
+            return( ret );
+
+        if( mode == MBEDTLS_DES_DECRYPT )
+            memcpy( iv, temp, 8 );
+        else
+            memcpy( iv, output + length - 8, 8 );
+    }
+    (void) i;
+#else
     if( mode == MBEDTLS_DES_ENCRYPT )
     {
         while( length > 0 )
@@ -937,6 +1153,7 @@ int mbedtls_des3_crypt_cbc( mbedtls_des3_context *ctx,
             length -= 8;
         }
     }
+#endif /* NUVOTON_ENABLE_DES */
 
     return( 0 );
 }
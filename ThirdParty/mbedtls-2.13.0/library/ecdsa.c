@@ -35,6 +35,7 @@
 
 #include "mbedtls/ecdsa.h"
 #include "mbedtls/asn1write.h"
+#include "mbedtls/platform_util.h"
 
 #include <string.h>
 
@@ -83,6 +84,9 @@ int mbedtls_ecdsa_sign( mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
 
 #ifdef NUVOTON_ENABLE_ECC
 	E_ECC_CURVE   ecc_curve;
+    int       hw_ret;
+    uint32_t  au32E[ECC_KEY_WORD_MAX], au32K[ECC_KEY_WORD_MAX], au32D[ECC_KEY_WORD_MAX];
+    uint32_t  au32R[ECC_KEY_WORD_MAX], au32S[ECC_KEY_WORD_MAX];
 
 	ecc_curve = nuvoton_get_curve(grp->id);
 	if (ecc_curve == CURVE_UNDEF)
@@ -128,16 +132,20 @@ int mbedtls_ecdsa_sign( mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
 
 #ifdef NUVOTON_ENABLE_ECC
 
-        mbedtls_mpi_write_string(&e, 16, tmp_1_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-        mbedtls_mpi_write_string(&k, 16, tmp_2_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-        mbedtls_mpi_write_string(d,  16, tmp_3_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
+        MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &e, au32E ) );
+        MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &k, au32K ) );
+        MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( d, au32D ) );
 
-        if (ECC_GenerateSignature(CRPT, ecc_curve, tmp_1_str, tmp_3_str, tmp_2_str, tmp_x_str, tmp_y_str) == 0)
+        CRPT_JobLock( CRPT_JOB_ECC );
+        hw_ret = ECC_GenerateSignatureWords(CRPT, ecc_curve, au32E, au32D, au32K, au32R, au32S);
+        CRPT_JobUnlock( CRPT_JOB_ECC );
+
+        if (hw_ret == 0)
         {
-			mbedtls_mpi_read_string(r, 16, tmp_x_str);
-			mbedtls_mpi_read_string(s, 16, tmp_y_str);
-			break;
-    	}
+            MBEDTLS_MPI_CHK( nuvoton_words_to_mpi( r, au32R ) );
+            MBEDTLS_MPI_CHK( nuvoton_words_to_mpi( s, au32S ) );
+            break;
+        }
 #else
         /*
          * Generate a random value to blind inv_mod in next step,
@@ -180,6 +188,10 @@ int mbedtls_ecdsa_sign( mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
 cleanup:
     mbedtls_ecp_point_free( &R );
     mbedtls_mpi_free( &k ); mbedtls_mpi_free( &e ); mbedtls_mpi_free( &t );
+#ifdef NUVOTON_ENABLE_ECC
+    mbedtls_platform_zeroize( au32K, sizeof( au32K ) );
+    mbedtls_platform_zeroize( au32D, sizeof( au32D ) );
+#endif
 
     return( ret );
 }
@@ -237,6 +249,8 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
     mbedtls_ecp_point R;
 #ifdef NUVOTON_ENABLE_ECC
 	E_ECC_CURVE   ecc_curve;
+    uint32_t  au32E[ECC_KEY_WORD_MAX], au32R[ECC_KEY_WORD_MAX], au32S[ECC_KEY_WORD_MAX];
+    uint32_t  au32X[ECC_KEY_WORD_MAX], au32Y[ECC_KEY_WORD_MAX];
 
 	ecc_curve = nuvoton_get_curve(grp->id);
 	if (ecc_curve == CURVE_UNDEF)
@@ -272,22 +286,21 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
 
 #ifdef NUVOTON_ENABLE_ECC
 
-    mbedtls_mpi_write_string(&e, 16, tmp_1_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-    mbedtls_mpi_write_string(r,  16, tmp_2_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-    mbedtls_mpi_write_string(s,  16, tmp_3_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-    mbedtls_mpi_write_string(&Q->X,  16, tmp_x_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-    mbedtls_mpi_write_string(&Q->Y,  16, tmp_y_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &e, au32E ) );
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( r, au32R ) );
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( s, au32S ) );
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &Q->X, au32X ) );
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &Q->Y, au32Y ) );
 
-    if (ECC_VerifySignature(CRPT, ecc_curve, tmp_1_str, tmp_x_str, tmp_y_str, tmp_2_str, tmp_3_str) != 0)
+    CRPT_JobLock( CRPT_JOB_ECC );
+    ret = ECC_VerifySignatureWords(CRPT, ecc_curve, au32E, au32X, au32Y, au32R, au32S);
+    CRPT_JobUnlock( CRPT_JOB_ECC );
+
+    if (ret != 0)
     {
     	ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
     	goto cleanup;
     }
-    else
-    {
-    	mbedtls_mpi_read_string(&R.X, 16, tmp_2_str);
-    	mbedtls_mpi_read_string(&R.Y, 16, tmp_3_str);
-	}
 #else
     /*
      * Step 4: u1 = e / s mod n, u2 = r / s mod n
@@ -319,7 +332,6 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
      * Step 7: reduce xR mod n (gives v)
      */
     MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &R.X, &R.X, &grp->N ) );
-#endif
 
     /*
      * Step 8: check if v (that is, R.X) is equal to r
@@ -329,6 +341,7 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
         ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
         goto cleanup;
     }
+#endif
 
 cleanup:
     mbedtls_ecp_point_free( &R );
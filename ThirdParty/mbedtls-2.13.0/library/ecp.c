@@ -166,17 +166,8 @@ static const mbedtls_ecp_curve_info ecp_supported_curves[] =
 
 static mbedtls_ecp_group_id ecp_supported_grp_id[ECP_NB_CURVES];
 
-size_t  tmp_len;
-char  tmp_str[MBEDTLS_ECP_MAX_PT_LEN];
-
 #ifdef NUVOTON_ENABLE_ECC
 
-char  tmp_x_str[MBEDTLS_ECP_MAX_PT_LEN];
-char  tmp_y_str[MBEDTLS_ECP_MAX_PT_LEN];
-char  tmp_1_str[MBEDTLS_ECP_MAX_PT_LEN];
-char  tmp_2_str[MBEDTLS_ECP_MAX_PT_LEN];
-char  tmp_3_str[MBEDTLS_ECP_MAX_PT_LEN];
-
 E_ECC_CURVE  nuvoton_get_curve(mbedtls_ecp_group_id id)
 {
     int  i;	
@@ -188,6 +179,45 @@ E_ECC_CURVE  nuvoton_get_curve(mbedtls_ecp_group_id id)
 	}
 	return CURVE_UNDEF;
 }
+
+#define NVT_WORDS_PER_LIMB    ( sizeof( mbedtls_mpi_uint ) / 4 )
+
+/*
+ * Copy X into the zero padded, least significant word first array
+ * the ECC_xxxWords() functions of the crypto driver take.
+ */
+int nuvoton_mpi_to_words( const mbedtls_mpi *X, uint32_t au32Words[] )
+{
+    size_t  i, li;
+
+    if( X->s < 0 || mbedtls_mpi_bitlen( X ) > ECC_KEY_WORD_MAX * 32 )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    for( i = 0; i < ECC_KEY_WORD_MAX; i++ )
+    {
+        li = i / NVT_WORDS_PER_LIMB;
+        au32Words[i] = ( li < X->n ) ?
+            (uint32_t)( X->p[li] >> ( ( i % NVT_WORDS_PER_LIMB ) * 32 ) ) : 0;
+    }
+
+    return( 0 );
+}
+
+int nuvoton_words_to_mpi( mbedtls_mpi *X, const uint32_t au32Words[] )
+{
+    int     ret;
+    size_t  i;
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( X, ECC_KEY_WORD_MAX / NVT_WORDS_PER_LIMB ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( X, 0 ) );
+
+    for( i = 0; i < ECC_KEY_WORD_MAX; i++ )
+        X->p[i / NVT_WORDS_PER_LIMB] |=
+            (mbedtls_mpi_uint) au32Words[i] << ( ( i % NVT_WORDS_PER_LIMB ) * 32 );
+
+cleanup:
+    return( ret );
+}
 #endif
 
 /*
@@ -1369,6 +1399,216 @@ cleanup:
     return( ret );
 }
 
+/*
+ * Fixed-base comb table cache.
+ *
+ * ecp_mul_comb() keeps the multiples of G in grp->T, which goes away with
+ * the group. A session that loads a group, signs and frees it again (one
+ * TLS handshake, one mbedtls_pk_sign() of a freshly parsed key) built the
+ * table on every call. Tables are kept here instead, one per curve, in at
+ * most NUVOTON_ECP_COMB_CACHE_SIZE bytes of heap; the least recently used
+ * one goes first. Tables generated into flash (see NUVOTON_ECP_COMB_ROM)
+ * are looked up before that and take no heap at all.
+ */
+#ifndef NUVOTON_ECP_COMB_CACHE_SIZE
+#define NUVOTON_ECP_COMB_CACHE_SIZE     8192
+#endif
+
+#if ( NUVOTON_ECP_COMB_CACHE_SIZE > 0 ) || defined(NUVOTON_ECP_COMB_ROM)
+#define NVT_ECP_COMB_CACHE
+#endif
+
+#if defined(NVT_ECP_COMB_CACHE)
+
+#if defined(NUVOTON_ECP_COMB_ROM)
+/*
+ * The generated tables give their limbs as pairs of 32-bit words, least
+ * significant first, so the same file builds for either limb size.
+ */
+#if defined(MBEDTLS_HAVE_INT32)
+#define NVT_COMB_U64( lo, hi )      (mbedtls_mpi_uint)( lo ), (mbedtls_mpi_uint)( hi )
+#else
+#define NVT_COMB_U64( lo, hi )      ( ( (mbedtls_mpi_uint)( hi ) << 32 ) | (mbedtls_mpi_uint)( lo ) )
+#endif
+
+#define NVT_COMB_MPI( limbs )       { 1, sizeof( limbs ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) limbs }
+#define NVT_COMB_POINT( x, y )      { NVT_COMB_MPI( x ), NVT_COMB_MPI( y ), NVT_COMB_MPI( nvt_comb_one ) }
+
+typedef struct
+{
+    mbedtls_ecp_group_id     id;
+    unsigned char            t_len;     /* Number of points */
+    const mbedtls_ecp_point *T;
+} nvt_ecp_comb_rom_t;
+
+static const mbedtls_mpi_uint nvt_comb_one[] = { 1 };
+
+#include NUVOTON_ECP_COMB_ROM
+#endif /* NUVOTON_ECP_COMB_ROM */
+
+typedef struct
+{
+    mbedtls_ecp_group_id  id;
+    unsigned char         t_len;
+    mbedtls_ecp_point    *T;
+    size_t                bytes;
+    uint32_t              last_use;
+} nvt_ecp_comb_entry_t;
+
+static nvt_ecp_comb_entry_t nvt_ecp_comb_cache[ECP_NB_CURVES];
+static size_t nvt_ecp_comb_bytes;
+static uint32_t nvt_ecp_comb_clock;
+
+static void nvt_ecp_comb_free_table( mbedtls_ecp_point *T, size_t t_len )
+{
+    size_t i;
+
+    for( i = 0; i < t_len; i++ )
+        mbedtls_ecp_point_free( &T[i] );
+    mbedtls_free( T );
+}
+
+/*
+ * Table of t_len multiples of G for grp, or NULL
+ */
+static const mbedtls_ecp_point *nvt_ecp_comb_lookup( const mbedtls_ecp_group *grp,
+                                                     unsigned char t_len )
+{
+    size_t i;
+
+    if( grp->id == MBEDTLS_ECP_DP_NONE )
+        return( NULL );
+
+#if defined(NUVOTON_ECP_COMB_ROM)
+    for( i = 0; nvt_ecp_comb_rom[i].id != MBEDTLS_ECP_DP_NONE; i++ )
+    {
+        if( nvt_ecp_comb_rom[i].id == grp->id && nvt_ecp_comb_rom[i].t_len == t_len )
+        {
+            nvt_ecp_comb_stats.rom_hits++;
+            return( nvt_ecp_comb_rom[i].T );
+        }
+    }
+#endif
+
+    for( i = 0; i < ECP_NB_CURVES; i++ )
+    {
+        if( nvt_ecp_comb_cache[i].T != NULL && nvt_ecp_comb_cache[i].id == grp->id &&
+            nvt_ecp_comb_cache[i].t_len == t_len )
+        {
+            nvt_ecp_comb_cache[i].last_use = ++nvt_ecp_comb_clock;
+            nvt_ecp_comb_stats.hits++;
+            return( nvt_ecp_comb_cache[i].T );
+        }
+    }
+
+    return( NULL );
+}
+
+/*
+ * Hand a freshly built table of G over to the cache.
+ * Returns 1 if the cache owns T now, 0 if it did not fit.
+ */
+static int nvt_ecp_comb_store( const mbedtls_ecp_group *grp,
+                               mbedtls_ecp_point *T, unsigned char t_len )
+{
+    size_t i, bytes, slot, lru;
+
+    if( grp->id == MBEDTLS_ECP_DP_NONE )
+        return( 0 );
+
+    bytes = t_len * sizeof( mbedtls_ecp_point );
+    for( i = 0; i < t_len; i++ )
+        bytes += ( T[i].X.n + T[i].Y.n + T[i].Z.n ) * sizeof( mbedtls_mpi_uint );
+
+    if( bytes > NUVOTON_ECP_COMB_CACHE_SIZE )
+    {
+        nvt_ecp_comb_stats.rejects++;
+        return( 0 );
+    }
+
+    /* Free the least recently used tables until this one fits */
+    while( nvt_ecp_comb_bytes + bytes > NUVOTON_ECP_COMB_CACHE_SIZE )
+    {
+        lru = ECP_NB_CURVES;
+        for( i = 0; i < ECP_NB_CURVES; i++ )
+        {
+            if( nvt_ecp_comb_cache[i].T != NULL &&
+                ( lru == ECP_NB_CURVES ||
+                  nvt_ecp_comb_cache[i].last_use < nvt_ecp_comb_cache[lru].last_use ) )
+                lru = i;
+        }
+
+        nvt_ecp_comb_free_table( nvt_ecp_comb_cache[lru].T, nvt_ecp_comb_cache[lru].t_len );
+        nvt_ecp_comb_bytes -= nvt_ecp_comb_cache[lru].bytes;
+        nvt_ecp_comb_cache[lru].T = NULL;
+        nvt_ecp_comb_stats.evictions++;
+    }
+
+    for( slot = 0; slot < ECP_NB_CURVES && nvt_ecp_comb_cache[slot].T != NULL; slot++ )
+        ;
+    if( slot == ECP_NB_CURVES )
+        return( 0 );
+
+    nvt_ecp_comb_cache[slot].id = grp->id;
+    nvt_ecp_comb_cache[slot].t_len = t_len;
+    nvt_ecp_comb_cache[slot].T = T;
+    nvt_ecp_comb_cache[slot].bytes = bytes;
+    nvt_ecp_comb_cache[slot].last_use = ++nvt_ecp_comb_clock;
+    nvt_ecp_comb_bytes += bytes;
+
+    nvt_ecp_comb_stats.stores++;
+    nvt_ecp_comb_stats.bytes = nvt_ecp_comb_bytes;
+
+    return( 1 );
+}
+
+/*
+ * Is T one of the tables of the cache or of flash?
+ */
+static int nvt_ecp_comb_owns( const mbedtls_ecp_point *T )
+{
+    size_t i;
+
+#if defined(NUVOTON_ECP_COMB_ROM)
+    for( i = 0; nvt_ecp_comb_rom[i].id != MBEDTLS_ECP_DP_NONE; i++ )
+    {
+        if( nvt_ecp_comb_rom[i].T == T )
+            return( 1 );
+    }
+#endif
+
+    for( i = 0; i < ECP_NB_CURVES; i++ )
+    {
+        if( nvt_ecp_comb_cache[i].T == T )
+            return( 1 );
+    }
+
+    return( 0 );
+}
+
+#endif /* NVT_ECP_COMB_CACHE */
+
+nvt_ecp_comb_stats_t  nvt_ecp_comb_stats;
+
+void nvt_ecp_comb_cache_flush( void )
+{
+#if defined(NVT_ECP_COMB_CACHE)
+    size_t i;
+
+    for( i = 0; i < ECP_NB_CURVES; i++ )
+    {
+        if( nvt_ecp_comb_cache[i].T != NULL )
+        {
+            nvt_ecp_comb_free_table( nvt_ecp_comb_cache[i].T, nvt_ecp_comb_cache[i].t_len );
+            nvt_ecp_comb_cache[i].T = NULL;
+        }
+    }
+
+    nvt_ecp_comb_bytes = 0;
+    nvt_ecp_comb_stats.bytes = 0;
+#endif
+}
+
 /*
  * Multiplication using the comb method,
  * for curves in short Weierstrass form
@@ -1432,6 +1672,11 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
      */
     T = p_eq_g ? grp->T : NULL;
 
+#if defined(NVT_ECP_COMB_CACHE)
+    if( T == NULL && p_eq_g )
+        T = (mbedtls_ecp_point *) nvt_ecp_comb_lookup( grp, pre_len );
+#endif
+
     if( T == NULL )
     {
         T = mbedtls_calloc( pre_len, sizeof( mbedtls_ecp_point ) );
@@ -1445,8 +1690,13 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
 
         if( p_eq_g )
         {
-            grp->T = T;
-            grp->T_size = pre_len;
+#if defined(NVT_ECP_COMB_CACHE)
+            if( ! nvt_ecp_comb_store( grp, T, pre_len ) )
+#endif
+            {
+                grp->T = T;
+                grp->T_size = pre_len;
+            }
         }
     }
 
@@ -1476,9 +1726,13 @@ cleanup:
     /* There are two cases where T is not stored in grp:
      * - P != G
      * - An intermediate operation failed before setting grp->T
-     * In either case, T must be freed.
+     * In either case, T must be freed, unless the table cache holds it.
      */
-    if( T != NULL && T != grp->T )
+    if( T != NULL && T != grp->T
+#if defined(NVT_ECP_COMB_CACHE)
+        && ! nvt_ecp_comb_owns( T )
+#endif
+      )
     {
         for( i = 0; i < pre_len; i++ )
             mbedtls_ecp_point_free( &T[i] );
@@ -1714,24 +1968,36 @@ int mbedtls_ecp_mul( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
              const mbedtls_mpi *m, const mbedtls_ecp_point *P,
              int (*f_rng)(void *, unsigned char *, size_t), void *p_rng )
 {
+    int ret, hw_ret;
+    uint32_t  au32X[ECC_KEY_WORD_MAX], au32Y[ECC_KEY_WORD_MAX], au32K[ECC_KEY_WORD_MAX];
 	E_ECC_CURVE   ecc_curve;
 
 	ecc_curve = nuvoton_get_curve(grp->id);
 	if (ecc_curve == CURVE_UNDEF)
 	    return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
 
-    mbedtls_mpi_write_string(m, 16, tmp_1_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-    mbedtls_mpi_write_string(&P->X, 16, tmp_x_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
-    mbedtls_mpi_write_string(&P->Y, 16, tmp_y_str, MBEDTLS_ECP_MAX_PT_LEN, &tmp_len);
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( m, au32K ) );
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &P->X, au32X ) );
+    MBEDTLS_MPI_CHK( nuvoton_mpi_to_words( &P->Y, au32Y ) );
+
+    /* The curve registers and the parsed curve of crypto.c are shared */
+    CRPT_JobLock( CRPT_JOB_ECC );
+    hw_ret = ECC_MultiplyWords( CRPT, ecc_curve, au32X, au32Y, au32K, au32X, au32Y );
+    CRPT_JobUnlock( CRPT_JOB_ECC );
 
-    ECC_Mutiply(CRPT, ecc_curve, tmp_x_str, tmp_y_str, tmp_1_str, tmp_2_str, tmp_3_str);
+    if( hw_ret != 0 )
+    {
+        ret = MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+        goto cleanup;
+    }
 
-    // printf("ECC mbedtls_ecp_mul success.\n");
+    MBEDTLS_MPI_CHK( nuvoton_words_to_mpi( &R->X, au32X ) );
+    MBEDTLS_MPI_CHK( nuvoton_words_to_mpi( &R->Y, au32Y ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &R->Z, 1 ) );
 
-	mbedtls_mpi_read_string(&R->X, 16, tmp_2_str);
-	mbedtls_mpi_read_string(&R->Y, 16, tmp_3_str);
-	mbedtls_mpi_lset( &R->Z, 1);
-	return 0;
+cleanup:
+    mbedtls_platform_zeroize( au32K, sizeof( au32K ) );
+    return( ret );
 }
 #else
 
@@ -89,6 +89,12 @@ void mbedtls_entropy_init( mbedtls_entropy_context *ctx )
                                 1, MBEDTLS_ENTROPY_SOURCE_STRONG );
 #endif
 
+#if defined(NUVOTON_ENABLE_TRNG)
+    mbedtls_entropy_add_source( ctx, nvt_trng_entropy_poll, NULL,
+                                NUVOTON_ENTROPY_MIN_TRNG,
+                                MBEDTLS_ENTROPY_SOURCE_STRONG );
+#endif
+
 #if !defined(MBEDTLS_NO_DEFAULT_ENTROPY_SOURCES)
 #if !defined(MBEDTLS_NO_PLATFORM_ENTROPY)
     mbedtls_entropy_add_source( ctx, mbedtls_platform_entropy_poll, NULL,
@@ -46,6 +46,10 @@
 #if defined(MBEDTLS_ENTROPY_NV_SEED)
 #include "mbedtls/platform.h"
 #endif
+#if defined(NUVOTON_ENABLE_TRNG)
+#include "mbedtls/sha256.h"
+#include "mbedtls/platform_util.h"
+#endif
 
 #if !defined(MBEDTLS_NO_PLATFORM_ENTROPY)
 
@@ -215,6 +219,47 @@ int mbedtls_null_entropy_poll( void *data,
 }
 #endif
 
+#if defined(NUVOTON_ENABLE_TRNG)
+
+#define NVT_TRNG_RAW_LEN    64  /* Raw TRNG bytes per SHA-256 output block */
+
+int nvt_trng_entropy_poll( void *data,
+                           unsigned char *output, size_t len, size_t *olen )
+{
+    unsigned char raw[NVT_TRNG_RAW_LEN];
+    unsigned char digest[32];
+    int ret = 0;
+
+    ((void) data);
+    *olen = 0;
+
+    if( TRNG_PoolReadWait( raw, sizeof( raw ) ) != 0 )
+    {
+        ret = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+        goto exit;
+    }
+
+    /* Runs on the CRYPTO SHA engine when NUVOTON_ENABLE_SHA is defined */
+    if( ( ret = mbedtls_sha256_ret( raw, sizeof( raw ), digest, 0 ) ) != 0 )
+    {
+        ret = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+        goto exit;
+    }
+
+    if( len > sizeof( digest ) )
+        len = sizeof( digest );
+
+    memcpy( output, digest, len );
+    *olen = len;
+
+exit:
+    mbedtls_platform_zeroize( raw, sizeof( raw ) );
+    mbedtls_platform_zeroize( digest, sizeof( digest ) );
+
+    return( ret );
+}
+#endif /* NUVOTON_ENABLE_TRNG */
+
 #if defined(MBEDTLS_TIMING_C)
 
 extern int  get_ticks(void);
@@ -46,6 +46,10 @@
 #include "mbedtls/aesni.h"
 #endif
 
+#ifdef NUVOTON_ENABLE_AES
+#include "mbedtls/aes.h"
+#endif
+
 #if defined(MBEDTLS_SELF_TEST) && defined(MBEDTLS_AES_C)
 #include "mbedtls/aes.h"
 #if defined(MBEDTLS_PLATFORM_C)
@@ -81,6 +85,29 @@
 }
 #endif
 
+#ifdef NUVOTON_ENABLE_AES
+/*
+ * With an AES key, the CTR keystream of mbedtls_gcm_update() is made by the
+ * engine by DMA from a zero buffer, one keystream buffer ahead of the CPU:
+ * while the CPU applies and GHASHes one buffer, the engine fills the other.
+ * The keystream buffers are shared by all contexts and used with the AES
+ * engine held, see aes.c.
+ */
+#ifndef NUVOTON_AES_DMA_BUFF_SIZE
+#define NUVOTON_AES_DMA_BUFF_SIZE   256
+#endif
+
+#ifdef __ICCARM__
+#pragma data_alignment=4
+static uint8_t nvt_gcm_zero[NUVOTON_AES_DMA_BUFF_SIZE];
+#pragma data_alignment=4
+static uint8_t nvt_gcm_ks[2][NUVOTON_AES_DMA_BUFF_SIZE];
+#else
+static uint8_t nvt_gcm_zero[NUVOTON_AES_DMA_BUFF_SIZE] __attribute__((aligned (4)));
+static uint8_t nvt_gcm_ks[2][NUVOTON_AES_DMA_BUFF_SIZE] __attribute__((aligned (4)));
+#endif
+#endif /* NUVOTON_ENABLE_AES */
+
 /*
  * Initialize a context
  */
@@ -154,6 +181,17 @@ static int gcm_gen_table( mbedtls_gcm_context *ctx )
         }
     }
 
+#ifdef NUVOTON_ENABLE_AES
+    /* The Cortex-M4 has no 64-bit shifts, gcm_mult() works on words */
+    for( i = 0; i < 16; i++ )
+    {
+        ctx->nvt_M[i][0] = (uint32_t)( ctx->HH[i] >> 32 );
+        ctx->nvt_M[i][1] = (uint32_t)( ctx->HH[i] );
+        ctx->nvt_M[i][2] = (uint32_t)( ctx->HL[i] >> 32 );
+        ctx->nvt_M[i][3] = (uint32_t)( ctx->HL[i] );
+    }
+#endif
+
     return( 0 );
 }
 
@@ -186,6 +224,10 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
     if( ( ret = gcm_gen_table( ctx ) ) != 0 )
         return( ret );
 
+#ifdef NUVOTON_ENABLE_AES
+    ctx->nvt_hw = ( cipher == MBEDTLS_CIPHER_ID_AES );
+#endif
+
     return( 0 );
 }
 
@@ -206,6 +248,51 @@ static const uint64_t last4[16] =
  * Sets output to x times H using the precomputed tables.
  * x and output are seen as elements of GF(2^128) as in [MGV].
  */
+#ifdef NUVOTON_ENABLE_AES
+static void gcm_mult( mbedtls_gcm_context *ctx, const unsigned char x[16],
+                      unsigned char output[16] )
+{
+    int i;
+    uint32_t lo, hi, rem;
+    uint32_t z0, z1, z2, z3;
+    const uint32_t *m;
+
+    lo = x[15] & 0xf;
+
+    m = ctx->nvt_M[lo];
+    z0 = m[0]; z1 = m[1]; z2 = m[2]; z3 = m[3];
+
+    for( i = 15; i >= 0; i-- )
+    {
+        lo = x[i] & 0xf;
+        hi = x[i] >> 4;
+
+        if( i != 15 )
+        {
+            rem = z3 & 0xf;
+            z3 = ( z2 << 28 ) | ( z3 >> 4 );
+            z2 = ( z1 << 28 ) | ( z2 >> 4 );
+            z1 = ( z0 << 28 ) | ( z1 >> 4 );
+            z0 = ( z0 >> 4 ) ^ ( (uint32_t) last4[rem] << 16 );
+            m = ctx->nvt_M[lo];
+            z0 ^= m[0]; z1 ^= m[1]; z2 ^= m[2]; z3 ^= m[3];
+        }
+
+        rem = z3 & 0xf;
+        z3 = ( z2 << 28 ) | ( z3 >> 4 );
+        z2 = ( z1 << 28 ) | ( z2 >> 4 );
+        z1 = ( z0 << 28 ) | ( z1 >> 4 );
+        z0 = ( z0 >> 4 ) ^ ( (uint32_t) last4[rem] << 16 );
+        m = ctx->nvt_M[hi];
+        z0 ^= m[0]; z1 ^= m[1]; z2 ^= m[2]; z3 ^= m[3];
+    }
+
+    PUT_UINT32_BE( z0, output, 0 );
+    PUT_UINT32_BE( z1, output, 4 );
+    PUT_UINT32_BE( z2, output, 8 );
+    PUT_UINT32_BE( z3, output, 12 );
+}
+#else
 static void gcm_mult( mbedtls_gcm_context *ctx, const unsigned char x[16],
                       unsigned char output[16] )
 {
@@ -261,6 +348,7 @@ static void gcm_mult( mbedtls_gcm_context *ctx, const unsigned char x[16],
     PUT_UINT32_BE( zl >> 32, output, 8 );
     PUT_UINT32_BE( zl, output, 12 );
 }
+#endif /* NUVOTON_ENABLE_AES */
 
 int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
                 int mode,
@@ -345,6 +433,103 @@ int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
     return( 0 );
 }
 
+#ifdef NUVOTON_ENABLE_AES
+/*
+ * Add n to the counter in the last four bytes of y, modulo 2^32.
+ */
+static void nvt_gcm_inc32( unsigned char y[16], uint32_t n )
+{
+    uint32_t c;
+
+    GET_UINT32_BE( c, y, 12 );
+    c += n;
+    PUT_UINT32_BE( c, y, 12 );
+}
+
+/*
+ * Apply len bytes of keystream to input and fold the ciphertext into the
+ * GHASH state.
+ */
+static void nvt_gcm_xor_ghash( mbedtls_gcm_context *ctx, const unsigned char *ks,
+                               const unsigned char *input, unsigned char *output,
+                               size_t len )
+{
+    size_t i, use_len;
+
+    while( len > 0 )
+    {
+        use_len = ( len < 16 ) ? len : 16;
+
+        for( i = 0; i < use_len; i++ )
+        {
+            if( ctx->mode == MBEDTLS_GCM_DECRYPT )
+                ctx->buf[i] ^= input[i];
+            output[i] = ks[i] ^ input[i];
+            if( ctx->mode == MBEDTLS_GCM_ENCRYPT )
+                ctx->buf[i] ^= output[i];
+        }
+
+        gcm_mult( ctx, ctx->buf, ctx->buf );
+
+        len    -= use_len;
+        ks     += use_len;
+        input  += use_len;
+        output += use_len;
+    }
+}
+
+static int nvt_gcm_update( mbedtls_gcm_context *ctx, size_t length,
+                           const unsigned char *input, unsigned char *output )
+{
+    int ret, cur = 0;
+    nvt_aes_stream_t st;
+    unsigned char ctr[16];
+    uint32_t blocks = (uint32_t)( ( length + 15 ) / 16 );
+    size_t n, next = 0;
+
+    memcpy( ctr, ctx->y, 16 );
+    nvt_gcm_inc32( ctr, 1 );
+
+    if( ( ret = nvt_aes_stream_start( &st, ctx->cipher_ctx.cipher_ctx, ctr ) ) != 0 )
+        return( ret );
+
+    n = ( length < NUVOTON_AES_DMA_BUFF_SIZE ) ? length : NUVOTON_AES_DMA_BUFF_SIZE;
+    if( ( ret = nvt_aes_stream_submit( &st, nvt_gcm_zero, nvt_gcm_ks[0],
+                                       ( n + 15 ) & ~15UL, n == length ) ) != 0 )
+        return( ret );
+
+    while( length > 0 )
+    {
+        if( ( ret = nvt_aes_stream_wait( &st ) ) != 0 )
+            return( ret );
+
+        if( length > n )
+        {
+            next = length - n;
+            if( next > NUVOTON_AES_DMA_BUFF_SIZE )
+                next = NUVOTON_AES_DMA_BUFF_SIZE;
+
+            if( ( ret = nvt_aes_stream_submit( &st, nvt_gcm_zero, nvt_gcm_ks[cur ^ 1],
+                                               ( next + 15 ) & ~15UL,
+                                               n + next == length ) ) != 0 )
+                return( ret );
+        }
+
+        nvt_gcm_xor_ghash( ctx, nvt_gcm_ks[cur], input, output, n );
+
+        input  += n;
+        output += n;
+        length -= n;
+        n = next;
+        cur ^= 1;
+    }
+
+    nvt_gcm_inc32( ctx->y, blocks );
+
+    return( 0 );
+}
+#endif /* NUVOTON_ENABLE_AES */
+
 int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
                 size_t length,
                 const unsigned char *input,
@@ -370,6 +555,23 @@ int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
 
     ctx->len += length;
 
+#ifdef NUVOTON_ENABLE_AES
+    /* The engine counts through all 128 bits, GCM only through the last 32 */
+    if( ctx->nvt_hw && length > 0 )
+    {
+        uint32_t c;
+
+        GET_UINT32_BE( c, ctx->y, 12 );
+        if( (uint64_t) c + ( length + 15 ) / 16 <= 0xFFFFFFFFUL )
+        {
+            CRPT_JobLock( CRPT_JOB_AES );
+            ret = nvt_gcm_update( ctx, length, input, output );
+            CRPT_JobUnlock( CRPT_JOB_AES );
+            return( ret );
+        }
+    }
+#endif
+
     p = input;
     while( length > 0 )
     {
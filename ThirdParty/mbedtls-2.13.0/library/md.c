@@ -49,6 +49,45 @@
 #include <stdio.h>
 #endif
 
+#ifdef NUVOTON_ENABLE_SHA
+#include "mbedtls/sha256.h"
+
+#ifndef NUVOTON_SHA_HMAC_BUFF_SIZE
+#define NUVOTON_SHA_HMAC_BUFF_SIZE  256
+#endif
+
+#if ( NUVOTON_SHA_HMAC_BUFF_SIZE % 4 )
+#error "NUVOTON_SHA_HMAC_BUFF_SIZE must be a multiple of 4"
+#endif
+
+/*
+ * HMAC on the CRPT engine. The engine takes the key followed by the
+ * message in one DMA stream and runs the inner and outer hash itself, so
+ * the message is collected behind the key and the MAC is computed in
+ * mbedtls_md_hmac_finish(). A message that outgrows the buffer, or a hash
+ * the engine does not run, goes through the software ipad/opad path, and so
+ * does a MAC finished while another hash streams through the engine. The
+ * short messages of PBKDF2, HKDF and the TLS PRF all fit.
+ *
+ * The state lives in hmac_ctx behind the ipad and opad blocks.
+ */
+typedef struct
+{
+    int       hw;             /* the MAC is still computed by the engine */
+    uint32_t  mode;           /* SHA_MODE_xxx */
+    uint32_t  keylen;         /* key bytes at the start of buf, 0 if no engine */
+    uint32_t  len;            /* bytes in buf, key padded to a word */
+    uint32_t  buf[( 128 + NUVOTON_SHA_HMAC_BUFF_SIZE ) / 4];    /* key, at most one block, then message */
+} nvt_hmac_context;
+
+#define MD_HMAC_CTX_SIZE( info )  ( 2 * (info)->block_size + sizeof( nvt_hmac_context ) )
+#define NVT_HMAC_CTX( ctx )       ( (nvt_hmac_context *) ( (unsigned char *) (ctx)->hmac_ctx + \
+                                                           2 * (ctx)->md_info->block_size ) )
+#define NVT_HMAC_KEY_ROOM( n )    ( ( (n) + 3 ) & ~3UL )
+#else
+#define MD_HMAC_CTX_SIZE( info )  ( 2 * (info)->block_size )
+#endif
+
 /*
  * Reminder: update profiles in x509_crt.c when adding a new hash!
  */
@@ -190,7 +229,7 @@ void mbedtls_md_free( mbedtls_md_context_t *ctx )
     if( ctx->hmac_ctx != NULL )
     {
         mbedtls_platform_zeroize( ctx->hmac_ctx,
-                                  2 * ctx->md_info->block_size );
+                                  MD_HMAC_CTX_SIZE( ctx->md_info ) );
         mbedtls_free( ctx->hmac_ctx );
     }
 
@@ -229,7 +268,7 @@ int mbedtls_md_setup( mbedtls_md_context_t *ctx, const mbedtls_md_info_t *md_inf
 
     if( hmac != 0 )
     {
-        ctx->hmac_ctx = mbedtls_calloc( 2, md_info->block_size );
+        ctx->hmac_ctx = mbedtls_calloc( 1, MD_HMAC_CTX_SIZE( md_info ) );
         if( ctx->hmac_ctx == NULL )
         {
             md_info->ctx_free_func( ctx->md_ctx );
@@ -316,6 +355,88 @@ cleanup:
 }
 #endif /* MBEDTLS_FS_IO */
 
+#ifdef NUVOTON_ENABLE_SHA
+static uint32_t nvt_hmac_mode( mbedtls_md_type_t md_type )
+{
+    uint32_t mode;
+
+    switch( md_type )
+    {
+        case MBEDTLS_MD_SHA1:   mode = SHA_MODE_SHA1;   break;
+        case MBEDTLS_MD_SHA224: mode = SHA_MODE_SHA224; break;
+        case MBEDTLS_MD_SHA256: mode = SHA_MODE_SHA256; break;
+        case MBEDTLS_MD_SHA384: mode = SHA_MODE_SHA384; break;
+        case MBEDTLS_MD_SHA512: mode = SHA_MODE_SHA512; break;
+        default:
+            return( (uint32_t) -1 );
+    }
+
+    /* M480LD only runs HMAC-SHA-256 */
+    if( ( SYS->CSERVER & SYS_CSERVER_VERSION_Msk ) != 0 && mode != SHA_MODE_SHA256 )
+        return( (uint32_t) -1 );
+
+    return( mode );
+}
+
+/*
+ * Leave the engine: run the software construction over what has been
+ * collected so far.
+ */
+static int nvt_hmac_to_software( mbedtls_md_context_t *ctx )
+{
+    int ret;
+    nvt_hmac_context *nvt = NVT_HMAC_CTX( ctx );
+    uint32_t off = NVT_HMAC_KEY_ROOM( nvt->keylen );
+
+    nvt->hw = 0;
+
+    if( ( ret = ctx->md_info->starts_func( ctx->md_ctx ) ) != 0 )
+        return( ret );
+    if( ( ret = ctx->md_info->update_func( ctx->md_ctx, ctx->hmac_ctx,
+                                           ctx->md_info->block_size ) ) != 0 )
+        return( ret );
+    return( ctx->md_info->update_func( ctx->md_ctx,
+                                       (unsigned char *) nvt->buf + off,
+                                       nvt->len - off ) );
+}
+
+/*
+ * Key and message in one transfer. The caller has claimed the engine.
+ */
+static int nvt_hmac_finish( mbedtls_md_context_t *ctx, unsigned char *output )
+{
+    nvt_hmac_context *nvt = NVT_HMAC_CTX( ctx );
+    uint32_t digest[16];
+    int i, ret = 0;
+
+    CRPT_JobLock( CRPT_JOB_SHA );
+
+    SHA_Open( CRPT, nvt->mode, SHA_IN_SWAP, nvt->keylen );
+    if( nvt_sha_feed( (unsigned char *) nvt->buf, nvt->len, 1 ) != 0 )
+        ret = MBEDTLS_ERR_MD_HW_ACCEL_FAILED;
+    else
+        SHA_Read( CRPT, digest );
+    nvt_sha_release( ctx );
+
+    CRPT_JobUnlock( CRPT_JOB_SHA );
+
+    if( ret == 0 )
+    {
+        for( i = 0; i < ctx->md_info->size / 4; i++ )
+        {
+            output[4 * i    ] = (unsigned char)( digest[i] >> 24 );
+            output[4 * i + 1] = (unsigned char)( digest[i] >> 16 );
+            output[4 * i + 2] = (unsigned char)( digest[i] >>  8 );
+            output[4 * i + 3] = (unsigned char)( digest[i]       );
+        }
+    }
+    mbedtls_platform_zeroize( digest, sizeof( digest ) );
+
+    nvt->len = NVT_HMAC_KEY_ROOM( nvt->keylen );
+    return( ret );
+}
+#endif /* NUVOTON_ENABLE_SHA */
+
 int mbedtls_md_hmac_starts( mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen )
 {
     int ret;
@@ -351,6 +472,26 @@ int mbedtls_md_hmac_starts( mbedtls_md_context_t *ctx, const unsigned char *key,
         opad[i] = (unsigned char)( opad[i] ^ key[i] );
     }
 
+#ifdef NUVOTON_ENABLE_SHA
+    {
+        nvt_hmac_context *nvt = NVT_HMAC_CTX( ctx );
+
+        /* The engine does not take an empty key */
+        nvt->mode = nvt_hmac_mode( ctx->md_info->type );
+        nvt->keylen = ( nvt->mode != (uint32_t) -1 ) ? keylen : 0;
+
+        if( nvt->keylen != 0 )
+        {
+            memcpy( nvt->buf, key, keylen );
+            nvt->len = NVT_HMAC_KEY_ROOM( keylen );
+            nvt->hw = 1;
+            ret = 0;
+            goto cleanup;
+        }
+        nvt->hw = 0;
+    }
+#endif
+
     if( ( ret = ctx->md_info->starts_func( ctx->md_ctx ) ) != 0 )
         goto cleanup;
     if( ( ret = ctx->md_info->update_func( ctx->md_ctx, ipad,
@@ -368,6 +509,26 @@ int mbedtls_md_hmac_update( mbedtls_md_context_t *ctx, const unsigned char *inpu
     if( ctx == NULL || ctx->md_info == NULL || ctx->hmac_ctx == NULL )
         return( MBEDTLS_ERR_MD_BAD_INPUT_DATA );
 
+#ifdef NUVOTON_ENABLE_SHA
+    {
+        nvt_hmac_context *nvt = NVT_HMAC_CTX( ctx );
+        int ret;
+
+        if( nvt->hw )
+        {
+            if( ilen <= sizeof( nvt->buf ) - nvt->len )
+            {
+                memcpy( (unsigned char *) nvt->buf + nvt->len, input, ilen );
+                nvt->len += ilen;
+                return( 0 );
+            }
+
+            if( ( ret = nvt_hmac_to_software( ctx ) ) != 0 )
+                return( ret );
+        }
+    }
+#endif
+
     return( ctx->md_info->update_func( ctx->md_ctx, input, ilen ) );
 }
 
@@ -382,6 +543,18 @@ int mbedtls_md_hmac_finish( mbedtls_md_context_t *ctx, unsigned char *output )
 
     opad = (unsigned char *) ctx->hmac_ctx + ctx->md_info->block_size;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( NVT_HMAC_CTX( ctx )->hw )
+    {
+        /* A hash streaming through the engine keeps it, the MAC is then
+         * computed in software */
+        if( nvt_sha_claim( ctx, NVT_HMAC_CTX( ctx )->mode ) )
+            return( nvt_hmac_finish( ctx, output ) );
+        if( ( ret = nvt_hmac_to_software( ctx ) ) != 0 )
+            return( ret );
+    }
+#endif
+
     if( ( ret = ctx->md_info->finish_func( ctx->md_ctx, tmp ) ) != 0 )
         return( ret );
     if( ( ret = ctx->md_info->starts_func( ctx->md_ctx ) ) != 0 )
@@ -405,6 +578,19 @@ int mbedtls_md_hmac_reset( mbedtls_md_context_t *ctx )
 
     ipad = (unsigned char *) ctx->hmac_ctx;
 
+#ifdef NUVOTON_ENABLE_SHA
+    {
+        nvt_hmac_context *nvt = NVT_HMAC_CTX( ctx );
+
+        if( nvt->keylen != 0 )
+        {
+            nvt->len = NVT_HMAC_KEY_ROOM( nvt->keylen );
+            nvt->hw = 1;
+            return( 0 );
+        }
+    }
+#endif
+
     if( ( ret = ctx->md_info->starts_func( ctx->md_ctx ) ) != 0 )
         return( ret );
     return( ctx->md_info->update_func( ctx->md_ctx, ipad,
@@ -35,6 +35,13 @@
 #include "mbedtls/sha1.h"
 #include "mbedtls/platform_util.h"
 
+#ifdef NUVOTON_ENABLE_SHA
+#if !defined(MBEDTLS_SHA256_C)
+#error "NUVOTON_ENABLE_SHA needs MBEDTLS_SHA256_C, which shares the SHA engine"
+#endif
+#include "mbedtls/sha256.h"
+#endif
+
 #include <string.h>
 
 #if defined(MBEDTLS_SELF_TEST)
@@ -71,6 +78,91 @@
 }
 #endif
 
+#ifdef NUVOTON_ENABLE_SHA
+/*
+ * Streaming through the shared SHA engine, see nvt_sha_claim() in sha256.c.
+ * While a context owns the engine, ctx->buffer holds the 1..64 bytes not
+ * yet sent to it.
+ */
+static uint32_t nvt_sha1_held( const mbedtls_sha1_context *ctx )
+{
+    if( ctx->total[0] == 0 && ctx->total[1] == 0 )
+        return( 0 );
+
+    return( ( ( ctx->total[0] - 1 ) & 0x3F ) + 1 );
+}
+
+/*
+ * The engine failed a transfer and the state of the message is lost with
+ * it: give the engine up, the hash has to be started again.
+ */
+static int nvt_sha1_fail( mbedtls_sha1_context *ctx )
+{
+    nvt_sha_release( ctx );
+    ctx->nvt_hw = 0;
+    return( MBEDTLS_ERR_SHA1_HW_ACCEL_FAILED );
+}
+
+static int nvt_sha1_update( mbedtls_sha1_context *ctx, uint32_t held,
+                             const unsigned char *input, size_t ilen )
+{
+    size_t fill, n;
+
+    fill = 64 - held;
+    if( fill > ilen )
+        fill = ilen;
+
+    memcpy( ctx->buffer + held, input, fill );
+    input += fill;
+    ilen  -= fill;
+
+    if( ilen == 0 )
+        return( 0 );
+
+    if( nvt_sha_feed( ctx->buffer, 64, 0 ) != 0 )
+        return( nvt_sha1_fail( ctx ) );
+
+    n = ( ( ilen - 1 ) / 64 ) * 64;
+    if( n > 0 && ( (uint32_t)input & 0x3 ) == 0 )
+    {
+        if( nvt_sha_feed( input, n, 0 ) != 0 )
+            return( nvt_sha1_fail( ctx ) );
+        input += n;
+        ilen  -= n;
+    }
+
+    while( ilen > 64 )
+    {
+        memcpy( ctx->buffer, input, 64 );
+        if( nvt_sha_feed( ctx->buffer, 64, 0 ) != 0 )
+            return( nvt_sha1_fail( ctx ) );
+        input += 64;
+        ilen  -= 64;
+    }
+
+    memcpy( ctx->buffer, input, ilen );
+    return( 0 );
+}
+
+static void nvt_sha1_detach( void *p )
+{
+    mbedtls_sha1_context *ctx = (mbedtls_sha1_context *) p;
+    uint32_t held;
+
+    if( !ctx->nvt_hw )
+        return;
+
+    held = nvt_sha1_held( ctx );
+
+    nvt_sha_read_state( ctx->state, 5 );
+    nvt_sha_release( ctx );
+    ctx->nvt_hw = 0;
+
+    if( held == 64 )
+        mbedtls_internal_sha1_process( ctx, ctx->buffer );
+}
+#endif /* NUVOTON_ENABLE_SHA */
+
 void mbedtls_sha1_init( mbedtls_sha1_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_sha1_context ) );
@@ -81,12 +173,21 @@ void mbedtls_sha1_free( mbedtls_sha1_context *ctx )
     if( ctx == NULL )
         return;
 
+#ifdef NUVOTON_ENABLE_SHA
+    nvt_sha_release( ctx );
+#endif
+
     mbedtls_platform_zeroize( ctx, sizeof( mbedtls_sha1_context ) );
 }
 
 void mbedtls_sha1_clone( mbedtls_sha1_context *dst,
                          const mbedtls_sha1_context *src )
 {
+#ifdef NUVOTON_ENABLE_SHA
+    /* The engine state cannot be duplicated, both copies go on in software */
+    nvt_sha1_detach( (mbedtls_sha1_context *) src );
+#endif
+
     *dst = *src;
 }
 
@@ -95,6 +196,10 @@ void mbedtls_sha1_clone( mbedtls_sha1_context *dst,
  */
 int mbedtls_sha1_starts_ret( mbedtls_sha1_context *ctx )
 {
+#ifdef NUVOTON_ENABLE_SHA
+    ctx->nvt_hw = nvt_sha_claim( ctx, SHA_MODE_SHA1 );
+#endif
+
     ctx->total[0] = 0;
     ctx->total[1] = 0;
 
@@ -300,12 +405,22 @@ int mbedtls_sha1_update_ret( mbedtls_sha1_context *ctx,
     left = ctx->total[0] & 0x3F;
     fill = 64 - left;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+        left = nvt_sha1_held( ctx );
+#endif
+
     ctx->total[0] += (uint32_t) ilen;
     ctx->total[0] &= 0xFFFFFFFF;
 
     if( ctx->total[0] < (uint32_t) ilen )
         ctx->total[1]++;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+        return( nvt_sha1_update( ctx, left, input, ilen ) );
+#endif
+
     if( left && ilen >= fill )
     {
         memcpy( (void *) (ctx->buffer + left), input, fill );
@@ -352,6 +467,31 @@ int mbedtls_sha1_finish_ret( mbedtls_sha1_context *ctx,
     uint32_t used;
     uint32_t high, low;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+    {
+        uint32_t  digest[5];
+        int       i;
+
+        used = nvt_sha1_held( ctx );
+        if( used > 0 )
+        {
+            if( nvt_sha_feed( ctx->buffer, used, 1 ) != 0 )
+                return( nvt_sha1_fail( ctx ) );
+            SHA_Read( CRPT, digest );
+            nvt_sha_release( ctx );
+            ctx->nvt_hw = 0;
+
+            for( i = 0; i < 5; i++ )
+                PUT_UINT32_BE( digest[i], output, i << 2 );
+
+            return( 0 );
+        }
+
+        nvt_sha1_detach( ctx );
+    }
+#endif
+
     /*
      * Add padding: 0x80 then 0x00 until 8 bytes remain for the length
      */
@@ -437,59 +577,12 @@ exit:
     return( ret );
 }
 
-#ifdef NUVOTON_ENABLE_SHA
-static void mbedtls_sha1_nuvoton( const unsigned char *input, size_t ilen, unsigned char output[20] )
-{
-    int        i;
-    uint8_t    remain[4] = {0,0,0,0};
-    uint32_t   *digest = (uint32_t *)&CRPT->HMAC_DGST[0];
-
-	g_Crypto_Int_done = 0;
-
-	CRPT->HMAC_DMACNT = ilen;
-    CRPT->HMAC_CTL = (SHA_MODE_SHA1 << CRPT_HMAC_CTL_OPMODE_Pos) | CRPT_HMAC_CTL_START_Msk;
-    for ( ; ilen>=4; input+=4, ilen-=4)
-    {
-    	while (!(CRPT->HMAC_STS & CRPT_HMAC_STS_DATINREQ_Msk));
-    	
-    	if (ilen == 4)
-    		CRPT->HMAC_CTL |= CRPT_HMAC_CTL_DMALAST_Msk | CRPT_HMAC_CTL_START_Msk;
-    	
-    	CRPT->HMAC_DATIN = (input[0]<<24) | (input[1]<<16) | (input[2]<<8) | input[3];
-	}
-	if (ilen > 0)
-	{
-		memcpy(remain, input, ilen);
-		while (!(CRPT->HMAC_STS & CRPT_HMAC_STS_DATINREQ_Msk));
-		CRPT->HMAC_CTL |= CRPT_HMAC_CTL_DMALAST_Msk | CRPT_HMAC_CTL_START_Msk;
-		CRPT->HMAC_DATIN = (remain[0]<<24) | (remain[1]<<16) | (remain[2]<<8) | remain[3];
-	} 
-	
-	while (g_Crypto_Int_done == 0);
-	
-	for (i = 0; i < 5; i++, output+=4, digest++)
-	{
-		output[0] = (*digest>>24) & 0xff;
-		output[1] = (*digest>>16) & 0xff;
-		output[2] = (*digest>>8) & 0xff;
-		output[3] = *digest & 0xff;
-	}
-}
-#endif
-
 
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
 void mbedtls_sha1( const unsigned char *input,
                    size_t ilen,
                    unsigned char output[20] )
 {
-#ifdef NUVOTON_ENABLE_SHA
-	if (ilen > 0)
-	{
-		mbedtls_sha1_nuvoton(input, ilen, output);
-		return;
-	}	
-#endif    
     mbedtls_sha1_ret( input, ilen, output );
 }
 #endif
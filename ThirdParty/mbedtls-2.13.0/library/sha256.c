@@ -74,6 +74,231 @@ do {                                                    \
 } while( 0 )
 #endif
 
+#ifdef NUVOTON_ENABLE_SHA
+/*
+ * The M480 SHA engine cannot be loaded with an intermediate state, so a
+ * message can only be hashed in hardware if it is streamed through the
+ * engine from the first byte to the last. The first context to start
+ * while the engine is free owns it until finish or free; contexts started
+ * meanwhile hash in software.
+ *
+ * Data reaches the engine by DMA: one cascade is opened with
+ * CRYPTO_DMA_FIRST and closed with CRYPTO_DMA_LAST. The owner always holds
+ * its last (possibly full) block back, so the closing transfer is never
+ * empty.
+ *
+ * A context that has to leave the engine early (it is cloned, e.g. for the
+ * TLS Finished message) takes the running state from HMAC_DGST and carries
+ * on in software.
+ *
+ * Between calls the engine belongs to nvt_sha_owner. The functions below
+ * hold the SHA engine with CRPT_JobLock() while they change the owner or
+ * write the registers, so tasks of an RTOS that installed a lock with
+ * CRPT_JobSetLock() can start hashes at the same time: one of them gets the
+ * engine, the others hash in software.
+ */
+void *nvt_sha_owner;            /* context streaming through the engine */
+static int nvt_sha_started;     /* owner has an open DMA cascade */
+
+int nvt_sha_claim( void *ctx, uint32_t u32OpMode )
+{
+    CRPT_JobLock( CRPT_JOB_SHA );
+
+    if( nvt_sha_owner != NULL && nvt_sha_owner != ctx )
+    {
+        CRPT_JobUnlock( CRPT_JOB_SHA );
+        return( 0 );
+    }
+
+    if( nvt_sha_started )
+        CRPT->HMAC_CTL |= CRPT_HMAC_CTL_STOP_Msk;
+
+    nvt_sha_owner = ctx;
+    nvt_sha_started = 0;
+    SHA_Open( CRPT, u32OpMode, SHA_IN_SWAP, 0 );
+
+    CRPT_JobUnlock( CRPT_JOB_SHA );
+    return( 1 );
+}
+
+void nvt_sha_release( void *ctx )
+{
+    CRPT_JobLock( CRPT_JOB_SHA );
+
+    if( nvt_sha_owner == ctx )
+    {
+        if( nvt_sha_started )
+            CRPT->HMAC_CTL |= CRPT_HMAC_CTL_STOP_Msk;
+
+        nvt_sha_started = 0;
+        nvt_sha_owner = NULL;
+    }
+
+    CRPT_JobUnlock( CRPT_JOB_SHA );
+}
+
+/*
+ * Send len bytes at the word aligned address data. All but the last
+ * transfer of a message must be a multiple of the block size. Returns 0,
+ * or -1 if the engine reported an error; the owner then has to release
+ * the engine, its state is lost.
+ */
+int nvt_sha_feed( const unsigned char *data, size_t len, int last )
+{
+    uint32_t  u32DMAMode;
+    int       ret = 0;
+
+    CRPT_JobLock( CRPT_JOB_SHA );
+
+    if( nvt_sha_started )
+        u32DMAMode = last ? CRYPTO_DMA_LAST : CRYPTO_DMA_CONTINUE;
+    else
+        u32DMAMode = last ? CRYPTO_DMA_ONE_SHOT : CRYPTO_DMA_FIRST;
+
+    if( last )
+    {
+        /* The final transfer is the one worth sleeping on: it goes through
+         * the CRPT job queue, the intermediate ones are polled */
+        CRPT_JOB_REG_T  regs[3];
+        CRPT_JOB_T      job;
+
+        regs[0].pu32Reg = &CRPT->HMAC_SADDR;
+        regs[0].u32Val  = (uint32_t)data;
+        regs[1].pu32Reg = &CRPT->HMAC_DMACNT;
+        regs[1].u32Val  = len;
+        regs[2].pu32Reg = &CRPT->HMAC_CTL;
+        regs[2].u32Val  = ( CRPT->HMAC_CTL & ~( 0x7UL << CRPT_HMAC_CTL_DMALAST_Pos ) ) |
+                          CRPT_HMAC_CTL_START_Msk | ( u32DMAMode << CRPT_HMAC_CTL_DMALAST_Pos );
+
+        memset( &job, 0, sizeof( job ) );
+        job.u32Engine = CRPT_JOB_SHA;
+        job.pRegs     = regs;
+        job.u32RegCnt = 3;
+
+        nvt_sha_started = 0;
+        if( CRPT_JobRun( CRPT, &job ) != CRPT_JOB_DONE )
+            ret = -1;
+    }
+    else
+    {
+        SHA_SetDMATransfer( CRPT, (uint32_t)data, len );
+        SHA_Start( CRPT, u32DMAMode );
+        while( CRPT->HMAC_STS & CRPT_HMAC_STS_DMABUSY_Msk );
+        nvt_sha_started = 1;
+        if( CRPT->HMAC_STS & CRPT_HMAC_STS_DMAERR_Msk )
+            ret = -1;
+    }
+
+    CRPT_JobUnlock( CRPT_JOB_SHA );
+    return( ret );
+}
+
+/*
+ * Read wcnt words of the running state of an open cascade. SHA_Read() is
+ * not used as it stops at the digest size of SHA-224/384. Returns 0 if
+ * nothing has been sent to the engine yet.
+ */
+int nvt_sha_read_state( uint32_t au32State[], int wcnt )
+{
+    int   i;
+
+    if( !nvt_sha_started )
+        return( 0 );
+
+    for( i = 0; i < wcnt; i++ )
+        au32State[i] = CRPT->HMAC_DGST[i];
+    return( 1 );
+}
+
+/*
+ * Number of bytes in ctx->buffer that the engine has not seen: 1..64, or
+ * 0 before the first update.
+ */
+static uint32_t nvt_sha256_held( const mbedtls_sha256_context *ctx )
+{
+    if( ctx->total[0] == 0 && ctx->total[1] == 0 )
+        return( 0 );
+
+    return( ( ( ctx->total[0] - 1 ) & 0x3F ) + 1 );
+}
+
+/*
+ * The engine failed a transfer and the state of the message is lost with
+ * it: give the engine up, the hash has to be started again.
+ */
+static int nvt_sha256_fail( mbedtls_sha256_context *ctx )
+{
+    nvt_sha_release( ctx );
+    ctx->nvt_hw = 0;
+    return( MBEDTLS_ERR_SHA256_HW_ACCEL_FAILED );
+}
+
+static int nvt_sha256_update( mbedtls_sha256_context *ctx, uint32_t held,
+                               const unsigned char *input, size_t ilen )
+{
+    size_t fill, n;
+
+    fill = 64 - held;
+    if( fill > ilen )
+        fill = ilen;
+
+    memcpy( ctx->buffer + held, input, fill );
+    input += fill;
+    ilen  -= fill;
+
+    if( ilen == 0 )
+        return( 0 );
+
+    /* More data follows, so the held block can go */
+    if( nvt_sha_feed( ctx->buffer, 64, 0 ) != 0 )
+        return( nvt_sha256_fail( ctx ) );
+
+    /* Whole blocks straight from the caller when the DMA can read them,
+     * otherwise through ctx->buffer; the last 1..64 bytes are held again */
+    n = ( ( ilen - 1 ) / 64 ) * 64;
+    if( n > 0 && ( (uint32_t)input & 0x3 ) == 0 )
+    {
+        if( nvt_sha_feed( input, n, 0 ) != 0 )
+            return( nvt_sha256_fail( ctx ) );
+        input += n;
+        ilen  -= n;
+    }
+
+    while( ilen > 64 )
+    {
+        memcpy( ctx->buffer, input, 64 );
+        if( nvt_sha_feed( ctx->buffer, 64, 0 ) != 0 )
+            return( nvt_sha256_fail( ctx ) );
+        input += 64;
+        ilen  -= 64;
+    }
+
+    memcpy( ctx->buffer, input, ilen );
+    return( 0 );
+}
+
+/*
+ * Move a context off the engine and continue the same hash in software.
+ */
+static void nvt_sha256_detach( void *p )
+{
+    mbedtls_sha256_context *ctx = (mbedtls_sha256_context *) p;
+    uint32_t held;
+
+    if( !ctx->nvt_hw )
+        return;
+
+    held = nvt_sha256_held( ctx );
+
+    nvt_sha_read_state( ctx->state, 8 );
+    nvt_sha_release( ctx );
+    ctx->nvt_hw = 0;
+
+    if( held == 64 )
+        mbedtls_internal_sha256_process( ctx, ctx->buffer );
+}
+#endif /* NUVOTON_ENABLE_SHA */
+
 void mbedtls_sha256_init( mbedtls_sha256_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_sha256_context ) );
@@ -84,12 +309,21 @@ void mbedtls_sha256_free( mbedtls_sha256_context *ctx )
     if( ctx == NULL )
         return;
 
+#ifdef NUVOTON_ENABLE_SHA
+    nvt_sha_release( ctx );
+#endif
+
     mbedtls_platform_zeroize( ctx, sizeof( mbedtls_sha256_context ) );
 }
 
 void mbedtls_sha256_clone( mbedtls_sha256_context *dst,
                            const mbedtls_sha256_context *src )
 {
+#ifdef NUVOTON_ENABLE_SHA
+    /* The engine state cannot be duplicated, both copies go on in software */
+    nvt_sha256_detach( (mbedtls_sha256_context *) src );
+#endif
+
     *dst = *src;
 }
 
@@ -98,6 +332,10 @@ void mbedtls_sha256_clone( mbedtls_sha256_context *dst,
  */
 int mbedtls_sha256_starts_ret( mbedtls_sha256_context *ctx, int is224 )
 {
+#ifdef NUVOTON_ENABLE_SHA
+    ctx->nvt_hw = nvt_sha_claim( ctx, is224 ? SHA_MODE_SHA224 : SHA_MODE_SHA256 );
+#endif
+
     ctx->total[0] = 0;
     ctx->total[1] = 0;
 
@@ -269,12 +507,22 @@ int mbedtls_sha256_update_ret( mbedtls_sha256_context *ctx,
     left = ctx->total[0] & 0x3F;
     fill = 64 - left;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+        left = nvt_sha256_held( ctx );
+#endif
+
     ctx->total[0] += (uint32_t) ilen;
     ctx->total[0] &= 0xFFFFFFFF;
 
     if( ctx->total[0] < (uint32_t) ilen )
         ctx->total[1]++;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+        return( nvt_sha256_update( ctx, left, input, ilen ) );
+#endif
+
     if( left && ilen >= fill )
     {
         memcpy( (void *) (ctx->buffer + left), input, fill );
@@ -321,6 +569,33 @@ int mbedtls_sha256_finish_ret( mbedtls_sha256_context *ctx,
     uint32_t used;
     uint32_t high, low;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+    {
+        uint32_t  digest[8];
+        int       i;
+
+        used = nvt_sha256_held( ctx );
+        if( used > 0 )
+        {
+            /* The engine adds the padding itself */
+            if( nvt_sha_feed( ctx->buffer, used, 1 ) != 0 )
+                return( nvt_sha256_fail( ctx ) );
+            SHA_Read( CRPT, digest );
+            nvt_sha_release( ctx );
+            ctx->nvt_hw = 0;
+
+            for( i = 0; i < ( ctx->is224 ? 7 : 8 ); i++ )
+                PUT_UINT32_BE( digest[i], output, i << 2 );
+
+            return( 0 );
+        }
+
+        /* Empty message, nothing was sent to the engine */
+        nvt_sha256_detach( ctx );
+    }
+#endif
+
     /*
      * Add padding: 0x80 then 0x00 until 8 bytes remain for the length
      */
@@ -412,71 +687,12 @@ exit:
     return( ret );
 }
 
-#ifdef NUVOTON_ENABLE_SHA
-static void mbedtls_sha256_nuvoton( const unsigned char *input, size_t ilen,
-             unsigned char output[32], int is224 )
-{
-    int        i, wcnt;
-    uint8_t    remain[4] = {0,0,0,0};
-    uint32_t   *digest = (uint32_t *)&CRPT->HMAC_DGST[0];
-    
-    g_Crypto_Int_done = 0;
-    
-	CRPT->HMAC_DMACNT = ilen;
-	if (is224)
-	{
-    	CRPT->HMAC_CTL = (SHA_MODE_SHA224 << CRPT_HMAC_CTL_OPMODE_Pos) | CRPT_HMAC_CTL_START_Msk;
-    	wcnt = 7;
-    }
-	else
-	{    	
-		CRPT->HMAC_CTL = (SHA_MODE_SHA256 << CRPT_HMAC_CTL_OPMODE_Pos) | CRPT_HMAC_CTL_START_Msk;
-		wcnt = 8;
-	}
-    
-    for ( ; ilen>=4; input+=4, ilen-=4)
-    {
-    	while (!(CRPT->HMAC_STS & CRPT_HMAC_STS_DATINREQ_Msk));
-    	
-    	if (ilen == 4)
-    		CRPT->HMAC_CTL |= CRPT_HMAC_CTL_DMALAST_Msk | CRPT_HMAC_CTL_START_Msk;
-    	
-    	CRPT->HMAC_DATIN = (input[0]<<24) | (input[1]<<16) | (input[2]<<8) | input[3];
-	}
-	if (ilen > 0)
-	{
-		memcpy(remain, input, ilen);
-		while (!(CRPT->HMAC_STS & CRPT_HMAC_STS_DATINREQ_Msk));
-		CRPT->HMAC_CTL |= CRPT_HMAC_CTL_DMALAST_Msk | CRPT_HMAC_CTL_START_Msk;
-		CRPT->HMAC_DATIN = (remain[0]<<24) | (remain[1]<<16) | (remain[2]<<8) | remain[3];
-	} 
-	
-	while (g_Crypto_Int_done == 0);
-	
-	for (i = 0; i < wcnt; i++, output+=4, digest++)
-	{
-		output[0] = (*digest>>24) & 0xff;
-		output[1] = (*digest>>16) & 0xff;
-		output[2] = (*digest>>8) & 0xff;
-		output[3] = *digest & 0xff;
-	}
-}
-#endif
-
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
 void mbedtls_sha256( const unsigned char *input,
                      size_t ilen,
                      unsigned char output[32],
                      int is224 )
 {
-#ifdef NUVOTON_ENABLE_SHA
-	if (ilen > 0)
-	{
-		mbedtls_sha256_nuvoton(input, ilen, output, is224);
-		return;
-	}	
-#endif    
-
     mbedtls_sha256_ret( input, ilen, output, is224 );
 }
 #endif
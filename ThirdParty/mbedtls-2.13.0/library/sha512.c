@@ -35,6 +35,13 @@
 #include "mbedtls/sha512.h"
 #include "mbedtls/platform_util.h"
 
+#ifdef NUVOTON_ENABLE_SHA
+#if !defined(MBEDTLS_SHA256_C)
+#error "NUVOTON_ENABLE_SHA needs MBEDTLS_SHA256_C, which shares the SHA engine"
+#endif
+#include "mbedtls/sha256.h"
+#endif
+
 #if defined(_MSC_VER) || defined(__WATCOMC__)
   #define UL64(x) x##ui64
 #else
@@ -88,6 +95,97 @@
 }
 #endif /* PUT_UINT64_BE */
 
+#ifdef NUVOTON_ENABLE_SHA
+/*
+ * Streaming through the shared SHA engine, see nvt_sha_claim() in sha256.c.
+ * While a context owns the engine, ctx->buffer holds the 1..128 bytes not
+ * yet sent to it.
+ */
+static unsigned int nvt_sha512_held( const mbedtls_sha512_context *ctx )
+{
+    if( ctx->total[0] == 0 && ctx->total[1] == 0 )
+        return( 0 );
+
+    return( (unsigned int)( ( ctx->total[0] - 1 ) & 0x7F ) + 1 );
+}
+
+/*
+ * The engine failed a transfer and the state of the message is lost with
+ * it: give the engine up, the hash has to be started again.
+ */
+static int nvt_sha512_fail( mbedtls_sha512_context *ctx )
+{
+    nvt_sha_release( ctx );
+    ctx->nvt_hw = 0;
+    return( MBEDTLS_ERR_SHA512_HW_ACCEL_FAILED );
+}
+
+static int nvt_sha512_update( mbedtls_sha512_context *ctx, unsigned int held,
+                               const unsigned char *input, size_t ilen )
+{
+    size_t fill, n;
+
+    fill = 128 - held;
+    if( fill > ilen )
+        fill = ilen;
+
+    memcpy( ctx->buffer + held, input, fill );
+    input += fill;
+    ilen  -= fill;
+
+    if( ilen == 0 )
+        return( 0 );
+
+    if( nvt_sha_feed( ctx->buffer, 128, 0 ) != 0 )
+        return( nvt_sha512_fail( ctx ) );
+
+    n = ( ( ilen - 1 ) / 128 ) * 128;
+    if( n > 0 && ( (uint32_t)input & 0x3 ) == 0 )
+    {
+        if( nvt_sha_feed( input, n, 0 ) != 0 )
+            return( nvt_sha512_fail( ctx ) );
+        input += n;
+        ilen  -= n;
+    }
+
+    while( ilen > 128 )
+    {
+        memcpy( ctx->buffer, input, 128 );
+        if( nvt_sha_feed( ctx->buffer, 128, 0 ) != 0 )
+            return( nvt_sha512_fail( ctx ) );
+        input += 128;
+        ilen  -= 128;
+    }
+
+    memcpy( ctx->buffer, input, ilen );
+    return( 0 );
+}
+
+static void nvt_sha512_detach( void *p )
+{
+    mbedtls_sha512_context *ctx = (mbedtls_sha512_context *) p;
+    unsigned int held;
+    uint32_t  words[16];
+    int       i;
+
+    if( !ctx->nvt_hw )
+        return;
+
+    held = nvt_sha512_held( ctx );
+
+    if( nvt_sha_read_state( words, 16 ) )
+    {
+        for( i = 0; i < 8; i++ )
+            ctx->state[i] = ( (uint64_t) words[2 * i] << 32 ) | words[2 * i + 1];
+    }
+    nvt_sha_release( ctx );
+    ctx->nvt_hw = 0;
+
+    if( held == 128 )
+        mbedtls_internal_sha512_process( ctx, ctx->buffer );
+}
+#endif /* NUVOTON_ENABLE_SHA */
+
 void mbedtls_sha512_init( mbedtls_sha512_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_sha512_context ) );
@@ -98,12 +196,21 @@ void mbedtls_sha512_free( mbedtls_sha512_context *ctx )
     if( ctx == NULL )
         return;
 
+#ifdef NUVOTON_ENABLE_SHA
+    nvt_sha_release( ctx );
+#endif
+
     mbedtls_platform_zeroize( ctx, sizeof( mbedtls_sha512_context ) );
 }
 
 void mbedtls_sha512_clone( mbedtls_sha512_context *dst,
                            const mbedtls_sha512_context *src )
 {
+#ifdef NUVOTON_ENABLE_SHA
+    /* The engine state cannot be duplicated, both copies go on in software */
+    nvt_sha512_detach( (mbedtls_sha512_context *) src );
+#endif
+
     *dst = *src;
 }
 
@@ -112,6 +219,10 @@ void mbedtls_sha512_clone( mbedtls_sha512_context *dst,
  */
 int mbedtls_sha512_starts_ret( mbedtls_sha512_context *ctx, int is384 )
 {
+#ifdef NUVOTON_ENABLE_SHA
+    ctx->nvt_hw = nvt_sha_claim( ctx, is384 ? SHA_MODE_SHA384 : SHA_MODE_SHA512 );
+#endif
+
     ctx->total[0] = 0;
     ctx->total[1] = 0;
 
@@ -300,11 +411,21 @@ int mbedtls_sha512_update_ret( mbedtls_sha512_context *ctx,
     left = (unsigned int) (ctx->total[0] & 0x7F);
     fill = 128 - left;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+        left = nvt_sha512_held( ctx );
+#endif
+
     ctx->total[0] += (uint64_t) ilen;
 
     if( ctx->total[0] < (uint64_t) ilen )
         ctx->total[1]++;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+        return( nvt_sha512_update( ctx, left, input, ilen ) );
+#endif
+
     if( left && ilen >= fill )
     {
         memcpy( (void *) (ctx->buffer + left), input, fill );
@@ -351,6 +472,36 @@ int mbedtls_sha512_finish_ret( mbedtls_sha512_context *ctx,
     unsigned used;
     uint64_t high, low;
 
+#ifdef NUVOTON_ENABLE_SHA
+    if( ctx->nvt_hw )
+    {
+        uint32_t  digest[16];
+        int       i;
+
+        used = nvt_sha512_held( ctx );
+        if( used > 0 )
+        {
+            if( nvt_sha_feed( ctx->buffer, used, 1 ) != 0 )
+                return( nvt_sha512_fail( ctx ) );
+            SHA_Read( CRPT, digest );
+            nvt_sha_release( ctx );
+            ctx->nvt_hw = 0;
+
+            for( i = 0; i < ( ctx->is384 ? 12 : 16 ); i++ )
+            {
+                output[4 * i    ] = (unsigned char)( digest[i] >> 24 );
+                output[4 * i + 1] = (unsigned char)( digest[i] >> 16 );
+                output[4 * i + 2] = (unsigned char)( digest[i] >>  8 );
+                output[4 * i + 3] = (unsigned char)( digest[i]       );
+            }
+
+            return( 0 );
+        }
+
+        nvt_sha512_detach( ctx );
+    }
+#endif
+
     /*
      * Add padding: 0x80 then 0x00 until 16 bytes remain for the length
      */
@@ -446,70 +597,11 @@ exit:
 
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
 
-#ifdef NUVOTON_ENABLE_SHA
-static void mbedtls_sha512_nuvoton( const unsigned char *input, size_t ilen,
-             unsigned char output[32], int is384 )
-{
-    int        i, wcnt;
-    uint8_t    remain[4] = {0,0,0,0};
-    uint32_t   *digest = (uint32_t *)&CRPT->HMAC_DGST[0];
-    
-    g_Crypto_Int_done = 0;
-
-	CRPT->HMAC_DMACNT = ilen;
-	if (is384)
-	{
-    	CRPT->HMAC_CTL = (SHA_MODE_SHA384 << CRPT_HMAC_CTL_OPMODE_Pos) | CRPT_HMAC_CTL_START_Msk;
-    	wcnt = 12;
-    }
-	else
-	{    	
-		CRPT->HMAC_CTL = (SHA_MODE_SHA512 << CRPT_HMAC_CTL_OPMODE_Pos) | CRPT_HMAC_CTL_START_Msk;
-		wcnt = 16;
-	}
-    
-    for ( ; ilen>=4; input+=4, ilen-=4)
-    {
-    	while (!(CRPT->HMAC_STS & CRPT_HMAC_STS_DATINREQ_Msk));
-    	
-    	if (ilen == 4)
-    		CRPT->HMAC_CTL |= CRPT_HMAC_CTL_DMALAST_Msk | CRPT_HMAC_CTL_START_Msk;
-    	
-    	CRPT->HMAC_DATIN = (input[0]<<24) | (input[1]<<16) | (input[2]<<8) | input[3];
-	}
-	if (ilen > 0)
-	{
-		memcpy(remain, input, ilen);
-		while (!(CRPT->HMAC_STS & CRPT_HMAC_STS_DATINREQ_Msk));
-		CRPT->HMAC_CTL |= CRPT_HMAC_CTL_DMALAST_Msk | CRPT_HMAC_CTL_START_Msk;
-		CRPT->HMAC_DATIN = (remain[0]<<24) | (remain[1]<<16) | (remain[2]<<8) | remain[3];
-	} 
-	
-	while (g_Crypto_Int_done == 0);
-	
-	for (i = 0; i < wcnt; i++, output+=4, digest++)
-	{
-		output[0] = (*digest>>24) & 0xff;
-		output[1] = (*digest>>16) & 0xff;
-		output[2] = (*digest>>8) & 0xff;
-		output[3] = *digest & 0xff;
-	}
-}
-#endif
-
 void mbedtls_sha512( const unsigned char *input,
                      size_t ilen,
                      unsigned char output[64],
                      int is384 )
 {
-#ifdef NUVOTON_ENABLE_SHA
-	if (ilen > 0)
-	{
-		mbedtls_sha512_nuvoton(input, ilen, output, is384);
-		return;
-	}	
-#endif    
-
     mbedtls_sha512_ret( input, ilen, output, is384 );
 }
 #endif